@@ -912,6 +912,9 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 	run->exit_reason = KVM_EXIT_UNKNOWN;
 	run->flags = 0;
 	while (ret > 0) {
+		enum kvm_exit_type exit_type;
+		u64 exit_start;
+
 		/*
 		 * Check conditions before entering the guest
 		 */
@@ -976,6 +979,7 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 		guest_timing_enter_irqoff();
 
 		ret = kvm_arm_vcpu_enter_exit(vcpu);
+		exit_start = ktime_get_ns();
 
 		vcpu->mode = OUTSIDE_GUEST_MODE;
 		vcpu->stat.exits++;
@@ -1055,7 +1059,9 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 			ret = ARM_EXCEPTION_IL;
 		}
 
+		exit_type = kvm_get_exit_type(vcpu, ret);
 		ret = handle_exit(vcpu, ret);
+		kvm_vcpu_account_exit(vcpu, exit_type, exit_start);
 	}
 
 	/* Tell userspace about in-kernel device output levels */
@@ -261,6 +261,47 @@ static exit_handle_fn kvm_get_exit_handler(struct kvm_vcpu *vcpu)
 	return arm_exit_handlers[esr_ec];
 }
 
+/*
+ * Classify an exit for the exit latency histograms, before it gets handled.
+ */
+enum kvm_exit_type kvm_get_exit_type(struct kvm_vcpu *vcpu, int exception_index)
+{
+	if (ARM_SERROR_PENDING(exception_index))
+		return KVM_EXIT_TYPE_OTHER;
+
+	switch (ARM_EXCEPTION_CODE(exception_index)) {
+	case ARM_EXCEPTION_IRQ:
+		return KVM_EXIT_TYPE_IRQ;
+	case ARM_EXCEPTION_TRAP:
+		break;
+	default:
+		return KVM_EXIT_TYPE_OTHER;
+	}
+
+	switch (ESR_ELx_EC(kvm_vcpu_get_esr(vcpu))) {
+	case ESR_ELx_EC_WFx:
+		return KVM_EXIT_TYPE_HALT;
+	case ESR_ELx_EC_IABT_LOW:
+	case ESR_ELx_EC_DABT_LOW:
+		return KVM_EXIT_TYPE_MEM_FAULT;
+	case ESR_ELx_EC_HVC32:
+	case ESR_ELx_EC_HVC64:
+	case ESR_ELx_EC_SMC32:
+	case ESR_ELx_EC_SMC64:
+		return KVM_EXIT_TYPE_HYPERCALL;
+	case ESR_ELx_EC_CP15_32:
+	case ESR_ELx_EC_CP15_64:
+	case ESR_ELx_EC_CP14_MR:
+	case ESR_ELx_EC_CP14_LS:
+	case ESR_ELx_EC_CP14_64:
+	case ESR_ELx_EC_CP10_ID:
+	case ESR_ELx_EC_SYS64:
+		return KVM_EXIT_TYPE_INSN;
+	default:
+		return KVM_EXIT_TYPE_OTHER;
+	}
+}
+
 /*
  * We may be single-stepping an emulated instruction. If the emulation
  * has been completed in the kernel, we can return to userspace with a
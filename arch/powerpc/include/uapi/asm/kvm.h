@@ -32,6 +32,7 @@
 
 /* Not always available, but if it is, this is the correct offset.  */
 #define KVM_COALESCED_MMIO_PAGE_OFFSET 1
+#define KVM_COALESCED_MMIO_RING_PAGE_OFFSET 0x1000
 
 struct kvm_regs {
 	__u64 pc;
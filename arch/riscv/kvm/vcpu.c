@@ -1134,6 +1134,7 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 {
 	int ret;
 	struct kvm_cpu_trap trap;
+	u64 exit_start;
 	struct kvm_run *run = vcpu->run;
 
 	/* Mark this VCPU ran at least once */
@@ -1238,6 +1239,7 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 		guest_timing_enter_irqoff();
 
 		kvm_riscv_vcpu_enter_exit(vcpu);
+		exit_start = ktime_get_ns();
 
 		vcpu->mode = OUTSIDE_GUEST_MODE;
 		vcpu->stat.exits++;
@@ -1278,6 +1280,8 @@ int kvm_arch_vcpu_ioctl_run(struct kvm_vcpu *vcpu)
 		kvm_vcpu_srcu_read_lock(vcpu);
 
 		ret = kvm_riscv_vcpu_exit(vcpu, run, &trap);
+		kvm_vcpu_account_exit(vcpu, kvm_riscv_vcpu_exit_type(&trap),
+				      exit_start);
 	}
 
 	kvm_sigset_deactivate(vcpu);
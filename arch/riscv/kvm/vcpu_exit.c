@@ -165,6 +165,28 @@ void kvm_riscv_vcpu_trap_redirect(struct kvm_vcpu *vcpu,
 	vcpu->arch.guest_context.sstatus |= SR_SPP;
 }
 
+/*
+ * Classify a trap for the exit latency histograms.
+ */
+enum kvm_exit_type kvm_riscv_vcpu_exit_type(struct kvm_cpu_trap *trap)
+{
+	if (trap->scause & CAUSE_IRQ_FLAG)
+		return KVM_EXIT_TYPE_IRQ;
+
+	switch (trap->scause) {
+	case EXC_VIRTUAL_INST_FAULT:
+		return KVM_EXIT_TYPE_INSN;
+	case EXC_INST_GUEST_PAGE_FAULT:
+	case EXC_LOAD_GUEST_PAGE_FAULT:
+	case EXC_STORE_GUEST_PAGE_FAULT:
+		return KVM_EXIT_TYPE_MEM_FAULT;
+	case EXC_SUPERVISOR_SYSCALL:
+		return KVM_EXIT_TYPE_HYPERCALL;
+	default:
+		return KVM_EXIT_TYPE_OTHER;
+	}
+}
+
 /*
  * Return > 0 to return to guest, < 0 on error, 0 (and set exit_reason) on
  * proper exit to userspace.
@@ -14,6 +14,7 @@
 #define KVM_PIO_PAGE_OFFSET 1
 #define KVM_COALESCED_MMIO_PAGE_OFFSET 2
 #define KVM_DIRTY_LOG_PAGE_OFFSET 64
+#define KVM_COALESCED_MMIO_RING_PAGE_OFFSET 0x1000
 
 #define DE_VECTOR 0
 #define DB_VECTOR 1
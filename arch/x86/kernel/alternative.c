@@ -1537,6 +1537,14 @@ void __init alternative_instructions(void)
 	 */
 	paravirt_set_cap();
 
+#ifdef CONFIG_NUMA_AWARE_SPINLOCKS
+	/*
+	 * Pick the NUMA-aware spinlock slowpath before the paravirt calls
+	 * into queued_spin_lock_slowpath() get patched below.
+	 */
+	cna_configure_spin_lock_slowpath();
+#endif
+
 	/*
 	 * First patch paravirt functions, such that we overwrite the indirect
 	 * call with the direct call.
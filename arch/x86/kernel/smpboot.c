@@ -655,6 +655,15 @@ static void __init build_sched_topology(void)
 		x86_topology[i++] = (struct sched_domain_topology_level){
 			cpu_cpu_mask, SD_INIT_NAME(DIE)
 		};
+		/*
+		 * Zen packages are made of several CCXs with their own L3, so
+		 * balancing at DIE level crosses an LLC: treat tasks as cache
+		 * hot for longer there.
+		 */
+		if ((boot_cpu_data.x86_vendor == X86_VENDOR_AMD ||
+		     boot_cpu_data.x86_vendor == X86_VENDOR_HYGON) &&
+		    boot_cpu_data.x86 >= 0x17)
+			x86_topology[i - 1].migration_cost = 2 * NSEC_PER_MSEC;
 	}
 
 	/*
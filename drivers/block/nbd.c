@@ -83,6 +83,7 @@ struct link_dead_args {
 #define NBD_RT_BOUND			5
 #define NBD_RT_DISCONNECT_ON_CLOSE	6
 #define NBD_RT_HAS_BACKEND_FILE		7
+#define NBD_RT_STRUCTURED_REPLY		8
 
 #define NBD_DESTROY_ON_DISCONNECT	0
 #define NBD_DISCONNECT_REQUESTED	1
@@ -550,6 +551,36 @@ static inline int was_interrupted(int result)
 	return result == -ERESTARTSYS || result == -EINTR;
 }
 
+static void nbd_bio_iter(struct iov_iter *iter, struct bio *bio)
+{
+	struct bio_vec *vec = __bvec_iter_bvec(bio->bi_io_vec, bio->bi_iter);
+	struct bvec_iter bi;
+	struct bio_vec bv;
+	unsigned int nr_bvec = 0;
+
+	bio_for_each_bvec(bv, bio, bi)
+		nr_bvec++;
+
+	iov_iter_bvec(iter, ITER_SOURCE, vec, nr_bvec, bio->bi_iter.bi_size);
+	iter->iov_offset = bio->bi_iter.bi_bvec_done;
+}
+
+/*
+ * The pages of the bio can be spliced into the socket instead of copied,
+ * unless one of them can't be referenced by the network stack.
+ */
+static bool nbd_bio_sendpage_ok(struct bio *bio)
+{
+	struct bvec_iter iter;
+	struct bio_vec bvec;
+
+	bio_for_each_segment(bvec, bio, iter) {
+		if (!sendpage_ok(bvec.bv_page))
+			return false;
+	}
+	return true;
+}
+
 /* always call with the tx_lock held */
 static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 {
@@ -641,52 +672,49 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 	if (type != NBD_CMD_WRITE)
 		goto out;
 
+	/* a single sendmsg for all the segments of each bio */
 	bio = req->bio;
 	while (bio) {
+		/*
+		 * The completion might already have come in once the last
+		 * byte is sent, so don't touch the bio after that. This
+		 * prevents use-after-free of the bio.
+		 */
 		struct bio *next = bio->bi_next;
-		struct bvec_iter iter;
-		struct bio_vec bvec;
-
-		bio_for_each_segment(bvec, bio, iter) {
-			bool is_last = !next && bio_iter_last(bvec, iter);
-			int flags = is_last ? 0 : MSG_MORE;
-
-			dev_dbg(nbd_to_dev(nbd), "request %p: sending %d bytes data\n",
-				req, bvec.bv_len);
-			iov_iter_bvec(&from, ITER_SOURCE, &bvec, 1, bvec.bv_len);
-			if (skip) {
-				if (skip >= iov_iter_count(&from)) {
-					skip -= iov_iter_count(&from);
-					continue;
-				}
-				iov_iter_advance(&from, skip);
-				skip = 0;
-			}
-			result = sock_xmit(nbd, index, 1, &from, flags, &sent);
-			if (result < 0) {
-				if (was_interrupted(result)) {
-					/* We've already sent the header, we
-					 * have no choice but to set pending and
-					 * return BUSY.
-					 */
-					nsock->pending = req;
-					nsock->sent = sent;
-					set_bit(NBD_CMD_REQUEUED, &cmd->flags);
-					return BLK_STS_RESOURCE;
-				}
-				dev_err(disk_to_dev(nbd->disk),
-					"Send data failed (result %d)\n",
-					result);
-				return -EAGAIN;
+		unsigned int size = bio->bi_iter.bi_size;
+		int flags = next ? MSG_MORE : 0;
+
+		if (skip >= size) {
+			skip -= size;
+			bio = next;
+			continue;
+		}
+
+		dev_dbg(nbd_to_dev(nbd), "request %p: sending %u bytes data\n",
+			req, size - skip);
+		nbd_bio_iter(&from, bio);
+		if (skip) {
+			iov_iter_advance(&from, skip);
+			skip = 0;
+		}
+		if (nbd_bio_sendpage_ok(bio))
+			flags |= MSG_SPLICE_PAGES;
+		result = sock_xmit(nbd, index, 1, &from, flags, &sent);
+		if (result < 0) {
+			if (was_interrupted(result)) {
+				/* We've already sent the header, we
+				 * have no choice but to set pending and
+				 * return BUSY.
+				 */
+				nsock->pending = req;
+				nsock->sent = sent;
+				set_bit(NBD_CMD_REQUEUED, &cmd->flags);
+				return BLK_STS_RESOURCE;
 			}
-			/*
-			 * The completion might already have come in,
-			 * so break for the last one instead of letting
-			 * the iterator do it. This prevents use-after-free
-			 * of the bio.
-			 */
-			if (is_last)
-				break;
+			dev_err(disk_to_dev(nbd->disk),
+				"Send data failed (result %d)\n",
+				result);
+			return -EAGAIN;
 		}
 		bio = next;
 	}
@@ -697,47 +725,67 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 	return 0;
 }
 
-static int nbd_read_reply(struct nbd_device *nbd, int index,
-			  struct nbd_reply *reply)
+/*
+ * Either reply flavour, the simple reply and the first 16 bytes of the
+ * structured reply chunk header share the layout of magic and cookie.
+ */
+union nbd_any_reply {
+	struct nbd_reply simple;
+	struct nbd_structured_reply chunk;
+};
+
+static int nbd_recv_kvec(struct nbd_device *nbd, int index, void *buf,
+			 size_t len)
 {
-	struct kvec iov = {.iov_base = reply, .iov_len = sizeof(*reply)};
+	struct kvec iov = {.iov_base = buf, .iov_len = len};
 	struct iov_iter to;
+
+	iov_iter_kvec(&to, ITER_DEST, &iov, 1, len);
+	return sock_xmit(nbd, index, 0, &to, MSG_WAITALL, NULL);
+}
+
+static int nbd_read_reply(struct nbd_device *nbd, int index,
+			  union nbd_any_reply *reply)
+{
+	struct nbd_config *config = nbd->config;
 	int result;
+	u32 magic;
 
-	reply->magic = 0;
-	iov_iter_kvec(&to, ITER_DEST, &iov, 1, sizeof(*reply));
-	result = sock_xmit(nbd, index, 0, &to, MSG_WAITALL, NULL);
-	if (result < 0) {
-		if (!nbd_disconnected(nbd->config))
-			dev_err(disk_to_dev(nbd->disk),
-				"Receive control failed (result %d)\n", result);
-		return result;
-	}
+	reply->simple.magic = 0;
+	result = nbd_recv_kvec(nbd, index, &reply->simple,
+			       sizeof(reply->simple));
+	if (result < 0)
+		goto err;
 
-	if (ntohl(reply->magic) != NBD_REPLY_MAGIC) {
-		dev_err(disk_to_dev(nbd->disk), "Wrong magic (0x%lx)\n",
-				(unsigned long)ntohl(reply->magic));
-		return -EPROTO;
+	magic = ntohl(reply->simple.magic);
+	if (magic == NBD_REPLY_MAGIC)
+		return 0;
+
+	if (magic == NBD_STRUCTURED_REPLY_MAGIC &&
+	    test_bit(NBD_RT_STRUCTURED_REPLY, &config->runtime_flags)) {
+		result = nbd_recv_kvec(nbd, index, &reply->chunk.length,
+				       sizeof(reply->chunk.length));
+		if (result < 0)
+			goto err;
+		return 0;
 	}
 
-	return 0;
+	dev_err(disk_to_dev(nbd->disk), "Wrong magic (0x%lx)\n",
+			(unsigned long)magic);
+	return -EPROTO;
+err:
+	if (!nbd_disconnected(config))
+		dev_err(disk_to_dev(nbd->disk),
+			"Receive control failed (result %d)\n", result);
+	return result;
 }
 
-/* NULL returned = something went wrong, inform userspace */
-static struct nbd_cmd *nbd_handle_reply(struct nbd_device *nbd, int index,
-					struct nbd_reply *reply)
+static struct nbd_cmd *nbd_handle_to_cmd(struct nbd_device *nbd, u64 handle)
 {
-	int result;
-	struct nbd_cmd *cmd;
 	struct request *req = NULL;
-	u64 handle;
-	u16 hwq;
-	u32 tag;
-	int ret = 0;
+	u32 tag = nbd_handle_to_tag(handle);
+	u16 hwq = blk_mq_unique_tag_to_hwq(tag);
 
-	handle = be64_to_cpu(reply->cookie);
-	tag = nbd_handle_to_tag(handle);
-	hwq = blk_mq_unique_tag_to_hwq(tag);
 	if (hwq < nbd->tag_set.nr_hw_queues)
 		req = blk_mq_tag_to_rq(nbd->tag_set.tags[hwq],
 				       blk_mq_unique_tag_to_tag(tag));
@@ -747,39 +795,128 @@ static struct nbd_cmd *nbd_handle_reply(struct nbd_device *nbd, int index,
 		return ERR_PTR(-ENOENT);
 	}
 	trace_nbd_header_received(req, handle);
-	cmd = blk_mq_rq_to_pdu(req);
+	return blk_mq_rq_to_pdu(req);
+}
+
+/*
+ * Check that the reply is for the current incarnation of @cmd on this
+ * socket. Called with cmd->lock held. A structured reply may still be
+ * received after an error chunk marked the command as failed.
+ */
+static int nbd_check_reply(struct nbd_device *nbd, int index,
+			   struct nbd_cmd *cmd, u64 handle, bool chunk)
+{
+	struct request *req = blk_mq_rq_from_pdu(cmd);
+	u32 tag = nbd_handle_to_tag(handle);
 
-	mutex_lock(&cmd->lock);
 	if (!test_bit(NBD_CMD_INFLIGHT, &cmd->flags)) {
 		dev_err(disk_to_dev(nbd->disk), "Suspicious reply %d (status %u flags %lu)",
 			tag, cmd->status, cmd->flags);
-		ret = -ENOENT;
-		goto out;
+		return -ENOENT;
 	}
 	if (cmd->index != index) {
 		dev_err(disk_to_dev(nbd->disk), "Unexpected reply %d from different sock %d (expected %d)",
 			tag, index, cmd->index);
-		ret = -ENOENT;
-		goto out;
+		return -ENOENT;
 	}
 	if (cmd->cmd_cookie != nbd_handle_to_cookie(handle)) {
 		dev_err(disk_to_dev(nbd->disk), "Double reply on req %p, cmd_cookie %u, handle cookie %u\n",
 			req, cmd->cmd_cookie, nbd_handle_to_cookie(handle));
-		ret = -ENOENT;
-		goto out;
+		return -ENOENT;
 	}
-	if (cmd->status != BLK_STS_OK) {
+	if (cmd->status != BLK_STS_OK && !chunk) {
 		dev_err(disk_to_dev(nbd->disk), "Command already handled %p\n",
 			req);
-		ret = -ENOENT;
-		goto out;
+		return -ENOENT;
 	}
 	if (test_bit(NBD_CMD_REQUEUED, &cmd->flags)) {
 		dev_err(disk_to_dev(nbd->disk), "Raced with timeout on req %p\n",
 			req);
-		ret = -ENOENT;
-		goto out;
+		return -ENOENT;
 	}
+	return 0;
+}
+
+/*
+ * Receive @len bytes of payload into the request, starting at byte @offset
+ * of the request, or zero that range if @zero is set. Called with cmd->lock
+ * held.
+ */
+static int nbd_rq_fill(struct nbd_device *nbd, int index, struct nbd_cmd *cmd,
+		       u64 offset, u32 len, bool zero)
+{
+	struct request *req = blk_mq_rq_from_pdu(cmd);
+	struct req_iterator iter;
+	struct bio_vec bvec;
+	struct iov_iter to;
+	u64 pos = 0;
+	int result;
+
+	rq_for_each_segment(bvec, req, iter) {
+		u64 end = pos + bvec.bv_len;
+
+		if (!len)
+			break;
+		if (end <= offset) {
+			pos = end;
+			continue;
+		}
+		if (offset > pos) {
+			bvec.bv_offset += offset - pos;
+			bvec.bv_len -= offset - pos;
+		}
+		bvec.bv_len = min(bvec.bv_len, len);
+		pos = end;
+		offset += bvec.bv_len;
+		len -= bvec.bv_len;
+
+		if (zero) {
+			memzero_bvec(&bvec);
+			continue;
+		}
+
+		iov_iter_bvec(&to, ITER_DEST, &bvec, 1, bvec.bv_len);
+		result = sock_xmit(nbd, index, 0, &to, MSG_WAITALL, NULL);
+		if (result < 0) {
+			dev_err(disk_to_dev(nbd->disk), "Receive data failed (result %d)\n",
+				result);
+			/*
+			 * If we've disconnected, we need to make sure we
+			 * complete this request, otherwise error out
+			 * and let the timeout stuff handle resubmitting
+			 * this request onto another connection.
+			 */
+			if (nbd_disconnected(nbd->config)) {
+				cmd->status = BLK_STS_IOERR;
+				return 0;
+			}
+			return -EIO;
+		}
+		dev_dbg(nbd_to_dev(nbd), "request %p: got %d bytes data\n",
+			req, bvec.bv_len);
+	}
+	return 0;
+}
+
+/* NULL returned = something went wrong, inform userspace */
+static struct nbd_cmd *nbd_handle_reply(struct nbd_device *nbd, int index,
+					struct nbd_reply *reply)
+{
+	struct nbd_cmd *cmd;
+	struct request *req;
+	u64 handle;
+	int ret;
+
+	handle = be64_to_cpu(reply->cookie);
+	cmd = nbd_handle_to_cmd(nbd, handle);
+	if (IS_ERR(cmd))
+		return cmd;
+	req = blk_mq_rq_from_pdu(cmd);
+
+	mutex_lock(&cmd->lock);
+	ret = nbd_check_reply(nbd, index, cmd, handle, false);
+	if (ret)
+		goto out;
 	if (ntohl(reply->error)) {
 		dev_err(disk_to_dev(nbd->disk), "Other side returned error (%d)\n",
 			ntohl(reply->error));
@@ -788,40 +925,155 @@ static struct nbd_cmd *nbd_handle_reply(struct nbd_device *nbd, int index,
 	}
 
 	dev_dbg(nbd_to_dev(nbd), "request %p: got reply\n", req);
-	if (rq_data_dir(req) != WRITE) {
-		struct req_iterator iter;
-		struct bio_vec bvec;
-		struct iov_iter to;
-
-		rq_for_each_segment(bvec, req, iter) {
-			iov_iter_bvec(&to, ITER_DEST, &bvec, 1, bvec.bv_len);
-			result = sock_xmit(nbd, index, 0, &to, MSG_WAITALL, NULL);
-			if (result < 0) {
-				dev_err(disk_to_dev(nbd->disk), "Receive data failed (result %d)\n",
-					result);
-				/*
-				 * If we've disconnected, we need to make sure we
-				 * complete this request, otherwise error out
-				 * and let the timeout stuff handle resubmitting
-				 * this request onto another connection.
-				 */
-				if (nbd_disconnected(nbd->config)) {
-					cmd->status = BLK_STS_IOERR;
-					goto out;
-				}
+	if (rq_data_dir(req) != WRITE)
+		ret = nbd_rq_fill(nbd, index, cmd, 0, blk_rq_bytes(req), false);
+out:
+	trace_nbd_payload_received(req, handle);
+	mutex_unlock(&cmd->lock);
+	return ret ? ERR_PTR(ret) : cmd;
+}
+
+/* Read and log the payload of an error chunk */
+static int nbd_handle_error_chunk(struct nbd_device *nbd, int index,
+				  struct nbd_cmd *cmd, u16 type, u32 len)
+{
+	struct {
+		__be32 error;
+		__be16 msg_len;
+	} __packed err;
+	char buf[64];
+	int result;
+
+	if (len < sizeof(err)) {
+		dev_err(disk_to_dev(nbd->disk), "Short error chunk (%u)\n",
+			len);
+		return -EPROTO;
+	}
+	result = nbd_recv_kvec(nbd, index, &err, sizeof(err));
+	if (result < 0)
+		return -EIO;
+	len -= sizeof(err);
+
+	/* the message and the offset aren't of any use to us */
+	while (len) {
+		size_t n = min_t(size_t, len, sizeof(buf));
+
+		result = nbd_recv_kvec(nbd, index, buf, n);
+		if (result < 0)
+			return -EIO;
+		len -= n;
+	}
+
+	dev_err(disk_to_dev(nbd->disk), "Other side returned error (%d, type %u)\n",
+		be32_to_cpu(err.error), type);
+	cmd->status = BLK_STS_IOERR;
+	return 0;
+}
+
+/*
+ * Handle one chunk of a structured reply. *@done is set once the last chunk
+ * of the reply was received and the command can be completed.
+ */
+static struct nbd_cmd *nbd_handle_chunk(struct nbd_device *nbd, int index,
+					struct nbd_structured_reply *chunk,
+					bool *done)
+{
+	u16 flags = be16_to_cpu(chunk->flags);
+	u16 type = be16_to_cpu(chunk->type);
+	u32 len = be32_to_cpu(chunk->length);
+	struct nbd_cmd *cmd;
+	struct request *req;
+	__be64 offset;
+	u64 handle;
+	u64 off;
+	int ret;
+
+	handle = be64_to_cpu(chunk->cookie);
+	cmd = nbd_handle_to_cmd(nbd, handle);
+	if (IS_ERR(cmd))
+		return cmd;
+	req = blk_mq_rq_from_pdu(cmd);
+
+	mutex_lock(&cmd->lock);
+	ret = nbd_check_reply(nbd, index, cmd, handle, true);
+	if (ret)
+		goto out;
+
+	switch (type) {
+	case NBD_REPLY_TYPE_NONE:
+		if (len)
+			ret = -EPROTO;
+		break;
+	case NBD_REPLY_TYPE_OFFSET_DATA:
+	case NBD_REPLY_TYPE_OFFSET_HOLE:
+		if (req_op(req) != REQ_OP_READ || len < sizeof(offset) ||
+		    (type == NBD_REPLY_TYPE_OFFSET_HOLE &&
+		     len != sizeof(offset) + sizeof(__be32))) {
+			ret = -EPROTO;
+			break;
+		}
+		if (nbd_recv_kvec(nbd, index, &offset, sizeof(offset)) < 0) {
+			ret = -EIO;
+			break;
+		}
+		len -= sizeof(offset);
+		if (type == NBD_REPLY_TYPE_OFFSET_HOLE) {
+			__be32 hole;
+
+			if (nbd_recv_kvec(nbd, index, &hole, sizeof(hole)) < 0) {
 				ret = -EIO;
-				goto out;
+				break;
 			}
-			dev_dbg(nbd_to_dev(nbd), "request %p: got %d bytes data\n",
-				req, bvec.bv_len);
+			len = be32_to_cpu(hole);
+		}
+
+		off = be64_to_cpu(offset) - blk_rq_pos(req) * SECTOR_SIZE;
+		if (be64_to_cpu(offset) < blk_rq_pos(req) * SECTOR_SIZE ||
+		    off + len > blk_rq_bytes(req)) {
+			dev_err(disk_to_dev(nbd->disk), "Chunk out of range on req %p\n",
+				req);
+			ret = -EPROTO;
+			break;
 		}
+		ret = nbd_rq_fill(nbd, index, cmd, off, len,
+				  type == NBD_REPLY_TYPE_OFFSET_HOLE);
+		break;
+	default:
+		if (NBD_REPLY_TYPE_IS_ERR(type))
+			ret = nbd_handle_error_chunk(nbd, index, cmd, type, len);
+		else
+			ret = -EPROTO;
+		break;
 	}
+	if (ret == -EPROTO)
+		dev_err(disk_to_dev(nbd->disk), "Invalid chunk (type %u length %u) on req %p\n",
+			type, be32_to_cpu(chunk->length), req);
+
+	*done = flags & NBD_REPLY_FLAG_DONE;
+	if (*done)
+		trace_nbd_payload_received(req, handle);
 out:
-	trace_nbd_payload_received(req, handle);
 	mutex_unlock(&cmd->lock);
 	return ret ? ERR_PTR(ret) : cmd;
 }
 
+/*
+ * Run the receive work of a socket on the node of the CPUs submitting to its
+ * hardware queue, so the replies are parsed next to where the requests were
+ * issued and get completed.
+ */
+static int nbd_sock_node(struct nbd_device *nbd, int index)
+{
+	struct blk_mq_queue_map *qmap = &nbd->tag_set.map[HCTX_TYPE_DEFAULT];
+	unsigned int cpu;
+
+	for_each_online_cpu(cpu) {
+		if (qmap->mq_map[cpu] == index)
+			return cpu_to_node(cpu);
+	}
+	return NUMA_NO_NODE;
+}
+
 static void recv_work(struct work_struct *work)
 {
 	struct recv_thread_args *args = container_of(work,
@@ -835,7 +1087,8 @@ static void recv_work(struct work_struct *work)
 	struct request *rq;
 
 	while (1) {
-		struct nbd_reply reply;
+		union nbd_any_reply reply;
+		bool done = true;
 
 		if (nbd_read_reply(nbd, args->index, &reply))
 			break;
@@ -852,11 +1105,19 @@ static void recv_work(struct work_struct *work)
 			break;
 		}
 
-		cmd = nbd_handle_reply(nbd, args->index, &reply);
+		if (ntohl(reply.simple.magic) == NBD_STRUCTURED_REPLY_MAGIC)
+			cmd = nbd_handle_chunk(nbd, args->index, &reply.chunk,
+					       &done);
+		else
+			cmd = nbd_handle_reply(nbd, args->index, &reply.simple);
 		if (IS_ERR(cmd)) {
 			percpu_ref_put(&q->q_usage_counter);
 			break;
 		}
+		if (!done) {
+			percpu_ref_put(&q->q_usage_counter);
+			continue;
+		}
 
 		rq = blk_mq_rq_from_pdu(cmd);
 		if (likely(!blk_should_fake_timeout(rq->q))) {
@@ -1225,7 +1486,8 @@ static int nbd_reconnect_socket(struct nbd_device *nbd, unsigned long arg)
 		/* We take the tx_mutex in an error path in the recv_work, so we
 		 * need to queue_work outside of the tx_mutex.
 		 */
-		queue_work(nbd->recv_workq, &args->work);
+		queue_work_node(nbd_sock_node(nbd, i), nbd->recv_workq,
+				&args->work);
 
 		atomic_inc(&config->live_connections);
 		wake_up(&config->conn_wait);
@@ -1399,7 +1661,8 @@ static int nbd_start_device(struct nbd_device *nbd)
 		INIT_WORK(&args->work, recv_work);
 		args->nbd = nbd;
 		args->index = i;
-		queue_work(nbd->recv_workq, &args->work);
+		queue_work_node(nbd_sock_node(nbd, i), nbd->recv_workq,
+				&args->work);
 	}
 	return nbd_set_size(nbd, config->bytesize, nbd_blksize(config));
 }
@@ -2038,6 +2301,10 @@ static int nbd_genl_connect(struct sk_buff *skb, struct genl_info *info)
 			set_bit(NBD_RT_DISCONNECT_ON_CLOSE,
 				&config->runtime_flags);
 		}
+		if (flags & NBD_CFLAG_STRUCTURED_REPLY) {
+			set_bit(NBD_RT_STRUCTURED_REPLY,
+				&config->runtime_flags);
+		}
 	}
 
 	if (info->attrs[NBD_ATTR_SOCKETS]) {
@@ -56,7 +56,8 @@
 		| UBLK_F_USER_RECOVERY_REISSUE \
 		| UBLK_F_UNPRIVILEGED_DEV \
 		| UBLK_F_CMD_IOCTL_ENCODE \
-		| UBLK_F_USER_COPY)
+		| UBLK_F_USER_COPY \
+		| UBLK_F_BATCH_IO)
 
 /* All UBLK_PARAM_TYPE_* should be included here */
 #define UBLK_PARAM_TYPE_ALL (UBLK_PARAM_TYPE_BASIC | \
@@ -135,6 +136,17 @@ struct ublk_queue {
 	bool timeout;
 	unsigned short nr_io_ready;	/* how many ios setup */
 	struct ublk_device *dev;
+
+	/*
+	 * UBLK_F_BATCH_IO: the pending FETCH_IO_CMDS command, and whether
+	 * task work delivering requests through it is scheduled
+	 */
+	spinlock_t		batch_lock;
+	struct io_uring_cmd	*batch_cmd;
+	bool			batch_tw;
+	unsigned int		batch_nr;
+	__u16 __user		*batch_tags;
+
 	struct ublk_io ios[];
 };
 
@@ -320,13 +332,25 @@ static inline bool ublk_support_user_copy(const struct ublk_queue *ubq)
 	return ubq->flags & UBLK_F_USER_COPY;
 }
 
+static inline bool ublk_support_zero_copy(const struct ublk_queue *ubq)
+{
+	return ubq->flags & UBLK_F_SUPPORT_ZERO_COPY;
+}
+
+/* the server passes io buffers, and the driver copies data from/to them */
+static inline bool ublk_need_map_io(const struct ublk_queue *ubq)
+{
+	return !ublk_support_user_copy(ubq) && !ublk_support_zero_copy(ubq);
+}
+
 static inline bool ublk_need_req_ref(const struct ublk_queue *ubq)
 {
 	/*
-	 * read()/write() is involved in user copy, so request reference
+	 * read()/write() is involved in user copy, and registered buffers
+	 * outlive the io command with zero copy, so request reference
 	 * has to be grabbed
 	 */
-	return ublk_support_user_copy(ubq);
+	return ublk_support_user_copy(ubq) || ublk_support_zero_copy(ubq);
 }
 
 static inline void ublk_init_req_ref(const struct ublk_queue *ubq,
@@ -368,6 +392,11 @@ static inline bool ublk_need_get_data(const struct ublk_queue *ubq)
 	return ubq->flags & UBLK_F_NEED_GET_DATA;
 }
 
+static inline bool ublk_support_batch_io(const struct ublk_queue *ubq)
+{
+	return ubq->flags & UBLK_F_BATCH_IO;
+}
+
 static struct ublk_device *ublk_get_device(struct ublk_device *ub)
 {
 	if (kobject_get_unless_zero(&ub->cdev_dev.kobj))
@@ -604,7 +633,7 @@ static int ublk_map_io(const struct ublk_queue *ubq, const struct request *req,
 {
 	const unsigned int rq_bytes = blk_rq_bytes(req);
 
-	if (ublk_support_user_copy(ubq))
+	if (!ublk_need_map_io(ubq))
 		return rq_bytes;
 
 	/*
@@ -631,7 +660,7 @@ static int ublk_unmap_io(const struct ublk_queue *ubq,
 {
 	const unsigned int rq_bytes = blk_rq_bytes(req);
 
-	if (ublk_support_user_copy(ubq))
+	if (!ublk_need_map_io(ubq))
 		return rq_bytes;
 
 	if (ublk_need_unmap_req(req)) {
@@ -822,6 +851,24 @@ static void ubq_complete_io_cmd(struct ublk_io *io, int res,
 	io_uring_cmd_done(io->cmd, res, 0, issue_flags);
 }
 
+/*
+ * Hand the request over to the server through the tag array of the pending
+ * FETCH_IO_CMDS command, which is completed once all queued requests are
+ * handled.
+ */
+static void ublk_batch_add_io(struct ublk_queue *ubq, struct ublk_io *io,
+		struct request *req)
+{
+	if (put_user(req->tag, &ubq->batch_tags[ubq->batch_nr])) {
+		blk_mq_end_request(req, BLK_STS_IOERR);
+		return;
+	}
+	ubq->batch_nr++;
+
+	io->flags |= UBLK_IO_FLAG_OWNED_BY_SRV;
+	io->flags &= ~UBLK_IO_FLAG_ACTIVE;
+}
+
 #define UBLK_REQUEUE_DELAY_MS	3
 
 static inline void __ublk_abort_rq(struct ublk_queue *ubq,
@@ -845,7 +892,7 @@ static inline void __ublk_rq_task_work(struct request *req,
 	unsigned int mapped_bytes;
 
 	pr_devel("%s: complete: op %d, qid %d tag %d io_flags %x addr %llx\n",
-			__func__, io->cmd->cmd_op, ubq->q_id, req->tag, io->flags,
+			__func__, req_op(req), ubq->q_id, req->tag, io->flags,
 			ublk_get_iod(ubq, req->tag)->addr);
 
 	/*
@@ -912,7 +959,10 @@ static inline void __ublk_rq_task_work(struct request *req,
 	}
 
 	ublk_init_req_ref(ubq, req);
-	ubq_complete_io_cmd(io, UBLK_IO_RES_OK, issue_flags);
+	if (ublk_support_batch_io(ubq))
+		ublk_batch_add_io(ubq, io, req);
+	else
+		ubq_complete_io_cmd(io, UBLK_IO_RES_OK, issue_flags);
 }
 
 static inline void ublk_forward_io_cmds(struct ublk_queue *ubq,
@@ -943,6 +993,41 @@ static void ublk_rq_task_work_cb(struct io_uring_cmd *cmd, unsigned issue_flags)
 	ublk_forward_io_cmds(ubq, issue_flags);
 }
 
+static void ublk_batch_tw_cb(struct io_uring_cmd *cmd, unsigned issue_flags)
+{
+	struct ublk_uring_cmd_pdu *pdu = ublk_get_uring_cmd_pdu(cmd);
+	struct ublk_queue *ubq = pdu->ubq;
+
+	/* requests queued from now on wait for the next FETCH_IO_CMDS */
+	spin_lock_irq(&ubq->batch_lock);
+	ubq->batch_cmd = NULL;
+	ubq->batch_tw = false;
+	spin_unlock_irq(&ubq->batch_lock);
+
+	ubq->batch_nr = 0;
+	ublk_forward_io_cmds(ubq, issue_flags);
+	io_uring_cmd_done(cmd, ubq->batch_nr, 0, issue_flags);
+}
+
+/*
+ * Schedule delivery of the queued requests, unless there is no FETCH_IO_CMDS
+ * command pending; the next one kicks delivery off then.
+ */
+static void ublk_batch_kick(struct ublk_queue *ubq)
+{
+	struct io_uring_cmd *cmd;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ubq->batch_lock, flags);
+	cmd = ubq->batch_tw ? NULL : ubq->batch_cmd;
+	if (cmd)
+		ubq->batch_tw = true;
+	spin_unlock_irqrestore(&ubq->batch_lock, flags);
+
+	if (cmd)
+		io_uring_cmd_complete_in_task(cmd, ublk_batch_tw_cb);
+}
+
 static void ublk_queue_cmd(struct ublk_queue *ubq, struct request *rq)
 {
 	struct ublk_rq_data *data = blk_mq_rq_to_pdu(rq);
@@ -966,6 +1051,8 @@ static void ublk_queue_cmd(struct ublk_queue *ubq, struct request *rq)
 	 */
 	if (unlikely(io->flags & UBLK_IO_FLAG_ABORTED)) {
 		ublk_abort_io_cmds(ubq);
+	} else if (ublk_support_batch_io(ubq)) {
+		ublk_batch_kick(ubq);
 	} else {
 		struct io_uring_cmd *cmd = io->cmd;
 		struct ublk_uring_cmd_pdu *pdu = ublk_get_uring_cmd_pdu(cmd);
@@ -1146,6 +1233,20 @@ static void ublk_abort_queue(struct ublk_device *ub, struct ublk_queue *ubq)
 				__ublk_fail_req(ubq, io, rq);
 		}
 	}
+
+	/*
+	 * Queued requests without pending delivery wait for a FETCH_IO_CMDS
+	 * which won't come any more
+	 */
+	if (ublk_support_batch_io(ubq)) {
+		bool tw;
+
+		spin_lock_irq(&ubq->batch_lock);
+		tw = ubq->batch_tw;
+		spin_unlock_irq(&ubq->batch_lock);
+		if (!tw)
+			ublk_abort_io_cmds(ubq);
+	}
 	ublk_put_device(ub);
 }
 
@@ -1198,6 +1299,19 @@ static void ublk_cancel_queue(struct ublk_queue *ubq)
 	if (!ublk_queue_ready(ubq))
 		return;
 
+	if (ublk_support_batch_io(ubq)) {
+		struct io_uring_cmd *cmd;
+
+		/* pending task work completes the command by itself */
+		spin_lock_irq(&ubq->batch_lock);
+		cmd = ubq->batch_tw ? NULL : ubq->batch_cmd;
+		ubq->batch_cmd = NULL;
+		spin_unlock_irq(&ubq->batch_lock);
+		if (cmd)
+			io_uring_cmd_complete_in_task(cmd, ublk_cmd_cancel_cb);
+		goto out;
+	}
+
 	for (i = 0; i < ubq->q_depth; i++) {
 		struct ublk_io *io = &ubq->ios[i];
 
@@ -1205,7 +1319,7 @@ static void ublk_cancel_queue(struct ublk_queue *ubq)
 			io_uring_cmd_complete_in_task(io->cmd,
 						      ublk_cmd_cancel_cb);
 	}
-
+out:
 	/* all io commands are canceled */
 	ubq->nr_io_ready = 0;
 }
@@ -1369,6 +1483,74 @@ static inline void ublk_fill_io_cmd(struct ublk_io *io,
 	io->addr = buf_addr;
 }
 
+static inline struct request *__ublk_check_and_get_req(struct ublk_device *ub,
+		struct ublk_queue *ubq, int tag, size_t offset)
+{
+	struct request *req;
+
+	if (!ublk_need_req_ref(ubq))
+		return NULL;
+
+	req = blk_mq_tag_to_rq(ub->tag_set.tags[ubq->q_id], tag);
+	if (!req)
+		return NULL;
+
+	if (!ublk_get_req_ref(ubq, req))
+		return NULL;
+
+	if (unlikely(!blk_mq_request_started(req) || req->tag != tag))
+		goto fail_put;
+
+	if (!ublk_rq_has_data(req))
+		goto fail_put;
+
+	if (offset > blk_rq_bytes(req))
+		goto fail_put;
+
+	return req;
+fail_put:
+	ublk_put_req_ref(ubq, req);
+	return NULL;
+}
+
+static void ublk_io_buf_release(void *priv)
+{
+	struct request *req = priv;
+
+	ublk_put_req_ref(req->mq_hctx->driver_data, req);
+}
+
+static int ublk_register_io_buf(struct io_uring_cmd *cmd,
+		struct ublk_device *ub, struct ublk_queue *ubq,
+		unsigned int tag, u64 index, unsigned int issue_flags)
+{
+	struct request *req;
+	int ret;
+
+	if (!ublk_support_zero_copy(ubq) || index > UINT_MAX)
+		return -EINVAL;
+
+	/* the reference is dropped when the buffer is released */
+	req = __ublk_check_and_get_req(ub, ubq, tag, 0);
+	if (!req)
+		return -EINVAL;
+
+	ret = io_buffer_register_bvec(cmd, req, ublk_io_buf_release, index,
+			issue_flags);
+	if (ret)
+		ublk_put_req_ref(ubq, req);
+	return ret;
+}
+
+static int ublk_unregister_io_buf(struct io_uring_cmd *cmd,
+		struct ublk_queue *ubq, u64 index, unsigned int issue_flags)
+{
+	if (!ublk_support_zero_copy(ubq) || index > UINT_MAX)
+		return -EINVAL;
+
+	return io_buffer_unregister_bvec(cmd, index, issue_flags);
+}
+
 static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 			       unsigned int issue_flags,
 			       const struct ublksrv_io_cmd *ub_cmd)
@@ -1400,6 +1582,24 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 
 	io = &ubq->ios[tag];
 
+	/* buffer (un)registration completes right away, io is left alone */
+	if (cmd_op == UBLK_U_IO_REGISTER_IO_BUF) {
+		if (!(io->flags & UBLK_IO_FLAG_OWNED_BY_SRV))
+			goto out;
+		ret = ublk_register_io_buf(cmd, ub, ubq, tag, ub_cmd->addr,
+				issue_flags);
+		goto out;
+	}
+	if (cmd_op == UBLK_U_IO_UNREGISTER_IO_BUF) {
+		ret = ublk_unregister_io_buf(cmd, ubq, ub_cmd->addr,
+				issue_flags);
+		goto out;
+	}
+
+	/* io commands are fetched and committed in batches */
+	if (ublk_support_batch_io(ubq))
+		goto out;
+
 	/* there is pending io cmd, something must be wrong */
 	if (io->flags & UBLK_IO_FLAG_ACTIVE) {
 		ret = -EBUSY;
@@ -1414,7 +1614,7 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 			^ (_IOC_NR(cmd_op) == UBLK_IO_NEED_GET_DATA))
 		goto out;
 
-	if (ublk_support_user_copy(ubq) && ub_cmd->addr) {
+	if (!ublk_need_map_io(ubq) && ub_cmd->addr) {
 		ret = -EINVAL;
 		goto out;
 	}
@@ -1438,7 +1638,7 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 		if (io->flags & UBLK_IO_FLAG_OWNED_BY_SRV)
 			goto out;
 
-		if (!ublk_support_user_copy(ubq)) {
+		if (ublk_need_map_io(ubq)) {
 			/*
 			 * FETCH_RQ has to provide IO buffer if NEED GET
 			 * DATA is not enabled
@@ -1456,7 +1656,7 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 		if (!(io->flags & UBLK_IO_FLAG_OWNED_BY_SRV))
 			goto out;
 
-		if (!ublk_support_user_copy(ubq)) {
+		if (ublk_need_map_io(ubq)) {
 			/*
 			 * COMMIT_AND_FETCH_REQ has to provide IO buffer if
 			 * NEED GET DATA is not enabled or it is Read IO.
@@ -1486,34 +1686,117 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 	return -EIOCBQUEUED;
 }
 
-static inline struct request *__ublk_check_and_get_req(struct ublk_device *ub,
-		struct ublk_queue *ubq, int tag, size_t offset)
+static int ublk_batch_fetch(struct io_uring_cmd *cmd, struct ublk_device *ub,
+		struct ublk_queue *ubq, const struct ublk_batch_io *uc)
 {
-	struct request *req;
+	struct ublk_uring_cmd_pdu *pdu = ublk_get_uring_cmd_pdu(cmd);
+	int i, ret = 0;
 
-	if (!ublk_need_req_ref(ubq))
-		return NULL;
+	if (uc->nr_elem < ubq->q_depth || !uc->elem)
+		return -EINVAL;
 
-	req = blk_mq_tag_to_rq(ub->tag_set.tags[ubq->q_id], tag);
-	if (!req)
-		return NULL;
+	/* the first one sets up all ios, they are always fetched from now */
+	if (!ublk_queue_ready(ubq)) {
+		for (i = 0; i < ubq->q_depth; i++) {
+			ubq->ios[i].flags |= UBLK_IO_FLAG_ACTIVE;
+			ublk_mark_io_ready(ub, ubq);
+		}
+	}
 
-	if (!ublk_get_req_ref(ubq, req))
-		return NULL;
+	pdu->ubq = ubq;
+	spin_lock_irq(&ubq->batch_lock);
+	if (ubq->batch_cmd) {
+		ret = -EBUSY;
+	} else {
+		ubq->batch_cmd = cmd;
+		ubq->batch_tags = u64_to_user_ptr(uc->elem);
+	}
+	spin_unlock_irq(&ubq->batch_lock);
 
-	if (unlikely(!blk_mq_request_started(req) || req->tag != tag))
-		goto fail_put;
+	/* requests may have arrived while no command was pending */
+	if (!ret && !llist_empty(&ubq->io_cmds))
+		ublk_batch_kick(ubq);
+	return ret;
+}
 
-	if (!ublk_rq_has_data(req))
-		goto fail_put;
+#define UBLK_BATCH_COMMIT_CHUNK	16
 
-	if (offset > blk_rq_bytes(req))
-		goto fail_put;
+static int ublk_batch_commit(struct ublk_device *ub, struct ublk_queue *ubq,
+		const struct ublk_batch_io *uc)
+{
+	struct ublk_batch_commit_elem __user *uelem = u64_to_user_ptr(uc->elem);
+	struct ublk_batch_commit_elem elem[UBLK_BATCH_COMMIT_CHUNK];
+	unsigned int done = 0, i, nr;
+	int ret = 0;
 
-	return req;
-fail_put:
-	ublk_put_req_ref(ubq, req);
-	return NULL;
+	while (done < uc->nr_elem) {
+		nr = min_t(unsigned int, uc->nr_elem - done,
+				UBLK_BATCH_COMMIT_CHUNK);
+		if (copy_from_user(elem, &uelem[done], nr * sizeof(elem[0]))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		for (i = 0; i < nr; i++, done++) {
+			struct ublksrv_io_cmd ub_cmd = {
+				.q_id = ubq->q_id,
+				.tag = elem[i].tag,
+				.result = elem[i].result,
+			};
+			struct ublk_io *io;
+
+			if (elem[i].tag >= ubq->q_depth) {
+				ret = -EINVAL;
+				goto out;
+			}
+			io = &ubq->ios[elem[i].tag];
+			if (!(io->flags & UBLK_IO_FLAG_OWNED_BY_SRV)) {
+				ret = -EINVAL;
+				goto out;
+			}
+
+			/* fetched again through FETCH_IO_CMDS */
+			io->flags |= UBLK_IO_FLAG_ACTIVE;
+			ublk_commit_completion(ub, &ub_cmd);
+		}
+	}
+out:
+	return done ? done : ret;
+}
+
+static int ublk_ch_batch_io_cmd(struct io_uring_cmd *cmd,
+		unsigned int issue_flags)
+{
+	const struct ublk_batch_io *ub_src = io_uring_sqe_cmd(cmd->sqe);
+	const struct ublk_batch_io uc = {
+		.q_id = READ_ONCE(ub_src->q_id),
+		.nr_elem = READ_ONCE(ub_src->nr_elem),
+		.elem = READ_ONCE(ub_src->elem),
+	};
+	struct ublk_device *ub = cmd->file->private_data;
+	struct ublk_queue *ubq;
+	int ret = -EINVAL;
+
+	if (uc.q_id >= ub->dev_info.nr_hw_queues)
+		goto out;
+
+	ubq = ublk_get_queue(ub, uc.q_id);
+	if (!ublk_support_batch_io(ubq))
+		goto out;
+
+	if (ubq->ubq_daemon && ubq->ubq_daemon != current)
+		goto out;
+
+	if (cmd->cmd_op == UBLK_U_IO_FETCH_IO_CMDS) {
+		ret = ublk_batch_fetch(cmd, ub, ubq, &uc);
+		if (!ret)
+			return -EIOCBQUEUED;
+	} else {
+		ret = ublk_batch_commit(ub, ubq, &uc);
+	}
+ out:
+	io_uring_cmd_done(cmd, ret, 0, issue_flags);
+	return -EIOCBQUEUED;
 }
 
 static int ublk_ch_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
@@ -1530,6 +1813,10 @@ static int ublk_ch_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
 		.addr = READ_ONCE(ub_src->addr)
 	};
 
+	if (cmd->cmd_op == UBLK_U_IO_FETCH_IO_CMDS ||
+	    cmd->cmd_op == UBLK_U_IO_COMMIT_IO_CMDS)
+		return ublk_ch_batch_io_cmd(cmd, issue_flags);
+
 	return __ublk_ch_uring_cmd(cmd, issue_flags, &ub_cmd);
 }
 
@@ -1672,6 +1959,7 @@ static int ublk_init_queue(struct ublk_device *ub, int q_id)
 
 	ubq->io_cmd_buf = ptr;
 	ubq->dev = ub;
+	spin_lock_init(&ubq->batch_lock);
 	return 0;
 }
 
@@ -2036,12 +2324,25 @@ static int ublk_ctrl_add_dev(struct io_uring_cmd *cmd)
 	ub->dev_info.flags |= UBLK_F_CMD_IOCTL_ENCODE |
 		UBLK_F_URING_CMD_COMP_IN_TASK;
 
-	/* GET_DATA isn't needed any more with USER_COPY */
-	if (ub->dev_info.flags & UBLK_F_USER_COPY)
+	/*
+	 * Zero copy hands the request pages to the server's io_uring, don't
+	 * allow it for unprivileged devices
+	 */
+	if (ub->dev_info.flags & UBLK_F_UNPRIVILEGED_DEV)
+		ub->dev_info.flags &= ~UBLK_F_SUPPORT_ZERO_COPY;
+
+	/* GET_DATA isn't needed any more with USER_COPY or ZERO_COPY */
+	if (ub->dev_info.flags & (UBLK_F_USER_COPY | UBLK_F_SUPPORT_ZERO_COPY))
 		ub->dev_info.flags &= ~UBLK_F_NEED_GET_DATA;
 
-	/* We are not ready to support zero copy */
-	ub->dev_info.flags &= ~UBLK_F_SUPPORT_ZERO_COPY;
+	/*
+	 * Batched io commands don't carry io buffers, and aren't ready for
+	 * recovery yet
+	 */
+	if (!(ub->dev_info.flags & (UBLK_F_USER_COPY |
+				    UBLK_F_SUPPORT_ZERO_COPY)) ||
+	    (ub->dev_info.flags & UBLK_F_USER_RECOVERY))
+		ub->dev_info.flags &= ~UBLK_F_BATCH_IO;
 
 	ub->dev_info.nr_hw_queues = min_t(unsigned int,
 			ub->dev_info.nr_hw_queues, nr_cpu_ids);
@@ -2354,7 +2655,7 @@ static int ublk_ctrl_get_features(struct io_uring_cmd *cmd)
 {
 	const struct ublksrv_ctrl_cmd *header = io_uring_sqe_cmd(cmd->sqe);
 	void __user *argp = (void __user *)(unsigned long)header->addr;
-	u64 features = UBLK_F_ALL & ~UBLK_F_SUPPORT_ZERO_COPY;
+	u64 features = UBLK_F_ALL;
 
 	if (header->len != UBLK_FEATURES_LEN || !header->addr)
 		return -EINVAL;
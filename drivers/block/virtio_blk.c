@@ -20,7 +20,10 @@
 
 #define PART_BITS 4
 #define VQ_NAME_LEN 16
+
 #define MAX_DISCARD_SEGMENTS 256u
+/* Completions collected per virtqueue_get_bufs() call in virtblk_done() */
+#define VIRTBLK_DONE_BATCH 16
 
 /* The maximum number of sg elements that fit into a virtqueue */
 #define VIRTIO_BLK_MAX_SG_ELEMS 32768
@@ -351,20 +354,23 @@ static inline void virtblk_request_done(struct request *req)
 static void virtblk_done(struct virtqueue *vq)
 {
 	struct virtio_blk *vblk = vq->vdev->priv;
+	void *vbrs[VIRTBLK_DONE_BATCH];
 	bool req_done = false;
 	int qid = vq->index;
-	struct virtblk_req *vbr;
+	unsigned int i, n;
 	unsigned long flags;
-	unsigned int len;
 
 	spin_lock_irqsave(&vblk->vqs[qid].lock, flags);
 	do {
 		virtqueue_disable_cb(vq);
-		while ((vbr = virtqueue_get_buf(vblk->vqs[qid].vq, &len)) != NULL) {
-			struct request *req = blk_mq_rq_from_pdu(vbr);
-
-			if (likely(!blk_should_fake_timeout(req->q)))
-				blk_mq_complete_request(req);
+		while ((n = virtqueue_get_bufs(vblk->vqs[qid].vq, vbrs, NULL,
+					       VIRTBLK_DONE_BATCH))) {
+			for (i = 0; i < n; i++) {
+				struct request *req = blk_mq_rq_from_pdu(vbrs[i]);
+
+				if (likely(!blk_should_fake_timeout(req->q)))
+					blk_mq_complete_request(req);
+			}
 			req_done = true;
 		}
 		if (unlikely(virtqueue_is_broken(vq)))
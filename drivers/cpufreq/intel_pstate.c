@@ -220,6 +220,9 @@ struct global_params {
  * @last_io_update:	Last time when IO wake flag was set
  * @sched_flags:	Store scheduler flags for possible cross CPU update
  * @hwp_boost_min:	Last HWP boosted min performance
+ * @hwp_uclamp_min:	Last HWP min performance derived from uclamp
+ * @hwp_uclamp_max:	Last HWP max performance derived from uclamp
+ * @hwp_uclamp_time:	Last time the HWP request was updated for uclamp
  * @suspended:		Whether or not the driver has been suspended.
  * @hwp_notify_work:	workqueue for HWP notifications.
  *
@@ -259,6 +262,9 @@ struct cpudata {
 	u64 last_io_update;
 	unsigned int sched_flags;
 	u32 hwp_boost_min;
+	u32 hwp_uclamp_min;
+	u32 hwp_uclamp_max;
+	u64 hwp_uclamp_time;
 	bool suspended;
 	struct delayed_work hwp_notify_work;
 };
@@ -298,6 +304,7 @@ static int hwp_active __read_mostly;
 static int hwp_mode_bdw __read_mostly;
 static bool per_cpu_limits __read_mostly;
 static bool hwp_boost __read_mostly;
+static bool hwp_uclamp __read_mostly;
 static bool hwp_forced __read_mostly;
 
 static struct cpufreq_driver *intel_pstate_driver __read_mostly;
@@ -1453,6 +1460,30 @@ static ssize_t store_hwp_dynamic_boost(struct kobject *a,
 	return count;
 }
 
+static ssize_t show_hwp_uclamp(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", hwp_uclamp);
+}
+
+static ssize_t store_hwp_uclamp(struct kobject *a, struct kobj_attribute *b,
+				const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &input);
+	if (ret)
+		return ret;
+
+	mutex_lock(&intel_pstate_driver_lock);
+	hwp_uclamp = !!input;
+	intel_pstate_update_policies();
+	mutex_unlock(&intel_pstate_driver_lock);
+
+	return count;
+}
+
 static ssize_t show_energy_efficiency(struct kobject *kobj, struct kobj_attribute *attr,
 				      char *buf)
 {
@@ -1489,6 +1520,7 @@ define_one_global_rw(min_perf_pct);
 define_one_global_ro(turbo_pct);
 define_one_global_ro(num_pstates);
 define_one_global_rw(hwp_dynamic_boost);
+define_one_global_rw(hwp_uclamp);
 define_one_global_rw(energy_efficiency);
 
 static struct attribute *intel_pstate_attributes[] = {
@@ -1580,6 +1612,9 @@ static void intel_pstate_sysfs_expose_hwp_dynamic_boost(void)
 
 	rc = sysfs_create_file(intel_pstate_kobject, &hwp_dynamic_boost.attr);
 	WARN_ON_ONCE(rc);
+
+	rc = sysfs_create_file(intel_pstate_kobject, &hwp_uclamp.attr);
+	WARN_ON_ONCE(rc);
 }
 
 static void intel_pstate_sysfs_hide_hwp_dynamic_boost(void)
@@ -1588,6 +1623,7 @@ static void intel_pstate_sysfs_hide_hwp_dynamic_boost(void)
 		return;
 
 	sysfs_remove_file(intel_pstate_kobject, &hwp_dynamic_boost.attr);
+	sysfs_remove_file(intel_pstate_kobject, &hwp_uclamp.attr);
 }
 
 /************************** sysfs end ************************/
@@ -2126,11 +2162,56 @@ static inline void intel_pstate_hwp_boost_down(struct cpudata *cpu)
 	cpu->last_update = cpu->sample.time;
 }
 
+/*
+ * Minimum time between two HWP request updates driven by uclamp, unless the
+ * minimum performance has to go up. This bounds the number of MSR writes
+ * when tasks with different clamps alternate on a CPU.
+ */
+static int hwp_uclamp_rate_limit_ns = NSEC_PER_MSEC;
+
+static inline void intel_pstate_hwp_uclamp(struct cpudata *cpu, u64 time)
+{
+	u64 hwp_req = READ_ONCE(cpu->hwp_req_cached);
+	u32 max_limit = (hwp_req & 0xff00) >> 8;
+	u32 min_limit = (hwp_req & 0xff);
+	unsigned long umin, umax;
+	u32 min_perf, max_perf;
+
+	if (!cpufreq_cpu_uclamp(cpu->cpu, &umin, &umax))
+		return;
+
+	/* Scale the clamps to the range allowed by the policy limits */
+	min_perf = DIV_ROUND_UP(umin * max_limit, SCHED_CAPACITY_SCALE);
+	min_perf = max(min_perf, min_limit);
+	max_perf = umax * max_limit / SCHED_CAPACITY_SCALE;
+	max_perf = max(max_perf, min_perf);
+
+	if (min_perf == cpu->hwp_uclamp_min && max_perf == cpu->hwp_uclamp_max)
+		return;
+
+	if (min_perf <= cpu->hwp_uclamp_min &&
+	    time_before64(time, cpu->hwp_uclamp_time + hwp_uclamp_rate_limit_ns))
+		return;
+
+	hwp_req &= ~GENMASK_ULL(15, 0);
+	hwp_req |= HWP_MAX_PERF(max_perf) | HWP_MIN_PERF(min_perf);
+	wrmsrl(MSR_HWP_REQUEST, hwp_req);
+
+	cpu->hwp_uclamp_min = min_perf;
+	cpu->hwp_uclamp_max = max_perf;
+	cpu->hwp_uclamp_time = time;
+}
+
 static inline void intel_pstate_update_util_hwp_local(struct cpudata *cpu,
 						      u64 time)
 {
 	cpu->sample.time = time;
 
+	if (READ_ONCE(hwp_uclamp)) {
+		intel_pstate_hwp_uclamp(cpu, time);
+		return;
+	}
+
 	if (cpu->sched_flags & SCHED_CPUFREQ_IOWAIT) {
 		bool do_io = false;
 
@@ -2474,7 +2555,7 @@ static void intel_pstate_set_update_util_hook(unsigned int cpu_num)
 {
 	struct cpudata *cpu = all_cpu_data[cpu_num];
 
-	if (hwp_active && !hwp_boost)
+	if (hwp_active && !hwp_boost && !hwp_uclamp)
 		return;
 
 	if (cpu->update_util_set)
@@ -2605,8 +2686,11 @@ static int intel_pstate_set_policy(struct cpufreq_policy *policy)
 		 * was turned off, in that case we need to clear the
 		 * update util hook.
 		 */
-		if (!hwp_boost)
+		if (!hwp_boost && !hwp_uclamp)
 			intel_pstate_clear_update_util_hook(policy->cpu);
+		/* The request is rewritten from the policy limits */
+		cpu->hwp_uclamp_min = 0;
+		cpu->hwp_uclamp_max = 0;
 		intel_pstate_hwp_set(policy->cpu);
 	}
 
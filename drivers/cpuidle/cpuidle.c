@@ -40,6 +40,19 @@ static int enabled_devices;
 static int off __read_mostly;
 static int initialized __read_mostly;
 
+/*
+ * Adaptive polling: poll before entering a real idle state for a window that
+ * is learned per CPU, which pays off when wakeups come in at a faster rate
+ * than the governor heuristics expect. Like halt polling in KVM, the window
+ * grows when the CPU is woken up shortly after it stopped polling and shrinks
+ * when it stays idle for longer than adaptive_poll_max_ns.
+ */
+static bool adaptive_poll __read_mostly;
+static unsigned int adaptive_poll_max_ns __read_mostly = 200000;
+static unsigned int adaptive_poll_grow __read_mostly = 2;
+static unsigned int adaptive_poll_grow_start __read_mostly = 10000;
+static unsigned int adaptive_poll_shrink __read_mostly = 2;
+
 int cpuidle_disabled(void)
 {
 	return off;
@@ -340,6 +353,51 @@ noinstr int cpuidle_enter_state(struct cpuidle_device *dev,
 	return entered_state;
 }
 
+static bool cpuidle_adaptive_poll(struct cpuidle_driver *drv,
+				  struct cpuidle_device *dev)
+{
+	return READ_ONCE(adaptive_poll) && drv->state_count > 1 &&
+	       drv->states[0].flags & CPUIDLE_FLAG_POLLING &&
+	       !dev->states_usage[0].disable;
+}
+
+static void adaptive_poll_adjust(struct cpuidle_device *dev, u64 block_ns)
+{
+	u64 val = dev->adaptive_poll_ns;
+
+	if (block_ns > val && block_ns <= adaptive_poll_max_ns) {
+		/* Woken up soon after the window timed out, grow it */
+		val *= adaptive_poll_grow;
+		if (val < adaptive_poll_grow_start)
+			val = adaptive_poll_grow_start;
+		if (val > adaptive_poll_max_ns)
+			val = adaptive_poll_max_ns;
+	} else if (block_ns > adaptive_poll_max_ns) {
+		/* Long idle period, polling was wasted */
+		val = adaptive_poll_shrink ? val / adaptive_poll_shrink : 0;
+	}
+
+	dev->adaptive_poll_ns = val;
+}
+
+static void adaptive_poll_reflect(struct cpuidle_device *dev, int index)
+{
+	u64 block_ns = dev->poll_block_ns + dev->last_residency_ns;
+
+	if (index == 0 && dev->poll_time_limit) {
+		/* The next idle period continues this one in a deeper state */
+		dev->poll_fail++;
+		dev->poll_block_ns = block_ns;
+		return;
+	}
+
+	if (index == 0)
+		dev->poll_success++;
+
+	dev->poll_block_ns = 0;
+	adaptive_poll_adjust(dev, block_ns);
+}
+
 /**
  * cpuidle_select - ask the cpuidle framework to choose an idle state
  *
@@ -356,6 +414,13 @@ noinstr int cpuidle_enter_state(struct cpuidle_device *dev,
 int cpuidle_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 		   bool *stop_tick)
 {
+	/* Poll first, unless the poll window has just timed out */
+	if (cpuidle_adaptive_poll(drv, dev) && dev->adaptive_poll_ns &&
+	    !dev->poll_block_ns) {
+		*stop_tick = false;
+		return 0;
+	}
+
 	return cpuidle_curr_governor->select(drv, dev, stop_tick);
 }
 
@@ -401,6 +466,9 @@ int cpuidle_enter(struct cpuidle_driver *drv, struct cpuidle_device *dev,
  */
 void cpuidle_reflect(struct cpuidle_device *dev, int index)
 {
+	if (READ_ONCE(adaptive_poll) && index >= 0)
+		adaptive_poll_reflect(dev, index);
+
 	if (cpuidle_curr_governor->reflect && index >= 0)
 		cpuidle_curr_governor->reflect(dev, index);
 }
@@ -434,6 +502,9 @@ __cpuidle u64 cpuidle_poll_time(struct cpuidle_driver *drv,
 
 	BUILD_BUG_ON(CPUIDLE_POLL_MIN > CPUIDLE_POLL_MAX);
 
+	if (READ_ONCE(adaptive_poll) && dev->adaptive_poll_ns)
+		return dev->adaptive_poll_ns;
+
 	if (dev->poll_limit_ns)
 		return dev->poll_limit_ns;
 
@@ -622,6 +693,10 @@ static void __cpuidle_device_init(struct cpuidle_device *dev)
 	memset(dev->states_usage, 0, sizeof(dev->states_usage));
 	dev->last_residency_ns = 0;
 	dev->next_hrtimer = 0;
+	dev->adaptive_poll_ns = 0;
+	dev->poll_block_ns = 0;
+	dev->poll_success = 0;
+	dev->poll_fail = 0;
 }
 
 /**
@@ -813,4 +888,9 @@ static int __init cpuidle_init(void)
 
 module_param(off, int, 0444);
 module_param_string(governor, param_governor, CPUIDLE_NAME_LEN, 0444);
+module_param(adaptive_poll, bool, 0644);
+module_param(adaptive_poll_max_ns, uint, 0644);
+module_param(adaptive_poll_grow, uint, 0644);
+module_param(adaptive_poll_grow_start, uint, 0644);
+module_param(adaptive_poll_shrink, uint, 0644);
 core_initcall(cpuidle_init);
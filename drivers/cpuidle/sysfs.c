@@ -207,8 +207,34 @@ static void cpuidle_sysfs_release(struct kobject *kobj)
 	complete(&kdev->kobj_unregister);
 }
 
+#define define_one_device_ro(_name, show) \
+static struct cpuidle_attr attr_##_name = __ATTR(_name, 0444, show, NULL)
+
+#define define_show_device_ull_function(_name) \
+static ssize_t show_##_name(struct cpuidle_device *dev, char *buf) \
+{ \
+	return sprintf(buf, "%llu\n", (unsigned long long)dev->_name); \
+}
+
+define_show_device_ull_function(adaptive_poll_ns)
+define_show_device_ull_function(poll_success)
+define_show_device_ull_function(poll_fail)
+
+define_one_device_ro(adaptive_poll_ns, show_adaptive_poll_ns);
+define_one_device_ro(poll_success, show_poll_success);
+define_one_device_ro(poll_fail, show_poll_fail);
+
+static struct attribute *cpuidle_default_attrs[] = {
+	&attr_adaptive_poll_ns.attr,
+	&attr_poll_success.attr,
+	&attr_poll_fail.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(cpuidle_default);
+
 static const struct kobj_type ktype_cpuidle = {
 	.sysfs_ops = &cpuidle_sysfs_ops,
+	.default_groups = cpuidle_default_groups,
 	.release = cpuidle_sysfs_release,
 };
 
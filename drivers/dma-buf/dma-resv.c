@@ -373,26 +373,34 @@ static void dma_resv_iter_walk_unlocked(struct dma_resv_iter *cursor)
 		return;
 
 	do {
+		struct dma_fence *fence;
+
 		/* Drop the reference from the previous round */
 		dma_fence_put(cursor->fence);
+		cursor->fence = NULL;
 
-		if (cursor->index >= cursor->num_fences) {
-			cursor->fence = NULL;
+		if (cursor->index >= cursor->num_fences)
 			break;
 
-		}
-
 		dma_resv_list_entry(cursor->fences, cursor->index++,
-				    cursor->obj, &cursor->fence,
-				    &cursor->fence_usage);
-		cursor->fence = dma_fence_get_rcu(cursor->fence);
+				    cursor->obj, &fence, &cursor->fence_usage);
+
+		/*
+		 * The fence memory is RCU protected, so fences the caller isn't
+		 * interested in or which are known to be signaled can be
+		 * skipped without bouncing their refcount.
+		 */
+		if (cursor->usage < cursor->fence_usage ||
+		    test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags))
+			continue;
+
+		cursor->fence = dma_fence_get_rcu(fence);
 		if (!cursor->fence) {
 			dma_resv_iter_restart_unlocked(cursor);
 			continue;
 		}
 
-		if (!dma_fence_is_signaled(cursor->fence) &&
-		    cursor->usage >= cursor->fence_usage)
+		if (!dma_fence_is_signaled(cursor->fence))
 			break;
 	} while (true);
 }
@@ -156,7 +156,8 @@ int amdgpu_sync_fence(struct amdgpu_sync *sync, struct dma_fence *f)
 {
 	struct amdgpu_sync_entry *e;
 
-	if (!f)
+	/* All users skip signaled fences, don't bother remembering them */
+	if (!f || dma_fence_is_signaled(f))
 		return 0;
 
 	if (amdgpu_sync_add_later(sync, f))
@@ -538,6 +538,39 @@ int drm_gem_shmem_dumb_create(struct drm_file *file, struct drm_device *dev,
 }
 EXPORT_SYMBOL_GPL(drm_gem_shmem_dumb_create);
 
+/*
+ * The pages of a large folio are likely to be accessed together, so map the
+ * rest of the folio of a faulting page right away instead of taking a fault
+ * for each of them. Failures are ignored, the page simply faults later.
+ */
+static void drm_gem_shmem_map_folio(struct vm_fault *vmf,
+				    struct drm_gem_shmem_object *shmem,
+				    pgoff_t page_offset)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct page *page = shmem->pages[page_offset];
+	struct folio *folio = page_folio(page);
+	pgoff_t first, end, i;
+
+	if (!folio_test_large(folio))
+		return;
+
+	first = page_offset - folio_page_idx(folio, page);
+	end = min3(first + folio_nr_pages(folio),
+		   (pgoff_t)(shmem->base.size >> PAGE_SHIFT),
+		   (pgoff_t)vma_pages(vma));
+
+	for (i = first; i < end; i++) {
+		if (i == page_offset)
+			continue;
+
+		if (vmf_insert_pfn(vma, vma->vm_start + (i << PAGE_SHIFT),
+				   page_to_pfn(shmem->pages[i])) &
+		    VM_FAULT_ERROR)
+			break;
+	}
+}
+
 static vm_fault_t drm_gem_shmem_fault(struct vm_fault *vmf)
 {
 	struct vm_area_struct *vma = vmf->vma;
@@ -561,6 +594,8 @@ static vm_fault_t drm_gem_shmem_fault(struct vm_fault *vmf)
 		page = shmem->pages[page_offset];
 
 		ret = vmf_insert_pfn(vma, vmf->address, page_to_pfn(page));
+		if (ret == VM_FAULT_NOPAGE)
+			drm_gem_shmem_map_folio(vmf, shmem, page_offset);
 	}
 
 	mutex_unlock(&shmem->pages_lock);
@@ -495,6 +495,131 @@ static u64 rb_to_hole_size_or_zero(struct rb_node *rb)
 	return rb ? rb_to_hole_size(rb) : 0;
 }
 
+/*
+ * Check whether @size bytes aligned to @alignment fit into @hole within the
+ * allowed range, returning the start of the allocation in @start.
+ */
+static bool hole_fits(struct drm_mm *mm, struct drm_mm_node *hole,
+		      u64 size, u64 alignment, u64 remainder_mask,
+		      unsigned long color, u64 range_start, u64 range_end,
+		      enum drm_mm_insert_mode mode, u64 *start)
+{
+	u64 hole_start = __drm_mm_hole_node_start(hole);
+	u64 hole_end = hole_start + hole->hole_size;
+	u64 adj_start, adj_end;
+	u64 col_start, col_end;
+
+	col_start = hole_start;
+	col_end = hole_end;
+	if (mm->color_adjust)
+		mm->color_adjust(hole, color, &col_start, &col_end);
+
+	adj_start = max(col_start, range_start);
+	adj_end = min(col_end, range_end);
+
+	if (adj_end <= adj_start || adj_end - adj_start < size)
+		return false;
+
+	if (mode == DRM_MM_INSERT_HIGH)
+		adj_start = adj_end - size;
+
+	if (alignment) {
+		u64 rem;
+
+		if (likely(remainder_mask))
+			rem = adj_start & remainder_mask;
+		else
+			div64_u64_rem(adj_start, alignment, &rem);
+		if (rem) {
+			adj_start -= rem;
+			if (mode != DRM_MM_INSERT_HIGH)
+				adj_start += alignment;
+
+			if (adj_start < max(col_start, range_start) ||
+			    min(col_end, range_end) - adj_start < size)
+				return false;
+
+			if (adj_end <= adj_start ||
+			    adj_end - adj_start < size)
+				return false;
+		}
+	}
+
+	*start = adj_start;
+	return true;
+}
+
+/*
+ * Best fit within a range that doesn't cover the whole allocator. Walking the
+ * size tree would visit every big enough hole, including all the ones outside
+ * of the range, so walk the holes of the range in address order instead,
+ * pruned by the subtree_max_hole of the address tree.
+ */
+static struct drm_mm_node *
+best_hole_in_range(struct drm_mm *mm, u64 size, u64 alignment,
+		   u64 remainder_mask, unsigned long color,
+		   u64 range_start, u64 range_end, u64 *start)
+{
+	struct drm_mm_node *hole, *best = NULL;
+	u64 adj_start;
+
+	for (hole = find_hole_addr(mm, range_start, size);
+	     hole;
+	     hole = next_hole_low_addr(hole, size)) {
+		if (__drm_mm_hole_node_start(hole) >= range_end)
+			break;
+
+		if (best && hole->hole_size >= best->hole_size)
+			continue;
+
+		if (!hole_fits(mm, hole, size, alignment, remainder_mask, color,
+			       range_start, range_end, DRM_MM_INSERT_BEST,
+			       &adj_start))
+			continue;
+
+		best = hole;
+		*start = adj_start;
+		if (hole->hole_size == size)
+			break;
+	}
+
+	return best;
+}
+
+static bool drm_mm_range_restricted(const struct drm_mm *mm,
+				    u64 range_start, u64 range_end)
+{
+	/* the head node hole spans the allocator when it is empty */
+	return range_start > mm->head_node.start + mm->head_node.size ||
+	       range_end < mm->head_node.start;
+}
+
+static void drm_mm_insert_hole(struct drm_mm *mm, struct drm_mm_node *hole,
+			       struct drm_mm_node *node, u64 start, u64 size,
+			       unsigned long color)
+{
+	u64 hole_start = __drm_mm_hole_node_start(hole);
+	u64 hole_end = hole_start + hole->hole_size;
+
+	node->mm = mm;
+	node->size = size;
+	node->start = start;
+	node->color = color;
+	node->hole_size = 0;
+
+	__set_bit(DRM_MM_NODE_ALLOCATED_BIT, &node->flags);
+	list_add(&node->node_list, &hole->node_list);
+	drm_mm_interval_tree_add_node(hole, node);
+
+	rm_hole(hole);
+	if (start > hole_start)
+		add_hole(hole);
+	if (start + size < hole_end)
+		add_hole(node);
+
+	save_stack(node);
+}
+
 /**
  * drm_mm_insert_node_in_range - ranged search for space and insert @node
  * @mm: drm_mm to allocate from
@@ -520,6 +645,7 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 {
 	struct drm_mm_node *hole;
 	u64 remainder_mask;
+	u64 adj_start;
 	bool once;
 
 	DRM_MM_BUG_ON(range_start > range_end);
@@ -537,13 +663,24 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 	mode &= ~DRM_MM_INSERT_ONCE;
 
 	remainder_mask = is_power_of_2(alignment) ? alignment - 1 : 0;
+
+	if (mode == DRM_MM_INSERT_BEST && !once &&
+	    drm_mm_range_restricted(mm, range_start, range_end)) {
+		hole = best_hole_in_range(mm, size, alignment, remainder_mask,
+					  color, range_start, range_end,
+					  &adj_start);
+		if (!hole)
+			return -ENOSPC;
+
+		drm_mm_insert_hole(mm, hole, node, adj_start, size, color);
+		return 0;
+	}
+
 	for (hole = first_hole(mm, range_start, range_end, size, mode);
 	     hole;
 	     hole = once ? NULL : next_hole(mm, hole, size, mode)) {
 		u64 hole_start = __drm_mm_hole_node_start(hole);
 		u64 hole_end = hole_start + hole->hole_size;
-		u64 adj_start, adj_end;
-		u64 col_start, col_end;
 
 		if (mode == DRM_MM_INSERT_LOW && hole_start >= range_end)
 			break;
@@ -551,59 +688,11 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 		if (mode == DRM_MM_INSERT_HIGH && hole_end <= range_start)
 			break;
 
-		col_start = hole_start;
-		col_end = hole_end;
-		if (mm->color_adjust)
-			mm->color_adjust(hole, color, &col_start, &col_end);
-
-		adj_start = max(col_start, range_start);
-		adj_end = min(col_end, range_end);
-
-		if (adj_end <= adj_start || adj_end - adj_start < size)
+		if (!hole_fits(mm, hole, size, alignment, remainder_mask, color,
+			       range_start, range_end, mode, &adj_start))
 			continue;
 
-		if (mode == DRM_MM_INSERT_HIGH)
-			adj_start = adj_end - size;
-
-		if (alignment) {
-			u64 rem;
-
-			if (likely(remainder_mask))
-				rem = adj_start & remainder_mask;
-			else
-				div64_u64_rem(adj_start, alignment, &rem);
-			if (rem) {
-				adj_start -= rem;
-				if (mode != DRM_MM_INSERT_HIGH)
-					adj_start += alignment;
-
-				if (adj_start < max(col_start, range_start) ||
-				    min(col_end, range_end) - adj_start < size)
-					continue;
-
-				if (adj_end <= adj_start ||
-				    adj_end - adj_start < size)
-					continue;
-			}
-		}
-
-		node->mm = mm;
-		node->size = size;
-		node->start = adj_start;
-		node->color = color;
-		node->hole_size = 0;
-
-		__set_bit(DRM_MM_NODE_ALLOCATED_BIT, &node->flags);
-		list_add(&node->node_list, &hole->node_list);
-		drm_mm_interval_tree_add_node(hole, node);
-
-		rm_hole(hole);
-		if (adj_start > hole_start)
-			add_hole(hole);
-		if (adj_start + size < hole_end)
-			add_hole(node);
-
-		save_stack(node);
+		drm_mm_insert_hole(mm, hole, node, adj_start, size, color);
 		return 0;
 	}
 
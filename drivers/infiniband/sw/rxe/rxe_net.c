@@ -429,12 +429,13 @@ int rxe_xmit_packet(struct rxe_qp *qp, struct rxe_pkt_info *pkt,
 	}
 	spin_unlock_irqrestore(&qp->state_lock, flags);
 
-	rxe_icrc_generate(skb, pkt);
-
-	if (pkt->mask & RXE_LOOPBACK_MASK)
+	/* loopback packets never leave memory, don't bother with the ICRC */
+	if (pkt->mask & RXE_LOOPBACK_MASK) {
 		err = rxe_loopback(skb, pkt);
-	else
+	} else {
+		rxe_icrc_generate(skb, pkt);
 		err = rxe_send(skb, pkt);
+	}
 	if (err) {
 		rxe_counter_inc(rxe, RXE_CNT_SEND_ERR);
 		return err;
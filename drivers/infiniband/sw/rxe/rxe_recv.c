@@ -337,9 +337,11 @@ void rxe_rcv(struct sk_buff *skb)
 	if (unlikely(err))
 		goto drop;
 
-	err = rxe_icrc_check(skb, pkt);
-	if (unlikely(err))
-		goto drop;
+	if (!(pkt->mask & RXE_LOOPBACK_MASK)) {
+		err = rxe_icrc_check(skb, pkt);
+		if (unlikely(err))
+			goto drop;
+	}
 
 	rxe_counter_inc(rxe, RXE_CNT_RCVD_PKTS);
 
@@ -674,7 +674,7 @@ void ipoib_cm_handle_rx_wc(struct net_device *dev, struct ib_wc *wc)
 	skb->dev = dev;
 	/* XXX get correct PACKET_ type here */
 	skb->pkt_type = PACKET_HOST;
-	netif_receive_skb(skb);
+	napi_gro_receive(&priv->recv_napi, skb);
 
 repost:
 	if (has_srq) {
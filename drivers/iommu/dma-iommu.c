@@ -86,9 +86,29 @@ early_param("iommu.forcedac", iommu_dma_forcedac_setup);
 /* Number of entries per flush queue */
 #define IOVA_FQ_SIZE	256
 
-/* Timeout (in ms) after which entries are flushed from the queue */
+/* Default timeout (in ms) after which entries are flushed from the queue */
 #define IOVA_FQ_TIMEOUT	10
 
+/*
+ * Upper bound on how long an unmapped IOVA stays reachable through a stale
+ * IOTLB entry in lazy mode, which trades off against how many unmaps each
+ * invalidation covers.
+ */
+static unsigned int iommu_dma_fq_timeout __read_mostly = IOVA_FQ_TIMEOUT;
+
+static int __init iommu_dma_fq_timeout_setup(char *str)
+{
+	unsigned int timeout;
+	int ret = kstrtouint(str, 0, &timeout);
+
+	if (ret)
+		return ret;
+	iommu_dma_fq_timeout = max(timeout, 1U);
+	pr_info("Flush queue timeout %ums\n", iommu_dma_fq_timeout);
+	return 0;
+}
+early_param("iommu.fq_timeout", iommu_dma_fq_timeout_setup);
+
 /* Flush queue entry for deferred flushing */
 struct iova_fq_entry {
 	unsigned long iova_pfn;
@@ -216,7 +236,7 @@ static void queue_iova(struct iommu_dma_cookie *cookie,
 	if (!atomic_read(&cookie->fq_timer_on) &&
 	    !atomic_xchg(&cookie->fq_timer_on, 1))
 		mod_timer(&cookie->fq_timer,
-			  jiffies + msecs_to_jiffies(IOVA_FQ_TIMEOUT));
+			  jiffies + msecs_to_jiffies(iommu_dma_fq_timeout));
 }
 
 static void iommu_dma_free_fq(struct iommu_dma_cookie *cookie)
@@ -5076,6 +5076,13 @@ static void bond_set_slave_arr(struct bonding *bond,
 	kfree_rcu(all, rcu);
 }
 
+static bool bond_slave_arr_equal(const struct bond_up_slave *old,
+				 const struct bond_up_slave *new)
+{
+	return old && old->count == new->count &&
+	       !memcmp(old->arr, new->arr, new->count * sizeof(new->arr[0]));
+}
+
 static void bond_reset_slave_arr(struct bonding *bond)
 {
 	struct bond_up_slave *usable, *all;
@@ -5156,6 +5163,18 @@ int bond_update_slave_arr(struct bonding *bond, struct slave *skipslave)
 		usable_slaves->arr[usable_slaves->count++] = slave;
 	}
 
+	/* Link events often don't change the result, spare the datapath the
+	 * switch to a new copy and the RCU grace period then.
+	 */
+	if (bond_slave_arr_equal(rtnl_dereference(bond->usable_slaves),
+				 usable_slaves) &&
+	    bond_slave_arr_equal(rtnl_dereference(bond->all_slaves),
+				 all_slaves)) {
+		kfree(usable_slaves);
+		kfree(all_slaves);
+		return ret;
+	}
+
 	bond_set_slave_arr(bond, usable_slaves, all_slaves);
 	return ret;
 out:
@@ -5546,29 +5565,46 @@ bond_xdp_get_xmit_slave(struct net_device *bond_dev, struct xdp_buff *xdp)
 static int bond_xdp_xmit(struct net_device *bond_dev,
 			 int n, struct xdp_frame **frames, u32 flags)
 {
-	int nxmit, err = -ENXIO;
+	struct net_device *run_dev = NULL;
+	int nxmit = 0, start = 0, i, err = 0;
 
 	rcu_read_lock();
 
-	for (nxmit = 0; nxmit < n; nxmit++) {
-		struct xdp_frame *frame = frames[nxmit];
-		struct xdp_frame *frames1[] = {frame};
+	/* Hand runs of consecutive frames for the same slave over at once */
+	for (i = 0; i < n; i++) {
 		struct net_device *slave_dev;
 		struct xdp_buff xdp;
 
-		xdp_convert_frame_to_buff(frame, &xdp);
+		xdp_convert_frame_to_buff(frames[i], &xdp);
 
 		slave_dev = bond_xdp_get_xmit_slave(bond_dev, &xdp);
+		if (slave_dev && slave_dev == run_dev)
+			continue;
+
+		if (run_dev) {
+			err = run_dev->netdev_ops->ndo_xdp_xmit(run_dev, i - start,
+								frames + start,
+								flags);
+			if (err > 0)
+				nxmit += err;
+			if (err < i - start)
+				goto out;
+		}
 		if (!slave_dev) {
 			err = -ENXIO;
-			break;
+			goto out;
 		}
-
-		err = slave_dev->netdev_ops->ndo_xdp_xmit(slave_dev, 1, frames1, flags);
-		if (err < 1)
-			break;
+		run_dev = slave_dev;
+		start = i;
 	}
 
+	if (run_dev) {
+		err = run_dev->netdev_ops->ndo_xdp_xmit(run_dev, n - start,
+							frames + start, flags);
+		if (err > 0)
+			nxmit += err;
+	}
+out:
 	rcu_read_unlock();
 
 	/* If error happened on the first frame then we can pass the error up, otherwise
@@ -17,6 +17,7 @@
 #include <linux/version.h>
 #include <linux/vmalloc.h>
 #include <net/ip.h>
+#include <net/xdp_sock_drv.h>
 
 #include "ena_netdev.h"
 #include <linux/bpf_trace.h>
@@ -184,6 +185,90 @@ static int ena_xmit_common(struct net_device *dev,
 	return 0;
 }
 
+/* Send the frames queued on the AF_XDP TX ring of the pool bound to the
+ * xdp ring. The frames are already DMA mapped by the pool, and the doorbell
+ * is written once for the whole burst.
+ *
+ * Returns true if the TX ring was drained within the budget.
+ */
+static bool ena_xsk_xmit(struct ena_ring *xdp_ring, u32 budget)
+{
+	struct xsk_buff_pool *xsk_pool = xdp_ring->xsk_pool;
+	struct ena_com_tx_ctx ena_tx_ctx;
+	struct ena_tx_buffer *tx_info;
+	u16 next_to_use, req_id;
+	struct xdp_desc desc;
+	u32 sent = 0;
+	int push_len;
+	dma_addr_t dma;
+	void *data;
+
+	spin_lock(&xdp_ring->xdp_tx_lock);
+
+	while (sent < budget) {
+		/* Once a descriptor is peeked it has to be sent, as the AF_XDP
+		 * completions are reported in order.
+		 */
+		if (unlikely(!ena_com_sq_have_enough_space(xdp_ring->ena_com_io_sq,
+							   2)))
+			break;
+
+		if (!xsk_tx_peek_desc(xsk_pool, &desc))
+			break;
+
+		dma = xsk_buff_raw_get_dma(xsk_pool, desc.addr);
+		data = xsk_buff_raw_get_data(xsk_pool, desc.addr);
+		xsk_buff_raw_dma_sync_for_device(xsk_pool, dma, desc.len);
+
+		next_to_use = xdp_ring->next_to_use;
+		req_id = xdp_ring->free_ids[next_to_use];
+		tx_info = &xdp_ring->tx_buffer_info[req_id];
+		tx_info->num_of_bufs = 0;
+		tx_info->xsk = 1;
+
+		memset(&ena_tx_ctx, 0, sizeof(ena_tx_ctx));
+		ena_tx_ctx.req_id = req_id;
+
+		push_len = 0;
+		if (xdp_ring->tx_mem_queue_type == ENA_ADMIN_PLACEMENT_POLICY_DEV) {
+			push_len = min_t(u32, desc.len, xdp_ring->tx_max_header_size);
+			ena_tx_ctx.push_header = data;
+		}
+		ena_tx_ctx.header_len = push_len;
+
+		if (desc.len > push_len) {
+			tx_info->bufs[0].paddr = dma + push_len;
+			tx_info->bufs[0].len = desc.len - push_len;
+			ena_tx_ctx.ena_bufs = tx_info->bufs;
+			ena_tx_ctx.num_bufs = 1;
+		}
+
+		/* Besides a full queue, which was checked above, all failures
+		 * trigger a device reset which completes the pending frames.
+		 */
+		if (unlikely(ena_xmit_common(xdp_ring->netdev, xdp_ring, tx_info,
+					     &ena_tx_ctx, next_to_use,
+					     desc.len))) {
+			tx_info->xsk = 0;
+			break;
+		}
+
+		sent++;
+	}
+
+	if (sent) {
+		ena_ring_tx_doorbell(xdp_ring);
+		xsk_tx_release(xsk_pool);
+	}
+
+	spin_unlock(&xdp_ring->xdp_tx_lock);
+
+	if (xsk_uses_need_wakeup(xsk_pool))
+		xsk_set_tx_need_wakeup(xsk_pool);
+
+	return sent < budget;
+}
+
 /* This is the XDP napi callback. XDP queues use a separate napi callback
  * than Rx/Tx queues.
  */
@@ -192,6 +277,7 @@ static int ena_xdp_io_poll(struct napi_struct *napi, int budget)
 	struct ena_napi *ena_napi = container_of(napi, struct ena_napi, napi);
 	u32 xdp_work_done, xdp_budget;
 	struct ena_ring *xdp_ring;
+	bool xsk_done = true;
 	int napi_comp_call = 0;
 	int ret;
 
@@ -207,13 +293,16 @@ static int ena_xdp_io_poll(struct napi_struct *napi, int budget)
 
 	xdp_work_done = ena_clean_xdp_irq(xdp_ring, xdp_budget);
 
+	if (xdp_ring->xsk_pool)
+		xsk_done = ena_xsk_xmit(xdp_ring, xdp_budget);
+
 	/* If the device is about to reset or down, avoid unmask
 	 * the interrupt and return 0 so NAPI won't reschedule
 	 */
 	if (unlikely(!test_bit(ENA_FLAG_DEV_UP, &xdp_ring->adapter->flags))) {
 		napi_complete_done(napi, 0);
 		ret = 0;
-	} else if (xdp_budget > xdp_work_done) {
+	} else if (xdp_budget > xdp_work_done && xsk_done) {
 		napi_comp_call = 1;
 		if (napi_complete_done(napi, xdp_work_done))
 			ena_unmask_interrupt(xdp_ring, NULL);
@@ -238,11 +327,21 @@ static int ena_xdp_tx_map_frame(struct ena_ring *xdp_ring,
 				struct ena_com_tx_ctx *ena_tx_ctx)
 {
 	struct ena_adapter *adapter = xdp_ring->adapter;
+	struct skb_shared_info *sinfo;
 	struct ena_com_buf *ena_buf;
 	int push_len = 0;
 	dma_addr_t dma;
+	u32 nr_frags = 0;
 	void *data;
 	u32 size;
+	int i;
+
+	if (unlikely(xdp_frame_has_frags(xdpf))) {
+		sinfo = xdp_get_shared_info_from_frame(xdpf);
+		nr_frags = sinfo->nr_frags;
+		if (unlikely(nr_frags + 1 > xdp_ring->sgl_size))
+			return -EINVAL;
+	}
 
 	tx_info->xdpf = xdpf;
 	data = tx_info->xdpf->data;
@@ -259,6 +358,8 @@ static int ena_xdp_tx_map_frame(struct ena_ring *xdp_ring,
 	}
 
 	ena_tx_ctx->header_len = push_len;
+	tx_info->map_linear_data = 0;
+	ena_buf = tx_info->bufs;
 
 	if (size > 0) {
 		dma = dma_map_single(xdp_ring->dev,
@@ -268,19 +369,39 @@ static int ena_xdp_tx_map_frame(struct ena_ring *xdp_ring,
 		if (unlikely(dma_mapping_error(xdp_ring->dev, dma)))
 			goto error_report_dma_error;
 
-		tx_info->map_linear_data = 0;
+		ena_buf->paddr = dma;
+		ena_buf->len = size;
+		ena_buf++;
+		tx_info->num_of_bufs++;
+	}
+
+	for (i = 0; i < nr_frags; i++) {
+		skb_frag_t *frag = &sinfo->frags[i];
+
+		size = skb_frag_size(frag);
+		dma = skb_frag_dma_map(xdp_ring->dev, frag, 0, size,
+				       DMA_TO_DEVICE);
+		if (unlikely(dma_mapping_error(xdp_ring->dev, dma)))
+			goto error_unmap_dma;
 
-		ena_buf = tx_info->bufs;
 		ena_buf->paddr = dma;
 		ena_buf->len = size;
+		ena_buf++;
+		tx_info->num_of_bufs++;
+	}
 
-		ena_tx_ctx->ena_bufs = ena_buf;
-		ena_tx_ctx->num_bufs = tx_info->num_of_bufs = 1;
+	if (tx_info->num_of_bufs) {
+		ena_tx_ctx->ena_bufs = tx_info->bufs;
+		ena_tx_ctx->num_bufs = tx_info->num_of_bufs;
 	}
 
 	return 0;
 
+error_unmap_dma:
+	ena_unmap_tx_buff(xdp_ring, tx_info);
+	tx_info->num_of_bufs = 0;
 error_report_dma_error:
+	tx_info->xdpf = NULL;
 	ena_increase_stat(&xdp_ring->tx_stats.dma_mapping_err, 1,
 			  &xdp_ring->syncp);
 	netif_warn(adapter, tx_queued, adapter->netdev, "Failed to map xdp buff\n");
@@ -314,7 +435,7 @@ static int ena_xdp_xmit_frame(struct ena_ring *xdp_ring,
 			     tx_info,
 			     &ena_tx_ctx,
 			     next_to_use,
-			     xdpf->len);
+			     xdp_get_frame_len(xdpf));
 	if (rc)
 		goto error_unmap_dma;
 
@@ -403,8 +524,8 @@ static int ena_xdp_execute(struct ena_ring *rx_ring, struct xdp_buff *xdp)
 		/* The XDP queues are shared between XDP_TX and XDP_REDIRECT */
 		spin_lock(&xdp_ring->xdp_tx_lock);
 
-		if (ena_xdp_xmit_frame(xdp_ring, rx_ring->netdev, xdpf,
-				       XDP_XMIT_FLUSH))
+		/* The doorbell is written once at the end of the napi poll */
+		if (ena_xdp_xmit_frame(xdp_ring, rx_ring->netdev, xdpf, 0))
 			xdp_return_frame(xdpf);
 
 		spin_unlock(&xdp_ring->xdp_tx_lock);
@@ -485,7 +606,8 @@ static int ena_xdp_register_rxq_info(struct ena_ring *rx_ring)
 {
 	int rc;
 
-	rc = xdp_rxq_info_reg(&rx_ring->xdp_rxq, rx_ring->netdev, rx_ring->qid, 0);
+	rc = __xdp_rxq_info_reg(&rx_ring->xdp_rxq, rx_ring->netdev, rx_ring->qid,
+				0, ENA_PAGE_SIZE);
 
 	if (rc) {
 		netif_err(rx_ring->adapter, ifup, rx_ring->netdev,
@@ -514,6 +636,43 @@ static void ena_xdp_unregister_rxq_info(struct ena_ring *rx_ring)
 	xdp_rxq_info_unreg(&rx_ring->xdp_rxq);
 }
 
+/* Returns the AF_XDP pool the queue should use in zero-copy mode, if any.
+ * Zero-copy requires the XDP queues, so it's used only while a program is
+ * attached.
+ */
+static struct xsk_buff_pool *ena_xsk_pool(struct ena_adapter *adapter, u16 qid)
+{
+	if (!ena_xdp_present(adapter) || !test_bit(qid, adapter->af_xdp_zc_qps))
+		return NULL;
+
+	return xsk_get_pool_from_qid(adapter->netdev, qid);
+}
+
+/* Switch the memory model of the rx queue between the page based one and
+ * the one of the AF_XDP zero-copy pool.
+ */
+static int ena_xdp_update_rxq_mem_model(struct ena_ring *rx_ring)
+{
+	enum xdp_mem_type type;
+	int rc;
+
+	type = rx_ring->xsk_pool ? MEM_TYPE_XSK_BUFF_POOL : MEM_TYPE_PAGE_SHARED;
+
+	xdp_rxq_info_unreg_mem_model(&rx_ring->xdp_rxq);
+	rc = xdp_rxq_info_reg_mem_model(&rx_ring->xdp_rxq, type, NULL);
+	if (rc) {
+		netif_err(rx_ring->adapter, ifup, rx_ring->netdev,
+			  "Failed to register xdp rx queue info memory model. RX queue num %d rc: %d\n",
+			  rx_ring->qid, rc);
+		return rc;
+	}
+
+	if (rx_ring->xsk_pool)
+		xsk_pool_set_rxq_info(rx_ring->xsk_pool, &rx_ring->xdp_rxq);
+
+	return 0;
+}
+
 static void ena_xdp_exchange_program_rx_in_range(struct ena_adapter *adapter,
 						 struct bpf_prog *prog,
 						 int first, int count)
@@ -580,7 +739,7 @@ static int ena_xdp_set(struct net_device *netdev, struct netdev_bpf *bpf)
 	bool is_up;
 
 	is_up = test_bit(ENA_FLAG_DEV_UP, &adapter->flags);
-	rc = ena_xdp_allowed(adapter);
+	rc = ena_xdp_allowed(adapter, prog);
 	if (rc == ENA_XDP_ALLOWED) {
 		old_bpf_prog = adapter->xdp_bpf_prog;
 		if (prog) {
@@ -606,7 +765,8 @@ static int ena_xdp_set(struct net_device *netdev, struct netdev_bpf *bpf)
 		}
 
 		prev_mtu = netdev->max_mtu;
-		netdev->max_mtu = prog ? ENA_XDP_MAX_MTU : adapter->max_mtu;
+		netdev->max_mtu = prog ? ena_xdp_max_mtu(adapter, prog) :
+					 adapter->max_mtu;
 
 		if (!old_bpf_prog)
 			netif_info(adapter, drv, adapter->netdev,
@@ -615,8 +775,8 @@ static int ena_xdp_set(struct net_device *netdev, struct netdev_bpf *bpf)
 
 	} else if (rc == ENA_XDP_CURRENT_MTU_TOO_LARGE) {
 		netif_err(adapter, drv, adapter->netdev,
-			  "Failed to set xdp program, the current MTU (%d) is larger than the maximum allowed MTU (%lu) while xdp is on",
-			  netdev->mtu, ENA_XDP_MAX_MTU);
+			  "Failed to set xdp program, the current MTU (%d) is larger than the maximum allowed MTU (%u) while xdp is on",
+			  netdev->mtu, ena_xdp_max_mtu(adapter, prog));
 		NL_SET_ERR_MSG_MOD(bpf->extack,
 				   "Failed to set xdp program, the current MTU is larger than the maximum allowed MTU. Check the dmesg for more info");
 		return -EINVAL;
@@ -632,14 +792,103 @@ static int ena_xdp_set(struct net_device *netdev, struct netdev_bpf *bpf)
 	return 0;
 }
 
+/* The queues pick up their AF_XDP pool when they are created, so the
+ * interface is restarted if the change affects the running rings.
+ */
+static int ena_xsk_pool_enable(struct ena_adapter *adapter,
+			       struct xsk_buff_pool *pool, u16 qid)
+{
+	bool restart;
+	int rc;
+
+	if (qid >= adapter->num_io_queues)
+		return -EINVAL;
+
+	rc = xsk_pool_dma_map(pool, &adapter->pdev->dev, 0);
+	if (rc)
+		return rc;
+
+	restart = test_bit(ENA_FLAG_DEV_UP, &adapter->flags) &&
+		  ena_xdp_present(adapter);
+	if (restart)
+		ena_down(adapter);
+
+	set_bit(qid, adapter->af_xdp_zc_qps);
+
+	return restart ? ena_up(adapter) : 0;
+}
+
+static int ena_xsk_pool_disable(struct ena_adapter *adapter, u16 qid)
+{
+	struct xsk_buff_pool *pool;
+	bool restart;
+	int rc = 0;
+
+	pool = xsk_get_pool_from_qid(adapter->netdev, qid);
+	if (!pool || !test_bit(qid, adapter->af_xdp_zc_qps))
+		return -EINVAL;
+
+	restart = test_bit(ENA_FLAG_DEV_UP, &adapter->flags) &&
+		  ena_xdp_present(adapter);
+	if (restart)
+		ena_down(adapter);
+
+	clear_bit(qid, adapter->af_xdp_zc_qps);
+	xsk_pool_dma_unmap(pool, 0);
+
+	if (restart)
+		rc = ena_up(adapter);
+
+	return rc;
+}
+
+static void ena_xsk_napi_schedule(struct napi_struct *napi)
+{
+	if (napi_if_scheduled_mark_missed(napi))
+		return;
+
+	local_bh_disable();
+	napi_schedule(napi);
+	local_bh_enable();
+}
+
+static int ena_xsk_wakeup(struct net_device *netdev, u32 qid, u32 flags)
+{
+	struct ena_adapter *adapter = netdev_priv(netdev);
+
+	if (!test_bit(ENA_FLAG_DEV_UP, &adapter->flags))
+		return -ENETDOWN;
+
+	if (!ena_xdp_present(adapter) || qid >= adapter->num_io_queues ||
+	    !adapter->rx_ring[qid].xsk_pool)
+		return -ENXIO;
+
+	/* RX is refilled by the queue's napi, TX is sent by the napi of its
+	 * xdp queue
+	 */
+	if (flags & XDP_WAKEUP_RX)
+		ena_xsk_napi_schedule(&adapter->ena_napi[qid].napi);
+	if (flags & XDP_WAKEUP_TX)
+		ena_xsk_napi_schedule(&adapter->ena_napi[adapter->xdp_first_ring + qid].napi);
+
+	return 0;
+}
+
 /* This is the main xdp callback, it's used by the kernel to set/unset the xdp
  * program as well as to query the current xdp program id.
  */
 static int ena_xdp(struct net_device *netdev, struct netdev_bpf *bpf)
 {
+	struct ena_adapter *adapter = netdev_priv(netdev);
+
 	switch (bpf->command) {
 	case XDP_SETUP_PROG:
 		return ena_xdp_set(netdev, bpf);
+	case XDP_SETUP_XSK_POOL:
+		if (bpf->xsk.pool)
+			return ena_xsk_pool_enable(adapter, bpf->xsk.pool,
+						   bpf->xsk.queue_id);
+		return ena_xsk_pool_disable(adapter, bpf->xsk.queue_id);
 	default:
 		return -EINVAL;
 	}
@@ -787,6 +1036,9 @@ static int ena_setup_tx_resources(struct ena_adapter *adapter, int qid)
 	tx_ring->next_to_clean = 0;
 	tx_ring->cpu = ena_irq->cpu;
 	tx_ring->numa_node = node;
+	if (ENA_IS_XDP_INDEX(adapter, qid))
+		tx_ring->xsk_pool = ena_xsk_pool(adapter,
+						 qid - adapter->xdp_first_ring);
 	return 0;
 
 err_push_buf_intermediate_buf:
@@ -817,6 +1069,8 @@ static void ena_free_tx_resources(struct ena_adapter *adapter, int qid)
 
 	vfree(tx_ring->push_buf_intermediate_buf);
 	tx_ring->push_buf_intermediate_buf = NULL;
+
+	tx_ring->xsk_pool = NULL;
 }
 
 static int ena_setup_tx_resources_in_range(struct ena_adapter *adapter,
@@ -921,6 +1175,10 @@ static int ena_setup_rx_resources(struct ena_adapter *adapter,
 	rx_ring->cpu = ena_irq->cpu;
 	rx_ring->numa_node = node;
 
+	rx_ring->xsk_pool = ena_xsk_pool(adapter, qid);
+	if (rx_ring->xsk_pool && ena_xdp_update_rxq_mem_model(rx_ring))
+		rx_ring->xsk_pool = NULL;
+
 	return 0;
 }
 
@@ -940,6 +1198,11 @@ static void ena_free_rx_resources(struct ena_adapter *adapter,
 
 	vfree(rx_ring->free_ids);
 	rx_ring->free_ids = NULL;
+
+	if (rx_ring->xsk_pool) {
+		rx_ring->xsk_pool = NULL;
+		ena_xdp_update_rxq_mem_model(rx_ring);
+	}
 }
 
 /* ena_setup_all_rx_resources - allocate I/O Rx queues resources for all queues
@@ -1074,12 +1337,62 @@ static void ena_free_rx_page(struct ena_ring *rx_ring,
 	rx_info->page = NULL;
 }
 
+/* Post buffers of the AF_XDP pool. Running out of them is expected if user
+ * space doesn't keep up filling the pool, so it isn't reported.
+ */
+static int ena_xsk_refill_rx_bufs(struct ena_ring *rx_ring, u32 num)
+{
+	struct ena_rx_buffer *rx_info;
+	u16 next_to_use, req_id;
+	u32 i;
+	int rc;
+
+	next_to_use = rx_ring->next_to_use;
+
+	for (i = 0; i < num; i++) {
+		req_id = rx_ring->free_ids[next_to_use];
+		rx_info = &rx_ring->rx_buffer_info[req_id];
+
+		if (likely(!rx_info->xdp)) {
+			rx_info->xdp = xsk_buff_alloc(rx_ring->xsk_pool);
+			if (!rx_info->xdp)
+				break;
+		}
+
+		rx_info->ena_buf.paddr = xsk_buff_xdp_get_dma(rx_info->xdp);
+		rx_info->ena_buf.len = xsk_pool_get_rx_frame_size(rx_ring->xsk_pool);
+
+		rc = ena_com_add_single_rx_desc(rx_ring->ena_com_io_sq,
+						&rx_info->ena_buf,
+						req_id);
+		if (unlikely(rc)) {
+			netif_warn(rx_ring->adapter, rx_status, rx_ring->netdev,
+				   "Failed to add buffer for rx queue %d\n",
+				   rx_ring->qid);
+			break;
+		}
+		next_to_use = ENA_RX_RING_IDX_NEXT(next_to_use,
+						   rx_ring->ring_size);
+	}
+
+	/* ena_com_write_sq_doorbell issues a wmb() */
+	if (likely(i))
+		ena_com_write_sq_doorbell(rx_ring->ena_com_io_sq);
+
+	rx_ring->next_to_use = next_to_use;
+
+	return i;
+}
+
 static int ena_refill_rx_bufs(struct ena_ring *rx_ring, u32 num)
 {
 	u16 next_to_use, req_id;
 	u32 i;
 	int rc;
 
+	if (rx_ring->xsk_pool)
+		return ena_xsk_refill_rx_bufs(rx_ring, num);
+
 	next_to_use = rx_ring->next_to_use;
 
 	for (i = 0; i < num; i++) {
@@ -1137,6 +1450,11 @@ static void ena_free_rx_bufs(struct ena_adapter *adapter,
 
 		if (rx_info->page)
 			ena_free_rx_page(rx_ring, rx_info);
+
+		if (rx_info->xdp) {
+			xsk_buff_free(rx_info->xdp);
+			rx_info->xdp = NULL;
+		}
 	}
 }
 
@@ -1153,7 +1471,7 @@ static void ena_refill_all_rx_bufs(struct ena_adapter *adapter)
 		bufs_num = rx_ring->ring_size - 1;
 		rc = ena_refill_rx_bufs(rx_ring, bufs_num);
 
-		if (unlikely(rc != bufs_num))
+		if (unlikely(rc != bufs_num) && !rx_ring->xsk_pool)
 			netif_warn(rx_ring->adapter, rx_status, rx_ring->netdev,
 				   "Refilling Queue %d failed. allocated %d buffers from: %d\n",
 				   i, rc, bufs_num);
@@ -1204,11 +1522,17 @@ static void ena_unmap_tx_buff(struct ena_ring *tx_ring,
 static void ena_free_tx_bufs(struct ena_ring *tx_ring)
 {
 	bool print_once = true;
+	u32 xsk_frames = 0;
 	u32 i;
 
 	for (i = 0; i < tx_ring->ring_size; i++) {
 		struct ena_tx_buffer *tx_info = &tx_ring->tx_buffer_info[i];
 
+		if (tx_info->xsk) {
+			xsk_frames++;
+			continue;
+		}
+
 		if (!tx_info->skb)
 			continue;
 
@@ -1227,6 +1551,10 @@ static void ena_free_tx_bufs(struct ena_ring *tx_ring)
 
 		dev_kfree_skb_any(tx_info->skb);
 	}
+
+	if (xsk_frames)
+		xsk_tx_completed(tx_ring->xsk_pool, xsk_frames);
+
 	netdev_tx_reset_queue(netdev_get_tx_queue(tx_ring->netdev,
 						  tx_ring->qid));
 }
@@ -1309,7 +1637,7 @@ static int validate_xdp_req_id(struct ena_ring *xdp_ring, u16 req_id)
 	struct ena_tx_buffer *tx_info;
 
 	tx_info = &xdp_ring->tx_buffer_info[req_id];
-	if (likely(tx_info->xdpf))
+	if (likely(tx_info->xdpf || tx_info->xsk))
 		return 0;
 
 	return handle_invalid_req_id(xdp_ring, req_id, tx_info, true);
@@ -1671,20 +1999,83 @@ static void ena_set_rx_hash(struct ena_ring *rx_ring,
 	}
 }
 
-static int ena_xdp_handle_buff(struct ena_ring *rx_ring, struct xdp_buff *xdp)
+/* Attach the buffers following the first one to the xdp_buff as fragments.
+ * Their pages are unmapped and handed over to the XDP frame, the ring gets
+ * new ones on refill.
+ */
+static void ena_xdp_add_frags(struct ena_ring *rx_ring, struct xdp_buff *xdp,
+			      u32 descs)
 {
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
 	struct ena_rx_buffer *rx_info;
+	skb_frag_t *frag;
+	u16 len;
+	u32 i;
+
+	sinfo->nr_frags = 0;
+	sinfo->xdp_frags_size = 0;
+
+	for (i = 1; i < descs; i++) {
+		rx_info = &rx_ring->rx_buffer_info[rx_ring->ena_bufs[i].req_id];
+		len = rx_ring->ena_bufs[i].len;
+
+		ena_unmap_rx_buff_attrs(rx_ring, rx_info, 0);
+
+		frag = &sinfo->frags[sinfo->nr_frags++];
+		skb_frag_fill_page_desc(frag, rx_info->page,
+					rx_info->page_offset + rx_info->buf_offset,
+					len);
+		sinfo->xdp_frags_size += len;
+
+		if (page_is_pfmemalloc(rx_info->page))
+			xdp_buff_set_frag_pfmemalloc(xdp);
+
+		rx_info->page = NULL;
+	}
+
+	xdp_buff_set_frags_flag(xdp);
+}
+
+static void ena_xdp_free_frags(struct xdp_buff *xdp)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
+	int i;
+
+	for (i = 0; i < sinfo->nr_frags; i++)
+		put_page(skb_frag_page(&sinfo->frags[i]));
+}
+
+static int ena_xdp_handle_buff(struct ena_ring *rx_ring, struct xdp_buff *xdp,
+			       u16 num_descs)
+{
+	struct ena_rx_buffer *rx_info;
+	struct bpf_prog *xdp_prog;
 	int ret;
 
+	xdp->flags = 0;
+
+	if (unlikely(num_descs > 1)) {
+		/* Only programs which declare it can access the fragments
+		 * of a multi-buffer frame
+		 */
+		xdp_prog = READ_ONCE(rx_ring->xdp_bpf_prog);
+		if (!xdp_prog->aux->xdp_has_frags ||
+		    num_descs - 1 > MAX_SKB_FRAGS)
+			return ENA_XDP_DROP;
+	} else if (unlikely(rx_ring->ena_bufs[0].len > ENA_XDP_MAX_MTU)) {
+		/* If for some reason we received a bigger packet than
+		 * we expect, then we simply drop it
+		 */
+		return ENA_XDP_DROP;
+	}
+
 	rx_info = &rx_ring->rx_buffer_info[rx_ring->ena_bufs[0].req_id];
 	xdp_prepare_buff(xdp, page_address(rx_info->page),
 			 rx_info->buf_offset,
 			 rx_ring->ena_bufs[0].len, false);
-	/* If for some reason we received a bigger packet than
-	 * we expect, then we simply drop it
-	 */
-	if (unlikely(rx_ring->ena_bufs[0].len > ENA_XDP_MAX_MTU))
-		return ENA_XDP_DROP;
+
+	if (unlikely(num_descs > 1))
+		ena_xdp_add_frags(rx_ring, xdp, num_descs);
 
 	ret = ena_xdp_execute(rx_ring, xdp);
 
@@ -1692,10 +2083,90 @@ static int ena_xdp_handle_buff(struct ena_ring *rx_ring, struct xdp_buff *xdp)
 	if (ret == ENA_XDP_PASS) {
 		rx_info->buf_offset = xdp->data - xdp->data_hard_start;
 		rx_ring->ena_bufs[0].len = xdp->data_end - xdp->data;
+	} else if (ret == ENA_XDP_DROP && xdp_buff_has_frags(xdp)) {
+		ena_xdp_free_frags(xdp);
 	}
 
 	return ret;
 }
+
+/* Build the skb of a multi-buffer frame passed by the XDP program. The
+ * fragments are owned by the xdp_buff already, and the program might have
+ * trimmed some of them.
+ */
+static struct sk_buff *ena_xdp_rx_skb(struct ena_ring *rx_ring,
+				      struct xdp_buff *xdp, u32 descs,
+				      u16 *next_to_clean)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
+	u32 nr_frags = 0, frags_size = 0;
+	struct ena_rx_buffer *rx_info;
+	struct sk_buff *skb;
+	u32 i;
+
+	/* napi_build_skb() clears the part of the shared info before the
+	 * fragments array
+	 */
+	if (xdp_buff_has_frags(xdp)) {
+		nr_frags = sinfo->nr_frags;
+		frags_size = sinfo->xdp_frags_size;
+	}
+
+	rx_info = &rx_ring->rx_buffer_info[rx_ring->ena_bufs[0].req_id];
+
+	skb = ena_alloc_skb(rx_ring, xdp->data_hard_start, ENA_PAGE_SIZE);
+	if (unlikely(!skb)) {
+		for (i = 0; i < nr_frags; i++)
+			put_page(skb_frag_page(&sinfo->frags[i]));
+		return NULL;
+	}
+
+	ena_unmap_rx_buff_attrs(rx_ring, rx_info, 0);
+	rx_info->page = NULL;
+
+	skb_reserve(skb, xdp->data - xdp->data_hard_start);
+	__skb_put(skb, xdp->data_end - xdp->data);
+	if (nr_frags)
+		xdp_update_skb_shared_info(skb, nr_frags, frags_size,
+					   nr_frags * ENA_PAGE_SIZE,
+					   xdp_buff_is_frag_pfmemalloc(xdp));
+	skb->protocol = eth_type_trans(skb, rx_ring->netdev);
+
+	for (i = 0; i < descs; i++) {
+		rx_ring->free_ids[*next_to_clean] = rx_ring->ena_bufs[i].req_id;
+		*next_to_clean = ENA_RX_RING_IDX_NEXT(*next_to_clean,
+						      rx_ring->ring_size);
+	}
+
+	return skb;
+}
+
+static void ena_rx_pkt_error(struct ena_ring *rx_ring, int rc)
+{
+	struct ena_adapter *adapter = netdev_priv(rx_ring->netdev);
+
+	if (rc == -ENOSPC) {
+		ena_increase_stat(&rx_ring->rx_stats.bad_desc_num, 1,
+				  &rx_ring->syncp);
+		ena_reset_device(adapter, ENA_REGS_RESET_TOO_MANY_RX_DESCS);
+	} else {
+		ena_increase_stat(&rx_ring->rx_stats.bad_req_id, 1,
+				  &rx_ring->syncp);
+		ena_reset_device(adapter, ENA_REGS_RESET_INV_RX_REQ_ID);
+	}
+}
+
+/* XDP_TX frames are queued without a doorbell, it's written once for all
+ * the frames of a napi poll. With LLQ ena_xmit_common() still writes it
+ * whenever the device's max burst size is reached.
+ */
+static void ena_xdp_ring_tx_doorbell(struct ena_ring *xdp_ring)
+{
+	spin_lock(&xdp_ring->xdp_tx_lock);
+	ena_ring_tx_doorbell(xdp_ring);
+	spin_unlock(&xdp_ring->xdp_tx_lock);
+}
+
 /* ena_clean_rx_irq - Cleanup RX irq
  * @rx_ring: RX ring to clean
  * @napi: napi handler
@@ -1709,7 +2180,6 @@ static int ena_clean_rx_irq(struct ena_ring *rx_ring, struct napi_struct *napi,
 	u16 next_to_clean = rx_ring->next_to_clean;
 	struct ena_com_rx_ctx ena_rx_ctx;
 	struct ena_rx_buffer *rx_info;
-	struct ena_adapter *adapter;
 	u32 res_budget, work_done;
 	int rx_copybreak_pkt = 0;
 	int refill_threshold;
@@ -1719,6 +2189,7 @@ static int ena_clean_rx_irq(struct ena_ring *rx_ring, struct napi_struct *napi,
 	int xdp_flags = 0;
 	int total_len = 0;
 	int xdp_verdict;
+	bool xdp_mb;
 	int rc = 0;
 	int i;
 
@@ -1752,11 +2223,18 @@ static int ena_clean_rx_irq(struct ena_ring *rx_ring, struct napi_struct *napi,
 			  rx_ring->qid, ena_rx_ctx.descs, ena_rx_ctx.l3_proto,
 			  ena_rx_ctx.l4_proto, ena_rx_ctx.hash);
 
-		if (ena_xdp_present_ring(rx_ring))
-			xdp_verdict = ena_xdp_handle_buff(rx_ring, &xdp);
+		xdp_mb = false;
+		if (ena_xdp_present_ring(rx_ring)) {
+			xdp_verdict = ena_xdp_handle_buff(rx_ring, &xdp,
+							  ena_rx_ctx.descs);
+			xdp_mb = ena_rx_ctx.descs > 1;
+		}
 
 		/* allocate skb and fill it */
-		if (xdp_verdict == ENA_XDP_PASS)
+		if (xdp_verdict == ENA_XDP_PASS && unlikely(xdp_mb))
+			skb = ena_xdp_rx_skb(rx_ring, &xdp, ena_rx_ctx.descs,
+					     &next_to_clean);
+		else if (xdp_verdict == ENA_XDP_PASS)
 			skb = ena_rx_skb(rx_ring,
 					 rx_ring->ena_bufs,
 					 ena_rx_ctx.descs,
@@ -1772,9 +2250,11 @@ static int ena_clean_rx_irq(struct ena_ring *rx_ring, struct napi_struct *napi,
 							     rx_ring->ring_size);
 
 				/* Packets was passed for transmission, unmap it
-				 * from RX side.
+				 * from RX side. The fragments of a multi-buffer
+				 * frame were unmapped already.
 				 */
-				if (xdp_verdict & ENA_XDP_FORWARDED) {
+				if ((xdp_verdict & ENA_XDP_FORWARDED) &&
+				    rx_ring->rx_buffer_info[req_id].page) {
 					ena_unmap_rx_buff_attrs(rx_ring,
 								&rx_ring->rx_buffer_info[req_id],
 								0);
@@ -1830,21 +2310,162 @@ static int ena_clean_rx_irq(struct ena_ring *rx_ring, struct napi_struct *napi,
 	if (xdp_flags & ENA_XDP_REDIRECT)
 		xdp_do_flush_map();
 
+	if (xdp_flags & ENA_XDP_TX)
+		ena_xdp_ring_tx_doorbell(rx_ring->xdp_ring);
+
 	return work_done;
 
 error:
-	adapter = netdev_priv(rx_ring->netdev);
+	ena_rx_pkt_error(rx_ring, rc);
+	return 0;
+}
 
-	if (rc == -ENOSPC) {
-		ena_increase_stat(&rx_ring->rx_stats.bad_desc_num, 1,
-				  &rx_ring->syncp);
-		ena_reset_device(adapter, ENA_REGS_RESET_TOO_MANY_RX_DESCS);
-	} else {
-		ena_increase_stat(&rx_ring->rx_stats.bad_req_id, 1,
-				  &rx_ring->syncp);
-		ena_reset_device(adapter, ENA_REGS_RESET_INV_RX_REQ_ID);
+static struct sk_buff *ena_xsk_rx_skb(struct ena_ring *rx_ring,
+				      struct xdp_buff *xdp)
+{
+	unsigned int len = xdp->data_end - xdp->data;
+	struct sk_buff *skb;
+
+	skb = ena_alloc_skb(rx_ring, NULL, len);
+	if (likely(skb)) {
+		skb_put_data(skb, xdp->data, len);
+		skb->protocol = eth_type_trans(skb, rx_ring->netdev);
 	}
-	return 0;
+
+	xsk_buff_free(xdp);
+	return skb;
+}
+
+/* ena_xsk_clean_rx_irq - Cleanup RX irq of an AF_XDP zero-copy queue
+ * @rx_ring: RX ring to clean
+ * @napi: napi handler
+ * @budget: how many packets driver is allowed to clean
+ *
+ * Frames passed to the stack are copied out of the pool. Frames which span
+ * more than one buffer don't fit into an AF_XDP frame and are dropped.
+ *
+ * Returns the number of cleaned buffers.
+ */
+static int ena_xsk_clean_rx_irq(struct ena_ring *rx_ring,
+				struct napi_struct *napi, u32 budget)
+{
+	struct xsk_buff_pool *xsk_pool = rx_ring->xsk_pool;
+	u16 next_to_clean = rx_ring->next_to_clean;
+	struct ena_com_rx_ctx ena_rx_ctx;
+	struct ena_rx_buffer *rx_info;
+	int refill_required, refill_threshold;
+	u32 work_done = 0;
+	int xdp_flags = 0;
+	int total_len = 0;
+	struct sk_buff *skb;
+	struct xdp_buff *xdp;
+	int xdp_verdict;
+	int rc, i;
+
+	while (likely(work_done < budget)) {
+		ena_rx_ctx.ena_bufs = rx_ring->ena_bufs;
+		ena_rx_ctx.max_bufs = rx_ring->sgl_size;
+		ena_rx_ctx.descs = 0;
+		ena_rx_ctx.pkt_offset = 0;
+		rc = ena_com_rx_pkt(rx_ring->ena_com_io_cq,
+				    rx_ring->ena_com_io_sq,
+				    &ena_rx_ctx);
+		if (unlikely(rc)) {
+			ena_rx_pkt_error(rx_ring, rc);
+			return 0;
+		}
+
+		if (unlikely(ena_rx_ctx.descs == 0))
+			break;
+
+		rx_info = &rx_ring->rx_buffer_info[rx_ring->ena_bufs[0].req_id];
+		xdp = rx_info->xdp;
+		if (unlikely(!xdp)) {
+			ena_rx_pkt_error(rx_ring, -EFAULT);
+			return 0;
+		}
+
+		xdp_verdict = ENA_XDP_DROP;
+		if (likely(ena_rx_ctx.descs == 1)) {
+			/* The device might place the packet at an offset */
+			xsk_buff_set_size(xdp, ena_rx_ctx.pkt_offset +
+					  rx_ring->ena_bufs[0].len);
+			xdp->data += ena_rx_ctx.pkt_offset;
+			xdp->data_meta = xdp->data;
+			xsk_buff_dma_sync_for_cpu(xdp, xsk_pool);
+
+			xdp_verdict = ena_xdp_execute(rx_ring, xdp);
+		}
+
+		total_len += rx_ring->ena_bufs[0].len;
+
+		/* A redirected or transmitted buffer is owned by its target
+		 * now, TX frames are copied out of the pool.
+		 */
+		if (xdp_verdict == ENA_XDP_PASS) {
+			rx_info->xdp = NULL;
+			skb = ena_xsk_rx_skb(rx_ring, xdp);
+			if (likely(skb)) {
+				ena_rx_checksum(rx_ring, &ena_rx_ctx, skb);
+				ena_set_rx_hash(rx_ring, &ena_rx_ctx, skb);
+				skb_record_rx_queue(skb, rx_ring->qid);
+				napi_gro_receive(napi, skb);
+			}
+		} else if (xdp_verdict & ENA_XDP_FORWARDED) {
+			rx_info->xdp = NULL;
+			xdp_flags |= xdp_verdict;
+		}
+
+		for (i = 0; i < ena_rx_ctx.descs; i++) {
+			u16 req_id = rx_ring->ena_bufs[i].req_id;
+
+			rx_info = &rx_ring->rx_buffer_info[req_id];
+			if (rx_info->xdp) {
+				xsk_buff_free(rx_info->xdp);
+				rx_info->xdp = NULL;
+			}
+
+			rx_ring->free_ids[next_to_clean] = req_id;
+			next_to_clean = ENA_RX_RING_IDX_NEXT(next_to_clean,
+							     rx_ring->ring_size);
+		}
+
+		work_done++;
+	}
+
+	rx_ring->per_napi_packets += work_done;
+	u64_stats_update_begin(&rx_ring->syncp);
+	rx_ring->rx_stats.bytes += total_len;
+	rx_ring->rx_stats.cnt += work_done;
+	u64_stats_update_end(&rx_ring->syncp);
+
+	rx_ring->next_to_clean = next_to_clean;
+
+	refill_required = ena_com_free_q_entries(rx_ring->ena_com_io_sq);
+	refill_threshold =
+		min_t(int, rx_ring->ring_size / ENA_RX_REFILL_THRESH_DIVIDER,
+		      ENA_RX_REFILL_THRESH_PACKET);
+
+	if (refill_required > refill_threshold) {
+		ena_com_update_dev_comp_head(rx_ring->ena_com_io_cq);
+		ena_refill_rx_bufs(rx_ring, refill_required);
+	}
+
+	/* Ask to be woken up if the pool ran out of buffers */
+	if (xsk_uses_need_wakeup(xsk_pool)) {
+		if (ena_com_free_q_entries(rx_ring->ena_com_io_sq) > refill_threshold)
+			xsk_set_rx_need_wakeup(xsk_pool);
+		else
+			xsk_clear_rx_need_wakeup(xsk_pool);
+	}
+
+	if (xdp_flags & ENA_XDP_REDIRECT)
+		xdp_do_flush_map();
+
+	if (xdp_flags & ENA_XDP_TX)
+		ena_xdp_ring_tx_doorbell(rx_ring->xdp_ring);
+
+	return work_done;
 }
 
 static void ena_dim_work(struct work_struct *w)
@@ -1950,6 +2571,7 @@ static void ena_update_ring_numa_node(struct ena_ring *tx_ring,
 static int ena_clean_xdp_irq(struct ena_ring *xdp_ring, u32 budget)
 {
 	u32 total_done = 0;
+	u32 xsk_frames = 0;
 	u16 next_to_clean;
 	int tx_pkts = 0;
 	u16 req_id;
@@ -1991,7 +2613,12 @@ static int ena_clean_xdp_irq(struct ena_ring *xdp_ring, u32 budget)
 		tx_pkts++;
 		total_done += tx_info->tx_descs;
 
-		xdp_return_frame(xdpf);
+		if (tx_info->xsk) {
+			tx_info->xsk = 0;
+			xsk_frames++;
+		} else {
+			xdp_return_frame(xdpf);
+		}
 		xdp_ring->free_ids[next_to_clean] = req_id;
 		next_to_clean = ENA_TX_RING_IDX_NEXT(next_to_clean,
 						     xdp_ring->ring_size);
@@ -2001,6 +2628,9 @@ static int ena_clean_xdp_irq(struct ena_ring *xdp_ring, u32 budget)
 	ena_com_comp_ack(xdp_ring->ena_com_io_sq, total_done);
 	ena_com_update_dev_comp_head(xdp_ring->ena_com_io_cq);
 
+	if (xsk_frames)
+		xsk_tx_completed(xdp_ring->xsk_pool, xsk_frames);
+
 	netif_dbg(xdp_ring->adapter, tx_done, xdp_ring->netdev,
 		  "tx_poll: q %d done. total pkts: %d\n",
 		  xdp_ring->qid, tx_pkts);
@@ -2034,7 +2664,9 @@ static int ena_io_poll(struct napi_struct *napi, int budget)
 	 * tx completions.
 	 */
 	if (likely(budget))
-		rx_work_done = ena_clean_rx_irq(rx_ring, napi, budget);
+		rx_work_done = rx_ring->xsk_pool ?
+			       ena_xsk_clean_rx_irq(rx_ring, napi, budget) :
+			       ena_clean_rx_irq(rx_ring, napi, budget);
 
 	/* If the device is about to reset or down, avoid unmask
 	 * the interrupt and return 0 so NAPI won't reschedule
@@ -2922,7 +3554,7 @@ int ena_update_queue_count(struct ena_adapter *adapter, u32 new_channel_count)
 	prev_channel_count = adapter->num_io_queues;
 	adapter->num_io_queues = new_channel_count;
 	if (ena_xdp_present(adapter) &&
-	    ena_xdp_allowed(adapter) == ENA_XDP_ALLOWED) {
+	    ena_xdp_allowed(adapter, adapter->xdp_bpf_prog) == ENA_XDP_ALLOWED) {
 		adapter->xdp_first_ring = new_channel_count;
 		adapter->xdp_num_queues = new_channel_count;
 		if (prev_channel_count > new_channel_count)
@@ -3430,6 +4062,7 @@ static const struct net_device_ops ena_netdev_ops = {
 	.ndo_validate_addr	= eth_validate_addr,
 	.ndo_bpf		= ena_xdp,
 	.ndo_xdp_xmit		= ena_xdp_xmit,
+	.ndo_xsk_wakeup		= ena_xsk_wakeup,
 };
 
 static void ena_calc_io_queue_size(struct ena_adapter *adapter,
@@ -4515,7 +5148,10 @@ static int ena_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 
 	if (ena_xdp_legal_queue_count(adapter, adapter->num_io_queues))
 		netdev->xdp_features = NETDEV_XDP_ACT_BASIC |
-				       NETDEV_XDP_ACT_REDIRECT;
+				       NETDEV_XDP_ACT_REDIRECT |
+				       NETDEV_XDP_ACT_RX_SG |
+				       NETDEV_XDP_ACT_NDO_XMIT_SG |
+				       NETDEV_XDP_ACT_XSK_ZEROCOPY;
 
 	memcpy(adapter->netdev->perm_addr, adapter->mac_addr, netdev->addr_len);
 
@@ -7,6 +7,7 @@
 #define ENA_H
 
 #include <linux/bitops.h>
+#include <linux/bpf.h>
 #include <linux/dim.h>
 #include <linux/etherdevice.h>
 #include <linux/if_vlan.h>
@@ -156,6 +157,11 @@ struct ena_tx_buffer {
 	 */
 	struct xdp_frame *xdpf;
 
+	/* Indicate that the buffer holds a frame of the AF_XDP zero-copy
+	 * pool, whose DMA mapping is owned by the pool
+	 */
+	u8 xsk;
+
 	/* Indicate if bufs[0] map the linear data of the skb. */
 	u8 map_linear_data;
 
@@ -177,6 +183,8 @@ struct ena_tx_buffer {
 struct ena_rx_buffer {
 	struct sk_buff *skb;
 	struct page *page;
+	/* AF_XDP zero-copy buffer, used instead of @page */
+	struct xdp_buff *xdp;
 	dma_addr_t dma_addr;
 	u32 page_offset;
 	u32 buf_offset;
@@ -251,6 +259,8 @@ struct ena_ring {
 	 * which traffic should be redirected from this rx ring.
 	 */
 	struct ena_ring *xdp_ring;
+	/* AF_XDP zero-copy pool bound to the rx ring and to its xdp ring */
+	struct xsk_buff_pool *xsk_pool;
 
 	u16 next_to_use;
 	u16 next_to_clean;
@@ -390,6 +400,8 @@ struct ena_adapter {
 	struct bpf_prog *xdp_bpf_prog;
 	u32 xdp_first_ring;
 	u32 xdp_num_queues;
+	/* Queues which run in AF_XDP zero-copy mode while XDP is enabled */
+	DECLARE_BITMAP(af_xdp_zc_qps, ENA_MAX_NUM_IO_QUEUES);
 };
 
 void ena_set_ethtool_ops(struct net_device *netdev);
@@ -451,11 +463,24 @@ static inline bool ena_xdp_legal_queue_count(struct ena_adapter *adapter,
 	return 2 * queues <= adapter->max_num_io_queues;
 }
 
-static inline enum ena_xdp_errors_t ena_xdp_allowed(struct ena_adapter *adapter)
+/* Programs which handle multi-buffer frames can be used with any MTU the
+ * device supports, the others are limited to a single buffer per frame.
+ */
+static inline u32 ena_xdp_max_mtu(struct ena_adapter *adapter,
+				  struct bpf_prog *prog)
+{
+	if (prog && prog->aux->xdp_has_frags)
+		return adapter->max_mtu;
+
+	return ENA_XDP_MAX_MTU;
+}
+
+static inline enum ena_xdp_errors_t ena_xdp_allowed(struct ena_adapter *adapter,
+						    struct bpf_prog *prog)
 {
 	enum ena_xdp_errors_t rc = ENA_XDP_ALLOWED;
 
-	if (adapter->netdev->mtu > ENA_XDP_MAX_MTU)
+	if (prog && adapter->netdev->mtu > ena_xdp_max_mtu(adapter, prog))
 		rc = ENA_XDP_CURRENT_MTU_TOO_LARGE;
 	else if (!ena_xdp_legal_queue_count(adapter, adapter->num_io_queues))
 		rc = ENA_XDP_NO_ENOUGH_QUEUES;
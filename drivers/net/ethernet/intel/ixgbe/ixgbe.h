@@ -157,6 +157,7 @@ enum ixgbe_tx_flags {
 	/* software defined flags */
 	IXGBE_TX_FLAGS_SW_VLAN	= 0x80,
 	IXGBE_TX_FLAGS_FCOE	= 0x100,
+	IXGBE_TX_FLAGS_XSK_CTXT	= 0x200,	/* AF_XDP context descriptor */
 };
 
 /* VLAN info */
@@ -551,6 +552,32 @@ static inline __le32 ixgbe_test_staterr(union ixgbe_adv_rx_desc *rx_desc,
 	return rx_desc->wb.upper.status_error & cpu_to_le32(stat_err_bits);
 }
 
+/* Lets the XDP RX metadata kfuncs get back to the descriptor. In the
+ * zero-copy path it is laid over the xdp and cb fields of struct
+ * xdp_buff_xsk, so it can't grow past XSK_PRIV_MAX.
+ */
+struct ixgbe_xdp_buff {
+	struct xdp_buff xdp;
+	union ixgbe_adv_rx_desc *rx_desc;
+	struct ixgbe_ring *rx_ring;
+	/* time stamp appended to the packet data, valid with TSIP */
+	__le64 pktstamp;
+};
+
+/* Called once xdp.data_end is set and the buffer is synced for the CPU */
+static inline void ixgbe_xdp_buff_set_desc(struct ixgbe_xdp_buff *ctx,
+					   struct ixgbe_ring *rx_ring,
+					   union ixgbe_adv_rx_desc *rx_desc)
+{
+	ctx->rx_desc = rx_desc;
+	ctx->rx_ring = rx_ring;
+
+	/* The program may move data_end, grab the time stamp before */
+	if (unlikely(ixgbe_test_staterr(rx_desc, IXGBE_RXD_STAT_TSIP)))
+		memcpy(&ctx->pktstamp, ctx->xdp.data_end - IXGBE_TS_HDR_LEN,
+		       IXGBE_TS_HDR_LEN);
+}
+
 static inline u16 ixgbe_desc_unused(struct ixgbe_ring *ring)
 {
 	u16 ntc = ring->next_to_clean;
@@ -1030,6 +1057,7 @@ void ixgbe_ptp_rx_hang(struct ixgbe_adapter *adapter);
 void ixgbe_ptp_tx_hang(struct ixgbe_adapter *adapter);
 void ixgbe_ptp_rx_pktstamp(struct ixgbe_q_vector *, struct sk_buff *);
 void ixgbe_ptp_rx_rgtstamp(struct ixgbe_q_vector *, struct sk_buff *skb);
+u64 ixgbe_ptp_rx_pktstamp_ns(struct ixgbe_adapter *adapter, __le64 regval);
 static inline void ixgbe_ptp_rx_hwtstamp(struct ixgbe_ring *rx_ring,
 					 union ixgbe_adv_rx_desc *rx_desc,
 					 struct sk_buff *skb)
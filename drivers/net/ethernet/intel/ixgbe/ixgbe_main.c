@@ -1432,6 +1432,60 @@ static inline void ixgbe_rx_hash(struct ixgbe_ring *ring,
 		     PKT_HASH_TYPE_L4 : PKT_HASH_TYPE_L3);
 }
 
+static const enum xdp_rss_hash_type ixgbe_xdp_rss_types[] = {
+	[IXGBE_RXDADV_RSSTYPE_NONE]		= XDP_RSS_TYPE_NONE,
+	[IXGBE_RXDADV_RSSTYPE_IPV4_TCP]		= XDP_RSS_TYPE_L4_IPV4_TCP,
+	[IXGBE_RXDADV_RSSTYPE_IPV4]		= XDP_RSS_TYPE_L3_IPV4,
+	[IXGBE_RXDADV_RSSTYPE_IPV6_TCP]		= XDP_RSS_TYPE_L4_IPV6_TCP,
+	[IXGBE_RXDADV_RSSTYPE_IPV6_EX]		= XDP_RSS_TYPE_L3_IPV6_EX,
+	[IXGBE_RXDADV_RSSTYPE_IPV6]		= XDP_RSS_TYPE_L3_IPV6,
+	[IXGBE_RXDADV_RSSTYPE_IPV6_TCP_EX]	= XDP_RSS_TYPE_L4_IPV6_TCP_EX,
+	[IXGBE_RXDADV_RSSTYPE_IPV4_UDP]		= XDP_RSS_TYPE_L4_IPV4_UDP,
+	[IXGBE_RXDADV_RSSTYPE_IPV6_UDP]		= XDP_RSS_TYPE_L4_IPV6_UDP,
+	[IXGBE_RXDADV_RSSTYPE_IPV6_UDP_EX]	= XDP_RSS_TYPE_L4_IPV6_UDP_EX,
+};
+
+static int ixgbe_xdp_rx_hash(const struct xdp_md *_ctx, u32 *hash,
+			     enum xdp_rss_hash_type *rss_type)
+{
+	const struct ixgbe_xdp_buff *ctx = (void *)_ctx;
+	u16 type;
+
+	if (!(ctx->rx_ring->netdev->features & NETIF_F_RXHASH))
+		return -ENODATA;
+
+	type = le16_to_cpu(ctx->rx_desc->wb.lower.lo_dword.hs_rss.pkt_info) &
+	       IXGBE_RXDADV_RSSTYPE_MASK;
+	if (!type || type >= ARRAY_SIZE(ixgbe_xdp_rss_types))
+		return -ENODATA;
+
+	*hash = le32_to_cpu(ctx->rx_desc->wb.lower.hi_dword.rss);
+	*rss_type = ixgbe_xdp_rss_types[type];
+
+	return 0;
+}
+
+/* Only the time stamps the hardware writes into the buffer are reported,
+ * reading the latched RXSTMP registers would steal them from the stack.
+ */
+static int ixgbe_xdp_rx_timestamp(const struct xdp_md *_ctx, u64 *timestamp)
+{
+	const struct ixgbe_xdp_buff *ctx = (void *)_ctx;
+
+	if (!ixgbe_test_staterr(ctx->rx_desc, IXGBE_RXD_STAT_TSIP))
+		return -ENODATA;
+
+	*timestamp = ixgbe_ptp_rx_pktstamp_ns(ctx->rx_ring->q_vector->adapter,
+					      ctx->pktstamp);
+
+	return 0;
+}
+
+static const struct xdp_metadata_ops ixgbe_xdp_metadata_ops = {
+	.xmo_rx_timestamp	= ixgbe_xdp_rx_timestamp,
+	.xmo_rx_hash		= ixgbe_xdp_rx_hash,
+};
+
 #ifdef IXGBE_FCOE
 /**
  * ixgbe_rx_is_fcoe - check the rx desc for incoming pkt type
@@ -2295,13 +2349,13 @@ static int ixgbe_clean_rx_irq(struct ixgbe_q_vector *q_vector,
 	u16 cleaned_count = ixgbe_desc_unused(rx_ring);
 	unsigned int offset = rx_ring->rx_offset;
 	unsigned int xdp_xmit = 0;
-	struct xdp_buff xdp;
+	struct ixgbe_xdp_buff ctx;
 
 	/* Frame size depend on rx_ring setup when PAGE_SIZE=4K */
 #if (PAGE_SIZE < 8192)
 	frame_sz = ixgbe_rx_frame_truesize(rx_ring, 0);
 #endif
-	xdp_init_buff(&xdp, frame_sz, &rx_ring->xdp_rxq);
+	xdp_init_buff(&ctx.xdp, frame_sz, &rx_ring->xdp_rxq);
 
 	while (likely(total_rx_packets < budget)) {
 		union ixgbe_adv_rx_desc *rx_desc;
@@ -2335,13 +2389,14 @@ static int ixgbe_clean_rx_irq(struct ixgbe_q_vector *q_vector,
 
 			hard_start = page_address(rx_buffer->page) +
 				     rx_buffer->page_offset - offset;
-			xdp_prepare_buff(&xdp, hard_start, offset, size, true);
-			xdp_buff_clear_frags_flag(&xdp);
+			xdp_prepare_buff(&ctx.xdp, hard_start, offset, size, true);
+			xdp_buff_clear_frags_flag(&ctx.xdp);
 #if (PAGE_SIZE > 4096)
 			/* At larger PAGE_SIZE, frame_sz depend on len size */
-			xdp.frame_sz = ixgbe_rx_frame_truesize(rx_ring, size);
+			ctx.xdp.frame_sz = ixgbe_rx_frame_truesize(rx_ring, size);
 #endif
-			skb = ixgbe_run_xdp(adapter, rx_ring, &xdp);
+			ixgbe_xdp_buff_set_desc(&ctx, rx_ring, rx_desc);
+			skb = ixgbe_run_xdp(adapter, rx_ring, &ctx.xdp);
 		}
 
 		if (IS_ERR(skb)) {
@@ -2359,10 +2414,10 @@ static int ixgbe_clean_rx_irq(struct ixgbe_q_vector *q_vector,
 			ixgbe_add_rx_frag(rx_ring, rx_buffer, skb, size);
 		} else if (ring_uses_build_skb(rx_ring)) {
 			skb = ixgbe_build_skb(rx_ring, rx_buffer,
-					      &xdp, rx_desc);
+					      &ctx.xdp, rx_desc);
 		} else {
 			skb = ixgbe_construct_skb(rx_ring, rx_buffer,
-						  &xdp, rx_desc);
+						  &ctx.xdp, rx_desc);
 		}
 
 		/* exit if we failed to retrieve a buffer */
@@ -11008,7 +11063,9 @@ static int ixgbe_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 	netdev->priv_flags |= IFF_SUPP_NOFCS;
 
 	netdev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT |
-			       NETDEV_XDP_ACT_XSK_ZEROCOPY;
+			       NETDEV_XDP_ACT_XSK_ZEROCOPY |
+			       NETDEV_XDP_ACT_XSK_TX_OFFLOAD;
+	netdev->xdp_metadata_ops = &ixgbe_xdp_metadata_ops;
 
 	/* MTU range: 68 - 9710 */
 	netdev->min_mtu = ETH_MIN_MTU;
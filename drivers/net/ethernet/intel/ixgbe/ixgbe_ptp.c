@@ -892,6 +892,23 @@ void ixgbe_ptp_rx_pktstamp(struct ixgbe_q_vector *q_vector,
 				      le64_to_cpu(regval));
 }
 
+/**
+ * ixgbe_ptp_rx_pktstamp_ns - convert an RX time stamp found in a buffer
+ * @adapter: private adapter structure
+ * @regval: the time stamp, as stored at the end of the packet data
+ *
+ * Used for the XDP RX metadata, where there is no skb to store the time
+ * stamp in. Returns the time stamp in ns.
+ */
+u64 ixgbe_ptp_rx_pktstamp_ns(struct ixgbe_adapter *adapter, __le64 regval)
+{
+	struct skb_shared_hwtstamps hwtstamps;
+
+	ixgbe_ptp_convert_to_hwtstamp(adapter, &hwtstamps, le64_to_cpu(regval));
+
+	return ktime_to_ns(hwtstamps.hwtstamp);
+}
+
 /**
  * ixgbe_ptp_rx_rgtstamp - utility function which checks for RX time stamp
  * @q_vector: structure containing interrupt and ring information
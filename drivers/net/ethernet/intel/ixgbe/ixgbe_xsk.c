@@ -35,6 +35,8 @@ static int ixgbe_xsk_pool_enable(struct ixgbe_adapter *adapter,
 	    qid >= netdev->real_num_tx_queues)
 		return -EINVAL;
 
+	XSK_CHECK_PRIV_TYPE(struct ixgbe_xdp_buff);
+
 	err = xsk_pool_dma_map(pool, &adapter->pdev->dev, IXGBE_RX_DMA_ATTR);
 	if (err)
 		return err;
@@ -150,9 +152,11 @@ static int ixgbe_run_xdp_zc(struct ixgbe_adapter *adapter,
 
 bool ixgbe_alloc_rx_buffers_zc(struct ixgbe_ring *rx_ring, u16 count)
 {
+	struct xdp_buff *xdps[IXGBE_RX_BUFFER_WRITE];
 	union ixgbe_adv_rx_desc *rx_desc;
 	struct ixgbe_rx_buffer *bi;
 	u16 i = rx_ring->next_to_use;
+	u32 nb_buffs, j;
 	dma_addr_t dma;
 	bool ok = true;
 
@@ -165,32 +169,40 @@ bool ixgbe_alloc_rx_buffers_zc(struct ixgbe_ring *rx_ring, u16 count)
 	i -= rx_ring->count;
 
 	do {
-		bi->xdp = xsk_buff_alloc(rx_ring->xsk_pool);
-		if (!bi->xdp) {
+		/* rx_buffer_info isn't an array of xdp_buff pointers, take
+		 * the buffers from the pool a batch at a time instead
+		 */
+		nb_buffs = xsk_buff_alloc_batch(rx_ring->xsk_pool, xdps,
+						min_t(u16, count,
+						      IXGBE_RX_BUFFER_WRITE));
+		if (!nb_buffs) {
 			ok = false;
 			break;
 		}
 
-		dma = xsk_buff_xdp_get_dma(bi->xdp);
-
-		/* Refresh the desc even if buffer_addrs didn't change
-		 * because each write-back erases this info.
-		 */
-		rx_desc->read.pkt_addr = cpu_to_le64(dma);
-
-		rx_desc++;
-		bi++;
-		i++;
-		if (unlikely(!i)) {
-			rx_desc = IXGBE_RX_DESC(rx_ring, 0);
-			bi = rx_ring->rx_buffer_info;
-			i -= rx_ring->count;
+		for (j = 0; j < nb_buffs; j++) {
+			bi->xdp = xdps[j];
+			dma = xsk_buff_xdp_get_dma(bi->xdp);
+
+			/* Refresh the desc even if buffer_addrs didn't change
+			 * because each write-back erases this info.
+			 */
+			rx_desc->read.pkt_addr = cpu_to_le64(dma);
+
+			rx_desc++;
+			bi++;
+			i++;
+			if (unlikely(!i)) {
+				rx_desc = IXGBE_RX_DESC(rx_ring, 0);
+				bi = rx_ring->rx_buffer_info;
+				i -= rx_ring->count;
+			}
+
+			/* clear the length for the next_to_use descriptor */
+			rx_desc->wb.upper.length = 0;
 		}
 
-		/* clear the length for the next_to_use descriptor */
-		rx_desc->wb.upper.length = 0;
-
-		count--;
+		count -= nb_buffs;
 	} while (count);
 
 	i += rx_ring->count;
@@ -236,13 +248,21 @@ static struct sk_buff *ixgbe_construct_skb_zc(struct ixgbe_ring *rx_ring,
 	return skb;
 }
 
-static void ixgbe_inc_ntc(struct ixgbe_ring *rx_ring)
+static u16 ixgbe_inc_ntc(struct ixgbe_ring *rx_ring, u16 ntc)
 {
-	u32 ntc = rx_ring->next_to_clean + 1;
-
+	ntc++;
 	ntc = (ntc < rx_ring->count) ? ntc : 0;
-	rx_ring->next_to_clean = ntc;
 	prefetch(IXGBE_RX_DESC(rx_ring, ntc));
+
+	return ntc;
+}
+
+static struct ixgbe_xdp_buff *xsk_buff_to_ixgbe_ctx(struct xdp_buff *xdp)
+{
+	/* struct ixgbe_xdp_buff is laid over the xdp and cb fields of
+	 * struct xdp_buff_xsk, see XSK_CHECK_PRIV_TYPE()
+	 */
+	return (struct ixgbe_xdp_buff *)xdp;
 }
 
 int ixgbe_clean_rx_irq_zc(struct ixgbe_q_vector *q_vector,
@@ -252,10 +272,14 @@ int ixgbe_clean_rx_irq_zc(struct ixgbe_q_vector *q_vector,
 	unsigned int total_rx_bytes = 0, total_rx_packets = 0;
 	struct ixgbe_adapter *adapter = q_vector->adapter;
 	u16 cleaned_count = ixgbe_desc_unused(rx_ring);
+	u16 ntc = rx_ring->next_to_clean;
 	unsigned int xdp_res, xdp_xmit = 0;
 	bool failure = false;
 	struct sk_buff *skb;
 
+	/* next_to_clean is only written back once the batch is done, the
+	 * refill in the loop goes by cleaned_count.
+	 */
 	while (likely(total_rx_packets < budget)) {
 		union ixgbe_adv_rx_desc *rx_desc;
 		struct ixgbe_rx_buffer *bi;
@@ -269,7 +293,7 @@ int ixgbe_clean_rx_irq_zc(struct ixgbe_q_vector *q_vector,
 			cleaned_count = 0;
 		}
 
-		rx_desc = IXGBE_RX_DESC(rx_ring, rx_ring->next_to_clean);
+		rx_desc = IXGBE_RX_DESC(rx_ring, ntc);
 		size = le16_to_cpu(rx_desc->wb.upper.length);
 		if (!size)
 			break;
@@ -280,18 +304,14 @@ int ixgbe_clean_rx_irq_zc(struct ixgbe_q_vector *q_vector,
 		 */
 		dma_rmb();
 
-		bi = &rx_ring->rx_buffer_info[rx_ring->next_to_clean];
+		bi = &rx_ring->rx_buffer_info[ntc];
 
 		if (unlikely(!ixgbe_test_staterr(rx_desc,
 						 IXGBE_RXD_STAT_EOP))) {
-			struct ixgbe_rx_buffer *next_bi;
-
 			xsk_buff_free(bi->xdp);
 			bi->xdp = NULL;
-			ixgbe_inc_ntc(rx_ring);
-			next_bi =
-			       &rx_ring->rx_buffer_info[rx_ring->next_to_clean];
-			next_bi->discard = true;
+			ntc = ixgbe_inc_ntc(rx_ring, ntc);
+			rx_ring->rx_buffer_info[ntc].discard = true;
 			continue;
 		}
 
@@ -299,12 +319,14 @@ int ixgbe_clean_rx_irq_zc(struct ixgbe_q_vector *q_vector,
 			xsk_buff_free(bi->xdp);
 			bi->xdp = NULL;
 			bi->discard = false;
-			ixgbe_inc_ntc(rx_ring);
+			ntc = ixgbe_inc_ntc(rx_ring, ntc);
 			continue;
 		}
 
 		bi->xdp->data_end = bi->xdp->data + size;
 		xsk_buff_dma_sync_for_cpu(bi->xdp, rx_ring->xsk_pool);
+		ixgbe_xdp_buff_set_desc(xsk_buff_to_ixgbe_ctx(bi->xdp),
+					rx_ring, rx_desc);
 		xdp_res = ixgbe_run_xdp_zc(adapter, rx_ring, bi->xdp);
 
 		if (likely(xdp_res & (IXGBE_XDP_TX | IXGBE_XDP_REDIR))) {
@@ -323,7 +345,7 @@ int ixgbe_clean_rx_irq_zc(struct ixgbe_q_vector *q_vector,
 		total_rx_bytes += size;
 
 		cleaned_count++;
-		ixgbe_inc_ntc(rx_ring);
+		ntc = ixgbe_inc_ntc(rx_ring, ntc);
 		continue;
 
 construct_skb:
@@ -338,7 +360,7 @@ int ixgbe_clean_rx_irq_zc(struct ixgbe_q_vector *q_vector,
 		bi->xdp = NULL;
 
 		cleaned_count++;
-		ixgbe_inc_ntc(rx_ring);
+		ntc = ixgbe_inc_ntc(rx_ring, ntc);
 
 		if (eth_skb_pad(skb))
 			continue;
@@ -350,6 +372,8 @@ int ixgbe_clean_rx_irq_zc(struct ixgbe_q_vector *q_vector,
 		ixgbe_rx_skb(q_vector, skb);
 	}
 
+	rx_ring->next_to_clean = ntc;
+
 	if (xdp_xmit & IXGBE_XDP_REDIR)
 		xdp_do_flush_map();
 
@@ -393,18 +417,135 @@ void ixgbe_xsk_clean_rx_ring(struct ixgbe_ring *rx_ring)
 	}
 }
 
+/* Program a context descriptor for the checksum and segmentation offload
+ * requested by @meta, fixing up the headers the way ixgbe_tso() does.
+ * Returns false if the request can't be honored, the packet is then sent
+ * as is.
+ */
+static bool ixgbe_xsk_tx_offload(struct ixgbe_ring *xdp_ring, void *data,
+				 u32 len, struct xsk_tx_metadata *meta,
+				 struct ixgbe_tx_buffer *tx_bi, u32 *paylen)
+{
+	u32 vlan_macip_lens, type_tucmd, mss_l4len_idx = 0;
+	u32 l4_offset = meta->csum_start, mac_len = ETH_HLEN;
+	struct ixgbe_tx_buffer *ctx_bi;
+	struct ethhdr *eth = data;
+	__be16 proto = eth->h_proto;
+	u32 hdr_len;
+	__sum16 *check;
+
+	if (!(meta->flags & XDP_TXMD_FLAGS_CHECKSUM))
+		return false;
+
+	if (proto == htons(ETH_P_8021Q)) {
+		struct vlan_ethhdr *veth = data;
+
+		mac_len = VLAN_ETH_HLEN;
+		proto = veth->h_vlan_encapsulated_proto;
+	}
+
+	switch (meta->csum_offset) {
+	case offsetof(struct tcphdr, check):
+		type_tucmd = IXGBE_ADVTXD_TUCMD_L4T_TCP;
+		hdr_len = sizeof(struct tcphdr);
+		break;
+	case offsetof(struct udphdr, check):
+		type_tucmd = IXGBE_ADVTXD_TUCMD_L4T_UDP;
+		hdr_len = sizeof(struct udphdr);
+		break;
+	default:
+		return false;
+	}
+
+	/* The headers have to be in this buffer and fit the descriptor */
+	if (l4_offset <= mac_len ||
+	    l4_offset - mac_len >= BIT(IXGBE_ADVTXD_MACLEN_SHIFT) ||
+	    l4_offset + hdr_len > len)
+		return false;
+
+	check = data + l4_offset + meta->csum_offset;
+
+	if (meta->flags & XDP_TXMD_FLAGS_TSO) {
+		bool tcp = type_tucmd == IXGBE_ADVTXD_TUCMD_L4T_TCP;
+
+		switch (meta->gso_type) {
+		case XDP_TXMD_GSO_TCPV4:
+		case XDP_TXMD_GSO_TCPV6:
+			if (!tcp)
+				return false;
+			break;
+		case XDP_TXMD_GSO_UDP_L4:
+			if (tcp || !(xdp_ring->netdev->features & NETIF_F_GSO_UDP_L4))
+				return false;
+			break;
+		default:
+			return false;
+		}
+
+		if (tcp)
+			hdr_len = ((struct tcphdr *)(data + l4_offset))->doff * 4;
+		hdr_len += l4_offset;
+		if (!meta->gso_size || hdr_len >= len)
+			return false;
+
+		if (proto == htons(ETH_P_IP)) {
+			struct iphdr *iph = data + mac_len;
+
+			iph->tot_len = 0;
+			iph->check = 0;
+			type_tucmd |= IXGBE_ADVTXD_TUCMD_IPV4;
+			tx_bi->tx_flags |= IXGBE_TX_FLAGS_IPV4;
+		} else if (proto == htons(ETH_P_IPV6)) {
+			struct ipv6hdr *ip6h = data + mac_len;
+
+			ip6h->payload_len = 0;
+		} else {
+			return false;
+		}
+
+		/* remove payload length from the pseudo header checksum */
+		csum_replace_by_diff(check, (__force __wsum)htonl(len - l4_offset));
+
+		tx_bi->gso_segs = DIV_ROUND_UP(len - hdr_len, meta->gso_size);
+		tx_bi->bytecount += (tx_bi->gso_segs - 1) * hdr_len;
+		tx_bi->tx_flags |= IXGBE_TX_FLAGS_TSO;
+		*paylen = len - hdr_len;
+
+		mss_l4len_idx = (hdr_len - l4_offset) << IXGBE_ADVTXD_L4LEN_SHIFT;
+		mss_l4len_idx |= meta->gso_size << IXGBE_ADVTXD_MSS_SHIFT;
+	}
+
+	tx_bi->tx_flags |= IXGBE_TX_FLAGS_CSUM;
+
+	vlan_macip_lens = l4_offset - mac_len;
+	vlan_macip_lens |= mac_len << IXGBE_ADVTXD_MACLEN_SHIFT;
+
+	/* The context descriptor carries no buffer, the cleanup skips it */
+	ctx_bi = &xdp_ring->tx_buffer_info[xdp_ring->next_to_use];
+	ctx_bi->xdpf = NULL;
+	ctx_bi->tx_flags = IXGBE_TX_FLAGS_XSK_CTXT;
+	ixgbe_tx_ctxtdesc(xdp_ring, vlan_macip_lens, 0, type_tucmd,
+			  mss_l4len_idx);
+
+	return true;
+}
+
 static bool ixgbe_xmit_zc(struct ixgbe_ring *xdp_ring, unsigned int budget)
 {
 	struct xsk_buff_pool *pool = xdp_ring->xsk_pool;
 	union ixgbe_adv_tx_desc *tx_desc = NULL;
+	struct xsk_tx_metadata meta, *md;
 	struct ixgbe_tx_buffer *tx_bi;
+	u32 cmd_type, olinfo, paylen;
 	bool work_done = true;
 	struct xdp_desc desc;
 	dma_addr_t dma;
-	u32 cmd_type;
 
 	while (budget-- > 0) {
-		if (unlikely(!ixgbe_desc_unused(xdp_ring))) {
+		struct ixgbe_tx_buffer first = {};
+
+		/* Leave room for a context descriptor */
+		if (unlikely(ixgbe_desc_unused(xdp_ring) < 2)) {
 			work_done = false;
 			break;
 		}
@@ -415,25 +556,48 @@ static bool ixgbe_xmit_zc(struct ixgbe_ring *xdp_ring, unsigned int budget)
 		if (!xsk_tx_peek_desc(pool, &desc))
 			break;
 
-		dma = xsk_buff_raw_get_dma(pool, desc.addr);
-		xsk_buff_raw_dma_sync_for_device(pool, dma, desc.len);
+		paylen = desc.len;
+		olinfo = 0;
+		cmd_type = IXGBE_ADVTXD_DTYP_DATA |
+			   IXGBE_ADVTXD_DCMD_DEXT |
+			   IXGBE_ADVTXD_DCMD_IFCS;
+
+		/* The offload goes into a context descriptor in front of the
+		 * data one, so collect the accounting in @first until then.
+		 */
+		first.bytecount = desc.len;
+		first.gso_segs = 1;
+		md = xsk_buff_get_metadata(pool, &desc);
+		if (md) {
+			memcpy(&meta, md, sizeof(meta));
+			if (ixgbe_xsk_tx_offload(xdp_ring,
+						 xsk_buff_raw_get_data(pool, desc.addr),
+						 desc.len, &meta, &first, &paylen)) {
+				if (first.tx_flags & IXGBE_TX_FLAGS_TSO)
+					cmd_type |= IXGBE_ADVTXD_DCMD_TSE;
+				olinfo |= IXGBE_ADVTXD_POPTS_TXSM;
+				if (first.tx_flags & IXGBE_TX_FLAGS_IPV4)
+					olinfo |= IXGBE_ADVTXD_POPTS_IXSM;
+			}
+		}
 
 		tx_bi = &xdp_ring->tx_buffer_info[xdp_ring->next_to_use];
-		tx_bi->bytecount = desc.len;
+		tx_bi->bytecount = first.bytecount;
+		tx_bi->gso_segs = first.gso_segs;
 		tx_bi->xdpf = NULL;
-		tx_bi->gso_segs = 1;
+		tx_bi->tx_flags = 0;
+
+		dma = xsk_buff_raw_get_dma(pool, desc.addr);
+		xsk_buff_raw_dma_sync_for_device(pool, dma, desc.len);
 
 		tx_desc = IXGBE_TX_DESC(xdp_ring, xdp_ring->next_to_use);
 		tx_desc->read.buffer_addr = cpu_to_le64(dma);
 
 		/* put descriptor type bits */
-		cmd_type = IXGBE_ADVTXD_DTYP_DATA |
-			   IXGBE_ADVTXD_DCMD_DEXT |
-			   IXGBE_ADVTXD_DCMD_IFCS;
 		cmd_type |= desc.len | IXGBE_TXD_CMD;
 		tx_desc->read.cmd_type_len = cpu_to_le32(cmd_type);
 		tx_desc->read.olinfo_status =
-			cpu_to_le32(desc.len << IXGBE_ADVTXD_PAYLEN_SHIFT);
+			cpu_to_le32(olinfo | paylen << IXGBE_ADVTXD_PAYLEN_SHIFT);
 
 		xdp_ring->next_to_use++;
 		if (xdp_ring->next_to_use == xdp_ring->count)
@@ -472,6 +636,14 @@ bool ixgbe_clean_xdp_tx_irq(struct ixgbe_q_vector *q_vector,
 	tx_desc = IXGBE_TX_DESC(tx_ring, ntc);
 
 	while (ntc != ntu) {
+		/* Context descriptors don't report completion, the data
+		 * descriptor right after them does.
+		 */
+		if (tx_bi->tx_flags & IXGBE_TX_FLAGS_XSK_CTXT) {
+			tx_bi->tx_flags = 0;
+			goto next;
+		}
+
 		if (!(tx_desc->wb.status & cpu_to_le32(IXGBE_TXD_STAT_DD)))
 			break;
 
@@ -484,7 +656,7 @@ bool ixgbe_clean_xdp_tx_irq(struct ixgbe_q_vector *q_vector,
 			xsk_frames++;
 
 		tx_bi->xdpf = NULL;
-
+next:
 		tx_bi++;
 		tx_desc++;
 		ntc++;
@@ -559,10 +731,11 @@ void ixgbe_xsk_clean_tx_ring(struct ixgbe_ring *tx_ring)
 
 		if (tx_bi->xdpf)
 			ixgbe_clean_xdp_tx_buffer(tx_ring, tx_bi);
-		else
+		else if (!(tx_bi->tx_flags & IXGBE_TX_FLAGS_XSK_CTXT))
 			xsk_frames++;
 
 		tx_bi->xdpf = NULL;
+		tx_bi->tx_flags = 0;
 
 		ntc++;
 		if (ntc == tx_ring->count)
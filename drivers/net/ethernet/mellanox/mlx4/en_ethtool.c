@@ -341,6 +341,33 @@ bitmap_iterator_count(struct bitmap_iterator *h)
 	return h->count;
 }
 
+#ifdef CONFIG_PAGE_POOL_STATS
+#define NUM_PP_RECYCLE_STATS	5
+
+static int mlx4_en_get_pp_recycle_stats(struct mlx4_en_rx_ring *ring,
+					u64 *data)
+{
+	struct page_pool_stats stats = {};
+
+	page_pool_get_stats(ring->pp, &stats);
+	data[0] = stats.recycle_stats.cached;
+	data[1] = stats.recycle_stats.cache_full;
+	data[2] = stats.recycle_stats.ring;
+	data[3] = stats.recycle_stats.ring_full;
+	data[4] = stats.recycle_stats.released_refcnt;
+
+	return NUM_PP_RECYCLE_STATS;
+}
+#else
+#define NUM_PP_RECYCLE_STATS	0
+
+static int mlx4_en_get_pp_recycle_stats(struct mlx4_en_rx_ring *ring,
+					u64 *data)
+{
+	return 0;
+}
+#endif
+
 static int mlx4_en_get_sset_count(struct net_device *dev, int sset)
 {
 	struct mlx4_en_priv *priv = netdev_priv(dev);
@@ -352,7 +379,8 @@ static int mlx4_en_get_sset_count(struct net_device *dev, int sset)
 	case ETH_SS_STATS:
 		return bitmap_iterator_count(&it) +
 			(priv->tx_ring_num[TX] * 2) +
-			(priv->rx_ring_num * (3 + NUM_XDP_STATS));
+			(priv->rx_ring_num * (3 + NUM_XDP_STATS +
+					      NUM_PP_RECYCLE_STATS));
 	case ETH_SS_TEST:
 		return MLX4_EN_NUM_SELF_TEST - !(priv->mdev->dev->caps.flags
 					& MLX4_DEV_CAP_FLAG_UC_LOOPBACK) * 2;
@@ -435,6 +463,8 @@ static void mlx4_en_get_ethtool_stats(struct net_device *dev,
 		data[index++] = priv->rx_ring[i]->xdp_redirect_fail;
 		data[index++] = priv->rx_ring[i]->xdp_tx;
 		data[index++] = priv->rx_ring[i]->xdp_tx_full;
+		index += mlx4_en_get_pp_recycle_stats(priv->rx_ring[i],
+						      data + index);
 	}
 	spin_unlock_bh(&priv->stats_lock);
 
@@ -532,6 +562,18 @@ static void mlx4_en_get_strings(struct net_device *dev,
 				"rx%d_xdp_tx", i);
 			sprintf(data + (index++) * ETH_GSTRING_LEN,
 				"rx%d_xdp_tx_full", i);
+#ifdef CONFIG_PAGE_POOL_STATS
+			sprintf(data + (index++) * ETH_GSTRING_LEN,
+				"rx%d_pp_recycle_cached", i);
+			sprintf(data + (index++) * ETH_GSTRING_LEN,
+				"rx%d_pp_recycle_cache_full", i);
+			sprintf(data + (index++) * ETH_GSTRING_LEN,
+				"rx%d_pp_recycle_ring", i);
+			sprintf(data + (index++) * ETH_GSTRING_LEN,
+				"rx%d_pp_recycle_ring_full", i);
+			sprintf(data + (index++) * ETH_GSTRING_LEN,
+				"rx%d_pp_recycle_released_ref", i);
+#endif
 		}
 		break;
 	case ETH_SS_PRIV_FLAGS:
@@ -51,10 +51,6 @@
 #include "mlx4_en.h"
 #include "en_port.h"
 
-#define MLX4_EN_MAX_XDP_MTU ((int)(PAGE_SIZE - ETH_HLEN - (2 * VLAN_HLEN) - \
-				XDP_PACKET_HEADROOM -			    \
-				SKB_DATA_ALIGN(sizeof(struct skb_shared_info))))
-
 int mlx4_en_setup_tc(struct net_device *dev, u8 up)
 {
 	struct mlx4_en_priv *priv = netdev_priv(dev);
@@ -2366,13 +2362,18 @@ void mlx4_en_destroy_netdev(struct net_device *dev)
 	free_netdev(dev);
 }
 
-static bool mlx4_en_check_xdp_mtu(struct net_device *dev, int mtu)
+static bool mlx4_en_check_xdp_mtu(struct net_device *dev, int mtu,
+				  const struct bpf_prog *prog)
 {
 	struct mlx4_en_priv *priv = netdev_priv(dev);
+	int max_mtu = MLX4_EN_MAX_XDP_MTU;
+
+	if (prog && prog->aux->xdp_has_frags)
+		max_mtu = MLX4_EN_MAX_XDP_FRAGS_MTU;
 
-	if (mtu > MLX4_EN_MAX_XDP_MTU) {
+	if (mtu > max_mtu) {
 		en_err(priv, "mtu:%d > max:%d when XDP prog is attached\n",
-		       mtu, MLX4_EN_MAX_XDP_MTU);
+		       mtu, max_mtu);
 		return false;
 	}
 
@@ -2389,7 +2390,8 @@ static int mlx4_en_change_mtu(struct net_device *dev, int new_mtu)
 		 dev->mtu, new_mtu);
 
 	if (priv->tx_ring_num[TX_XDP] &&
-	    !mlx4_en_check_xdp_mtu(dev, new_mtu))
+	    !mlx4_en_check_xdp_mtu(dev, new_mtu,
+				   rtnl_dereference(priv->rx_ring[0]->xdp_prog)))
 		return -EOPNOTSUPP;
 
 	dev->mtu = new_mtu;
@@ -2739,6 +2741,9 @@ static int mlx4_xdp_set(struct net_device *dev, struct bpf_prog *prog)
 
 	xdp_ring_num = prog ? priv->rx_ring_num : 0;
 
+	if (prog && !mlx4_en_check_xdp_mtu(dev, dev->mtu, prog))
+		return -EOPNOTSUPP;
+
 	/* No need to reconfigure buffers when simply swapping the
 	 * program for a new one.
 	 */
@@ -2759,9 +2764,6 @@ static int mlx4_xdp_set(struct net_device *dev, struct bpf_prog *prog)
 		return 0;
 	}
 
-	if (!mlx4_en_check_xdp_mtu(dev, dev->mtu))
-		return -EOPNOTSUPP;
-
 	tmp = kzalloc(sizeof(*tmp), GFP_KERNEL);
 	if (!tmp)
 		return -ENOMEM;
@@ -3416,7 +3418,8 @@ int mlx4_en_init_netdev(struct mlx4_en_dev *mdev, int port,
 		priv->rss_hash_fn = ETH_RSS_HASH_TOP;
 	}
 
-	dev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT;
+	dev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT |
+			    NETDEV_XDP_ACT_RX_SG;
 
 	/* MTU range: 68 - hw-specific max */
 	dev->min_mtu = ETH_MIN_MTU;
@@ -50,24 +50,20 @@
 
 #include "mlx4_en.h"
 
-static int mlx4_alloc_page(struct mlx4_en_priv *priv,
+static int mlx4_alloc_page(struct mlx4_en_rx_ring *ring,
 			   struct mlx4_en_rx_alloc *frag,
+			   unsigned int stride, unsigned int headroom,
 			   gfp_t gfp)
 {
+	unsigned int offset;
 	struct page *page;
-	dma_addr_t dma;
 
-	page = alloc_page(gfp);
+	page = page_pool_alloc_frag(ring->pp, &offset, stride, gfp);
 	if (unlikely(!page))
 		return -ENOMEM;
-	dma = dma_map_page(priv->ddev, page, 0, PAGE_SIZE, priv->dma_dir);
-	if (unlikely(dma_mapping_error(priv->ddev, dma))) {
-		__free_page(page);
-		return -ENOMEM;
-	}
 	frag->page = page;
-	frag->dma = dma;
-	frag->page_offset = priv->rx_headroom;
+	frag->dma = page_pool_get_dma_addr(page);
+	frag->page_offset = offset + headroom;
 	return 0;
 }
 
@@ -81,7 +77,10 @@ static int mlx4_en_alloc_frags(struct mlx4_en_priv *priv,
 
 	for (i = 0; i < priv->num_frags; i++, frags++) {
 		if (!frags->page) {
-			if (mlx4_alloc_page(priv, frags, gfp))
+			/* Only the first fragment needs the XDP headroom */
+			if (mlx4_alloc_page(ring, frags,
+					    priv->frag_info[i].frag_stride,
+					    i ? 0 : priv->rx_headroom, gfp))
 				return -ENOMEM;
 			ring->rx_alloc_pages++;
 		}
@@ -91,14 +90,11 @@ static int mlx4_en_alloc_frags(struct mlx4_en_priv *priv,
 	return 0;
 }
 
-static void mlx4_en_free_frag(const struct mlx4_en_priv *priv,
+static void mlx4_en_free_frag(struct mlx4_en_rx_ring *ring,
 			      struct mlx4_en_rx_alloc *frag)
 {
-	if (frag->page) {
-		dma_unmap_page(priv->ddev, frag->dma,
-			       PAGE_SIZE, priv->dma_dir);
-		__free_page(frag->page);
-	}
+	if (frag->page)
+		page_pool_put_full_page(ring->pp, frag->page, false);
 	/* We need to clear all fields, otherwise a change of priv->log_rx_info
 	 * could lead to see garbage later in frag->page.
 	 */
@@ -138,18 +134,6 @@ static int mlx4_en_prepare_rx_desc(struct mlx4_en_priv *priv,
 		(index << ring->log_stride);
 	struct mlx4_en_rx_alloc *frags = ring->rx_info +
 					(index << priv->log_rx_info);
-	if (likely(ring->page_cache.index > 0)) {
-		/* XDP uses a single page per frame */
-		if (!frags->page) {
-			ring->page_cache.index--;
-			frags->page = ring->page_cache.buf[ring->page_cache.index].page;
-			frags->dma  = ring->page_cache.buf[ring->page_cache.index].dma;
-		}
-		frags->page_offset = XDP_PACKET_HEADROOM;
-		rx_desc->data[0].addr = cpu_to_be64(frags->dma +
-						    XDP_PACKET_HEADROOM);
-		return 0;
-	}
 
 	return mlx4_en_alloc_frags(priv, ring, rx_desc, frags, gfp);
 }
@@ -175,7 +159,7 @@ static void mlx4_en_free_rx_desc(const struct mlx4_en_priv *priv,
 	frags = ring->rx_info + (index << priv->log_rx_info);
 	for (nr = 0; nr < priv->num_frags; nr++) {
 		en_dbg(DRV, priv, "Freeing fragment:%d\n", nr);
-		mlx4_en_free_frag(priv, frags + nr);
+		mlx4_en_free_frag(ring, frags + nr);
 	}
 }
 
@@ -265,6 +249,7 @@ int mlx4_en_create_rx_ring(struct mlx4_en_priv *priv,
 			   u32 size, u16 stride, int node, int queue_index)
 {
 	struct mlx4_en_dev *mdev = priv->mdev;
+	struct page_pool_params pp = {};
 	struct mlx4_en_rx_ring *ring;
 	int err = -ENOMEM;
 	int tmp;
@@ -283,8 +268,31 @@ int mlx4_en_create_rx_ring(struct mlx4_en_priv *priv,
 	ring->log_stride = ffs(ring->stride) - 1;
 	ring->buf_size = ring->size * ring->stride + TXBB_SIZE;
 
-	if (xdp_rxq_info_reg(&ring->xdp_rxq, priv->dev, queue_index, 0) < 0)
+	/* The buffers are laid out only when the port is started, but
+	 * whether XDP is used is already known from the ring numbers.
+	 */
+	pp.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV | PP_FLAG_PAGE_FRAG;
+	pp.pool_size = size * DIV_ROUND_UP(MLX4_EN_EFF_MTU(priv->dev->mtu),
+					   PAGE_SIZE);
+	pp.nid = node;
+	pp.dev = priv->ddev;
+	pp.dma_dir = priv->tx_ring_num[TX_XDP] ? DMA_BIDIRECTIONAL :
+						 DMA_FROM_DEVICE;
+	pp.max_len = PAGE_SIZE;
+	ring->pp = page_pool_create(&pp);
+	if (IS_ERR(ring->pp)) {
+		err = PTR_ERR(ring->pp);
 		goto err_ring;
+	}
+
+	if (__xdp_rxq_info_reg(&ring->xdp_rxq, priv->dev, queue_index, 0,
+			       PAGE_SIZE) < 0)
+		goto err_pp;
+
+	err = xdp_rxq_info_reg_mem_model(&ring->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					 ring->pp);
+	if (err)
+		goto err_xdp_info;
 
 	tmp = size * roundup_pow_of_two(MLX4_EN_MAX_RX_FRAGS *
 					sizeof(struct mlx4_en_rx_alloc));
@@ -316,6 +324,8 @@ int mlx4_en_create_rx_ring(struct mlx4_en_priv *priv,
 	ring->rx_info = NULL;
 err_xdp_info:
 	xdp_rxq_info_unreg(&ring->xdp_rxq);
+err_pp:
+	page_pool_destroy(ring->pp);
 err_ring:
 	kfree(ring);
 	*pring = NULL;
@@ -406,26 +416,6 @@ void mlx4_en_recover_from_oom(struct mlx4_en_priv *priv)
 	}
 }
 
-/* When the rx ring is running in page-per-packet mode, a released frame can go
- * directly into a small cache, to avoid unmapping or touching the page
- * allocator. In bpf prog performance scenarios, buffers are either forwarded
- * or dropped, never converted to skbs, so every page can come directly from
- * this cache when it is sized to be a multiple of the napi budget.
- */
-bool mlx4_en_rx_recycle(struct mlx4_en_rx_ring *ring,
-			struct mlx4_en_rx_alloc *frame)
-{
-	struct mlx4_en_page_cache *cache = &ring->page_cache;
-
-	if (cache->index >= MLX4_EN_CACHE_SIZE)
-		return false;
-
-	cache->buf[cache->index].page = frame->page;
-	cache->buf[cache->index].dma = frame->dma;
-	cache->index++;
-	return true;
-}
-
 void mlx4_en_destroy_rx_ring(struct mlx4_en_priv *priv,
 			     struct mlx4_en_rx_ring **pring,
 			     u32 size, u16 stride)
@@ -443,6 +433,7 @@ void mlx4_en_destroy_rx_ring(struct mlx4_en_priv *priv,
 	mlx4_free_hwq_res(mdev->dev, &ring->wqres, size * stride + TXBB_SIZE);
 	kvfree(ring->rx_info);
 	ring->rx_info = NULL;
+	page_pool_destroy(ring->pp);
 	kfree(ring);
 	*pring = NULL;
 }
@@ -450,69 +441,51 @@ void mlx4_en_destroy_rx_ring(struct mlx4_en_priv *priv,
 void mlx4_en_deactivate_rx_ring(struct mlx4_en_priv *priv,
 				struct mlx4_en_rx_ring *ring)
 {
-	int i;
-
-	for (i = 0; i < ring->page_cache.index; i++) {
-		dma_unmap_page(priv->ddev, ring->page_cache.buf[i].dma,
-			       PAGE_SIZE, priv->dma_dir);
-		put_page(ring->page_cache.buf[i].page);
-	}
-	ring->page_cache.index = 0;
 	mlx4_en_free_rx_buf(priv, ring);
 	if (ring->stride <= TXBB_SIZE)
 		ring->buf -= TXBB_SIZE;
 }
 
 
+/* The fragments are handed over to the skb, and go back to the page_pool
+ * when it is freed. When the frame went through XDP with frags, the layout
+ * is taken from @xdp_sinfo, as bpf_xdp_adjust_tail() may have changed it,
+ * and the data is already synced for the CPU.
+ */
 static int mlx4_en_complete_rx_desc(struct mlx4_en_priv *priv,
 				    struct mlx4_en_rx_alloc *frags,
 				    struct sk_buff *skb,
-				    int length)
+				    int length,
+				    const struct skb_shared_info *xdp_sinfo)
 {
 	const struct mlx4_en_frag_info *frag_info = priv->frag_info;
 	unsigned int truesize = 0;
-	bool release = true;
 	int nr, frag_size;
 	struct page *page;
-	dma_addr_t dma;
 
-	/* Collect used fragments while replacing them in the HW descriptors */
+	/* Collect used fragments, new ones are allocated on refill */
 	for (nr = 0;; frags++) {
-		frag_size = min_t(int, length, frag_info->frag_size);
+		if (!xdp_sinfo)
+			frag_size = min_t(int, length, frag_info->frag_size);
+		else if (!nr)
+			frag_size = length - xdp_sinfo->xdp_frags_size;
+		else
+			frag_size = skb_frag_size(&xdp_sinfo->frags[nr - 1]);
 
 		page = frags->page;
 		if (unlikely(!page))
 			goto fail;
 
-		dma = frags->dma;
-		dma_sync_single_range_for_cpu(priv->ddev, dma, frags->page_offset,
-					      frag_size, priv->dma_dir);
+		if (!xdp_sinfo)
+			dma_sync_single_range_for_cpu(priv->ddev, frags->dma,
+						      frags->page_offset,
+						      frag_size, priv->dma_dir);
 
 		__skb_fill_page_desc(skb, nr, page, frags->page_offset,
 				     frag_size);
 
 		truesize += frag_info->frag_stride;
-		if (frag_info->frag_stride == PAGE_SIZE / 2) {
-			frags->page_offset ^= PAGE_SIZE / 2;
-			release = page_count(page) != 1 ||
-				  page_is_pfmemalloc(page) ||
-				  page_to_nid(page) != numa_mem_id();
-		} else if (!priv->rx_headroom) {
-			/* rx_headroom for non XDP setup is always 0.
-			 * When XDP is set, the above condition will
-			 * guarantee page is always released.
-			 */
-			u32 sz_align = ALIGN(frag_size, SMP_CACHE_BYTES);
-
-			frags->page_offset += sz_align;
-			release = frags->page_offset + frag_info->frag_size > PAGE_SIZE;
-		}
-		if (release) {
-			dma_unmap_page(priv->ddev, dma, PAGE_SIZE, priv->dma_dir);
-			frags->page = NULL;
-		} else {
-			page_ref_inc(page);
-		}
+		frags->page = NULL;
 
 		nr++;
 		length -= frag_size;
@@ -526,11 +499,49 @@ static int mlx4_en_complete_rx_desc(struct mlx4_en_priv *priv,
 fail:
 	while (nr > 0) {
 		nr--;
-		__skb_frag_unref(skb_shinfo(skb)->frags + nr, false);
+		__skb_frag_unref(skb_shinfo(skb)->frags + nr, true);
 	}
 	return 0;
 }
 
+/* Attach the fragments following the first one to an XDP frame spanning
+ * several of them.
+ */
+static u32 mlx4_en_xdp_add_frags(struct mlx4_en_priv *priv,
+				 struct mlx4_en_rx_alloc *frags,
+				 struct xdp_buff *xdp, u32 length)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
+	const struct mlx4_en_frag_info *frag_info = priv->frag_info;
+	u32 nr = 0;
+
+	length -= frag_info->frag_size;
+	sinfo->xdp_frags_size = length;
+	sinfo->xdp_frags_truesize = 0;
+
+	while (length) {
+		u32 frag_size;
+
+		frags++;
+		frag_info++;
+		frag_size = min_t(u32, length, frag_info->frag_size);
+		dma_sync_single_range_for_cpu(priv->ddev, frags->dma,
+					      frags->page_offset, frag_size,
+					      priv->dma_dir);
+		skb_frag_fill_page_desc(&sinfo->frags[nr], frags->page,
+					frags->page_offset, frag_size);
+		sinfo->xdp_frags_truesize += frag_info->frag_stride;
+		if (page_is_pfmemalloc(frags->page))
+			xdp_buff_set_frag_pfmemalloc(xdp);
+		length -= frag_size;
+		nr++;
+	}
+
+	sinfo->nr_frags = nr;
+	xdp_buff_set_frags_flag(xdp);
+	return nr;
+}
+
 static void validate_loopback(struct mlx4_en_priv *priv, void *va)
 {
 	const unsigned char *data = va + ETH_HLEN;
@@ -744,6 +755,7 @@ int mlx4_en_process_rx_cq(struct net_device *dev, struct mlx4_en_cq *cq, int bud
 	while (XNOR(cqe->owner_sr_opcode & MLX4_CQE_OWNER_MASK,
 		    cq->mcq.cons_index & cq->size)) {
 		struct mlx4_en_rx_alloc *frags;
+		const struct skb_shared_info *xdp_sinfo = NULL;
 		enum pkt_hash_types hash_type;
 		struct sk_buff *skb;
 		unsigned int length;
@@ -816,17 +828,27 @@ int mlx4_en_process_rx_cq(struct net_device *dev, struct mlx4_en_cq *cq, int bud
 		 * read bytes but not past the end of the frag.
 		 */
 		if (xdp_prog) {
+			u32 frag0_offset = frags[0].page_offset;
+			u32 xdp_nr_frags = 0;
 			dma_addr_t dma;
 			void *orig_data;
-			u32 act;
+			u32 act, i;
 
 			dma = frags[0].dma + frags[0].page_offset;
 			dma_sync_single_for_cpu(priv->ddev, dma,
 						priv->frag_info[0].frag_size,
 						DMA_FROM_DEVICE);
 
+			xdp_buff_clear_frags_flag(&mxbuf.xdp);
 			xdp_prepare_buff(&mxbuf.xdp, va - frags[0].page_offset,
-					 frags[0].page_offset, length, true);
+					 frags[0].page_offset,
+					 min_t(u32, length,
+					       priv->frag_info[0].frag_size),
+					 true);
+			if (unlikely(length > priv->frag_info[0].frag_size))
+				xdp_nr_frags = mlx4_en_xdp_add_frags(priv, frags,
+								     &mxbuf.xdp,
+								     length);
 			orig_data = mxbuf.xdp.data;
 			mxbuf.cqe = cqe;
 			mxbuf.mdev = priv->mdev;
@@ -835,12 +857,25 @@ int mlx4_en_process_rx_cq(struct net_device *dev, struct mlx4_en_cq *cq, int bud
 
 			act = bpf_prog_run_xdp(xdp_prog, &mxbuf.xdp);
 
-			length = mxbuf.xdp.data_end - mxbuf.xdp.data;
+			length = xdp_get_buff_len(&mxbuf.xdp);
 			if (mxbuf.xdp.data != orig_data) {
 				frags[0].page_offset = mxbuf.xdp.data -
 					mxbuf.xdp.data_hard_start;
 				va = mxbuf.xdp.data;
 			}
+			if (unlikely(xdp_nr_frags)) {
+				xdp_sinfo = xdp_get_shared_info_from_buff(&mxbuf.xdp);
+				nr = xdp_buff_has_frags(&mxbuf.xdp) ?
+				     xdp_sinfo->nr_frags : 0;
+				/* Frags trimmed by the program were already
+				 * given back to the page_pool.
+				 */
+				for (i = nr; i < xdp_nr_frags; i++)
+					frags[i + 1].page = NULL;
+				xdp_nr_frags = nr;
+				if (!xdp_nr_frags)
+					xdp_sinfo = NULL;
+			}
 
 			switch (act) {
 			case XDP_PASS:
@@ -849,14 +884,17 @@ int mlx4_en_process_rx_cq(struct net_device *dev, struct mlx4_en_cq *cq, int bud
 				if (likely(!xdp_do_redirect(dev, &mxbuf.xdp, xdp_prog))) {
 					ring->xdp_redirect++;
 					xdp_redir_flush = true;
-					frags[0].page = NULL;
+					for (i = 0; i <= xdp_nr_frags; i++)
+						frags[i].page = NULL;
 					goto next;
 				}
 				ring->xdp_redirect_fail++;
 				trace_xdp_exception(dev, xdp_prog, act);
 				goto xdp_drop_no_cnt;
 			case XDP_TX:
-				if (likely(!mlx4_en_xmit_frame(ring, frags, priv,
+				/* Only single descriptor frames can be sent */
+				if (likely(!xdp_nr_frags &&
+					   !mlx4_en_xmit_frame(ring, frags, priv,
 							length, cq_ring,
 							&doorbell_pending))) {
 					frags[0].page = NULL;
@@ -873,6 +911,8 @@ int mlx4_en_process_rx_cq(struct net_device *dev, struct mlx4_en_cq *cq, int bud
 			case XDP_DROP:
 				ring->xdp_drop++;
 xdp_drop_no_cnt:
+				/* The buffers are reused as they are */
+				frags[0].page_offset = frag0_offset;
 				goto next;
 			}
 		}
@@ -944,8 +984,10 @@ int mlx4_en_process_rx_cq(struct net_device *dev, struct mlx4_en_cq *cq, int bud
 			__vlan_hwaccel_put_tag(skb, htons(ETH_P_8021AD),
 					       be16_to_cpu(cqe->sl_vid));
 
-		nr = mlx4_en_complete_rx_desc(priv, frags, skb, length);
+		nr = mlx4_en_complete_rx_desc(priv, frags, skb, length,
+					      xdp_sinfo);
 		if (likely(nr)) {
+			skb_mark_for_recycle(skb);
 			skb_shinfo(skb)->nr_frags = nr;
 			skb->len = length;
 			skb->data_len = length;
@@ -1050,18 +1092,30 @@ void mlx4_en_calc_rx_buf(struct net_device *dev)
 	int eff_mtu = MLX4_EN_EFF_MTU(dev->mtu);
 	int i = 0;
 
-	/* bpf requires buffers to be set up as 1 packet per page.
-	 * This only works when num_frags == 1.
+	/* bpf requires every fragment to be a page of its own, the first
+	 * one also holding the headroom. Larger frames are only received
+	 * when the program handles frags, see mlx4_en_check_xdp_mtu().
 	 */
 	if (priv->tx_ring_num[TX_XDP]) {
-		priv->frag_info[0].frag_size = eff_mtu;
-		/* This will gain efficient xdp frame recycling at the
-		 * expense of more costly truesize accounting
-		 */
-		priv->frag_info[0].frag_stride = PAGE_SIZE;
+		int buf_size = 0;
+
+		while (buf_size < eff_mtu) {
+			int frag_size = eff_mtu - buf_size;
+
+			frag_size = min_t(int, frag_size,
+					  i ? PAGE_SIZE :
+					  MLX4_EN_EFF_MTU(MLX4_EN_MAX_XDP_MTU));
+			priv->frag_info[i].frag_size = frag_size;
+			/* This will gain efficient xdp frame recycling at the
+			 * expense of more costly truesize accounting
+			 */
+			priv->frag_info[i].frag_stride = PAGE_SIZE;
+
+			buf_size += frag_size;
+			i++;
+		}
 		priv->dma_dir = DMA_BIDIRECTIONAL;
 		priv->rx_headroom = XDP_PACKET_HEADROOM;
-		i = 1;
 	} else {
 		int frag_size_max = 2048, buf_size = 0;
 
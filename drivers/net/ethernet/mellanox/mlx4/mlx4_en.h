@@ -49,6 +49,7 @@
 #include <linux/ptp_clock_kernel.h>
 #include <linux/irq.h>
 #include <net/xdp.h>
+#include <net/page_pool.h>
 
 #include <linux/mlx4/device.h>
 #include <linux/mlx4/qp.h>
@@ -177,6 +178,15 @@
  * headers. (For example: ETH_P_8021Q and ETH_P_8021AD).
  */
 #define MLX4_EN_EFF_MTU(mtu)	((mtu) + ETH_HLEN + (2 * VLAN_HLEN))
+
+/* With XDP the first fragment also holds the headroom and, for frames
+ * with frags, the skb_shared_info. The following fragments are full pages.
+ */
+#define MLX4_EN_MAX_XDP_MTU ((int)(PAGE_SIZE - ETH_HLEN - (2 * VLAN_HLEN) - \
+				XDP_PACKET_HEADROOM -			    \
+				SKB_DATA_ALIGN(sizeof(struct skb_shared_info))))
+#define MLX4_EN_MAX_XDP_FRAGS_MTU (MLX4_EN_MAX_XDP_MTU + \
+				   (MLX4_EN_MAX_RX_FRAGS - 1) * (int)PAGE_SIZE)
 #define ETH_BCAST		0xffffffffffffULL
 
 #define MLX4_EN_LOOPBACK_RETRIES	5
@@ -250,16 +260,6 @@ struct mlx4_en_rx_alloc {
 	u32		page_offset;
 };
 
-#define MLX4_EN_CACHE_SIZE (2 * NAPI_POLL_WEIGHT)
-
-struct mlx4_en_page_cache {
-	u32 index;
-	struct {
-		struct page	*page;
-		dma_addr_t	dma;
-	} buf[MLX4_EN_CACHE_SIZE];
-};
-
 enum {
 	MLX4_EN_TX_RING_STATE_RECOVERING,
 };
@@ -341,7 +341,7 @@ struct mlx4_en_rx_ring {
 	void *buf;
 	void *rx_info;
 	struct bpf_prog __rcu *xdp_prog;
-	struct mlx4_en_page_cache page_cache;
+	struct page_pool *pp;
 	unsigned long bytes;
 	unsigned long packets;
 	unsigned long csum_ok;
@@ -703,8 +703,6 @@ netdev_tx_t mlx4_en_xmit_frame(struct mlx4_en_rx_ring *rx_ring,
 			       struct mlx4_en_priv *priv, unsigned int length,
 			       int tx_ind, bool *doorbell_pending);
 void mlx4_en_xmit_doorbell(struct mlx4_en_tx_ring *ring);
-bool mlx4_en_rx_recycle(struct mlx4_en_rx_ring *ring,
-			struct mlx4_en_rx_alloc *frame);
 
 int mlx4_en_create_tx_ring(struct mlx4_en_priv *priv,
 			   struct mlx4_en_tx_ring **pring,
@@ -3707,19 +3707,31 @@ mlxsw_sp_nexthop_group_update(struct mlxsw_sp *mlxsw_sp,
 	return 0;
 }
 
+static void mlxsw_sp_ralue_bulk_begin(struct mlxsw_sp *mlxsw_sp);
+static void mlxsw_sp_ralue_bulk_end(struct mlxsw_sp *mlxsw_sp);
+static int mlxsw_sp_ralue_bulk_flush(struct mlxsw_sp *mlxsw_sp);
+
 static int
 mlxsw_sp_nexthop_fib_entries_update(struct mlxsw_sp *mlxsw_sp,
 				    struct mlxsw_sp_nexthop_group *nh_grp)
 {
 	struct mlxsw_sp_fib_entry *fib_entry;
-	int err;
+	int err = 0;
 
+	/* Callers release the previous adjacency entries right after, so
+	 * wait for all the routes to be switched over.
+	 */
+	mlxsw_sp_ralue_bulk_begin(mlxsw_sp);
 	list_for_each_entry(fib_entry, &nh_grp->fib_list, nexthop_group_node) {
 		err = mlxsw_sp_fib_entry_update(mlxsw_sp, fib_entry);
 		if (err)
-			return err;
+			break;
 	}
-	return 0;
+	if (!err)
+		err = mlxsw_sp_ralue_bulk_flush(mlxsw_sp);
+	mlxsw_sp_ralue_bulk_end(mlxsw_sp);
+
+	return err;
 }
 
 struct mlxsw_sp_adj_grp_size_range {
@@ -5829,6 +5841,186 @@ mlxsw_sp_fib_entry_hw_flags_refresh(struct mlxsw_sp *mlxsw_sp,
 	}
 }
 
+static void
+mlxsw_sp_fib4_entry_offload_failed_set(struct mlxsw_sp *mlxsw_sp,
+				       struct mlxsw_sp_fib_entry *fib_entry)
+{
+	u32 *p_dst = (u32 *) fib_entry->fib_node->key.addr;
+	int dst_len = fib_entry->fib_node->key.prefix_len;
+	struct mlxsw_sp_fib4_entry *fib4_entry;
+	struct fib_rt_info fri;
+
+	fib4_entry = container_of(fib_entry, struct mlxsw_sp_fib4_entry,
+				  common);
+	fri.fi = fib4_entry->fi;
+	fri.tb_id = fib4_entry->tb_id;
+	fri.dst = cpu_to_be32(*p_dst);
+	fri.dst_len = dst_len;
+	fri.dscp = fib4_entry->dscp;
+	fri.type = fib4_entry->type;
+	fri.offload = false;
+	fri.trap = false;
+	fri.offload_failed = true;
+	fib_alias_hw_flags_set(mlxsw_sp_net(mlxsw_sp), &fri);
+}
+
+#if IS_ENABLED(CONFIG_IPV6)
+static void
+mlxsw_sp_fib6_entry_offload_failed_set(struct mlxsw_sp *mlxsw_sp,
+				       struct mlxsw_sp_fib_entry *fib_entry)
+{
+	struct mlxsw_sp_fib6_entry *fib6_entry;
+	struct mlxsw_sp_rt6 *mlxsw_sp_rt6;
+
+	fib6_entry = container_of(fib_entry, struct mlxsw_sp_fib6_entry,
+				  common);
+	list_for_each_entry(mlxsw_sp_rt6, &fib6_entry->rt6_list, list)
+		fib6_info_hw_flags_set(mlxsw_sp_net(mlxsw_sp), mlxsw_sp_rt6->rt,
+				       false, false, true);
+}
+#else
+static void
+mlxsw_sp_fib6_entry_offload_failed_set(struct mlxsw_sp *mlxsw_sp,
+				       struct mlxsw_sp_fib_entry *fib_entry)
+{
+}
+#endif
+
+static void
+mlxsw_sp_fib_entry_offload_failed_set(struct mlxsw_sp *mlxsw_sp,
+				      struct mlxsw_sp_fib_entry *fib_entry)
+{
+	switch (fib_entry->fib_node->fib->proto) {
+	case MLXSW_SP_L3_PROTO_IPV4:
+		mlxsw_sp_fib4_entry_offload_failed_set(mlxsw_sp, fib_entry);
+		break;
+	case MLXSW_SP_L3_PROTO_IPV6:
+		mlxsw_sp_fib6_entry_offload_failed_set(mlxsw_sp, fib_entry);
+		break;
+	}
+}
+
+/* Maximum number of RALUE writes in flight in a bulk */
+#define MLXSW_SP_RALUE_BULK_MAX 128
+
+struct mlxsw_sp_ralue_bulk_rec {
+	struct mlxsw_sp_fib_entry *fib_entry; /* NULL if destroyed meanwhile */
+	enum mlxsw_reg_ralue_op op;
+	bool done;
+};
+
+/* Within a bulk, RALUE writes are sent to the device without waiting for
+ * the previous ones to complete. The offload flags of the routes are only
+ * refreshed once their write completed. Protected by the router lock.
+ */
+struct mlxsw_sp_ralue_bulk {
+	struct list_head trans_list;
+	unsigned int depth;
+	unsigned int count;
+	struct mlxsw_sp_ralue_bulk_rec recs[MLXSW_SP_RALUE_BULK_MAX];
+};
+
+static void mlxsw_sp_ralue_bulk_rec_cb(struct mlxsw_core *mlxsw_core,
+				       char *ralue_pl, size_t ralue_pl_len,
+				       unsigned long cb_priv)
+{
+	struct mlxsw_sp_ralue_bulk_rec *rec;
+
+	rec = (struct mlxsw_sp_ralue_bulk_rec *) cb_priv;
+	rec->done = true;
+}
+
+static int mlxsw_sp_ralue_bulk_flush(struct mlxsw_sp *mlxsw_sp)
+{
+	struct mlxsw_sp_ralue_bulk *bulk = mlxsw_sp->router->ralue_bulk;
+	unsigned int i;
+	int err;
+
+	if (!bulk->count)
+		return 0;
+
+	err = mlxsw_reg_trans_bulk_wait(&bulk->trans_list);
+
+	for (i = 0; i < bulk->count; i++) {
+		struct mlxsw_sp_ralue_bulk_rec *rec = &bulk->recs[i];
+
+		if (!rec->fib_entry)
+			continue;
+		if (rec->done)
+			mlxsw_sp_fib_entry_hw_flags_refresh(mlxsw_sp,
+							    rec->fib_entry,
+							    rec->op);
+		else if (rec->op == MLXSW_REG_RALUE_OP_WRITE_WRITE)
+			mlxsw_sp_fib_entry_offload_failed_set(mlxsw_sp,
+							      rec->fib_entry);
+	}
+	bulk->count = 0;
+
+	if (err)
+		dev_warn_ratelimited(mlxsw_sp->bus_info->dev, "Failed to write FIB entries to the device\n");
+
+	return err;
+}
+
+static void mlxsw_sp_ralue_bulk_begin(struct mlxsw_sp *mlxsw_sp)
+{
+	mlxsw_sp->router->ralue_bulk->depth++;
+}
+
+static void mlxsw_sp_ralue_bulk_end(struct mlxsw_sp *mlxsw_sp)
+{
+	struct mlxsw_sp_ralue_bulk *bulk = mlxsw_sp->router->ralue_bulk;
+
+	if (WARN_ON_ONCE(!bulk->depth) || --bulk->depth)
+		return;
+	mlxsw_sp_ralue_bulk_flush(mlxsw_sp);
+}
+
+static void mlxsw_sp_ralue_bulk_forget(struct mlxsw_sp *mlxsw_sp,
+				       struct mlxsw_sp_fib_entry *fib_entry)
+{
+	struct mlxsw_sp_ralue_bulk *bulk = mlxsw_sp->router->ralue_bulk;
+	unsigned int i;
+
+	/* The write itself can still complete, as its payload was copied,
+	 * but the entry must not be touched once it completes.
+	 */
+	for (i = 0; i < bulk->count; i++)
+		if (bulk->recs[i].fib_entry == fib_entry)
+			bulk->recs[i].fib_entry = NULL;
+}
+
+static int mlxsw_sp_fib_entry_ralue_write(struct mlxsw_sp *mlxsw_sp,
+					  struct mlxsw_sp_fib_entry *fib_entry,
+					  enum mlxsw_reg_ralue_op op,
+					  char *ralue_pl)
+{
+	struct mlxsw_sp_ralue_bulk *bulk = mlxsw_sp->router->ralue_bulk;
+	struct mlxsw_sp_ralue_bulk_rec *rec;
+	int err;
+
+	if (!bulk->depth)
+		return mlxsw_reg_write(mlxsw_sp->core, MLXSW_REG(ralue),
+				       ralue_pl);
+
+	if (bulk->count == MLXSW_SP_RALUE_BULK_MAX)
+		mlxsw_sp_ralue_bulk_flush(mlxsw_sp);
+
+	rec = &bulk->recs[bulk->count];
+	rec->fib_entry = fib_entry;
+	rec->op = op;
+	rec->done = false;
+	err = mlxsw_reg_trans_write(mlxsw_sp->core, MLXSW_REG(ralue), ralue_pl,
+				    &bulk->trans_list,
+				    mlxsw_sp_ralue_bulk_rec_cb,
+				    (unsigned long) rec);
+	if (err)
+		return err;
+	bulk->count++;
+
+	return 0;
+}
+
 static void
 mlxsw_sp_fib_entry_ralue_pack(char *ralue_pl,
 			      const struct mlxsw_sp_fib_entry *fib_entry,
@@ -5888,7 +6080,8 @@ static int mlxsw_sp_fib_entry_op_remote(struct mlxsw_sp *mlxsw_sp,
 	mlxsw_sp_fib_entry_ralue_pack(ralue_pl, fib_entry, op);
 	mlxsw_reg_ralue_act_remote_pack(ralue_pl, trap_action, trap_id,
 					adjacency_index, ecmp_size);
-	return mlxsw_reg_write(mlxsw_sp->core, MLXSW_REG(ralue), ralue_pl);
+	return mlxsw_sp_fib_entry_ralue_write(mlxsw_sp, fib_entry, op,
+					      ralue_pl);
 }
 
 static int mlxsw_sp_fib_entry_op_local(struct mlxsw_sp *mlxsw_sp,
@@ -5912,7 +6105,8 @@ static int mlxsw_sp_fib_entry_op_local(struct mlxsw_sp *mlxsw_sp,
 	mlxsw_sp_fib_entry_ralue_pack(ralue_pl, fib_entry, op);
 	mlxsw_reg_ralue_act_local_pack(ralue_pl, trap_action, trap_id,
 				       rif_index);
-	return mlxsw_reg_write(mlxsw_sp->core, MLXSW_REG(ralue), ralue_pl);
+	return mlxsw_sp_fib_entry_ralue_write(mlxsw_sp, fib_entry, op,
+					      ralue_pl);
 }
 
 static int mlxsw_sp_fib_entry_op_trap(struct mlxsw_sp *mlxsw_sp,
@@ -5923,7 +6117,8 @@ static int mlxsw_sp_fib_entry_op_trap(struct mlxsw_sp *mlxsw_sp,
 
 	mlxsw_sp_fib_entry_ralue_pack(ralue_pl, fib_entry, op);
 	mlxsw_reg_ralue_act_ip2me_pack(ralue_pl);
-	return mlxsw_reg_write(mlxsw_sp->core, MLXSW_REG(ralue), ralue_pl);
+	return mlxsw_sp_fib_entry_ralue_write(mlxsw_sp, fib_entry, op,
+					      ralue_pl);
 }
 
 static int mlxsw_sp_fib_entry_op_blackhole(struct mlxsw_sp *mlxsw_sp,
@@ -5936,7 +6131,8 @@ static int mlxsw_sp_fib_entry_op_blackhole(struct mlxsw_sp *mlxsw_sp,
 	trap_action = MLXSW_REG_RALUE_TRAP_ACTION_DISCARD_ERROR;
 	mlxsw_sp_fib_entry_ralue_pack(ralue_pl, fib_entry, op);
 	mlxsw_reg_ralue_act_local_pack(ralue_pl, trap_action, 0, 0);
-	return mlxsw_reg_write(mlxsw_sp->core, MLXSW_REG(ralue), ralue_pl);
+	return mlxsw_sp_fib_entry_ralue_write(mlxsw_sp, fib_entry, op,
+					      ralue_pl);
 }
 
 static int
@@ -5953,7 +6149,8 @@ mlxsw_sp_fib_entry_op_unreachable(struct mlxsw_sp *mlxsw_sp,
 
 	mlxsw_sp_fib_entry_ralue_pack(ralue_pl, fib_entry, op);
 	mlxsw_reg_ralue_act_local_pack(ralue_pl, trap_action, trap_id, 0);
-	return mlxsw_reg_write(mlxsw_sp->core, MLXSW_REG(ralue), ralue_pl);
+	return mlxsw_sp_fib_entry_ralue_write(mlxsw_sp, fib_entry, op,
+					      ralue_pl);
 }
 
 static int
@@ -5978,7 +6175,8 @@ mlxsw_sp_fib_entry_op_ipip_decap(struct mlxsw_sp *mlxsw_sp,
 	mlxsw_sp_fib_entry_ralue_pack(ralue_pl, fib_entry, op);
 	mlxsw_reg_ralue_act_ip2me_tun_pack(ralue_pl,
 					   fib_entry->decap.tunnel_index);
-	return mlxsw_reg_write(mlxsw_sp->core, MLXSW_REG(ralue), ralue_pl);
+	return mlxsw_sp_fib_entry_ralue_write(mlxsw_sp, fib_entry, op,
+					      ralue_pl);
 }
 
 static int mlxsw_sp_fib_entry_op_nve_decap(struct mlxsw_sp *mlxsw_sp,
@@ -5990,7 +6188,8 @@ static int mlxsw_sp_fib_entry_op_nve_decap(struct mlxsw_sp *mlxsw_sp,
 	mlxsw_sp_fib_entry_ralue_pack(ralue_pl, fib_entry, op);
 	mlxsw_reg_ralue_act_ip2me_tun_pack(ralue_pl,
 					   fib_entry->decap.tunnel_index);
-	return mlxsw_reg_write(mlxsw_sp->core, MLXSW_REG(ralue), ralue_pl);
+	return mlxsw_sp_fib_entry_ralue_write(mlxsw_sp, fib_entry, op,
+					      ralue_pl);
 }
 
 static int __mlxsw_sp_fib_entry_op(struct mlxsw_sp *mlxsw_sp,
@@ -6027,7 +6226,9 @@ static int mlxsw_sp_fib_entry_op(struct mlxsw_sp *mlxsw_sp,
 	if (err)
 		return err;
 
-	mlxsw_sp_fib_entry_hw_flags_refresh(mlxsw_sp, fib_entry, op);
+	/* Pipelined writes are refreshed once they complete */
+	if (!mlxsw_sp->router->ralue_bulk->depth)
+		mlxsw_sp_fib_entry_hw_flags_refresh(mlxsw_sp, fib_entry, op);
 
 	return err;
 }
@@ -6175,6 +6376,7 @@ static void mlxsw_sp_fib4_entry_destroy(struct mlxsw_sp *mlxsw_sp,
 {
 	struct mlxsw_sp_fib_node *fib_node = fib4_entry->common.fib_node;
 
+	mlxsw_sp_ralue_bulk_forget(mlxsw_sp, &fib4_entry->common);
 	fib_info_put(fib4_entry->fi);
 	mlxsw_sp_fib4_entry_type_unset(mlxsw_sp, fib4_entry);
 	mlxsw_sp_nexthop_group_vr_unlink(fib4_entry->common.nh_group,
@@ -7089,6 +7291,7 @@ static void mlxsw_sp_fib6_entry_destroy(struct mlxsw_sp *mlxsw_sp,
 {
 	struct mlxsw_sp_fib_node *fib_node = fib6_entry->common.fib_node;
 
+	mlxsw_sp_ralue_bulk_forget(mlxsw_sp, &fib6_entry->common);
 	mlxsw_sp_fib6_entry_type_unset(mlxsw_sp, fib6_entry);
 	mlxsw_sp_nexthop_group_vr_unlink(fib6_entry->common.nh_group,
 					 fib_node->fib);
@@ -7450,7 +7653,7 @@ struct mlxsw_sp_fib6_event_work {
 };
 
 struct mlxsw_sp_fib_event_work {
-	struct work_struct work;
+	struct list_head list; /* Member of router's FIB event queue */
 	union {
 		struct mlxsw_sp_fib6_event_work fib6_work;
 		struct fib_entry_notifier_info fen_info;
@@ -7461,6 +7664,7 @@ struct mlxsw_sp_fib_event_work {
 	};
 	struct mlxsw_sp *mlxsw_sp;
 	unsigned long event;
+	int family;
 };
 
 static int
@@ -7511,16 +7715,12 @@ mlxsw_sp_router_fib6_work_fini(struct mlxsw_sp_fib6_event_work *fib6_work)
 	kfree(fib6_work->rt_arr);
 }
 
-static void mlxsw_sp_router_fib4_event_work(struct work_struct *work)
+static void
+mlxsw_sp_router_fib4_event_process(struct mlxsw_sp *mlxsw_sp,
+				   struct mlxsw_sp_fib_event_work *fib_work)
 {
-	struct mlxsw_sp_fib_event_work *fib_work =
-		container_of(work, struct mlxsw_sp_fib_event_work, work);
-	struct mlxsw_sp *mlxsw_sp = fib_work->mlxsw_sp;
 	int err;
 
-	mutex_lock(&mlxsw_sp->router->lock);
-	mlxsw_sp_span_respin(mlxsw_sp);
-
 	switch (fib_work->event) {
 	case FIB_EVENT_ENTRY_REPLACE:
 		err = mlxsw_sp_router_fib4_replace(mlxsw_sp,
@@ -7543,21 +7743,15 @@ static void mlxsw_sp_router_fib4_event_work(struct work_struct *work)
 		fib_info_put(fib_work->fnh_info.fib_nh->nh_parent);
 		break;
 	}
-	mutex_unlock(&mlxsw_sp->router->lock);
-	kfree(fib_work);
 }
 
-static void mlxsw_sp_router_fib6_event_work(struct work_struct *work)
+static void
+mlxsw_sp_router_fib6_event_process(struct mlxsw_sp *mlxsw_sp,
+				   struct mlxsw_sp_fib_event_work *fib_work)
 {
-	struct mlxsw_sp_fib_event_work *fib_work =
-		    container_of(work, struct mlxsw_sp_fib_event_work, work);
 	struct mlxsw_sp_fib6_event_work *fib6_work = &fib_work->fib6_work;
-	struct mlxsw_sp *mlxsw_sp = fib_work->mlxsw_sp;
 	int err;
 
-	mutex_lock(&mlxsw_sp->router->lock);
-	mlxsw_sp_span_respin(mlxsw_sp);
-
 	switch (fib_work->event) {
 	case FIB_EVENT_ENTRY_REPLACE:
 		err = mlxsw_sp_router_fib6_replace(mlxsw_sp,
@@ -7590,20 +7784,15 @@ static void mlxsw_sp_router_fib6_event_work(struct work_struct *work)
 		mlxsw_sp_router_fib6_work_fini(fib6_work);
 		break;
 	}
-	mutex_unlock(&mlxsw_sp->router->lock);
-	kfree(fib_work);
 }
 
-static void mlxsw_sp_router_fibmr_event_work(struct work_struct *work)
+static void
+mlxsw_sp_router_fibmr_event_process(struct mlxsw_sp *mlxsw_sp,
+				    struct mlxsw_sp_fib_event_work *fib_work)
 {
-	struct mlxsw_sp_fib_event_work *fib_work =
-		container_of(work, struct mlxsw_sp_fib_event_work, work);
-	struct mlxsw_sp *mlxsw_sp = fib_work->mlxsw_sp;
 	bool replace;
 	int err;
 
-	rtnl_lock();
-	mutex_lock(&mlxsw_sp->router->lock);
 	switch (fib_work->event) {
 	case FIB_EVENT_ENTRY_REPLACE:
 	case FIB_EVENT_ENTRY_ADD:
@@ -7632,9 +7821,92 @@ static void mlxsw_sp_router_fibmr_event_work(struct work_struct *work)
 		dev_put(fib_work->ven_info.dev);
 		break;
 	}
+}
+
+static bool
+mlxsw_sp_router_fib_event_is_mr(const struct mlxsw_sp_fib_event_work *fib_work)
+{
+	return fib_work->family == RTNL_FAMILY_IPMR ||
+	       fib_work->family == RTNL_FAMILY_IP6MR;
+}
+
+static void
+mlxsw_sp_router_fib_event_lock(struct mlxsw_sp *mlxsw_sp, bool rtnl)
+{
+	if (rtnl)
+		rtnl_lock();
+	mutex_lock(&mlxsw_sp->router->lock);
+	mlxsw_sp_ralue_bulk_begin(mlxsw_sp);
+}
+
+static void
+mlxsw_sp_router_fib_event_unlock(struct mlxsw_sp *mlxsw_sp, bool rtnl)
+{
+	mlxsw_sp_ralue_bulk_end(mlxsw_sp);
 	mutex_unlock(&mlxsw_sp->router->lock);
-	rtnl_unlock();
-	kfree(fib_work);
+	if (rtnl)
+		rtnl_unlock();
+}
+
+/* Number of FIB events processed before the locks are released */
+#define MLXSW_SP_ROUTER_FIB_EVENT_BATCH 1024
+
+/* FIB notifications are queued and processed in batches, so that the route
+ * updates of a batch are written to the device in a pipelined manner rather
+ * than one at a time.
+ */
+static void mlxsw_sp_router_fib_event_work(struct work_struct *work)
+{
+	struct mlxsw_sp_router *router =
+		container_of(work, struct mlxsw_sp_router,
+			     fib_event_queue.work);
+	struct mlxsw_sp_fib_event_work *fib_work, *tmp;
+	struct mlxsw_sp *mlxsw_sp = router->mlxsw_sp;
+	unsigned int processed = 0;
+	LIST_HEAD(fib_event_list);
+	bool rtnl = false;
+
+	spin_lock_bh(&router->fib_event_queue.lock);
+	list_splice_init(&router->fib_event_queue.list, &fib_event_list);
+	spin_unlock_bh(&router->fib_event_queue.lock);
+
+	/* Multicast routes are programmed under RTNL */
+	list_for_each_entry(fib_work, &fib_event_list, list) {
+		if (mlxsw_sp_router_fib_event_is_mr(fib_work)) {
+			rtnl = true;
+			break;
+		}
+	}
+
+	mlxsw_sp_router_fib_event_lock(mlxsw_sp, rtnl);
+	mlxsw_sp_span_respin(mlxsw_sp);
+
+	list_for_each_entry_safe(fib_work, tmp, &fib_event_list, list) {
+		switch (fib_work->family) {
+		case AF_INET:
+			mlxsw_sp_router_fib4_event_process(mlxsw_sp, fib_work);
+			break;
+		case AF_INET6:
+			mlxsw_sp_router_fib6_event_process(mlxsw_sp, fib_work);
+			break;
+		case RTNL_FAMILY_IP6MR:
+		case RTNL_FAMILY_IPMR:
+			mlxsw_sp_router_fibmr_event_process(mlxsw_sp, fib_work);
+			break;
+		}
+		list_del(&fib_work->list);
+		kfree(fib_work);
+
+		if (++processed % MLXSW_SP_ROUTER_FIB_EVENT_BATCH ||
+		    list_empty(&fib_event_list))
+			continue;
+
+		mlxsw_sp_router_fib_event_unlock(mlxsw_sp, rtnl);
+		cond_resched();
+		mlxsw_sp_router_fib_event_lock(mlxsw_sp, rtnl);
+	}
+
+	mlxsw_sp_router_fib_event_unlock(mlxsw_sp, rtnl);
 }
 
 static void mlxsw_sp_router_fib4_event(struct mlxsw_sp_fib_event_work *fib_work,
@@ -7792,26 +8064,27 @@ static int mlxsw_sp_router_fib_event(struct notifier_block *nb,
 
 	fib_work->mlxsw_sp = router->mlxsw_sp;
 	fib_work->event = event;
+	fib_work->family = info->family;
 
 	switch (info->family) {
 	case AF_INET:
-		INIT_WORK(&fib_work->work, mlxsw_sp_router_fib4_event_work);
 		mlxsw_sp_router_fib4_event(fib_work, info);
 		break;
 	case AF_INET6:
-		INIT_WORK(&fib_work->work, mlxsw_sp_router_fib6_event_work);
 		err = mlxsw_sp_router_fib6_event(fib_work, info);
 		if (err)
 			goto err_fib_event;
 		break;
 	case RTNL_FAMILY_IP6MR:
 	case RTNL_FAMILY_IPMR:
-		INIT_WORK(&fib_work->work, mlxsw_sp_router_fibmr_event_work);
 		mlxsw_sp_router_fibmr_event(fib_work, info);
 		break;
 	}
 
-	mlxsw_core_schedule_work(&fib_work->work);
+	spin_lock_bh(&router->fib_event_queue.lock);
+	list_add_tail(&fib_work->list, &router->fib_event_queue.list);
+	spin_unlock_bh(&router->fib_event_queue.lock);
+	mlxsw_core_schedule_work(&router->fib_event_queue.work);
 
 	return NOTIFY_DONE;
 
@@ -10869,6 +11142,17 @@ int mlxsw_sp_router_init(struct mlxsw_sp *mlxsw_sp,
 	mlxsw_sp->router = router;
 	router->mlxsw_sp = mlxsw_sp;
 
+	router->ralue_bulk = kzalloc(sizeof(*router->ralue_bulk), GFP_KERNEL);
+	if (!router->ralue_bulk) {
+		err = -ENOMEM;
+		goto err_ralue_bulk_alloc;
+	}
+	INIT_LIST_HEAD(&router->ralue_bulk->trans_list);
+	INIT_LIST_HEAD(&router->fib_event_queue.list);
+	spin_lock_init(&router->fib_event_queue.lock);
+	INIT_WORK(&router->fib_event_queue.work,
+		  mlxsw_sp_router_fib_event_work);
+
 	err = mlxsw_sp->router_ops->init(mlxsw_sp);
 	if (err)
 		goto err_router_ops_init;
@@ -11029,6 +11313,8 @@ int mlxsw_sp_router_init(struct mlxsw_sp *mlxsw_sp,
 err_router_init:
 	cancel_delayed_work_sync(&mlxsw_sp->router->nh_grp_activity_dw);
 err_router_ops_init:
+	kfree(mlxsw_sp->router->ralue_bulk);
+err_ralue_bulk_alloc:
 	mutex_destroy(&mlxsw_sp->router->lock);
 	kfree(mlxsw_sp->router);
 	return err;
@@ -11062,6 +11348,8 @@ void mlxsw_sp_router_fini(struct mlxsw_sp *mlxsw_sp)
 	mlxsw_sp_ipips_fini(mlxsw_sp);
 	__mlxsw_sp_router_fini(mlxsw_sp);
 	cancel_delayed_work_sync(&router->nh_grp_activity_dw);
+	WARN_ON(!list_empty(&router->fib_event_queue.list));
+	kfree(router->ralue_bulk);
 	mutex_destroy(&router->lock);
 	kfree(router);
 }
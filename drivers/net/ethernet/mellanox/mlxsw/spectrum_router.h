@@ -60,6 +60,12 @@ struct mlxsw_sp_router {
 	struct mlxsw_sp_router_nve_decap nve_decap_config;
 	struct mutex lock; /* Protects shared router resources */
 	struct mlxsw_sp_fib_entry_op_ctx *ll_op_ctx;
+	struct {
+		struct list_head list;
+		spinlock_t lock; /* Protects the list */
+		struct work_struct work;
+	} fib_event_queue;
+	struct mlxsw_sp_ralue_bulk *ralue_bulk;
 	struct mlxsw_sp_crif *lb_crif;
 	const struct mlxsw_sp_adj_grp_size_range *adj_grp_size_ranges;
 	size_t adj_grp_size_ranges_count;
@@ -1246,12 +1246,49 @@ static int tap_sendmsg(struct socket *sock, struct msghdr *m,
 			    m->msg_flags & MSG_DONTWAIT);
 }
 
+static int tap_recv_batch(struct tap_queue *q, struct tun_recv_buf *bufs,
+			  int num)
+{
+	int n;
+
+	for (n = 0; n < num; n++) {
+		struct tun_recv_buf *buf = &bufs[n];
+		struct sk_buff *skb = buf->ptr;
+		size_t len = iov_iter_count(&buf->iter);
+
+		buf->ret = tap_put_user(q, skb, &buf->iter);
+		if (unlikely(buf->ret < 0)) {
+			kfree_skb(skb);
+			return n + 1;
+		}
+		consume_skb(skb);
+		if (unlikely(buf->ret != len))
+			return n + 1;
+	}
+
+	return n;
+}
+
 static int tap_recvmsg(struct socket *sock, struct msghdr *m,
 		       size_t total_len, int flags)
 {
 	struct tap_queue *q = container_of(sock, struct tap_queue, sock);
+	struct tun_msg_ctl *ctl = m->msg_control;
 	struct sk_buff *skb = m->msg_control;
-	int ret;
+	int ret, i;
+
+	if (m->msg_controllen == sizeof(struct tun_msg_ctl) &&
+	    ctl && ctl->type == TUN_MSG_PTR) {
+		struct tun_recv_buf *bufs = ctl->ptr;
+
+		if (flags & ~(MSG_DONTWAIT|MSG_TRUNC)) {
+			for (i = 0; i < ctl->num; i++)
+				kfree_skb(bufs[i].ptr);
+			return -EINVAL;
+		}
+		return tap_recv_batch(q, bufs, ctl->num);
+	}
+
 	if (flags & ~(MSG_DONTWAIT|MSG_TRUNC)) {
 		kfree_skb(skb);
 		return -EINVAL;
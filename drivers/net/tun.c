@@ -2267,6 +2267,79 @@ static ssize_t tun_chr_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	return ret;
 }
 
+/* TUNSENDMMSG and TUNRECVMMSG: write or read a batch of packets */
+static long tun_chr_mmsg(struct file *file, unsigned int cmd,
+			 void __user *argp)
+{
+	struct tun_file *tfile = file->private_data;
+	int noblock = !!(file->f_flags & O_NONBLOCK);
+	struct tun_mmsg_pkt __user *upkts;
+	struct tun_struct *tun;
+	struct tun_mmsg mmsg;
+	unsigned int done;
+	bool more = false;
+	ssize_t ret = 0;
+
+	if (copy_from_user(&mmsg, argp, sizeof(mmsg)))
+		return -EFAULT;
+	if (mmsg.flags)
+		return -EINVAL;
+	mmsg.count = min_t(u32, mmsg.count, UIO_MAXIOV);
+	upkts = u64_to_user_ptr(mmsg.pkts);
+
+	tun = tun_get(tfile);
+	if (!tun)
+		return -EBADFD;
+
+	for (done = 0; done < mmsg.count; done++) {
+		struct iovec iovstack[UIO_FASTIOV], *iov = iovstack;
+		struct tun_mmsg_pkt pkt;
+		struct iov_iter iter;
+		size_t len;
+
+		if (copy_from_user(&pkt, &upkts[done], sizeof(pkt))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = import_iovec(cmd == TUNSENDMMSG ? ITER_SOURCE : ITER_DEST,
+				   u64_to_user_ptr(pkt.iov), pkt.iovlen,
+				   UIO_FASTIOV, &iov, &iter);
+		if (ret < 0)
+			break;
+
+		len = iov_iter_count(&iter);
+		if (cmd == TUNSENDMMSG) {
+			ret = tun_get_user(tun, tfile, NULL, &iter, noblock,
+					   done + 1 < mmsg.count);
+			if (ret >= 0)
+				more = done + 1 < mmsg.count;
+		} else {
+			ret = tun_do_read(tun, tfile, &iter, noblock || done,
+					  NULL);
+		}
+		kfree(iov);
+		if (ret < 0)
+			break;
+
+		if (put_user(min_t(size_t, ret, len), &upkts[done].len)) {
+			ret = -EFAULT;
+			done++;
+			break;
+		}
+	}
+
+	/* The batch stopped early: don't leave queued packets unpolled */
+	if (more && tfile->napi_enabled) {
+		local_bh_disable();
+		napi_schedule(&tfile->napi);
+		local_bh_enable();
+	}
+
+	tun_put(tun);
+	return done ? done : ret;
+}
+
 static void tun_prog_free(struct rcu_head *rcu)
 {
 	struct tun_prog *prog = container_of(rcu, struct tun_prog, rcu);
@@ -2599,14 +2672,75 @@ static int tun_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len)
 	return ret;
 }
 
+static void tun_recv_bufs_free(struct tun_recv_buf *bufs, int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		tun_ptr_free(bufs[i].ptr);
+}
+
+static int tun_recv_batch(struct tun_struct *tun, struct tun_file *tfile,
+			  struct tun_recv_buf *bufs, int num)
+{
+	struct xdp_frame_bulk bq;
+	int i, n;
+
+	for (n = 0; n < num; n++) {
+		struct tun_recv_buf *buf = &bufs[n];
+		size_t len = iov_iter_count(&buf->iter);
+
+		if (tun_is_xdp_frame(buf->ptr)) {
+			buf->ret = tun_put_user_xdp(tun, tfile,
+						    tun_ptr_to_xdp(buf->ptr),
+						    &buf->iter);
+		} else {
+			struct sk_buff *skb = buf->ptr;
+
+			buf->ret = tun_put_user(tun, tfile, skb, &buf->iter);
+			if (unlikely(buf->ret < 0))
+				kfree_skb(skb);
+			else
+				consume_skb(skb);
+		}
+
+		if (unlikely(buf->ret != len)) {
+			n++;
+			break;
+		}
+	}
+
+	/* Give back the XDP frames to their memory model in bulk */
+	xdp_frame_bulk_init(&bq);
+	rcu_read_lock();
+	for (i = 0; i < n; i++) {
+		if (tun_is_xdp_frame(bufs[i].ptr))
+			xdp_return_frame_bulk(tun_ptr_to_xdp(bufs[i].ptr), &bq);
+	}
+	xdp_flush_frame_bulk(&bq);
+	rcu_read_unlock();
+
+	return n;
+}
+
 static int tun_recvmsg(struct socket *sock, struct msghdr *m, size_t total_len,
 		       int flags)
 {
 	struct tun_file *tfile = container_of(sock, struct tun_file, socket);
 	struct tun_struct *tun = tun_get(tfile);
+	struct tun_msg_ctl *ctl = m->msg_control;
 	void *ptr = m->msg_control;
+	struct tun_recv_buf *bufs = NULL;
+	int num = 0;
 	int ret;
 
+	if (m->msg_controllen == sizeof(struct tun_msg_ctl) &&
+	    ctl && ctl->type == TUN_MSG_PTR) {
+		bufs = ctl->ptr;
+		num = ctl->num;
+		ptr = NULL;
+	}
+
 	if (!tun) {
 		ret = -EBADFD;
 		goto out_free;
@@ -2621,6 +2755,10 @@ static int tun_recvmsg(struct socket *sock, struct msghdr *m, size_t total_len,
 					 SOL_PACKET, TUN_TX_TIMESTAMP);
 		goto out;
 	}
+	if (bufs) {
+		ret = tun_recv_batch(tun, tfile, bufs, num);
+		goto out;
+	}
 	ret = tun_do_read(tun, tfile, &m->msg_iter, flags & MSG_DONTWAIT, ptr);
 	if (ret > (ssize_t)total_len) {
 		m->msg_flags |= MSG_TRUNC;
@@ -2633,7 +2771,10 @@ static int tun_recvmsg(struct socket *sock, struct msghdr *m, size_t total_len,
 out_put_tun:
 	tun_put(tun);
 out_free:
-	tun_ptr_free(ptr);
+	if (bufs)
+		tun_recv_bufs_free(bufs, num);
+	else
+		tun_ptr_free(ptr);
 	return ret;
 }
 
@@ -3094,6 +3235,8 @@ static long __tun_chr_ioctl(struct file *file, unsigned int cmd,
 				TUN_FEATURES, (unsigned int __user*)argp);
 	} else if (cmd == TUNSETQUEUE) {
 		return tun_set_queue(file, &ifr);
+	} else if (cmd == TUNSENDMMSG || cmd == TUNRECVMMSG) {
+		return tun_chr_mmsg(file, cmd, argp);
 	} else if (cmd == SIOCGSKNS) {
 		if (!ns_capable(net->user_ns, CAP_NET_ADMIN))
 			return -EPERM;
@@ -3410,6 +3553,8 @@ static long tun_chr_compat_ioctl(struct file *file,
 	case TUNSETSNDBUF:
 	case SIOCGIFHWADDR:
 	case SIOCSIFHWADDR:
+	case TUNSENDMMSG:
+	case TUNRECVMMSG:
 		arg = (unsigned long)compat_ptr(arg);
 		break;
 	default:
@@ -47,6 +47,8 @@ struct veth_stats {
 	u64	xdp_drops;
 	u64	xdp_tx;
 	u64	xdp_tx_err;
+	u64	xdp_skb_copy;
+	u64	xdp_skb_copy_bytes;
 	u64	peer_tq_xdp_xmit;
 	u64	peer_tq_xdp_xmit_err;
 };
@@ -101,6 +103,8 @@ static const struct veth_q_stat_desc veth_rq_stats_desc[] = {
 	{ "xdp_drops",		VETH_RQ_STAT(xdp_drops) },
 	{ "xdp_tx",		VETH_RQ_STAT(xdp_tx) },
 	{ "xdp_tx_errors",	VETH_RQ_STAT(xdp_tx_err) },
+	{ "xdp_skb_copy",	VETH_RQ_STAT(xdp_skb_copy) },
+	{ "xdp_skb_copy_bytes",	VETH_RQ_STAT(xdp_skb_copy_bytes) },
 };
 
 #define VETH_RQ_STATS_LEN	ARRAY_SIZE(veth_rq_stats_desc)
@@ -728,7 +732,8 @@ static void veth_xdp_get(struct xdp_buff *xdp)
 
 static int veth_convert_skb_to_xdp_buff(struct veth_rq *rq,
 					struct xdp_buff *xdp,
-					struct sk_buff **pskb)
+					struct sk_buff **pskb,
+					struct veth_stats *stats)
 {
 	struct sk_buff *skb = *pskb;
 	u32 frame_sz;
@@ -752,6 +757,9 @@ static int veth_convert_skb_to_xdp_buff(struct veth_rq *rq,
 		if (skb->len > PAGE_SIZE * MAX_SKB_FRAGS + max_head_size)
 			goto drop;
 
+		stats->xdp_skb_copy++;
+		stats->xdp_skb_copy_bytes += skb->len;
+
 		/* Allocate skb head */
 		page = page_pool_dev_alloc_pages(rq->page_pool);
 		if (!page)
@@ -849,7 +857,7 @@ static struct sk_buff *veth_xdp_rcv_skb(struct veth_rq *rq,
 	}
 
 	__skb_push(skb, skb->data - skb_mac_header(skb));
-	if (veth_convert_skb_to_xdp_buff(rq, xdp, &skb))
+	if (veth_convert_skb_to_xdp_buff(rq, xdp, &skb, stats))
 		goto drop;
 	vxbuf.skb = skb;
 
@@ -991,6 +999,8 @@ static int veth_xdp_rcv(struct veth_rq *rq, int budget,
 	rq->stats.vs.xdp_drops += stats->xdp_drops;
 	rq->stats.vs.rx_drops += stats->rx_drops;
 	rq->stats.vs.xdp_packets += done;
+	rq->stats.vs.xdp_skb_copy += stats->xdp_skb_copy;
+	rq->stats.vs.xdp_skb_copy_bytes += stats->xdp_skb_copy_bytes;
 	u64_stats_update_end(&rq->stats.syncp);
 
 	return done;
@@ -1591,9 +1601,28 @@ static int veth_set_features(struct net_device *dev,
 	return 0;
 }
 
+/* Both ends of the pair advertise the larger of the headroom requested for
+ * them. While either end runs XDP, also ask for the XDP headroom, so that the
+ * skbs sent to it don't have to be copied into a page_pool page before the
+ * program can run.
+ */
+static void veth_update_headroom(struct net_device *dev,
+				 struct net_device *peer)
+{
+	struct veth_priv *peer_priv = netdev_priv(peer);
+	struct veth_priv *priv = netdev_priv(dev);
+	unsigned int new_hr;
+
+	new_hr = max(priv->requested_headroom, peer_priv->requested_headroom);
+	if (priv->_xdp_prog || peer_priv->_xdp_prog)
+		new_hr = max_t(unsigned int, new_hr, VETH_XDP_HEADROOM);
+	dev->needed_headroom = new_hr;
+	peer->needed_headroom = new_hr;
+}
+
 static void veth_set_rx_headroom(struct net_device *dev, int new_hr)
 {
-	struct veth_priv *peer_priv, *priv = netdev_priv(dev);
+	struct veth_priv *priv = netdev_priv(dev);
 	struct net_device *peer;
 
 	if (new_hr < 0)
@@ -1604,11 +1633,8 @@ static void veth_set_rx_headroom(struct net_device *dev, int new_hr)
 	if (unlikely(!peer))
 		goto out;
 
-	peer_priv = netdev_priv(peer);
 	priv->requested_headroom = new_hr;
-	new_hr = max(priv->requested_headroom, peer_priv->requested_headroom);
-	dev->needed_headroom = new_hr;
-	peer->needed_headroom = new_hr;
+	veth_update_headroom(dev, peer);
 
 out:
 	rcu_read_unlock();
@@ -1686,8 +1712,10 @@ static int veth_xdp_set(struct net_device *dev, struct bpf_prog *prog,
 		bpf_prog_put(old_prog);
 	}
 
-	if ((!!old_prog ^ !!prog) && peer)
+	if ((!!old_prog ^ !!prog) && peer) {
+		veth_update_headroom(dev, peer);
 		netdev_update_features(peer);
+	}
 
 	return 0;
 err:
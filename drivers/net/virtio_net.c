@@ -17,6 +17,7 @@
 #include <linux/slab.h>
 #include <linux/cpu.h>
 #include <linux/average.h>
+#include <linux/dim.h>
 #include <linux/filter.h>
 #include <linux/kernel.h>
 #include <net/route.h>
@@ -86,6 +87,7 @@ struct virtnet_sq_stats {
 	u64 xdp_tx_drops;
 	u64 kicks;
 	u64 tx_timeouts;
+	u64 dim_updates;
 };
 
 struct virtnet_rq_stats {
@@ -98,6 +100,7 @@ struct virtnet_rq_stats {
 	u64 xdp_redirects;
 	u64 xdp_drops;
 	u64 kicks;
+	u64 dim_updates;
 };
 
 #define VIRTNET_SQ_STAT(m)	offsetof(struct virtnet_sq_stats, m)
@@ -110,6 +113,7 @@ static const struct virtnet_stat_desc virtnet_sq_stats_desc[] = {
 	{ "xdp_tx_drops",	VIRTNET_SQ_STAT(xdp_tx_drops) },
 	{ "kicks",		VIRTNET_SQ_STAT(kicks) },
 	{ "tx_timeouts",	VIRTNET_SQ_STAT(tx_timeouts) },
+	{ "dim_updates",	VIRTNET_SQ_STAT(dim_updates) },
 };
 
 static const struct virtnet_stat_desc virtnet_rq_stats_desc[] = {
@@ -121,6 +125,7 @@ static const struct virtnet_stat_desc virtnet_rq_stats_desc[] = {
 	{ "xdp_redirects",	VIRTNET_RQ_STAT(xdp_redirects) },
 	{ "xdp_drops",		VIRTNET_RQ_STAT(xdp_drops) },
 	{ "kicks",		VIRTNET_RQ_STAT(kicks) },
+	{ "dim_updates",	VIRTNET_RQ_STAT(dim_updates) },
 };
 
 #define VIRTNET_SQ_STATS_LEN	ARRAY_SIZE(virtnet_sq_stats_desc)
@@ -143,6 +148,14 @@ struct send_queue {
 
 	/* Record whether sq is in reset state. */
 	bool reset;
+
+	/* Adaptive moderation, VIRTIO_NET_F_VQ_NOTF_COAL only */
+	struct dim dim;
+	u16 calls;
+
+	/* Notification coalescing currently programmed for this queue */
+	u32 coal_usecs;
+	u32 coal_max_packets;
 };
 
 /* Internal representation of a receive virtqueue */
@@ -156,6 +169,14 @@ struct receive_queue {
 
 	struct virtnet_rq_stats stats;
 
+	/* Adaptive moderation, VIRTIO_NET_F_VQ_NOTF_COAL only */
+	struct dim dim;
+	u16 calls;
+
+	/* Notification coalescing currently programmed for this queue */
+	u32 coal_usecs;
+	u32 coal_max_packets;
+
 	/* Chain pages by the private ptr. */
 	struct page *pages;
 
@@ -207,6 +228,7 @@ struct control_buf {
 	struct virtio_net_ctrl_rss rss;
 	struct virtio_net_ctrl_coal_tx coal_tx;
 	struct virtio_net_ctrl_coal_rx coal_rx;
+	struct virtio_net_ctrl_coal_vq coal_vq;
 };
 
 struct virtnet_info {
@@ -286,6 +308,10 @@ struct virtnet_info {
 	u32 tx_max_packets;
 	u32 rx_max_packets;
 
+	/* Adaptive moderation is driving the queues' coalescing */
+	bool rx_dim_enabled;
+	bool tx_dim_enabled;
+
 	unsigned long guest_offloads;
 	unsigned long guest_offloads_capable;
 
@@ -562,14 +588,20 @@ static struct sk_buff *page_to_skb(struct virtnet_info *vi,
 	return skb;
 }
 
+#define VIRTNET_XMIT_BATCH 16
+
 static void free_old_xmit_skbs(struct send_queue *sq, bool in_napi)
 {
-	unsigned int len;
+	void *bufs[VIRTNET_XMIT_BATCH];
 	unsigned int packets = 0;
 	unsigned int bytes = 0;
+	unsigned int i, n;
 	void *ptr;
 
-	while ((ptr = virtqueue_get_buf(sq->vq, &len)) != NULL) {
+again:
+	n = virtqueue_get_bufs(sq->vq, bufs, NULL, VIRTNET_XMIT_BATCH);
+	for (i = 0; i < n; i++) {
+		ptr = bufs[i];
 		if (likely(!is_xdp_frame(ptr))) {
 			struct sk_buff *skb = ptr;
 
@@ -585,6 +617,8 @@ static void free_old_xmit_skbs(struct send_queue *sq, bool in_napi)
 		}
 		packets++;
 	}
+	if (n == VIRTNET_XMIT_BATCH)
+		goto again;
 
 	/* Avoid overhead when no packets have been processed
 	 * happens when called speculatively from start_xmit.
@@ -1946,6 +1980,23 @@ static void virtnet_poll_cleantx(struct receive_queue *rq)
 	}
 }
 
+static void virtnet_rx_dim_update(struct receive_queue *rq)
+{
+	struct dim_sample cur_sample = {};
+	u8 profile_ix = rq->dim.profile_ix;
+
+	/* NAPI is the only writer of the rq stats */
+	dim_update_sample(rq->calls, rq->stats.packets, rq->stats.bytes,
+			  &cur_sample);
+	net_dim(&rq->dim, cur_sample);
+
+	if (rq->dim.profile_ix != profile_ix) {
+		u64_stats_update_begin(&rq->stats.syncp);
+		rq->stats.dim_updates++;
+		u64_stats_update_end(&rq->stats.syncp);
+	}
+}
+
 static int virtnet_poll(struct napi_struct *napi, int budget)
 {
 	struct receive_queue *rq =
@@ -1957,14 +2008,18 @@ static int virtnet_poll(struct napi_struct *napi, int budget)
 
 	virtnet_poll_cleantx(rq);
 
+	rq->calls++;
 	received = virtnet_receive(rq, budget, &xdp_xmit);
 
 	if (xdp_xmit & VIRTIO_XDP_REDIR)
 		xdp_do_flush();
 
 	/* Out of packets? */
-	if (received < budget)
+	if (received < budget) {
 		virtqueue_napi_complete(napi, rq->vq, received);
+		if (READ_ONCE(vi->rx_dim_enabled))
+			virtnet_rx_dim_update(rq);
+	}
 
 	if (xdp_xmit & VIRTIO_XDP_TX) {
 		sq = virtnet_xdp_get_sq(vi);
@@ -2040,6 +2095,23 @@ static int virtnet_open(struct net_device *dev)
 	return err;
 }
 
+/* Called with the tx lock held, which serializes the sq stats */
+static void virtnet_tx_dim_update(struct send_queue *sq)
+{
+	struct dim_sample cur_sample = {};
+	u8 profile_ix = sq->dim.profile_ix;
+
+	dim_update_sample(sq->calls, sq->stats.packets, sq->stats.bytes,
+			  &cur_sample);
+	net_dim(&sq->dim, cur_sample);
+
+	if (sq->dim.profile_ix != profile_ix) {
+		u64_stats_update_begin(&sq->stats.syncp);
+		sq->stats.dim_updates++;
+		u64_stats_update_end(&sq->stats.syncp);
+	}
+}
+
 static int virtnet_poll_tx(struct napi_struct *napi, int budget)
 {
 	struct send_queue *sq = container_of(napi, struct send_queue, napi);
@@ -2060,6 +2132,10 @@ static int virtnet_poll_tx(struct napi_struct *napi, int budget)
 	virtqueue_disable_cb(sq->vq);
 	free_old_xmit_skbs(sq, true);
 
+	sq->calls++;
+	if (READ_ONCE(vi->tx_dim_enabled))
+		virtnet_tx_dim_update(sq);
+
 	if (sq->vq->num_free >= 2 + MAX_SKB_FRAGS)
 		netif_tx_wake_queue(txq);
 
@@ -3044,7 +3120,30 @@ static int virtnet_get_link_ksettings(struct net_device *dev,
 static int virtnet_send_notf_coal_cmds(struct virtnet_info *vi,
 				       struct ethtool_coalesce *ec)
 {
+	bool rx_dim = ec->use_adaptive_rx_coalesce;
+	bool tx_dim = ec->use_adaptive_tx_coalesce;
 	struct scatterlist sgs_tx, sgs_rx;
+	int i;
+
+	if ((rx_dim || tx_dim) &&
+	    !virtio_has_feature(vi->vdev, VIRTIO_NET_F_VQ_NOTF_COAL))
+		return -EOPNOTSUPP;
+
+	/* While adaptive moderation owns a direction the static parameters
+	 * can only be changed together with turning it on or off.
+	 */
+	if (rx_dim && vi->rx_dim_enabled &&
+	    (ec->rx_coalesce_usecs != vi->rx_usecs ||
+	     ec->rx_max_coalesced_frames != vi->rx_max_packets))
+		return -EINVAL;
+
+	if (tx_dim && vi->tx_dim_enabled &&
+	    (ec->tx_coalesce_usecs != vi->tx_usecs ||
+	     ec->tx_max_coalesced_frames != vi->tx_max_packets))
+		return -EINVAL;
+
+	if (tx_dim && vi->tx_dim_enabled)
+		goto rx;
 
 	vi->ctrl->coal_tx.tx_usecs = cpu_to_le32(ec->tx_coalesce_usecs);
 	vi->ctrl->coal_tx.tx_max_packets = cpu_to_le32(ec->tx_max_coalesced_frames);
@@ -3059,6 +3158,18 @@ static int virtnet_send_notf_coal_cmds(struct virtnet_info *vi,
 	vi->tx_usecs = ec->tx_coalesce_usecs;
 	vi->tx_max_packets = ec->tx_max_coalesced_frames;
 
+	/* The command applies to all the queues */
+	for (i = 0; i < vi->max_queue_pairs; i++) {
+		vi->sq[i].coal_usecs = vi->tx_usecs;
+		vi->sq[i].coal_max_packets = vi->tx_max_packets;
+	}
+
+rx:
+	WRITE_ONCE(vi->tx_dim_enabled, tx_dim);
+
+	if (rx_dim && vi->rx_dim_enabled)
+		return 0;
+
 	vi->ctrl->coal_rx.rx_usecs = cpu_to_le32(ec->rx_coalesce_usecs);
 	vi->ctrl->coal_rx.rx_max_packets = cpu_to_le32(ec->rx_max_coalesced_frames);
 	sg_init_one(&sgs_rx, &vi->ctrl->coal_rx, sizeof(vi->ctrl->coal_rx));
@@ -3072,15 +3183,98 @@ static int virtnet_send_notf_coal_cmds(struct virtnet_info *vi,
 	vi->rx_usecs = ec->rx_coalesce_usecs;
 	vi->rx_max_packets = ec->rx_max_coalesced_frames;
 
+	for (i = 0; i < vi->max_queue_pairs; i++) {
+		vi->rq[i].coal_usecs = vi->rx_usecs;
+		vi->rq[i].coal_max_packets = vi->rx_max_packets;
+	}
+
+	WRITE_ONCE(vi->rx_dim_enabled, rx_dim);
+
+	return 0;
+}
+
+static int virtnet_send_ctrl_coal_vq_cmd(struct virtnet_info *vi, u16 vqn,
+					 u32 max_usecs, u32 max_packets)
+{
+	struct scatterlist sgs;
+
+	vi->ctrl->coal_vq.vqn = cpu_to_le16(vqn);
+	vi->ctrl->coal_vq.coal.max_usecs = cpu_to_le32(max_usecs);
+	vi->ctrl->coal_vq.coal.max_packets = cpu_to_le32(max_packets);
+	sg_init_one(&sgs, &vi->ctrl->coal_vq, sizeof(vi->ctrl->coal_vq));
+
+	if (!virtnet_send_command(vi, VIRTIO_NET_CTRL_NOTF_COAL,
+				  VIRTIO_NET_CTRL_NOTF_COAL_VQ_SET,
+				  &sgs))
+		return -EINVAL;
+
 	return 0;
 }
 
+/* net_dim() picked a new profile for the queue: the control vq sleeps, so
+ * the matching command is sent from here rather than from NAPI.
+ */
+static void virtnet_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct receive_queue *rq = container_of(dim, struct receive_queue, dim);
+	struct virtnet_info *vi = rq->vq->vdev->priv;
+	struct dim_cq_moder moder;
+
+	/* The control vq buffers are protected by the rtnl lock */
+	rtnl_lock();
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	if (vi->rx_dim_enabled &&
+	    (moder.usec != rq->coal_usecs ||
+	     moder.pkts != rq->coal_max_packets) &&
+	    !virtnet_send_ctrl_coal_vq_cmd(vi, rxq2vq(vq2rxq(rq->vq)),
+					   moder.usec, moder.pkts)) {
+		rq->coal_usecs = moder.usec;
+		rq->coal_max_packets = moder.pkts;
+	}
+	dim->state = DIM_START_MEASURE;
+	rtnl_unlock();
+}
+
+static void virtnet_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct send_queue *sq = container_of(dim, struct send_queue, dim);
+	struct virtnet_info *vi = sq->vq->vdev->priv;
+	struct dim_cq_moder moder;
+
+	rtnl_lock();
+	moder = net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+	if (vi->tx_dim_enabled &&
+	    (moder.usec != sq->coal_usecs ||
+	     moder.pkts != sq->coal_max_packets) &&
+	    !virtnet_send_ctrl_coal_vq_cmd(vi, txq2vq(vq2txq(sq->vq)),
+					   moder.usec, moder.pkts)) {
+		sq->coal_usecs = moder.usec;
+		sq->coal_max_packets = moder.pkts;
+	}
+	dim->state = DIM_START_MEASURE;
+	rtnl_unlock();
+}
+
+/* Must be called without the rtnl lock, the dim works take it */
+static void virtnet_cancel_dim(struct virtnet_info *vi)
+{
+	int i;
+
+	for (i = 0; i < vi->max_queue_pairs; i++) {
+		cancel_work_sync(&vi->rq[i].dim.work);
+		cancel_work_sync(&vi->sq[i].dim.work);
+	}
+}
+
 static int virtnet_coal_params_supported(struct ethtool_coalesce *ec)
 {
 	/* usecs coalescing is supported only if VIRTIO_NET_F_NOTF_COAL
 	 * feature is negotiated.
 	 */
-	if (ec->rx_coalesce_usecs || ec->tx_coalesce_usecs)
+	if (ec->rx_coalesce_usecs || ec->tx_coalesce_usecs ||
+	    ec->use_adaptive_rx_coalesce || ec->use_adaptive_tx_coalesce)
 		return -EOPNOTSUPP;
 
 	if (ec->tx_max_coalesced_frames > 1 ||
@@ -3108,6 +3302,10 @@ static int virtnet_set_coalesce(struct net_device *dev,
 			update_napi = true;
 	}
 
+	/* There are no TX interrupts to moderate without napi_tx */
+	if (ec->use_adaptive_tx_coalesce && !napi_weight)
+		return -EINVAL;
+
 	if (virtio_has_feature(vi->vdev, VIRTIO_NET_F_NOTF_COAL))
 		ret = virtnet_send_notf_coal_cmds(vi, ec);
 	else
@@ -3136,6 +3334,8 @@ static int virtnet_get_coalesce(struct net_device *dev,
 		ec->tx_coalesce_usecs = vi->tx_usecs;
 		ec->tx_max_coalesced_frames = vi->tx_max_packets;
 		ec->rx_max_coalesced_frames = vi->rx_max_packets;
+		ec->use_adaptive_rx_coalesce = vi->rx_dim_enabled;
+		ec->use_adaptive_tx_coalesce = vi->tx_dim_enabled;
 	} else {
 		ec->rx_max_coalesced_frames = 1;
 
@@ -3261,7 +3461,7 @@ static int virtnet_set_rxnfc(struct net_device *dev, struct ethtool_rxnfc *info)
 
 static const struct ethtool_ops virtnet_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_MAX_FRAMES |
-		ETHTOOL_COALESCE_USECS,
+		ETHTOOL_COALESCE_USECS | ETHTOOL_COALESCE_USE_ADAPTIVE,
 	.get_drvinfo = virtnet_get_drvinfo,
 	.get_link = ethtool_op_get_link,
 	.get_ringparam = virtnet_get_ringparam,
@@ -3849,6 +4049,11 @@ static int virtnet_alloc_queues(struct virtnet_info *vi)
 		ewma_pkt_len_init(&vi->rq[i].mrg_avg_pkt_len);
 		sg_init_table(vi->sq[i].sg, ARRAY_SIZE(vi->sq[i].sg));
 
+		INIT_WORK(&vi->rq[i].dim.work, virtnet_rx_dim_work);
+		vi->rq[i].dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		INIT_WORK(&vi->sq[i].dim.work, virtnet_tx_dim_work);
+		vi->sq[i].dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+
 		u64_stats_init(&vi->rq[i].stats.syncp);
 		u64_stats_init(&vi->sq[i].stats.syncp);
 	}
@@ -3952,6 +4157,8 @@ static bool virtnet_validate_features(struct virtio_device *vdev)
 	     VIRTNET_FAIL_ON(vdev, VIRTIO_NET_F_HASH_REPORT,
 			     "VIRTIO_NET_F_CTRL_VQ") ||
 	     VIRTNET_FAIL_ON(vdev, VIRTIO_NET_F_NOTF_COAL,
+			     "VIRTIO_NET_F_CTRL_VQ") ||
+	     VIRTNET_FAIL_ON(vdev, VIRTIO_NET_F_VQ_NOTF_COAL,
 			     "VIRTIO_NET_F_CTRL_VQ"))) {
 		return false;
 	}
@@ -4296,6 +4503,8 @@ static int virtnet_probe(struct virtio_device *vdev)
 
 static void remove_vq_common(struct virtnet_info *vi)
 {
+	virtnet_cancel_dim(vi);
+
 	virtio_reset_device(vi->vdev);
 
 	/* Free unused buffers in both send and recv, if any. */
@@ -4376,6 +4585,7 @@ static struct virtio_device_id id_table[] = {
 	VIRTIO_NET_F_MTU, VIRTIO_NET_F_CTRL_GUEST_OFFLOADS, \
 	VIRTIO_NET_F_SPEED_DUPLEX, VIRTIO_NET_F_STANDBY, \
 	VIRTIO_NET_F_RSS, VIRTIO_NET_F_HASH_REPORT, VIRTIO_NET_F_NOTF_COAL, \
+	VIRTIO_NET_F_VQ_NOTF_COAL, \
 	VIRTIO_NET_F_GUEST_HDRLEN
 
 static unsigned int features[] = {
@@ -494,15 +494,37 @@ void wg_packet_decrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
+	struct wg_peer *peer = NULL;
+	unsigned int batch = 0;
 	struct sk_buff *skb;
 
 	while ((skb = ptr_ring_consume_bh(&queue->ring)) != NULL) {
 		enum packet_state state =
 			likely(decrypt_packet(skb, PACKET_CB(skb)->keypair)) ?
 				PACKET_STATE_CRYPTED : PACKET_STATE_DEAD;
-		wg_queue_enqueue_per_peer_rx(skb, state);
-		if (need_resched())
+
+		/* Consecutive packets mostly belong to the same peer, so only
+		 * kick its napi when the run ends or every so often, rather
+		 * than for each packet. The reference keeps the peer alive
+		 * until then, as in wg_queue_enqueue_per_peer_rx().
+		 */
+		if (PACKET_PEER(skb) != peer || ++batch >= NAPI_POLL_WEIGHT) {
+			if (peer) {
+				napi_schedule(&peer->napi);
+				wg_peer_put(peer);
+			}
+			peer = wg_peer_get(PACKET_PEER(skb));
+			batch = 0;
+		}
+		atomic_set_release(&PACKET_CB(skb)->state, state);
+		if (need_resched()) {
+			napi_schedule(&peer->napi);
 			cond_resched();
+		}
+	}
+	if (peer) {
+		napi_schedule(&peer->napi);
+		wg_peer_put(peer);
 	}
 }
 
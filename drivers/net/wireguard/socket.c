@@ -344,6 +344,11 @@ static void set_sock_opts(struct socket *sock)
 	sock->sk->sk_allocation = GFP_ATOMIC;
 	sock->sk->sk_sndbuf = INT_MAX;
 	sk_set_memalloc(sock->sk);
+	/* Let GRO coalesce the outer UDP flow of a peer. Since the socket
+	 * doesn't accept GSO packets, the UDP layer splits the aggregate
+	 * back into single messages before calling wg_receive().
+	 */
+	udp_sk(sock->sk)->gro_enabled = 1;
 }
 
 int wg_socket_init(struct wg_device *wg, u16 port)
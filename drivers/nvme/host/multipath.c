@@ -17,6 +17,7 @@ MODULE_PARM_DESC(multipath,
 static const char *nvme_iopolicy_names[] = {
 	[NVME_IOPOLICY_NUMA]	= "numa",
 	[NVME_IOPOLICY_RR]	= "round-robin",
+	[NVME_IOPOLICY_ST]	= "service-time",
 };
 
 static int iopolicy = NVME_IOPOLICY_NUMA;
@@ -29,6 +30,8 @@ static int nvme_set_iopolicy(const char *val, const struct kernel_param *kp)
 		iopolicy = NVME_IOPOLICY_NUMA;
 	else if (!strncmp(val, "round-robin", 11))
 		iopolicy = NVME_IOPOLICY_RR;
+	else if (!strncmp(val, "service-time", 12))
+		iopolicy = NVME_IOPOLICY_ST;
 	else
 		return -EINVAL;
 
@@ -43,7 +46,7 @@ static int nvme_get_iopolicy(char *buf, const struct kernel_param *kp)
 module_param_call(iopolicy, nvme_set_iopolicy, nvme_get_iopolicy,
 	&iopolicy, 0644);
 MODULE_PARM_DESC(iopolicy,
-	"Default multipath I/O policy; 'numa' (default) or 'round-robin'");
+	"Default multipath I/O policy; 'numa' (default), 'round-robin' or 'service-time'");
 
 void nvme_mpath_default_iopolicy(struct nvme_subsystem *subsys)
 {
@@ -118,6 +121,8 @@ void nvme_failover_req(struct request *req)
 	blk_steal_bios(&ns->head->requeue_list, req);
 	spin_unlock_irqrestore(&ns->head->requeue_lock, flags);
 
+	if (nvme_req(req)->flags & NVME_MPATH_CNT_ACTIVE)
+		atomic_dec(&ns->st_inflight);
 	blk_mq_end_request(req, 0);
 	kblockd_schedule_work(&ns->head->requeue_work);
 }
@@ -127,6 +132,13 @@ void nvme_mpath_start_request(struct request *rq)
 	struct nvme_ns *ns = rq->q->queuedata;
 	struct gendisk *disk = ns->head->disk;
 
+	if (READ_ONCE(ns->head->subsys->iopolicy) == NVME_IOPOLICY_ST &&
+	    !(nvme_req(rq)->flags & NVME_MPATH_CNT_ACTIVE)) {
+		atomic_inc(&ns->st_inflight);
+		nvme_req(rq)->st_start_ns = ktime_get_ns();
+		nvme_req(rq)->flags |= NVME_MPATH_CNT_ACTIVE;
+	}
+
 	if (!blk_queue_io_stat(disk->queue) || blk_rq_is_passthrough(rq))
 		return;
 
@@ -136,10 +148,35 @@ void nvme_mpath_start_request(struct request *rq)
 }
 EXPORT_SYMBOL_GPL(nvme_mpath_start_request);
 
+/*
+ * Weight of a new latency sample in the per-path EWMA used by the
+ * service-time iopolicy, as a shift: 1/8.
+ */
+#define NVME_ST_EWMA_SHIFT	3
+
+static void nvme_mpath_end_service_time(struct nvme_ns *ns, struct request *rq)
+{
+	u64 lat = ktime_get_ns() - nvme_req(rq)->st_start_ns;
+	u64 ewma = READ_ONCE(ns->st_ewma_ns);
+
+	atomic_dec(&ns->st_inflight);
+
+	/* Concurrent updates may lose a sample, which is fine for an average */
+	if (ewma)
+		ewma = ewma - (ewma >> NVME_ST_EWMA_SHIFT) +
+			(lat >> NVME_ST_EWMA_SHIFT);
+	else
+		ewma = lat;
+	WRITE_ONCE(ns->st_ewma_ns, ewma);
+}
+
 void nvme_mpath_end_request(struct request *rq)
 {
 	struct nvme_ns *ns = rq->q->queuedata;
 
+	if (nvme_req(rq)->flags & NVME_MPATH_CNT_ACTIVE)
+		nvme_mpath_end_service_time(ns, rq);
+
 	if (!(nvme_req(rq)->flags & NVME_MPATH_IO_STATS))
 		return;
 	bdev_end_io_acct(ns->head->disk->part0, req_op(rq),
@@ -329,6 +366,47 @@ static struct nvme_ns *nvme_round_robin_path(struct nvme_ns_head *head,
 	return found;
 }
 
+/*
+ * Predicted service time of a new request on @ns: the time to complete the
+ * requests in flight plus the new one, at the average latency of the path.
+ */
+static u64 nvme_ns_service_time(struct nvme_ns *ns)
+{
+	return (atomic_read(&ns->st_inflight) + 1) *
+		max_t(u64, READ_ONCE(ns->st_ewma_ns), 1);
+}
+
+static struct nvme_ns *nvme_service_time_path(struct nvme_ns_head *head)
+{
+	u64 min_opt = U64_MAX, min_nonopt = U64_MAX, score;
+	struct nvme_ns *opt = NULL, *nonopt = NULL, *ns;
+
+	list_for_each_entry_rcu(ns, &head->list, siblings) {
+		if (nvme_path_is_disabled(ns))
+			continue;
+
+		score = nvme_ns_service_time(ns);
+		switch (ns->ana_state) {
+		case NVME_ANA_OPTIMIZED:
+			if (score < min_opt) {
+				min_opt = score;
+				opt = ns;
+			}
+			break;
+		case NVME_ANA_NONOPTIMIZED:
+			if (score < min_nonopt) {
+				min_nonopt = score;
+				nonopt = ns;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	return opt ? opt : nonopt;
+}
+
 static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 {
 	return ns->ctrl->state == NVME_CTRL_LIVE &&
@@ -340,6 +418,9 @@ inline struct nvme_ns *nvme_find_path(struct nvme_ns_head *head)
 	int node = numa_node_id();
 	struct nvme_ns *ns;
 
+	if (READ_ONCE(head->subsys->iopolicy) == NVME_IOPOLICY_ST)
+		return nvme_service_time_path(head);
+
 	ns = srcu_dereference(head->current_path[node], &head->srcu);
 	if (unlikely(!ns))
 		return __nvme_find_path(head, node);
@@ -831,6 +912,18 @@ static ssize_t ana_state_show(struct device *dev, struct device_attribute *attr,
 }
 DEVICE_ATTR_RO(ana_state);
 
+static ssize_t service_time_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_ns *ns = nvme_get_ns_from_dev(dev);
+
+	return sysfs_emit(buf, "inflight %d latency_ns %llu score %llu\n",
+			  atomic_read(&ns->st_inflight),
+			  READ_ONCE(ns->st_ewma_ns),
+			  nvme_ns_service_time(ns));
+}
+DEVICE_ATTR_RO(service_time);
+
 static int nvme_lookup_ana_group_desc(struct nvme_ctrl *ctrl,
 		struct nvme_ana_group_desc *desc, void *data)
 {
@@ -171,6 +171,7 @@ struct nvme_request {
 	u16			status;
 #ifdef CONFIG_NVME_MULTIPATH
 	unsigned long		start_time;
+	u64			st_start_ns;
 #endif
 	struct nvme_ctrl	*ctrl;
 };
@@ -184,6 +185,7 @@ enum {
 	NVME_REQ_CANCELLED		= (1 << 0),
 	NVME_REQ_USERCMD		= (1 << 1),
 	NVME_MPATH_IO_STATS		= (1 << 2),
+	NVME_MPATH_CNT_ACTIVE		= (1 << 3),
 };
 
 static inline struct nvme_request *nvme_req(struct request *req)
@@ -389,6 +391,7 @@ struct nvme_ctrl {
 enum nvme_iopolicy {
 	NVME_IOPOLICY_NUMA,
 	NVME_IOPOLICY_RR,
+	NVME_IOPOLICY_ST,
 };
 
 struct nvme_subsystem {
@@ -481,6 +484,9 @@ struct nvme_ns {
 #ifdef CONFIG_NVME_MULTIPATH
 	enum nvme_ana_state ana_state;
 	u32 ana_grpid;
+	/* service-time iopolicy: requests in flight, EWMA of their latency */
+	atomic_t st_inflight;
+	u64 st_ewma_ns;
 #endif
 	struct list_head siblings;
 	struct kref kref;
@@ -912,6 +918,7 @@ static inline void nvme_trace_bio_complete(struct request *req)
 extern bool multipath;
 extern struct device_attribute dev_attr_ana_grpid;
 extern struct device_attribute dev_attr_ana_state;
+extern struct device_attribute dev_attr_service_time;
 extern struct device_attribute subsys_attr_iopolicy;
 
 #else
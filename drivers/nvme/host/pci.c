@@ -21,6 +21,7 @@
 #include <linux/mutex.h>
 #include <linux/once.h>
 #include <linux/pci.h>
+#include <linux/sched/cpufreq.h>
 #include <linux/suspend.h>
 #include <linux/t10-pi.h>
 #include <linux/types.h>
@@ -105,6 +106,11 @@ static bool noacpi;
 module_param(noacpi, bool, 0444);
 MODULE_PARM_DESC(noacpi, "disable acpi bios quirks");
 
+static bool adaptive_coalescing;
+module_param(adaptive_coalescing, bool, 0444);
+MODULE_PARM_DESC(adaptive_coalescing,
+	"adapt interrupt coalescing to the completion rate of each vector");
+
 struct nvme_dev;
 struct nvme_queue;
 
@@ -159,6 +165,12 @@ struct nvme_dev {
 	unsigned int nr_allocated_queues;
 	unsigned int nr_write_queues;
 	unsigned int nr_poll_queues;
+
+	/* interrupt coalescing adaptation: */
+	struct delayed_work coal_work;
+	unsigned long coal_stamp;
+	unsigned int coal_level;
+	bool coal_failed;
 };
 
 static int io_queue_depth_set(const char *val, const struct kernel_param *kp)
@@ -204,6 +216,9 @@ struct nvme_queue {
 	u16 qid;
 	u8 cq_phase;
 	u8 sqes;
+	bool coal_on;
+	u32 nr_irq_cqes;
+	u32 coal_last_cqes;
 	unsigned long flags;
 #define NVMEQ_ENABLED		0
 #define NVMEQ_SQ_CMB		1
@@ -1080,8 +1095,11 @@ static irqreturn_t nvme_irq(int irq, void *data)
 {
 	struct nvme_queue *nvmeq = data;
 	DEFINE_IO_COMP_BATCH(iob);
+	int found;
 
-	if (nvme_poll_cq(nvmeq, &iob)) {
+	found = nvme_poll_cq(nvmeq, &iob);
+	if (found) {
+		nvmeq->nr_irq_cqes += found;
 		if (!rq_list_empty(iob.req_list))
 			nvme_pci_complete_batch(&iob);
 		return IRQ_HANDLED;
@@ -1125,6 +1143,8 @@ static int nvme_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
 	found = nvme_poll_cq(nvmeq, iob);
 	spin_unlock(&nvmeq->cq_poll_lock);
 
+	if (found)
+		cpufreq_io_boost_hint();
 	return found;
 }
 
@@ -2680,6 +2700,148 @@ static void nvme_pci_free_ctrl(struct nvme_ctrl *ctrl)
 	kfree(dev);
 }
 
+/*
+ * Interrupt coalescing adaptation.
+ *
+ * The aggregation threshold and time of the Interrupt Coalescing feature are
+ * controller wide, so they are raised only as far as the busiest vector needs
+ * them, while the vectors completing few commands opt out through the
+ * Coalescing Disable bit of the Interrupt Vector Configuration feature and
+ * keep their latency.  Rates are in completions per second and vector.
+ */
+#define NVME_COAL_INTERVAL	msecs_to_jiffies(100)
+#define NVME_IRQ_CONFIG_CD	(1 << 16)
+
+static const struct {
+	u8 thr;		/* 0's based number of entries */
+	u8 time;	/* 100 microsecond units */
+	u32 rate;	/* rate from which the level is used */
+} nvme_coal_levels[] = {
+	{  0, 0,      0 },
+	{  3, 1,  50000 },
+	{  7, 1, 150000 },
+	{ 15, 2, 400000 },
+};
+
+static int nvme_coal_set_error(struct nvme_dev *dev, int ret)
+{
+	/* errors while the controller is being reset are expected */
+	if (dev->ctrl.state != NVME_CTRL_LIVE)
+		return ret;
+
+	dev_warn(dev->ctrl.device,
+		"disabling interrupt coalescing adaptation: %d\n", ret);
+	dev->coal_failed = true;
+	return ret;
+}
+
+static int nvme_coal_set_vector(struct nvme_dev *dev,
+		struct nvme_queue *nvmeq, bool on)
+{
+	u32 dw11 = nvmeq->cq_vector;
+	int ret;
+
+	if (!on)
+		dw11 |= NVME_IRQ_CONFIG_CD;
+	ret = nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_CONFIG, dw11, NULL,
+				0, NULL);
+	if (ret)
+		return nvme_coal_set_error(dev, ret);
+	nvmeq->coal_on = on;
+	return 0;
+}
+
+static int nvme_coal_set_level(struct nvme_dev *dev, unsigned int level)
+{
+	u32 dw11 = nvme_coal_levels[level].thr |
+		   nvme_coal_levels[level].time << 8;
+	int ret;
+
+	ret = nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_COALESCE, dw11, NULL,
+				0, NULL);
+	if (ret)
+		return nvme_coal_set_error(dev, ret);
+	dev->coal_level = level;
+	return 0;
+}
+
+static void nvme_coal_work(struct work_struct *work)
+{
+	struct nvme_dev *dev =
+		container_of(to_delayed_work(work), struct nvme_dev, coal_work);
+	unsigned long elapsed = max(jiffies - dev->coal_stamp, 1UL);
+	unsigned int level = dev->coal_level;
+	u64 rate, max_rate = 0;
+	int i;
+
+	if (dev->ctrl.state != NVME_CTRL_LIVE)
+		return;
+	dev->coal_stamp = jiffies;
+
+	for (i = 1; i < dev->online_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+		u32 cqes = READ_ONCE(nvmeq->nr_irq_cqes);
+		bool on;
+
+		if (test_bit(NVMEQ_POLLED, &nvmeq->flags))
+			continue;
+
+		rate = div_u64((u64)(cqes - nvmeq->coal_last_cqes) * HZ,
+			       elapsed);
+		nvmeq->coal_last_cqes = cqes;
+		max_rate = max(max_rate, rate);
+
+		/* half the rate to leave coalescing again, to avoid flapping */
+		if (nvmeq->coal_on)
+			on = rate >= nvme_coal_levels[1].rate / 2;
+		else
+			on = rate >= nvme_coal_levels[1].rate;
+		if (on != nvmeq->coal_on && nvme_coal_set_vector(dev, nvmeq, on))
+			return;
+	}
+
+	/* move by a single level per interval, with the same hysteresis */
+	if (level + 1 < ARRAY_SIZE(nvme_coal_levels) &&
+	    max_rate >= nvme_coal_levels[level + 1].rate)
+		level++;
+	else if (level && max_rate < nvme_coal_levels[level].rate / 2)
+		level--;
+	if (level != dev->coal_level && nvme_coal_set_level(dev, level))
+		return;
+
+	queue_delayed_work(nvme_wq, &dev->coal_work, NVME_COAL_INTERVAL);
+}
+
+/*
+ * (Re)start the adaptation once the I/O queues are live.  A controller reset
+ * brings the features back to their defaults: coalescing allowed on every
+ * vector, and neither an aggregation threshold nor time.
+ */
+static void nvme_coal_start(struct nvme_dev *dev)
+{
+	int i;
+
+	if (!adaptive_coalescing || dev->num_vecs == 1)
+		return;
+
+	/*
+	 * Any command of a previous run has been cancelled by the reset, so
+	 * this doesn't wait for long.
+	 */
+	cancel_delayed_work_sync(&dev->coal_work);
+	if (dev->coal_failed)
+		return;
+
+	dev->coal_level = 0;
+	dev->coal_stamp = jiffies;
+	for (i = 1; i < dev->online_queues; i++) {
+		dev->queues[i].coal_on = true;
+		dev->queues[i].coal_last_cqes =
+			READ_ONCE(dev->queues[i].nr_irq_cqes);
+	}
+	queue_delayed_work(nvme_wq, &dev->coal_work, NVME_COAL_INTERVAL);
+}
+
 static void nvme_reset_work(struct work_struct *work)
 {
 	struct nvme_dev *dev =
@@ -2765,6 +2927,7 @@ static void nvme_reset_work(struct work_struct *work)
 	}
 
 	nvme_start_ctrl(&dev->ctrl);
+	nvme_coal_start(dev);
 	return;
 
  out_unlock:
@@ -2919,6 +3082,7 @@ static struct nvme_dev *nvme_pci_alloc_dev(struct pci_dev *pdev,
 	if (!dev)
 		return ERR_PTR(-ENOMEM);
 	INIT_WORK(&dev->ctrl.reset_work, nvme_reset_work);
+	INIT_DELAYED_WORK(&dev->coal_work, nvme_coal_work);
 	mutex_init(&dev->shutdown_lock);
 
 	dev->nr_write_queues = write_queues;
@@ -3052,6 +3216,7 @@ static int nvme_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 	pci_set_drvdata(pdev, dev);
 
 	nvme_start_ctrl(&dev->ctrl);
+	nvme_coal_start(dev);
 	nvme_put_ctrl(&dev->ctrl);
 	flush_work(&dev->ctrl.scan_work);
 	return 0;
@@ -3121,6 +3286,7 @@ static void nvme_remove(struct pci_dev *pdev)
 	}
 
 	flush_work(&dev->ctrl.reset_work);
+	cancel_delayed_work_sync(&dev->coal_work);
 	nvme_stop_ctrl(&dev->ctrl);
 	nvme_remove_namespaces(&dev->ctrl);
 	nvme_dev_disable(dev, true);
@@ -3156,6 +3322,11 @@ static int nvme_resume(struct device *dev)
 	if (ctrl->hmpre && nvme_setup_host_mem(ndev))
 		goto reset;
 
+	if (adaptive_coalescing && ndev->num_vecs > 1 && !ndev->coal_failed) {
+		ndev->coal_stamp = jiffies;
+		queue_delayed_work(nvme_wq, &ndev->coal_work,
+				   NVME_COAL_INTERVAL);
+	}
 	return 0;
 reset:
 	return nvme_try_sched_reset(ctrl);
@@ -3169,6 +3340,7 @@ static int nvme_suspend(struct device *dev)
 	int ret = -EBUSY;
 
 	ndev->last_ps = U32_MAX;
+	cancel_delayed_work_sync(&ndev->coal_work);
 
 	/*
 	 * The platform does not remove power for a kernel managed suspend so
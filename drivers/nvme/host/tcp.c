@@ -12,6 +12,8 @@
 #include <net/sock.h>
 #include <net/tcp.h>
 #include <linux/blk-mq.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <crypto/hash.h>
 #include <net/busy_poll.h>
 #include <trace/events/sock.h>
@@ -31,6 +33,25 @@ static int so_priority;
 module_param(so_priority, int, 0644);
 MODULE_PARM_DESC(so_priority, "nvme tcp socket optimize priority");
 
+/*
+ * Receive directly from the socket data_ready callback, in softirq context,
+ * when no more than this many bytes are pending instead of scheduling
+ * io_work. This saves a context switch per completion for small I/O, at the
+ * cost of more time spent in softirq context. Zero always uses io_work.
+ */
+static unsigned int softirq_rx_max;
+module_param(softirq_rx_max, uint, 0644);
+MODULE_PARM_DESC(softirq_rx_max,
+		 "max pending bytes received in softirq context (default 0: disabled)");
+
+/*
+ * Account the time requests spend on the network, waiting for the receive
+ * context to run and being completed, per queue. Exposed in debugfs.
+ */
+static bool latency_stats;
+module_param(latency_stats, bool, 0644);
+MODULE_PARM_DESC(latency_stats, "account per queue completion latency splits");
+
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 /* lockdep can detect a circular dependency of the form
  *   sk_lock -> mmap_lock (page fault) -> fs locks -> sk_lock
@@ -87,6 +108,7 @@ struct nvme_tcp_request {
 	u32			h2cdata_offset;
 	u16			ttag;
 	__le16			status;
+	u64			sent_ns;
 	struct list_head	entry;
 	struct llist_node	lentry;
 	__le32			ddgst;
@@ -112,6 +134,13 @@ enum nvme_tcp_recv_state {
 	NVME_TCP_RECV_DDGST,
 };
 
+struct nvme_tcp_queue_stats {
+	u64			nr;
+	u64			net_ns;
+	u64			wait_ns;
+	u64			comp_ns;
+};
+
 struct nvme_tcp_ctrl;
 struct nvme_tcp_queue {
 	struct socket		*sock;
@@ -131,6 +160,12 @@ struct nvme_tcp_queue {
 	size_t			ddgst_remaining;
 	unsigned int		nr_cqe;
 
+	/* latency stats, updated with the socket locked */
+	u64			rx_ready_ns;
+	u64			rx_start_ns;
+	u64			rx_wake_ns;
+	struct nvme_tcp_queue_stats stats;
+
 	/* send state */
 	struct nvme_tcp_request *request;
 
@@ -170,11 +205,13 @@ struct nvme_tcp_ctrl {
 	struct delayed_work	connect_work;
 	struct nvme_tcp_request async_req;
 	u32			io_queues[HCTX_MAX_TYPES];
+	struct dentry		*debugfs;
 };
 
 static LIST_HEAD(nvme_tcp_ctrl_list);
 static DEFINE_MUTEX(nvme_tcp_ctrl_mutex);
 static struct workqueue_struct *nvme_tcp_wq;
+static struct dentry *nvme_tcp_debugfs;
 static const struct blk_mq_ops nvme_tcp_mq_ops;
 static const struct blk_mq_ops nvme_tcp_admin_mq_ops;
 static int nvme_tcp_try_send(struct nvme_tcp_queue *queue);
@@ -245,20 +282,41 @@ static inline bool nvme_tcp_has_inline_data(struct nvme_tcp_request *req)
 		req->data_len <= nvme_tcp_inline_data_size(req);
 }
 
-static inline struct page *nvme_tcp_req_cur_page(struct nvme_tcp_request *req)
-{
-	return req->iter.bvec->bv_page;
-}
+/* Maximum number of data segments handed to the socket in one sendmsg */
+#define NVME_TCP_MAX_SEND_SEGS	16
 
-static inline size_t nvme_tcp_req_cur_offset(struct nvme_tcp_request *req)
-{
-	return req->iter.bvec->bv_offset + req->iter.iov_offset;
-}
+/*
+ * Fill @bvec with the data segments of the current bio that are left to
+ * send in the current PDU. All the segments either can or cannot be spliced,
+ * as reported in @splice. Returns the number of segments.
+ */
+static int nvme_tcp_req_send_bvecs(struct nvme_tcp_request *req,
+		struct bio_vec *bvec, size_t *len, bool *splice)
+{
+	size_t left = req->pdu_len - req->pdu_sent;
+	struct iov_iter iter = req->iter;
+	int nr = 0;
+
+	*len = 0;
+	*splice = true;
+	while (nr < NVME_TCP_MAX_SEND_SEGS && left && iov_iter_count(&iter)) {
+		struct page *page = iter.bvec->bv_page;
+		size_t offset = iter.bvec->bv_offset + iter.iov_offset;
+		size_t seg = min_t(size_t, iov_iter_single_seg_count(&iter),
+				   left);
+
+		if (!nr)
+			*splice = sendpage_ok(page);
+		else if (sendpage_ok(page) != *splice)
+			break;
 
-static inline size_t nvme_tcp_req_cur_length(struct nvme_tcp_request *req)
-{
-	return min_t(size_t, iov_iter_single_seg_count(&req->iter),
-			req->pdu_len - req->pdu_sent);
+		bvec_set_page(&bvec[nr++], page, seg, offset);
+		iov_iter_advance(&iter, seg);
+		left -= seg;
+		*len += seg;
+	}
+
+	return nr;
 }
 
 static inline size_t nvme_tcp_pdu_data_left(struct nvme_tcp_request *req)
@@ -396,13 +454,16 @@ static inline void nvme_tcp_ddgst_final(struct ahash_request *hash,
 }
 
 static inline void nvme_tcp_ddgst_update(struct ahash_request *hash,
-		struct page *page, off_t off, size_t len)
+		struct bio_vec *bvec, int nr, size_t len)
 {
-	struct scatterlist sg;
+	struct scatterlist sg[NVME_TCP_MAX_SEND_SEGS];
+	int i;
 
-	sg_init_table(&sg, 1);
-	sg_set_page(&sg, page, len, off);
-	ahash_request_set_crypt(hash, &sg, NULL, len);
+	sg_init_table(sg, nr);
+	for (i = 0; i < nr; i++)
+		sg_set_page(&sg[i], bvec[i].bv_page, bvec[i].bv_len,
+			    bvec[i].bv_offset);
+	ahash_request_set_crypt(hash, sg, NULL, len);
 	crypto_ahash_update(hash);
 }
 
@@ -533,6 +594,40 @@ static void nvme_tcp_init_recv_ctx(struct nvme_tcp_queue *queue)
 	queue->ddgst_remaining = 0;
 }
 
+static void nvme_tcp_rx_stats_start(struct nvme_tcp_queue *queue)
+{
+	u64 ready;
+
+	if (!READ_ONCE(latency_stats)) {
+		queue->rx_start_ns = 0;
+		return;
+	}
+
+	queue->rx_start_ns = ktime_get_ns();
+	ready = READ_ONCE(queue->rx_ready_ns);
+	WRITE_ONCE(queue->rx_ready_ns, 0);
+	/* polled receives don't wait for data_ready */
+	queue->rx_wake_ns = ready ? : queue->rx_start_ns;
+}
+
+static void nvme_tcp_account_req(struct nvme_tcp_queue *queue,
+		struct nvme_tcp_request *req)
+{
+	struct nvme_tcp_queue_stats *stats = &queue->stats;
+	u64 now;
+
+	if (!queue->rx_start_ns || !req->sent_ns)
+		return;
+
+	now = ktime_get_ns();
+	stats->nr++;
+	if (queue->rx_wake_ns > req->sent_ns)
+		stats->net_ns += queue->rx_wake_ns - req->sent_ns;
+	stats->wait_ns += queue->rx_start_ns - queue->rx_wake_ns;
+	stats->comp_ns += now - queue->rx_start_ns;
+	req->sent_ns = 0;
+}
+
 static void nvme_tcp_error_recovery(struct nvme_ctrl *ctrl)
 {
 	if (!nvme_change_ctrl_state(ctrl, NVME_CTRL_RESETTING))
@@ -561,6 +656,7 @@ static int nvme_tcp_process_nvme_cqe(struct nvme_tcp_queue *queue,
 	if (req->status == cpu_to_le16(NVME_SC_SUCCESS))
 		req->status = cqe->status;
 
+	nvme_tcp_account_req(queue, req);
 	if (!nvme_try_complete_req(rq, req->status, cqe->result))
 		nvme_complete_rq(rq);
 	queue->nr_cqe++;
@@ -825,6 +921,7 @@ static int nvme_tcp_recv_data(struct nvme_tcp_queue *queue, struct sk_buff *skb,
 			queue->ddgst_remaining = NVME_TCP_DIGEST_LENGTH;
 		} else {
 			if (pdu->hdr.flags & NVME_TCP_F_DATA_SUCCESS) {
+				nvme_tcp_account_req(queue, req);
 				nvme_tcp_end_request(rq,
 						le16_to_cpu(req->status));
 				queue->nr_cqe++;
@@ -873,6 +970,7 @@ static int nvme_tcp_recv_ddgst(struct nvme_tcp_queue *queue,
 					pdu->command_id);
 		struct nvme_tcp_request *req = blk_mq_rq_to_pdu(rq);
 
+		nvme_tcp_account_req(queue, req);
 		nvme_tcp_end_request(rq, le16_to_cpu(req->status));
 		queue->nr_cqe++;
 	}
@@ -917,6 +1015,28 @@ static int nvme_tcp_recv_skb(read_descriptor_t *desc, struct sk_buff *skb,
 	return consumed;
 }
 
+/*
+ * Called from data_ready. The socket is only locked by the softirq receive
+ * path if it isn't owned by user context, in which case io_work is used.
+ */
+static bool nvme_tcp_softirq_recv(struct nvme_tcp_queue *queue)
+{
+	unsigned int max = READ_ONCE(softirq_rx_max);
+	struct socket *sock = queue->sock;
+	struct sock *sk = sock->sk;
+	read_descriptor_t rd_desc;
+
+	if (!max || !in_softirq() || sock_owned_by_user(sk) ||
+	    tcp_inq(sk) > max)
+		return false;
+
+	rd_desc.arg.data = queue;
+	rd_desc.count = 1;
+	nvme_tcp_rx_stats_start(queue);
+	sock->ops->read_sock(sk, &rd_desc, nvme_tcp_recv_skb);
+	return true;
+}
+
 static void nvme_tcp_data_ready(struct sock *sk)
 {
 	struct nvme_tcp_queue *queue;
@@ -926,8 +1046,13 @@ static void nvme_tcp_data_ready(struct sock *sk)
 	read_lock_bh(&sk->sk_callback_lock);
 	queue = sk->sk_user_data;
 	if (likely(queue && queue->rd_enabled) &&
-	    !test_bit(NVME_TCP_Q_POLLING, &queue->flags))
-		queue_work_on(queue->io_cpu, nvme_tcp_wq, &queue->io_work);
+	    !test_bit(NVME_TCP_Q_POLLING, &queue->flags)) {
+		if (READ_ONCE(latency_stats) && !READ_ONCE(queue->rx_ready_ns))
+			WRITE_ONCE(queue->rx_ready_ns, ktime_get_ns());
+		if (!nvme_tcp_softirq_recv(queue))
+			queue_work_on(queue->io_cpu, nvme_tcp_wq,
+				      &queue->io_work);
+	}
 	read_unlock_bh(&sk->sk_callback_lock);
 }
 
@@ -997,34 +1122,34 @@ static int nvme_tcp_try_send_data(struct nvme_tcp_request *req)
 	u32 h2cdata_left = req->h2cdata_left;
 
 	while (true) {
-		struct bio_vec bvec;
+		struct bio_vec bvec[NVME_TCP_MAX_SEND_SEGS];
 		struct msghdr msg = {
 			.msg_flags = MSG_DONTWAIT | MSG_SPLICE_PAGES,
 		};
-		struct page *page = nvme_tcp_req_cur_page(req);
-		size_t offset = nvme_tcp_req_cur_offset(req);
-		size_t len = nvme_tcp_req_cur_length(req);
-		bool last = nvme_tcp_pdu_last_send(req, len);
 		int req_data_sent = req->data_sent;
-		int ret;
+		bool last, splice;
+		size_t len;
+		int nr, ret;
+
+		/* send as many segments of the PDU as possible at once */
+		nr = nvme_tcp_req_send_bvecs(req, bvec, &len, &splice);
+		last = nvme_tcp_pdu_last_send(req, len);
 
 		if (last && !queue->data_digest && !nvme_tcp_queue_more(queue))
 			msg.msg_flags |= MSG_EOR;
 		else
 			msg.msg_flags |= MSG_MORE;
 
-		if (!sendpage_ok(page))
+		if (!splice)
 			msg.msg_flags &= ~MSG_SPLICE_PAGES;
 
-		bvec_set_page(&bvec, page, len, offset);
-		iov_iter_bvec(&msg.msg_iter, ITER_SOURCE, &bvec, 1, len);
+		iov_iter_bvec(&msg.msg_iter, ITER_SOURCE, bvec, nr, len);
 		ret = sock_sendmsg(queue->sock, &msg);
 		if (ret <= 0)
 			return ret;
 
 		if (queue->data_digest)
-			nvme_tcp_ddgst_update(queue->snd_hash, page,
-					offset, ret);
+			nvme_tcp_ddgst_update(queue->snd_hash, bvec, nr, ret);
 
 		/*
 		 * update the request iterator except for the last payload send
@@ -1080,6 +1205,8 @@ static int nvme_tcp_try_send_cmd_pdu(struct nvme_tcp_request *req)
 
 	len -= ret;
 	if (!len) {
+		if (READ_ONCE(latency_stats))
+			req->sent_ns = ktime_get_ns();
 		if (inline_data) {
 			req->state = NVME_TCP_SEND_DATA;
 			if (queue->data_digest)
@@ -1222,6 +1349,7 @@ static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue)
 	rd_desc.count = 1;
 	lock_sock(sk);
 	queue->nr_cqe = 0;
+	nvme_tcp_rx_stats_start(queue);
 	consumed = sock->ops->read_sock(sk, &rd_desc, nvme_tcp_recv_skb);
 	release_sock(sk);
 	return consumed;
@@ -2175,10 +2303,33 @@ static void nvme_tcp_stop_ctrl(struct nvme_ctrl *ctrl)
 	cancel_delayed_work_sync(&to_tcp_ctrl(ctrl)->connect_work);
 }
 
+static int nvme_tcp_latency_show(struct seq_file *m, void *unused)
+{
+	struct nvme_tcp_ctrl *ctrl = m->private;
+	int i;
+
+	seq_puts(m, "queue completions network_avg_ns io_work_wait_avg_ns completion_avg_ns\n");
+	for (i = 0; i < ctrl->ctrl.queue_count; i++) {
+		struct nvme_tcp_queue_stats *stats = &ctrl->queues[i].stats;
+		u64 nr = READ_ONCE(stats->nr);
+
+		if (!nr)
+			continue;
+		seq_printf(m, "%d %llu %llu %llu %llu\n", i, nr,
+			   div64_u64(READ_ONCE(stats->net_ns), nr),
+			   div64_u64(READ_ONCE(stats->wait_ns), nr),
+			   div64_u64(READ_ONCE(stats->comp_ns), nr));
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nvme_tcp_latency);
+
 static void nvme_tcp_free_ctrl(struct nvme_ctrl *nctrl)
 {
 	struct nvme_tcp_ctrl *ctrl = to_tcp_ctrl(nctrl);
 
+	debugfs_remove_recursive(ctrl->debugfs);
+
 	if (list_empty(&ctrl->list))
 		goto free_ctrl;
 
@@ -2334,6 +2485,7 @@ static blk_status_t nvme_tcp_setup_cmd_pdu(struct nvme_ns *ns,
 
 	req->state = NVME_TCP_SEND_CMD_PDU;
 	req->status = cpu_to_le16(NVME_SC_SUCCESS);
+	req->sent_ns = 0;
 	req->offset = 0;
 	req->data_sent = 0;
 	req->pdu_len = 0;
@@ -2593,6 +2745,11 @@ static struct nvme_ctrl *nvme_tcp_create_ctrl(struct device *dev,
 	dev_info(ctrl->ctrl.device, "new ctrl: NQN \"%s\", addr %pISp\n",
 		nvmf_ctrl_subsysnqn(&ctrl->ctrl), &ctrl->addr);
 
+	ctrl->debugfs = debugfs_create_dir(dev_name(ctrl->ctrl.device),
+					   nvme_tcp_debugfs);
+	debugfs_create_file("latency", 0400, ctrl->debugfs, ctrl,
+			    &nvme_tcp_latency_fops);
+
 	mutex_lock(&nvme_tcp_ctrl_mutex);
 	list_add_tail(&ctrl->list, &nvme_tcp_ctrl_list);
 	mutex_unlock(&nvme_tcp_ctrl_mutex);
@@ -2640,6 +2797,7 @@ static int __init nvme_tcp_init_module(void)
 	if (!nvme_tcp_wq)
 		return -ENOMEM;
 
+	nvme_tcp_debugfs = debugfs_create_dir("nvme_tcp", NULL);
 	nvmf_register_transport(&nvme_tcp_transport);
 	return 0;
 }
@@ -2656,6 +2814,7 @@ static void __exit nvme_tcp_cleanup_module(void)
 	mutex_unlock(&nvme_tcp_ctrl_mutex);
 	flush_workqueue(nvme_delete_wq);
 
+	debugfs_remove_recursive(nvme_tcp_debugfs);
 	destroy_workqueue(nvme_tcp_wq);
 }
 
@@ -112,6 +112,7 @@ static const char *sdebug_version_date = "20210520";
  * (id 0) containing 1 logical unit (lun 0). That is 1 device.
  */
 #define DEF_ATO 1
+#define DEF_BANDWIDTH 0		/* MB/s, 0: no limit */
 #define DEF_CDB_LEN 10
 #define DEF_JDELAY   1		/* if > 0 unit is a jiffy */
 #define DEF_DEV_SIZE_PRE_INIT   0
@@ -364,6 +365,7 @@ static atomic_t sdebug_miss_cpus;    /* submission + completion cpus differ */
 static atomic_t sdebug_a_tsf;	     /* 'almost task set full' counter */
 static atomic_t sdeb_inject_pending;
 static atomic_t sdeb_mq_poll_count;  /* bumped when mq_poll returns > 0 */
+static atomic64_t sdeb_bw_busy_until; /* boottime ns the data path is busy */
 
 struct opcode_info_t {
 	u8 num_attached;	/* 0 if this is it (i.e. a leaf); use 0xff */
@@ -739,6 +741,7 @@ static const struct opcode_info_t opcode_info_arr[SDEB_I_LAST_ELEM_P1 + 1] = {
 static int sdebug_num_hosts;
 static int sdebug_add_host = DEF_NUM_HOST;  /* in sysfs this is relative */
 static int sdebug_ato = DEF_ATO;
+static unsigned int sdebug_bandwidth = DEF_BANDWIDTH;
 static int sdebug_cdb_len = DEF_CDB_LEN;
 static int sdebug_jdelay = DEF_JDELAY;	/* if > 0 then unit is jiffies */
 static int sdebug_dev_size_mb = DEF_DEV_SIZE_PRE_INIT;
@@ -5533,6 +5536,32 @@ static struct sdebug_queued_cmd *sdebug_alloc_queued_cmd(struct scsi_cmnd *scmd)
 	return sqcp;
 }
 
+/* Time in ns until the data of @cmnd has been transferred when all delayed
+ * commands share a data path of sdebug_bandwidth MB/s. Transfers are
+ * serialized in submission order, so the latency grows with the amount of
+ * data queued ahead, as it does on a saturated device.
+ */
+static u64 sdeb_bw_delay_ns(struct scsi_cmnd *cmnd)
+{
+	unsigned int bw = READ_ONCE(sdebug_bandwidth);
+	s64 now, start, old;
+	u64 xfer;
+
+	if (!bw || !scsi_bufflen(cmnd))
+		return 0;
+
+	/* 1 MB/s moves one byte per microsecond */
+	xfer = div_u64((u64)scsi_bufflen(cmnd) * NSEC_PER_USEC, bw);
+	now = ktime_get_boottime_ns();
+	old = atomic64_read(&sdeb_bw_busy_until);
+	do {
+		start = max(now, old);
+	} while (!atomic64_try_cmpxchg(&sdeb_bw_busy_until, &old,
+				       start + xfer));
+
+	return start + xfer - now;
+}
+
 /* Complete the processing of the thread that queued a SCSI command to this
  * driver. It either completes the command by calling cmnd_done() or
  * schedules a hr timer or work queue then returns 0. Returns
@@ -5625,10 +5654,11 @@ static int schedule_resp(struct scsi_cmnd *cmnd, struct sdebug_dev_info *devip,
 					ns = get_random_u32_below((u32)ns);
 				ns <<= 12;
 			}
-			kt = ns_to_ktime(ns);
+			kt = ns_to_ktime(ns + sdeb_bw_delay_ns(cmnd));
 		} else {	/* ndelay has a 4.2 second max */
 			kt = sdebug_random ? get_random_u32_below((u32)ndelay) :
 					     (u32)ndelay;
+			kt += sdeb_bw_delay_ns(cmnd);
 			if (ndelay < INCLUSIVE_TIMING_MAX_NS) {
 				u64 d = ktime_get_boottime_ns() - ns_from_boot;
 
@@ -5709,6 +5739,7 @@ static int schedule_resp(struct scsi_cmnd *cmnd, struct sdebug_dev_info *devip,
  */
 module_param_named(add_host, sdebug_add_host, int, S_IRUGO | S_IWUSR);
 module_param_named(ato, sdebug_ato, int, S_IRUGO);
+module_param_named(bandwidth, sdebug_bandwidth, uint, S_IRUGO | S_IWUSR);
 module_param_named(cdb_len, sdebug_cdb_len, int, 0644);
 module_param_named(clustering, sdebug_clustering, bool, S_IRUGO | S_IWUSR);
 module_param_named(delay, sdebug_jdelay, int, S_IRUGO | S_IWUSR);
@@ -5785,6 +5816,7 @@ MODULE_VERSION(SDEBUG_VERSION);
 
 MODULE_PARM_DESC(add_host, "add n hosts, in sysfs if negative remove host(s) (def=1)");
 MODULE_PARM_DESC(ato, "application tag ownership: 0=disk 1=host (def=1)");
+MODULE_PARM_DESC(bandwidth, "data transfer rate in MB/s shared by all delayed commands (def=0: no limit)");
 MODULE_PARM_DESC(cdb_len, "suggest CDB lengths to drivers (def=10)");
 MODULE_PARM_DESC(clustering, "when set enables larger transfers (def=0)");
 MODULE_PARM_DESC(delay, "response delay (def=1 jiffy); 0:imm, -1,-2:tiny");
@@ -29,6 +29,7 @@
 #include <linux/module.h>
 #include <linux/mm.h>
 #include <linux/kthread.h>
+#include <linux/padata.h>
 #include <linux/rbtree.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/mm.h>
@@ -60,6 +61,11 @@ module_param_named(dma_entry_limit, dma_entry_limit, uint, 0644);
 MODULE_PARM_DESC(dma_entry_limit,
 		 "Maximum number of user DMA mappings per container (65535).");
 
+static unsigned int prefault_threads __read_mostly;
+module_param_named(prefault_threads, prefault_threads, uint, 0644);
+MODULE_PARM_DESC(prefault_threads,
+		 "Fault in large DMA mappings with up to this many threads before pinning them (0 disables).");
+
 struct vfio_iommu {
 	struct list_head	domain_list;
 	struct list_head	iova_list;
@@ -670,7 +676,8 @@ static long vfio_pin_pages_remote(struct vfio_dma *dma, unsigned long vaddr,
 			 * externally pinned pages are already counted against
 			 * the user.
 			 */
-			if (!rsvd && !vfio_find_vpfn(dma, iova)) {
+			if (!rsvd && (RB_EMPTY_ROOT(&dma->pfn_list) ||
+				      !vfio_find_vpfn(dma, iova))) {
 				if (!dma->lock_cap &&
 				    mm->locked_vm + lock_acct + 1 > limit) {
 					pr_warn("%s: RLIMIT_MEMLOCK (%ld) exceeded\n",
@@ -726,14 +733,31 @@ static long vfio_unpin_pages_remote(struct vfio_dma *dma, dma_addr_t iova,
 				    bool do_accounting)
 {
 	long unlocked = 0, locked = 0;
-	long i;
+	long i, j, nr;
+
+	/*
+	 * Unpin runs of non-reserved pfns at once, so that the pages of a
+	 * large folio are released with a single update of the folio.
+	 */
+	for (i = 0; i < npage; i += nr) {
+		bool rsvd = is_invalid_reserved_pfn(pfn + i);
+
+		for (nr = 1; i + nr < npage; nr++)
+			if (is_invalid_reserved_pfn(pfn + i + nr) != rsvd)
+				break;
+		if (rsvd)
+			continue;
+
+		unpin_user_page_range_dirty_lock(pfn_to_page(pfn + i), nr,
+						 dma->prot & IOMMU_WRITE);
+		unlocked += nr;
 
-	for (i = 0; i < npage; i++, iova += PAGE_SIZE) {
-		if (put_pfn(pfn++, dma->prot)) {
-			unlocked++;
-			if (vfio_find_vpfn(dma, iova))
+		/* Pages also pinned externally stay accounted */
+		if (RB_EMPTY_ROOT(&dma->pfn_list))
+			continue;
+		for (j = 0; j < nr; j++)
+			if (vfio_find_vpfn(dma, iova + ((i + j) << PAGE_SHIFT)))
 				locked++;
-		}
 	}
 
 	if (do_accounting)
@@ -1454,6 +1478,91 @@ static int vfio_iommu_map(struct vfio_iommu *iommu, dma_addr_t iova,
 	return ret;
 }
 
+/* Mappings smaller than this aren't worth prefaulting in parallel */
+#define VFIO_PREFAULT_MIN_SIZE	SZ_1G
+#define VFIO_PREFAULT_MIN_CHUNK	(SZ_128M >> PAGE_SHIFT)
+
+struct vfio_prefault {
+	struct padata_mt_job	job;
+	struct mm_struct	*mm;
+	unsigned int		gup_flags;
+};
+
+/* padata thread function, faults in the pages [start, end) of pf->mm */
+static void vfio_prefault_chunk(unsigned long start, unsigned long end,
+				void *arg)
+{
+	struct vfio_prefault *pf = arg;
+	bool use_mm = current->mm != pf->mm;
+	struct page **pages;
+
+	pages = (struct page **)__get_free_page(GFP_KERNEL);
+	if (!pages)
+		return;
+
+	/* The helpers run in kworkers */
+	if (use_mm)
+		kthread_use_mm(pf->mm);
+
+	while (start < end) {
+		long npage = min_t(long, end - start,
+				   PAGE_SIZE / sizeof(struct page *));
+
+		mmap_read_lock(pf->mm);
+		npage = get_user_pages_remote(pf->mm, start << PAGE_SHIFT,
+					      npage, pf->gup_flags, pages,
+					      NULL);
+		mmap_read_unlock(pf->mm);
+
+		/* Leave errors like a VM_PFNMAP range to the pinning */
+		if (npage <= 0)
+			break;
+
+		release_pages(pages, npage);
+		start += npage;
+	}
+
+	if (use_mm)
+		kthread_unuse_mm(pf->mm);
+	free_page((unsigned long)pages);
+}
+
+/*
+ * Pinning a large mapping is dominated by faulting in and clearing the
+ * pages, which the sequential pinning in vfio_pin_map_dma() then finds
+ * present.  Do that part in parallel; the helpers' time is charged to the
+ * caller's cgroup.
+ */
+static void vfio_prefault_dma(struct vfio_dma *dma, size_t map_size,
+			      unsigned long limit)
+{
+	struct vfio_prefault pf = {
+		.job = {
+			.thread_fn	= vfio_prefault_chunk,
+			.start		= dma->vaddr >> PAGE_SHIFT,
+			.size		= map_size >> PAGE_SHIFT,
+			.align		= PMD_SIZE >> PAGE_SHIFT,
+			.min_chunk	= VFIO_PREFAULT_MIN_CHUNK,
+			.max_threads	= READ_ONCE(prefault_threads),
+			.numa_aware	= true,
+		},
+		.mm		= dma->mm,
+		.gup_flags	= (dma->prot & IOMMU_WRITE) ? FOLL_WRITE : 0,
+	};
+
+	if (!IS_ENABLED(CONFIG_PADATA) || pf.job.max_threads < 2 ||
+	    map_size < VFIO_PREFAULT_MIN_SIZE || dma->mm != current->mm)
+		return;
+
+	/* Don't fault in what the pinning will refuse anyway */
+	if (!dma->lock_cap &&
+	    dma->mm->locked_vm + pf.job.size > limit)
+		return;
+
+	pf.job.fn_arg = &pf;
+	padata_do_multithreaded(&pf.job);
+}
+
 static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
 			    size_t map_size)
 {
@@ -1465,6 +1574,8 @@ static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
 	unsigned long pfn, limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
 	int ret = 0;
 
+	vfio_prefault_dma(dma, map_size, limit);
+
 	vfio_batch_init(&batch);
 
 	while (size) {
@@ -105,6 +105,17 @@ struct vhost_net_buf {
 	int head;
 };
 
+/* Max number of packets received from a tun/tap ring with one recvmsg() */
+#define VHOST_NET_RX_BATCH 16
+struct vhost_net_rx_batch {
+	struct tun_recv_buf bufs[VHOST_NET_RX_BATCH];
+	struct {
+		struct iov_iter fixup;
+		size_t len;
+		int headcount;
+	} pkts[VHOST_NET_RX_BATCH];
+};
+
 struct vhost_net_virtqueue {
 	struct vhost_virtqueue vq;
 	size_t vhost_hlen;
@@ -125,6 +136,8 @@ struct vhost_net_virtqueue {
 	struct vhost_net_ubuf_ref *ubufs;
 	struct ptr_ring *rx_ring;
 	struct vhost_net_buf rxq;
+	/* Packets received in one batch from rx_ring */
+	struct vhost_net_rx_batch *rx_batch;
 	/* Batched XDP buffs */
 	struct xdp_buff *xdp;
 };
@@ -1036,6 +1049,8 @@ static int vhost_net_rx_peek_head_len(struct vhost_net *net, struct sock *sk,
 /* This is a multi-buffer version of vhost_get_desc, that works if
  *	vq has read descriptors only.
  * @vq		- the relevant virtqueue
+ * @heads	- array to return the buffer heads in
+ * @iov_off	- first entry of vq->iov to fill
  * @datalen	- data length we'll be reading
  * @iovcount	- returned count of io vectors we fill
  * @log		- vhost log
@@ -1045,6 +1060,7 @@ static int vhost_net_rx_peek_head_len(struct vhost_net *net, struct sock *sk,
  */
 static int get_rx_bufs(struct vhost_virtqueue *vq,
 		       struct vring_used_elem *heads,
+		       unsigned int iov_off,
 		       int datalen,
 		       unsigned *iovcount,
 		       struct vhost_log *log,
@@ -1052,7 +1068,7 @@ static int get_rx_bufs(struct vhost_virtqueue *vq,
 		       unsigned int quota)
 {
 	unsigned int out, in;
-	int seg = 0;
+	int seg = iov_off;
 	int headcount = 0;
 	unsigned d;
 	int r, nlogs = 0;
@@ -1095,7 +1111,7 @@ static int get_rx_bufs(struct vhost_virtqueue *vq,
 		seg += in;
 	}
 	heads[headcount - 1].len = cpu_to_vhost32(vq, len + datalen);
-	*iovcount = seg;
+	*iovcount = seg - iov_off;
 	if (unlikely(log))
 		*log_num = nlogs;
 
@@ -1110,6 +1126,116 @@ static int get_rx_bufs(struct vhost_virtqueue *vq,
 	return r;
 }
 
+/*
+ * Receive up to VHOST_NET_RX_BATCH packets from the tun/tap ring with a
+ * single recvmsg(), after getting the descriptors for all of them. Only
+ * used if the socket supplies the vnet header and there is no dirty log.
+ *
+ * Returns the number of packets consumed from the ring, 0 if the first one
+ * should go through the regular path, or a negative error if RX should
+ * stop until the next kick.
+ */
+static int vhost_net_rx_batch(struct vhost_net *net, struct socket *sock,
+			      bool mergeable, size_t *total_len)
+{
+	struct vhost_net_virtqueue *nvq = &net->vqs[VHOST_NET_VQ_RX];
+	struct vhost_net_rx_batch *batch = nvq->rx_batch;
+	struct vhost_virtqueue *vq = &nvq->vq;
+	struct vhost_net_buf *rxq = &nvq->rxq;
+	struct tun_msg_ctl ctl = {
+		.type = TUN_MSG_PTR,
+		.ptr = batch->bufs,
+	};
+	struct msghdr msg = {
+		.msg_control = &ctl,
+		.msg_controllen = sizeof(ctl),
+		.msg_flags = MSG_DONTWAIT,
+	};
+	int max = min(vhost_net_buf_get_size(rxq), VHOST_NET_RX_BATCH);
+	int heads = nvq->done_idx, fetched, consumed, n, i, err = 0;
+	unsigned int seg = 0, in, quota;
+	__virtio16 num_buffers;
+	int headcount;
+	size_t len;
+
+	for (n = 0; n < max; n++) {
+		void *ptr = rxq->queue[rxq->head + n];
+
+		/* vq->heads has room for UIO_MAXIOV + VHOST_NET_BATCH */
+		quota = UIO_MAXIOV + VHOST_NET_BATCH - heads;
+		if (!quota)
+			break;
+		quota = likely(mergeable) ? min(quota, UIO_MAXIOV) : 1;
+
+		len = vhost_net_buf_peek_len(ptr) + nvq->sock_hlen;
+		headcount = get_rx_bufs(vq, vq->heads + heads, seg, len, &in,
+					NULL, NULL, quota);
+		/*
+		 * Out of descriptors, iovecs or heads: receive what we have,
+		 * the failed descriptors have been discarded already.
+		 */
+		if (headcount <= 0 || headcount > UIO_MAXIOV) {
+			if (!n && headcount < 0)
+				return headcount;
+			break;
+		}
+
+		batch->bufs[n].ptr = ptr;
+		iov_iter_init(&batch->bufs[n].iter, ITER_DEST, vq->iov + seg,
+			      in, len);
+		batch->pkts[n].fixup = batch->bufs[n].iter;
+		batch->pkts[n].len = len;
+		batch->pkts[n].headcount = headcount;
+		heads += headcount;
+		seg += in;
+	}
+	if (!n)
+		return 0;
+
+	fetched = heads - nvq->done_idx;
+	rxq->head += n;
+	ctl.num = n;
+	consumed = sock->ops->recvmsg(sock, &msg, 0, MSG_DONTWAIT | MSG_TRUNC);
+	/* On error all the packets have been dropped */
+	if (unlikely(consumed < 0))
+		consumed = n;
+	/* Put back what wasn't looked at */
+	rxq->head -= n - consumed;
+
+	heads = nvq->done_idx;
+	for (i = 0; i < consumed; i++) {
+		if (unlikely(batch->bufs[i].ret != batch->pkts[i].len)) {
+			pr_debug("Discarded rx packet: len %d, expected %zd\n",
+				 batch->bufs[i].ret, batch->pkts[i].len);
+			break;
+		}
+
+		/* Patch ->num_buffers over the header from the socket */
+		iov_iter_advance(&batch->pkts[i].fixup,
+				 sizeof(struct virtio_net_hdr));
+		num_buffers = cpu_to_vhost16(vq, batch->pkts[i].headcount);
+		if (likely(mergeable) &&
+		    copy_to_iter(&num_buffers, sizeof(num_buffers),
+				 &batch->pkts[i].fixup) != sizeof(num_buffers)) {
+			vq_err(vq, "Failed num_buffers write");
+			err = -EFAULT;
+			break;
+		}
+
+		heads += batch->pkts[i].headcount;
+		*total_len += batch->pkts[i].len;
+	}
+
+	/*
+	 * Discard the descriptors from the first failed packet on. The socket
+	 * stops at a short copy, so there's no packet consumed after it.
+	 */
+	vhost_discard_vq_desc(vq, fetched - (heads - nvq->done_idx));
+	nvq->done_idx = heads;
+
+	return err ? err : consumed;
+}
+
 /* Expects to be always run from workqueue - which acts as
  * read-size critical section for our kind of RCU. */
 static void handle_rx(struct vhost_net *net)
@@ -1139,6 +1265,7 @@ static void handle_rx(struct vhost_net *net)
 	struct iov_iter fixup;
 	__virtio16 num_buffers;
 	int recv_pkts = 0;
+	bool batch;
 
 	mutex_lock_nested(&vq->mutex, VHOST_NET_VQ_RX);
 	sock = vhost_vq_get_backend(vq);
@@ -1157,15 +1284,30 @@ static void handle_rx(struct vhost_net *net)
 	vq_log = unlikely(vhost_has_feature(vq, VHOST_F_LOG_ALL)) ?
 		vq->log : NULL;
 	mergeable = vhost_has_feature(vq, VIRTIO_NET_F_MRG_RXBUF);
+	batch = nvq->rx_ring && !vhost_hlen && !vq_log;
 
 	do {
 		sock_len = vhost_net_rx_peek_head_len(net, sock->sk,
 						      &busyloop_intr);
 		if (!sock_len)
 			break;
+		if (batch && vhost_net_buf_get_size(&nvq->rxq) > 1) {
+			int n = vhost_net_rx_batch(net, sock, mergeable,
+						   &total_len);
+
+			if (unlikely(n < 0))
+				goto out;
+			if (n) {
+				busyloop_intr = false;
+				if (nvq->done_idx > VHOST_NET_BATCH)
+					vhost_net_signal_used(nvq);
+				recv_pkts += n - 1;
+				continue;
+			}
+		}
 		sock_len += sock_hlen;
 		vhost_len = sock_len + vhost_hlen;
-		headcount = get_rx_bufs(vq, vq->heads + nvq->done_idx,
+		headcount = get_rx_bufs(vq, vq->heads + nvq->done_idx, 0,
 					vhost_len, &in, vq_log, &log,
 					likely(mergeable) ? UIO_MAXIOV : 1);
 		/* On error, stop handling until the next kick. */
@@ -1295,6 +1437,7 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 	struct vhost_net *n;
 	struct vhost_dev *dev;
 	struct vhost_virtqueue **vqs;
+	struct vhost_net_rx_batch *rx_batch;
 	void **queue;
 	struct xdp_buff *xdp;
 	int i;
@@ -1326,6 +1469,16 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 	}
 	n->vqs[VHOST_NET_VQ_TX].xdp = xdp;
 
+	rx_batch = kmalloc(sizeof(*rx_batch), GFP_KERNEL);
+	if (!rx_batch) {
+		kfree(vqs);
+		kvfree(n);
+		kfree(queue);
+		kfree(xdp);
+		return -ENOMEM;
+	}
+	n->vqs[VHOST_NET_VQ_RX].rx_batch = rx_batch;
+
 	dev = &n->dev;
 	vqs[VHOST_NET_VQ_TX] = &n->vqs[VHOST_NET_VQ_TX].vq;
 	vqs[VHOST_NET_VQ_RX] = &n->vqs[VHOST_NET_VQ_RX].vq;
@@ -1420,6 +1573,7 @@ static int vhost_net_release(struct inode *inode, struct file *f)
 	 * since jobs can re-queue themselves. */
 	vhost_net_flush(n);
 	kfree(n->vqs[VHOST_NET_VQ_RX].rxq.queue);
+	kfree(n->vqs[VHOST_NET_VQ_RX].rx_batch);
 	kfree(n->vqs[VHOST_NET_VQ_TX].xdp);
 	kfree(n->dev.vqs);
 	if (n->page_frag.page)
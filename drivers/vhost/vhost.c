@@ -30,6 +30,9 @@
 #include <linux/interval_tree_generic.h>
 #include <linux/nospec.h>
 #include <linux/kcov.h>
+#include <linux/cgroup.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "vhost.h"
 
@@ -41,6 +44,45 @@ static int max_iotlb_entries = 2048;
 module_param(max_iotlb_entries, int, 0444);
 MODULE_PARM_DESC(max_iotlb_entries,
 	"Maximum number of iotlb entries. (default: 2048)");
+static unsigned int shared_workers;
+module_param(shared_workers, uint, 0644);
+MODULE_PARM_DESC(shared_workers,
+	"Number of worker threads shared by the devices of a cgroup, 0 for a worker per device. (default: 0)");
+
+/*
+ * A thread of a vhost_worker_pool. It runs the work of the vhost_workers
+ * queued on @ready one after the other, switching to the mm of their
+ * device. Since the virtqueue handlers bound the work they do per run by
+ * the vq weight and requeue themselves, this shares the thread fairly.
+ */
+struct vhost_shared_worker {
+	struct task_struct	*task;
+	struct vhost_worker_pool *pool;
+	/* Protects @ready, @running and the stats */
+	spinlock_t		lock;
+	struct list_head	ready;
+	struct vhost_worker	*running;
+	wait_queue_head_t	idle_wait;
+	int			nr_devs;
+	u64			start_ns;
+	u64			busy_ns;
+	u64			wait_ns;
+	u64			max_wait_ns;
+	u64			nr_runs;
+};
+
+/* The shared worker threads of a cgroup */
+struct vhost_worker_pool {
+	struct list_head	node;
+	struct cgroup		*cgrp;
+	int			refcnt;
+	unsigned int		nr_threads;
+	struct vhost_shared_worker threads[];
+};
+
+/* Protects vhost_worker_pools and the device counts of the pools */
+static DEFINE_MUTEX(vhost_pools_mutex);
+static LIST_HEAD(vhost_worker_pools);
 
 enum {
 	VHOST_MEMORY_F_LOG = 0x1,
@@ -233,6 +275,23 @@ void vhost_poll_stop(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_stop);
 
+static void vhost_shared_worker_wake(struct vhost_worker *worker)
+{
+	struct vhost_shared_worker *sw = worker->shared;
+	unsigned long flags;
+
+	/* Already queued, or running and not yet past llist_del_all() */
+	if (test_and_set_bit(VHOST_WORKER_QUEUED, &worker->shared_flags))
+		return;
+
+	spin_lock_irqsave(&sw->lock, flags);
+	worker->queued_ns = ktime_get_ns();
+	list_add_tail(&worker->shared_node, &sw->ready);
+	spin_unlock_irqrestore(&sw->lock, flags);
+
+	wake_up_process(sw->task);
+}
+
 static void vhost_worker_queue(struct vhost_worker *worker,
 			       struct vhost_work *work)
 {
@@ -242,7 +301,10 @@ static void vhost_worker_queue(struct vhost_worker *worker,
 		 * test_and_set_bit() implies a memory barrier.
 		 */
 		llist_add(&work->node, &worker->work_list);
-		vhost_task_wake(worker->vtsk);
+		if (worker->shared)
+			vhost_shared_worker_wake(worker);
+		else
+			vhost_task_wake(worker->vtsk);
 	}
 }
 
@@ -332,12 +394,20 @@ void vhost_poll_queue(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_queue);
 
+static void vhost_vq_tlb_reset(struct vhost_virtqueue *vq)
+{
+	memset(vq->tlb, 0, sizeof(vq->tlb));
+	vq->tlb_next = 0;
+}
+
+/* Called with the vq mutex held before any map of the vq may go away */
 static void __vhost_vq_meta_reset(struct vhost_virtqueue *vq)
 {
 	int j;
 
 	for (j = 0; j < VHOST_NUM_ADDRS; j++)
 		vq->meta_iotlb[j] = NULL;
+	vhost_vq_tlb_reset(vq);
 }
 
 static void vhost_vq_meta_reset(struct vhost_dev *d)
@@ -417,6 +487,249 @@ static bool vhost_worker(void *data)
 	return !!node;
 }
 
+static int vhost_shared_worker_fn(void *data)
+{
+	struct vhost_shared_worker *sw = data;
+	struct vhost_worker *worker;
+	u64 start, wait;
+
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+
+		spin_lock_irq(&sw->lock);
+		worker = list_first_entry_or_null(&sw->ready,
+						  struct vhost_worker,
+						  shared_node);
+		if (worker) {
+			list_del_init(&worker->shared_node);
+			sw->running = worker;
+			start = ktime_get_ns();
+			wait = start - worker->queued_ns;
+		}
+		spin_unlock_irq(&sw->lock);
+
+		if (!worker) {
+			if (kthread_should_stop()) {
+				__set_current_state(TASK_RUNNING);
+				break;
+			}
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		/* Work queued from now on has to queue the worker again */
+		clear_bit(VHOST_WORKER_QUEUED, &worker->shared_flags);
+		smp_mb__after_atomic();
+
+		kthread_use_mm(worker->mm);
+		vhost_worker(worker);
+		kthread_unuse_mm(worker->mm);
+
+		spin_lock_irq(&sw->lock);
+		sw->running = NULL;
+		sw->busy_ns += ktime_get_ns() - start;
+		sw->wait_ns += wait;
+		sw->max_wait_ns = max(sw->max_wait_ns, wait);
+		sw->nr_runs++;
+		spin_unlock_irq(&sw->lock);
+		wake_up_all(&sw->idle_wait);
+
+		cond_resched();
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_CGROUPS
+static struct cgroup *vhost_get_cgroup(void)
+{
+	struct cgroup *cgrp;
+
+	rcu_read_lock();
+	cgrp = task_dfl_cgroup(current);
+	cgroup_get(cgrp);
+	rcu_read_unlock();
+
+	return cgrp;
+}
+
+static void vhost_put_cgroup(struct cgroup *cgrp)
+{
+	cgroup_put(cgrp);
+}
+#else
+static struct cgroup *vhost_get_cgroup(void)
+{
+	return NULL;
+}
+
+static void vhost_put_cgroup(struct cgroup *cgrp) { }
+#endif
+
+static void vhost_worker_pool_free(struct vhost_worker_pool *pool)
+{
+	unsigned int i;
+
+	for (i = 0; i < pool->nr_threads; i++)
+		kthread_stop(pool->threads[i].task);
+	vhost_put_cgroup(pool->cgrp);
+	kfree(pool);
+}
+
+/* Takes over the reference to @cgrp */
+static struct vhost_worker_pool *vhost_worker_pool_create(struct cgroup *cgrp,
+							  unsigned int nr_threads)
+{
+	struct vhost_worker_pool *pool;
+	struct task_struct *task;
+	unsigned int i;
+	int ret;
+
+	pool = kzalloc(struct_size(pool, threads, nr_threads), GFP_KERNEL);
+	if (!pool) {
+		vhost_put_cgroup(cgrp);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	pool->cgrp = cgrp;
+
+	for (i = 0; i < nr_threads; i++) {
+		struct vhost_shared_worker *sw = &pool->threads[i];
+
+		spin_lock_init(&sw->lock);
+		INIT_LIST_HEAD(&sw->ready);
+		init_waitqueue_head(&sw->idle_wait);
+		sw->pool = pool;
+		sw->start_ns = ktime_get_ns();
+
+		task = kthread_create(vhost_shared_worker_fn, sw, "vhost-%llu/%u",
+				      cgroup_id(cgrp), i);
+		if (IS_ERR(task)) {
+			ret = PTR_ERR(task);
+			goto err;
+		}
+		sw->task = task;
+		pool->nr_threads++;
+
+		/* Account the thread like the devices it works for */
+		ret = cgroup_attach_task_all(current, task);
+		if (ret)
+			goto err;
+
+		wake_up_process(task);
+	}
+
+	return pool;
+
+err:
+	vhost_worker_pool_free(pool);
+	return ERR_PTR(ret);
+}
+
+/* Run the work of @worker from a pool thread of the cgroup of current */
+static int vhost_worker_pool_attach(struct vhost_worker *worker,
+				    struct vhost_dev *dev, unsigned int nr_threads)
+{
+	struct vhost_shared_worker *sw;
+	struct vhost_worker_pool *pool;
+	struct cgroup *cgrp;
+	unsigned int i;
+
+	cgrp = vhost_get_cgroup();
+
+	mutex_lock(&vhost_pools_mutex);
+	list_for_each_entry(pool, &vhost_worker_pools, node) {
+		if (pool->cgrp == cgrp) {
+			vhost_put_cgroup(cgrp);
+			goto found;
+		}
+	}
+
+	pool = vhost_worker_pool_create(cgrp, nr_threads);
+	if (IS_ERR(pool)) {
+		mutex_unlock(&vhost_pools_mutex);
+		return PTR_ERR(pool);
+	}
+	list_add(&pool->node, &vhost_worker_pools);
+
+found:
+	/* Spread the devices over the threads of the pool */
+	sw = &pool->threads[0];
+	for (i = 1; i < pool->nr_threads; i++) {
+		if (pool->threads[i].nr_devs < sw->nr_devs)
+			sw = &pool->threads[i];
+	}
+	sw->nr_devs++;
+	pool->refcnt++;
+	mutex_unlock(&vhost_pools_mutex);
+
+	INIT_LIST_HEAD(&worker->shared_node);
+	worker->mm = dev->mm;
+	worker->shared = sw;
+	return 0;
+}
+
+static void vhost_worker_pool_detach(struct vhost_worker *worker)
+{
+	struct vhost_shared_worker *sw = worker->shared;
+	struct vhost_worker_pool *pool = sw->pool;
+
+	spin_lock_irq(&sw->lock);
+	list_del_init(&worker->shared_node);
+	spin_unlock_irq(&sw->lock);
+	wait_event(sw->idle_wait, READ_ONCE(sw->running) != worker);
+
+	mutex_lock(&vhost_pools_mutex);
+	sw->nr_devs--;
+	if (--pool->refcnt) {
+		pool = NULL;
+	} else {
+		list_del(&pool->node);
+	}
+	mutex_unlock(&vhost_pools_mutex);
+
+	if (pool)
+		vhost_worker_pool_free(pool);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int vhost_shared_workers_show(struct seq_file *m, void *v)
+{
+	struct vhost_worker_pool *pool;
+	unsigned int i;
+
+	seq_puts(m, "cgroup thread pid devices runs busy_ns elapsed_ns wait_ns max_wait_ns\n");
+
+	mutex_lock(&vhost_pools_mutex);
+	list_for_each_entry(pool, &vhost_worker_pools, node) {
+		for (i = 0; i < pool->nr_threads; i++) {
+			struct vhost_shared_worker *sw = &pool->threads[i];
+			u64 busy, wait, max_wait, runs;
+
+			spin_lock_irq(&sw->lock);
+			busy = sw->busy_ns;
+			wait = sw->wait_ns;
+			max_wait = sw->max_wait_ns;
+			runs = sw->nr_runs;
+			spin_unlock_irq(&sw->lock);
+
+			seq_printf(m, "%llu %u %d %d %llu %llu %llu %llu %llu\n",
+				   cgroup_id(pool->cgrp), i,
+				   task_pid_nr(sw->task), sw->nr_devs, runs,
+				   busy, ktime_get_ns() - sw->start_ns,
+				   wait, max_wait);
+		}
+	}
+	mutex_unlock(&vhost_pools_mutex);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vhost_shared_workers);
+
+static struct dentry *vhost_debugfs_dir;
+#endif
+
 static void vhost_vq_free_iovecs(struct vhost_virtqueue *vq)
 {
 	kfree(vq->indirect);
@@ -596,7 +909,10 @@ static void vhost_worker_destroy(struct vhost_dev *dev,
 
 	WARN_ON(!llist_empty(&worker->work_list));
 	xa_erase(&dev->worker_xa, worker->id);
-	vhost_task_stop(worker->vtsk);
+	if (worker->shared)
+		vhost_worker_pool_detach(worker);
+	else
+		vhost_task_stop(worker->vtsk);
 	kfree(worker);
 }
 
@@ -619,7 +935,12 @@ static void vhost_workers_free(struct vhost_dev *dev)
 	xa_destroy(&dev->worker_xa);
 }
 
-static struct vhost_worker *vhost_worker_create(struct vhost_dev *dev)
+/*
+ * With @nr_shared the worker doesn't get a thread of its own, its work is
+ * run by one of @nr_shared threads shared by the devices of the cgroup.
+ */
+static struct vhost_worker *vhost_worker_create(struct vhost_dev *dev,
+						unsigned int nr_shared)
 {
 	struct vhost_worker *worker;
 	struct vhost_task *vtsk;
@@ -631,18 +952,23 @@ static struct vhost_worker *vhost_worker_create(struct vhost_dev *dev)
 	if (!worker)
 		return NULL;
 
-	snprintf(name, sizeof(name), "vhost-%d", current->pid);
-
-	vtsk = vhost_task_create(vhost_worker, worker, name);
-	if (!vtsk)
-		goto free_worker;
-
 	mutex_init(&worker->mutex);
 	init_llist_head(&worker->work_list);
 	worker->kcov_handle = kcov_common_handle();
-	worker->vtsk = vtsk;
 
-	vhost_task_start(vtsk);
+	if (nr_shared) {
+		if (vhost_worker_pool_attach(worker, dev, nr_shared))
+			goto free_worker;
+	} else {
+		snprintf(name, sizeof(name), "vhost-%d", current->pid);
+
+		vtsk = vhost_task_create(vhost_worker, worker, name);
+		if (!vtsk)
+			goto free_worker;
+
+		worker->vtsk = vtsk;
+		vhost_task_start(vtsk);
+	}
 
 	ret = xa_alloc(&dev->worker_xa, &id, worker, xa_limit_32b, GFP_KERNEL);
 	if (ret < 0)
@@ -652,7 +978,10 @@ static struct vhost_worker *vhost_worker_create(struct vhost_dev *dev)
 	return worker;
 
 stop_worker:
-	vhost_task_stop(vtsk);
+	if (worker->shared)
+		vhost_worker_pool_detach(worker);
+	else
+		vhost_task_stop(worker->vtsk);
 free_worker:
 	kfree(worker);
 	return NULL;
@@ -734,7 +1063,7 @@ static int vhost_new_worker(struct vhost_dev *dev,
 {
 	struct vhost_worker *worker;
 
-	worker = vhost_worker_create(dev);
+	worker = vhost_worker_create(dev, 0);
 	if (!worker)
 		return -ENOMEM;
 
@@ -886,7 +1215,7 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 		 * below since we don't have to worry about vsock queueing
 		 * while we free the worker.
 		 */
-		worker = vhost_worker_create(dev);
+		worker = vhost_worker_create(dev, READ_ONCE(shared_workers));
 		if (!worker) {
 			err = -ENOMEM;
 			goto err_worker;
@@ -1365,6 +1694,7 @@ static bool umem_access_ok(u64 uaddr, u64 size, int access)
 	return true;
 }
 
+/* Caller must hold the device mutex and the mutexes of all vqs */
 static int vhost_process_iotlb_msg(struct vhost_dev *dev, u32 asid,
 				   struct vhost_iotlb_msg *msg)
 {
@@ -1373,8 +1703,6 @@ static int vhost_process_iotlb_msg(struct vhost_dev *dev, u32 asid,
 	if (asid != 0)
 		return -EINVAL;
 
-	mutex_lock(&dev->mutex);
-	vhost_dev_lock_vqs(dev);
 	switch (msg->type) {
 	case VHOST_IOTLB_UPDATE:
 		if (!dev->iotlb) {
@@ -1408,18 +1736,17 @@ static int vhost_process_iotlb_msg(struct vhost_dev *dev, u32 asid,
 		break;
 	}
 
-	vhost_dev_unlock_vqs(dev);
-	mutex_unlock(&dev->mutex);
-
 	return ret;
 }
-ssize_t vhost_chr_write_iter(struct vhost_dev *dev,
-			     struct iov_iter *from)
+
+/* Returns the size of the message read from @from, or a negative error */
+static int vhost_chr_get_msg(struct vhost_dev *dev, struct iov_iter *from,
+			     struct vhost_iotlb_msg *msg, u32 *asid)
 {
-	struct vhost_iotlb_msg msg;
 	size_t offset;
 	int type, ret;
-	u32 asid = 0;
+
+	*asid = 0;
 
 	ret = copy_from_iter(&type, sizeof(type), from);
 	if (ret != sizeof(type)) {
@@ -1437,8 +1764,8 @@ ssize_t vhost_chr_write_iter(struct vhost_dev *dev,
 	case VHOST_IOTLB_MSG_V2:
 		if (vhost_backend_has_feature(dev->vqs[0],
 					      VHOST_BACKEND_F_IOTLB_ASID)) {
-			ret = copy_from_iter(&asid, sizeof(asid), from);
-			if (ret != sizeof(asid)) {
+			ret = copy_from_iter(asid, sizeof(*asid), from);
+			if (ret != sizeof(*asid)) {
 				ret = -EINVAL;
 				goto done;
 			}
@@ -1452,33 +1779,71 @@ ssize_t vhost_chr_write_iter(struct vhost_dev *dev,
 	}
 
 	iov_iter_advance(from, offset);
-	ret = copy_from_iter(&msg, sizeof(msg), from);
-	if (ret != sizeof(msg)) {
+	ret = copy_from_iter(msg, sizeof(*msg), from);
+	if (ret != sizeof(*msg)) {
 		ret = -EINVAL;
 		goto done;
 	}
 
-	if ((msg.type == VHOST_IOTLB_UPDATE ||
-	     msg.type == VHOST_IOTLB_INVALIDATE) &&
-	     msg.size == 0) {
+	if ((msg->type == VHOST_IOTLB_UPDATE ||
+	     msg->type == VHOST_IOTLB_INVALIDATE) &&
+	     msg->size == 0) {
 		ret = -EINVAL;
 		goto done;
 	}
 
-	if (dev->msg_handler)
-		ret = dev->msg_handler(dev, asid, &msg);
-	else
-		ret = vhost_process_iotlb_msg(dev, asid, &msg);
-	if (ret) {
-		ret = -EFAULT;
-		goto done;
-	}
-
 	ret = (type == VHOST_IOTLB_MSG) ? sizeof(struct vhost_msg) :
 	      sizeof(struct vhost_msg_v2);
 done:
 	return ret;
 }
+
+/*
+ * A write can carry several messages back to back. They are processed in
+ * order, and for devices without a msg_handler under a single hold of the
+ * device and vq mutexes, so that e.g. a burst of invalidations only stops
+ * the vqs once.  Returns the size of the messages processed, or the error
+ * of the first message.
+ */
+ssize_t vhost_chr_write_iter(struct vhost_dev *dev,
+			     struct iov_iter *from)
+{
+	struct vhost_iotlb_msg msg;
+	bool locked = false;
+	ssize_t done = 0;
+	u32 asid;
+	int ret;
+
+	do {
+		ret = vhost_chr_get_msg(dev, from, &msg, &asid);
+		if (ret < 0)
+			break;
+
+		if (dev->msg_handler) {
+			if (dev->msg_handler(dev, asid, &msg))
+				ret = -EFAULT;
+		} else {
+			if (!locked) {
+				mutex_lock(&dev->mutex);
+				vhost_dev_lock_vqs(dev);
+				locked = true;
+			}
+			if (vhost_process_iotlb_msg(dev, asid, &msg))
+				ret = -EFAULT;
+		}
+		if (ret < 0)
+			break;
+
+		done += ret;
+	} while (iov_iter_count(from));
+
+	if (locked) {
+		vhost_dev_unlock_vqs(dev);
+		mutex_unlock(&dev->mutex);
+	}
+
+	return done ? done : ret;
+}
 EXPORT_SYMBOL(vhost_chr_write_iter);
 
 __poll_t vhost_chr_poll(struct file *file, struct vhost_dev *dev,
@@ -1765,6 +2130,7 @@ static long vhost_set_memory(struct vhost_dev *d, struct vhost_memory __user *m)
 	for (i = 0; i < d->nvqs; ++i) {
 		mutex_lock(&d->vqs[i]->mutex);
 		d->vqs[i]->umem = newumem;
+		vhost_vq_tlb_reset(d->vqs[i]);
 		mutex_unlock(&d->vqs[i]->mutex);
 	}
 
@@ -2331,6 +2697,30 @@ int vhost_vq_init_access(struct vhost_virtqueue *vq)
 }
 EXPORT_SYMBOL_GPL(vhost_vq_init_access);
 
+/*
+ * Lookup @addr in the per vq cache of the last maps used before going to
+ * the interval tree. The maps don't overlap, so the result is the same.
+ */
+static const struct vhost_iotlb_map *
+vhost_vq_tlb_lookup(struct vhost_virtqueue *vq, struct vhost_iotlb *umem,
+		    u64 addr, u64 last)
+{
+	const struct vhost_iotlb_map *map;
+	int i;
+
+	for (i = 0; i < VHOST_VQ_TLB_SIZE; i++) {
+		map = vq->tlb[i];
+		if (map && map->start <= addr && addr <= map->last)
+			return map;
+	}
+
+	map = vhost_iotlb_itree_first(umem, addr, last);
+	if (map && map->start <= addr)
+		vq->tlb[vq->tlb_next++ % VHOST_VQ_TLB_SIZE] = map;
+
+	return map;
+}
+
 static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			  struct iovec iov[], int iov_size, int access)
 {
@@ -2348,7 +2738,7 @@ static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			break;
 		}
 
-		map = vhost_iotlb_itree_first(umem, addr, last);
+		map = vhost_vq_tlb_lookup(vq, umem, addr, last);
 		if (map == NULL || map->start > addr) {
 			if (umem != dev->iotlb) {
 				ret = -EFAULT;
@@ -2923,11 +3313,19 @@ EXPORT_SYMBOL_GPL(vhost_set_backend_features);
 
 static int __init vhost_init(void)
 {
+#ifdef CONFIG_DEBUG_FS
+	vhost_debugfs_dir = debugfs_create_dir("vhost", NULL);
+	debugfs_create_file("shared_workers", 0444, vhost_debugfs_dir, NULL,
+			    &vhost_shared_workers_fops);
+#endif
 	return 0;
 }
 
 static void __exit vhost_exit(void)
 {
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove_recursive(vhost_debugfs_dir);
+#endif
 }
 
 module_init(vhost_init);
@@ -17,6 +17,7 @@
 
 struct vhost_work;
 struct vhost_task;
+struct vhost_shared_worker;
 typedef void (*vhost_work_fn_t)(struct vhost_work *work);
 
 #define VHOST_WORK_QUEUED 1
@@ -26,6 +27,7 @@ struct vhost_work {
 	unsigned long		flags;
 };
 
+#define VHOST_WORKER_QUEUED 0
 struct vhost_worker {
 	struct vhost_task	*vtsk;
 	/* Used to serialize device wide flushing with worker swapping. */
@@ -34,6 +36,12 @@ struct vhost_worker {
 	u64			kcov_handle;
 	u32			id;
 	int			attachment_cnt;
+	/* Set instead of vtsk if the work is run by a shared pool thread. */
+	struct vhost_shared_worker *shared;
+	struct list_head	shared_node;
+	unsigned long		shared_flags;
+	u64			queued_ns;
+	struct mm_struct	*mm;
 };
 
 /* Poll a file (eventfd or socket) */
@@ -75,6 +83,8 @@ struct vhost_vring_call {
 	struct irq_bypass_producer producer;
 };
 
+#define VHOST_VQ_TLB_SIZE 4
+
 /* The virtqueue structure describes a queue attached to a device. */
 struct vhost_virtqueue {
 	struct vhost_dev *dev;
@@ -87,6 +97,9 @@ struct vhost_virtqueue {
 	vring_avail_t __user *avail;
 	vring_used_t __user *used;
 	const struct vhost_iotlb_map *meta_iotlb[VHOST_NUM_ADDRS];
+	/* Last translations done for descriptors, see translate_desc() */
+	const struct vhost_iotlb_map *tlb[VHOST_VQ_TLB_SIZE];
+	unsigned int tlb_next;
 	struct file *kick;
 	struct vhost_vring_call call_ctx;
 	struct eventfd_ctx *error_ctx;
@@ -77,6 +77,8 @@ struct vring_desc_state_packed {
 	struct vring_packed_desc *indir_desc; /* Indirect descriptor, if any. */
 	u16 num;			/* Descriptor list length. */
 	u16 last;			/* The last desc state in a list. */
+	u16 next_in_order;		/* The buffer added after this one. */
+	u32 total_in_len;		/* Device writable length, for in order. */
 };
 
 struct vring_desc_extra {
@@ -139,6 +141,18 @@ struct vring_virtqueue_packed {
 	 */
 	u16 event_flags_shadow;
 
+	/*
+	 * VIRTIO_F_IN_ORDER: the device may mark a whole batch of buffers
+	 * used with a single descriptor carrying the id of the last one.
+	 * The outstanding buffers are kept in a list in the order they were
+	 * added, @in_order_pending of them are used but not returned yet.
+	 */
+	bool in_order;
+	u16 in_order_head;
+	u16 in_order_tail;
+	u16 in_order_pending;
+	u32 in_order_len;
+
 	/* Per-descriptor state. */
 	struct vring_desc_state_packed *desc_state;
 	struct vring_desc_extra *desc_extra;
@@ -160,6 +174,12 @@ struct vring_virtqueue {
 	/* Is DMA API used? */
 	bool use_dma_api;
 
+	/* Does the driver map the buffers itself? */
+	bool premapped;
+
+	/* Do the buffers need to be unmapped on detach? */
+	bool do_unmap;
+
 	/* Can we use weak barriers? */
 	bool weak_barriers;
 
@@ -359,6 +379,9 @@ static dma_addr_t vring_map_one_sg(const struct vring_virtqueue *vq,
 				   struct scatterlist *sg,
 				   enum dma_data_direction direction)
 {
+	if (vq->premapped)
+		return sg_dma_address(sg);
+
 	if (!vq->use_dma_api) {
 		/*
 		 * If DMA is not used, KMSAN doesn't know that the scatterlist
@@ -427,7 +450,7 @@ static void vring_unmap_one_split_indirect(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->do_unmap)
 		return;
 
 	flags = virtio16_to_cpu(vq->vq.vdev, desc->flags);
@@ -451,12 +474,13 @@ static unsigned int vring_unmap_one_split(const struct vring_virtqueue *vq,
 	flags = extra[i].flags;
 
 	if (flags & VRING_DESC_F_INDIRECT) {
+		/* The indirect table is mapped by us even if premapped */
 		dma_unmap_single(vring_dma_dev(vq),
 				 extra[i].addr,
 				 extra[i].len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (vq->do_unmap) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra[i].addr,
 			       extra[i].len,
@@ -774,8 +798,10 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 				VRING_DESC_F_INDIRECT));
 		BUG_ON(len == 0 || len % sizeof(struct vring_desc));
 
-		for (j = 0; j < len / sizeof(struct vring_desc); j++)
-			vring_unmap_one_split_indirect(vq, &indir_desc[j]);
+		if (vq->do_unmap) {
+			for (j = 0; j < len / sizeof(struct vring_desc); j++)
+				vring_unmap_one_split_indirect(vq, &indir_desc[j]);
+		}
 
 		kfree(indir_desc);
 		vq->split.desc_state[head].indir_desc = NULL;
@@ -790,9 +816,20 @@ static bool more_used_split(const struct vring_virtqueue *vq)
 			vq->split.vring.used->idx);
 }
 
+static void virtqueue_update_used_event_split(struct vring_virtqueue *vq)
+{
+	/* If we expect an interrupt for the next entry, tell host
+	 * by writing event index and flush out the write before
+	 * the read in the next get_buf call. */
+	if (!(vq->split.avail_flags_shadow & VRING_AVAIL_F_NO_INTERRUPT))
+		virtio_store_mb(vq->weak_barriers,
+				&vring_used_event(&vq->split.vring),
+				cpu_to_virtio16(vq->vq.vdev, vq->last_used_idx));
+}
+
 static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 					 unsigned int *len,
-					 void **ctx)
+					 void **ctx, bool update_event)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
 	void *ret;
@@ -834,13 +871,8 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 	ret = vq->split.desc_state[i].data;
 	detach_buf_split(vq, i, ctx);
 	vq->last_used_idx++;
-	/* If we expect an interrupt for the next entry, tell host
-	 * by writing event index and flush out the write before
-	 * the read in the next get_buf call. */
-	if (!(vq->split.avail_flags_shadow & VRING_AVAIL_F_NO_INTERRUPT))
-		virtio_store_mb(vq->weak_barriers,
-				&vring_used_event(&vq->split.vring),
-				cpu_to_virtio16(_vq->vdev, vq->last_used_idx));
+	if (update_event)
+		virtqueue_update_used_event_split(vq);
 
 	LAST_ADD_TIME_INVALID(vq);
 
@@ -1205,7 +1237,7 @@ static void vring_unmap_extra_packed(const struct vring_virtqueue *vq,
 				 extra->addr, extra->len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (vq->do_unmap) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra->addr, extra->len,
 			       (flags & VRING_DESC_F_WRITE) ?
@@ -1218,7 +1250,7 @@ static void vring_unmap_desc_packed(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->do_unmap)
 		return;
 
 	flags = le16_to_cpu(desc->flags);
@@ -1247,6 +1279,30 @@ static struct vring_packed_desc *alloc_indirect_packed(unsigned int total_sg,
 	return desc;
 }
 
+static void vring_in_order_reset_packed(struct vring_virtqueue *vq)
+{
+	vq->packed.in_order_head = vq->packed.vring.num;
+	vq->packed.in_order_tail = vq->packed.vring.num;
+	vq->packed.in_order_pending = 0;
+}
+
+static void vring_in_order_add_packed(struct vring_virtqueue *vq, u16 id,
+				      u32 in_len)
+{
+	struct vring_desc_state_packed *state = vq->packed.desc_state;
+
+	if (!vq->packed.in_order)
+		return;
+
+	state[id].total_in_len = in_len;
+	state[id].next_in_order = vq->packed.vring.num;
+	if (vq->packed.in_order_tail == vq->packed.vring.num)
+		vq->packed.in_order_head = id;
+	else
+		state[vq->packed.in_order_tail].next_in_order = id;
+	vq->packed.in_order_tail = id;
+}
+
 static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 					 struct scatterlist *sgs[],
 					 unsigned int total_sg,
@@ -1261,6 +1317,8 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	u16 head, id;
 	dma_addr_t addr;
 
+	u32 in_len = 0;
+
 	head = vq->packed.next_avail_idx;
 	desc = alloc_indirect_packed(total_sg, gfp);
 	if (!desc)
@@ -1288,6 +1346,8 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 						0 : VRING_DESC_F_WRITE);
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
+			if (n >= out_sgs)
+				in_len += sg->length;
 			i++;
 		}
 	}
@@ -1341,6 +1401,7 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = desc;
 	vq->packed.desc_state[id].last = id;
+	vring_in_order_add_packed(vq, id, in_len);
 
 	vq->num_added += 1;
 
@@ -1376,6 +1437,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	unsigned int i, n, c, descs_used, err_idx;
 	__le16 head_flags, flags;
 	u16 head, id, prev, curr, avail_used_flags;
+	u32 in_len = 0;
 	int err;
 
 	START_USE(vq);
@@ -1442,6 +1504,8 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
 			desc[i].id = cpu_to_le16(id);
+			if (n >= out_sgs)
+				in_len += sg->length;
 
 			if (unlikely(vq->use_dma_api)) {
 				vq->packed.desc_extra[curr].addr = addr;
@@ -1476,6 +1540,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = ctx;
 	vq->packed.desc_state[id].last = prev;
+	vring_in_order_add_packed(vq, id, in_len);
 
 	/*
 	 * A driver MUST NOT make the first descriptor in the list
@@ -1594,7 +1659,7 @@ static void detach_buf_packed(struct vring_virtqueue *vq,
 		if (!desc)
 			return;
 
-		if (vq->use_dma_api) {
+		if (vq->do_unmap) {
 			len = vq->packed.desc_extra[id].len;
 			for (i = 0; i < len / sizeof(struct vring_packed_desc);
 					i++)
@@ -1626,15 +1691,102 @@ static bool more_used_packed(const struct vring_virtqueue *vq)
 	u16 last_used_idx;
 	bool used_wrap_counter;
 
+	if (vq->packed.in_order_pending)
+		return true;
+
 	last_used_idx = READ_ONCE(vq->last_used_idx);
 	last_used = packed_last_used(last_used_idx);
 	used_wrap_counter = packed_used_wrap_counter(last_used_idx);
 	return is_used_desc_packed(vq, last_used, used_wrap_counter);
 }
 
+static void virtqueue_update_used_event_packed(struct vring_virtqueue *vq)
+{
+	/*
+	 * If we expect an interrupt for the next entry, tell host
+	 * by writing event index and flush out the write before
+	 * the read in the next get_buf call.
+	 */
+	if (vq->packed.event_flags_shadow == VRING_PACKED_EVENT_FLAG_DESC)
+		virtio_store_mb(vq->weak_barriers,
+				&vq->packed.vring.driver->off_wrap,
+				cpu_to_le16(vq->last_used_idx));
+}
+
+/*
+ * Return the oldest buffer of the batch the device marked used, reading
+ * the next used descriptor first if the previous batch is done.
+ */
+static void *virtqueue_get_buf_in_order_packed(struct vring_virtqueue *vq,
+					       unsigned int *len, void **ctx)
+{
+	struct vring_desc_state_packed *state = vq->packed.desc_state;
+	u16 last_used, id, last_used_idx, n, num;
+	bool used_wrap_counter;
+	void *ret;
+
+	if (!vq->packed.in_order_pending) {
+		last_used_idx = READ_ONCE(vq->last_used_idx);
+		used_wrap_counter = packed_used_wrap_counter(last_used_idx);
+		last_used = packed_last_used(last_used_idx);
+		id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
+		vq->packed.in_order_len =
+			le32_to_cpu(vq->packed.vring.desc[last_used].len);
+
+		if (unlikely(id >= vq->packed.vring.num)) {
+			BAD_RING(vq, "id %u out of range\n", id);
+			return NULL;
+		}
+		if (unlikely(!state[id].data)) {
+			BAD_RING(vq, "id %u is not a head!\n", id);
+			return NULL;
+		}
+
+		/* The batch goes from the oldest buffer up to @id */
+		n = 0;
+		num = vq->packed.in_order_head;
+		last_used += state[num].num;
+		while (num != id) {
+			num = state[num].next_in_order;
+			if (unlikely(num == vq->packed.vring.num)) {
+				BAD_RING(vq, "id %u is not in order\n", id);
+				return NULL;
+			}
+			last_used += state[num].num;
+			n++;
+		}
+		vq->packed.in_order_pending = n + 1;
+
+		/* The device skips the descriptors of the whole batch */
+		if (last_used >= vq->packed.vring.num) {
+			last_used -= vq->packed.vring.num;
+			used_wrap_counter ^= 1;
+		}
+		last_used = (last_used | (used_wrap_counter << VRING_PACKED_EVENT_F_WRAP_CTR));
+		WRITE_ONCE(vq->last_used_idx, last_used);
+	}
+
+	id = vq->packed.in_order_head;
+	vq->packed.in_order_head = state[id].next_in_order;
+	if (vq->packed.in_order_head == vq->packed.vring.num)
+		vq->packed.in_order_tail = vq->packed.vring.num;
+
+	/* Only the last buffer of a batch has its length reported */
+	if (--vq->packed.in_order_pending)
+		*len = state[id].total_in_len;
+	else
+		*len = vq->packed.in_order_len;
+
+	/* detach_buf_packed clears data, so grab it now. */
+	ret = state[id].data;
+	detach_buf_packed(vq, id, ctx);
+
+	return ret;
+}
+
 static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 					  unsigned int *len,
-					  void **ctx)
+					  void **ctx, bool update_event)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
 	u16 last_used, id, last_used_idx;
@@ -1657,6 +1809,11 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 	/* Only get used elements after they have been exposed by host. */
 	virtio_rmb(vq->weak_barriers);
 
+	if (vq->packed.in_order) {
+		ret = virtqueue_get_buf_in_order_packed(vq, len, ctx);
+		goto out;
+	}
+
 	last_used_idx = READ_ONCE(vq->last_used_idx);
 	used_wrap_counter = packed_used_wrap_counter(last_used_idx);
 	last_used = packed_last_used(last_used_idx);
@@ -1685,15 +1842,9 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 	last_used = (last_used | (used_wrap_counter << VRING_PACKED_EVENT_F_WRAP_CTR));
 	WRITE_ONCE(vq->last_used_idx, last_used);
 
-	/*
-	 * If we expect an interrupt for the next entry, tell host
-	 * by writing event index and flush out the write before
-	 * the read in the next get_buf call.
-	 */
-	if (vq->packed.event_flags_shadow == VRING_PACKED_EVENT_FLAG_DESC)
-		virtio_store_mb(vq->weak_barriers,
-				&vq->packed.vring.driver->off_wrap,
-				cpu_to_le16(vq->last_used_idx));
+out:
+	if (ret && update_event)
+		virtqueue_update_used_event_packed(vq);
 
 	LAST_ADD_TIME_INVALID(vq);
 
@@ -1759,6 +1910,9 @@ static bool virtqueue_poll_packed(struct virtqueue *_vq, u16 off_wrap)
 	bool wrap_counter;
 	u16 used_idx;
 
+	if (vq->packed.in_order_pending)
+		return true;
+
 	wrap_counter = off_wrap >> VRING_PACKED_EVENT_F_WRAP_CTR;
 	used_idx = off_wrap & ~(1 << VRING_PACKED_EVENT_F_WRAP_CTR);
 
@@ -1817,7 +1971,8 @@ static bool virtqueue_enable_cb_delayed_packed(struct virtqueue *_vq)
 	last_used_idx = READ_ONCE(vq->last_used_idx);
 	wrap_counter = packed_used_wrap_counter(last_used_idx);
 	used_idx = packed_last_used(last_used_idx);
-	if (is_used_desc_packed(vq, used_idx, wrap_counter)) {
+	if (vq->packed.in_order_pending ||
+	    is_used_desc_packed(vq, used_idx, wrap_counter)) {
 		END_USE(vq);
 		return false;
 	}
@@ -1845,6 +2000,7 @@ static void *virtqueue_detach_unused_buf_packed(struct virtqueue *_vq)
 	}
 	/* That should have freed everything. */
 	BUG_ON(vq->vq.num_free != vq->packed.vring.num);
+	vring_in_order_reset_packed(vq);
 
 	END_USE(vq);
 	return NULL;
@@ -2010,6 +2166,7 @@ static void virtqueue_reinit_packed(struct vring_virtqueue *vq)
 
 	virtqueue_init(vq, vq->packed.vring.num);
 	virtqueue_vring_init_packed(&vq->packed, !!vq->vq.callback);
+	vring_in_order_reset_packed(vq);
 }
 
 static struct virtqueue *vring_create_virtqueue_packed(
@@ -2052,6 +2209,8 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	vq->packed_ring = true;
 	vq->dma_dev = dma_dev;
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->premapped = false;
+	vq->do_unmap = vq->use_dma_api;
 
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
@@ -2068,6 +2227,8 @@ static struct virtqueue *vring_create_virtqueue_packed(
 
 	virtqueue_init(vq, num);
 	virtqueue_vring_attach_packed(vq, &vring_packed);
+	vq->packed.in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
+	vring_in_order_reset_packed(vq);
 
 	spin_lock(&vdev->vqs_list_lock);
 	list_add_tail(&vq->vq.list, &vdev->vqs);
@@ -2102,6 +2263,7 @@ static int virtqueue_resize_packed(struct virtqueue *_vq, u32 num)
 
 	virtqueue_init(vq, vring_packed.vring.num);
 	virtqueue_vring_attach_packed(vq, &vring_packed);
+	vring_in_order_reset_packed(vq);
 
 	return 0;
 
@@ -2323,8 +2485,9 @@ void *virtqueue_get_buf_ctx(struct virtqueue *_vq, unsigned int *len,
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
 
-	return vq->packed_ring ? virtqueue_get_buf_ctx_packed(_vq, len, ctx) :
-				 virtqueue_get_buf_ctx_split(_vq, len, ctx);
+	return vq->packed_ring ?
+		virtqueue_get_buf_ctx_packed(_vq, len, ctx, true) :
+		virtqueue_get_buf_ctx_split(_vq, len, ctx, true);
 }
 EXPORT_SYMBOL_GPL(virtqueue_get_buf_ctx);
 
@@ -2333,6 +2496,50 @@ void *virtqueue_get_buf(struct virtqueue *_vq, unsigned int *len)
 	return virtqueue_get_buf_ctx(_vq, len, NULL);
 }
 EXPORT_SYMBOL_GPL(virtqueue_get_buf);
+
+/**
+ * virtqueue_get_bufs - get a batch of used buffers
+ * @_vq: the struct virtqueue we're talking about.
+ * @bufs: array receiving the "data" tokens handed to virtqueue_add_*()
+ * @lens: array receiving the length written into each buffer, or NULL
+ * @max: the size of @bufs and @lens
+ *
+ * Like calling virtqueue_get_buf() up to @max times, but the used event
+ * index is only updated once, after the last buffer.
+ *
+ * Caller must ensure we don't call this with other virtqueue
+ * operations at the same time (except where noted).
+ *
+ * Returns the number of buffers returned in @bufs.
+ */
+unsigned int virtqueue_get_bufs(struct virtqueue *_vq, void **bufs,
+				unsigned int *lens, unsigned int max)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int i, len;
+
+	for (i = 0; i < max; i++) {
+		bufs[i] = vq->packed_ring ?
+			virtqueue_get_buf_ctx_packed(_vq, &len, NULL, false) :
+			virtqueue_get_buf_ctx_split(_vq, &len, NULL, false);
+		if (!bufs[i])
+			break;
+		if (lens)
+			lens[i] = len;
+	}
+
+	if (i && !vq->broken) {
+		START_USE(vq);
+		if (vq->packed_ring)
+			virtqueue_update_used_event_packed(vq);
+		else
+			virtqueue_update_used_event_split(vq);
+		END_USE(vq);
+	}
+
+	return i;
+}
+EXPORT_SYMBOL_GPL(virtqueue_get_bufs);
 /**
  * virtqueue_disable_cb - disable callbacks
  * @_vq: the struct virtqueue we're talking about.
@@ -2541,6 +2748,8 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 #endif
 	vq->dma_dev = dma_dev;
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->premapped = false;
+	vq->do_unmap = vq->use_dma_api;
 
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
@@ -2796,6 +3005,11 @@ void vring_transport_features(struct virtio_device *vdev)
 			break;
 		case VIRTIO_F_RING_PACKED:
 			break;
+		case VIRTIO_F_IN_ORDER:
+			/* Only implemented for the packed ring. */
+			if (!__virtio_test_bit(vdev, VIRTIO_F_RING_PACKED))
+				__virtio_clear_bit(vdev, i);
+			break;
 		case VIRTIO_F_ORDER_PLATFORM:
 			break;
 		case VIRTIO_F_NOTIFICATION_DATA:
@@ -2938,6 +3152,195 @@ dma_addr_t virtqueue_get_used_addr(const struct virtqueue *_vq)
 }
 EXPORT_SYMBOL_GPL(virtqueue_get_used_addr);
 
+/**
+ * virtqueue_set_dma_premapped - let the driver map the buffers itself
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * In premapped mode the sg entries passed to virtqueue_add_*() carry the
+ * DMA address in sg_dma_address(), and the buffers returned by
+ * virtqueue_get_buf() or virtqueue_detach_unused_buf() are not unmapped.
+ * This lets a driver map long lived buffers once, with the helpers below,
+ * instead of for every use.
+ *
+ * Must be called before any buffer is added, with the same exclusion as
+ * the other operations on the vq.
+ *
+ * Returns zero or a negative error.
+ * 0: success.
+ * -EBUSY: buffers are outstanding.
+ * -EINVAL: the vq doesn't use the DMA API.
+ */
+int virtqueue_set_dma_premapped(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	u32 num;
+
+	START_USE(vq);
+
+	num = vq->packed_ring ? vq->packed.vring.num : vq->split.vring.num;
+	if (num != vq->vq.num_free) {
+		END_USE(vq);
+		return -EBUSY;
+	}
+
+	if (!vq->use_dma_api) {
+		END_USE(vq);
+		return -EINVAL;
+	}
+
+	vq->premapped = true;
+	vq->do_unmap = false;
+
+	END_USE(vq);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(virtqueue_set_dma_premapped);
+
+/**
+ * virtqueue_dma_dev - get the device to map buffers of the vq with
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Returns NULL if the vq doesn't use the DMA API.
+ */
+struct device *virtqueue_dma_dev(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (vq->use_dma_api)
+		return vring_dma_dev(vq);
+	return NULL;
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_dev);
+
+/**
+ * virtqueue_dma_map_page_attrs - map a page for a premapped vq
+ * @_vq: the struct virtqueue we're talking about.
+ * @page: the page to map
+ * @offset: offset of the buffer in @page
+ * @size: size of the buffer
+ * @dir: DMA direction
+ * @attrs: DMA attributes
+ *
+ * The address has to be checked with virtqueue_dma_mapping_error().
+ */
+dma_addr_t virtqueue_dma_map_page_attrs(struct virtqueue *_vq,
+					struct page *page, size_t offset,
+					size_t size,
+					enum dma_data_direction dir,
+					unsigned long attrs)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api) {
+		kmsan_handle_dma(page, offset, size, dir);
+		return page_to_phys(page) + offset;
+	}
+
+	return dma_map_page_attrs(vring_dma_dev(vq), page, offset, size,
+				  dir, attrs);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_map_page_attrs);
+
+/**
+ * virtqueue_dma_unmap_page_attrs - unmap a page mapped for a premapped vq
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the address returned by virtqueue_dma_map_page_attrs()
+ * @size: size of the buffer
+ * @dir: DMA direction
+ * @attrs: DMA attributes
+ */
+void virtqueue_dma_unmap_page_attrs(struct virtqueue *_vq, dma_addr_t addr,
+				    size_t size, enum dma_data_direction dir,
+				    unsigned long attrs)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return;
+
+	dma_unmap_page_attrs(vring_dma_dev(vq), addr, size, dir, attrs);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_unmap_page_attrs);
+
+/**
+ * virtqueue_dma_mapping_error - check an address mapped for the vq
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the address to check
+ */
+int virtqueue_dma_mapping_error(struct virtqueue *_vq, dma_addr_t addr)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	return vring_mapping_error(vq, addr);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_mapping_error);
+
+/**
+ * virtqueue_dma_need_sync - check if a mapping of the vq needs syncs
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the address to check
+ *
+ * Buffers the driver keeps mapped across uses have to be synced before
+ * each use if this returns true.
+ */
+bool virtqueue_dma_need_sync(struct virtqueue *_vq, dma_addr_t addr)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return false;
+
+	return dma_need_sync(vring_dma_dev(vq), addr);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_need_sync);
+
+/**
+ * virtqueue_dma_sync_single_range_for_cpu - sync a mapping for the cpu
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the mapped address
+ * @offset: offset of the range to sync
+ * @size: size of the range to sync
+ * @dir: DMA direction
+ */
+void virtqueue_dma_sync_single_range_for_cpu(struct virtqueue *_vq,
+					     dma_addr_t addr,
+					     unsigned long offset, size_t size,
+					     enum dma_data_direction dir)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return;
+
+	dma_sync_single_range_for_cpu(vring_dma_dev(vq), addr, offset,
+				      size, dir);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_sync_single_range_for_cpu);
+
+/**
+ * virtqueue_dma_sync_single_range_for_device - sync a mapping for the device
+ * @_vq: the struct virtqueue we're talking about.
+ * @addr: the mapped address
+ * @offset: offset of the range to sync
+ * @size: size of the range to sync
+ * @dir: DMA direction
+ */
+void virtqueue_dma_sync_single_range_for_device(struct virtqueue *_vq,
+						dma_addr_t addr,
+						unsigned long offset,
+						size_t size,
+						enum dma_data_direction dir)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (!vq->use_dma_api)
+		return;
+
+	dma_sync_single_range_for_device(vring_dma_dev(vq), addr, offset,
+					 size, dir);
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_sync_single_range_for_device);
+
 /* Only available for split ring */
 const struct vring *virtqueue_get_vring(const struct virtqueue *vq)
 {
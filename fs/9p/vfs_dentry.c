@@ -30,11 +30,18 @@
  */
 static int v9fs_cached_dentry_delete(const struct dentry *dentry)
 {
+	struct v9fs_session_info *v9ses = dentry->d_sb->s_fs_info;
+
 	p9_debug(P9_DEBUG_VFS, " dentry: %pd (%p)\n",
 		 dentry, dentry);
 
-	/* Don't cache negative dentries */
-	if (d_really_is_negative(dentry))
+	/*
+	 * Only cache negative dentries with loose consistency: nothing would
+	 * tell us about a file created on the server side otherwise. Builds
+	 * spend a lot of their lookups on names that don't exist, e.g. along
+	 * the include paths.
+	 */
+	if (d_really_is_negative(dentry) && !(v9ses->cache & CACHE_LOOSE))
 		return 1;
 	return 0;
 }
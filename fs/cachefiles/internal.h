@@ -114,8 +114,11 @@ struct cachefiles_cache {
 	unsigned long			req_id_next;
 	struct xarray			ondemand_ids;	/* xarray for ondemand_id allocation */
 	u32				ondemand_id_next;
+	size_t				ondemand_ra;	/* min length of on-demand reads */
 };
 
+#define CACHEFILES_ONDEMAND_RA_MAX	(16UL << 20)
+
 static inline bool cachefiles_in_ondemand_mode(struct cachefiles_cache *cache)
 {
 	return IS_ENABLED(CONFIG_CACHEFILES_ONDEMAND) &&
@@ -290,6 +293,8 @@ extern ssize_t cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
 extern int cachefiles_ondemand_copen(struct cachefiles_cache *cache,
 				     char *args);
 
+extern int cachefiles_ondemand_ra(struct cachefiles_cache *cache, char *args);
+
 extern int cachefiles_ondemand_init_object(struct cachefiles_object *object);
 extern void cachefiles_ondemand_clean_object(struct cachefiles_object *object);
 
@@ -398,7 +398,7 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 	struct file *file = cachefiles_cres_file(cres);
 	enum netfs_io_source ret = NETFS_DOWNLOAD_FROM_SERVER;
 	size_t len = *_len;
-	loff_t off, to;
+	loff_t off, to, hole_end;
 	ino_t ino = file ? file_inode(file)->i_ino : 0;
 	int rc;
 
@@ -432,11 +432,13 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 	cache = object->volume->cache;
 	cachefiles_begin_secure(cache, &saved_cred);
 retry:
+	hole_end = start + len;
 	off = cachefiles_inject_read_error();
 	if (off == 0)
 		off = vfs_llseek(file, start, SEEK_DATA);
 	if (off < 0 && off >= (loff_t)-MAX_ERRNO) {
 		if (off == (loff_t)-ENXIO) {
+			hole_end = i_size;
 			why = cachefiles_trace_read_seek_nxio;
 			goto download_and_store;
 		}
@@ -447,6 +449,7 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 	}
 
 	if (off >= start + len) {
+		hole_end = min_t(loff_t, off, i_size);
 		why = cachefiles_trace_read_found_hole;
 		goto download_and_store;
 	}
@@ -485,7 +488,14 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 download_and_store:
 	__set_bit(NETFS_SREQ_COPY_TO_CACHE, _flags);
 	if (test_bit(NETFS_SREQ_ONDEMAND, _flags)) {
-		rc = cachefiles_ondemand_read(object, start, len);
+		/* Have the daemon fill more of the hole if asked to */
+		size_t ra = READ_ONCE(cache->ondemand_ra);
+
+		if (ra > len && hole_end > start + len)
+			ra = min_t(loff_t, ra, hole_end - start);
+		else
+			ra = len;
+		rc = cachefiles_ondemand_read(object, start, ra);
 		if (!rc) {
 			__clear_bit(NETFS_SREQ_ONDEMAND, _flags);
 			goto retry;
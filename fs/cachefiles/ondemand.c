@@ -181,6 +181,31 @@ int cachefiles_ondemand_copen(struct cachefiles_cache *cache, char *args)
 	return ret;
 }
 
+/*
+ * Set the minimum length of the READ requests sent for a missing range:
+ * "ra <bytes>". Longer requests let the daemon fetch the neighbourhood of
+ * a miss in one go instead of one round trip per block. A request never
+ * extends beyond the hole it was sent for nor beyond EOF. 0, the default,
+ * requests exactly what is being read.
+ */
+int cachefiles_ondemand_ra(struct cachefiles_cache *cache, char *args)
+{
+	unsigned long ra;
+	int ret;
+
+	if (!test_bit(CACHEFILES_ONDEMAND_MODE, &cache->flags))
+		return -EOPNOTSUPP;
+
+	ret = kstrtoul(args, 0, &ra);
+	if (ret)
+		return ret;
+	if (ra > CACHEFILES_ONDEMAND_RA_MAX)
+		return -EINVAL;
+
+	WRITE_ONCE(cache->ondemand_ra, round_up(ra, PAGE_SIZE));
+	return 0;
+}
+
 static int cachefiles_ondemand_get_fd(struct cachefiles_req *req)
 {
 	struct cachefiles_object *object;
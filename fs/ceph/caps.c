@@ -1557,6 +1557,7 @@ static void __ceph_flush_snaps(struct ceph_inode_info *ci,
 
 		spin_lock(&mdsc->cap_dirty_lock);
 		capsnap->cap_flush.tid = ++mdsc->last_cap_flush_tid;
+		capsnap->cap_flush.start_time = ktime_get();
 		list_add_tail(&capsnap->cap_flush.g_list,
 			      &mdsc->cap_flush_list);
 		if (oldest_flush_tid == 0)
@@ -1840,6 +1841,7 @@ static u64 __mark_caps_flushing(struct inode *inode,
 	list_del_init(&ci->i_dirty_item);
 
 	cf->tid = ++mdsc->last_cap_flush_tid;
+	cf->start_time = ktime_get();
 	list_add_tail(&cf->g_list, &mdsc->cap_flush_list);
 	*oldest_flush_tid = __get_oldest_flush_tid(mdsc);
 
@@ -3643,6 +3645,7 @@ static void handle_cap_flush_ack(struct inode *inode, u64 flush_tid,
 	struct ceph_mds_client *mdsc = ceph_sb_to_client(inode->i_sb)->mdsc;
 	struct ceph_cap_flush *cf, *tmp_cf;
 	LIST_HEAD(to_remove);
+	ktime_t now = ktime_get();
 	unsigned seq = le32_to_cpu(m->seq);
 	int dirty = le32_to_cpu(m->dirty);
 	int cleaned = 0;
@@ -3730,6 +3733,8 @@ static void handle_cap_flush_ack(struct inode *inode, u64 flush_tid,
 		cf = list_first_entry(&to_remove,
 				      struct ceph_cap_flush, i_list);
 		list_del_init(&cf->i_list);
+		ceph_update_cap_flush_metrics(&mdsc->metric,
+					      cf->start_time, now);
 		if (!cf->is_capsnap)
 			ceph_free_cap_flush(cf);
 	}
@@ -3820,6 +3825,9 @@ static void handle_cap_flushsnap_ack(struct inode *inode, u64 flush_tid,
 	spin_unlock(&ci->i_ceph_lock);
 
 	if (capsnap) {
+		ceph_update_cap_flush_metrics(&mdsc->metric,
+					      capsnap->cap_flush.start_time,
+					      ktime_get());
 		ceph_put_snap_context(capsnap->context);
 		ceph_put_cap_snap(capsnap);
 		if (wake_ci)
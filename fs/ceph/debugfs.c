@@ -168,7 +168,8 @@ static const char * const metric_str[] = {
 	"read",
 	"write",
 	"metadata",
-	"copyfrom"
+	"copyfrom",
+	"capflush"
 };
 static int metrics_latency_show(struct seq_file *s, void *p)
 {
@@ -209,8 +210,8 @@ static int metrics_size_show(struct seq_file *s, void *p)
 	seq_printf(s, "----------------------------------------------------------------------------------------\n");
 
 	for (i = 0; i < METRIC_MAX; i++) {
-		/* skip 'metadata' as it doesn't use the size metric */
-		if (i == METRIC_METADATA)
+		/* skip 'metadata' and 'capflush' as they don't use the size metric */
+		if (i == METRIC_METADATA || i == METRIC_CAPFLUSH)
 			continue;
 		m = &cm->metric[i];
 		spin_lock(&m->lock);
@@ -1142,11 +1142,15 @@ static void ceph_async_unlink_cb(struct ceph_mds_client *mdsc,
 		/* mark inode itself for an error (since metadata is bogus) */
 		mapping_set_error(req->r_old_inode->i_mapping, result);
 
-		pr_warn("async unlink failure path=(%llx)%s result=%d!\n",
-			base, IS_ERR(path) ? "<<bad>>" : path, result);
+		pr_warn("async %s failure path=(%llx)%s result=%d!\n",
+			ceph_mds_op_name(req->r_op), base,
+			IS_ERR(path) ? "<<bad>>" : path, result);
 		ceph_mdsc_free_path(path, pathlen);
 	}
 out:
+	if (test_and_clear_bit(CEPH_MDS_R_FX_REF, &req->r_req_flags))
+		ceph_put_cap_refs(ceph_inode(req->r_old_inode),
+				  CEPH_CAP_FILE_EXCL);
 	iput(req->r_old_inode);
 	ceph_mdsc_release_dir_caps(req);
 }
@@ -1187,6 +1191,48 @@ static int get_caps_for_async_unlink(struct inode *dir, struct dentry *dentry)
 	return 0;
 }
 
+/*
+ * An rmdir can be done asynchronously as well, provided that we know the
+ * directory to be empty and that nobody can add to it behind our back:
+ * we need Fx on the directory, its complete listing, and no entry left
+ * in it, not even one whose async unlink is still in flight. On success
+ * the Fx reference is kept until the MDS replies.
+ */
+static bool get_caps_for_async_rmdir(struct dentry *dentry)
+{
+	struct ceph_inode_info *ci = ceph_inode(d_inode(dentry));
+	struct dentry *child;
+	bool empty = true;
+
+	spin_lock(&ci->i_ceph_lock);
+	if (!(__ceph_caps_issued(ci, NULL) & CEPH_CAP_FILE_EXCL) ||
+	    !__ceph_dir_is_complete(ci)) {
+		spin_unlock(&ci->i_ceph_lock);
+		return false;
+	}
+	ceph_take_cap_refs(ci, CEPH_CAP_FILE_EXCL, false);
+	spin_unlock(&ci->i_ceph_lock);
+
+	spin_lock(&dentry->d_lock);
+	list_for_each_entry(child, &dentry->d_subdirs, d_child) {
+		struct ceph_dentry_info *di;
+
+		spin_lock_nested(&child->d_lock, DENTRY_D_LOCK_NESTED);
+		di = ceph_dentry(child);
+		if (d_really_is_positive(child) ||
+		    (di && (di->flags & CEPH_DENTRY_ASYNC_UNLINK)))
+			empty = false;
+		spin_unlock(&child->d_lock);
+		if (!empty)
+			break;
+	}
+	spin_unlock(&dentry->d_lock);
+
+	if (!empty)
+		ceph_put_cap_refs(ci, CEPH_CAP_FILE_EXCL);
+	return empty;
+}
+
 /*
  * rmdir and unlink are differ only by the metadata op code
  */
@@ -1225,14 +1271,23 @@ static int ceph_unlink(struct inode *dir, struct dentry *dentry)
 	req->r_dentry_unless = CEPH_CAP_FILE_EXCL;
 	req->r_inode_drop = ceph_drop_caps_for_unlink(inode);
 
-	if (try_async && op == CEPH_MDS_OP_UNLINK &&
-	    (req->r_dir_caps = get_caps_for_async_unlink(dir, dentry))) {
+	if (try_async && op != CEPH_MDS_OP_RMSNAP)
+		req->r_dir_caps = get_caps_for_async_unlink(dir, dentry);
+	if (req->r_dir_caps && op == CEPH_MDS_OP_RMDIR &&
+	    !get_caps_for_async_rmdir(dentry)) {
+		ceph_put_cap_refs(ceph_inode(dir), req->r_dir_caps);
+		req->r_dir_caps = 0;
+	}
+
+	if (req->r_dir_caps) {
 		struct ceph_dentry_info *di = ceph_dentry(dentry);
 
-		dout("async unlink on %llu/%.*s caps=%s", ceph_ino(dir),
-		     dentry->d_name.len, dentry->d_name.name,
+		dout("async %s on %llu/%.*s caps=%s", ceph_mds_op_name(op),
+		     ceph_ino(dir), dentry->d_name.len, dentry->d_name.name,
 		     ceph_cap_string(req->r_dir_caps));
 		set_bit(CEPH_MDS_R_ASYNC, &req->r_req_flags);
+		if (op == CEPH_MDS_OP_RMDIR)
+			set_bit(CEPH_MDS_R_FX_REF, &req->r_req_flags);
 		req->r_callback = ceph_async_unlink_cb;
 		req->r_old_inode = d_inode(dentry);
 		ihold(req->r_old_inode);
@@ -1252,9 +1307,18 @@ static int ceph_unlink(struct inode *dir, struct dentry *dentry)
 			 * We have enough caps, so we assume that the unlink
 			 * will succeed. Fix up the target inode and dcache.
 			 */
-			drop_nlink(inode);
+			if (op == CEPH_MDS_OP_RMDIR)
+				clear_nlink(inode);
+			else
+				drop_nlink(inode);
 			d_delete(dentry);
 		} else {
+			/* unless the callback already dropped it */
+			if (test_and_clear_bit(CEPH_MDS_R_FX_REF,
+					       &req->r_req_flags))
+				ceph_put_cap_refs(ceph_inode(inode),
+						  CEPH_CAP_FILE_EXCL);
+
 			spin_lock(&fsc->async_unlink_conflict_lock);
 			hash_del_rcu(&di->hnode);
 			spin_unlock(&fsc->async_unlink_conflict_lock);
@@ -272,6 +272,7 @@ struct ceph_mds_request {
 #define CEPH_MDS_R_DID_PREPOPULATE	(6) /* prepopulated readdir */
 #define CEPH_MDS_R_PARENT_LOCKED	(7) /* is r_parent->i_rwsem wlocked? */
 #define CEPH_MDS_R_ASYNC		(8) /* async request */
+#define CEPH_MDS_R_FX_REF		(9) /* holds Fx on r_old_inode */
 	unsigned long	r_req_flags;
 
 	struct mutex r_fill_mutex;
@@ -148,6 +148,7 @@ enum metric_type {
 	METRIC_WRITE,
 	METRIC_METADATA,
 	METRIC_COPYFROM,
+	METRIC_CAPFLUSH,
 	METRIC_MAX
 };
 
@@ -241,4 +242,10 @@ static inline void ceph_update_copyfrom_metrics(struct ceph_client_metric *m,
 	ceph_update_metrics(&m->metric[METRIC_COPYFROM],
 			    r_start, r_end, size, rc);
 }
+static inline void ceph_update_cap_flush_metrics(struct ceph_client_metric *m,
+						 ktime_t r_start, ktime_t r_end)
+{
+	ceph_update_metrics(&m->metric[METRIC_CAPFLUSH],
+			    r_start, r_end, 0, 0);
+}
 #endif /* _FS_CEPH_MDS_METRIC_H */
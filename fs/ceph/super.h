@@ -203,6 +203,7 @@ struct ceph_cap_flush {
 	int caps;
 	bool wake; /* wake up flush waiters when finish ? */
 	bool is_capsnap; /* true means capsnap */
+	ktime_t start_time; /* when the flush was sent, for the metrics */
 	struct list_head g_list; // global
 	struct list_head i_list; // per inode
 };
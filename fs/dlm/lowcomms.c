@@ -64,6 +64,8 @@
 
 #define DLM_SHUTDOWN_WAIT_TIMEOUT msecs_to_jiffies(5000)
 #define NEEDED_RMEM (4*1024*1024)
+/* Number of write queue pages handed to the socket at once */
+#define DLM_SEND_MAX_PAGES 16
 
 struct connection {
 	struct socket *sock;	/* NULL if not connected */
@@ -1356,15 +1358,15 @@ int dlm_lowcomms_resend_msg(struct dlm_msg *msg)
 	return 0;
 }
 
-/* Send a message */
+/* Send the messages of the ready write queue pages, several at once */
 static int send_to_sock(struct connection *con)
 {
-	struct writequeue_entry *e;
-	struct bio_vec bvec;
+	struct writequeue_entry *e, *entries[DLM_SEND_MAX_PAGES];
+	struct bio_vec bvec[DLM_SEND_MAX_PAGES];
 	struct msghdr msg = {
 		.msg_flags = MSG_SPLICE_PAGES | MSG_DONTWAIT | MSG_NOSIGNAL,
 	};
-	int len, offset, ret;
+	int i, nr = 0, len = 0, completed, ret;
 
 	spin_lock_bh(&con->writequeue_lock);
 	e = con_next_wq(con);
@@ -1374,13 +1376,18 @@ static int send_to_sock(struct connection *con)
 		return DLM_IO_END;
 	}
 
-	len = e->len;
-	offset = e->offset;
-	WARN_ON_ONCE(len == 0 && e->users == 0);
+	/* stop at the first page still being filled, like con_next_wq() */
+	do {
+		bvec_set_page(&bvec[nr], e->page, e->len, e->offset);
+		entries[nr++] = e;
+		len += e->len;
+		if (list_is_last(&e->list, &con->writequeue))
+			break;
+		e = list_next_entry(e, list);
+	} while (nr < DLM_SEND_MAX_PAGES && !e->users && e->len);
 	spin_unlock_bh(&con->writequeue_lock);
 
-	bvec_set_page(&bvec, e->page, len, offset);
-	iov_iter_bvec(&msg.msg_iter, ITER_SOURCE, &bvec, 1, len);
+	iov_iter_bvec(&msg.msg_iter, ITER_SOURCE, bvec, nr, len);
 	ret = sock_sendmsg(con->sock, &msg);
 	trace_dlm_send(con->nodeid, ret);
 	if (ret == -EAGAIN || ret == 0) {
@@ -1410,7 +1417,11 @@ static int send_to_sock(struct connection *con)
 	}
 
 	spin_lock_bh(&con->writequeue_lock);
-	writequeue_entry_complete(e, ret);
+	for (i = 0; i < nr && ret > 0; i++) {
+		completed = min_t(int, ret, bvec[i].bv_len);
+		writequeue_entry_complete(entries[i], completed);
+		ret -= completed;
+	}
 	spin_unlock_bh(&con->writequeue_lock);
 
 	return DLM_IO_SUCCESS;
@@ -4,7 +4,10 @@
  * Copyright (C) 2022, Bytedance Inc. All rights reserved.
  */
 #include <linux/fscache.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
 #include "internal.h"
+#include "xattr.h"
 
 static DEFINE_MUTEX(erofs_domain_list_lock);
 static DEFINE_MUTEX(erofs_domain_cookies_lock);
@@ -12,10 +15,31 @@ static LIST_HEAD(erofs_domain_list);
 static LIST_HEAD(erofs_domain_cookies_list);
 static struct vfsmount *erofs_pseudo_mnt;
 
+/* inode_share: files of a domain with the same fingerprint share a page cache */
+#define EROFS_ISHARE_XATTR		"erofs.fingerprint"
+#define EROFS_ISHARE_FP_MAX		64
+
+struct erofs_ishare {
+	struct hlist_node node;		/* in erofs_ishare_hash */
+	struct erofs_domain *domain;
+	refcount_t ref;
+	struct inode *inode;		/* anon inode holding the page cache */
+
+	spinlock_t lock;
+	struct list_head owners;	/* erofs inodes sharing the page cache */
+
+	unsigned int len;
+	u8 fingerprint[EROFS_ISHARE_FP_MAX];
+};
+
+static DEFINE_MUTEX(erofs_ishare_lock);
+static DEFINE_HASHTABLE(erofs_ishare_hash, 10);
+
 struct erofs_fscache_request {
 	struct erofs_fscache_request *primary;
 	struct netfs_cache_resources cache_resources;
 	struct address_space	*mapping;	/* The mapping being accessed */
+	struct inode		*inode;		/* The inode mapping the data */
 	loff_t			start;		/* Start position */
 	size_t			len;		/* Length of the request */
 	size_t			submitted;	/* Length of submitted */
@@ -33,6 +57,7 @@ static struct erofs_fscache_request *erofs_fscache_req_alloc(struct address_spac
 		return ERR_PTR(-ENOMEM);
 
 	req->mapping = mapping;
+	req->inode   = mapping->host;
 	req->start   = start;
 	req->len     = len;
 	refcount_set(&req->ref, 1);
@@ -54,6 +79,7 @@ static struct erofs_fscache_request *erofs_fscache_req_chain(struct erofs_fscach
 	req = erofs_fscache_req_alloc(primary->mapping,
 			primary->start + primary->submitted, len);
 	if (!IS_ERR(req)) {
+		req->inode = primary->inode;
 		req->primary = primary;
 		refcount_inc(&primary->ref);
 	}
@@ -116,7 +142,7 @@ static int erofs_fscache_read_folios_async(struct fscache_cookie *cookie,
 		struct erofs_fscache_request *req, loff_t pstart, size_t len)
 {
 	enum netfs_io_source source;
-	struct super_block *sb = req->mapping->host->i_sb;
+	struct super_block *sb = req->inode->i_sb;
 	struct netfs_cache_resources *cres = &req->cache_resources;
 	struct iov_iter iter;
 	loff_t lstart = req->start + req->submitted;
@@ -187,7 +213,7 @@ static int erofs_fscache_meta_read_folio(struct file *data, struct folio *folio)
 static int erofs_fscache_data_read_slice(struct erofs_fscache_request *primary)
 {
 	struct address_space *mapping = primary->mapping;
-	struct inode *inode = mapping->host;
+	struct inode *inode = primary->inode;
 	struct super_block *sb = inode->i_sb;
 	struct erofs_fscache_request *req;
 	struct erofs_map_blocks map;
@@ -317,6 +343,88 @@ const struct address_space_operations erofs_fscache_access_aops = {
 	.readahead = erofs_fscache_readahead,
 };
 
+/*
+ * The shared page cache has no layout of its own, so map the data through
+ * any of the erofs inodes which are still alive.  Their content is the same.
+ */
+static struct inode *erofs_ishare_get_owner(struct address_space *mapping)
+{
+	struct erofs_ishare *share = mapping->host->i_private;
+	struct inode *inode = NULL;
+	struct erofs_inode *vi;
+
+	spin_lock(&share->lock);
+	list_for_each_entry(vi, &share->owners, ishare_node) {
+		inode = igrab(&vi->vfs_inode);
+		if (inode)
+			break;
+	}
+	spin_unlock(&share->lock);
+	return inode;
+}
+
+static int erofs_fscache_ishare_read_folio(struct file *file,
+					   struct folio *folio)
+{
+	struct erofs_fscache_request *req;
+	struct inode *owner;
+	int ret;
+
+	owner = erofs_ishare_get_owner(folio_mapping(folio));
+	if (!owner) {
+		folio_unlock(folio);
+		return -EIO;
+	}
+
+	req = erofs_fscache_req_alloc(folio_mapping(folio),
+			folio_pos(folio), folio_size(folio));
+	if (IS_ERR(req)) {
+		folio_unlock(folio);
+		iput(owner);
+		return PTR_ERR(req);
+	}
+	req->inode = owner;
+
+	ret = erofs_fscache_data_read(req);
+	erofs_fscache_req_put(req);
+	iput(owner);
+	return ret;
+}
+
+static void erofs_fscache_ishare_readahead(struct readahead_control *rac)
+{
+	struct erofs_fscache_request *req;
+	struct inode *owner;
+
+	if (!readahead_count(rac))
+		return;
+
+	owner = erofs_ishare_get_owner(rac->mapping);
+	if (!owner)
+		return;
+
+	req = erofs_fscache_req_alloc(rac->mapping,
+			readahead_pos(rac), readahead_length(rac));
+	if (IS_ERR(req)) {
+		iput(owner);
+		return;
+	}
+	req->inode = owner;
+
+	/* The request completion will drop refs on the folios. */
+	while (readahead_folio(rac))
+		;
+
+	erofs_fscache_data_read(req);
+	erofs_fscache_req_put(req);
+	iput(owner);
+}
+
+static const struct address_space_operations erofs_fscache_ishare_aops = {
+	.read_folio = erofs_fscache_ishare_read_folio,
+	.readahead = erofs_fscache_ishare_readahead,
+};
+
 static void erofs_fscache_domain_put(struct erofs_domain *domain)
 {
 	mutex_lock(&erofs_domain_list_lock);
@@ -610,3 +718,114 @@ void erofs_fscache_unregister_fs(struct super_block *sb)
 	sbi->volume = NULL;
 	sbi->domain = NULL;
 }
+
+static struct erofs_ishare *erofs_ishare_alloc(struct inode *inode,
+					       const u8 *fp, unsigned int len)
+{
+	struct erofs_domain *domain = EROFS_I_SB(inode)->domain;
+	struct erofs_ishare *share;
+	struct inode *sinode;
+
+	share = kzalloc(sizeof(*share), GFP_KERNEL);
+	if (!share)
+		return NULL;
+
+	sinode = new_inode(erofs_pseudo_mnt->mnt_sb);
+	if (!sinode) {
+		kfree(share);
+		return NULL;
+	}
+	sinode->i_mode = S_IFREG;
+	sinode->i_size = inode->i_size;
+	sinode->i_blkbits = inode->i_blkbits;
+	sinode->i_mapping->a_ops = &erofs_fscache_ishare_aops;
+	mapping_set_large_folios(sinode->i_mapping);
+	sinode->i_private = share;
+
+	spin_lock_init(&share->lock);
+	INIT_LIST_HEAD(&share->owners);
+	refcount_set(&share->ref, 1);
+	share->inode = sinode;
+	share->len = len;
+	memcpy(share->fingerprint, fp, len);
+
+	refcount_inc(&domain->ref);
+	share->domain = domain;
+	return share;
+}
+
+/*
+ * Let a regular file use the page cache of the domain for its fingerprint,
+ * so that the same content is cached once however many images contain it.
+ * Files without a fingerprint keep a page cache of their own.
+ */
+void erofs_fscache_ishare_init(struct inode *inode)
+{
+	struct erofs_sb_info *sbi = EROFS_I_SB(inode);
+	struct erofs_inode *vi = EROFS_I(inode);
+	struct erofs_ishare *share;
+	u8 fp[EROFS_ISHARE_FP_MAX];
+	u32 key;
+	int len;
+
+	if (!test_opt(&sbi->opt, INODE_SHARE) || !sbi->domain ||
+	    !S_ISREG(inode->i_mode))
+		return;
+
+	len = erofs_getxattr(inode, EROFS_XATTR_INDEX_TRUSTED,
+			     EROFS_ISHARE_XATTR, fp, sizeof(fp));
+	if (len <= 0)
+		return;
+	key = jhash(fp, len, (u32)(unsigned long)sbi->domain);
+
+	mutex_lock(&erofs_ishare_lock);
+	hash_for_each_possible(erofs_ishare_hash, share, node, key) {
+		if (share->domain == sbi->domain && share->len == len &&
+		    !memcmp(share->fingerprint, fp, len) &&
+		    share->inode->i_size == inode->i_size) {
+			refcount_inc(&share->ref);
+			goto attach;
+		}
+	}
+	share = erofs_ishare_alloc(inode, fp, len);
+	if (!share) {
+		mutex_unlock(&erofs_ishare_lock);
+		return;
+	}
+	hash_add(erofs_ishare_hash, &share->node, key);
+attach:
+	mutex_unlock(&erofs_ishare_lock);
+
+	spin_lock(&share->lock);
+	list_add_tail(&vi->ishare_node, &share->owners);
+	spin_unlock(&share->lock);
+	vi->ishare = share;
+	inode->i_mapping = share->inode->i_mapping;
+}
+
+void erofs_fscache_ishare_put(struct inode *inode)
+{
+	struct erofs_inode *vi = EROFS_I(inode);
+	struct erofs_ishare *share = vi->ishare;
+	struct erofs_domain *domain = NULL;
+
+	if (!share)
+		return;
+
+	spin_lock(&share->lock);
+	list_del(&vi->ishare_node);
+	spin_unlock(&share->lock);
+	inode->i_mapping = &inode->i_data;
+	vi->ishare = NULL;
+
+	mutex_lock(&erofs_ishare_lock);
+	if (refcount_dec_and_test(&share->ref)) {
+		hash_del(&share->node);
+		domain = share->domain;
+		iput(share->inode);
+		kfree(share);
+	}
+	mutex_unlock(&erofs_ishare_lock);
+	if (domain)
+		erofs_fscache_domain_put(domain);
+}
@@ -302,8 +302,10 @@ static int erofs_fill_inode(struct inode *inode)
 	inode->i_mapping->a_ops = &erofs_raw_access_aops;
 	mapping_set_large_folios(inode->i_mapping);
 #ifdef CONFIG_EROFS_FS_ONDEMAND
-	if (erofs_is_fscache_mode(inode->i_sb))
+	if (erofs_is_fscache_mode(inode->i_sb)) {
 		inode->i_mapping->a_ops = &erofs_fscache_access_aops;
+		erofs_fscache_ishare_init(inode);
+	}
 #endif
 
 out_unlock:
@@ -115,6 +115,12 @@ struct erofs_fscache {
 	char *name;
 };
 
+enum {
+	Z_EROFS_COMPRESSION_SHIFTED = Z_EROFS_COMPRESSION_MAX,
+	Z_EROFS_COMPRESSION_INTERLACED,
+	Z_EROFS_COMPRESSION_RUNTIME_MAX
+};
+
 struct erofs_xattr_prefix_item {
 	struct erofs_xattr_long_prefix *prefix;
 	u8 infix_len;
@@ -137,6 +143,10 @@ struct erofs_sb_info {
 	struct inode *managed_cache;
 
 	struct erofs_sb_lz4_info lz4;
+
+	/* decompression statistics, per algorithm */
+	atomic64_t decompress_nr[Z_EROFS_COMPRESSION_RUNTIME_MAX];
+	atomic64_t decompress_ns[Z_EROFS_COMPRESSION_RUNTIME_MAX];
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	struct inode *packed_inode;
 	struct erofs_dev_context *devs;
@@ -192,6 +202,7 @@ struct erofs_sb_info {
 #define EROFS_MOUNT_POSIX_ACL		0x00000020
 #define EROFS_MOUNT_DAX_ALWAYS		0x00000040
 #define EROFS_MOUNT_DAX_NEVER		0x00000080
+#define EROFS_MOUNT_INODE_SHARE		0x00000100
 
 #define clear_opt(opt, option)	((opt)->mount_opt &= ~EROFS_MOUNT_##option)
 #define set_opt(opt, option)	((opt)->mount_opt |= EROFS_MOUNT_##option)
@@ -295,6 +306,11 @@ struct erofs_inode {
 		};
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	};
+#ifdef CONFIG_EROFS_FS_ONDEMAND
+	/* page cache shared with identical files of the domain, if any */
+	struct erofs_ishare *ishare;
+	struct list_head ishare_node;
+#endif
 	/* the corresponding vfs inode */
 	struct inode vfs_inode;
 };
@@ -366,12 +382,6 @@ struct erofs_map_blocks {
 /* Used to map tail extent for tailpacking inline or fragment pcluster */
 #define EROFS_GET_BLOCKS_FINDTAIL	0x0004
 
-enum {
-	Z_EROFS_COMPRESSION_SHIFTED = Z_EROFS_COMPRESSION_MAX,
-	Z_EROFS_COMPRESSION_INTERLACED,
-	Z_EROFS_COMPRESSION_RUNTIME_MAX
-};
-
 struct erofs_map_dev {
 	struct erofs_fscache *m_fscache;
 	struct block_device *m_bdev;
@@ -526,6 +536,9 @@ void erofs_fscache_unregister_fs(struct super_block *sb);
 struct erofs_fscache *erofs_fscache_register_cookie(struct super_block *sb,
 					char *name, unsigned int flags);
 void erofs_fscache_unregister_cookie(struct erofs_fscache *fscache);
+
+void erofs_fscache_ishare_init(struct inode *inode);
+void erofs_fscache_ishare_put(struct inode *inode);
 #else
 static inline int erofs_fscache_register_fs(struct super_block *sb)
 {
@@ -543,6 +556,9 @@ struct erofs_fscache *erofs_fscache_register_cookie(struct super_block *sb,
 static inline void erofs_fscache_unregister_cookie(struct erofs_fscache *fscache)
 {
 }
+
+static inline void erofs_fscache_ishare_init(struct inode *inode) {}
+static inline void erofs_fscache_ishare_put(struct inode *inode) {}
 #endif
 
 #define EFSCORRUPTED    EUCLEAN         /* Filesystem is corrupted */
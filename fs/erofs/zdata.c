@@ -169,6 +169,8 @@ static inline void z_erofs_onlinepage_endio(struct page *page)
 }
 
 #define Z_EROFS_ONSTACK_PAGES		32
+/* compressed pages a background worker decompresses before splitting */
+#define Z_EROFS_SPLIT_PAGES		32
 
 /*
  * since pclustersize is variable for big pcluster feature, introduce slab
@@ -1285,6 +1287,7 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	int err2;
 	struct page *page;
 	bool overlapped;
+	u64 start;
 
 	mutex_lock(&pcl->lock);
 	be->nr_pages = PAGE_ALIGN(pcl->length + pcl->pageofs_out) >> PAGE_SHIFT;
@@ -1324,6 +1327,7 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	else
 		inputsize = pclusterpages * PAGE_SIZE;
 
+	start = ktime_get_ns();
 	err = decompressor->decompress(&(struct z_erofs_decompress_req) {
 					.sb = be->sb,
 					.in = be->compressed_pages,
@@ -1337,6 +1341,9 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 					.partial_decoding = pcl->partial,
 					.fillgaps = pcl->multibases,
 				 }, be->pagepool);
+	atomic64_add(ktime_get_ns() - start,
+		     &sbi->decompress_ns[pcl->algorithmformat]);
+	atomic64_inc(&sbi->decompress_nr[pcl->algorithmformat]);
 
 out:
 	/* must handle all compressed pages before actual file pages */
@@ -1413,6 +1420,44 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
+static void z_erofs_decompressqueue_work(struct work_struct *work);
+
+/*
+ * Keep about Z_EROFS_SPLIT_PAGES compressed pages of a background queue for
+ * the current worker and hand the rest of the chain over to another one, so
+ * that the pclusters of a large readahead are decompressed on several CPUs
+ * instead of one after another.  The new worker splits its part in turn.
+ */
+static void z_erofs_split_queue(struct z_erofs_decompressqueue *io)
+{
+	z_erofs_next_pcluster_t owned = io->head;
+	struct z_erofs_decompressqueue *q;
+	struct z_erofs_pcluster *pcl;
+	unsigned int pages = 0;
+
+	if (num_online_cpus() < 2)
+		return;
+
+	do {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+		if (owned == Z_EROFS_PCLUSTER_TAIL)
+			return;
+		pages += z_erofs_pclusterpages(pcl);
+	} while (pages < Z_EROFS_SPLIT_PAGES);
+
+	q = kvzalloc(sizeof(*q), GFP_KERNEL | __GFP_NOWARN);
+	if (!q)
+		return;
+	q->sb = io->sb;
+	q->eio = io->eio;
+	q->head = owned;
+	/* the pclusters are still owned by this chain, so cut it at @pcl */
+	WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL);
+	INIT_WORK(&q->u.work, z_erofs_decompressqueue_work);
+	queue_work(z_erofs_workqueue, &q->u.work);
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -1420,6 +1465,7 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	struct page *pagepool = NULL;
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL);
+	z_erofs_split_queue(bgq);
 	z_erofs_decompress_queue(bgq, &pagepool);
 	erofs_release_pages(&pagepool);
 	kvfree(bgq);
@@ -614,6 +614,15 @@ enum {
 #define DEF_HOT_DATA_AGE_THRESHOLD	262144
 #define DEF_WARM_DATA_AGE_THRESHOLD	2621440
 
+/*
+ * With adaptive_data_age, the thresholds follow the percentiles of the ages
+ * of the written blocks, so that hot/warm/cold keep splitting the writes
+ * whatever the workload.  A step moves a threshold by 1/64 of its value.
+ */
+#define HOT_DATA_AGE_PERCENTILE		25
+#define WARM_DATA_AGE_PERCENTILE	75
+#define DATA_AGE_STEP_SHIFT		6
+
 /* extent cache type */
 enum extent_type {
 	EX_READ,
@@ -1279,6 +1288,7 @@ struct f2fs_gc_control {
 	bool should_migrate_blocks;	/* should migrate blocks */
 	bool err_gc_skipped;		/* return EAGAIN if GC skipped */
 	unsigned int nr_free_secs;	/* # of free sections to do GC */
+	unsigned int nr_bg_secs;	/* # of victim sections for BG_GC */
 };
 
 /*
@@ -1592,6 +1602,11 @@ struct f2fs_sb_info {
 	unsigned int hot_data_age_threshold;
 	unsigned int warm_data_age_threshold;
 	unsigned int last_age_weight;
+	unsigned int adaptive_data_age;
+
+	/* data blocks written per temperature, by users and by GC */
+	atomic64_t temp_user_blocks[NR_TEMP_TYPE];
+	atomic64_t temp_gc_blocks[NR_TEMP_TYPE];
 
 	/* basic filesystem units */
 	unsigned int log_sectors_per_block;	/* log2 sectors per block */
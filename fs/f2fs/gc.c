@@ -133,6 +133,7 @@ static int gc_thread_func(void *data)
 		gc_control.init_gc_type = sync_mode ? FG_GC : BG_GC;
 		gc_control.no_bg_gc = foreground;
 		gc_control.nr_free_secs = foreground ? 1 : 0;
+		gc_control.nr_bg_secs = gc_th->bg_secs;
 
 		/* if return value is not zero, no victim was selected */
 		if (f2fs_gc(sbi, &gc_control)) {
@@ -169,6 +170,24 @@ static int gc_thread_func(void *data)
 	return 0;
 }
 
+/*
+ * A device serving many requests in parallel can take the migration of
+ * several sections in a background round without hurting user IO.
+ */
+static unsigned int default_bg_secs(struct f2fs_sb_info *sbi)
+{
+	unsigned int depth = 0;
+	int i;
+
+	for (i = 0; i < sbi->s_ndevs; i++)
+		depth = max(depth, blk_queue_depth(bdev_get_queue(FDEV(i).bdev)));
+	if (!depth)
+		depth = blk_queue_depth(bdev_get_queue(sbi->sb->s_bdev));
+
+	return clamp_t(unsigned int, depth / DEF_GC_QUEUE_DEPTH_PER_SEC,
+		       1, MAX_GC_BG_SECS);
+}
+
 int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_gc_kthread *gc_th;
@@ -182,6 +201,7 @@ int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->min_sleep_time = DEF_GC_THREAD_MIN_SLEEP_TIME;
 	gc_th->max_sleep_time = DEF_GC_THREAD_MAX_SLEEP_TIME;
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
+	gc_th->bg_secs = default_bg_secs(sbi);
 
 	gc_th->gc_wake = false;
 
@@ -1602,6 +1622,10 @@ static int gc_data_segment(struct f2fs_sb_info *sbi, struct f2fs_summary *sum,
 				iput(inode);
 				continue;
 			}
+			/* the read is still in flight if issued just now */
+			if (!PageUptodate(data_page))
+				f2fs_update_iostat(sbi, NULL, FS_GDATA_READ_IO,
+						   F2FS_BLKSIZE);
 
 			f2fs_put_page(data_page, 0);
 			add_gc_inode(gc_list, inode);
@@ -1804,7 +1828,7 @@ int f2fs_gc(struct f2fs_sb_info *sbi, struct f2fs_gc_control *gc_control)
 		.ilist = LIST_HEAD_INIT(gc_list.ilist),
 		.iroot = RADIX_TREE_INIT(gc_list.iroot, GFP_NOFS),
 	};
-	unsigned int skipped_round = 0, round = 0;
+	unsigned int skipped_round = 0, round = 0, bg_round = 0;
 	unsigned int upper_secs;
 
 	trace_f2fs_gc_begin(sbi->sb, gc_type, gc_control->no_bg_gc,
@@ -1891,6 +1915,14 @@ int f2fs_gc(struct f2fs_sb_info *sbi, struct f2fs_gc_control *gc_control)
 			goto stop;
 		}
 	} else if (has_enough_free_secs(sbi, 0, 0)) {
+		/*
+		 * Clean more victims in this background round if asked to,
+		 * but don't keep a checkpoint waiting for gc_lock.
+		 */
+		if (++bg_round < gc_control->nr_bg_secs &&
+		    !f2fs_rwsem_is_contended(&sbi->cp_rwsem) &&
+		    !f2fs_rwsem_is_contended(&sbi->gc_lock))
+			goto go_gc_more;
 		goto stop;
 	}
 
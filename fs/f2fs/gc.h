@@ -32,6 +32,10 @@
 
 #define NR_GC_CHECKPOINT_SECS (3)	/* data/node/dentry sections */
 
+/* victim sections cleaned per background GC round, by device queue depth */
+#define DEF_GC_QUEUE_DEPTH_PER_SEC	32
+#define MAX_GC_BG_SECS			16
+
 struct f2fs_gc_kthread {
 	struct task_struct *f2fs_gc_task;
 	wait_queue_head_t gc_wait_queue_head;
@@ -42,6 +46,9 @@ struct f2fs_gc_kthread {
 	unsigned int max_sleep_time;
 	unsigned int no_gc_sleep_time;
 
+	/* victim sections cleaned in a background round */
+	unsigned int bg_secs;
+
 	/* for changing gc mode */
 	bool gc_wake;
 
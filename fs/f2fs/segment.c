@@ -3294,6 +3294,43 @@ static int __get_segment_type_4(struct f2fs_io_info *fio)
 	}
 }
 
+/* move @threshold towards the @pct percentile of the observed ages */
+static unsigned int track_age_percentile(unsigned int threshold,
+					unsigned long long age, unsigned int pct)
+{
+	unsigned int step = max(threshold >> DATA_AGE_STEP_SHIFT, 1U);
+	unsigned int delta;
+
+	if (age > threshold) {
+		delta = max(mult_frac(step, pct, 100), 1U);
+		return threshold > UINT_MAX - delta ? UINT_MAX :
+						threshold + delta;
+	}
+	if (age < threshold) {
+		delta = max(mult_frac(step, 100 - pct, 100), 1U);
+		return threshold > delta ? threshold - delta : 1;
+	}
+	return threshold;
+}
+
+static void update_data_age_thresholds(struct f2fs_sb_info *sbi,
+					unsigned long long age)
+{
+	unsigned int hot = READ_ONCE(sbi->hot_data_age_threshold);
+	unsigned int warm = READ_ONCE(sbi->warm_data_age_threshold);
+
+	hot = track_age_percentile(hot, age, HOT_DATA_AGE_PERCENTILE);
+	warm = track_age_percentile(warm, age, WARM_DATA_AGE_PERCENTILE);
+	if (warm <= hot) {
+		if (hot == UINT_MAX)
+			hot--;
+		warm = hot + 1;
+	}
+
+	WRITE_ONCE(sbi->hot_data_age_threshold, hot);
+	WRITE_ONCE(sbi->warm_data_age_threshold, warm);
+}
+
 static int __get_age_segment_type(struct inode *inode, pgoff_t pgofs)
 {
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
@@ -3302,9 +3339,11 @@ static int __get_age_segment_type(struct inode *inode, pgoff_t pgofs)
 	if (f2fs_lookup_age_extent_cache(inode, pgofs, &ei)) {
 		if (!ei.age)
 			return NO_CHECK_TYPE;
-		if (ei.age <= sbi->hot_data_age_threshold)
+		if (sbi->adaptive_data_age)
+			update_data_age_thresholds(sbi, ei.age);
+		if (ei.age <= READ_ONCE(sbi->hot_data_age_threshold))
 			return CURSEG_HOT_DATA;
-		if (ei.age <= sbi->warm_data_age_threshold)
+		if (ei.age <= READ_ONCE(sbi->warm_data_age_threshold))
 			return CURSEG_WARM_DATA;
 		return CURSEG_COLD_DATA;
 	}
@@ -3526,11 +3565,44 @@ void f2fs_update_device_state(struct f2fs_sb_info *sbi, nid_t ino,
 	}
 }
 
+static enum temp_type seg_type_to_temp(int type)
+{
+	if (IS_HOT(type))
+		return HOT;
+	if (IS_WARM(type))
+		return WARM;
+	return COLD;
+}
+
+/*
+ * Account a data block write for the per-temperature write amplification:
+ * a block moved by GC counts for the temperature it was written with.
+ */
+static void update_temp_write_stat(struct f2fs_io_info *fio)
+{
+	struct f2fs_sb_info *sbi = fio->sbi;
+
+	if (fio->type != DATA)
+		return;
+
+	if (fio->io_type == FS_GC_DATA_IO || page_private_gcing(fio->page)) {
+		if (!__is_valid_data_blkaddr(fio->old_blkaddr))
+			return;
+		atomic64_inc(&sbi->temp_gc_blocks[seg_type_to_temp(
+			get_seg_entry(sbi,
+				GET_SEGNO(sbi, fio->old_blkaddr))->type)]);
+		return;
+	}
+	atomic64_inc(&sbi->temp_user_blocks[fio->temp]);
+}
+
 static void do_write_page(struct f2fs_summary *sum, struct f2fs_io_info *fio)
 {
 	int type = __get_segment_type(fio);
 	bool keep_order = (f2fs_lfs_mode(fio->sbi) && type == CURSEG_COLD_DATA);
 
+	update_temp_write_stat(fio);
+
 	if (keep_order)
 		f2fs_down_read(&fio->sbi->io_order_lock);
 reallocate:
@@ -511,6 +511,11 @@ static ssize_t __sbi_store(struct f2fs_attr *a,
 			return -EINVAL;
 	}
 
+	if (!strcmp(a->attr.name, "gc_bg_sections")) {
+		if (t == 0 || t > MAX_GC_BG_SECS)
+			return -EINVAL;
+	}
+
 	if (!strcmp(a->attr.name, "gc_urgent")) {
 		if (t == 0) {
 			sbi->gc_mode = GC_NORMAL;
@@ -706,6 +711,13 @@ static ssize_t __sbi_store(struct f2fs_attr *a,
 		return count;
 	}
 
+	if (!strcmp(a->attr.name, "adaptive_data_age")) {
+		if (t > 1)
+			return -EINVAL;
+		*ui = (unsigned int)t;
+		return count;
+	}
+
 	if (!strcmp(a->attr.name, "last_age_weight")) {
 		if (t > 100)
 			return -EINVAL;
@@ -896,6 +908,7 @@ GC_THREAD_RW_ATTR(gc_urgent_sleep_time, urgent_sleep_time);
 GC_THREAD_RW_ATTR(gc_min_sleep_time, min_sleep_time);
 GC_THREAD_RW_ATTR(gc_max_sleep_time, max_sleep_time);
 GC_THREAD_RW_ATTR(gc_no_gc_sleep_time, no_gc_sleep_time);
+GC_THREAD_RW_ATTR(gc_bg_sections, bg_secs);
 
 /* SM_INFO ATTR */
 SM_INFO_RW_ATTR(reclaim_segments, rec_prefree_segments);
@@ -966,6 +979,7 @@ F2FS_SBI_GENERAL_RW_ATTR(revoked_atomic_block);
 F2FS_SBI_GENERAL_RW_ATTR(hot_data_age_threshold);
 F2FS_SBI_GENERAL_RW_ATTR(warm_data_age_threshold);
 F2FS_SBI_GENERAL_RW_ATTR(last_age_weight);
+F2FS_SBI_GENERAL_RW_ATTR(adaptive_data_age);
 #ifdef CONFIG_BLK_DEV_ZONED
 F2FS_SBI_GENERAL_RO_ATTR(unusable_blocks_per_sec);
 #endif
@@ -1051,6 +1065,7 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(gc_min_sleep_time),
 	ATTR_LIST(gc_max_sleep_time),
 	ATTR_LIST(gc_no_gc_sleep_time),
+	ATTR_LIST(gc_bg_sections),
 	ATTR_LIST(gc_idle),
 	ATTR_LIST(gc_urgent),
 	ATTR_LIST(reclaim_segments),
@@ -1146,6 +1161,7 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(hot_data_age_threshold),
 	ATTR_LIST(warm_data_age_threshold),
 	ATTR_LIST(last_age_weight),
+	ATTR_LIST(adaptive_data_age),
 	NULL,
 };
 ATTRIBUTE_GROUPS(f2fs);
@@ -1348,6 +1364,29 @@ static int __maybe_unused segment_info_seq_show(struct seq_file *seq,
 	return 0;
 }
 
+static int __maybe_unused temperature_info_seq_show(struct seq_file *seq,
+						void *offset)
+{
+	static const char * const temp_name[NR_TEMP_TYPE] = {
+		[HOT] = "hot", [WARM] = "warm", [COLD] = "cold",
+	};
+	struct super_block *sb = seq->private;
+	struct f2fs_sb_info *sbi = F2FS_SB(sb);
+	int i;
+
+	seq_printf(seq, "hot_data_age_threshold: %u\n",
+		   READ_ONCE(sbi->hot_data_age_threshold));
+	seq_printf(seq, "warm_data_age_threshold: %u\n",
+		   READ_ONCE(sbi->warm_data_age_threshold));
+	seq_puts(seq, "format: temperature: user_blocks gc_blocks\n");
+
+	for (i = 0; i < NR_TEMP_TYPE; i++)
+		seq_printf(seq, "%-5s: %llu %llu\n", temp_name[i],
+			   (u64)atomic64_read(&sbi->temp_user_blocks[i]),
+			   (u64)atomic64_read(&sbi->temp_gc_blocks[i]));
+	return 0;
+}
+
 static int __maybe_unused segment_bits_seq_show(struct seq_file *seq,
 						void *offset)
 {
@@ -1513,6 +1552,8 @@ int f2fs_register_sysfs(struct f2fs_sb_info *sbi)
 				victim_bits_seq_show, sb);
 	proc_create_single_data("discard_plist_info", 0444, sbi->s_proc,
 				discard_plist_seq_show, sb);
+	proc_create_single_data("temperature_info", 0444, sbi->s_proc,
+				temperature_info_seq_show, sb);
 	return 0;
 put_feature_list_kobj:
 	kobject_put(&sbi->s_feature_list_kobj);
@@ -0,0 +1,644 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE: Filesystem in Userspace
+ *
+ * io_uring request transport.  The server hands buffers to per-CPU queues
+ * with io_uring commands on the device.  A request is copied to an available
+ * buffer of the queue of the CPU it was submitted on, and completes the
+ * command waiting on that buffer.  The reply is committed together with the
+ * fetch of the next request, so each request costs a single command instead
+ * of a read and a write on the device, and the servers don't contend on the
+ * single input queue.
+ */
+
+#include "fuse_i.h"
+#include "fuse_dev_i.h"
+#include "dev_uring_i.h"
+
+#include <linux/io_uring.h>
+#include <linux/module.h>
+#include <linux/sched/task.h>
+#include <linux/slab.h>
+#include <linux/uio.h>
+
+static bool __read_mostly enable_uring;
+module_param(enable_uring, bool, 0644);
+MODULE_PARM_DESC(enable_uring,
+		 "Enable userspace communication through io-uring");
+
+#define FUSE_URING_MONITOR_PERIOD	(5 * HZ)
+
+struct fuse_uring_pdu {
+	struct fuse_ring_ent *ent;
+};
+
+static struct fuse_uring_pdu *fuse_uring_cmd_pdu(struct io_uring_cmd *cmd)
+{
+	return (struct fuse_uring_pdu *)cmd->pdu;
+}
+
+bool fuse_uring_enabled(void)
+{
+	return enable_uring;
+}
+
+static void fuse_uring_monitor_work(struct work_struct *work)
+{
+	struct fuse_ring *ring =
+		container_of(work, struct fuse_ring, monitor_work.work);
+	struct fuse_conn *fc = ring->fc;
+	unsigned int qid;
+
+	for (qid = 0; qid < ring->nr_queues; qid++) {
+		struct fuse_ring_queue *queue = READ_ONCE(ring->queues[qid]);
+		struct task_struct *task;
+
+		task = queue ? READ_ONCE(queue->task) : NULL;
+		if (task && (task->flags & PF_EXITING)) {
+			/*
+			 * The commands of the task keep the device open,
+			 * complete them so that the task can exit.
+			 */
+			fuse_abort_conn(fc);
+			return;
+		}
+	}
+
+	if (READ_ONCE(fc->connected))
+		schedule_delayed_work(&ring->monitor_work,
+				      FUSE_URING_MONITOR_PERIOD);
+}
+
+static struct fuse_ring *fuse_uring_create(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring, *res;
+
+	ring = kzalloc(struct_size(ring, queues, nr_cpu_ids),
+		       GFP_KERNEL_ACCOUNT);
+	if (!ring)
+		return NULL;
+
+	ring->fc = fc;
+	ring->nr_queues = nr_cpu_ids;
+	INIT_DELAYED_WORK(&ring->monitor_work, fuse_uring_monitor_work);
+
+	spin_lock(&fc->lock);
+	res = fc->ring;
+	if (!res) {
+		WRITE_ONCE(fc->ring, ring);
+		schedule_delayed_work(&ring->monitor_work,
+				      FUSE_URING_MONITOR_PERIOD);
+	}
+	spin_unlock(&fc->lock);
+
+	if (res) {
+		kfree(ring);
+		return res;
+	}
+	return ring;
+}
+
+static struct fuse_ring_queue *fuse_uring_create_queue(struct fuse_ring *ring,
+						       unsigned int qid)
+{
+	struct fuse_conn *fc = ring->fc;
+	struct fuse_ring_queue *queue, *res;
+	struct list_head *pq;
+
+	queue = kzalloc(sizeof(*queue), GFP_KERNEL_ACCOUNT);
+	if (!queue)
+		return NULL;
+	pq = kcalloc(FUSE_PQ_HASH_SIZE, sizeof(struct list_head), GFP_KERNEL);
+	if (!pq) {
+		kfree(queue);
+		return NULL;
+	}
+
+	queue->ring = ring;
+	queue->qid = qid;
+	queue->fpq.processing = pq;
+	fuse_pqueue_init(&queue->fpq);
+	INIT_LIST_HEAD(&queue->ent_avail);
+	INIT_LIST_HEAD(&queue->ent_busy);
+	INIT_LIST_HEAD(&queue->fuse_req_queue);
+
+	spin_lock(&fc->lock);
+	res = ring->queues[qid];
+	if (!res)
+		WRITE_ONCE(ring->queues[qid], queue);
+	spin_unlock(&fc->lock);
+
+	if (res) {
+		kfree(pq);
+		kfree(queue);
+		return res;
+	}
+	return queue;
+}
+
+/* Called with fpq->lock held, @ent must not be on the available list */
+static void fuse_uring_ent_assign(struct fuse_ring_ent *ent,
+				  struct fuse_req *req)
+{
+	struct fuse_ring_queue *queue = ent->queue;
+
+	ent->req = req;
+	ent->state = FRRS_SENDING;
+	list_move_tail(&ent->list, &queue->ent_busy);
+	list_add(&req->list, &queue->fpq.io);
+}
+
+/*
+ * Give the next waiting request to @ent, or make it available.  Returns true
+ * if a request has to be sent.  Called with fpq->lock held.
+ */
+static bool fuse_uring_ent_next(struct fuse_ring_ent *ent)
+{
+	struct fuse_ring_queue *queue = ent->queue;
+	struct fuse_req *req;
+
+	req = list_first_entry_or_null(&queue->fuse_req_queue, struct fuse_req,
+				       list);
+	if (!req) {
+		ent->req = NULL;
+		ent->state = FRRS_AVAILABLE;
+		list_move_tail(&ent->list, &queue->ent_avail);
+		return false;
+	}
+
+	list_del_init(&req->list);
+	fuse_uring_ent_assign(ent, req);
+	return true;
+}
+
+static int fuse_uring_copy_to_ring(struct fuse_ring_ent *ent,
+				   struct fuse_req *req)
+{
+	struct fuse_args *args = req->args;
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	int err;
+
+	err = import_ubuf(ITER_DEST, ent->buf, ent->buf_len, &iter);
+	if (err)
+		return err;
+
+	fuse_copy_init(&cs, 1, &iter);
+	cs.req = req;
+	err = fuse_copy_one(&cs, &req->in.h, sizeof(req->in.h));
+	if (!err)
+		err = fuse_copy_args(&cs, args->in_numargs, args->in_pages,
+				     (struct fuse_arg *) args->in_args, 0);
+	fuse_copy_finish(&cs);
+	return err;
+}
+
+/*
+ * Copy the request of @ent to its buffer and complete the command of the
+ * server.  Mirrors fuse_dev_do_read().  Runs in the context of the task
+ * serving the queue.
+ */
+static void fuse_uring_send(struct fuse_ring_ent *ent, unsigned int issue_flags)
+{
+	struct fuse_ring_queue *queue = ent->queue;
+	struct fuse_pqueue *fpq = &queue->fpq;
+	struct io_uring_cmd *cmd = ent->cmd;
+	struct fuse_req *req;
+	unsigned int reqsize;
+	bool next;
+	int err;
+
+again:
+	req = ent->req;
+	reqsize = req->in.h.len;
+
+	if (unlikely(current != queue->task || (current->flags & PF_EXITING)))
+		err = -ECONNABORTED;
+	else if (reqsize > ent->buf_len)
+		err = -E2BIG;
+	else
+		err = fuse_uring_copy_to_ring(ent, req);
+
+	spin_lock(&fpq->lock);
+	clear_bit(FR_LOCKED, &req->flags);
+	if (!fpq->connected) {
+		err = -ECONNABORTED;
+		goto out_end;
+	}
+	if (err) {
+		req->out.h.error = -EIO;
+		/* SETXATTR is special, since it may contain too large data */
+		if (err == -E2BIG && req->args->opcode == FUSE_SETXATTR)
+			req->out.h.error = -E2BIG;
+		goto out_end;
+	}
+	list_move_tail(&req->list,
+		       &fpq->processing[fuse_req_hash(req->in.h.unique)]);
+	req->ring_entry = ent;
+	ent->state = FRRS_USERSPACE;
+	__fuse_get_request(req);
+	set_bit(FR_SENT, &req->flags);
+	spin_unlock(&fpq->lock);
+	/* matches barrier in request_wait_answer() */
+	smp_mb__after_atomic();
+	if (test_bit(FR_INTERRUPTED, &req->flags))
+		fuse_queue_interrupt(req);
+	fuse_put_request(req);
+
+	io_uring_cmd_done(cmd, reqsize, 0, issue_flags);
+	return;
+
+out_end:
+	if (!test_bit(FR_PRIVATE, &req->flags))
+		list_del_init(&req->list);
+	ent->req = NULL;
+
+	/* A too large request doesn't spoil the buffer, go on with the next */
+	next = false;
+	if (err == -E2BIG)
+		next = fuse_uring_ent_next(ent);
+	else
+		ent->state = FRRS_RELEASED;
+	spin_unlock(&fpq->lock);
+
+	fuse_request_end(req);
+
+	if (next)
+		goto again;
+	if (err != -E2BIG) {
+		ent->cmd = NULL;
+		io_uring_cmd_done(cmd, err == -ECONNABORTED ? -ENOTCONN : err,
+				  0, issue_flags);
+	}
+}
+
+static void fuse_uring_send_in_task(struct io_uring_cmd *cmd,
+				    unsigned int issue_flags)
+{
+	fuse_uring_send(fuse_uring_cmd_pdu(cmd)->ent, issue_flags);
+}
+
+/*
+ * Queue a request to the ring queue of the current CPU.  Called with
+ * fiq->lock held, after the connection was checked.
+ */
+void fuse_uring_queue_req(struct fuse_req *req)
+{
+	struct fuse_ring *ring = req->fm->fc->ring;
+	struct fuse_ring_queue *queue = ring->queues[smp_processor_id()];
+	struct fuse_pqueue *fpq = &queue->fpq;
+	struct fuse_ring_ent *ent;
+
+	/* never on fiq->pending, see request_wait_answer() */
+	clear_bit(FR_PENDING, &req->flags);
+
+	spin_lock(&fpq->lock);
+	ent = list_first_entry_or_null(&queue->ent_avail, struct fuse_ring_ent,
+				       list);
+	if (ent)
+		fuse_uring_ent_assign(ent, req);
+	else
+		list_add_tail(&req->list, &queue->fuse_req_queue);
+	spin_unlock(&fpq->lock);
+
+	if (ent)
+		io_uring_cmd_complete_in_task(ent->cmd, fuse_uring_send_in_task);
+}
+
+/* Wait with @cmd on @ent for the next request */
+static int fuse_uring_fetch(struct fuse_ring_ent *ent, struct io_uring_cmd *cmd,
+			    unsigned int issue_flags)
+{
+	struct fuse_pqueue *fpq = &ent->queue->fpq;
+	bool send;
+
+	spin_lock(&fpq->lock);
+	if (!fpq->connected) {
+		ent->state = FRRS_RELEASED;
+		list_move_tail(&ent->list, &ent->queue->ent_busy);
+		spin_unlock(&fpq->lock);
+		return -ENOTCONN;
+	}
+	ent->cmd = cmd;
+	fuse_uring_cmd_pdu(cmd)->ent = ent;
+	send = fuse_uring_ent_next(ent);
+	spin_unlock(&fpq->lock);
+
+	if (send)
+		fuse_uring_send(ent, issue_flags);
+	return -EIOCBQUEUED;
+}
+
+static size_t fuse_uring_min_buf_len(struct fuse_conn *fc)
+{
+	/* same as the minimum read buffer of the device */
+	return max_t(size_t, FUSE_MIN_READ_BUFFER,
+		     sizeof(struct fuse_in_header) +
+		     sizeof(struct fuse_write_in) + fc->max_write);
+}
+
+static void fuse_uring_queue_ready(struct fuse_ring *ring)
+{
+	struct fuse_conn *fc = ring->fc;
+
+	spin_lock(&fc->lock);
+	if (++ring->nr_ready == num_possible_cpus())
+		smp_store_release(&ring->ready, true);
+	spin_unlock(&fc->lock);
+}
+
+static int fuse_uring_register(struct io_uring_cmd *cmd,
+			       unsigned int issue_flags, struct fuse_conn *fc)
+{
+	const struct fuse_uring_cmd_req *cmd_req = io_uring_sqe_cmd(cmd->sqe);
+	unsigned int qid = READ_ONCE(cmd_req->qid);
+	struct fuse_ring *ring = fc->ring;
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent;
+	bool first = false;
+
+	if (qid >= nr_cpu_ids || !cpu_possible(qid))
+		return -EINVAL;
+
+	if (!ring) {
+		ring = fuse_uring_create(fc);
+		if (!ring)
+			return -ENOMEM;
+	}
+
+	queue = READ_ONCE(ring->queues[qid]);
+	if (!queue) {
+		queue = fuse_uring_create_queue(ring, qid);
+		if (!queue)
+			return -ENOMEM;
+	}
+
+	ent = kzalloc(sizeof(*ent), GFP_KERNEL_ACCOUNT);
+	if (!ent)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&ent->list);
+	ent->queue = queue;
+	ent->buf = u64_to_user_ptr(READ_ONCE(cmd->sqe->addr));
+	ent->buf_len = READ_ONCE(cmd->sqe->len);
+	if (ent->buf_len < fuse_uring_min_buf_len(fc)) {
+		kfree(ent);
+		return -EINVAL;
+	}
+
+	spin_lock(&queue->fpq.lock);
+	if (!queue->task) {
+		WRITE_ONCE(queue->task, get_task_struct(current));
+		first = true;
+	} else if (queue->task != current) {
+		spin_unlock(&queue->fpq.lock);
+		kfree(ent);
+		return -EINVAL;
+	}
+	ent->state = FRRS_RELEASED;
+	list_add_tail(&ent->list, &queue->ent_busy);
+	spin_unlock(&queue->fpq.lock);
+
+	if (first)
+		fuse_uring_queue_ready(ring);
+
+	return fuse_uring_fetch(ent, cmd, issue_flags);
+}
+
+/* Copy the reply for @req from the buffer of @ent, mirrors fuse_dev_do_write() */
+static int fuse_uring_copy_from_ring(struct fuse_ring_ent *ent,
+				     struct fuse_req *req)
+{
+	struct fuse_copy_state cs;
+	struct fuse_out_header oh;
+	struct iov_iter iter;
+	int err;
+
+	err = import_ubuf(ITER_SOURCE, ent->buf, ent->buf_len, &iter);
+	if (err)
+		return err;
+
+	fuse_copy_init(&cs, 0, &iter);
+	err = fuse_copy_one(&cs, &oh, sizeof(oh));
+	if (err)
+		goto out;
+
+	err = -EINVAL;
+	if (oh.unique != req->in.h.unique || oh.len < sizeof(oh) ||
+	    oh.len > ent->buf_len || oh.error <= -512 || oh.error > 0)
+		goto out;
+
+	cs.req = req;
+	req->out.h = oh;
+	if (oh.error)
+		err = oh.len != sizeof(oh) ? -EINVAL : 0;
+	else
+		err = fuse_copy_out_args(&cs, req->args, oh.len);
+out:
+	fuse_copy_finish(&cs);
+	return err;
+}
+
+static int fuse_uring_commit_fetch(struct io_uring_cmd *cmd,
+				   unsigned int issue_flags,
+				   struct fuse_conn *fc)
+{
+	const struct fuse_uring_cmd_req *cmd_req = io_uring_sqe_cmd(cmd->sqe);
+	unsigned int qid = READ_ONCE(cmd_req->qid);
+	u64 commit_id = READ_ONCE(cmd_req->commit_id);
+	struct fuse_ring *ring = fc->ring;
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent;
+	struct fuse_pqueue *fpq;
+	struct fuse_req *req;
+	int err;
+
+	if (!ring || qid >= ring->nr_queues)
+		return -EINVAL;
+	queue = READ_ONCE(ring->queues[qid]);
+	if (!queue || queue->task != current)
+		return -EINVAL;
+	/* interrupt replies go through the device */
+	if (commit_id & FUSE_INT_REQ_BIT)
+		return -EINVAL;
+
+	fpq = &queue->fpq;
+	spin_lock(&fpq->lock);
+	if (!fpq->connected) {
+		spin_unlock(&fpq->lock);
+		return -ENOTCONN;
+	}
+	req = fuse_request_find(fpq, commit_id);
+	ent = req ? req->ring_entry : NULL;
+	if (!ent || WARN_ON_ONCE(ent->state != FRRS_USERSPACE)) {
+		spin_unlock(&fpq->lock);
+		return -ENOENT;
+	}
+	clear_bit(FR_SENT, &req->flags);
+	list_move(&req->list, &fpq->io);
+	set_bit(FR_LOCKED, &req->flags);
+	req->ring_entry = NULL;
+	ent->req = NULL;
+	spin_unlock(&fpq->lock);
+
+	err = fuse_uring_copy_from_ring(ent, req);
+
+	spin_lock(&fpq->lock);
+	clear_bit(FR_LOCKED, &req->flags);
+	if (fpq->connected && err)
+		req->out.h.error = -EIO;
+	if (!test_bit(FR_PRIVATE, &req->flags))
+		list_del_init(&req->list);
+	spin_unlock(&fpq->lock);
+
+	fuse_request_end(req);
+
+	/*
+	 * A broken reply only fails its request, like a write to the device
+	 * would, the buffer goes on serving requests.
+	 */
+	return fuse_uring_fetch(ent, cmd, issue_flags);
+}
+
+int fuse_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
+{
+	struct fuse_dev *fud = fuse_get_dev(cmd->file);
+	struct fuse_conn *fc;
+
+	if (!fud)
+		return -EPERM;
+	fc = fud->fc;
+
+	if (!enable_uring || !fc->io_uring)
+		return -EOPNOTSUPP;
+	if (!fc->connected)
+		return fc->aborted ? -ECONNABORTED : -ENOTCONN;
+
+	switch (cmd->cmd_op) {
+	case FUSE_IO_URING_CMD_REGISTER:
+		return fuse_uring_register(cmd, issue_flags, fc);
+	case FUSE_IO_URING_CMD_COMMIT_AND_FETCH:
+		return fuse_uring_commit_fetch(cmd, issue_flags, fc);
+	default:
+		return -EINVAL;
+	}
+}
+
+/*
+ * Find a request sent over the ring and take a reference on it, for the
+ * interrupt replies, which are written to /dev/fuse.
+ */
+struct fuse_req *fuse_uring_request_get(struct fuse_conn *fc, u64 unique)
+{
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+	struct fuse_req *req = NULL;
+	unsigned int qid;
+
+	if (!ring)
+		return NULL;
+
+	for (qid = 0; qid < ring->nr_queues && !req; qid++) {
+		struct fuse_ring_queue *queue = READ_ONCE(ring->queues[qid]);
+		struct fuse_pqueue *fpq;
+
+		if (!queue)
+			continue;
+
+		fpq = &queue->fpq;
+		spin_lock(&fpq->lock);
+		if (fpq->connected)
+			req = fuse_request_find(fpq, unique);
+		if (req)
+			__fuse_get_request(req);
+		spin_unlock(&fpq->lock);
+	}
+
+	return req;
+}
+
+/*
+ * Called from fuse_abort_conn() once no request can be queued anymore: end
+ * the requests of the queues and complete the commands waiting for one.
+ * Commands with a request being sent are completed by the send.
+ */
+void fuse_uring_abort(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	for (qid = 0; qid < ring->nr_queues; qid++) {
+		struct fuse_ring_queue *queue = READ_ONCE(ring->queues[qid]);
+		struct fuse_pqueue *fpq;
+		struct fuse_ring_ent *ent;
+		LIST_HEAD(to_end);
+
+		if (!queue)
+			continue;
+
+		fpq = &queue->fpq;
+		spin_lock(&fpq->lock);
+		fuse_pqueue_abort(fpq, &to_end);
+		list_splice_tail_init(&queue->fuse_req_queue, &to_end);
+		spin_unlock(&fpq->lock);
+
+		fuse_dev_end_requests(&to_end);
+
+		for (;;) {
+			struct io_uring_cmd *cmd;
+
+			spin_lock(&fpq->lock);
+			ent = list_first_entry_or_null(&queue->ent_avail,
+						       struct fuse_ring_ent,
+						       list);
+			if (!ent) {
+				spin_unlock(&fpq->lock);
+				break;
+			}
+			cmd = ent->cmd;
+			ent->cmd = NULL;
+			ent->state = FRRS_RELEASED;
+			list_move_tail(&ent->list, &queue->ent_busy);
+			spin_unlock(&fpq->lock);
+
+			io_uring_cmd_done(cmd, -ENOTCONN, 0, IO_URING_F_UNLOCKED);
+		}
+	}
+}
+
+/* Called when the connection is freed, no command can be pending anymore */
+void fuse_uring_destruct(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = fc->ring;
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	cancel_delayed_work_sync(&ring->monitor_work);
+
+	for (qid = 0; qid < ring->nr_queues; qid++) {
+		struct fuse_ring_queue *queue = ring->queues[qid];
+		struct fuse_ring_ent *ent, *next;
+
+		if (!queue)
+			continue;
+
+		WARN_ON(!list_empty(&queue->ent_avail));
+		list_for_each_entry_safe(ent, next, &queue->ent_busy, list) {
+			WARN_ON(ent->state != FRRS_RELEASED &&
+				ent->state != FRRS_USERSPACE);
+			list_del(&ent->list);
+			kfree(ent);
+		}
+		if (queue->task)
+			put_task_struct(queue->task);
+		kfree(queue->fpq.processing);
+		kfree(queue);
+	}
+
+	kfree(ring);
+	fc->ring = NULL;
+}
@@ -0,0 +1,126 @@
+/* SPDX-License-Identifier: GPL-2.0
+ *
+ * FUSE: Filesystem in Userspace
+ *
+ * io_uring request transport.
+ */
+#ifndef _FS_FUSE_DEV_URING_I_H
+#define _FS_FUSE_DEV_URING_I_H
+
+#include "fuse_i.h"
+
+#ifdef CONFIG_FUSE_IO_URING
+
+struct io_uring_cmd;
+
+enum fuse_ring_ent_state {
+	/* the entry waits with a command for a request */
+	FRRS_AVAILABLE,
+	/* a request is being copied to the buffer of the entry */
+	FRRS_SENDING,
+	/* the request is with the server, waiting for the commit */
+	FRRS_USERSPACE,
+	/* the command was completed with an error, the buffer is unused */
+	FRRS_RELEASED,
+};
+
+/* A buffer of the server, with the command that waits on it */
+struct fuse_ring_ent {
+	/* on queue->ent_avail if available, on queue->ent_busy otherwise */
+	struct list_head list;
+
+	struct fuse_ring_queue *queue;
+	enum fuse_ring_ent_state state;
+
+	/* command of the server, valid while available or sending */
+	struct io_uring_cmd *cmd;
+
+	void __user *buf;
+	size_t buf_len;
+
+	/* request being sent or handled by the server */
+	struct fuse_req *req;
+};
+
+struct fuse_ring_queue {
+	struct fuse_ring *ring;
+	unsigned int qid;
+
+	/* the task serving the queue, set by the first registration */
+	struct task_struct *task;
+
+	/* fpq.lock protects the queue */
+	struct fuse_pqueue fpq;
+
+	struct list_head ent_avail;
+	struct list_head ent_busy;
+
+	/* requests waiting for an available entry */
+	struct list_head fuse_req_queue;
+};
+
+struct fuse_ring {
+	struct fuse_conn *fc;
+
+	/* one queue per possible CPU */
+	unsigned int nr_queues;
+
+	/* number of queues with a registered entry, under fc->lock */
+	unsigned int nr_ready;
+
+	/* set once all the queues have a registered entry */
+	bool ready;
+
+	/* aborts the connection if a server task dies */
+	struct delayed_work monitor_work;
+
+	struct fuse_ring_queue *queues[];
+};
+
+bool fuse_uring_enabled(void);
+int fuse_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags);
+void fuse_uring_queue_req(struct fuse_req *req);
+struct fuse_req *fuse_uring_request_get(struct fuse_conn *fc, u64 unique);
+void fuse_uring_abort(struct fuse_conn *fc);
+void fuse_uring_destruct(struct fuse_conn *fc);
+
+static inline bool fuse_uring_ready(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = READ_ONCE(fc->ring);
+
+	return ring && smp_load_acquire(&ring->ready);
+}
+
+#else /* CONFIG_FUSE_IO_URING */
+
+static inline bool fuse_uring_enabled(void)
+{
+	return false;
+}
+
+static inline void fuse_uring_queue_req(struct fuse_req *req)
+{
+}
+
+static inline struct fuse_req *fuse_uring_request_get(struct fuse_conn *fc,
+						      u64 unique)
+{
+	return NULL;
+}
+
+static inline void fuse_uring_abort(struct fuse_conn *fc)
+{
+}
+
+static inline void fuse_uring_destruct(struct fuse_conn *fc)
+{
+}
+
+static inline bool fuse_uring_ready(struct fuse_conn *fc)
+{
+	return false;
+}
+
+#endif /* CONFIG_FUSE_IO_URING */
+
+#endif /* _FS_FUSE_DEV_URING_I_H */
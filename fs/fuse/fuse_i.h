@@ -31,6 +31,7 @@
 #include <linux/pid_namespace.h>
 #include <linux/refcount.h>
 #include <linux/user_namespace.h>
+#include <linux/idr.h>
 
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
@@ -112,6 +113,11 @@ struct fuse_inode {
 
 			/* List of writepage requestst (pending or sent) */
 			struct rb_root writepages;
+
+			/* Number of cached opens if positive, number of
+			 * passthrough opens if negative.  Protected by
+			 * fi->lock */
+			int iocachectr;
 		};
 
 		/* readdir cache (directory only) */
@@ -226,6 +232,30 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** Is this a cached open, counted in fi->iocachectr? */
+	bool iocache:1;
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/** Backing id from the open reply, if FOPEN_PASSTHROUGH */
+	int backing_id;
+
+	/** The backing file and its file opened for passthrough io */
+	struct fuse_backing *fb;
+	struct file *passthrough;
+#endif
+};
+
+/** A file registered by the server for passthrough io */
+struct fuse_backing {
+	struct file *file;
+
+	/** Credentials of the server, used for passthrough io */
+	const struct cred *cred;
+
+	/** Refcount, one for the backing id and one for each open */
+	refcount_t count;
+	struct rcu_head rcu;
 };
 
 /** One input argument of a request */
@@ -374,6 +404,11 @@ struct fuse_req {
 	void *argbuf;
 #endif
 
+#ifdef CONFIG_FUSE_IO_URING
+	/** io_uring ring entry the request was sent with */
+	void *ring_entry;
+#endif
+
 	/** fuse_mount this request belongs to */
 	struct fuse_mount *fm;
 };
@@ -792,6 +827,15 @@ struct fuse_conn {
 	/* Is tmpfile not implemented by fs? */
 	unsigned int no_tmpfile:1;
 
+	/* Does the server accept requests over io_uring? */
+	unsigned int io_uring:1;
+
+	/* Are passthrough opens enabled? */
+	unsigned int passthrough:1;
+
+	/* Maximum stack depth of the backing files */
+	int max_stack_depth;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -841,6 +885,16 @@ struct fuse_conn {
 
 	/* New writepages go into this bucket */
 	struct fuse_sync_bucket __rcu *curr_bucket;
+
+#ifdef CONFIG_FUSE_IO_URING
+	/* io_uring request transport, created by the first registration */
+	struct fuse_ring *ring;
+#endif
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/** Backing files registered by the server, protected by fc->lock */
+	struct idr backing_files_map;
+#endif
 };
 
 /*
@@ -1012,7 +1066,7 @@ int fuse_open_common(struct inode *inode, struct file *file, bool isdir);
 
 struct fuse_file *fuse_file_alloc(struct fuse_mount *fm);
 void fuse_file_free(struct fuse_file *ff);
-void fuse_finish_open(struct inode *inode, struct file *file);
+int fuse_finish_open(struct inode *inode, struct file *file);
 
 void fuse_sync_release(struct fuse_inode *fi, struct fuse_file *ff,
 		       unsigned int flags);
@@ -1133,6 +1187,7 @@ void fuse_conn_put(struct fuse_conn *fc);
 
 struct fuse_dev *fuse_dev_alloc_install(struct fuse_conn *fc);
 struct fuse_dev *fuse_dev_alloc(void);
+void fuse_pqueue_init(struct fuse_pqueue *fpq);
 void fuse_dev_install(struct fuse_dev *fud, struct fuse_conn *fc);
 void fuse_dev_free(struct fuse_dev *fud);
 void fuse_send_init(struct fuse_mount *fm);
@@ -1324,4 +1379,73 @@ struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
 void fuse_file_release(struct inode *inode, struct fuse_file *ff,
 		       unsigned int open_flags, fl_owner_t id, bool isdir);
 
+/* passthrough.c */
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+void fuse_backing_files_init(struct fuse_conn *fc);
+void fuse_backing_files_free(struct fuse_conn *fc);
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map);
+int fuse_backing_close(struct fuse_conn *fc, int backing_id);
+
+int fuse_passthrough_open(struct inode *inode, struct file *file);
+void fuse_passthrough_release(struct inode *inode, struct fuse_file *ff);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *iter);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *iter);
+ssize_t fuse_passthrough_splice_read(struct file *in, loff_t *ppos,
+				     struct pipe_inode_info *pipe,
+				     size_t len, unsigned int flags);
+ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
+				      struct file *out, loff_t *ppos,
+				      size_t len, unsigned int flags);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+#else
+static inline void fuse_backing_files_init(struct fuse_conn *fc) {}
+static inline void fuse_backing_files_free(struct fuse_conn *fc) {}
+static inline int fuse_backing_open(struct fuse_conn *fc,
+				    struct fuse_backing_map *map)
+{
+	return -EOPNOTSUPP;
+}
+static inline int fuse_backing_close(struct fuse_conn *fc, int backing_id)
+{
+	return -EOPNOTSUPP;
+}
+static inline int fuse_passthrough_open(struct inode *inode, struct file *file)
+{
+	return -EINVAL;
+}
+static inline void fuse_passthrough_release(struct inode *inode,
+					    struct fuse_file *ff) {}
+static inline ssize_t fuse_passthrough_read_iter(struct kiocb *iocb,
+						 struct iov_iter *iter)
+{
+	return -EINVAL;
+}
+static inline ssize_t fuse_passthrough_write_iter(struct kiocb *iocb,
+						  struct iov_iter *iter)
+{
+	return -EINVAL;
+}
+static inline ssize_t fuse_passthrough_splice_read(struct file *in,
+						   loff_t *ppos,
+						   struct pipe_inode_info *pipe,
+						   size_t len,
+						   unsigned int flags)
+{
+	return -EINVAL;
+}
+static inline ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
+						    struct file *out,
+						    loff_t *ppos, size_t len,
+						    unsigned int flags)
+{
+	return -EINVAL;
+}
+static inline int fuse_passthrough_mmap(struct file *file,
+					struct vm_area_struct *vma)
+{
+	return -EINVAL;
+}
+#endif
+
 #endif /* _FS_FUSE_I_H */
@@ -7,6 +7,7 @@
 */
 
 #include "fuse_i.h"
+#include "dev_uring_i.h"
 
 #include <linux/pagemap.h>
 #include <linux/slab.h>
@@ -51,6 +52,21 @@ MODULE_PARM_DESC(max_user_congthresh,
  "Global limit for the maximum congestion threshold an "
  "unprivileged user can set");
 
+static unsigned int max_readahead_reqs;
+module_param(max_readahead_reqs, uint, 0644);
+MODULE_PARM_DESC(max_readahead_reqs,
+ "Number of maximum sized read requests the readahead window of a new "
+ "connection may span (0: use the default readahead window)");
+
+/* Readahead window spanning max_readahead_reqs requests of @max_pages */
+static unsigned long fuse_readahead_reqs_pages(unsigned int max_pages)
+{
+	unsigned long ra_pages = (unsigned long) max_readahead_reqs * max_pages;
+
+	/* It must fit the u32 max_readahead of FUSE_INIT in bytes */
+	return min_t(unsigned long, ra_pages, U32_MAX / PAGE_SIZE);
+}
+
 #define FUSE_DEFAULT_BLKSIZE 512
 
 /** Maximum number of outstanding background requests */
@@ -814,7 +830,7 @@ static void fuse_iqueue_init(struct fuse_iqueue *fiq,
 	fiq->priv = priv;
 }
 
-static void fuse_pqueue_init(struct fuse_pqueue *fpq)
+void fuse_pqueue_init(struct fuse_pqueue *fpq)
 {
 	unsigned int i;
 
@@ -854,6 +870,7 @@ void fuse_conn_init(struct fuse_conn *fc, struct fuse_mount *fm,
 	fc->user_ns = get_user_ns(user_ns);
 	fc->max_pages = FUSE_DEFAULT_MAX_PAGES_PER_REQ;
 	fc->max_pages_limit = FUSE_MAX_MAX_PAGES;
+	fuse_backing_files_init(fc);
 
 	INIT_LIST_HEAD(&fc->mounts);
 	list_add(&fm->fc_entry, &fc->mounts);
@@ -869,6 +886,8 @@ void fuse_conn_put(struct fuse_conn *fc)
 
 		if (IS_ENABLED(CONFIG_FUSE_DAX))
 			fuse_dax_conn_free(fc);
+		fuse_uring_destruct(fc);
+		fuse_backing_files_free(fc);
 		if (fiq->ops->release)
 			fiq->ops->release(fiq);
 		put_pid_ns(fc->pid_ns);
@@ -1209,14 +1228,43 @@ static void process_init_reply(struct fuse_mount *fm, struct fuse_args *args,
 				fc->init_security = 1;
 			if (flags & FUSE_CREATE_SUPP_GROUP)
 				fc->create_supp_group = 1;
+			if ((flags & FUSE_OVER_IO_URING) && fuse_uring_enabled())
+				fc->io_uring = 1;
+			/*
+			 * The backing files are stacked below this mount, so
+			 * it can't be stacked on by passthrough or overlayfs
+			 * beyond the limit.
+			 */
+			if (IS_ENABLED(CONFIG_FUSE_PASSTHROUGH) &&
+			    (flags & FUSE_PASSTHROUGH) &&
+			    arg->max_stack_depth > 0 &&
+			    arg->max_stack_depth <= FILESYSTEM_MAX_STACK_DEPTH) {
+				fc->passthrough = 1;
+				fc->max_stack_depth = arg->max_stack_depth;
+				fm->sb->s_stack_depth = arg->max_stack_depth;
+			}
 		} else {
 			ra_pages = fc->max_read / PAGE_SIZE;
 			fc->no_lock = 1;
 			fc->no_flock = 1;
 		}
 
+		/*
+		 * The window offered was sized for requests of max_pages_limit,
+		 * trim it to the max_pages just negotiated.
+		 */
+		if (max_readahead_reqs) {
+			unsigned long reqs_pages;
+
+			reqs_pages = fuse_readahead_reqs_pages(fc->max_pages);
+			reqs_pages = max_t(unsigned long, reqs_pages,
+					   VM_READAHEAD_PAGES);
+			ra_pages = min(ra_pages, reqs_pages);
+		}
 		fm->sb->s_bdi->ra_pages =
 				min(fm->sb->s_bdi->ra_pages, ra_pages);
+		if (max_readahead_reqs)
+			fm->sb->s_bdi->io_pages = fm->sb->s_bdi->ra_pages;
 		fc->minor = arg->minor;
 		fc->max_write = arg->minor < 5 ? 4096 : arg->max_write;
 		fc->max_write = max_t(unsigned, 4096, fc->max_write);
@@ -1263,6 +1311,10 @@ void fuse_send_init(struct fuse_mount *fm)
 #endif
 	if (fm->fc->auto_submounts)
 		flags |= FUSE_SUBMOUNTS;
+	if (fuse_uring_enabled())
+		flags |= FUSE_OVER_IO_URING;
+	if (IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+		flags |= FUSE_PASSTHROUGH;
 
 	ia->in.flags = flags;
 	ia->in.flags2 = flags >> 32;
@@ -1331,6 +1383,20 @@ static int fuse_bdi_init(struct fuse_conn *fc, struct super_block *sb)
 	 */
 	bdi_set_max_ratio(sb->s_bdi, 1);
 
+	/*
+	 * Let the readahead window cover several full sized requests, so
+	 * that sequential reads keep that many FUSE_READs in flight.  This
+	 * is what is offered in FUSE_INIT, the server may lower it, and it is
+	 * trimmed once max_pages is negotiated.
+	 */
+	if (max_readahead_reqs) {
+		unsigned long ra_pages =
+			fuse_readahead_reqs_pages(fc->max_pages_limit);
+
+		sb->s_bdi->ra_pages = max(sb->s_bdi->ra_pages, ra_pages);
+		sb->s_bdi->io_pages = sb->s_bdi->ra_pages;
+	}
+
 	return 0;
 }
 
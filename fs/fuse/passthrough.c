@@ -0,0 +1,454 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE passthrough to backing file.
+ *
+ * The server registers a backing file with FUSE_DEV_IOC_BACKING_OPEN and
+ * returns its backing id with FOPEN_PASSTHROUGH in the open reply.  Reads,
+ * writes, splices and mmaps of the open file are then done on the backing
+ * file, the same way overlayfs stacks on its real files, with the
+ * credentials of the server at registration time.  Everything else still
+ * goes through the server.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/cred.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/idr.h>
+#include <linux/splice.h>
+#include <linux/uio.h>
+
+struct fuse_aio_req {
+	struct kiocb iocb;
+	refcount_t ref;
+	struct kiocb *orig_iocb;
+};
+
+static void fuse_backing_free(struct fuse_backing *fb)
+{
+	fput(fb->file);
+	put_cred(fb->cred);
+	kfree_rcu(fb, rcu);
+}
+
+static void fuse_backing_put(struct fuse_backing *fb)
+{
+	if (fb && refcount_dec_and_test(&fb->count))
+		fuse_backing_free(fb);
+}
+
+static struct fuse_backing *fuse_backing_lookup(struct fuse_conn *fc,
+						int backing_id)
+{
+	struct fuse_backing *fb;
+
+	if (backing_id <= 0)
+		return NULL;
+
+	rcu_read_lock();
+	fb = idr_find(&fc->backing_files_map, backing_id);
+	if (fb && !refcount_inc_not_zero(&fb->count))
+		fb = NULL;
+	rcu_read_unlock();
+
+	return fb;
+}
+
+void fuse_backing_files_init(struct fuse_conn *fc)
+{
+	idr_init(&fc->backing_files_map);
+}
+
+void fuse_backing_files_free(struct fuse_conn *fc)
+{
+	struct fuse_backing *fb;
+	int id;
+
+	idr_for_each_entry(&fc->backing_files_map, fb, id)
+		fuse_backing_put(fb);
+
+	idr_destroy(&fc->backing_files_map);
+}
+
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
+{
+	struct fuse_backing *fb;
+	struct file *file;
+	int res;
+
+	res = -EOPNOTSUPP;
+	if (!fc->passthrough)
+		goto out;
+
+	/*
+	 * Backing files are not visible to the usual tools (lsof and the
+	 * like), so for now only a privileged server may register them.
+	 */
+	res = -EPERM;
+	if (!capable(CAP_SYS_ADMIN))
+		goto out;
+
+	res = -EINVAL;
+	if (map->flags || map->padding)
+		goto out;
+
+	res = -EBADF;
+	file = fget(map->fd);
+	if (!file)
+		goto out;
+
+	res = -EINVAL;
+	if (!d_is_reg(file->f_path.dentry))
+		goto out_fput;
+
+	res = -EOPNOTSUPP;
+	if (!file->f_op->read_iter || !file->f_op->write_iter)
+		goto out_fput;
+
+	res = -ELOOP;
+	if (file_inode(file)->i_sb->s_stack_depth >= fc->max_stack_depth)
+		goto out_fput;
+
+	res = -ENOMEM;
+	fb = kmalloc(sizeof(*fb), GFP_KERNEL);
+	if (!fb)
+		goto out_fput;
+
+	fb->cred = prepare_creds();
+	if (!fb->cred) {
+		kfree(fb);
+		goto out_fput;
+	}
+	fb->file = file;
+	refcount_set(&fb->count, 1);
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->lock);
+	res = idr_alloc_cyclic(&fc->backing_files_map, fb, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->lock);
+	idr_preload_end();
+
+	if (res < 0)
+		fuse_backing_free(fb);
+
+	return res;
+
+out_fput:
+	fput(file);
+out:
+	return res;
+}
+
+int fuse_backing_close(struct fuse_conn *fc, int backing_id)
+{
+	struct fuse_backing *fb;
+
+	if (!fc->passthrough)
+		return -EOPNOTSUPP;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (backing_id <= 0)
+		return -EINVAL;
+
+	spin_lock(&fc->lock);
+	fb = idr_remove(&fc->backing_files_map, backing_id);
+	spin_unlock(&fc->lock);
+	if (!fb)
+		return -ENOENT;
+
+	/* Files already open keep their reference */
+	fuse_backing_put(fb);
+
+	return 0;
+}
+
+/*
+ * Open the backing file for a FOPEN_PASSTHROUGH reply.  Fails with -ETXTBSY
+ * if the inode has cached opens, see fuse_file_io_open().
+ */
+int fuse_passthrough_open(struct inode *inode, struct file *file)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct fuse_backing *fb;
+	struct file *backing_file;
+	bool first = false;
+	int err;
+
+	/* The server has to register the backing file before replying */
+	fb = fuse_backing_lookup(fc, ff->backing_id);
+	if (!fb)
+		return -EIO;
+
+	err = -ETXTBSY;
+	spin_lock(&fi->lock);
+	if (fi->iocachectr <= 0) {
+		first = !fi->iocachectr;
+		fi->iocachectr--;
+		err = 0;
+	}
+	spin_unlock(&fi->lock);
+	if (err)
+		goto out_put;
+
+	/* Drop what the cached opens left behind, it would go stale */
+	if (first)
+		invalidate_inode_pages2(inode->i_mapping);
+
+	backing_file = backing_file_open(&file->f_path, file->f_flags,
+					 &fb->file->f_path, fb->cred);
+	if (IS_ERR(backing_file)) {
+		err = PTR_ERR(backing_file);
+		goto out_dec;
+	}
+
+	ff->fb = fb;
+	ff->passthrough = backing_file;
+
+	return 0;
+
+out_dec:
+	spin_lock(&fi->lock);
+	fi->iocachectr++;
+	spin_unlock(&fi->lock);
+out_put:
+	fuse_backing_put(fb);
+	return err;
+}
+
+void fuse_passthrough_release(struct inode *inode, struct fuse_file *ff)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+
+	/* A cached open, or one of fuse_file_open() not set up for io */
+	if (!ff->passthrough)
+		return;
+
+	fput(ff->passthrough);
+	ff->passthrough = NULL;
+	fuse_backing_put(ff->fb);
+	ff->fb = NULL;
+
+	spin_lock(&fi->lock);
+	fi->iocachectr++;
+	spin_unlock(&fi->lock);
+}
+
+static rwf_t fuse_iocb_to_rwf(int ifl)
+{
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+static inline void fuse_aio_put(struct fuse_aio_req *aio_req)
+{
+	if (refcount_dec_and_test(&aio_req->ref))
+		kfree(aio_req);
+}
+
+static void fuse_aio_cleanup_handler(struct fuse_aio_req *aio_req)
+{
+	struct kiocb *iocb = &aio_req->iocb;
+	struct kiocb *orig_iocb = aio_req->orig_iocb;
+
+	if (iocb->ki_flags & IOCB_WRITE) {
+		/* Actually acquired in fuse_passthrough_write_iter() */
+		__sb_writers_acquired(file_inode(iocb->ki_filp)->i_sb,
+				      SB_FREEZE_WRITE);
+		file_end_write(iocb->ki_filp);
+		/* May be called from irq context, can't take fi->lock */
+		fuse_invalidate_attr_mask(file_inode(orig_iocb->ki_filp),
+					  FUSE_STATX_MODSIZE);
+	}
+
+	orig_iocb->ki_pos = iocb->ki_pos;
+	fuse_aio_put(aio_req);
+}
+
+static void fuse_aio_rw_complete(struct kiocb *iocb, long res)
+{
+	struct fuse_aio_req *aio_req = container_of(iocb,
+						    struct fuse_aio_req, iocb);
+	struct kiocb *orig_iocb = aio_req->orig_iocb;
+
+	fuse_aio_cleanup_handler(aio_req);
+	orig_iocb->ki_complete(orig_iocb, res);
+}
+
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *iter)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = ff->passthrough;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(iter))
+		return 0;
+
+	if (iocb->ki_flags & IOCB_DIRECT &&
+	    !(backing_file->f_mode & FMODE_CAN_ODIRECT))
+		return -EINVAL;
+
+	old_cred = override_creds(ff->fb->cred);
+	if (is_sync_kiocb(iocb)) {
+		ret = vfs_iter_read(backing_file, iter, &iocb->ki_pos,
+				    fuse_iocb_to_rwf(iocb->ki_flags));
+	} else {
+		struct fuse_aio_req *aio_req;
+
+		ret = -ENOMEM;
+		aio_req = kzalloc(sizeof(*aio_req), GFP_KERNEL);
+		if (!aio_req)
+			goto out;
+
+		aio_req->orig_iocb = iocb;
+		kiocb_clone(&aio_req->iocb, iocb, backing_file);
+		aio_req->iocb.ki_complete = fuse_aio_rw_complete;
+		refcount_set(&aio_req->ref, 2);
+		ret = vfs_iocb_iter_read(backing_file, &aio_req->iocb, iter);
+		fuse_aio_put(aio_req);
+		if (ret != -EIOCBQUEUED)
+			fuse_aio_cleanup_handler(aio_req);
+	}
+out:
+	revert_creds(old_cred);
+	fuse_invalidate_atime(file_inode(file));
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *iter)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = ff->passthrough;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(iter))
+		return 0;
+
+	inode_lock(inode);
+	ret = -EINVAL;
+	if (iocb->ki_flags & IOCB_DIRECT &&
+	    !(backing_file->f_mode & FMODE_CAN_ODIRECT))
+		goto out_unlock;
+
+	old_cred = override_creds(ff->fb->cred);
+	if (is_sync_kiocb(iocb)) {
+		file_start_write(backing_file);
+		ret = vfs_iter_write(backing_file, iter, &iocb->ki_pos,
+				     fuse_iocb_to_rwf(iocb->ki_flags));
+		file_end_write(backing_file);
+		fuse_write_update_attr(inode, iocb->ki_pos, ret);
+	} else {
+		struct fuse_aio_req *aio_req;
+
+		ret = -ENOMEM;
+		aio_req = kzalloc(sizeof(*aio_req), GFP_KERNEL);
+		if (!aio_req)
+			goto out;
+
+		file_start_write(backing_file);
+		/* Pacify lockdep, same trick as done in aio_write() */
+		__sb_writers_release(file_inode(backing_file)->i_sb,
+				     SB_FREEZE_WRITE);
+		aio_req->orig_iocb = iocb;
+		kiocb_clone(&aio_req->iocb, iocb, backing_file);
+		aio_req->iocb.ki_complete = fuse_aio_rw_complete;
+		refcount_set(&aio_req->ref, 2);
+		ret = vfs_iocb_iter_write(backing_file, &aio_req->iocb, iter);
+		fuse_aio_put(aio_req);
+		if (ret != -EIOCBQUEUED)
+			fuse_aio_cleanup_handler(aio_req);
+	}
+out:
+	revert_creds(old_cred);
+out_unlock:
+	inode_unlock(inode);
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_splice_read(struct file *in, loff_t *ppos,
+				     struct pipe_inode_info *pipe,
+				     size_t len, unsigned int flags)
+{
+	struct fuse_file *ff = in->private_data;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	old_cred = override_creds(ff->fb->cred);
+	ret = vfs_splice_read(ff->passthrough, ppos, pipe, len, flags);
+	revert_creds(old_cred);
+	fuse_invalidate_atime(file_inode(in));
+
+	return ret;
+}
+
+/*
+ * Like for overlayfs, iter_file_splice_write() on the fuse file would take
+ * pipe->mutex before file_start_write() on the backing file, so splice to
+ * the backing file directly.
+ */
+ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
+				      struct file *out, loff_t *ppos,
+				      size_t len, unsigned int flags)
+{
+	struct fuse_file *ff = out->private_data;
+	struct inode *inode = file_inode(out);
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	inode_lock(inode);
+	old_cred = override_creds(ff->fb->cred);
+	file_start_write(ff->passthrough);
+
+	ret = iter_file_splice_write(pipe, ff->passthrough, ppos, len, flags);
+
+	file_end_write(ff->passthrough);
+	fuse_write_update_attr(inode, *ppos, ret);
+	revert_creds(old_cred);
+	inode_unlock(inode);
+
+	return ret;
+}
+
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = ff->passthrough;
+	const struct cred *old_cred;
+	int ret;
+
+	if (!backing_file->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	vma_set_file(vma, backing_file);
+
+	old_cred = override_creds(ff->fb->cred);
+	ret = call_mmap(vma->vm_file, vma);
+	revert_creds(old_cred);
+	fuse_invalidate_atime(file_inode(file));
+
+	return ret;
+}
@@ -6,6 +6,8 @@
 
 #include <linux/fs.h>
 #include <linux/dax.h>
+#include <linux/debugfs.h>
+#include <linux/group_cpus.h>
 #include <linux/pci.h>
 #include <linux/pfn_t.h>
 #include <linux/memremap.h>
@@ -16,6 +18,7 @@
 #include <linux/fs_context.h>
 #include <linux/fs_parser.h>
 #include <linux/highmem.h>
+#include <linux/seq_file.h>
 #include <linux/uio.h>
 #include "fuse_i.h"
 
@@ -31,6 +34,8 @@
 static DEFINE_MUTEX(virtio_fs_mutex);
 static LIST_HEAD(virtio_fs_instances);
 
+static struct dentry *virtio_fs_debugfs_root;
+
 enum {
 	VQ_HIPRIO,
 	VQ_REQUEST
@@ -50,6 +55,7 @@ struct virtio_fs_vq {
 	bool connected;
 	long in_flight;
 	struct completion in_flight_zero; /* No inflight requests */
+	u64 nr_reqs;			/* Requests sent, under ->lock */
 	char name[VQ_NAME_LEN];
 } ____cacheline_aligned_in_smp;
 
@@ -61,7 +67,9 @@ struct virtio_fs {
 	struct virtio_fs_vq *vqs;
 	unsigned int nvqs;               /* number of virtqueues */
 	unsigned int num_request_queues; /* number of request queues */
+	unsigned int *mq_map;		 /* index = cpu id, value = vq index */
 	struct dax_device *dax_dev;
+	struct dentry *debugfs_dir;
 
 	/* DAX memory window where file contents are mapped */
 	void *window_kaddr;
@@ -165,6 +173,7 @@ static void release_virtio_fs_obj(struct kref *ref)
 {
 	struct virtio_fs *vfs = container_of(ref, struct virtio_fs, refcount);
 
+	kfree(vfs->mq_map);
 	kfree(vfs->vqs);
 	kfree(vfs);
 }
@@ -454,6 +463,7 @@ static int send_forget_request(struct virtio_fs_vq *fsvq,
 
 	if (!in_flight)
 		inc_in_flight_req(fsvq);
+	fsvq->nr_reqs++;
 	notify = virtqueue_kick_prepare(vq);
 	spin_unlock(&fsvq->lock);
 
@@ -679,12 +689,51 @@ static void virtio_fs_init_vq(struct virtio_fs_vq *fsvq, char *name,
 	}
 }
 
+static void virtio_fs_map_queues(struct virtio_device *vdev,
+				 struct virtio_fs *fs)
+{
+	const struct cpumask *mask, *masks;
+	unsigned int q, cpu;
+
+	/* First attempt to map using the interrupt affinity of the queues */
+	if (!vdev->config->get_vq_affinity)
+		goto fallback;
+
+	for (q = 0; q < fs->num_request_queues; q++) {
+		mask = vdev->config->get_vq_affinity(vdev, VQ_REQUEST + q);
+		if (!mask)
+			goto fallback;
+
+		for_each_cpu(cpu, mask)
+			fs->mq_map[cpu] = q + VQ_REQUEST;
+	}
+
+	return;
+fallback:
+	/* Attempt to map evenly in groups over the CPUs */
+	masks = group_cpus_evenly(fs->num_request_queues);
+	/* If even this fails, all CPUs use the first request queue */
+	if (!masks) {
+		for_each_possible_cpu(cpu)
+			fs->mq_map[cpu] = VQ_REQUEST;
+		return;
+	}
+
+	for (q = 0; q < fs->num_request_queues; q++) {
+		for_each_cpu(cpu, &masks[q])
+			fs->mq_map[cpu] = q + VQ_REQUEST;
+	}
+	kfree(masks);
+}
+
 /* Initialize virtqueues */
 static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 			       struct virtio_fs *fs)
 {
 	struct virtqueue **vqs;
 	vq_callback_t **callbacks;
+	/* Specify pre_vectors to ensure that the hiprio queue isn't spread */
+	struct irq_affinity desc = { .pre_vectors = VQ_REQUEST };
 	const char **names;
 	unsigned int i;
 	int ret = 0;
@@ -694,6 +743,10 @@ static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 	if (fs->num_request_queues == 0)
 		return -EINVAL;
 
+	/* Queues beyond one per CPU would never be used */
+	fs->num_request_queues = min_t(unsigned int, fs->num_request_queues,
+				       nr_cpu_ids);
+
 	fs->nvqs = VQ_REQUEST + fs->num_request_queues;
 	fs->vqs = kcalloc(fs->nvqs, sizeof(fs->vqs[VQ_HIPRIO]), GFP_KERNEL);
 	if (!fs->vqs)
@@ -703,7 +756,9 @@ static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 	callbacks = kmalloc_array(fs->nvqs, sizeof(callbacks[VQ_HIPRIO]),
 					GFP_KERNEL);
 	names = kmalloc_array(fs->nvqs, sizeof(names[VQ_HIPRIO]), GFP_KERNEL);
-	if (!vqs || !callbacks || !names) {
+	fs->mq_map = kcalloc_node(nr_cpu_ids, sizeof(*fs->mq_map), GFP_KERNEL,
+				  dev_to_node(&vdev->dev));
+	if (!vqs || !callbacks || !names || !fs->mq_map) {
 		ret = -ENOMEM;
 		goto out;
 	}
@@ -723,20 +778,24 @@ static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 		names[i] = fs->vqs[i].name;
 	}
 
-	ret = virtio_find_vqs(vdev, fs->nvqs, vqs, callbacks, names, NULL);
+	ret = virtio_find_vqs(vdev, fs->nvqs, vqs, callbacks, names, &desc);
 	if (ret < 0)
 		goto out;
 
 	for (i = 0; i < fs->nvqs; i++)
 		fs->vqs[i].vq = vqs[i];
 
+	virtio_fs_map_queues(vdev, fs);
 	virtio_fs_start_all_queues(fs);
 out:
 	kfree(names);
 	kfree(callbacks);
 	kfree(vqs);
-	if (ret)
+	if (ret) {
 		kfree(fs->vqs);
+		kfree(fs->mq_map);
+		fs->mq_map = NULL;
+	}
 	return ret;
 }
 
@@ -857,6 +916,46 @@ static int virtio_fs_setup_dax(struct virtio_device *vdev, struct virtio_fs *fs)
 					fs->dax_dev);
 }
 
+static int virtio_fs_queues_show(struct seq_file *m, void *v)
+{
+	struct virtio_fs *fs = m->private;
+	unsigned int i, cpu;
+
+	for (i = 0; i < fs->nvqs; i++) {
+		struct virtio_fs_vq *fsvq = &fs->vqs[i];
+		long in_flight;
+		u64 nr_reqs;
+
+		spin_lock(&fsvq->lock);
+		in_flight = fsvq->in_flight;
+		nr_reqs = fsvq->nr_reqs;
+		spin_unlock(&fsvq->lock);
+
+		seq_printf(m, "%s: in_flight %ld requests %llu", fsvq->name,
+			   in_flight, nr_reqs);
+		if (i >= VQ_REQUEST) {
+			seq_puts(m, " cpus");
+			for_each_possible_cpu(cpu)
+				if (fs->mq_map[cpu] == i)
+					seq_printf(m, " %u", cpu);
+		}
+		seq_putc(m, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(virtio_fs_queues);
+
+/* Per queue request statistics, in <debugfs>/virtiofs/<device>/queues */
+static void virtio_fs_debugfs_add(struct virtio_device *vdev,
+				  struct virtio_fs *fs)
+{
+	fs->debugfs_dir = debugfs_create_dir(dev_name(&vdev->dev),
+					     virtio_fs_debugfs_root);
+	debugfs_create_file("queues", 0400, fs->debugfs_dir, fs,
+			    &virtio_fs_queues_fops);
+}
+
 static int virtio_fs_probe(struct virtio_device *vdev)
 {
 	struct virtio_fs *fs;
@@ -876,8 +975,6 @@ static int virtio_fs_probe(struct virtio_device *vdev)
 	if (ret < 0)
 		goto out;
 
-	/* TODO vq affinity */
-
 	ret = virtio_fs_setup_dax(vdev, fs);
 	if (ret < 0)
 		goto out_vqs;
@@ -891,12 +988,15 @@ static int virtio_fs_probe(struct virtio_device *vdev)
 	if (ret < 0)
 		goto out_vqs;
 
+	virtio_fs_debugfs_add(vdev, fs);
+
 	return 0;
 
 out_vqs:
 	virtio_reset_device(vdev);
 	virtio_fs_cleanup_vqs(vdev);
 	kfree(fs->vqs);
+	kfree(fs->mq_map);
 
 out:
 	vdev->priv = NULL;
@@ -924,6 +1024,7 @@ static void virtio_fs_remove(struct virtio_device *vdev)
 	mutex_lock(&virtio_fs_mutex);
 	/* This device is going away. No one should get new reference */
 	list_del_init(&fs->list);
+	debugfs_remove_recursive(fs->debugfs_dir);
 	virtio_fs_stop_all_queues(fs);
 	virtio_fs_drain_all_queues_locked(fs);
 	virtio_reset_device(vdev);
@@ -1201,6 +1302,7 @@ static int virtio_fs_enqueue_req(struct virtio_fs_vq *fsvq,
 
 	if (!in_flight)
 		inc_in_flight_req(fsvq);
+	fsvq->nr_reqs++;
 	notify = virtqueue_kick_prepare(vq);
 
 	spin_unlock(&fsvq->lock);
@@ -1224,7 +1326,7 @@ static int virtio_fs_enqueue_req(struct virtio_fs_vq *fsvq,
 static void virtio_fs_wake_pending_and_unlock(struct fuse_iqueue *fiq)
 __releases(fiq->lock)
 {
-	unsigned int queue_id = VQ_REQUEST; /* TODO multiqueue */
+	unsigned int queue_id;
 	struct virtio_fs *fs;
 	struct fuse_req *req;
 	struct virtio_fs_vq *fsvq;
@@ -1244,6 +1346,8 @@ __releases(fiq->lock)
 		 req->in.h.nodeid, req->in.h.len,
 		 fuse_len_args(req->args->out_numargs, req->args->out_args));
 
+	/* Use the request queue of the submitting CPU */
+	queue_id = fs->mq_map[raw_smp_processor_id()];
 	fsvq = &fs->vqs[queue_id];
 	ret = virtio_fs_enqueue_req(fsvq, req, false);
 	if (ret < 0) {
@@ -1514,17 +1618,23 @@ static int __init virtio_fs_init(void)
 {
 	int ret;
 
+	virtio_fs_debugfs_root = debugfs_create_dir("virtiofs", NULL);
+
 	ret = register_virtio_driver(&virtio_fs_driver);
 	if (ret < 0)
-		return ret;
+		goto out_debugfs;
 
 	ret = register_filesystem(&virtio_fs_type);
 	if (ret < 0) {
 		unregister_virtio_driver(&virtio_fs_driver);
-		return ret;
+		goto out_debugfs;
 	}
 
 	return 0;
+
+out_debugfs:
+	debugfs_remove_recursive(virtio_fs_debugfs_root);
+	return ret;
 }
 module_init(virtio_fs_init);
 
@@ -1532,6 +1642,7 @@ static void __exit virtio_fs_exit(void)
 {
 	unregister_filesystem(&virtio_fs_type);
 	unregister_virtio_driver(&virtio_fs_driver);
+	debugfs_remove_recursive(virtio_fs_debugfs_root);
 }
 module_exit(virtio_fs_exit);
 
@@ -516,6 +516,17 @@ static inline struct gfs2_holder *find_first_waiter(const struct gfs2_glock *gl)
 	return NULL;
 }
 
+static void gfs2_holdhist_inc(const struct gfs2_glock *gl)
+{
+	const struct gfs2_sbd *sdp = gl->gl_name.ln_sbd;
+	unsigned int ms = jiffies_to_msecs(jiffies - gl->gl_tchange);
+	unsigned int bucket = min_t(unsigned int, fls(ms), GFS2_NR_HOLDHIST - 1);
+
+	preempt_disable();
+	this_cpu_ptr(sdp->sd_lkstats)->holdhist[gl->gl_name.ln_type][bucket]++;
+	preempt_enable();
+}
+
 /**
  * state_change - record that the glock is now in a different state
  * @gl: the glock
@@ -529,6 +540,9 @@ static void state_change(struct gfs2_glock *gl, unsigned int new_state)
 	held1 = (gl->gl_state != LM_ST_UNLOCKED);
 	held2 = (new_state != LM_ST_UNLOCKED);
 
+	if (held1 && new_state != gl->gl_state)
+		gfs2_holdhist_inc(gl);
+
 	if (held1 != held2) {
 		GLOCK_BUG_ON(gl, __lockref_is_dead(&gl->gl_lockref));
 		if (held2)
@@ -2850,6 +2864,37 @@ static const struct file_operations gfs2_glockfd_fops = {
 
 DEFINE_SEQ_ATTRIBUTE(gfs2_sbstats);
 
+/*
+ * One line per glock type, with the number of times a glock was left in
+ * a locked state after less than 1, 2, 4, ... ms.
+ */
+static int gfs2_holdtime_show(struct seq_file *seq, void *v)
+{
+	struct gfs2_sbd *sdp = seq->private;
+	int type, i, cpu;
+
+	seq_printf(seq, "%-10s", gfs2_gltype[0]);
+	for (i = 0; i < GFS2_NR_HOLDHIST - 1; i++)
+		seq_printf(seq, " %10lu", 1UL << i);
+	seq_printf(seq, " %10s\n", "inf");
+
+	for (type = 0; type < ARRAY_SIZE(gfs2_gltype) - 1; type++) {
+		seq_printf(seq, "%-10s", gfs2_gltype[type + 1]);
+		for (i = 0; i < GFS2_NR_HOLDHIST; i++) {
+			u64 count = 0;
+
+			for_each_possible_cpu(cpu)
+				count += per_cpu_ptr(sdp->sd_lkstats, cpu)->
+					 holdhist[type][i];
+			seq_printf(seq, " %10llu", (unsigned long long)count);
+		}
+		seq_putc(seq, '\n');
+	}
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(gfs2_holdtime);
+
 void gfs2_create_debugfs_file(struct gfs2_sbd *sdp)
 {
 	sdp->debugfs_dir = debugfs_create_dir(sdp->sd_table_name, gfs2_root);
@@ -2865,6 +2910,9 @@ void gfs2_create_debugfs_file(struct gfs2_sbd *sdp)
 
 	debugfs_create_file("sbstats", S_IFREG | S_IRUGO, sdp->debugfs_dir, sdp,
 			    &gfs2_sbstats_fops);
+
+	debugfs_create_file("holdtime", S_IFREG | S_IRUGO, sdp->debugfs_dir, sdp,
+			    &gfs2_holdtime_fops);
 }
 
 void gfs2_delete_debugfs_file(struct gfs2_sbd *sdp)
@@ -668,9 +668,14 @@ struct lm_lockstruct {
 	uint32_t *ls_recover_result; /* result of last jid recovery */
 };
 
+/* Buckets of the glock hold time histogram, by powers of two of ms */
+#define GFS2_NR_HOLDHIST 16
+
 struct gfs2_pcpu_lkstats {
 	/* One struct for each glock type */
 	struct gfs2_lkstats lkstats[10];
+	/* How long glocks of each type stayed in a locked state */
+	u64 holdhist[10][GFS2_NR_HOLDHIST];
 };
 
 /* List of local (per node) statfs inodes */
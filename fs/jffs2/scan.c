@@ -111,12 +111,12 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 		jffs2_dbg(1, "MTD point failed %d\n", ret);
 #endif
 	if (!flashbuf) {
-		/* For NAND it's quicker to read a whole eraseblock at a time,
-		   apparently */
-		if (jffs2_cleanmarker_oob(c))
-			try_size = c->sector_size;
-		else
-			try_size = PAGE_SIZE;
+		/* It's quicker to read a whole eraseblock at a time, on NOR
+		   too: only the used part of a block is read past the initial
+		   EMPTY_SCAN_SIZE, and the scan of that part used to be split
+		   into PAGE_SIZE reads. mtd_kmalloc_up_to() falls back to a
+		   smaller buffer if needed. */
+		try_size = c->sector_size;
 
 		jffs2_dbg(1, "Trying to allocate readbuf of %zu "
 			  "bytes\n", try_size);
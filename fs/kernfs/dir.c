@@ -525,6 +525,23 @@ void kernfs_get(struct kernfs_node *kn)
 }
 EXPORT_SYMBOL_GPL(kernfs_get);
 
+/*
+ * The node is freed after a grace period, so that it can be looked at from
+ * RCU-walk mode through the inode of a dentry.
+ */
+static void kernfs_free_rcu(struct rcu_head *rcu)
+{
+	struct kernfs_node *kn = container_of(rcu, struct kernfs_node, rcu);
+
+	kfree_const(kn->name);
+
+	if (kn->iattr) {
+		simple_xattrs_free(&kn->iattr->xattrs);
+		kmem_cache_free(kernfs_iattrs_cache, kn->iattr);
+	}
+	kmem_cache_free(kernfs_node_cache, kn);
+}
+
 /**
  * kernfs_put - put a reference count on a kernfs_node
  * @kn: the target kernfs_node
@@ -553,16 +570,10 @@ void kernfs_put(struct kernfs_node *kn)
 	if (kernfs_type(kn) == KERNFS_LINK)
 		kernfs_put(kn->symlink.target_kn);
 
-	kfree_const(kn->name);
-
-	if (kn->iattr) {
-		simple_xattrs_free(&kn->iattr->xattrs);
-		kmem_cache_free(kernfs_iattrs_cache, kn->iattr);
-	}
 	spin_lock(&kernfs_idr_lock);
 	idr_remove(&root->ino_idr, (u32)kernfs_ino(kn));
 	spin_unlock(&kernfs_idr_lock);
-	kmem_cache_free(kernfs_node_cache, kn);
+	call_rcu(&kn->rcu, kernfs_free_rcu);
 
 	kn = parent;
 	if (kn) {
@@ -1089,13 +1100,29 @@ static int kernfs_dop_revalidate(struct dentry *dentry, unsigned int flags)
 	struct kernfs_node *kn;
 	struct kernfs_root *root;
 
-	if (flags & LOOKUP_RCU)
-		return -ECHILD;
-
 	/* Negative hashed dentry? */
 	if (d_really_is_negative(dentry)) {
 		struct kernfs_node *parent;
 
+		/*
+		 * Lookups of names that don't exist are common on large
+		 * directories, e.g. probing for cgroup or device attributes.
+		 * Validate those without the lock when nothing changed in the
+		 * directory, and fall back to ref-walk otherwise. The node
+		 * of the parent is freed after a grace period.
+		 */
+		if (flags & LOOKUP_RCU) {
+			struct inode *dir;
+
+			dir = d_inode_rcu(READ_ONCE(dentry->d_parent));
+			if (!dir)
+				return -ECHILD;
+			parent = dir->i_private;
+			if (kernfs_dir_changed(parent, dentry))
+				return -ECHILD;
+			return 1;
+		}
+
 		/* If the kernfs parent node has changed discard and
 		 * proceed to ->lookup.
 		 *
@@ -1129,6 +1156,9 @@ static int kernfs_dop_revalidate(struct dentry *dentry, unsigned int flags)
 		return 1;
 	}
 
+	if (flags & LOOKUP_RCU)
+		return -ECHILD;
+
 	kn = kernfs_dentry_node(dentry);
 	root = kernfs_root(kn);
 	down_read(&root->kernfs_rwsem);
@@ -116,7 +116,7 @@ static inline void kernfs_inc_rev(struct kernfs_node *parent)
 static inline bool kernfs_dir_changed(struct kernfs_node *parent,
 				      struct dentry *dentry)
 {
-	if (parent->dir.rev != dentry->d_time)
+	if (READ_ONCE(parent->dir.rev) != dentry->d_time)
 		return true;
 	return false;
 }
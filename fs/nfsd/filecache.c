@@ -49,6 +49,9 @@
 
 #define NFSD_LAUNDRETTE_DELAY		     (2 * HZ)
 
+/* Number of LRU entries the laundrette examines per lock hold */
+#define NFSD_FILE_GC_BATCH		     (1024UL)
+
 #define NFSD_FILE_CACHE_UP		     (0)
 
 /* We only care about NFSD_MAY_READ/WRITE for this cache */
@@ -60,6 +63,11 @@ static DEFINE_PER_CPU(unsigned long, nfsd_file_releases);
 static DEFINE_PER_CPU(unsigned long, nfsd_file_total_age);
 static DEFINE_PER_CPU(unsigned long, nfsd_file_evictions);
 
+/* Only updated by the laundrette, which never runs concurrently */
+static unsigned long			nfsd_file_gc_runs;
+static unsigned long			nfsd_file_gc_total_us;
+static unsigned long			nfsd_file_gc_max_us;
+
 struct nfsd_fcache_disposal {
 	struct work_struct work;
 	spinlock_t lock;
@@ -482,22 +490,47 @@ nfsd_file_lru_cb(struct list_head *item, struct list_lru_one *lru,
 	return LRU_REMOVED;
 }
 
+/*
+ * Walk each per-node LRU list in batches, so that nfsd threads adding
+ * files to the LRU never wait for more than one batch, and hand the
+ * evicted files over to the disposal workers as we go.
+ */
 static void
 nfsd_file_gc(void)
 {
+	unsigned long ret = 0;
 	LIST_HEAD(dispose);
-	unsigned long ret;
+	int nid;
+
+	for_each_node_state(nid, N_NORMAL_MEMORY) {
+		unsigned long remaining = list_lru_count_node(&nfsd_file_lru, nid);
 
-	ret = list_lru_walk(&nfsd_file_lru, nfsd_file_lru_cb,
-			    &dispose, list_lru_count(&nfsd_file_lru));
+		while (remaining) {
+			unsigned long nr = min(remaining, NFSD_FILE_GC_BATCH);
+
+			remaining -= nr;
+			ret += list_lru_walk_node(&nfsd_file_lru, nid,
+						  nfsd_file_lru_cb, &dispose, &nr);
+			nfsd_file_dispose_list_delayed(&dispose);
+			cond_resched();
+		}
+	}
 	trace_nfsd_file_gc_removed(ret, list_lru_count(&nfsd_file_lru));
-	nfsd_file_dispose_list_delayed(&dispose);
 }
 
 static void
 nfsd_file_gc_worker(struct work_struct *work)
 {
+	ktime_t start = ktime_get();
+	unsigned long us;
+
 	nfsd_file_gc();
+
+	us = ktime_us_delta(ktime_get(), start);
+	WRITE_ONCE(nfsd_file_gc_runs, nfsd_file_gc_runs + 1);
+	WRITE_ONCE(nfsd_file_gc_total_us, nfsd_file_gc_total_us + us);
+	if (us > nfsd_file_gc_max_us)
+		WRITE_ONCE(nfsd_file_gc_max_us, us);
 	if (list_lru_count(&nfsd_file_lru))
 		nfsd_file_schedule_laundrette();
 }
@@ -505,7 +538,7 @@ nfsd_file_gc_worker(struct work_struct *work)
 static unsigned long
 nfsd_file_lru_count(struct shrinker *s, struct shrink_control *sc)
 {
-	return list_lru_count(&nfsd_file_lru);
+	return list_lru_shrink_count(&nfsd_file_lru, sc);
 }
 
 static unsigned long
@@ -525,6 +558,7 @@ static struct shrinker	nfsd_file_shrinker = {
 	.scan_objects = nfsd_file_lru_scan,
 	.count_objects = nfsd_file_lru_count,
 	.seeks = 1,
+	.flags = SHRINKER_NUMA_AWARE,
 };
 
 /**
@@ -918,6 +952,9 @@ nfsd_file_cache_shutdown(void)
 		per_cpu(nfsd_file_total_age, i) = 0;
 		per_cpu(nfsd_file_evictions, i) = 0;
 	}
+	nfsd_file_gc_runs = 0;
+	nfsd_file_gc_total_us = 0;
+	nfsd_file_gc_max_us = 0;
 }
 
 static struct nfsd_file *
@@ -1197,6 +1234,7 @@ int nfsd_file_cache_stats_show(struct seq_file *m, void *v)
 	unsigned long hits = 0, acquisitions = 0;
 	unsigned int i, count = 0, buckets = 0;
 	unsigned long lru = 0, total_age = 0;
+	unsigned long gc_runs, gc_total_us;
 
 	/* Serialize with server shutdown */
 	mutex_lock(&nfsd_mutex);
@@ -1234,5 +1272,19 @@ int nfsd_file_cache_stats_show(struct seq_file *m, void *v)
 		seq_printf(m, "mean age (ms): %ld\n", total_age / releases);
 	else
 		seq_printf(m, "mean age (ms): -\n");
+	if (acquisitions)
+		seq_printf(m, "hit rate (%%):  %lu\n",
+			   hits * 100 / acquisitions);
+	else
+		seq_printf(m, "hit rate (%%):  -\n");
+
+	gc_runs = READ_ONCE(nfsd_file_gc_runs);
+	gc_total_us = READ_ONCE(nfsd_file_gc_total_us);
+	seq_printf(m, "gc runs:       %lu\n", gc_runs);
+	if (gc_runs)
+		seq_printf(m, "gc mean (us):  %lu\n", gc_total_us / gc_runs);
+	else
+		seq_printf(m, "gc mean (us):  -\n");
+	seq_printf(m, "gc max (us):   %lu\n", READ_ONCE(nfsd_file_gc_max_us));
 	return 0;
 }
@@ -179,6 +179,9 @@ struct nfsd_net {
 
 	struct shrinker		nfsd_reply_cache_shrinker;
 
+	/* reclaims expired entries outside of the lookup path */
+	struct delayed_work	drc_prune_work;
+
 	/* tracking server-to-server copy mounts */
 	spinlock_t              nfsd_ssc_lock;
 	struct list_head        nfsd_ssc_mount_list;
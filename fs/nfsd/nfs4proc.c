@@ -2886,11 +2886,10 @@ static u32 nfsd4_read_plus_rsize(const struct svc_rqst *rqstp,
 {
 	u32 rlen = min(op->u.read.rd_length, nfsd4_max_payload(rqstp));
 	/*
-	 * If we detect that the file changed during hole encoding, then we
-	 * recover by encoding the remaining reply as data. This means we need
-	 * to set aside enough room to encode two data segments.
+	 * The reply carries at most a hole segment followed by a data
+	 * segment.
 	 */
-	u32 seg_len = 2 * (1 + 2 + 1);
+	u32 seg_len = (1 + 2 + 2) + (1 + 2 + 1);
 
 	return (op_encode_hdr_size + 2 + seg_len + XDR_QUADLEN(rlen)) * sizeof(__be32);
 }
@@ -4926,6 +4926,56 @@ nfsd4_encode_read_plus_data(struct nfsd4_compoundres *resp,
 	return nfs_ok;
 }
 
+/*
+ * Describe a hole at the start of the requested range with a single
+ * HOLE segment instead of sending its zeroes, then trim the range so
+ * that the data segment stops at the next hole. If the file layout
+ * can't be queried, the whole range is sent as data.
+ */
+static __be32
+nfsd4_encode_read_plus_hole(struct xdr_stream *xdr, struct nfsd4_read *read,
+			    u32 *segments)
+{
+	struct file *file = read->rd_nf->nf_file;
+	loff_t isize = i_size_read(file_inode(file));
+	loff_t end = read->rd_offset + read->rd_length;
+	loff_t data, hole;
+	__be32 *p;
+
+	data = vfs_llseek(file, read->rd_offset, SEEK_DATA);
+	if (data == -ENXIO)
+		data = isize;
+	else if (data < 0)
+		return nfs_ok;
+
+	if (data > read->rd_offset) {
+		u64 count = min(data, end) - read->rd_offset;
+
+		/* Content type, offset, byte count */
+		p = xdr_reserve_space(xdr, 4 + 8 + 8);
+		if (!p)
+			return nfserr_io;
+		*p++ = cpu_to_be32(NFS4_CONTENT_HOLE);
+		p = xdr_encode_hyper(p, read->rd_offset);
+		xdr_encode_hyper(p, count);
+		(*segments)++;
+
+		read->rd_offset += count;
+		read->rd_length -= count;
+		if (read->rd_offset >= isize) {
+			read->rd_eof = true;
+			return nfs_ok;
+		}
+		if (!read->rd_length)
+			return nfs_ok;
+	}
+
+	hole = vfs_llseek(file, read->rd_offset, SEEK_HOLE);
+	if (hole > read->rd_offset && hole < end && hole < isize)
+		read->rd_length = hole - read->rd_offset;
+	return nfs_ok;
+}
+
 static __be32
 nfsd4_encode_read_plus(struct nfsd4_compoundres *resp, __be32 nfserr,
 		       union nfsd4_op_u *u)
@@ -4950,6 +5000,14 @@ nfsd4_encode_read_plus(struct nfsd4_compoundres *resp, __be32 nfserr,
 	if (read->rd_eof)
 		goto out;
 
+	nfserr = nfsd4_encode_read_plus_hole(xdr, read, &segments);
+	if (nfserr) {
+		xdr_truncate_encode(xdr, starting_len);
+		return nfserr;
+	}
+	if (read->rd_eof || !read->rd_length)
+		goto out;
+
 	nfserr = nfsd4_encode_read_plus_data(resp, read);
 	if (nfserr) {
 		xdr_truncate_encode(xdr, starting_len);
@@ -10,6 +10,7 @@
  */
 
 #include <linux/sunrpc/svc_xprt.h>
+#include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/sunrpc/addr.h>
@@ -29,6 +30,16 @@
  */
 #define TARGET_BUCKET_SIZE	64
 
+/*
+ * Stream transports don't mangle retransmitted calls the way lossy UDP
+ * paths can, so the xid, procedure and source address are enough to
+ * recognize a retransmission there. Admins may then skip the checksum.
+ */
+static bool nfsd_drc_stream_csum = true;
+module_param_named(drc_stream_checksum, nfsd_drc_stream_csum, bool, 0644);
+MODULE_PARM_DESC(drc_stream_checksum,
+		 "Checksum calls received over stream transports in the duplicate reply cache");
+
 struct nfsd_drc_bucket {
 	struct rb_root rb_head;
 	struct list_head lru_head;
@@ -42,6 +53,7 @@ static unsigned long nfsd_reply_cache_count(struct shrinker *shrink,
 					    struct shrink_control *sc);
 static unsigned long nfsd_reply_cache_scan(struct shrinker *shrink,
 					   struct shrink_control *sc);
+static void nfsd_reply_cache_prune_worker(struct work_struct *work);
 
 /*
  * Put a cap on the size of the DRC based on the amount of available
@@ -198,6 +210,7 @@ int nfsd_reply_cache_init(struct nfsd_net *nn)
 		spin_lock_init(&nn->drc_hashtbl[i].cache_lock);
 	}
 	nn->drc_hashsize = hashsize;
+	INIT_DELAYED_WORK(&nn->drc_prune_work, nfsd_reply_cache_prune_worker);
 
 	return 0;
 out_shrinker:
@@ -212,6 +225,7 @@ void nfsd_reply_cache_shutdown(struct nfsd_net *nn)
 	unsigned int i;
 
 	unregister_shrinker(&nn->nfsd_reply_cache_shrinker);
+	cancel_delayed_work_sync(&nn->drc_prune_work);
 
 	for (i = 0; i < nn->drc_hashsize; i++) {
 		struct list_head *head = &nn->drc_hashtbl[i].lru_head;
@@ -270,11 +284,6 @@ static long prune_bucket(struct nfsd_drc_bucket *b, struct nfsd_net *nn,
 	return freed;
 }
 
-static long nfsd_prune_bucket(struct nfsd_drc_bucket *b, struct nfsd_net *nn)
-{
-	return prune_bucket(b, nn, 3);
-}
-
 /*
  * Walk the LRU list and prune off entries that are older than RC_EXPIRE.
  * Also prune the oldest ones when the total exceeds the max number of entries.
@@ -314,6 +323,31 @@ nfsd_reply_cache_scan(struct shrinker *shrink, struct shrink_control *sc)
 
 	return prune_cache_entries(nn);
 }
+
+/*
+ * Expired entries are reclaimed from a work item rather than from the
+ * lookup path. It rearms itself for as long as the cache isn't empty.
+ */
+static void nfsd_reply_cache_prune_worker(struct work_struct *work)
+{
+	struct nfsd_net *nn = container_of(to_delayed_work(work),
+				struct nfsd_net, drc_prune_work);
+
+	prune_cache_entries(nn);
+	if (atomic_read(&nn->num_drc_entries))
+		queue_delayed_work(system_unbound_wq, &nn->drc_prune_work,
+				   RC_EXPIRE);
+}
+
+static void nfsd_reply_cache_kick_prune(struct nfsd_net *nn)
+{
+	/* Over the limit, don't wait for the entries to expire */
+	if (atomic_read(&nn->num_drc_entries) > nn->max_drc_entries)
+		mod_delayed_work(system_unbound_wq, &nn->drc_prune_work, 0);
+	else if (!delayed_work_pending(&nn->drc_prune_work))
+		queue_delayed_work(system_unbound_wq, &nn->drc_prune_work,
+				   RC_EXPIRE);
+}
 /*
  * Walk an xdr_buf and get a CRC for at most the first RC_CSUMLEN bytes
  */
@@ -438,7 +472,10 @@ int nfsd_cache_lookup(struct svc_rqst *rqstp)
 		goto out;
 	}
 
-	csum = nfsd_cache_csum(rqstp);
+	if (rqstp->rq_prot == IPPROTO_UDP || READ_ONCE(nfsd_drc_stream_csum))
+		csum = nfsd_cache_csum(rqstp);
+	else
+		csum = 0;
 
 	/*
 	 * Since the common case is a cache miss followed by an insert,
@@ -461,11 +498,9 @@ int nfsd_cache_lookup(struct svc_rqst *rqstp)
 
 	atomic_inc(&nn->num_drc_entries);
 	nfsd_stats_drc_mem_usage_add(nn, sizeof(*rp));
-
-	nfsd_prune_bucket(b, nn);
-
-out_unlock:
 	spin_unlock(&b->cache_lock);
+
+	nfsd_reply_cache_kick_prune(nn);
 out:
 	return rtn;
 
@@ -505,7 +540,9 @@ int nfsd_cache_lookup(struct svc_rqst *rqstp)
 
 out_trace:
 	trace_nfsd_drc_found(nn, rqstp, rtn);
-	goto out_unlock;
+out_unlock:
+	spin_unlock(&b->cache_lock);
+	return rtn;
 }
 
 /**
@@ -628,5 +665,7 @@ int nfsd_reply_cache_stats_show(struct seq_file *m, void *v)
 		   percpu_counter_sum_positive(&nn->counter[NFSD_NET_PAYLOAD_MISSES]));
 	seq_printf(m, "longest chain len:     %u\n", nn->longest_chain);
 	seq_printf(m, "cachesize at longest:  %u\n", nn->longest_chain_cachesize);
+	seq_printf(m, "stream checksums:      %s\n",
+		   READ_ONCE(nfsd_drc_stream_csum) ? "on" : "off");
 	return 0;
 }
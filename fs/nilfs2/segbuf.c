@@ -12,6 +12,7 @@
 #include <linux/writeback.h>
 #include <linux/crc32.h>
 #include <linux/backing-dev.h>
+#include <linux/blkdev.h>
 #include <linux/slab.h>
 #include "page.h"
 #include "segbuf.h"
@@ -288,13 +289,20 @@ void nilfs_truncate_logs(struct list_head *logs,
 int nilfs_write_logs(struct list_head *logs, struct the_nilfs *nilfs)
 {
 	struct nilfs_segment_buffer *segbuf;
+	struct blk_plug plug;
 	int ret = 0;
 
+	/*
+	 * The logs are contiguous within a segment, plug so that their BIOs
+	 * reach the device merged and as one batch.
+	 */
+	blk_start_plug(&plug);
 	list_for_each_entry(segbuf, logs, sb_list) {
 		ret = nilfs_segbuf_write(segbuf, nilfs);
 		if (ret)
 			break;
 	}
+	blk_finish_plug(&plug);
 	return ret;
 }
 
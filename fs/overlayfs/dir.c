@@ -268,6 +268,7 @@ static int ovl_instantiate(struct dentry *dentry, struct inode *inode,
 	};
 
 	ovl_dir_modified(dentry->d_parent, false);
+	ovl_dir_cache_update(dentry, newdentry);
 	ovl_dentry_set_upper_alias(dentry);
 	ovl_dentry_init_reval(dentry, newdentry, NULL);
 
@@ -785,6 +786,7 @@ static int ovl_remove_and_whiteout(struct dentry *dentry,
 		goto out_d_drop;
 
 	ovl_dir_modified(dentry->d_parent, true);
+	ovl_dir_cache_update(dentry, NULL);
 out_d_drop:
 	d_drop(dentry);
 out_dput_upper:
@@ -831,6 +833,8 @@ static int ovl_remove_upper(struct dentry *dentry, bool is_dir,
 	else
 		err = ovl_do_unlink(ofs, dir, upper);
 	ovl_dir_modified(dentry->d_parent, ovl_type_origin(dentry));
+	if (!err)
+		ovl_dir_cache_update(dentry, NULL);
 
 	/*
 	 * Keeping this dentry hashed would mean having to release
@@ -1268,8 +1272,10 @@ static int ovl_rename(struct mnt_idmap *idmap, struct inode *olddir,
 
 	ovl_dir_modified(old->d_parent, ovl_type_origin(old) ||
 			 (!overwrite && ovl_type_origin(new)));
+	ovl_dir_cache_update(old, overwrite ? NULL : newdentry);
 	ovl_dir_modified(new->d_parent, ovl_type_origin(old) ||
 			 (d_inode(new) && ovl_type_origin(new)));
+	ovl_dir_cache_update(new, olddentry);
 
 	/* copy ctime: */
 	ovl_copyattr(d_inode(old));
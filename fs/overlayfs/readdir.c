@@ -28,6 +28,11 @@ struct ovl_cache_entry {
 	char name[];
 };
 
+/*
+ * The merged cache of a directory is shared by all its openers and stays
+ * attached to the inode after the last one is gone: the inode holds a
+ * reference of its own. The impure cache is not refcounted.
+ */
 struct ovl_dir_cache {
 	long refcount;
 	u64 version;
@@ -198,17 +203,23 @@ static bool ovl_fill_lowest(struct ovl_readdir_data *rdd,
 			   const char *name, int namelen,
 			   loff_t offset, u64 ino, unsigned int d_type)
 {
+	struct rb_node **newp = &rdd->root->rb_node;
+	struct rb_node *parent = NULL;
 	struct ovl_cache_entry *p;
 
-	p = ovl_cache_entry_find(rdd->root, name, namelen);
-	if (p) {
+	/* Index the lowest entries too, for ovl_dir_cache_update() */
+	if (ovl_cache_entry_find_link(name, namelen, &newp, &parent)) {
+		p = ovl_cache_entry_from_node(parent);
 		list_move_tail(&p->l_node, &rdd->middle);
 	} else {
 		p = ovl_cache_entry_new(rdd, name, namelen, ino, d_type);
-		if (p == NULL)
+		if (p == NULL) {
 			rdd->err = -ENOMEM;
-		else
+		} else {
 			list_add_tail(&p->l_node, &rdd->middle);
+			rb_link_node(&p->node, parent, newp);
+			rb_insert_color(&p->node, rdd->root);
+		}
 	}
 
 	return rdd->err == 0;
@@ -225,29 +236,31 @@ void ovl_cache_free(struct list_head *list)
 	INIT_LIST_HEAD(list);
 }
 
+static void ovl_dir_cache_destroy(struct ovl_dir_cache *cache)
+{
+	ovl_cache_free(&cache->entries);
+	kfree(cache);
+}
+
 void ovl_dir_cache_free(struct inode *inode)
 {
 	struct ovl_dir_cache *cache = ovl_dir_cache(inode);
 
-	if (cache) {
-		ovl_cache_free(&cache->entries);
-		kfree(cache);
-	}
+	if (cache)
+		ovl_dir_cache_destroy(cache);
 }
 
-static void ovl_cache_put(struct ovl_dir_file *od, struct inode *inode)
+static void ovl_cache_release(struct ovl_dir_cache *cache)
 {
-	struct ovl_dir_cache *cache = od->cache;
-
 	WARN_ON(cache->refcount <= 0);
 	cache->refcount--;
-	if (!cache->refcount) {
-		if (ovl_dir_cache(inode) == cache)
-			ovl_set_dir_cache(inode, NULL);
+	if (!cache->refcount)
+		ovl_dir_cache_destroy(cache);
+}
 
-		ovl_cache_free(&cache->entries);
-		kfree(cache);
-	}
+static void ovl_cache_put(struct ovl_dir_file *od, struct inode *inode)
+{
+	ovl_cache_release(od->cache);
 }
 
 static bool ovl_fill_merge(struct dir_context *ctx, const char *name,
@@ -402,13 +415,21 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 		cache->refcount++;
 		return cache;
 	}
-	ovl_set_dir_cache(d_inode(dentry), NULL);
+	if (cache) {
+		/* Drop the reference of the inode on the stale cache */
+		ovl_set_dir_cache(inode, NULL);
+		if (cache->refcount)
+			ovl_cache_release(cache);
+		else
+			ovl_dir_cache_destroy(cache);
+	}
 
 	cache = kzalloc(sizeof(struct ovl_dir_cache), GFP_KERNEL);
 	if (!cache)
 		return ERR_PTR(-ENOMEM);
 
-	cache->refcount = 1;
+	/* One reference for the opener and one for the inode */
+	cache->refcount = 2;
 	INIT_LIST_HEAD(&cache->entries);
 	cache->root = RB_ROOT;
 
@@ -425,6 +446,66 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 	return cache;
 }
 
+/**
+ * ovl_dir_cache_update - apply a change of a merged directory to its cache
+ * @dentry: overlay dentry that was added, removed or renamed
+ * @upper: upper dentry now found under the name of @dentry, NULL if the
+ *         name is gone from the merged directory
+ *
+ * Called with the parent directory locked, right after ovl_dir_modified().
+ * If the cache was up to date before the change, update the entry in place
+ * instead of having the next reader merge all the layers again. Openers
+ * already walking the cache see the change or not, as with any directory
+ * modified during readdir.
+ */
+void ovl_dir_cache_update(struct dentry *dentry, struct dentry *upper)
+{
+	struct inode *dir = d_inode(dentry->d_parent);
+	struct ovl_dir_cache *cache = ovl_dir_cache(dir);
+	const char *name = dentry->d_name.name;
+	int len = dentry->d_name.len;
+	struct ovl_cache_entry *p;
+	u64 version = ovl_inode_version_get(dir);
+
+	if (!cache || !cache->refcount || ovl_dir_is_real(dir) ||
+	    cache->version + 1 != version)
+		return;
+
+	p = ovl_cache_entry_find(&cache->root, name, len);
+	if (!upper || !d_inode(upper) || ovl_is_whiteout(upper)) {
+		if (p)
+			p->is_whiteout = true;
+		cache->version = version;
+		return;
+	}
+
+	if (!p) {
+		struct rb_node **newp = &cache->root.rb_node;
+		struct rb_node *parent = NULL;
+		size_t size = offsetof(struct ovl_cache_entry, name[len + 1]);
+
+		p = kmalloc(size, GFP_KERNEL);
+		if (!p)
+			return;
+
+		memcpy(p->name, name, len);
+		p->name[len] = '\0';
+		p->len = len;
+		ovl_cache_entry_find_link(name, len, &newp, &parent);
+		list_add_tail(&p->l_node, &cache->entries);
+		rb_link_node(&p->node, parent, newp);
+		rb_insert_color(&p->node, &cache->root);
+	}
+	p->type = fs_umode_to_dtype(d_inode(upper)->i_mode);
+	p->real_ino = d_inode(upper)->i_ino;
+	/* Let ovl_iterate() work out d_ino */
+	p->ino = 0;
+	p->next_maybe_whiteout = NULL;
+	p->is_upper = true;
+	p->is_whiteout = false;
+	cache->version = version;
+}
+
 /* Map inode number to lower fs unique range */
 static u64 ovl_remap_lower_ino(u64 ino, int xinobits, int fsid,
 			       const char *name, int namelen, bool warn)
@@ -781,6 +781,17 @@ static void smap_gather_stats(struct vm_area_struct *vma,
 	if (start >= vma->vm_end)
 		return;
 
+	/*
+	 * An anonymous VMA gets its anon_vma on the first write fault or
+	 * swapin, so without one nothing but the zero page, which isn't
+	 * accounted, can be mapped. Skip walking the page tables of such
+	 * VMAs: large reserved but unused ranges are common, e.g. for the
+	 * heap of language runtimes, and walking them under mmap_lock only
+	 * costs time.
+	 */
+	if (vma_is_anonymous(vma) && !vma->anon_vma)
+		return;
+
 	if (vma->vm_file && shmem_mapping(vma->vm_file->f_mapping)) {
 		/*
 		 * For shared or readonly shmem mappings we know that all
@@ -105,11 +105,34 @@ static inline int check_conn_state(struct ksmbd_work *work)
 #define SERVER_HANDLER_CONTINUE		0
 #define SERVER_HANDLER_ABORT		1
 
+struct ksmbd_cmd_stats {
+	u64	count;
+	u64	total_ns;
+	u64	max_ns;
+};
+
+static DEFINE_PER_CPU(struct ksmbd_cmd_stats [NUMBER_OF_SMB2_COMMANDS],
+		      ksmbd_cmd_stats);
+
+static void ksmbd_update_cmd_stats(u16 command, u64 start)
+{
+	struct ksmbd_cmd_stats *stats;
+	u64 delta = ktime_get_ns() - start;
+
+	stats = &get_cpu_var(ksmbd_cmd_stats)[command];
+	stats->count++;
+	stats->total_ns += delta;
+	if (delta > stats->max_ns)
+		stats->max_ns = delta;
+	put_cpu_var(ksmbd_cmd_stats);
+}
+
 static int __process_request(struct ksmbd_work *work, struct ksmbd_conn *conn,
 			     u16 *cmd)
 {
 	struct smb_version_cmds *cmds;
 	u16 command;
+	u64 start;
 	int ret;
 
 	if (check_conn_state(work))
@@ -142,7 +165,11 @@ static int __process_request(struct ksmbd_work *work, struct ksmbd_conn *conn,
 		}
 	}
 
+	start = ktime_get_ns();
 	ret = cmds->proc(work);
+	/* SMB1 is only used to negotiate, don't account it */
+	if (conn->max_cmds == NUMBER_OF_SMB2_COMMANDS)
+		ksmbd_update_cmd_stats(command, start);
 
 	if (ret < 0)
 		ksmbd_debug(CONN, "Failed to process %u [%d]\n", command, ret);
@@ -442,6 +469,58 @@ static ssize_t stats_show(const struct class *class, const struct class_attribut
 			  server_conf.ipc_last_active / HZ);
 }
 
+static const char * const smb2_cmd_strings[NUMBER_OF_SMB2_COMMANDS] = {
+	[SMB2_NEGOTIATE_HE]		= "negotiate",
+	[SMB2_SESSION_SETUP_HE]		= "session_setup",
+	[SMB2_LOGOFF_HE]		= "logoff",
+	[SMB2_TREE_CONNECT_HE]		= "tree_connect",
+	[SMB2_TREE_DISCONNECT_HE]	= "tree_disconnect",
+	[SMB2_CREATE_HE]		= "create",
+	[SMB2_CLOSE_HE]			= "close",
+	[SMB2_FLUSH_HE]			= "flush",
+	[SMB2_READ_HE]			= "read",
+	[SMB2_WRITE_HE]			= "write",
+	[SMB2_LOCK_HE]			= "lock",
+	[SMB2_IOCTL_HE]			= "ioctl",
+	[SMB2_CANCEL_HE]		= "cancel",
+	[SMB2_ECHO_HE]			= "echo",
+	[SMB2_QUERY_DIRECTORY_HE]	= "query_directory",
+	[SMB2_CHANGE_NOTIFY_HE]		= "change_notify",
+	[SMB2_QUERY_INFO_HE]		= "query_info",
+	[SMB2_SET_INFO_HE]		= "set_info",
+	[SMB2_OPLOCK_BREAK_HE]		= "oplock_break",
+};
+
+/*
+ * One line per SMB2 command: name, number of requests, total and maximum
+ * time spent to process them in microseconds.
+ */
+static ssize_t cmd_stats_show(const struct class *class,
+			      const struct class_attribute *attr, char *buf)
+{
+	ssize_t sz = 0;
+	int i, cpu;
+
+	for (i = 0; i < NUMBER_OF_SMB2_COMMANDS; i++) {
+		u64 count = 0, total = 0, max = 0;
+
+		for_each_possible_cpu(cpu) {
+			struct ksmbd_cmd_stats *stats;
+
+			stats = &per_cpu(ksmbd_cmd_stats, cpu)[i];
+			count += READ_ONCE(stats->count);
+			total += READ_ONCE(stats->total_ns);
+			max = max(max, READ_ONCE(stats->max_ns));
+		}
+
+		sz += sysfs_emit_at(buf, sz, "%s %llu %llu %llu\n",
+				    smb2_cmd_strings[i], count,
+				    div_u64(total, NSEC_PER_USEC),
+				    div_u64(max, NSEC_PER_USEC));
+	}
+	return sz;
+}
+
 static ssize_t kill_server_store(const struct class *class,
 				 const struct class_attribute *attr, const char *buf,
 				 size_t len)
@@ -508,11 +587,13 @@ static ssize_t debug_store(const struct class *class, const struct class_attribu
 }
 
 static CLASS_ATTR_RO(stats);
+static CLASS_ATTR_RO(cmd_stats);
 static CLASS_ATTR_WO(kill_server);
 static CLASS_ATTR_RW(debug);
 
 static struct attribute *ksmbd_control_class_attrs[] = {
 	&class_attr_stats.attr,
+	&class_attr_cmd_stats.attr,
 	&class_attr_kill_server.attr,
 	&class_attr_debug.attr,
 	NULL,
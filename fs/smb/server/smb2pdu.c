@@ -6264,7 +6264,12 @@ int smb2_read(struct ksmbd_work *work)
 	ksmbd_debug(SMB, "filename %pD, offset %lld, len %zu\n",
 		    fp->filp, offset, length);
 
-	work->aux_payload_buf = kvzalloc(length, GFP_KERNEL);
+	/*
+	 * Only the nbytes actually read are sent, no need to zero it. Leave
+	 * room for the up to 7 bytes of padding the last response of a
+	 * compound gets, see is_chained_smb2_message(), which are sent too.
+	 */
+	work->aux_payload_buf = kvmalloc(length + 7, GFP_KERNEL);
 	if (!work->aux_payload_buf) {
 		err = -ENOMEM;
 		goto out;
@@ -6287,6 +6292,7 @@ int smb2_read(struct ksmbd_work *work)
 
 	ksmbd_debug(SMB, "nbytes %zu, offset %lld mincount %zu\n",
 		    nbytes, offset, mincount);
+	memset(work->aux_payload_buf + nbytes, 0, 7);
 
 	if (is_rdma_channel == true) {
 		/* write data to the client using rdma channel */
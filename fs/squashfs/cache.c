@@ -81,18 +81,19 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			}
 
 			/*
-			 * At least one unused cache entry.  A simple
-			 * round-robin strategy is used to choose the entry to
-			 * be evicted from the cache.
+			 * At least one unused cache entry.  The least recently
+			 * used one is evicted from the cache.
 			 */
-			i = cache->next_blk;
+			i = -1;
 			for (n = 0; n < cache->entries; n++) {
-				if (cache->entry[i].refcount == 0)
-					break;
-				i = (i + 1) % cache->entries;
+				if (cache->entry[n].refcount)
+					continue;
+				if (i < 0 || time_before(cache->entry[n].last_used,
+						cache->entry[i].last_used))
+					i = n;
 			}
 
-			cache->next_blk = (i + 1) % cache->entries;
+			cache->curr_blk = i;
 			entry = &cache->entry[i];
 
 			/*
@@ -177,6 +178,7 @@ void squashfs_cache_put(struct squashfs_cache_entry *entry)
 	spin_lock(&cache->lock);
 	entry->refcount--;
 	if (entry->refcount == 0) {
+		entry->last_used = ++cache->lru_clock;
 		cache->unused++;
 		/*
 		 * If there's any processes waiting for a block to become
@@ -238,7 +240,7 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	}
 
 	cache->curr_blk = 0;
-	cache->next_blk = 0;
+	cache->lru_clock = 0;
 	cache->unused = entries;
 	cache->entries = entries;
 	cache->block_size = block_size;
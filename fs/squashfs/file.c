@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -533,6 +534,89 @@ static int squashfs_readahead_fragment(struct page **page,
 	return error;
 }
 
+/* Most datablocks of one readahead window decompressed at the same time */
+#define SQUASHFS_READAHEAD_PARALLEL	8
+
+/* A datablock of a readahead window, with the locked pages it fills */
+struct squashfs_readahead_block {
+	struct work_struct work;
+	struct inode *inode;
+	struct page **pages;
+	unsigned int nr_pages;
+	unsigned int expected;
+	u64 block;
+	int bsize;
+	bool tail;
+};
+
+static void squashfs_readahead_read(struct squashfs_readahead_block *ra)
+{
+	struct squashfs_sb_info *msblk = ra->inode->i_sb->s_fs_info;
+	struct squashfs_page_actor *actor;
+	struct page *last_page;
+	int i, res;
+
+	actor = squashfs_page_actor_init_special(msblk, ra->pages, ra->nr_pages,
+						 ra->expected);
+	if (!actor)
+		goto out;
+
+	res = squashfs_read_data(ra->inode->i_sb, ra->block, ra->bsize, NULL,
+				 actor);
+
+	last_page = squashfs_page_actor_free(actor);
+
+	if (res == ra->expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (ra->tail && bytes && last_page)
+			memzero_page(last_page, bytes, PAGE_SIZE - bytes);
+
+		for (i = 0; i < ra->nr_pages; i++) {
+			flush_dcache_page(ra->pages[i]);
+			SetPageUptodate(ra->pages[i]);
+		}
+	}
+
+out:
+	for (i = 0; i < ra->nr_pages; i++) {
+		unlock_page(ra->pages[i]);
+		put_page(ra->pages[i]);
+	}
+}
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	squashfs_readahead_read(container_of(work,
+				struct squashfs_readahead_block, work));
+}
+
+/*
+ * Read and decompress the collected datablocks, all but the first one on
+ * the unbound workqueue so that the decompressor streams of several CPUs
+ * are used, and wait for them.
+ */
+static void squashfs_readahead_run(struct squashfs_readahead_block *ra,
+				   unsigned int nr)
+{
+	unsigned int i;
+
+	if (!nr)
+		return;
+
+	for (i = 1; i < nr; i++) {
+		INIT_WORK(&ra[i].work, squashfs_readahead_work);
+		queue_work(system_unbound_wq, &ra[i].work);
+	}
+
+	squashfs_readahead_read(&ra[0]);
+
+	for (i = 1; i < nr; i++)
+		flush_work(&ra[i].work);
+}
+
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -541,24 +625,32 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
-	unsigned int nr_pages = 0;
+	struct squashfs_readahead_block *ra, *b = NULL;
+	unsigned int nr_pages = 0, nr_ra = 0, nr_par;
 	struct page **pages;
 	int i, file_end = i_size_read(inode) >> msblk->block_log;
 	unsigned int max_pages = 1UL << shift;
 
 	readahead_expand(ractl, start, (len | mask) + 1);
 
-	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
-	if (!pages)
-		return;
+	/* only worth it if the decompressor can run several streams */
+	nr_par = clamp_t(int, min_t(int, msblk->max_thread_num,
+				    num_online_cpus()),
+			 1, SQUASHFS_READAHEAD_PARALLEL);
+
+	ra = kcalloc(nr_par, sizeof(*ra), GFP_KERNEL);
+	pages = kmalloc_array(nr_par << shift, sizeof(void *), GFP_KERNEL);
+	if (!ra || !pages)
+		goto out;
 
 	for (;;) {
 		pgoff_t index;
 		int res, bsize;
 		u64 block = 0;
 		unsigned int expected;
-		struct page *last_page;
+
+		b = &ra[nr_ra];
+		b->pages = pages + (nr_ra << shift);
 
 		expected = start >> msblk->block_log == file_end ?
 			   (i_size_read(inode) & (msblk->block_size - 1)) :
@@ -566,21 +658,21 @@ static void squashfs_readahead(struct readahead_control *ractl)
 
 		max_pages = (expected + PAGE_SIZE - 1) >> PAGE_SHIFT;
 
-		nr_pages = __readahead_batch(ractl, pages, max_pages);
+		nr_pages = __readahead_batch(ractl, b->pages, max_pages);
 		if (!nr_pages)
 			break;
 
 		if (readahead_pos(ractl) >= i_size_read(inode))
 			goto skip_pages;
 
-		index = pages[0]->index >> shift;
+		index = b->pages[0]->index >> shift;
 
-		if ((pages[nr_pages - 1]->index >> shift) != index)
+		if ((b->pages[nr_pages - 1]->index >> shift) != index)
 			goto skip_pages;
 
 		if (index == file_end && squashfs_i(inode)->fragment_block !=
 						SQUASHFS_INVALID_BLK) {
-			res = squashfs_readahead_fragment(pages, nr_pages,
+			res = squashfs_readahead_fragment(b->pages, nr_pages,
 							  expected);
 			if (res)
 				goto skip_pages;
@@ -591,45 +683,31 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		last_page = squashfs_page_actor_free(actor);
-
-		if (res == expected) {
-			int bytes;
+		b->inode = inode;
+		b->nr_pages = nr_pages;
+		b->expected = expected;
+		b->block = block;
+		b->bsize = bsize;
+		b->tail = index == file_end;
 
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (index == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
-
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
-		}
-
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
+		if (++nr_ra == nr_par) {
+			squashfs_readahead_run(ra, nr_ra);
+			nr_ra = 0;
 		}
 	}
 
-	kfree(pages);
-	return;
+	squashfs_readahead_run(ra, nr_ra);
+	goto out;
 
 skip_pages:
 	for (i = 0; i < nr_pages; i++) {
-		unlock_page(pages[i]);
-		put_page(pages[i]);
+		unlock_page(b->pages[i]);
+		put_page(b->pages[i]);
 	}
+	squashfs_readahead_run(ra, nr_ra);
+out:
 	kfree(pages);
+	kfree(ra);
 }
 
 const struct address_space_operations squashfs_aops = {
@@ -16,7 +16,7 @@ struct squashfs_cache {
 	char			*name;
 	int			entries;
 	int			curr_blk;
-	int			next_blk;
+	unsigned long		lru_clock;
 	int			num_waiters;
 	int			unused;
 	int			block_size;
@@ -34,6 +34,7 @@ struct squashfs_cache_entry {
 	int			pending;
 	int			error;
 	int			num_waiters;
+	unsigned long		last_used;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache	*cache;
 	void			**data;
@@ -48,12 +48,14 @@ enum Opt_errors {
 enum squashfs_param {
 	Opt_errors,
 	Opt_threads,
+	Opt_fragment_cache,
 };
 
 struct squashfs_mount_opts {
 	enum Opt_errors errors;
 	const struct squashfs_decompressor_thread_ops *thread_ops;
 	int thread_num;
+	unsigned int fragment_cache;
 };
 
 static const struct constant_table squashfs_param_errors[] = {
@@ -65,6 +67,7 @@ static const struct constant_table squashfs_param_errors[] = {
 static const struct fs_parameter_spec squashfs_fs_parameters[] = {
 	fsparam_enum("errors", Opt_errors, squashfs_param_errors),
 	fsparam_string("threads", Opt_threads),
+	fsparam_u32("fragment_cache", Opt_fragment_cache),
 	{}
 };
 
@@ -142,6 +145,13 @@ static int squashfs_parse_param(struct fs_context *fc, struct fs_parameter *para
 		if (squashfs_parse_param_threads(param->string, opts) != 0)
 			return -EINVAL;
 		break;
+	case Opt_fragment_cache:
+		if (result.uint_32 < 1 ||
+		    result.uint_32 > SQUASHFS_MAX_CACHED_FRAGMENTS)
+			return invalf(fc, "fragment_cache must be 1..%d",
+				      SQUASHFS_MAX_CACHED_FRAGMENTS);
+		opts->fragment_cache = result.uint_32;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -405,7 +415,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		opts->fragment_cache, msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -521,6 +531,11 @@ static int squashfs_show_options(struct seq_file *s, struct dentry *root)
 	else
 		seq_puts(s, ",errors=continue");
 
+	if (msblk->fragment_cache &&
+	    msblk->fragment_cache->entries != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(s, ",fragment_cache=%d",
+			   msblk->fragment_cache->entries);
+
 #ifdef CONFIG_SQUASHFS_CHOICE_DECOMP_BY_MOUNT
 	if (msblk->thread_ops == &squashfs_decompressor_single) {
 		seq_puts(s, ",threads=single");
@@ -555,6 +570,7 @@ static int squashfs_init_fs_context(struct fs_context *fc)
 #error "fail: unknown squashfs decompression thread mode?"
 #endif
 	opts->thread_num = 0;
+	opts->fragment_cache = SQUASHFS_CACHED_FRAGMENTS;
 	fc->fs_private = opts;
 	fc->ops = &squashfs_context_ops;
 	return 0;
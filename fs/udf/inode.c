@@ -403,6 +403,7 @@ int udf_expand_file_adinicb(struct inode *inode)
 struct udf_map_rq {
 	sector_t lblk;
 	udf_pblk_t pblk;
+	unsigned int len;	/* in: max blocks to map, out: blocks mapped */
 	int iflags;		/* UDF_MAP_ flags determining behavior */
 	int oflags;		/* UDF_BLK_ flags reporting results */
 };
@@ -428,6 +429,18 @@ static int udf_map_block(struct inode *inode, struct udf_map_rq *map)
 			map->pblk = udf_get_lb_pblock(inode->i_sb, &eloc,
 							offset);
 			map->oflags |= UDF_BLK_MAPPED;
+			/*
+			 * Map up to the end of the extent at once, unless the
+			 * partition remaps blocks (virtual, sparable or
+			 * metadata partitions).
+			 */
+			if (udf_partition_is_linear(inode->i_sb,
+					eloc.partitionReferenceNum))
+				map->len = min_t(sector_t, map->len,
+					DIV_ROUND_UP(elen, inode->i_sb->s_blocksize)
+					- offset);
+			else
+				map->len = 1;
 		}
 		up_read(&iinfo->i_data_sem);
 		brelse(epos.bh);
@@ -435,6 +448,8 @@ static int udf_map_block(struct inode *inode, struct udf_map_rq *map)
 		return 0;
 	}
 
+	map->len = 1;
+
 	down_write(&iinfo->i_data_sem);
 	/*
 	 * Block beyond EOF and prealloc extents? Just discard preallocation
@@ -454,6 +469,8 @@ static int __udf_get_block(struct inode *inode, sector_t block,
 	int err;
 	struct udf_map_rq map = {
 		.lblk = block,
+		.len = max_t(unsigned int, bh_result->b_size >> inode->i_blkbits,
+			     1),
 		.iflags = flags,
 	};
 
@@ -462,6 +479,7 @@ static int __udf_get_block(struct inode *inode, sector_t block,
 		return err;
 	if (map.oflags & UDF_BLK_MAPPED) {
 		map_bh(bh_result, inode->i_sb, map.pblk);
+		bh_result->b_size = map.len << inode->i_blkbits;
 		if (map.oflags & UDF_BLK_NEW)
 			set_buffer_new(bh_result);
 	}
@@ -1212,6 +1230,7 @@ struct buffer_head *udf_bread(struct inode *inode, udf_pblk_t block,
 	struct buffer_head *bh = NULL;
 	struct udf_map_rq map = {
 		.lblk = block,
+		.len = 1,
 		.iflags = UDF_MAP_NOPREALLOC | (create ? UDF_MAP_CREATE : 0),
 	};
 
@@ -39,6 +39,15 @@ uint32_t udf_get_pblock(struct super_block *sb, uint32_t block,
 		return map->s_partition_root + block + offset;
 }
 
+/* Are the blocks of the partition laid out contiguously on the device? */
+bool udf_partition_is_linear(struct super_block *sb, uint16_t partition)
+{
+	struct udf_sb_info *sbi = UDF_SB(sb);
+
+	return partition < sbi->s_partitions &&
+	       !sbi->s_partmaps[partition].s_partition_func;
+}
+
 uint32_t udf_get_pblock_virt15(struct super_block *sb, uint32_t block,
 			       uint16_t partition, uint32_t offset)
 {
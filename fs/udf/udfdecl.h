@@ -195,6 +195,7 @@ udf_pblk_t udf_get_last_block(struct super_block *);
 /* partition.c */
 extern uint32_t udf_get_pblock(struct super_block *, uint32_t, uint16_t,
 			       uint32_t);
+extern bool udf_partition_is_linear(struct super_block *, uint16_t);
 extern uint32_t udf_get_pblock_virt15(struct super_block *, uint32_t, uint16_t,
 				      uint32_t);
 extern uint32_t udf_get_pblock_virt20(struct super_block *, uint32_t, uint16_t,
@@ -915,7 +915,10 @@
 
 #define INIT_CALLS_LEVEL(level)						\
 		__initcall##level##_start = .;				\
+		KEEP(*(.initcall##level##a.init))			\
+		__initcall##level##a_end = .;				\
 		KEEP(*(.initcall##level##.init))			\
+		__initcall##level##s_start = .;				\
 		KEEP(*(.initcall##level##s.init))			\
 
 #define INIT_CALLS							\
@@ -17,6 +17,7 @@
 #include <linux/refcount.h>
 #include <linux/percpu-refcount.h>
 #include <linux/percpu-rwsem.h>
+#include <linux/sched/signal.h>
 #include <linux/u64_stats_sync.h>
 #include <linux/workqueue.h>
 #include <linux/bpf-cgroup-defs.h>
@@ -98,6 +99,13 @@ enum {
 	 * and then seeding it with CLONE_INTO_CGROUP doesn't require write
 	 * locking cgroup_threadgroup_rwsem and thus doesn't benefit from
 	 * favordynmod.
+	 *
+	 * Once favordynmods has been enabled, forks and exits additionally
+	 * read-lock signal_struct->cgroup_threadgroup_rwsem of their thread
+	 * group, and migrating a whole process only write-locks that one
+	 * instead of the global cgroup_threadgroup_rwsem. Other thread groups
+	 * can keep forking meanwhile. This can't be turned off again, as
+	 * tasks may be in between cgroup_threadgroup_change_begin() and end().
 	 */
 	CGRP_ROOT_FAVOR_DYNMODS = (1 << 4),
 
@@ -476,6 +484,8 @@ struct cgroup {
 	/* per-cpu recursive resource statistics */
 	struct cgroup_rstat_cpu __percpu *rstat_cpu;
 	struct list_head rstat_css_list;
+	/* jiffies at the start of the last flush, under cgroup_rstat_lock */
+	unsigned long rstat_flush_time;
 
 	/* cgroup basic resource statistics */
 	struct cgroup_base_stat last_bstat;
@@ -498,6 +508,11 @@ struct cgroup {
 	/* used to track pressure stalls */
 	struct psi_group *psi;
 
+#ifdef CONFIG_TASK_DELAY_ACCT
+	/* delays of the member tasks, see struct cgroup_delaystats */
+	struct cgroup_delay_cpu __percpu *delays;
+#endif
+
 	/* used to store eBPF programs */
 	struct cgroup_bpf bpf;
 
@@ -738,17 +753,21 @@ struct cgroup_subsys {
 };
 
 extern struct percpu_rw_semaphore cgroup_threadgroup_rwsem;
+extern bool cgroup_enable_per_threadgroup_rwsem;
 
 /**
  * cgroup_threadgroup_change_begin - threadgroup exclusion for cgroups
  * @tsk: target task
  *
  * Allows cgroup operations to synchronize against threadgroup changes
- * using a percpu_rw_semaphore.
+ * using a percpu_rw_semaphore and, with favordynmods, the per threadgroup
+ * rw_semaphore of @tsk.
  */
 static inline void cgroup_threadgroup_change_begin(struct task_struct *tsk)
 {
 	percpu_down_read(&cgroup_threadgroup_rwsem);
+	if (cgroup_enable_per_threadgroup_rwsem)
+		down_read(&tsk->signal->cgroup_threadgroup_rwsem);
 }
 
 /**
@@ -759,6 +778,8 @@ static inline void cgroup_threadgroup_change_begin(struct task_struct *tsk)
  */
 static inline void cgroup_threadgroup_change_end(struct task_struct *tsk)
 {
+	if (cgroup_enable_per_threadgroup_rwsem)
+		up_read(&tsk->signal->cgroup_threadgroup_rwsem);
 	percpu_up_read(&cgroup_threadgroup_rwsem);
 }
 
@@ -101,6 +101,10 @@ struct cpuidle_device {
 	u64			last_residency_ns;
 	u64			poll_limit_ns;
 	u64			forced_idle_latency_limit_ns;
+	u64			adaptive_poll_ns;  /* learned poll window */
+	u64			poll_block_ns;	   /* idle time since poll timed out */
+	unsigned long long	poll_success;	   /* woken up while polling */
+	unsigned long long	poll_fail;	   /* poll window timed out */
 	struct cpuidle_state_usage	states_usage[CPUIDLE_STATE_MAX];
 	struct cpuidle_state_kobj *kobjs[CPUIDLE_STATE_MAX];
 	struct cpuidle_driver_kobj *kobj_driver;
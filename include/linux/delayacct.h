@@ -85,6 +85,7 @@ extern void __delayacct_compact_end(void);
 extern void __delayacct_wpcopy_start(void);
 extern void __delayacct_wpcopy_end(void);
 extern void __delayacct_irq(struct task_struct *task, u32 delta);
+extern void __delayacct_cpu_wait(struct task_struct *task, u64 delta);
 
 static inline void delayacct_tsk_init(struct task_struct *tsk)
 {
@@ -228,6 +229,15 @@ static inline void delayacct_irq(struct task_struct *task, u32 delta)
 		__delayacct_irq(task, delta);
 }
 
+/* Only accounted per cgroup, tasks get theirs from sched_info */
+static inline void delayacct_cpu_wait(struct task_struct *task, u64 delta)
+{
+	if (!static_branch_unlikely(&delayacct_key))
+		return;
+
+	__delayacct_cpu_wait(task, delta);
+}
+
 #else
 static inline void delayacct_init(void)
 {}
@@ -268,7 +278,27 @@ static inline void delayacct_wpcopy_end(void)
 {}
 static inline void delayacct_irq(struct task_struct *task, u32 delta)
 {}
+static inline void delayacct_cpu_wait(struct task_struct *task, u64 delta)
+{}
 
 #endif /* CONFIG_TASK_DELAY_ACCT */
 
+struct cgroup;
+struct cgroup_delaystats;
+
+#if defined(CONFIG_TASK_DELAY_ACCT) && defined(CONFIG_CGROUPS)
+extern int delayacct_cgroup_alloc(struct cgroup *cgrp);
+extern void delayacct_cgroup_free(struct cgroup *cgrp);
+extern bool delayacct_cgroup_read(struct cgroup *cgrp,
+				  struct cgroup_delaystats *stats);
+#else
+static inline int delayacct_cgroup_alloc(struct cgroup *cgrp)
+{ return 0; }
+static inline void delayacct_cgroup_free(struct cgroup *cgrp)
+{}
+static inline bool delayacct_cgroup_read(struct cgroup *cgrp,
+					 struct cgroup_delaystats *stats)
+{ return false; }
+#endif
+
 #endif
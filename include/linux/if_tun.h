@@ -6,6 +6,7 @@
 #ifndef __IF_TUN_H
 #define __IF_TUN_H
 
+#include <linux/uio.h>
 #include <uapi/linux/if_tun.h>
 #include <uapi/linux/virtio_net.h>
 
@@ -19,6 +20,20 @@ struct tun_msg_ctl {
 	void *ptr;
 };
 
+/*
+ * A recvmsg() with a TUN_MSG_PTR tun_msg_ctl copies the packets taken from
+ * the ptr_ring of a tun or tap socket to the buffers of the ctl->num
+ * tun_recv_bufs at ctl->ptr. It stops after the first packet which fails
+ * or doesn't fill its buffer exactly (->ret differs from the size of ->iter)
+ * and returns the number of packets consumed; the ones after that are left
+ * to the caller.
+ */
+struct tun_recv_buf {
+	void *ptr;
+	struct iov_iter iter;
+	int ret;
+};
+
 struct tun_xdp_hdr {
 	int buflen;
 	struct virtio_net_hdr gso;
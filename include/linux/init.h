@@ -169,6 +169,15 @@ extern initcall_entry_t __initcall6_start[];
 extern initcall_entry_t __initcall7_start[];
 extern initcall_entry_t __initcall_end[];
 
+extern initcall_entry_t __initcall0a_end[], __initcall0s_start[];
+extern initcall_entry_t __initcall1a_end[], __initcall1s_start[];
+extern initcall_entry_t __initcall2a_end[], __initcall2s_start[];
+extern initcall_entry_t __initcall3a_end[], __initcall3s_start[];
+extern initcall_entry_t __initcall4a_end[], __initcall4s_start[];
+extern initcall_entry_t __initcall5a_end[], __initcall5s_start[];
+extern initcall_entry_t __initcall6a_end[], __initcall6s_start[];
+extern initcall_entry_t __initcall7a_end[], __initcall7s_start[];
+
 extern struct file_system_type rootfs_fs_type;
 
 #if defined(CONFIG_STRICT_KERNEL_RWX) || defined(CONFIG_STRICT_MODULE_RWX)
@@ -313,6 +322,16 @@ extern bool initcall_debug;
 #define late_initcall(fn)		__define_initcall(fn, 7)
 #define late_initcall_sync(fn)		__define_initcall(fn, 7s)
 
+/*
+ * Async initcalls only depend on the initcalls of the earlier levels. They
+ * run in parallel with each other and with the plain initcalls of their
+ * level, and are done before the _sync initcalls of their level start.
+ */
+#define subsys_initcall_async(fn)	__define_initcall(fn, 4a)
+#define fs_initcall_async(fn)		__define_initcall(fn, 5a)
+#define device_initcall_async(fn)	__define_initcall(fn, 6a)
+#define late_initcall_async(fn)		__define_initcall(fn, 7a)
+
 #define __initcall(fn) device_initcall(fn)
 
 #define __exitcall(fn)						\
@@ -162,6 +162,8 @@ struct io_restriction {
 struct io_submit_link {
 	struct io_kiocb		*head;
 	struct io_kiocb		*last;
+	/* ->last is part of an IOSQE_IO_PARALLEL group */
+	bool			last_in_group;
 };
 
 struct io_submit_state {
@@ -224,6 +226,8 @@ struct io_ring_ctx {
 		struct io_rings			*rings;
 		struct task_struct		*submitter_task;
 		struct percpu_ref		refs;
+		/* per-opcode latency stats, NULL unless enabled */
+		struct io_ring_stats __percpu	*op_stats;
 	} ____cacheline_aligned_in_smp;
 
 	/* submission data */
@@ -372,6 +376,15 @@ struct io_ring_ctx {
 	struct callback_head		poll_wq_task_work;
 	struct list_head		defer_list;
 	unsigned			sq_thread_idle;
+	/* backing memory for ->op_stats, kept while stats are disabled */
+	struct io_ring_stats __percpu	*op_stats_mem;
+	/* SQPOLL fair share state, for rings sharing an SQPOLL thread */
+	unsigned			sq_thread_weight;
+	unsigned long			sq_idle_deadline;
+	/* set by the SQPOLL thread, cleared by IORING_ENTER_SQ_WAKEUP */
+	bool				sq_parked;
+	/* only used by the SQPOLL thread */
+	bool				sq_thread_parked;
 	/* protected by ->completion_lock */
 	unsigned			evfd_last_cq_tail;
 };
@@ -389,6 +402,7 @@ enum {
 	REQ_F_FORCE_ASYNC_BIT	= IOSQE_ASYNC_BIT,
 	REQ_F_BUFFER_SELECT_BIT	= IOSQE_BUFFER_SELECT_BIT,
 	REQ_F_CQE_SKIP_BIT	= IOSQE_CQE_SKIP_SUCCESS_BIT,
+	REQ_F_IO_PARALLEL_BIT	= IOSQE_IO_PARALLEL_BIT,
 
 	/* first byte is taken by user flags, shift it to not overlap */
 	REQ_F_FAIL_BIT		= 8,
@@ -436,6 +450,8 @@ enum {
 	REQ_F_BUFFER_SELECT	= BIT(REQ_F_BUFFER_SELECT_BIT),
 	/* IOSQE_CQE_SKIP_SUCCESS */
 	REQ_F_CQE_SKIP		= BIT(REQ_F_CQE_SKIP_BIT),
+	/* IOSQE_IO_PARALLEL, or member of a started parallel link group */
+	REQ_F_IO_PARALLEL	= BIT(REQ_F_IO_PARALLEL_BIT),
 
 	/* fail rest of links */
 	REQ_F_FAIL		= BIT(REQ_F_FAIL_BIT),
@@ -578,6 +594,8 @@ struct io_kiocb {
 	atomic_t			poll_refs;
 	struct io_task_work		io_task_work;
 	unsigned			nr_tw;
+	/* latency stats timestamp and state, see io_uring/stats.h */
+	u32				stats_time;
 	/* for polled requests, i.e. IORING_OP_POLL_ADD and async armed poll */
 	union {
 		struct hlist_node	hash_node;
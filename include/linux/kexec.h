@@ -30,6 +30,7 @@ extern note_buf_t __percpu *crash_notes;
 
 #ifdef CONFIG_KEXEC_CORE
 #include <linux/list.h>
+#include <linux/xarray.h>
 #include <linux/compat.h>
 #include <linux/ioport.h>
 #include <linux/module.h>
@@ -324,6 +325,10 @@ struct kimage {
 	struct list_head dest_pages;
 	struct list_head unusable_pages;
 
+	/* dest_pages by boot pfn, and the IND_SOURCE entries by destination */
+	struct xarray dest_pages_xa;
+	struct xarray source_entries;
+
 	/* Address of next control page to allocate for crash kernels. */
 	unsigned long control_page;
 
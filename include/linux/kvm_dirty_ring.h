@@ -2,6 +2,7 @@
 #define KVM_DIRTY_RING_H
 
 #include <linux/kvm.h>
+#include <linux/mutex.h>
 
 /**
  * kvm_dirty_ring: KVM internal dirty ring structure
@@ -17,6 +18,7 @@
  *               to allow userspace to harvest all the dirty pages
  * @dirty_gfns:  the array to keep the dirty gfns
  * @index:       index of this dirty ring
+ * @reset_lock:  serializes the resets of this ring
  */
 struct kvm_dirty_ring {
 	u32 dirty_index;
@@ -25,6 +27,7 @@ struct kvm_dirty_ring {
 	u32 soft_limit;
 	struct kvm_dirty_gfn *dirty_gfns;
 	int index;
+	struct mutex reset_lock;
 };
 
 #ifndef CONFIG_HAVE_KVM_DIRTY_RING
@@ -78,8 +81,8 @@ u32 kvm_dirty_ring_get_rsvd_entries(void);
 int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size);
 
 /*
- * called with kvm->slots_lock held, returns the number of
- * processed pages.
+ * called with kvm->slots_lock held or within a kvm->srcu read side
+ * critical section, returns the number of processed pages.
  */
 int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring);
 
@@ -344,6 +344,10 @@ struct kvm_vcpu {
 	sigset_t sigset;
 	unsigned int halt_poll_ns;
 	bool valid_wakeup;
+	/* Wakeup prediction for halt polling, see kvm_vcpu_halt() */
+	u64 halt_avg_ns;
+	u64 halt_timer_period_ns;
+	ktime_t halt_last_timer;
 
 #ifdef CONFIG_HAS_IOMEM
 	int mmio_needed;
@@ -381,6 +385,11 @@ struct kvm_vcpu {
 	struct kvm_vcpu_stat stat;
 	char stats_id[KVM_STATS_NAME_SIZE];
 	struct kvm_dirty_ring dirty_ring;
+#ifdef CONFIG_KVM_MMIO
+	/* Per-vCPU coalesced MMIO ring, see KVM_CAP_COALESCED_MMIO_RING */
+	struct kvm_coalesced_mmio_ring *coalesced_mmio_ring;
+	u32 coalesced_mmio_max;
+#endif
 
 	/*
 	 * The most recently used memslot by this vCPU and the slots generation
@@ -758,6 +767,8 @@ struct kvm {
 		/* resampler_list update side is protected by resampler_lock. */
 		struct list_head  resampler_list;
 		struct mutex      resampler_lock;
+		/* Slow path injections, if kvm.irqfd_inject_kthread is set */
+		struct kthread_worker *inject_worker;
 	} irqfds;
 	struct list_head ioeventfds;
 #endif
@@ -768,6 +779,10 @@ struct kvm {
 	struct kvm_coalesced_mmio_ring *coalesced_mmio_ring;
 	spinlock_t ring_lock;
 	struct list_head coalesced_zones;
+	/* KVM_CAP_COALESCED_MMIO_RING configuration */
+	u32 coalesced_ring_size;
+	u32 coalesced_ring_batch;
+	struct eventfd_ctx *coalesced_ring_eventfd;
 #endif
 
 	struct mutex irq_lock;
@@ -1288,7 +1303,10 @@ void kvm_gpc_init(struct gfn_to_pfn_cache *gpc, struct kvm *kvm,
  *
  * @gpc:	   struct gfn_to_pfn_cache object.
  * @gpa:	   guest physical address to map.
- * @len:	   sanity check; the range being access must fit a single page.
+ * @len:	   length of the range to map.  It must fit a single page if
+ *		   the PFN is used by the guest, else it may span up to
+ *		   KVM_GPC_MAX_PAGES pages of the same memslot, which get
+ *		   mapped contiguously in the kernel.
  *
  * @return:	   0 for success.
  *		   -EINVAL for a mapping which would cross a page boundary.
@@ -1304,7 +1322,8 @@ int kvm_gpc_activate(struct gfn_to_pfn_cache *gpc, gpa_t gpa, unsigned long len)
  * kvm_gpc_check - check validity of a gfn_to_pfn_cache.
  *
  * @gpc:	   struct gfn_to_pfn_cache object.
- * @len:	   sanity check; the range being access must fit a single page.
+ * @len:	   sanity check; the range being access must fit the pages
+ *		   mapped by the cache.
  *
  * @return:	   %true if the cache is still valid and the address matches.
  *		   %false if the cache is not valid.
@@ -1322,7 +1341,7 @@ bool kvm_gpc_check(struct gfn_to_pfn_cache *gpc, unsigned long len);
  * kvm_gpc_refresh - update a previously initialized cache.
  *
  * @gpc:	   struct gfn_to_pfn_cache object.
- * @len:	   sanity check; the range being access must fit a single page.
+ * @len:	   length of the range to map, see kvm_gpc_activate().
  *
  * @return:	   0 for success.
  *		   -EINVAL for a mapping which would cross a page boundary.
@@ -1351,6 +1370,22 @@ void kvm_sigset_deactivate(struct kvm_vcpu *vcpu);
 
 void kvm_vcpu_halt(struct kvm_vcpu *vcpu);
 bool kvm_vcpu_block(struct kvm_vcpu *vcpu);
+
+/*
+ * Generic classes of exits, arch code maps its exit reasons onto them when
+ * reporting how long it took to handle an exit.
+ */
+enum kvm_exit_type {
+	KVM_EXIT_TYPE_IRQ,		/* host interrupt */
+	KVM_EXIT_TYPE_HALT,		/* WFI/HLT and friends */
+	KVM_EXIT_TYPE_MEM_FAULT,	/* stage-2/EPT faults, incl. MMIO */
+	KVM_EXIT_TYPE_HYPERCALL,
+	KVM_EXIT_TYPE_INSN,		/* sysreg/CSR/instruction emulation */
+	KVM_EXIT_TYPE_OTHER,
+};
+
+void kvm_vcpu_account_exit(struct kvm_vcpu *vcpu, enum kvm_exit_type type,
+			   u64 start_ns);
 void kvm_arch_vcpu_blocking(struct kvm_vcpu *vcpu);
 void kvm_arch_vcpu_unblocking(struct kvm_vcpu *vcpu);
 bool kvm_vcpu_wake_up(struct kvm_vcpu *vcpu);
@@ -1844,7 +1879,9 @@ struct _kvm_stats_desc {
 
 #define KVM_GENERIC_VM_STATS()						       \
 	STATS_DESC_COUNTER(VM_GENERIC, remote_tlb_flush),		       \
-	STATS_DESC_COUNTER(VM_GENERIC, remote_tlb_flush_requests)
+	STATS_DESC_COUNTER(VM_GENERIC, remote_tlb_flush_requests),	       \
+	STATS_DESC_COUNTER(VM_GENERIC, irqfd_inject_fast),		       \
+	STATS_DESC_COUNTER(VM_GENERIC, irqfd_inject_slow)
 
 #define KVM_GENERIC_VCPU_STATS()					       \
 	STATS_DESC_COUNTER(VCPU_GENERIC, halt_successful_poll),		       \
@@ -1860,7 +1897,25 @@ struct _kvm_stats_desc {
 			HALT_POLL_HIST_COUNT),				       \
 	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_wait_hist,	       \
 			HALT_POLL_HIST_COUNT),				       \
-	STATS_DESC_IBOOLEAN(VCPU_GENERIC, blocking)
+	STATS_DESC_IBOOLEAN(VCPU_GENERIC, blocking),			       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, halt_wakeup_timer),		       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, halt_wakeup_irq),		       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, halt_wakeup_signal),		       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, halt_poll_skipped),		       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_duration_hist,	       \
+			HALT_POLL_HIST_COUNT),				       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, exit_irq_hist,	       \
+			EXIT_LATENCY_HIST_COUNT),			       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, exit_halt_hist,	       \
+			EXIT_LATENCY_HIST_COUNT),			       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, exit_mem_fault_hist,	       \
+			EXIT_LATENCY_HIST_COUNT),			       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, exit_hypercall_hist,	       \
+			EXIT_LATENCY_HIST_COUNT),			       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, exit_insn_hist,	       \
+			EXIT_LATENCY_HIST_COUNT),			       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, exit_other_hist,	       \
+			EXIT_LATENCY_HIST_COUNT)
 
 extern struct dentry *kvm_debugfs_dir;
 
@@ -9,6 +9,7 @@
 #define __LINUX_KVM_IRQFD_H
 
 #include <linux/kvm_host.h>
+#include <linux/kthread.h>
 #include <linux/poll.h>
 
 /*
@@ -46,6 +47,9 @@ struct kvm_kernel_irqfd {
 	/* Used for level IRQ fast-path */
 	int gsi;
 	struct work_struct inject;
+	/* Used instead of inject if the VM has an inject_worker */
+	struct kthread_work inject_kwork;
+	struct kthread_worker *inject_worker;
 	/* The resampler used by this irqfd (resampler-only) */
 	struct kvm_kernel_irqfd_resampler *resampler;
 	/* Eventfd notified on resample (resampler-only) */
@@ -62,6 +62,12 @@ struct gfn_to_hva_cache {
 	struct kvm_memory_slot *memslot;
 };
 
+/*
+ * Maximum number of pages a gfn_to_pfn_cache used only by the host may span;
+ * they have to be contiguous in the guest, but not in the host.
+ */
+#define KVM_GPC_MAX_PAGES	8
+
 struct gfn_to_pfn_cache {
 	u64 generation;
 	gpa_t gpa;
@@ -74,6 +80,7 @@ struct gfn_to_pfn_cache {
 	struct mutex refresh_lock;
 	void *khva;
 	kvm_pfn_t pfn;
+	unsigned int nr_pages;
 	enum pfn_cache_usage usage;
 	bool active;
 	bool valid;
@@ -101,10 +108,13 @@ struct kvm_mmu_memory_cache {
 #endif
 
 #define HALT_POLL_HIST_COUNT			32
+#define EXIT_LATENCY_HIST_COUNT			32
 
 struct kvm_vm_stat_generic {
 	u64 remote_tlb_flush;
 	u64 remote_tlb_flush_requests;
+	u64 irqfd_inject_fast;
+	u64 irqfd_inject_slow;
 };
 
 struct kvm_vcpu_stat_generic {
@@ -119,6 +129,17 @@ struct kvm_vcpu_stat_generic {
 	u64 halt_poll_fail_hist[HALT_POLL_HIST_COUNT];
 	u64 halt_wait_hist[HALT_POLL_HIST_COUNT];
 	u64 blocking;
+	u64 halt_wakeup_timer;
+	u64 halt_wakeup_irq;
+	u64 halt_wakeup_signal;
+	u64 halt_poll_skipped;
+	u64 halt_duration_hist[HALT_POLL_HIST_COUNT];
+	u64 exit_irq_hist[EXIT_LATENCY_HIST_COUNT];
+	u64 exit_halt_hist[EXIT_LATENCY_HIST_COUNT];
+	u64 exit_mem_fault_hist[EXIT_LATENCY_HIST_COUNT];
+	u64 exit_hypercall_hist[EXIT_LATENCY_HIST_COUNT];
+	u64 exit_insn_hist[EXIT_LATENCY_HIST_COUNT];
+	u64 exit_other_hist[EXIT_LATENCY_HIST_COUNT];
 };
 
 #define KVM_STATS_NAME_SIZE	48
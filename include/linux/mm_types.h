@@ -11,6 +11,7 @@
 #include <linux/rbtree.h>
 #include <linux/maple_tree.h>
 #include <linux/rwsem.h>
+#include <linux/mutex.h>
 #include <linux/completion.h>
 #include <linux/cpumask.h>
 #include <linux/uprobes.h>
@@ -737,6 +738,16 @@ struct mm_struct {
 #endif
 		struct user_namespace *user_ns;
 
+#ifdef CONFIG_MEMBARRIER
+		/*
+		 * Serializes MEMBARRIER_CMD_PRIVATE_EXPEDITED IPI rounds;
+		 * @membarrier_seq is odd while one is in flight and lets
+		 * concurrent callers piggyback on a later completed round.
+		 */
+		struct mutex membarrier_mutex;
+		unsigned long membarrier_seq;
+#endif
+
 		/* store ref to file /proc/<pid>/exe symlink points to */
 		struct file __rcu *exe_file;
 #ifdef CONFIG_MMU_NOTIFIER
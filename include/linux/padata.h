@@ -136,7 +136,13 @@ struct padata_shell {
  *             the client to communicate the minimum amount of work that's
  *             appropriate for one worker thread to do at once.
  * @max_threads: Max threads to use for the job, actual number may be less
- *               depending on task size and minimum chunk size.
+ *               depending on task size and minimum chunk size.  After boot,
+ *               it is also limited by the CPUs the caller may run on.
+ * @numa_aware: Split the job into one contiguous part per node with CPUs,
+ *              sized by the node's share of CPUs, and run the helpers of
+ *              each part on that node.  Helpers which are done with their
+ *              part take over chunks of the others.
+ * @cancelled: Stops handing out chunks once set, see padata_mt_job_cancel().
  */
 struct padata_mt_job {
 	void (*thread_fn)(unsigned long start, unsigned long end, void *arg);
@@ -146,8 +152,22 @@ struct padata_mt_job {
 	unsigned long		align;
 	unsigned long		min_chunk;
 	int			max_threads;
+	bool			numa_aware;
+	bool			cancelled;
 };
 
+/**
+ * padata_mt_job_cancel - stop a multithreaded job early
+ * @job: The job, typically passed to the thread function through @fn_arg.
+ *
+ * Chunks which are already running complete, no further chunks are started
+ * and padata_do_multithreaded() returns -ECANCELED.
+ */
+static inline void padata_mt_job_cancel(struct padata_mt_job *job)
+{
+	WRITE_ONCE(job->cancelled, true);
+}
+
 /**
  * struct padata_instance - The overall control structure.
  *
@@ -189,7 +209,7 @@ extern void padata_free_shell(struct padata_shell *ps);
 extern int padata_do_parallel(struct padata_shell *ps,
 			      struct padata_priv *padata, int *cb_cpu);
 extern void padata_do_serial(struct padata_priv *padata);
-extern void __init padata_do_multithreaded(struct padata_mt_job *job);
+extern int padata_do_multithreaded(struct padata_mt_job *job);
 extern int padata_set_cpumask(struct padata_instance *pinst, int cpumask_type,
 			      cpumask_var_t cpumask);
 #endif
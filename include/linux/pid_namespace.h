@@ -31,10 +31,14 @@ struct fs_pin;
 #define MEMFD_NOEXEC_SCOPE_NOEXEC_ENFORCED	2
 #endif
 
+struct pid_cache;
+
 struct pid_namespace {
 	struct idr idr;
 	struct rcu_head rcu;
 	unsigned int pid_allocated;
+	struct pid_cache __percpu *pid_cache;	/* see pid_cache_alloc() */
+	bool pid_cache_off;			/* ns_last_pid was written */
 	struct task_struct *child_reaper;
 	struct kmem_cache *pid_cachep;
 	unsigned int level;
@@ -104,6 +108,8 @@ static inline int reboot_pid_ns(struct pid_namespace *pid_ns, int cmd)
 extern struct pid_namespace *task_active_pid_ns(struct task_struct *tsk);
 void pidhash_init(void);
 void pid_idr_init(void);
+struct pid_cache __percpu *alloc_pid_cache(void);
+void pid_cache_disable(struct pid_namespace *ns);
 
 static inline bool task_is_in_init_pid_ns(struct task_struct *tsk)
 {
@@ -162,6 +162,22 @@ static inline void cpu_latency_qos_update_request(struct pm_qos_request *req,
 static inline void cpu_latency_qos_remove_request(struct pm_qos_request *req) {}
 #endif
 
+#ifdef CONFIG_CPU_IDLE
+DECLARE_PER_CPU(s32, cpu_task_latency_req);
+
+s32 cpu_task_latency_qos_limit(int cpu);
+int task_latency_qos_set(unsigned long value);
+#else
+static inline s32 cpu_task_latency_qos_limit(int cpu)
+{
+	return PM_QOS_RESUME_LATENCY_NO_CONSTRAINT;
+}
+static inline int task_latency_qos_set(unsigned long value)
+{
+	return -EINVAL;
+}
+#endif
+
 #ifdef CONFIG_PM
 enum pm_qos_flags_status __dev_pm_qos_flags(struct device *dev, s32 mask);
 enum pm_qos_flags_status dev_pm_qos_flags(struct device *dev, s32 mask);
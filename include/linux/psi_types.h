@@ -160,6 +160,10 @@ struct psi_group {
 	struct psi_group *parent;
 	bool enabled;
 
+	/* Hierarchy links, only maintained with psi_leaf_only */
+	struct list_head children;
+	struct list_head sibling;
+
 	/* Protects data used by the aggregator */
 	struct mutex avgs_lock;
 
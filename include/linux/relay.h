@@ -26,7 +26,23 @@
 /*
  * Tracks changes to rchan/rchan_buf structs
  */
-#define RELAYFS_CHANNEL_VERSION		7
+#define RELAYFS_CHANNEL_VERSION		8
+
+/*
+ * Relay buffer statistics
+ */
+enum {
+	RELAY_STATS_BUF_FULL		= (1 << 0),
+	RELAY_STATS_BUF_OVERWRITE	= (1 << 1),
+	RELAY_STATS_WRT_BIG		= (1 << 2),
+};
+
+struct rchan_buf_stats
+{
+	unsigned int full_count;	/* writes dropped, buffer full */
+	unsigned int overwrite_count;	/* unread sub-buffers overwritten */
+	unsigned int big_count;		/* writes dropped, too big */
+};
 
 /*
  * Per-cpu relay channel buffer
@@ -51,6 +67,7 @@ struct rchan_buf
 	size_t bytes_consumed;		/* bytes consumed in cur read subbuf */
 	size_t early_bytes;		/* bytes consumed before VFS inited */
 	unsigned int cpu;		/* this buf's cpu */
+	struct rchan_buf_stats stats;	/* dropped and overwritten data */
 } ____cacheline_aligned;
 
 /*
@@ -169,6 +186,7 @@ extern void relay_subbufs_consumed(struct rchan *chan,
 				   size_t consumed);
 extern void relay_reset(struct rchan *chan);
 extern int relay_buf_full(struct rchan_buf *buf);
+extern size_t relay_stats(struct rchan *chan, int flags);
 
 extern size_t relay_switch_subbuf(struct rchan_buf *buf,
 				  size_t length);
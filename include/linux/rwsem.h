@@ -64,11 +64,29 @@ struct rw_semaphore {
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	struct lockdep_map	dep_map;
 #endif
+#ifdef CONFIG_RWSEM_ADAPTIVE
+	/* Per-CPU reader counts, see rwsem_enable_adaptive() */
+	unsigned int __percpu	*read_count;
+	int			pcpu_state;
+	unsigned long		pcpu_stamp;	/* jiffies of the last writer */
+	struct task_struct __rcu *pcpu_writer;	/* writer draining readers */
+#endif
 };
 
-/* In all implementations count != 0 means locked */
+#ifdef CONFIG_RWSEM_ADAPTIVE
+extern int rwsem_pcpu_is_locked(struct rw_semaphore *sem);
+#endif
+
+/*
+ * In all implementations count != 0 means locked, except for adaptive rwsems
+ * whose readers may only be accounted in the per-CPU counts.
+ */
 static inline int rwsem_is_locked(struct rw_semaphore *sem)
 {
+#ifdef CONFIG_RWSEM_ADAPTIVE
+	if (unlikely(READ_ONCE(sem->pcpu_state)))
+		return rwsem_pcpu_is_locked(sem);
+#endif
 	return atomic_long_read(&sem->count) != 0;
 }
 
@@ -214,6 +232,22 @@ DEFINE_FREE(up_write, struct rw_semaphore *, if (_T) up_write(_T))
  */
 extern void downgrade_write(struct rw_semaphore *sem);
 
+/*
+ * Let readers of a read-mostly rwsem use per-CPU counts while no writer
+ * is around.
+ */
+#ifdef CONFIG_RWSEM_ADAPTIVE
+extern int rwsem_enable_adaptive(struct rw_semaphore *sem);
+extern void rwsem_disable_adaptive(struct rw_semaphore *sem);
+#else
+static inline int rwsem_enable_adaptive(struct rw_semaphore *sem)
+{
+	return 0;
+}
+
+static inline void rwsem_disable_adaptive(struct rw_semaphore *sem) { }
+#endif
+
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 /*
  * nested locking. NOTE: rwsems are not allowed to recurse
@@ -503,12 +503,19 @@ struct sched_avg {
 	struct util_est			util_est;
 } ____cacheline_aligned;
 
+/*
+ * Runqueue wait time histogram: bucket 0 counts waits below 1us, bucket N
+ * waits of [2^(N-1), 2^N) usecs, the last bucket everything longer.
+ */
+#define SCHED_WAIT_HIST_NR		20
+
 struct sched_statistics {
 #ifdef CONFIG_SCHEDSTATS
 	u64				wait_start;
 	u64				wait_max;
 	u64				wait_count;
 	u64				wait_sum;
+	u64				wait_hist[SCHED_WAIT_HIST_NR];
 	u64				iowait_count;
 	u64				iowait_sum;
 
@@ -728,6 +735,23 @@ struct wake_q_node {
 	struct wake_q_node *next;
 };
 
+#ifdef CONFIG_LOCK_CONTENTION_PROFILE
+/* Lock waits in progress, see kernel/locking/lock_contention.c */
+#define LOCK_CONTENTION_DEPTH		2
+
+struct lock_contention_wait {
+	void			*lock;
+	unsigned long		ip;
+	u64			start;
+	unsigned int		flags;
+};
+
+struct lock_contention_stack {
+	unsigned int			depth;
+	struct lock_contention_wait	wait[LOCK_CONTENTION_DEPTH];
+};
+#endif
+
 struct kmap_ctrl {
 #ifdef CONFIG_KMAP_LOCAL
 	int				idx;
@@ -794,6 +818,7 @@ struct task_struct {
 #ifdef CONFIG_SCHED_CORE
 	struct rb_node			core_node;
 	unsigned long			core_cookie;
+	unsigned long			core_ref;
 	unsigned int			core_occupation;
 #endif
 
@@ -1145,6 +1170,10 @@ struct task_struct {
 	struct mutex_waiter		*blocked_on;
 #endif
 
+#ifdef CONFIG_LOCK_CONTENTION_PROFILE
+	struct lock_contention_stack	lock_contention;
+#endif
+
 #ifdef CONFIG_DEBUG_ATOMIC_SLEEP
 	int				non_block_count;
 #endif
@@ -1308,6 +1337,12 @@ struct task_struct {
 	 * with respect to preemption.
 	 */
 	unsigned long rseq_event_mask;
+	/* Time slice extension, enabled with RSEQ_FLAG_SLICE_EXT */
+	u8 rseq_slice_ext;
+	u8 rseq_slice_state;
+	unsigned long rseq_slice_granted;
+	unsigned long rseq_slice_yielded;
+	unsigned long rseq_slice_expired;
 #endif
 
 #ifdef CONFIG_SCHED_MM_CID
@@ -1353,6 +1388,11 @@ struct task_struct {
 	u64				timer_slack_ns;
 	u64				default_timer_slack_ns;
 
+#ifdef CONFIG_CPU_IDLE
+	/* Wakeup latency (usecs) the CPU this task runs on has to provide */
+	s32				wakeup_latency_qos;
+#endif
+
 #if defined(CONFIG_KASAN_GENERIC) || defined(CONFIG_KASAN_SW_TAGS)
 	unsigned int			kasan_depth;
 #endif
@@ -2323,6 +2363,22 @@ enum rseq_event_mask {
 	RSEQ_EVENT_MIGRATE	= (1U << RSEQ_EVENT_MIGRATE_BIT),
 };
 
+/* task_struct::rseq_slice_state */
+enum rseq_slice_state {
+	RSEQ_SLICE_NONE,
+	RSEQ_SLICE_GRANTED,	/* Running on an extension */
+	RSEQ_SLICE_EXPIRED,	/* Extension expired, reschedule pending */
+};
+
+static inline void rseq_slice_reset(struct task_struct *t)
+{
+	t->rseq_slice_ext = 0;
+	t->rseq_slice_state = RSEQ_SLICE_NONE;
+	t->rseq_slice_granted = 0;
+	t->rseq_slice_yielded = 0;
+	t->rseq_slice_expired = 0;
+}
+
 static inline void rseq_set_notify_resume(struct task_struct *t)
 {
 	if (t->rseq)
@@ -2372,11 +2428,14 @@ static inline void rseq_fork(struct task_struct *t, unsigned long clone_flags)
 		t->rseq_len = 0;
 		t->rseq_sig = 0;
 		t->rseq_event_mask = 0;
+		rseq_slice_reset(t);
 	} else {
 		t->rseq = current->rseq;
 		t->rseq_len = current->rseq_len;
 		t->rseq_sig = current->rseq_sig;
 		t->rseq_event_mask = current->rseq_event_mask;
+		rseq_slice_reset(t);
+		t->rseq_slice_ext = current->rseq_slice_ext;
 	}
 }
 
@@ -2386,8 +2445,12 @@ static inline void rseq_execve(struct task_struct *t)
 	t->rseq_len = 0;
 	t->rseq_sig = 0;
 	t->rseq_event_mask = 0;
+	rseq_slice_reset(t);
 }
 
+bool rseq_slice_extension_grant(void);
+bool sched_rseq_slice_extend(void);
+
 #else
 
 static inline void rseq_set_notify_resume(struct task_struct *t)
@@ -2413,6 +2476,10 @@ static inline void rseq_fork(struct task_struct *t, unsigned long clone_flags)
 static inline void rseq_execve(struct task_struct *t)
 {
 }
+static inline bool rseq_slice_extension_grant(void)
+{
+	return false;
+}
 
 #endif
 
@@ -23,6 +23,16 @@ void cpufreq_add_update_util_hook(int cpu, struct update_util_data *data,
 void cpufreq_remove_update_util_hook(int cpu);
 bool cpufreq_this_cpu_can_update(struct cpufreq_policy *policy);
 
+#ifdef CONFIG_UCLAMP_TASK
+bool cpufreq_cpu_uclamp(int cpu, unsigned long *min, unsigned long *max);
+#else
+static inline bool cpufreq_cpu_uclamp(int cpu, unsigned long *min,
+				      unsigned long *max)
+{
+	return false;
+}
+#endif
+
 static inline unsigned long map_util_freq(unsigned long util,
 					unsigned long freq, unsigned long cap)
 {
@@ -35,4 +45,10 @@ static inline unsigned long map_util_perf(unsigned long util)
 }
 #endif /* CONFIG_CPU_FREQ */
 
+#ifdef CONFIG_CPU_FREQ_GOV_SCHEDUTIL
+void cpufreq_io_boost_hint(void);
+#else
+static inline void cpufreq_io_boost_hint(void) { }
+#endif
+
 #endif /* _LINUX_SCHED_CPUFREQ_H */
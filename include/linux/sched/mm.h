@@ -460,6 +460,12 @@ static inline void membarrier_mm_sync_core_before_usermode(struct mm_struct *mm)
 	sync_core_before_usermode();
 }
 
+static inline void membarrier_mm_init(struct mm_struct *mm)
+{
+	mutex_init(&mm->membarrier_mutex);
+	mm->membarrier_seq = 0;
+}
+
 extern void membarrier_exec_mmap(struct mm_struct *mm);
 
 extern void membarrier_update_current_mm(struct mm_struct *next_mm);
@@ -472,6 +478,9 @@ static inline void membarrier_arch_switch_mm(struct mm_struct *prev,
 {
 }
 #endif
+static inline void membarrier_mm_init(struct mm_struct *mm)
+{
+}
 static inline void membarrier_exec_mmap(struct mm_struct *mm)
 {
 }
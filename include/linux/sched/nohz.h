@@ -29,4 +29,12 @@ extern void wake_up_nohz_cpu(int cpu);
 static inline void wake_up_nohz_cpu(int cpu) { }
 #endif
 
+struct cpumask;
+
+#ifdef CONFIG_NO_HZ_FULL
+extern void sched_set_batch_cpus(const struct cpumask *cpus);
+#else
+static inline void sched_set_batch_cpus(const struct cpumask *cpus) { }
+#endif
+
 #endif /* _LINUX_SCHED_NOHZ_H */
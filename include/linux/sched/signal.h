@@ -245,6 +245,13 @@ struct signal_struct {
 						 * and may have inconsistent
 						 * permissions.
 						 */
+#ifdef CONFIG_CGROUPS
+	struct rw_semaphore cgroup_threadgroup_rwsem;	/* Stabilizes the thread
+							 * group against cgroup
+							 * migration, see
+							 * CGRP_ROOT_FAVOR_DYNMODS
+							 */
+#endif
 } __randomize_layout;
 
 /*
@@ -82,6 +82,11 @@ struct sched_domain_shared {
 	atomic_t	nr_busy_cpus;
 	int		has_idle_cores;
 	int		nr_idle_scan;
+	/*
+	 * CPUs of the LLC that went idle, maintained on idle entry and exit
+	 * for SIS_FILTER. Only a hint, wakeups still check the CPU is idle.
+	 */
+	unsigned long	icpus[];
 };
 
 struct sched_domain {
@@ -95,6 +100,7 @@ struct sched_domain {
 	unsigned int imbalance_pct;	/* No balance until over watermark */
 	unsigned int cache_nice_tries;	/* Leave cache hot tasks for # tries */
 	unsigned int imb_numa_nr;	/* Nr running tasks that allows a NUMA imbalance */
+	unsigned int migration_cost;	/* Cache hot threshold in ns, 0: sysctl */
 
 	int nohz_idle;			/* NOHZ IDLE status */
 	int flags;			/* See SD_* */
@@ -167,7 +173,7 @@ static inline struct cpumask *sched_domain_span(struct sched_domain *sd)
 	return to_cpumask(sd->span);
 }
 
-extern void partition_sched_domains_locked(int ndoms_new,
+extern bool partition_sched_domains_locked(int ndoms_new,
 					   cpumask_var_t doms_new[],
 					   struct sched_domain_attr *dattr_new);
 
@@ -192,11 +198,19 @@ struct sd_data {
 	struct sched_group_capacity *__percpu *sgc;
 };
 
+/*
+ * Arches may stack several cache sharing (SD_SHARE_PKG_RESOURCES) levels below
+ * NUMA, e.g. L2 clusters inside an L3 CCX; the highest one becomes sd_llc and
+ * provides sd_llc_shared. @migration_cost overrides
+ * sysctl_sched_migration_cost as the cache hot threshold used when balancing
+ * at that level, so that levels crossing an LLC boundary can be made stickier.
+ */
 struct sched_domain_topology_level {
 	sched_domain_mask_f mask;
 	sched_domain_flags_f sd_flags;
 	int		    flags;
 	int		    numa_level;
+	unsigned int	    migration_cost;
 	struct sd_data      data;
 #ifdef CONFIG_SCHED_DEBUG
 	char                *name;
@@ -215,10 +229,11 @@ extern void __init set_sched_topology(struct sched_domain_topology_level *tl);
 
 struct sched_domain_attr;
 
-static inline void
+static inline bool
 partition_sched_domains_locked(int ndoms_new, cpumask_var_t doms_new[],
 			       struct sched_domain_attr *dattr_new)
 {
+	return false;
 }
 
 static inline void
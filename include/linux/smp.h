@@ -160,6 +160,11 @@ void smp_call_function_many(const struct cpumask *mask,
 int smp_call_function_any(const struct cpumask *mask,
 			  smp_call_func_t func, void *info, int wait);
 
+void smp_call_batch_begin(void);
+void smp_call_batch_add(const struct cpumask *mask,
+			smp_call_func_t func, void *info);
+void smp_call_batch_end(void);
+
 void kick_all_cpus_sync(void);
 void wake_up_all_idle_cpus(void);
 
@@ -215,6 +220,11 @@ smp_call_function_any(const struct cpumask *mask, smp_call_func_t func,
 	return smp_call_function_single(0, func, info, wait);
 }
 
+#define smp_call_batch_begin()			preempt_disable()
+static inline void smp_call_batch_add(const struct cpumask *mask,
+				      smp_call_func_t func, void *info) { }
+#define smp_call_batch_end()			preempt_enable()
+
 static inline void kick_all_cpus_sync(void) {  }
 static inline void wake_up_all_idle_cpus(void) {  }
 
@@ -55,6 +55,7 @@ struct timezone;
 struct tms;
 struct utimbuf;
 struct mq_attr;
+struct mq_msgv;
 struct compat_stat;
 struct old_timeval32;
 struct robust_list_head;
@@ -74,6 +75,7 @@ struct landlock_ruleset_attr;
 enum landlock_rule_type;
 struct cachestat_range;
 struct cachestat;
+struct syscall_batch_entry;
 
 #include <linux/types.h>
 #include <linux/aio_abi.h>
@@ -708,6 +710,7 @@ asmlinkage long sys_mq_open(const char __user *name, int oflag, umode_t mode, st
 asmlinkage long sys_mq_unlink(const char __user *name);
 asmlinkage long sys_mq_timedsend(mqd_t mqdes, const char __user *msg_ptr, size_t msg_len, unsigned int msg_prio, const struct __kernel_timespec __user *abs_timeout);
 asmlinkage long sys_mq_timedreceive(mqd_t mqdes, char __user *msg_ptr, size_t msg_len, unsigned int __user *msg_prio, const struct __kernel_timespec __user *abs_timeout);
+asmlinkage long sys_mq_timedreceivev(mqd_t mqdes, struct mq_msgv __user *msgv, unsigned int vlen, unsigned int flags, const struct __kernel_timespec __user *abs_timeout);
 asmlinkage long sys_mq_notify(mqd_t mqdes, const struct sigevent __user *notification);
 asmlinkage long sys_mq_getsetattr(mqd_t mqdes, const struct mq_attr __user *mqstat, struct mq_attr __user *omqstat);
 asmlinkage long sys_mq_timedreceive_time32(mqd_t mqdes,
@@ -953,6 +956,8 @@ asmlinkage long sys_set_mempolicy_home_node(unsigned long start, unsigned long l
 asmlinkage long sys_cachestat(unsigned int fd,
 		struct cachestat_range __user *cstat_range,
 		struct cachestat __user *cstat, unsigned int flags);
+asmlinkage long sys_syscall_batch(struct syscall_batch_entry __user *entries,
+				  unsigned int nr, unsigned int flags);
 
 /*
  * Architecture-specific system calls
@@ -13,7 +13,7 @@ void unix_notinflight(struct user_struct *user, struct file *fp);
 void unix_destruct_scm(struct sk_buff *skb);
 void io_uring_destruct_scm(struct sk_buff *skb);
 void unix_gc(void);
-void wait_for_unix_gc(void);
+void wait_for_unix_gc(struct scm_fp_list *fpl);
 struct sock *unix_get_socket(struct file *filp);
 struct sock *unix_peer_get(struct sock *sk);
 
@@ -38,10 +38,15 @@ struct unix_skb_parms {
 	u32			secid;		/* Security ID		*/
 #endif
 	u32			consumed;
+	u32			nr_unix_fds;	/* AF_UNIX sockets in fp */
 } __randomize_layout;
 
 struct scm_stat {
 	atomic_t nr_fds;
+	/* Queued fds that are AF_UNIX sockets, the GC only scans the
+	 * queues where it is non-zero.
+	 */
+	atomic_t nr_unix_fds;
 };
 
 #define UNIXCB(skb)	(*(struct unix_skb_parms *)&((skb)->cb))
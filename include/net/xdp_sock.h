@@ -24,6 +24,7 @@ struct xdp_umem {
 	u32 headroom;
 	u32 chunk_size;
 	u32 chunks;
+	u32 tx_metadata_len;
 	u32 npgs;
 	struct user_struct *user;
 	refcount_t users;
@@ -60,6 +61,10 @@ struct xdp_sock {
 
 	struct xsk_queue *tx ____cacheline_aligned_in_smp;
 	struct list_head tx_list;
+	/* Own completion ring when sharing the pool of another socket */
+	struct xsk_queue *cq;
+	/* Protects cq in the SKB mode */
+	spinlock_t cq_lock;
 	/* Protects generic receive. */
 	spinlock_t rx_lock;
 
@@ -72,6 +77,8 @@ struct xdp_sock {
 	spinlock_t map_list_lock;
 	/* Protects multiple processes in the control path */
 	struct mutex mutex;
+	/* Own fill ring when sharing the pool of another socket */
+	struct xsk_queue *fq;
 	struct xsk_queue *fq_tmp; /* Only as tmp storage before bind */
 	struct xsk_queue *cq_tmp; /* Only as tmp storage before bind */
 };
@@ -7,6 +7,7 @@
 #include <linux/if_xdp.h>
 #include <linux/types.h>
 #include <linux/dma-mapping.h>
+#include <linux/mutex.h>
 #include <linux/bpf.h>
 #include <net/xdp.h>
 
@@ -43,6 +44,13 @@ struct xsk_dma_map {
 	bool dma_need_sync;
 };
 
+/* Fill rings that sockets sharing a pool brought along, see xp_add_fq() */
+struct xsk_fq_array {
+	struct rcu_head rcu;
+	u32 nr;
+	struct xsk_queue *fqs[];
+};
+
 struct xsk_buff_pool {
 	/* Members only used in the control path first. */
 	struct device *dev;
@@ -56,10 +64,18 @@ struct xsk_buff_pool {
 	struct list_head free_list;
 	u32 heads_cnt;
 	u16 queue_id;
+	/* Serializes updates of extra_fqs */
+	struct mutex fqs_lock;
 
 	/* Data path members as close to free_heads at the end as possible. */
 	struct xsk_queue *fq ____cacheline_aligned_in_smp;
 	struct xsk_queue *cq;
+	/* Consumed round robin once fq is empty */
+	struct xsk_fq_array __rcu *extra_fqs;
+	u32 extra_fq_idx;
+	unsigned long wakeup_jiffies;
+	/* XDP_WAKEUP_* kicks the driver hasn't polled since, see xsk_wakeup() */
+	unsigned long wakeup_pending;
 	/* For performance reasons, each buff pool has its own array of dma_pages
 	 * even when they are identical.
 	 */
@@ -75,10 +91,15 @@ struct xsk_buff_pool {
 	u32 chunk_size;
 	u32 chunk_shift;
 	u32 frame_len;
+	u32 tx_metadata_len;
 	u8 cached_need_wakeup;
+	/* Rx is driven by busy-polling, keep need_wakeup set */
+	bool busy_poll_rx;
 	bool uses_need_wakeup;
 	bool dma_need_sync;
 	bool unaligned;
+	/* Tx packets may span several descriptors, see XDP_PKT_CONTD */
+	bool tx_sg;
 	void *addrs;
 	/* Mutual exclusion of the completion ring in the SKB mode. Two cases to protect:
 	 * NAPI TX thread and sendmsg error paths in the SKB destructor callback and when
@@ -109,6 +130,8 @@ bool xp_put_pool(struct xsk_buff_pool *pool);
 void xp_clear_dev(struct xsk_buff_pool *pool);
 void xp_add_xsk(struct xsk_buff_pool *pool, struct xdp_sock *xs);
 void xp_del_xsk(struct xsk_buff_pool *pool, struct xdp_sock *xs);
+int xp_add_fq(struct xsk_buff_pool *pool, struct xsk_queue *fq);
+void xp_del_fq(struct xsk_buff_pool *pool, struct xsk_queue *fq);
 
 /* AF_XDP, and XDP core. */
 void xp_free(struct xdp_buff_xsk *xskb);
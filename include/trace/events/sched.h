@@ -735,6 +735,10 @@ DECLARE_TRACE(sched_update_nr_running_tp,
 	TP_PROTO(struct rq *rq, int change),
 	TP_ARGS(rq, change));
 
+DECLARE_TRACE(sched_cpufreq_boost_tp,
+	TP_PROTO(int cpu, unsigned long boost, unsigned long util),
+	TP_ARGS(cpu, boost, util));
+
 #endif /* _TRACE_SCHED_H */
 
 /* This part must be outside protection */
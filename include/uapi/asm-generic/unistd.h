@@ -819,9 +819,13 @@ __SYSCALL(__NR_set_mempolicy_home_node, sys_set_mempolicy_home_node)
 
 #define __NR_cachestat 451
 __SYSCALL(__NR_cachestat, sys_cachestat)
+#define __NR_mq_timedreceivev 452
+__SYSCALL(__NR_mq_timedreceivev, sys_mq_timedreceivev)
+#define __NR_syscall_batch 453
+__SYSCALL(__NR_syscall_batch, sys_syscall_batch)
 
 #undef __NR_syscalls
-#define __NR_syscalls 452
+#define __NR_syscalls 454
 
 /*
  * 32 bit systems traditionally used different
@@ -38,6 +38,42 @@ struct cgroupstats {
 	__u64	nr_io_wait;		/* Number of tasks waiting on IO */
 };
 
+/*
+ * Delays accrued by the tasks of a cgroup on the default hierarchy while
+ * they were in it, as accounted by delay accounting for each task. Tasks
+ * in descendant cgroups are not included. Only cgroups created while
+ * delay accounting was enabled have them.
+ *
+ * hist[] counts the delays by duration: bucket 0 holds the ones shorter
+ * than 1024ns, bucket i the ones in [2^(2i+8), 2^(2i+10)) ns and the last
+ * bucket everything longer. The buckets are free running 32 bit counters
+ * that wrap around.
+ */
+enum {
+	CGROUPSTATS_DELAY_CPU,		/* waiting for a CPU while runnable */
+	CGROUPSTATS_DELAY_BLKIO,	/* sync block I/O */
+	CGROUPSTATS_DELAY_SWAPIN,	/* swapin */
+	CGROUPSTATS_DELAY_FREEPAGES,	/* memory reclaim */
+	CGROUPSTATS_DELAY_THRASHING,	/* thrashing page */
+	CGROUPSTATS_DELAY_COMPACT,	/* memory compaction */
+	CGROUPSTATS_DELAY_WPCOPY,	/* write-protect copy */
+	CGROUPSTATS_DELAY_IRQ,		/* IRQ/SOFTIRQ */
+	CGROUPSTATS_DELAY_NR,
+};
+
+#define CGROUPSTATS_DELAY_BUCKETS	12
+
+#define CGROUP_DELAYSTATS_VERSION	1
+
+struct cgroup_delaystats {
+	__u64	cgroup_id;		/* as in name_to_handle_at() */
+	__u32	version;		/* CGROUP_DELAYSTATS_VERSION */
+	__u32	nr_buckets;		/* CGROUPSTATS_DELAY_BUCKETS */
+	__u64	delay_total[CGROUPSTATS_DELAY_NR];	/* in ns */
+	__u64	count[CGROUPSTATS_DELAY_NR];
+	__u32	hist[CGROUPSTATS_DELAY_NR][CGROUPSTATS_DELAY_BUCKETS];
+};
+
 /*
  * Commands sent from userspace
  * Not versioned. New commands should only be inserted at the enum's end
@@ -48,6 +84,7 @@ enum {
 	CGROUPSTATS_CMD_UNSPEC = __TASKSTATS_CMD_MAX,	/* Reserved */
 	CGROUPSTATS_CMD_GET,		/* user->kernel request/get-response */
 	CGROUPSTATS_CMD_NEW,		/* kernel->user event */
+	CGROUPSTATS_CMD_GET_DELAYS,	/* user->kernel dump of all cgroups */
 	__CGROUPSTATS_CMD_MAX,
 };
 
@@ -56,6 +93,7 @@ enum {
 enum {
 	CGROUPSTATS_TYPE_UNSPEC = 0,	/* Reserved */
 	CGROUPSTATS_TYPE_CGROUP_STATS,	/* contains name + stats */
+	CGROUPSTATS_TYPE_CGROUP_DELAYS,	/* struct cgroup_delaystats */
 	__CGROUPSTATS_TYPE_MAX,
 };
 
@@ -206,6 +206,14 @@
  *  - add extension header
  *  - add FUSE_EXT_GROUPS
  *  - add FUSE_CREATE_SUPP_GROUP
+ *
+ *  7.39
+ *  - add FUSE_OVER_IO_URING and the io_uring request transport
+ *
+ *  7.40
+ *  - add max_stack_depth to fuse_init_out, add FUSE_PASSTHROUGH init flag
+ *  - add backing_id to fuse_open_out, add FOPEN_PASSTHROUGH open flag
+ *  - add FUSE_DEV_IOC_BACKING_OPEN and FUSE_DEV_IOC_BACKING_CLOSE
  */
 
 #ifndef _LINUX_FUSE_H
@@ -241,7 +249,7 @@
 #define FUSE_KERNEL_VERSION 7
 
 /** Minor version number of this interface */
-#define FUSE_KERNEL_MINOR_VERSION 38
+#define FUSE_KERNEL_MINOR_VERSION 40
 
 /** The node ID of the root inode */
 #define FUSE_ROOT_ID 1
@@ -314,6 +322,7 @@ struct fuse_file_lock {
  * FOPEN_STREAM: the file is stream-like (no file position at all)
  * FOPEN_NOFLUSH: don't flush data cache on close (unless FUSE_WRITEBACK_CACHE)
  * FOPEN_PARALLEL_DIRECT_WRITES: Allow concurrent direct writes on the same inode
+ * FOPEN_PASSTHROUGH: passthrough read/write io for this open file
  */
 #define FOPEN_DIRECT_IO		(1 << 0)
 #define FOPEN_KEEP_CACHE	(1 << 1)
@@ -322,6 +331,7 @@ struct fuse_file_lock {
 #define FOPEN_STREAM		(1 << 4)
 #define FOPEN_NOFLUSH		(1 << 5)
 #define FOPEN_PARALLEL_DIRECT_WRITES	(1 << 6)
+#define FOPEN_PASSTHROUGH	(1 << 7)
 
 /**
  * INIT request/reply flags
@@ -369,6 +379,9 @@ struct fuse_file_lock {
  * FUSE_HAS_INODE_DAX:  use per inode DAX
  * FUSE_CREATE_SUPP_GROUP: add supplementary group info to create, mkdir,
  *			symlink and mknod (single group that matches parent)
+ * FUSE_OVER_IO_URING: requests may be transferred with io_uring commands
+ *			instead of read/write on the device
+ * FUSE_PASSTHROUGH: passthrough read/write io on backing files
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -406,6 +419,8 @@ struct fuse_file_lock {
 #define FUSE_SECURITY_CTX	(1ULL << 32)
 #define FUSE_HAS_INODE_DAX	(1ULL << 33)
 #define FUSE_CREATE_SUPP_GROUP	(1ULL << 34)
+#define FUSE_OVER_IO_URING	(1ULL << 35)
+#define FUSE_PASSTHROUGH	(1ULL << 36)
 
 /**
  * CUSE INIT request/reply flags
@@ -698,7 +713,7 @@ struct fuse_create_in {
 struct fuse_open_out {
 	uint64_t	fh;
 	uint32_t	open_flags;
-	uint32_t	padding;
+	int32_t		backing_id;
 };
 
 struct fuse_release_in {
@@ -814,7 +829,8 @@ struct fuse_init_out {
 	uint16_t	max_pages;
 	uint16_t	map_alignment;
 	uint32_t	flags2;
-	uint32_t	unused[7];
+	uint32_t	max_stack_depth;
+	uint32_t	unused[6];
 };
 
 #define CUSE_INIT_INFO_MAX 4096
@@ -989,6 +1005,22 @@ struct fuse_notify_retrieve_in {
 /* Device ioctls: */
 #define FUSE_DEV_IOC_MAGIC		229
 #define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
+#define FUSE_DEV_IOC_BACKING_OPEN	_IOW(FUSE_DEV_IOC_MAGIC, 1, \
+					     struct fuse_backing_map)
+#define FUSE_DEV_IOC_BACKING_CLOSE	_IOW(FUSE_DEV_IOC_MAGIC, 2, uint32_t)
+
+/*
+ * FUSE_DEV_IOC_BACKING_OPEN registers @fd as a backing file and returns its
+ * backing id, which the server puts in fuse_open_out with FOPEN_PASSTHROUGH.
+ * Reads, writes and mmaps of such an open file go directly to the backing
+ * file, with the credentials of the server at registration time.  @flags and
+ * @padding must be zero.
+ */
+struct fuse_backing_map {
+	int32_t		fd;
+	uint32_t	flags;
+	uint64_t	padding;
+};
 
 struct fuse_lseek_in {
 	uint64_t	fh;
@@ -1090,4 +1122,39 @@ struct fuse_supp_groups {
 	uint32_t	groups[];
 };
 
+/*
+ * io_uring request transport
+ *
+ * If FUSE_OVER_IO_URING was negotiated, the server may submit IORING_OP_URING_CMD
+ * commands on the device with the following cmd_op values:
+ *
+ * FUSE_IO_URING_CMD_REGISTER: hand a buffer (sqe->addr, sqe->len) to queue
+ *	@qid of struct fuse_uring_cmd_req.  There is one queue per possible
+ *	CPU, and each queue has to be served by a single task.  Requests are
+ *	only sent through the ring once every queue has a buffer.
+ *
+ * FUSE_IO_URING_CMD_COMMIT_AND_FETCH: the buffer holds the reply to the
+ *	request @commit_id; commit it and wait for the next request in the
+ *	same buffer.
+ *
+ * A command completes with the length of the request placed in its buffer,
+ * in the same format a read of the device returns.  Replies are written to
+ * the buffer in the format of a write to the device.  A negative result
+ * ends the use of the buffer.  Interrupts, forgets and notifications still
+ * go through read and write on the device.
+ */
+enum fuse_uring_cmd {
+	FUSE_IO_URING_CMD_INVALID = 0,
+	FUSE_IO_URING_CMD_REGISTER = 1,
+	FUSE_IO_URING_CMD_COMMIT_AND_FETCH = 2,
+};
+
+/* Payload of the io_uring commands, in the cmd area of the sqe */
+struct fuse_uring_cmd_req {
+	/* unique id of the request replied to, for COMMIT_AND_FETCH */
+	uint64_t	commit_id;
+	uint16_t	qid;
+	uint16_t	padding[3];
+};
+
 #endif /* _LINUX_FUSE_H */
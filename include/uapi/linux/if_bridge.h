@@ -803,6 +803,12 @@ struct br_mcast_stats {
 /* bridge boolean options
  * BR_BOOLOPT_NO_LL_LEARN - disable learning from link-local packets
  * BR_BOOLOPT_MCAST_VLAN_SNOOPING - control vlan multicast snooping
+ * BR_BOOLOPT_FDB_LEARN_BATCH - queue newly learned fdb entries per CPU and
+ *                              insert them in batches
+ * BR_BOOLOPT_FDB_COARSE_REFRESH - refresh the fdb entry timestamps at most
+ *                                 once per second
+ * BR_BOOLOPT_FDB_FWD_CACHE - cache the fdb entries of recently forwarded
+ *                            unicast flows per CPU
  *
  * IMPORTANT: if adding a new option do not forget to handle
  *            it in br_boolopt_toggle/get and bridge sysfs
@@ -811,6 +817,9 @@ enum br_boolopt_id {
 	BR_BOOLOPT_NO_LL_LEARN,
 	BR_BOOLOPT_MCAST_VLAN_SNOOPING,
 	BR_BOOLOPT_MST_ENABLE,
+	BR_BOOLOPT_FDB_LEARN_BATCH,
+	BR_BOOLOPT_FDB_COARSE_REFRESH,
+	BR_BOOLOPT_FDB_FWD_CACHE,
 	BR_BOOLOPT_MAX
 };
 
@@ -61,6 +61,8 @@
 #define TUNSETFILTEREBPF _IOR('T', 225, int)
 #define TUNSETCARRIER _IOW('T', 226, int)
 #define TUNGETDEVNETNS _IO('T', 227)
+#define TUNSENDMMSG _IOW('T', 228, struct tun_mmsg)
+#define TUNRECVMMSG _IOWR('T', 229, struct tun_mmsg)
 
 /* TUNSETIFF ifr flags */
 #define IFF_TUN		0x0001
@@ -93,6 +95,25 @@
 #define TUN_F_USO4	0x20	/* I can handle USO for IPv4 packets */
 #define TUN_F_USO6	0x40	/* I can handle USO for IPv6 packets */
 
+/*
+ * Batch of packets for TUNSENDMMSG and TUNRECVMMSG. Each packet is laid out
+ * as for write() and read() on the device, i.e. with struct tun_pi and the
+ * virtio_net_hdr in front if those are enabled, so GSO packets can be passed
+ * in both directions. The ioctls return the number of packets transferred and
+ * set @len of each of them. TUNRECVMMSG only blocks for the first packet.
+ */
+struct tun_mmsg_pkt {
+	__u64	iov;	/* pointer to an array of struct iovec */
+	__u32	iovlen;	/* number of entries in @iov */
+	__u32	len;	/* set to the length of the packet */
+};
+
+struct tun_mmsg {
+	__u64	pkts;	/* pointer to an array of struct tun_mmsg_pkt */
+	__u32	count;	/* number of entries in @pkts */
+	__u32	flags;	/* must be 0 */
+};
+
 /* Protocol info prepended to the packets (when IFF_NO_PI is not set) */
 #define TUN_PKT_STRIP	0x0001
 struct tun_pi {
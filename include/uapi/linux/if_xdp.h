@@ -28,6 +28,8 @@
 
 /* Flags for xsk_umem_config flags */
 #define XDP_UMEM_UNALIGNED_CHUNK_FLAG (1 << 0)
+/* The tx_metadata_len field of struct xdp_umem_reg is valid */
+#define XDP_UMEM_TX_METADATA_LEN (1 << 1)
 
 struct sockaddr_xdp {
 	__u16 sxdp_family;
@@ -70,6 +72,7 @@ struct xdp_umem_reg {
 	__u32 chunk_size;
 	__u32 headroom;
 	__u32 flags;
+	__u32 tx_metadata_len;
 };
 
 struct xdp_statistics {
@@ -106,6 +109,41 @@ struct xdp_desc {
 	__u32 options;
 };
 
+/* Flags for the options field of struct xdp_desc */
+
+/* The packet continues in the next descriptor. Only supported on Tx in
+ * copy mode and by drivers which support multi-buffer zero-copy Tx.
+ */
+#define XDP_PKT_CONTD (1 << 0)
+/* A struct xsk_tx_metadata is placed tx_metadata_len bytes in front of
+ * the packet data. Only valid on the first descriptor of a packet.
+ */
+#define XDP_TX_METADATA (1 << 1)
+
+/* Request L4 checksum offload: the device computes the checksum from
+ * csum_start to the end of the packet and stores it at csum_start +
+ * csum_offset. The checksum field has to hold the pseudo header sum.
+ */
+#define XDP_TXMD_FLAGS_CHECKSUM (1 << 0)
+/* Request segmentation offload into gso_size bytes of L4 payload per
+ * segment. Requires XDP_TXMD_FLAGS_CHECKSUM.
+ */
+#define XDP_TXMD_FLAGS_TSO (1 << 1)
+
+/* Values for the gso_type field of struct xsk_tx_metadata */
+#define XDP_TXMD_GSO_TCPV4	1
+#define XDP_TXMD_GSO_TCPV6	2
+#define XDP_TXMD_GSO_UDP_L4	3
+
+/* Tx offload request, see XDP_TX_METADATA */
+struct xsk_tx_metadata {
+	__u64 flags;
+	__u16 csum_start;
+	__u16 csum_offset;
+	__u16 gso_size;
+	__u16 gso_type;
+};
+
 /* UMEM descriptor is __u64 */
 
 #endif /* _LINUX_IF_XDP_H */
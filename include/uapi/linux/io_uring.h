@@ -114,6 +114,7 @@ enum {
 	IOSQE_ASYNC_BIT,
 	IOSQE_BUFFER_SELECT_BIT,
 	IOSQE_CQE_SKIP_SUCCESS_BIT,
+	IOSQE_IO_PARALLEL_BIT,
 };
 
 /*
@@ -133,6 +134,8 @@ enum {
 #define IOSQE_BUFFER_SELECT	(1U << IOSQE_BUFFER_SELECT_BIT)
 /* don't post CQE if request succeeded */
 #define IOSQE_CQE_SKIP_SUCCESS	(1U << IOSQE_CQE_SKIP_SUCCESS_BIT)
+/* with IOSQE_IO_LINK, run in parallel with the next sqe of the link */
+#define IOSQE_IO_PARALLEL	(1U << IOSQE_IO_PARALLEL_BIT)
 
 /*
  * io_uring_setup() flags
@@ -185,6 +188,12 @@ enum {
  */
 #define IORING_SETUP_REGISTERED_FD_ONLY	(1U << 15)
 
+/*
+ * Don't keep a private cache of free requests, share a per-cpu one with
+ * other rings using this flag instead.
+ */
+#define IORING_SETUP_SHARED_REQ_CACHE	(1U << 16)
+
 enum io_uring_op {
 	IORING_OP_NOP,
 	IORING_OP_READV,
@@ -235,6 +244,8 @@ enum io_uring_op {
 	IORING_OP_URING_CMD,
 	IORING_OP_SEND_ZC,
 	IORING_OP_SENDMSG_ZC,
+	IORING_OP_READV_FIXED,
+	IORING_OP_WRITEV_FIXED,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -265,6 +276,7 @@ enum io_uring_op {
 #define IORING_LINK_TIMEOUT_UPDATE	(1U << 4)
 #define IORING_TIMEOUT_ETIME_SUCCESS	(1U << 5)
 #define IORING_TIMEOUT_MULTISHOT	(1U << 6)
+#define IORING_TIMEOUT_COARSE		(1U << 7)
 #define IORING_TIMEOUT_CLOCK_MASK	(IORING_TIMEOUT_BOOTTIME | IORING_TIMEOUT_REALTIME)
 #define IORING_TIMEOUT_UPDATE_MASK	(IORING_TIMEOUT_UPDATE | IORING_LINK_TIMEOUT_UPDATE)
 /*
@@ -388,11 +400,16 @@ struct io_uring_cqe {
  * IORING_CQE_F_SOCK_NONEMPTY	If set, more data to read after socket recv
  * IORING_CQE_F_NOTIF	Set for notification CQEs. Can be used to distinct
  * 			them from sends.
+ * IORING_CQE_F_BUF_MORE If set, the buffer ID set in the upper 16 bits has
+ *			only been partially consumed and more completions
+ *			will land in it, appended right after the data of
+ *			this one. Only used with IOU_PBUF_RING_INC rings.
  */
 #define IORING_CQE_F_BUFFER		(1U << 0)
 #define IORING_CQE_F_MORE		(1U << 1)
 #define IORING_CQE_F_SOCK_NONEMPTY	(1U << 2)
 #define IORING_CQE_F_NOTIF		(1U << 3)
+#define IORING_CQE_F_BUF_MORE		(1U << 4)
 
 enum {
 	IORING_CQE_BUFFER_SHIFT		= 16,
@@ -491,6 +508,7 @@ struct io_uring_params {
 #define IORING_FEAT_CQE_SKIP		(1U << 11)
 #define IORING_FEAT_LINKED_FILE		(1U << 12)
 #define IORING_FEAT_REG_REG_RING	(1U << 13)
+#define IORING_FEAT_CQ_BATCH_WAIT	(1U << 14)
 
 /*
  * io_uring_register(2) opcodes and arguments
@@ -537,6 +555,15 @@ enum {
 	/* register a range of fixed file slots for automatic slot allocation */
 	IORING_REGISTER_FILE_ALLOC_RANGE	= 25,
 
+	/* grow the registered file table to nr_args slots */
+	IORING_REGISTER_FILES_GROW		= 26,
+
+	/* set the share of a shared SQPOLL thread this ring gets */
+	IORING_REGISTER_SQPOLL_WEIGHT		= 27,
+
+	/* enable (nr_args == 1) or disable per-opcode latency stats */
+	IORING_REGISTER_OP_STATS		= 28,
+
 	/* this goes last */
 	IORING_REGISTER_LAST,
 
@@ -617,6 +644,17 @@ struct io_uring_restriction {
 	__u32 resv2[3];
 };
 
+/*
+ * Segment descriptor for IORING_OP_READV_FIXED and IORING_OP_WRITEV_FIXED.
+ * sqe->addr points to an array of these, sqe->len holds the number of entries.
+ */
+struct io_uring_fixed_vec {
+	__u64	offset;		/* offset into the registered buffer */
+	__u32	len;
+	__u16	buf_index;	/* index of the registered buffer */
+	__u16	resv;
+};
+
 struct io_uring_buf {
 	__u64	addr;
 	__u32	len;
@@ -649,9 +687,18 @@ struct io_uring_buf_ring {
  *			mmap(2) with the offset set as:
  *			IORING_OFF_PBUF_RING | (bgid << IORING_OFF_PBUF_SHIFT)
  *			to get a virtual mapping for the ring.
+ * IOU_PBUF_RING_INC:	If set, buffers in the ring may be consumed
+ *			incrementally by multishot receive. Rather than
+ *			retiring a buffer per completion, the kernel advances
+ *			the addr and len of the buffer entry by the amount
+ *			received and keeps filling it, posting
+ *			IORING_CQE_F_BUF_MORE until it is used up. This lets a
+ *			few large buffers absorb a stream of receives with the
+ *			data laid out back to back.
  */
 enum {
 	IOU_PBUF_RING_MMAP	= 1,
+	IOU_PBUF_RING_INC	= 2,
 };
 
 /* argument for IORING_(UN)REGISTER_PBUF_RING */
@@ -682,10 +729,17 @@ enum {
 	IORING_RESTRICTION_LAST
 };
 
+/*
+ * If batch_wait_usec is set, min_complete passed to io_uring_enter(2) is
+ * treated as a target batch size rather than a hard minimum: the waiter
+ * returns once min_complete CQEs are available, or once batch_wait_usec
+ * has elapsed and at least one CQE is available, whichever comes first.
+ * The ts timeout, if any, still bounds the total wait.
+ */
 struct io_uring_getevents_arg {
 	__u64	sigmask;
 	__u32	sigmask_sz;
-	__u32	pad;
+	__u32	batch_wait_usec;
 	__u64	ts;
 };
 
@@ -563,6 +563,27 @@ struct kvm_coalesced_mmio_ring {
 	((PAGE_SIZE - sizeof(struct kvm_coalesced_mmio_ring)) / \
 	 sizeof(struct kvm_coalesced_mmio))
 
+/*
+ * KVM_CAP_COALESCED_MMIO_RING gives each vCPU its own coalesced MMIO/PIO
+ * ring, of args[0] bytes (a power of two, at least a page), mapped at
+ * KVM_COALESCED_MMIO_RING_PAGE_OFFSET of the vCPU fd.  Writes of a vCPU
+ * to a coalesced zone go to its ring, without any locking; the layout is
+ * the one of the per-VM ring, with (size - sizeof(struct
+ * kvm_coalesced_mmio_ring)) / sizeof(struct kvm_coalesced_mmio) entries.
+ * If args[1] is an eventfd (or -1 for none), it is signaled whenever a
+ * ring fills up to args[2] entries.  Must be enabled before creating
+ * vCPUs.
+ */
+#define KVM_COALESCED_MMIO_RING_MAX_SIZE	(64 * 4096)
+
+/*
+ * Arch needs to define the macro to support per-vCPU coalesced MMIO
+ * rings, as the starting page offset of the ring in the vCPU mapping.
+ */
+#ifndef KVM_COALESCED_MMIO_RING_PAGE_OFFSET
+#define KVM_COALESCED_MMIO_RING_PAGE_OFFSET 0
+#endif
+
 /* for KVM_TRANSLATE */
 struct kvm_translation {
 	/* in */
@@ -1192,6 +1213,8 @@ struct kvm_ppc_resize_hpt {
 #define KVM_CAP_COUNTER_OFFSET 227
 #define KVM_CAP_ARM_EAGER_SPLIT_CHUNK_SIZE 228
 #define KVM_CAP_ARM_SUPPORTED_BLOCK_SIZES 229
+#define KVM_CAP_DIRTY_LOG_RING_RESET_LIST 230
+#define KVM_CAP_COALESCED_MMIO_RING 231
 
 #ifdef KVM_CAP_IRQ_ROUTING
 
@@ -1774,6 +1797,8 @@ struct kvm_pv_cmd {
 
 /* Available with KVM_CAP_DIRTY_LOG_RING */
 #define KVM_RESET_DIRTY_RINGS		_IO(KVMIO, 0xc7)
+/* Available with KVM_CAP_DIRTY_LOG_RING_RESET_LIST */
+#define KVM_RESET_DIRTY_RINGS_LIST	_IOW(KVMIO, 0xd2, struct kvm_dirty_ring_reset)
 
 /* Per-VM Xen attributes */
 #define KVM_XEN_HVM_GET_ATTR	_IOWR(KVMIO, 0xc8, struct kvm_xen_hvm_attr)
@@ -2249,4 +2274,16 @@ struct kvm_s390_zpci_op {
 /* flags for kvm_s390_zpci_op->u.reg_aen.flags */
 #define KVM_S390_ZPCIOP_REGAEN_HOST    (1 << 0)
 
+/*
+ * For KVM_RESET_DIRTY_RINGS_LIST: reset the dirty rings of the vCPUs in
+ * vcpu_ids only. Unlike KVM_RESET_DIRTY_RINGS, this doesn't serialize
+ * against other resets of disjoint rings, so the harvesting of a large VM
+ * can be spread over several threads.
+ */
+struct kvm_dirty_ring_reset {
+	__u32 nr;
+	__u32 flags;
+	__u32 vcpu_ids[];
+};
+
 #endif /* __LINUX_KVM_H */
@@ -33,6 +33,21 @@ struct mq_attr {
 	__kernel_long_t	__reserved[4];	/* ignored for input, zeroed for output */
 };
 
+/* for mq_timedreceivev() */
+struct mq_msgv {
+	__u64		msg_ptr;	/* receive buffer			*/
+	__u64		msg_len;	/* in: buffer size, out: message size	*/
+	__u32		msg_prio;	/* out: message priority		*/
+	__u32		__reserved;
+};
+
+/*
+ * mq_timedreceivev() flag: if the call has to wait, pin the first buffer so
+ * that a sender can copy a large message straight into it. The buffer must be
+ * page aligned and the queue's mq_msgsize at least a page.
+ */
+#define MQ_RECV_DIRECT	0x1
+
 /*
  * SIGEV_THREAD implementation:
  * SIGEV_THREAD must be implemented in user space. If SIGEV_THREAD is passed
@@ -64,6 +64,9 @@ enum {
 #define NBD_CFLAG_DISCONNECT_ON_CLOSE (1 << 1) /* disconnect the nbd device on
 						*  close by last opener.
 						*/
+#define NBD_CFLAG_STRUCTURED_REPLY (1 << 2) /* structured replies were
+					     * negotiated with the server.
+					     */
 
 /* userspace doesn't need the nbd_device structure */
 
@@ -71,8 +74,8 @@ enum {
 
 #define NBD_REQUEST_MAGIC 0x25609513
 #define NBD_REPLY_MAGIC 0x67446698
+#define NBD_STRUCTURED_REPLY_MAGIC 0x668e33ef
 /* Do *not* use magics: 0x12560953 0x96744668. */
-/* magic 0x668e33ef for structured reply not supported by kernel yet */
 
 /*
  * This is the packet used for communication between client and
@@ -101,4 +104,27 @@ struct nbd_reply {
 		char handle[8];	/* older spelling of cookie		*/
 	};
 };
+
+/* values for the flags field of structured reply chunks */
+#define NBD_REPLY_FLAG_DONE	(1 << 0) /* last chunk of the reply */
+
+/* structured reply chunk types */
+#define NBD_REPLY_TYPE_NONE		0
+#define NBD_REPLY_TYPE_OFFSET_DATA	1
+#define NBD_REPLY_TYPE_OFFSET_HOLE	2
+#define NBD_REPLY_TYPE_ERROR		((1 << 15) + 1)
+#define NBD_REPLY_TYPE_ERROR_OFFSET	((1 << 15) + 2)
+#define NBD_REPLY_TYPE_IS_ERR(type)	((type) & (1 << 15))
+
+/*
+ * Header of a structured reply chunk, followed by length bytes of payload.
+ * Only sent if structured replies were negotiated.
+ */
+struct nbd_structured_reply {
+	__be32 magic;		/* NBD_STRUCTURED_REPLY_MAGIC	*/
+	__be16 flags;		/* NBD_REPLY_FLAG_*		*/
+	__be16 type;		/* NBD_REPLY_TYPE_*		*/
+	__be64 cookie;		/* Opaque identifier from request	*/
+	__be32 length;		/* Length of the payload	*/
+} __attribute__((packed));
 #endif /* _UAPILINUX_NBD_H */
@@ -78,6 +78,9 @@ enum ovs_datapath_cmd {
  * datapath. Always present in notifications.
  * @OVS_DP_ATTR_IFINDEX: Interface index for a new datapath netdev. Only
  * valid for %OVS_DP_CMD_NEW requests.
+ * @OVS_DP_ATTR_UPCALL_RATE: Maximum number of flow miss upcalls per second
+ * and CPU, misses above it are dropped and counted as lost.  Zero, the
+ * default, for no limit.
  *
  * These attributes follow the &struct ovs_header within the Generic Netlink
  * payload for %OVS_DP_* commands.
@@ -95,6 +98,7 @@ enum ovs_datapath_attr {
 				     * per-cpu dispatch mode
 				     */
 	OVS_DP_ATTR_IFINDEX,
+	OVS_DP_ATTR_UPCALL_RATE,	/* u32 miss upcalls per second per CPU */
 	__OVS_DP_ATTR_MAX
 };
 
@@ -138,6 +142,9 @@ struct ovs_vport_stats {
 /* Allow per-cpu dispatch of upcalls */
 #define OVS_DP_F_DISPATCH_UPCALL_PER_CPU	(1 << 3)
 
+/* Allow datapath to drop flow misses of a flow key which just had a few */
+#define OVS_DP_F_UPCALL_DEDUP	(1 << 4)
+
 /* Fixed logical ports. */
 #define OVSP_LOCAL      ((__u32)0)
 
@@ -606,6 +613,9 @@ struct ovs_nsh_key_md1 {
  * @OVS_FLOW_ATTR_UFID_FLAGS: A 32-bit value of OR'd %OVS_UFID_F_*
  * flags that provide alternative semantics for flow installation and
  * retrieval. Optional for all requests.
+ * @OVS_FLOW_ATTR_MASK_HITS: A 64-bit integer giving the number of lookups
+ * that found a flow with the same mask as this flow, updated periodically.
+ * Present in notifications if nonzero.  Ignored in requests.
  *
  * These attributes follow the &struct ovs_header within the Generic Netlink
  * payload for %OVS_FLOW_* commands.
@@ -624,6 +634,7 @@ enum ovs_flow_attr {
 	OVS_FLOW_ATTR_UFID,      /* Variable length unique flow identifier. */
 	OVS_FLOW_ATTR_UFID_FLAGS,/* u32 of OVS_UFID_F_*. */
 	OVS_FLOW_ATTR_PAD,
+	OVS_FLOW_ATTR_MASK_HITS, /* u64 lookups hitting the flow's mask. */
 	__OVS_FLOW_ATTR_MAX
 };
 
@@ -5,8 +5,65 @@
 
 #include <linux/types.h>
 #include <linux/fcntl.h>
+#include <linux/ioctl.h>
 
 /* Flags for pidfd_open().  */
 #define PIDFD_NONBLOCK O_NONBLOCK
 
+/*
+ * Fields of struct pidfd_info. Userspace sets the ones it wants in
+ * @mask, the kernel clears the ones it could not provide.
+ */
+#define PIDFD_INFO_PID		(1ULL << 0) /* pid, tgid, ppid */
+#define PIDFD_INFO_CREDS	(1ULL << 1) /* ruid ... fsgid */
+#define PIDFD_INFO_CGROUPID	(1ULL << 2) /* cgroupid */
+#define PIDFD_INFO_STAT		(1ULL << 3) /* state ... start_time */
+#define PIDFD_INFO_MEM		(1ULL << 4) /* vsize, rss */
+#define PIDFD_INFO_IO		(1ULL << 5) /* rchar ... cancelled_write_bytes */
+
+#define PIDFD_INFO_SIZE_VER0	184 /* sizeof first published struct */
+
+/*
+ * Status of the thread group of a pidfd, as in /proc/<pid>/{status,stat,
+ * statm,io}. Ids are translated into the pid and user namespaces of the
+ * caller, times are in nanoseconds and sizes in bytes. The IO counters
+ * require the same ptrace access as /proc/<pid>/io.
+ */
+struct pidfd_info {
+	__u64 mask;
+	__u64 cgroupid;
+	__u32 pid;
+	__u32 tgid;
+	__u32 ppid;
+	__u32 ruid;
+	__u32 rgid;
+	__u32 euid;
+	__u32 egid;
+	__u32 suid;
+	__u32 sgid;
+	__u32 fsuid;
+	__u32 fsgid;
+	__u32 state;
+	__u32 nr_threads;
+	__u32 __spare0;
+	__u64 utime;
+	__u64 stime;
+	__u64 min_flt;
+	__u64 maj_flt;
+	__u64 start_time;
+	__u64 vsize;
+	__u64 rss;
+	__u64 rchar;
+	__u64 wchar;
+	__u64 syscr;
+	__u64 syscw;
+	__u64 read_bytes;
+	__u64 write_bytes;
+	__u64 cancelled_write_bytes;
+};
+
+#define PIDFD_IOCTL_MAGIC	0xFF
+
+#define PIDFD_GET_INFO		_IOWR(PIDFD_IOCTL_MAGIC, 11, struct pidfd_info)
+
 #endif /* _UAPI_LINUX_PIDFD_H */
@@ -267,7 +267,9 @@ struct prctl_mm_map {
 # define PR_SCHED_CORE_CREATE		1 /* create unique core_sched cookie */
 # define PR_SCHED_CORE_SHARE_TO		2 /* push core_sched cookie to pid */
 # define PR_SCHED_CORE_SHARE_FROM	3 /* pull core_sched cookie to pid */
-# define PR_SCHED_CORE_MAX		4
+# define PR_SCHED_CORE_CREATE_COMPAT	4 /* create cookie compatible with current's */
+# define PR_SCHED_CORE_GET_FORCEIDLE	5 /* get forced idle ns charged to cookie */
+# define PR_SCHED_CORE_MAX		6
 # define PR_SCHED_CORE_SCOPE_THREAD		0
 # define PR_SCHED_CORE_SCOPE_THREAD_GROUP	1
 # define PR_SCHED_CORE_SCOPE_PROCESS_GROUP	2
@@ -305,4 +307,9 @@ struct prctl_mm_map {
 # define PR_RISCV_V_VSTATE_CTRL_NEXT_MASK	0xc
 # define PR_RISCV_V_VSTATE_CTRL_MASK		0x1f
 
+/* Wakeup latency (usecs) the CPUs running the task have to provide */
+#define PR_SET_WAKEUP_LATENCY		71
+#define PR_GET_WAKEUP_LATENCY		72
+# define PR_WAKEUP_LATENCY_NONE		0x7fffffff
+
 #endif /* _LINUX_PRCTL_H */
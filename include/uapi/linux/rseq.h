@@ -20,6 +20,12 @@ enum rseq_cpu_id_state {
 
 enum rseq_flags {
 	RSEQ_FLAG_UNREGISTER = (1 << 0),
+	RSEQ_FLAG_SLICE_EXT = (1 << 1),
+};
+
+enum rseq_slice_ctrl {
+	RSEQ_SLICE_EXT_REQUEST	= (1U << 0),
+	RSEQ_SLICE_EXT_GRANTED	= (1U << 1),
 };
 
 enum rseq_cs_flags_bit {
@@ -148,6 +154,45 @@ struct rseq {
 	 */
 	__u32 mm_cid;
 
+	/*
+	 * Restartable sequences slice_ctrl field. Only used if the thread
+	 * registered with RSEQ_FLAG_SLICE_EXT.
+	 * Aligned on 32-bit.
+	 *
+	 * User-space sets RSEQ_SLICE_EXT_REQUEST while it executes a short
+	 * critical section (e.g. holding a user-space lock). If the kernel
+	 * wants to preempt the thread while the request is set, it may
+	 * instead let it run for a few more microseconds: it then replaces
+	 * RSEQ_SLICE_EXT_REQUEST with RSEQ_SLICE_EXT_GRANTED. At the end of
+	 * the critical section, user-space clears RSEQ_SLICE_EXT_REQUEST
+	 * and, if RSEQ_SLICE_EXT_GRANTED is set, gives the CPU back with
+	 * sched_yield(). A thread which doesn't is preempted once the
+	 * extension expires. The kernel clears RSEQ_SLICE_EXT_GRANTED after
+	 * the thread has been scheduled.
+	 */
+	__u32 slice_ctrl;
+
+	/*
+	 * Restartable sequences sched_runtime and sched_stamp fields.
+	 * Updated by the kernel whenever the thread returns to user-space
+	 * after having been scheduled in. Read by user-space with
+	 * single-copy atomicity semantics. These fields should only be
+	 * read by the thread which registered this data structure.
+	 * Aligned on 64-bit.
+	 *
+	 * sched_runtime is the CPU time consumed by the thread (in
+	 * nanoseconds, as reported by CLOCK_THREAD_CPUTIME_ID) at time
+	 * sched_stamp (CLOCK_MONOTONIC in nanoseconds). As the thread has
+	 * not been scheduled out since, its current CPU time is:
+	 *
+	 *   sched_runtime + (clock_gettime(CLOCK_MONOTONIC) - sched_stamp)
+	 *
+	 * where the clock can be read through the vDSO. Re-read
+	 * sched_stamp after reading the clock and retry if it changed.
+	 */
+	__u64 sched_runtime;
+	__u64 sched_stamp;
+
 	/*
 	 * Flexible array member at end of structure, after last feature field.
 	 */
@@ -219,10 +219,20 @@ enum {
 	SMC_NLA_STATS_RMB_REUSE_CNT,		/* u64 */
 	SMC_NLA_STATS_RMB_ALLOC_CNT,		/* u64 */
 	SMC_NLA_STATS_RMB_DGRADE_CNT,		/* u64 */
+	SMC_NLA_STATS_RMB_POOL_CNT,		/* u64 */
 	__SMC_NLA_STATS_RMB_MAX,
 	SMC_NLA_STATS_RMB_MAX = __SMC_NLA_STATS_RMB_MAX - 1
 };
 
+/* SMC_NLA_STATS_T_CLNT(SRV)_CLC(LINK)_LAT nested attributes */
+enum {
+	SMC_NLA_STATS_HS_LAT_PAD,
+	SMC_NLA_STATS_HS_LAT_SUM_US,	/* u64 */
+	SMC_NLA_STATS_HS_LAT_CNT,	/* u64 */
+	__SMC_NLA_STATS_HS_LAT_MAX,
+	SMC_NLA_STATS_HS_LAT_MAX = __SMC_NLA_STATS_HS_LAT_MAX - 1
+};
+
 /* SMC_NLA_STATS_SMCD_TECH and _SMCR_TECH nested attributes */
 enum {
 	SMC_NLA_STATS_T_PAD,
@@ -245,6 +255,10 @@ enum {
 	SMC_NLA_STATS_T_TX_BYTES,	/* u64 */
 	SMC_NLA_STATS_T_RX_CNT,		/* u64 */
 	SMC_NLA_STATS_T_TX_CNT,		/* u64 */
+	SMC_NLA_STATS_T_CLNT_CLC_LAT,	/* nest */
+	SMC_NLA_STATS_T_CLNT_LINK_LAT,	/* nest */
+	SMC_NLA_STATS_T_SRV_CLC_LAT,	/* nest */
+	SMC_NLA_STATS_T_SRV_LINK_LAT,	/* nest */
 	__SMC_NLA_STATS_T_MAX,
 	SMC_NLA_STATS_T_MAX = __SMC_NLA_STATS_T_MAX - 1
 };
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_SYSCALL_BATCH_H
+#define _UAPI_LINUX_SYSCALL_BATCH_H
+
+#include <linux/types.h>
+
+/**
+ * struct syscall_batch_entry - one system call of a syscall_batch() vector
+ * @nr:		Native number of the system call
+ * @flags:	Must be zero
+ * @args:	Arguments of the system call
+ * @ret:	Return value of the system call, written by the kernel
+ */
+struct syscall_batch_entry {
+	__u32	nr;
+	__u32	flags;
+	__u64	args[6];
+	__s64	ret;
+};
+
+/* Stop at the first entry which fails */
+#define SYSCALL_BATCH_STOP_ON_ERROR	(1U << 0)
+
+/* Maximum number of entries per syscall_batch() call */
+#define SYSCALL_BATCH_MAX		1024
+
+#endif /* _UAPI_LINUX_SYSCALL_BATCH_H */
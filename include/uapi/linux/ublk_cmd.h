@@ -75,6 +75,29 @@
  *
  *      It is only used if ublksrv set UBLK_F_NEED_GET_DATA flag
  *      while starting a ublk device.
+ *
+ * REGISTER_IO_BUF: only used with UBLK_F_SUPPORT_ZERO_COPY, registers the
+ *      pages of the request identified by q_id and tag as fixed buffer
+ *      with index 'addr' into the io_uring the command is issued on. The
+ *      slot has to be empty, e.g. reserved by registering a sparse buffer
+ *      table. The buffer is addressed by offset into the request, and can
+ *      only be read from for WRITE requests and written to for READ
+ *      requests.
+ *
+ * UNREGISTER_IO_BUF: empties buffer slot 'addr' again. The request can't
+ *      be completed before all of its buffers are unregistered and the
+ *      io_uring requests using them are done.
+ *
+ * FETCH_IO_CMDS: only used with UBLK_F_BATCH_IO, replaces the per-tag
+ *      FETCH_REQ and NEED_GET_DATA commands, see struct ublk_batch_io. A
+ *      single command is outstanding per queue; it completes as soon as
+ *      requests arrive, with the number of tags stored to the tag array.
+ *      The first one also makes the queue ready.
+ *
+ * COMMIT_IO_CMDS: only used with UBLK_F_BATCH_IO, commits the results of
+ *      an array of struct ublk_batch_commit_elem; the committed tags are
+ *      fetched again through FETCH_IO_CMDS. Completes right away with the
+ *      number of committed elements, a negative error if the first failed.
  */
 
 /*
@@ -92,6 +115,14 @@
 	_IOWR('u', UBLK_IO_COMMIT_AND_FETCH_REQ, struct ublksrv_io_cmd)
 #define	UBLK_U_IO_NEED_GET_DATA		\
 	_IOWR('u', UBLK_IO_NEED_GET_DATA, struct ublksrv_io_cmd)
+#define	UBLK_U_IO_REGISTER_IO_BUF	\
+	_IOWR('u', 0x23, struct ublksrv_io_cmd)
+#define	UBLK_U_IO_UNREGISTER_IO_BUF	\
+	_IOWR('u', 0x24, struct ublksrv_io_cmd)
+#define	UBLK_U_IO_FETCH_IO_CMDS		\
+	_IOWR('u', 0x25, struct ublk_batch_io)
+#define	UBLK_U_IO_COMMIT_IO_CMDS	\
+	_IOWR('u', 0x26, struct ublk_batch_io)
 
 /* only ABORT means that no re-fetch */
 #define UBLK_IO_RES_OK			0
@@ -125,8 +156,9 @@
 #define UBLKSRV_IO_BUF_TOTAL_SIZE	(1ULL << UBLKSRV_IO_BUF_TOTAL_BITS)
 
 /*
- * zero copy requires 4k block size, and can remap ublk driver's io
- * request into ublksrv's vm space
+ * zero copy: the ublk server doesn't provide io buffers, it registers the
+ * request pages into its io_uring with UBLK_U_IO_REGISTER_IO_BUF and
+ * submits io against them as fixed buffer instead
  */
 #define UBLK_F_SUPPORT_ZERO_COPY	(1ULL << 0)
 
@@ -176,6 +208,14 @@
 /* Copy between request and user buffer by pread()/pwrite() */
 #define UBLK_F_USER_COPY	(1UL << 7)
 
+/*
+ * Fetch and commit io commands in batches with UBLK_U_IO_FETCH_IO_CMDS and
+ * UBLK_U_IO_COMMIT_IO_CMDS instead of one uring_cmd per io. Requires
+ * UBLK_F_USER_COPY or UBLK_F_SUPPORT_ZERO_COPY, and isn't supported with
+ * UBLK_F_USER_RECOVERY
+ */
+#define UBLK_F_BATCH_IO		(1ULL << 8)
+
 /* device state */
 #define UBLK_S_DEV_DEAD	0
 #define UBLK_S_DEV_LIVE	1
@@ -291,6 +331,32 @@ struct ublksrv_io_cmd {
 	__u64	addr;
 };
 
+/* shipped via sqe->cmd of UBLK_U_IO_FETCH_IO_CMDS/UBLK_U_IO_COMMIT_IO_CMDS */
+struct ublk_batch_io {
+	__u16	q_id;
+	__u16	resv;
+
+	/*
+	 * number of elements: FETCH_IO_CMDS needs room for the queue depth,
+	 * COMMIT_IO_CMDS's elements are all committed
+	 */
+	__u32	nr_elem;
+
+	/*
+	 * userspace address of the elements: __u16 tags filled in by
+	 * FETCH_IO_CMDS, struct ublk_batch_commit_elem for COMMIT_IO_CMDS
+	 */
+	__u64	elem;
+};
+
+struct ublk_batch_commit_elem {
+	__u16	tag;
+	__u16	resv;
+
+	/* io result, same as ublksrv_io_cmd.result of COMMIT_AND_FETCH_REQ */
+	__s32	result;
+};
+
 struct ublk_param_basic {
 #define UBLK_ATTR_READ_ONLY            (1 << 0)
 #define UBLK_ATTR_ROTATIONAL           (1 << 1)
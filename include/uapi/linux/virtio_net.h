@@ -56,6 +56,8 @@
 #define VIRTIO_NET_F_MQ	22	/* Device supports Receive Flow
 					 * Steering */
 #define VIRTIO_NET_F_CTRL_MAC_ADDR 23	/* Set MAC address */
+#define VIRTIO_NET_F_VQ_NOTF_COAL 52	/* Device supports virtqueue
+					 * notification coalescing */
 #define VIRTIO_NET_F_NOTF_COAL	53	/* Device supports notifications coalescing */
 #define VIRTIO_NET_F_GUEST_USO4	54	/* Guest can handle USOv4 in. */
 #define VIRTIO_NET_F_GUEST_USO6	55	/* Guest can handle USOv6 in. */
@@ -392,4 +394,24 @@ struct virtio_net_ctrl_coal_rx {
 
 #define VIRTIO_NET_CTRL_NOTF_COAL_RX_SET		1
 
+/*
+ * Set the max-usecs/max-packets parameters of a single virtqueue.
+ *
+ * Available with the VIRTIO_NET_F_VQ_NOTF_COAL feature bit.
+ */
+struct virtio_net_ctrl_coal {
+	/* Maximum number of packets to handle before a notification */
+	__le32 max_packets;
+	/* Maximum number of usecs to delay a notification */
+	__le32 max_usecs;
+};
+
+struct virtio_net_ctrl_coal_vq {
+	__le16 vqn;
+	__le16 reserved;
+	struct virtio_net_ctrl_coal coal;
+};
+
+#define VIRTIO_NET_CTRL_NOTF_COAL_VQ_SET		2
+
 #endif /* _UAPI_LINUX_VIRTIO_NET_H */
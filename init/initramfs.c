@@ -19,6 +19,13 @@
 #include <linux/task_work.h>
 #include <linux/umh.h>
 
+static bool __initdata initramfs_async = true;
+static int __init initramfs_async_setup(char *str)
+{
+	return kstrtobool(str, &initramfs_async) == 0;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
 static __initdata bool csum_present;
 static __initdata u32 io_csum;
 
@@ -38,13 +45,6 @@ static ssize_t __init xwrite(struct file *file, const unsigned char *p,
 		} else if (rv == 0)
 			break;
 
-		if (csum_present) {
-			ssize_t i;
-
-			for (i = 0; i < rv; i++)
-				io_csum += p[i];
-		}
-
 		p += rv;
 		out += rv;
 		count -= rv;
@@ -354,6 +354,92 @@ static int __init maybe_link(void)
 static __initdata struct file *wfile;
 static __initdata loff_t wfile_pos;
 
+/*
+ * Large files aren't written while they are unpacked: their data is
+ * collected in a buffer and an async worker writes it out, so that filling
+ * the page cache overlaps with decompressing the files that follow.
+ */
+#define ASYNC_WRITE_MIN		(128 << 10)
+#define ASYNC_WRITE_MAX_BYTES	(64 << 20)	/* collected, not yet written */
+
+struct async_write {
+	struct file *file;
+	char *buf;
+	size_t len;
+	time64_t mtime;
+};
+
+static ASYNC_DOMAIN_EXCLUSIVE(initramfs_write_domain);
+static atomic_long_t async_write_bytes;
+static bool async_write_failed;
+static __initdata struct async_write *wdata;
+
+static void __init async_write_file(void *data, async_cookie_t cookie)
+{
+	struct async_write *aw = data;
+	loff_t pos = 0;
+
+	if (xwrite(aw->file, aw->buf, aw->len, &pos) != aw->len)
+		WRITE_ONCE(async_write_failed, true);
+
+	do_utime_path(&aw->file->f_path, aw->mtime);
+	fput(aw->file);
+	kvfree(aw->buf);
+	atomic_long_sub(aw->len, &async_write_bytes);
+	kfree(aw);
+}
+
+static void __init start_async_write(void)
+{
+	struct async_write *aw;
+
+	if (!initramfs_async || body_len < ASYNC_WRITE_MIN)
+		return;
+
+	if (atomic_long_read(&async_write_bytes) + body_len >
+	    ASYNC_WRITE_MAX_BYTES)
+		async_synchronize_full_domain(&initramfs_write_domain);
+
+	aw = kmalloc(sizeof(*aw), GFP_KERNEL);
+	if (!aw)
+		return;
+	aw->buf = kvmalloc(body_len, GFP_KERNEL | __GFP_NOWARN);
+	if (!aw->buf) {
+		/* just write it synchronously */
+		kfree(aw);
+		return;
+	}
+	aw->file = wfile;
+	aw->len = body_len;
+	atomic_long_add(body_len, &async_write_bytes);
+	wdata = aw;
+}
+
+static void __init finish_async_write(void)
+{
+	wdata->mtime = mtime;
+	async_schedule_domain(async_write_file, wdata, &initramfs_write_domain);
+	wdata = NULL;
+}
+
+static bool __init write_chunk(unsigned long count)
+{
+	if (csum_present) {
+		unsigned long i;
+
+		for (i = 0; i < count; i++)
+			io_csum += (unsigned char)victim[i];
+	}
+
+	if (wdata) {
+		memcpy(wdata->buf + wfile_pos, victim, count);
+		wfile_pos += count;
+		return true;
+	}
+
+	return xwrite(wfile, victim, count, &wfile_pos) == count;
+}
+
 static int __init do_name(void)
 {
 	state = SkipIt;
@@ -379,6 +465,7 @@ static int __init do_name(void)
 			vfs_fchmod(wfile, mode);
 			if (body_len)
 				vfs_truncate(&wfile->f_path, body_len);
+			start_async_write();
 			state = CopyFile;
 		}
 	} else if (S_ISDIR(mode)) {
@@ -401,18 +488,22 @@ static int __init do_name(void)
 static int __init do_copy(void)
 {
 	if (byte_count >= body_len) {
-		if (xwrite(wfile, victim, body_len, &wfile_pos) != body_len)
+		if (!write_chunk(body_len))
 			error("write error");
 
-		do_utime_path(&wfile->f_path, mtime);
-		fput(wfile);
+		if (wdata) {
+			finish_async_write();
+		} else {
+			do_utime_path(&wfile->f_path, mtime);
+			fput(wfile);
+		}
 		if (csum_present && io_csum != hdr_csum)
 			error("bad data checksum");
 		eat(body_len);
 		state = SkipIt;
 		return 0;
 	} else {
-		if (xwrite(wfile, victim, byte_count, &wfile_pos) != byte_count)
+		if (!write_chunk(byte_count))
 			error("write error");
 		body_len -= byte_count;
 		eat(byte_count);
@@ -535,6 +626,9 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 		buf += my_inptr;
 		len -= my_inptr;
 	}
+	async_synchronize_full_domain(&initramfs_write_domain);
+	if (READ_ONCE(async_write_failed))
+		error("write error");
 	dir_utime();
 	kfree(name_buf);
 	kfree(symlink_buf);
@@ -562,13 +656,6 @@ static int __init keepinitrd_setup(char *__unused)
 __setup("keepinitrd", keepinitrd_setup);
 #endif
 
-static bool __initdata initramfs_async = true;
-static int __init initramfs_async_setup(char *str)
-{
-	return kstrtobool(str, &initramfs_async) == 0;
-}
-__setup("initramfs_async=", initramfs_async_setup);
-
 extern char __initramfs_start[];
 extern unsigned long __initramfs_size;
 #include <linux/initrd.h>
@@ -1175,6 +1175,10 @@ trace_initcall_start_cb(void *data, initcall_t fn)
 {
 	ktime_t *calltime = data;
 
+	/* Async initcalls are timed by do_async_initcall() */
+	if (current_is_async())
+		return;
+
 	printk(KERN_DEBUG "calling  %pS @ %i\n", fn, task_pid_nr(current));
 	*calltime = ktime_get();
 }
@@ -1184,6 +1188,9 @@ trace_initcall_finish_cb(void *data, initcall_t fn, int ret)
 {
 	ktime_t rettime, *calltime = data;
 
+	if (current_is_async())
+		return;
+
 	rettime = ktime_get();
 	printk(KERN_DEBUG "initcall %pS returned %d after %lld usecs\n",
 		 fn, ret, (unsigned long long)ktime_us_delta(rettime, *calltime));
@@ -1273,6 +1280,63 @@ static const char *initcall_level_names[] __initdata = {
 	"late",
 };
 
+static initcall_entry_t *initcall_async_ends[] __initdata = {
+	__initcall0a_end,
+	__initcall1a_end,
+	__initcall2a_end,
+	__initcall3a_end,
+	__initcall4a_end,
+	__initcall5a_end,
+	__initcall6a_end,
+	__initcall7a_end,
+};
+
+static initcall_entry_t *initcall_sync_starts[] __initdata = {
+	__initcall0s_start,
+	__initcall1s_start,
+	__initcall2s_start,
+	__initcall3s_start,
+	__initcall4s_start,
+	__initcall5s_start,
+	__initcall6s_start,
+	__initcall7s_start,
+};
+
+static bool initcall_async = true;
+core_param(initcall_async, initcall_async, bool, 0444);
+
+static ASYNC_DOMAIN(initcall_domain);
+static DEFINE_SPINLOCK(initcall_async_lock);
+static initcall_t initcall_async_longest __initdata;
+static s64 initcall_async_longest_us __initdata;
+
+static void __init do_async_initcall(void *data, async_cookie_t cookie)
+{
+	initcall_t fn = (initcall_t)data;
+	ktime_t calltime;
+	s64 delta;
+	int ret;
+
+	if (initcall_debug)
+		printk(KERN_DEBUG "calling  %pS @ %i (async)\n", fn,
+		       task_pid_nr(current));
+
+	calltime = ktime_get();
+	ret = do_one_initcall(fn);
+	delta = ktime_us_delta(ktime_get(), calltime);
+
+	if (initcall_debug)
+		printk(KERN_DEBUG "initcall %pS returned %d after %lld usecs (async)\n",
+		       fn, ret, delta);
+
+	spin_lock(&initcall_async_lock);
+	if (delta > initcall_async_longest_us) {
+		initcall_async_longest_us = delta;
+		initcall_async_longest = fn;
+	}
+	spin_unlock(&initcall_async_lock);
+}
+
 static int __init ignore_unknown_bootoption(char *param, char *val,
 			       const char *unused, void *arg)
 {
@@ -1282,6 +1346,7 @@ static int __init ignore_unknown_bootoption(char *param, char *val,
 static void __init do_initcall_level(int level, char *command_line)
 {
 	initcall_entry_t *fn;
+	ktime_t start, serial;
 
 	parse_args(initcall_level_names[level],
 		   command_line, __start___param,
@@ -1290,7 +1355,36 @@ static void __init do_initcall_level(int level, char *command_line)
 		   NULL, ignore_unknown_bootoption);
 
 	trace_initcall_level(initcall_level_names[level]);
-	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
+	start = ktime_get();
+	initcall_async_longest = NULL;
+	initcall_async_longest_us = 0;
+
+	for (fn = initcall_levels[level]; fn < initcall_async_ends[level]; fn++) {
+		if (initcall_async)
+			async_schedule_domain(do_async_initcall,
+					      (void *)initcall_from_entry(fn),
+					      &initcall_domain);
+		else
+			do_one_initcall(initcall_from_entry(fn));
+	}
+	for (; fn < initcall_sync_starts[level]; fn++)
+		do_one_initcall(initcall_from_entry(fn));
+	serial = ktime_get();
+
+	async_synchronize_full_domain(&initcall_domain);
+
+	/*
+	 * The level takes as long as the longer of its sequential part and
+	 * its longest async initcall, tell which one that was.
+	 */
+	if (initcall_debug && initcall_async_longest)
+		printk(KERN_DEBUG "initcall level %s: sequential %lld usecs, longest async %pS %lld usecs, total %lld usecs\n",
+		       initcall_level_names[level],
+		       ktime_us_delta(serial, start), initcall_async_longest,
+		       initcall_async_longest_us,
+		       ktime_us_delta(ktime_get(), start));
+
+	for (; fn < initcall_levels[level+1]; fn++)
 		do_one_initcall(initcall_from_entry(fn));
 }
 
@@ -1539,6 +1633,7 @@ static noinline void __init kernel_init_freeable(void)
 
 	smp_init();
 	sched_init_smp();
+	workqueue_init_topology();
 
 	padata_init();
 	page_alloc_init_late();
@@ -14,6 +14,7 @@
 #include "fdinfo.h"
 #include "cancel.h"
 #include "rsrc.h"
+#include "tctx.h"
 
 #ifdef CONFIG_PROC_FS
 static __cold int io_uring_show_cred(struct seq_file *m, unsigned int id,
@@ -169,6 +170,20 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 			io_uring_show_cred(m, index, cred);
 	}
 
+	if (has_lock) {
+		struct io_tctx_node *node;
+
+		seq_puts(m, "IoWq:\n");
+		list_for_each_entry(node, &ctx->tctx_list, ctx_node) {
+			struct io_uring_task *tctx = node->task->io_uring;
+
+			if (!tctx || !tctx->io_wq)
+				continue;
+			seq_printf(m, "  task=%d\n", task_pid_nr(node->task));
+			io_wq_show_fdinfo(tctx->io_wq, m);
+		}
+	}
+
 	seq_puts(m, "PollList:\n");
 	for (i = 0; i < (1U << ctx->cancel_table.hash_bits); i++) {
 		struct io_hash_bucket *hb = &ctx->cancel_table.hbs[i];
@@ -188,8 +203,11 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 					task_work_pending(req->task));
 	}
 
-	if (has_lock)
+	if (has_lock) {
+		/* ->op_stats_mem is only changed under ->uring_lock */
+		io_show_op_stats(ctx, m);
 		mutex_unlock(&ctx->uring_lock);
+	}
 
 	seq_puts(m, "CqOverflowList:\n");
 	spin_lock(&ctx->completion_lock);
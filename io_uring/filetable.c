@@ -52,6 +52,27 @@ bool io_alloc_file_tables(struct io_file_table *table, unsigned nr_files)
 	return true;
 }
 
+/*
+ * Replace the tables with bigger ones, carrying over the existing slots.
+ * Lookups all happen under ->uring_lock, which the caller holds.
+ */
+bool io_grow_file_tables(struct io_file_table *table, unsigned old_nr,
+			 unsigned nr_files)
+{
+	struct io_file_table new;
+
+	if (!io_alloc_file_tables(&new, nr_files))
+		return false;
+
+	memcpy(new.files, table->files, old_nr * sizeof(table->files[0]));
+	bitmap_copy(new.bitmap, table->bitmap, old_nr);
+	kvfree(table->files);
+	bitmap_free(table->bitmap);
+	table->files = new.files;
+	table->bitmap = new.bitmap;
+	return true;
+}
+
 void io_free_file_tables(struct io_file_table *table)
 {
 	kvfree(table->files);
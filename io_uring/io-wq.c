@@ -16,6 +16,7 @@
 #include <linux/task_work.h>
 #include <linux/audit.h>
 #include <linux/mmu_context.h>
+#include <linux/seq_file.h>
 #include <uapi/linux/io_uring.h>
 
 #include "io-wq.h"
@@ -60,6 +61,9 @@ struct io_worker {
 	struct callback_head create_work;
 	int create_index;
 
+	/* NUMA node this worker was created for, or NUMA_NO_NODE */
+	int node;
+
 	union {
 		struct rcu_head rcu;
 		struct work_struct work;
@@ -90,6 +94,19 @@ enum {
 	IO_WQ_ACCT_NR,
 };
 
+/*
+ * Per NUMA node accounting. Work is queued on the shared acct lists so that
+ * hashed work stays ordered, but idle workers local to the submitting node
+ * are preferred when waking, and new workers are created on and affined to
+ * the submitting node.
+ */
+struct io_wq_node {
+	/* protected by wq->lock */
+	unsigned nr_workers[IO_WQ_ACCT_NR];
+	/* work queued from this node that hasn't been picked up yet */
+	atomic_t nr_queued;
+};
+
 /*
  * Per io_wq state
   */
@@ -110,6 +127,8 @@ struct io_wq {
 
 	struct io_wq_acct acct[IO_WQ_ACCT_NR];
 
+	struct io_wq_node *nodes;
+
 	/* lock protects access to elements below */
 	raw_spinlock_t lock;
 
@@ -133,7 +152,7 @@ struct io_cb_cancel_data {
 	bool cancel_all;
 };
 
-static bool create_io_worker(struct io_wq *wq, int index);
+static bool create_io_worker(struct io_wq *wq, int index, int node);
 static void io_wq_dec_running(struct io_worker *worker);
 static bool io_acct_cancel_pending_work(struct io_wq *wq,
 					struct io_wq_acct *acct,
@@ -174,6 +193,50 @@ static void io_worker_ref_put(struct io_wq *wq)
 		complete(&wq->worker_done);
 }
 
+static inline void io_wq_node_account_worker(struct io_worker *worker,
+					     int delta)
+	__must_hold(worker->wq->lock)
+{
+	struct io_wq_node *node;
+
+	if (worker->node == NUMA_NO_NODE)
+		return;
+	node = &worker->wq->nodes[worker->node];
+	if (worker->flags & IO_WORKER_F_BOUND)
+		node->nr_workers[IO_WQ_ACCT_BOUND] += delta;
+	else
+		node->nr_workers[IO_WQ_ACCT_UNBOUND] += delta;
+}
+
+static inline int io_get_work_node(struct io_wq_work *work)
+{
+	return ((work->flags & IO_WQ_NODE_MASK) >> IO_WQ_NODE_SHIFT) - 1;
+}
+
+static inline void io_wq_work_set_node(struct io_wq *wq,
+				       struct io_wq_work *work, int node)
+{
+	work->flags &= ~IO_WQ_NODE_MASK;
+	work->flags |= (node + 1) << IO_WQ_NODE_SHIFT;
+	atomic_inc(&wq->nodes[node].nr_queued);
+}
+
+/*
+ * Work is no longer pending, drop it from the node queue depth. Must be
+ * called with the acct lock held, before the work becomes visible as the
+ * current work of a worker.
+ */
+static inline void io_wq_work_clear_node(struct io_wq *wq,
+					 struct io_wq_work *work)
+{
+	int node = io_get_work_node(work);
+
+	if (node != NUMA_NO_NODE) {
+		atomic_dec(&wq->nodes[node].nr_queued);
+		work->flags &= ~IO_WQ_NODE_MASK;
+	}
+}
+
 static void io_worker_cancel_cb(struct io_worker *worker)
 {
 	struct io_wq_acct *acct = io_wq_get_acct(worker);
@@ -218,6 +281,7 @@ static void io_worker_exit(struct io_worker *worker)
 	if (worker->flags & IO_WORKER_F_FREE)
 		hlist_nulls_del_rcu(&worker->nulls_node);
 	list_del_rcu(&worker->all_list);
+	io_wq_node_account_worker(worker, -1);
 	raw_spin_unlock(&wq->lock);
 	io_wq_dec_running(worker);
 	/*
@@ -249,8 +313,8 @@ static inline bool io_acct_run_queue(struct io_wq_acct *acct)
  * Check head of free list for an available worker. If one isn't available,
  * caller must create one.
  */
-static bool io_wq_activate_free_worker(struct io_wq *wq,
-					struct io_wq_acct *acct)
+static bool __io_wq_activate_free_worker(struct io_wq *wq,
+					  struct io_wq_acct *acct, int node)
 	__must_hold(RCU)
 {
 	struct hlist_nulls_node *n;
@@ -262,6 +326,8 @@ static bool io_wq_activate_free_worker(struct io_wq *wq,
 	 * of exiting, keep trying.
 	 */
 	hlist_nulls_for_each_entry_rcu(worker, n, &wq->free_list, nulls_node) {
+		if (node != NUMA_NO_NODE && worker->node != node)
+			continue;
 		if (!io_worker_get(worker))
 			continue;
 		if (io_wq_get_acct(worker) != acct) {
@@ -278,11 +344,26 @@ static bool io_wq_activate_free_worker(struct io_wq *wq,
 	return false;
 }
 
+/*
+ * Prefer an idle worker on @node, if there is one, but fall back to any idle
+ * worker rather than have the work wait for a new one to get created.
+ */
+static bool io_wq_activate_free_worker(struct io_wq *wq,
+				       struct io_wq_acct *acct, int node)
+	__must_hold(RCU)
+{
+	if (node != NUMA_NO_NODE && nr_node_ids > 1 &&
+	    __io_wq_activate_free_worker(wq, acct, node))
+		return true;
+	return __io_wq_activate_free_worker(wq, acct, NUMA_NO_NODE);
+}
+
 /*
  * We need a worker. If we find a free one, we're good. If not, and we're
  * below the max number of workers, create one.
  */
-static bool io_wq_create_worker(struct io_wq *wq, struct io_wq_acct *acct)
+static bool io_wq_create_worker(struct io_wq *wq, struct io_wq_acct *acct,
+				int node)
 {
 	/*
 	 * Most likely an attempt to queue unbounded work on an io_wq that
@@ -300,7 +381,7 @@ static bool io_wq_create_worker(struct io_wq *wq, struct io_wq_acct *acct)
 	raw_spin_unlock(&wq->lock);
 	atomic_inc(&acct->nr_running);
 	atomic_inc(&wq->worker_refs);
-	return create_io_worker(wq, acct->index);
+	return create_io_worker(wq, acct->index, node);
 }
 
 static void io_wq_inc_running(struct io_worker *worker)
@@ -329,7 +410,7 @@ static void create_worker_cb(struct callback_head *cb)
 	}
 	raw_spin_unlock(&wq->lock);
 	if (do_create) {
-		create_io_worker(wq, worker->create_index);
+		create_io_worker(wq, worker->create_index, worker->node);
 	} else {
 		atomic_dec(&acct->nr_running);
 		io_worker_ref_put(wq);
@@ -467,6 +548,7 @@ static struct io_wq_work *io_get_next_work(struct io_wq_acct *acct,
 		/* not hashed, can run anytime */
 		if (!io_wq_is_hashed(work)) {
 			wq_list_del(&acct->work_list, node, prev);
+			io_wq_work_clear_node(wq, work);
 			return work;
 		}
 
@@ -476,8 +558,12 @@ static struct io_wq_work *io_get_next_work(struct io_wq_acct *acct,
 
 		/* hashed, can run if not already running */
 		if (!test_and_set_bit(hash, &wq->hash->map)) {
+			struct io_wq_work *pos;
+
 			wq->hash_tail[hash] = NULL;
 			wq_list_cut(&acct->work_list, &tail->list, prev);
+			for (pos = work; pos; pos = wq_next_work(pos))
+				io_wq_work_clear_node(wq, pos);
 			return work;
 		}
 		if (stall_hash == -1U)
@@ -688,17 +774,41 @@ void io_wq_worker_sleeping(struct task_struct *tsk)
 	io_wq_dec_running(worker);
 }
 
+/*
+ * Keep a node local worker on the CPUs of its node, as long as that leaves
+ * it with any CPUs that the io-wq affinity allows.
+ */
+static void io_wq_worker_set_affinity(struct io_wq *wq,
+				      struct io_worker *worker,
+				      struct task_struct *tsk)
+{
+	cpumask_var_t mask;
+
+	if (worker->node == NUMA_NO_NODE ||
+	    !alloc_cpumask_var(&mask, GFP_KERNEL)) {
+		set_cpus_allowed_ptr(tsk, wq->cpu_mask);
+		return;
+	}
+
+	if (cpumask_and(mask, wq->cpu_mask, cpumask_of_node(worker->node)))
+		set_cpus_allowed_ptr(tsk, mask);
+	else
+		set_cpus_allowed_ptr(tsk, wq->cpu_mask);
+	free_cpumask_var(mask);
+}
+
 static void io_init_new_worker(struct io_wq *wq, struct io_worker *worker,
 			       struct task_struct *tsk)
 {
 	tsk->worker_private = worker;
 	worker->task = tsk;
-	set_cpus_allowed_ptr(tsk, wq->cpu_mask);
+	io_wq_worker_set_affinity(wq, worker, tsk);
 
 	raw_spin_lock(&wq->lock);
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &wq->free_list);
 	list_add_tail_rcu(&worker->all_list, &wq->all_list);
 	worker->flags |= IO_WORKER_F_FREE;
+	io_wq_node_account_worker(worker, 1);
 	raw_spin_unlock(&wq->lock);
 	wake_up_new_task(tsk);
 }
@@ -737,7 +847,7 @@ static void create_worker_cont(struct callback_head *cb)
 	worker = container_of(cb, struct io_worker, create_work);
 	clear_bit_unlock(0, &worker->create_state);
 	wq = worker->wq;
-	tsk = create_io_thread(io_wq_worker, worker, NUMA_NO_NODE);
+	tsk = create_io_thread(io_wq_worker, worker, worker->node);
 	if (!IS_ERR(tsk)) {
 		io_init_new_worker(wq, worker, tsk);
 		io_worker_release(worker);
@@ -779,7 +889,7 @@ static void io_workqueue_create(struct work_struct *work)
 		kfree(worker);
 }
 
-static bool create_io_worker(struct io_wq *wq, int index)
+static bool create_io_worker(struct io_wq *wq, int index, int node)
 {
 	struct io_wq_acct *acct = &wq->acct[index];
 	struct io_worker *worker;
@@ -800,13 +910,14 @@ static bool create_io_worker(struct io_wq *wq, int index)
 
 	refcount_set(&worker->ref, 1);
 	worker->wq = wq;
+	worker->node = node;
 	raw_spin_lock_init(&worker->lock);
 	init_completion(&worker->ref_done);
 
 	if (index == IO_WQ_ACCT_BOUND)
 		worker->flags |= IO_WORKER_F_BOUND;
 
-	tsk = create_io_thread(io_wq_worker, worker, NUMA_NO_NODE);
+	tsk = create_io_thread(io_wq_worker, worker, node);
 	if (!IS_ERR(tsk)) {
 		io_init_new_worker(wq, worker, tsk);
 	} else if (!io_should_retry_thread(PTR_ERR(tsk))) {
@@ -892,6 +1003,7 @@ void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work)
 	struct io_wq_acct *acct = io_work_get_acct(wq, work);
 	struct io_cb_cancel_data match;
 	unsigned work_flags = work->flags;
+	int node = numa_node_id();
 	bool do_create;
 
 	/*
@@ -905,13 +1017,14 @@ void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work)
 	}
 
 	raw_spin_lock(&acct->lock);
+	io_wq_work_set_node(wq, work, node);
 	io_wq_insert_work(wq, work);
 	clear_bit(IO_ACCT_STALLED_BIT, &acct->flags);
 	raw_spin_unlock(&acct->lock);
 
 	raw_spin_lock(&wq->lock);
 	rcu_read_lock();
-	do_create = !io_wq_activate_free_worker(wq, acct);
+	do_create = !io_wq_activate_free_worker(wq, acct, node);
 	rcu_read_unlock();
 
 	raw_spin_unlock(&wq->lock);
@@ -920,7 +1033,7 @@ void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work)
 	    !atomic_read(&acct->nr_running))) {
 		bool did_create;
 
-		did_create = io_wq_create_worker(wq, acct);
+		did_create = io_wq_create_worker(wq, acct, node);
 		if (likely(did_create))
 			return;
 
@@ -999,6 +1112,7 @@ static inline void io_wq_remove_pending(struct io_wq *wq,
 			wq->hash_tail[hash] = NULL;
 	}
 	wq_list_del(&acct->work_list, &work->list, prev);
+	io_wq_work_clear_node(wq, work);
 }
 
 static bool io_acct_cancel_pending_work(struct io_wq *wq,
@@ -1101,7 +1215,7 @@ static int io_wq_hash_wake(struct wait_queue_entry *wait, unsigned mode,
 		struct io_wq_acct *acct = &wq->acct[i];
 
 		if (test_and_clear_bit(IO_ACCT_STALLED_BIT, &acct->flags))
-			io_wq_activate_free_worker(wq, acct);
+			io_wq_activate_free_worker(wq, acct, NUMA_NO_NODE);
 	}
 	rcu_read_unlock();
 	return 1;
@@ -1134,6 +1248,9 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	if (!alloc_cpumask_var(&wq->cpu_mask, GFP_KERNEL))
 		goto err;
 	cpumask_copy(wq->cpu_mask, cpu_possible_mask);
+	wq->nodes = kcalloc(nr_node_ids, sizeof(*wq->nodes), GFP_KERNEL);
+	if (!wq->nodes)
+		goto err;
 	wq->acct[IO_WQ_ACCT_BOUND].max_workers = bounded;
 	wq->acct[IO_WQ_ACCT_UNBOUND].max_workers =
 				task_rlimit(current, RLIMIT_NPROC);
@@ -1160,6 +1277,7 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	io_wq_put_hash(data->hash);
 	cpuhp_state_remove_instance_nocalls(io_wq_online, &wq->cpuhp_node);
 
+	kfree(wq->nodes);
 	free_cpumask_var(wq->cpu_mask);
 err_wq:
 	kfree(wq);
@@ -1229,6 +1347,7 @@ static void io_wq_destroy(struct io_wq *wq)
 
 	cpuhp_state_remove_instance_nocalls(io_wq_online, &wq->cpuhp_node);
 	io_wq_cancel_pending_work(wq, &match);
+	kfree(wq->nodes);
 	free_cpumask_var(wq->cpu_mask);
 	io_wq_put_hash(wq->hash);
 	kfree(wq);
@@ -1337,10 +1456,30 @@ int io_wq_max_workers(struct io_wq *wq, int *new_count)
 	return 0;
 }
 
+#ifdef CONFIG_PROC_FS
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m)
+{
+	int node;
+
+	raw_spin_lock(&wq->lock);
+	for_each_online_node(node) {
+		struct io_wq_node *n = &wq->nodes[node];
+
+		seq_printf(m, "  node%d: queued=%d bound=%u unbound=%u\n", node,
+			   atomic_read(&n->nr_queued),
+			   n->nr_workers[IO_WQ_ACCT_BOUND],
+			   n->nr_workers[IO_WQ_ACCT_UNBOUND]);
+	}
+	raw_spin_unlock(&wq->lock);
+}
+#endif
+
 static __init int io_wq_init(void)
 {
 	int ret;
 
+	BUILD_BUG_ON(MAX_NUMNODES >= (IO_WQ_NODE_MASK >> IO_WQ_NODE_SHIFT));
+
 	ret = cpuhp_setup_state_multi(CPUHP_AP_ONLINE_DYN, "io-wq/online",
 					io_wq_cpu_online, io_wq_cpu_offline);
 	if (ret < 0)
@@ -12,6 +12,8 @@ enum {
 	IO_WQ_WORK_UNBOUND	= 4,
 	IO_WQ_WORK_CONCURRENT	= 16,
 
+	IO_WQ_NODE_SHIFT	= 8,	/* bits 8..23 hold queueing node + 1 */
+	IO_WQ_NODE_MASK		= 0xffff << IO_WQ_NODE_SHIFT,
 	IO_WQ_HASH_SHIFT	= 24,	/* upper 8 bits are used for hash key */
 };
 
@@ -53,6 +55,9 @@ void io_wq_hash_work(struct io_wq_work *work, void *val);
 int io_wq_cpu_affinity(struct io_wq *wq, cpumask_var_t mask);
 int io_wq_max_workers(struct io_wq *wq, int *new_count);
 
+struct seq_file;
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m);
+
 static inline bool io_wq_is_hashed(struct io_wq_work *work)
 {
 	return work->flags & IO_WQ_WORK_HASHED;
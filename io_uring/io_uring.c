@@ -72,6 +72,7 @@
 #include <linux/io_uring.h>
 #include <linux/audit.h>
 #include <linux/security.h>
+#include <linux/local_lock.h>
 #include <asm/shmparam.h>
 
 #define CREATE_TRACE_POINTS
@@ -108,7 +109,8 @@
 			  IOSQE_IO_HARDLINK | IOSQE_ASYNC)
 
 #define SQE_VALID_FLAGS	(SQE_COMMON_FLAGS | IOSQE_BUFFER_SELECT | \
-			IOSQE_IO_DRAIN | IOSQE_CQE_SKIP_SUCCESS)
+			IOSQE_IO_DRAIN | IOSQE_CQE_SKIP_SUCCESS | \
+			IOSQE_IO_PARALLEL)
 
 #define IO_REQ_CLEAN_FLAGS (REQ_F_BUFFER_SELECTED | REQ_F_NEED_CLEANUP | \
 				REQ_F_POLLED | REQ_F_INFLIGHT | REQ_F_CREDS | \
@@ -119,8 +121,13 @@
 
 #define IO_TCTX_REFS_CACHE_NR	(1U << 10)
 
+/* ->poll_refs of the request waiting on a parallel link group */
+#define IO_LINK_JOIN_FAILED	BIT(30)
+#define IO_LINK_JOIN_MASK	(IO_LINK_JOIN_FAILED - 1)
+
 #define IO_COMPL_BATCH			32
 #define IO_REQ_ALLOC_BATCH		8
+#define IO_REQ_PCPU_CACHE_MAX		128
 
 enum {
 	IO_CHECK_CQ_OVERFLOW_BIT,
@@ -147,11 +154,30 @@ static bool io_uring_try_cancel_requests(struct io_ring_ctx *ctx,
 					 bool cancel_all);
 
 static void io_queue_sqe(struct io_kiocb *req);
+static void io_queue_sqe_fallback(struct io_kiocb *req);
+static struct io_kiocb *io_link_group_done(struct io_kiocb *req);
 static void io_move_task_work_from_local(struct io_ring_ctx *ctx);
 static void __io_submit_flush_completions(struct io_ring_ctx *ctx);
 
 struct kmem_cache *req_cachep;
 
+/*
+ * Free requests of rings set up with IORING_SETUP_SHARED_REQ_CACHE. Those
+ * rings return completed requests here rather than to their own cache and
+ * refill from it, so lots of mostly idle rings don't each pin a warm cache.
+ * Being per-cpu, a task that migrates simply starts using the cache of the
+ * CPU it now runs on. Cached requests don't hold a ctx reference.
+ */
+struct io_req_pcpu_cache {
+	local_lock_t			lock;
+	struct io_wq_work_node		list;
+	unsigned int			nr;
+};
+
+static DEFINE_PER_CPU(struct io_req_pcpu_cache, io_req_pcpu_cache) = {
+	.lock = INIT_LOCAL_LOCK(lock),
+};
+
 struct sock *io_uring_get_socket(struct file *file)
 {
 #if defined(CONFIG_UNIX)
@@ -232,6 +258,43 @@ static inline void io_req_add_to_cache(struct io_kiocb *req, struct io_ring_ctx
 	kasan_poison_object_data(req_cachep, req);
 }
 
+static int io_req_pcpu_cache_get(void **reqs, int nr)
+{
+	struct io_req_pcpu_cache *c;
+	int i = 0;
+
+	local_lock(&io_req_pcpu_cache.lock);
+	c = this_cpu_ptr(&io_req_pcpu_cache);
+	while (i < nr && c->list.next) {
+		struct io_kiocb *req = container_of(c->list.next,
+						    struct io_kiocb, comp_list);
+
+		kasan_unpoison_object_data(req_cachep, req);
+		wq_stack_extract(&c->list);
+		reqs[i++] = req;
+	}
+	c->nr -= i;
+	local_unlock(&io_req_pcpu_cache.lock);
+	return i;
+}
+
+static void io_req_pcpu_cache_put(struct io_kiocb *req)
+{
+	struct io_req_pcpu_cache *c;
+
+	local_lock(&io_req_pcpu_cache.lock);
+	c = this_cpu_ptr(&io_req_pcpu_cache);
+	if (c->nr < IO_REQ_PCPU_CACHE_MAX) {
+		wq_stack_add_head(&req->comp_list, &c->list);
+		kasan_poison_object_data(req_cachep, req);
+		c->nr++;
+		req = NULL;
+	}
+	local_unlock(&io_req_pcpu_cache.lock);
+	if (req)
+		kmem_cache_free(req_cachep, req);
+}
+
 static __cold void io_ring_ctx_ref_free(struct percpu_ref *ref)
 {
 	struct io_ring_ctx *ctx = container_of(ref, struct io_ring_ctx, refs);
@@ -511,6 +574,7 @@ void io_queue_iowq(struct io_kiocb *req, struct io_tw_state *ts_dont_use)
 		req->work.flags |= IO_WQ_WORK_CANCEL;
 
 	trace_io_uring_queue_async_work(req, io_wq_is_hashed(&req->work));
+	io_stats_iowq(req);
 	io_wq_enqueue(tctx->io_wq, &req->work);
 	if (link)
 		io_queue_linked_timeout(link);
@@ -988,7 +1052,12 @@ static void __io_req_complete_post(struct io_kiocb *req, unsigned issue_flags)
 	 * free_list cache.
 	 */
 	if (req_ref_put_and_test(req)) {
-		if (req->flags & IO_REQ_LINK_FLAGS) {
+		if (unlikely(req->flags & REQ_F_IO_PARALLEL)) {
+			struct io_kiocb *nxt = io_link_group_done(req);
+
+			if (nxt)
+				io_req_task_queue(nxt);
+		} else if (req->flags & IO_REQ_LINK_FLAGS) {
 			if (req->flags & IO_DISARM_MASK)
 				io_disarm_next(req);
 			if (req->link) {
@@ -1098,6 +1167,12 @@ __cold bool __io_alloc_req_refill(struct io_ring_ctx *ctx)
 			return true;
 	}
 
+	if (ctx->flags & IORING_SETUP_SHARED_REQ_CACHE) {
+		ret = io_req_pcpu_cache_get(reqs, ARRAY_SIZE(reqs));
+		if (ret)
+			goto got_reqs;
+	}
+
 	ret = kmem_cache_alloc_bulk(req_cachep, gfp, ARRAY_SIZE(reqs), reqs);
 
 	/*
@@ -1110,7 +1185,7 @@ __cold bool __io_alloc_req_refill(struct io_ring_ctx *ctx)
 			return false;
 		ret = 1;
 	}
-
+got_reqs:
 	percpu_ref_get_many(&ctx->refs, ret);
 	for (i = 0; i < ret; i++) {
 		struct io_kiocb *req = reqs[i];
@@ -1140,10 +1215,78 @@ static void __io_req_find_next_prep(struct io_kiocb *req)
 	spin_unlock(&ctx->completion_lock);
 }
 
+/*
+ * A run of IOSQE_IO_PARALLEL requests in a link, together with the request
+ * that terminates the run, forms a group. All members are started at once
+ * and the request following the group only runs when all of them are done.
+ * Starting the group points every member's ->link at that join request and
+ * uses the join's ->poll_refs, unused until it's issued, as the count of
+ * members yet to complete. The caller still has to issue @req itself.
+ */
+static void io_link_group_start(struct io_kiocb *req, bool submit)
+{
+	struct io_kiocb *cur, *next, *join;
+	int nr = 1;
+
+	for (cur = req; cur->link && (cur->flags & REQ_F_IO_PARALLEL);
+	     cur = cur->link)
+		nr++;
+	join = cur->link;
+	if (join)
+		atomic_set(&join->poll_refs, nr);
+
+	cur = req->link;
+	req->link = join;
+	while (cur != join) {
+		next = cur->link;
+		cur->link = join;
+		cur->flags |= REQ_F_IO_PARALLEL;
+		if (!submit)
+			io_req_task_queue(cur);
+		else if (cur->flags & REQ_F_FORCE_ASYNC)
+			io_queue_sqe_fallback(cur);
+		else
+			io_queue_sqe(cur);
+		cur = next;
+	}
+}
+
+static struct io_kiocb *io_link_group_done(struct io_kiocb *req)
+{
+	struct io_kiocb *join = req->link;
+	int v;
+
+	/* severed by io_fail_links(), the group never started */
+	if (!join)
+		return NULL;
+	req->link = NULL;
+
+	if ((req->flags & REQ_F_FAIL) && !(req->flags & REQ_F_HARDLINK))
+		atomic_or(IO_LINK_JOIN_FAILED, &join->poll_refs);
+	v = atomic_dec_return(&join->poll_refs);
+	if (v & IO_LINK_JOIN_MASK)
+		return NULL;
+	if (v & IO_LINK_JOIN_FAILED) {
+		struct io_kiocb *cur;
+
+		/* the rest of the link is failed as a plain chain */
+		io_for_each_link(cur, join)
+			cur->flags &= ~REQ_F_IO_PARALLEL;
+		io_req_task_queue_fail(join, -ECANCELED);
+		return NULL;
+	}
+	if (join->flags & REQ_F_IO_PARALLEL)
+		io_link_group_start(join, false);
+	return join;
+}
+
 static inline struct io_kiocb *io_req_find_next(struct io_kiocb *req)
 {
 	struct io_kiocb *nxt;
 
+	if (unlikely(req->flags & REQ_F_IO_PARALLEL))
+		return io_link_group_done(req);
+
 	/*
 	 * If LINK is set, we have dependent requests in this chain. If we
 	 * didn't fail this request, queue the first one up, moving any other
@@ -1154,6 +1297,8 @@ static inline struct io_kiocb *io_req_find_next(struct io_kiocb *req)
 		__io_req_find_next_prep(req);
 	nxt = req->link;
 	req->link = NULL;
+	if (unlikely(nxt && (nxt->flags & REQ_F_IO_PARALLEL)))
+		io_link_group_start(nxt, false);
 	return nxt;
 }
 
@@ -1510,6 +1655,8 @@ void io_queue_next(struct io_kiocb *req)
 void io_free_batch_list(struct io_ring_ctx *ctx, struct io_wq_work_node *node)
 	__must_hold(&ctx->uring_lock)
 {
+	unsigned int nr_shared = 0;
+
 	do {
 		struct io_kiocb *req = container_of(node, struct io_kiocb,
 						    comp_list);
@@ -1541,8 +1688,16 @@ void io_free_batch_list(struct io_ring_ctx *ctx, struct io_wq_work_node *node)
 
 		io_put_task(req->task);
 		node = req->comp_list.next;
-		io_req_add_to_cache(req, ctx);
+		if (ctx->flags & IORING_SETUP_SHARED_REQ_CACHE) {
+			io_req_pcpu_cache_put(req);
+			nr_shared++;
+		} else {
+			io_req_add_to_cache(req, ctx);
+		}
 	} while (node);
+
+	if (nr_shared)
+		percpu_ref_put_many(&ctx->refs, nr_shared);
 }
 
 static void __io_submit_flush_completions(struct io_ring_ctx *ctx)
@@ -1864,6 +2019,7 @@ static int io_issue_sqe(struct io_kiocb *req, unsigned int issue_flags)
 	if (!def->audit_skip)
 		audit_uring_entry(req->opcode);
 
+	io_stats_issue(req);
 	ret = def->issue(req, issue_flags);
 
 	if (!def->audit_skip)
@@ -2055,12 +2211,18 @@ static void io_queue_sqe_fallback(struct io_kiocb *req)
 	__must_hold(&req->ctx->uring_lock)
 {
 	if (unlikely(req->flags & REQ_F_FAIL)) {
+		struct io_kiocb *cur;
+
 		/*
 		 * We don't submit, fail them all, for that replace hardlinks
-		 * with normal links. Extra REQ_F_LINK is tolerated.
+		 * with normal links. Extra REQ_F_LINK is tolerated. Parallel
+		 * groups never started, so the link has to be torn down as a
+		 * plain chain.
 		 */
 		req->flags &= ~REQ_F_HARDLINK;
 		req->flags |= REQ_F_LINK;
+		io_for_each_link(cur, req)
+			cur->flags &= ~REQ_F_IO_PARALLEL;
 		io_req_defer_failed(req, req->cqe.res);
 	} else {
 		int ret = io_req_prep_async(req);
@@ -2136,6 +2298,7 @@ static int io_init_req(struct io_ring_ctx *ctx, struct io_kiocb *req,
 	req->file = NULL;
 	req->rsrc_node = NULL;
 	req->task = current;
+	io_stats_init_req(ctx, req);
 
 	if (unlikely(opcode >= IORING_OP_LAST)) {
 		req->opcode = 0;
@@ -2151,6 +2314,9 @@ static int io_init_req(struct io_ring_ctx *ctx, struct io_kiocb *req,
 				return -EOPNOTSUPP;
 			req->buf_index = READ_ONCE(sqe->buf_group);
 		}
+		if ((sqe_flags & IOSQE_IO_PARALLEL) &&
+		    !(sqe_flags & (IOSQE_IO_LINK | IOSQE_IO_HARDLINK)))
+			return -EINVAL;
 		if (sqe_flags & IOSQE_CQE_SKIP_SUCCESS)
 			ctx->drain_disabled = true;
 		if (sqe_flags & IOSQE_IO_DRAIN) {
@@ -2276,6 +2442,8 @@ static inline int io_submit_sqe(struct io_ring_ctx *ctx, struct io_kiocb *req,
 			return io_submit_fail_init(sqe, req, ret);
 
 		trace_io_uring_link(req, link->head);
+		link->last_in_group = (link->last->flags | req->flags) &
+					REQ_F_IO_PARALLEL;
 		link->last->link = req;
 		link->last = req;
 
@@ -2284,6 +2452,9 @@ static inline int io_submit_sqe(struct io_ring_ctx *ctx, struct io_kiocb *req,
 		/* last request of the link, flush it */
 		req = link->head;
 		link->head = NULL;
+		if (unlikely((req->flags & (REQ_F_IO_PARALLEL | REQ_F_FAIL)) ==
+			     REQ_F_IO_PARALLEL))
+			io_link_group_start(req, true);
 		if (req->flags & (REQ_F_FORCE_ASYNC | REQ_F_FAIL))
 			goto fallback;
 
@@ -2292,6 +2463,7 @@ static inline int io_submit_sqe(struct io_ring_ctx *ctx, struct io_kiocb *req,
 		if (req->flags & IO_REQ_LINK_FLAGS) {
 			link->head = req;
 			link->last = req;
+			link->last_in_group = req->flags & REQ_F_IO_PARALLEL;
 		} else {
 fallback:
 			io_queue_sqe_fallback(req);
@@ -2310,8 +2482,14 @@ static void io_submit_state_end(struct io_ring_ctx *ctx)
 {
 	struct io_submit_state *state = &ctx->submit_state;
 
-	if (unlikely(state->link.head))
-		io_queue_sqe_fallback(state->link.head);
+	if (unlikely(state->link.head)) {
+		struct io_kiocb *head = state->link.head;
+
+		if ((head->flags & (REQ_F_IO_PARALLEL | REQ_F_FAIL)) ==
+		    REQ_F_IO_PARALLEL)
+			io_link_group_start(head, true);
+		io_queue_sqe_fallback(head);
+	}
 	/* flush only after queuing links as they can generate completions */
 	io_submit_flush_completions(ctx);
 	if (state->plug_started)
@@ -2436,6 +2614,7 @@ struct io_wait_queue {
 	unsigned cq_tail;
 	unsigned nr_timeouts;
 	ktime_t timeout;
+	ktime_t batch_timeout;
 };
 
 static inline bool io_has_work(struct io_ring_ctx *ctx)
@@ -2499,6 +2678,17 @@ static inline int io_cqring_wait_schedule(struct io_ring_ctx *ctx,
 		return -EINTR;
 	if (unlikely(io_should_wake(iowq)))
 		return 0;
+	if (iowq->batch_timeout != KTIME_MAX) {
+		if (schedule_hrtimeout(&iowq->batch_timeout, HRTIMER_MODE_ABS))
+			return 0;
+		/*
+		 * Latency budget for the batch ran out, settle for whatever
+		 * is there now, or the first CQE that gets posted after.
+		 */
+		iowq->batch_timeout = KTIME_MAX;
+		iowq->cq_tail = READ_ONCE(ctx->rings->cq.head) + 1;
+		return 1;
+	}
 	if (iowq->timeout == KTIME_MAX)
 		schedule();
 	else if (!schedule_hrtimeout(&iowq->timeout, HRTIMER_MODE_ABS))
@@ -2512,7 +2702,8 @@ static inline int io_cqring_wait_schedule(struct io_ring_ctx *ctx,
  */
 static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 			  const sigset_t __user *sig, size_t sigsz,
-			  struct __kernel_timespec __user *uts)
+			  struct __kernel_timespec __user *uts,
+			  ktime_t batch_wait)
 {
 	struct io_wait_queue iowq;
 	struct io_rings *rings = ctx->rings;
@@ -2548,6 +2739,7 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 	iowq.nr_timeouts = atomic_read(&ctx->cq_timeouts);
 	iowq.cq_tail = READ_ONCE(ctx->rings->cq.head) + min_events;
 	iowq.timeout = KTIME_MAX;
+	iowq.batch_timeout = KTIME_MAX;
 
 	if (uts) {
 		struct timespec64 ts;
@@ -2556,6 +2748,16 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 			return -EFAULT;
 		iowq.timeout = ktime_add_ns(timespec64_to_ktime(ts), ktime_get_ns());
 	}
+	/*
+	 * A batch wait only makes sense if it can expire before the overall
+	 * timeout and if there's more than a single event to wait for.
+	 */
+	if (batch_wait && min_events > 1) {
+		ktime_t batch_timeout = ktime_add(ktime_get(), batch_wait);
+
+		if (batch_timeout < iowq.timeout)
+			iowq.batch_timeout = batch_timeout;
+	}
 
 	trace_io_uring_cqring_wait(ctx, min_events);
 	do {
@@ -2844,6 +3046,7 @@ static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 	io_alloc_cache_free(&ctx->netmsg_cache, io_netmsg_cache_free);
 	io_destroy_buffers(ctx);
 	mutex_unlock(&ctx->uring_lock);
+	io_free_op_stats(ctx);
 	if (ctx->sq_creds)
 		put_cred(ctx->sq_creds);
 	if (ctx->submitter_task)
@@ -3504,7 +3707,7 @@ static int io_validate_ext_arg(unsigned flags, const void __user *argp, size_t a
 
 static int io_get_ext_arg(unsigned flags, const void __user *argp, size_t *argsz,
 			  struct __kernel_timespec __user **ts,
-			  const sigset_t __user **sig)
+			  const sigset_t __user **sig, ktime_t *batch_wait)
 {
 	struct io_uring_getevents_arg arg;
 
@@ -3515,6 +3718,7 @@ static int io_get_ext_arg(unsigned flags, const void __user *argp, size_t *argsz
 	if (!(flags & IORING_ENTER_EXT_ARG)) {
 		*sig = (const sigset_t __user *) argp;
 		*ts = NULL;
+		*batch_wait = 0;
 		return 0;
 	}
 
@@ -3526,11 +3730,10 @@ static int io_get_ext_arg(unsigned flags, const void __user *argp, size_t *argsz
 		return -EINVAL;
 	if (copy_from_user(&arg, argp, sizeof(arg)))
 		return -EFAULT;
-	if (arg.pad)
-		return -EINVAL;
 	*sig = u64_to_user_ptr(arg.sigmask);
 	*argsz = arg.sigmask_sz;
 	*ts = u64_to_user_ptr(arg.ts);
+	*batch_wait = us_to_ktime(arg.batch_wait_usec);
 	return 0;
 }
 
@@ -3588,8 +3791,10 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 			ret = -EOWNERDEAD;
 			goto out;
 		}
-		if (flags & IORING_ENTER_SQ_WAKEUP)
+		if (flags & IORING_ENTER_SQ_WAKEUP) {
+			io_sqpoll_unpark(ctx);
 			wake_up(&ctx->sq_data->wait);
+		}
 		if (flags & IORING_ENTER_SQ_WAIT)
 			io_sqpoll_wait_sq(ctx);
 
@@ -3640,13 +3845,15 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 		} else {
 			const sigset_t __user *sig;
 			struct __kernel_timespec __user *ts;
+			ktime_t batch_wait;
 
-			ret2 = io_get_ext_arg(flags, argp, &argsz, &ts, &sig);
+			ret2 = io_get_ext_arg(flags, argp, &argsz, &ts, &sig,
+					      &batch_wait);
 			if (likely(!ret2)) {
 				min_complete = min(min_complete,
 						   ctx->cq_entries);
 				ret2 = io_cqring_wait(ctx, min_complete, sig,
-						      argsz, ts);
+						      argsz, ts, batch_wait);
 			}
 		}
 
@@ -3942,7 +4149,8 @@ static __cold int io_uring_create(unsigned entries, struct io_uring_params *p,
 			IORING_FEAT_POLL_32BITS | IORING_FEAT_SQPOLL_NONFIXED |
 			IORING_FEAT_EXT_ARG | IORING_FEAT_NATIVE_WORKERS |
 			IORING_FEAT_RSRC_TAGS | IORING_FEAT_CQE_SKIP |
-			IORING_FEAT_LINKED_FILE | IORING_FEAT_REG_REG_RING;
+			IORING_FEAT_LINKED_FILE | IORING_FEAT_REG_REG_RING |
+			IORING_FEAT_CQ_BATCH_WAIT;
 
 	if (copy_to_user(params, p, sizeof(*p))) {
 		ret = -EFAULT;
@@ -4009,7 +4217,8 @@ static long io_uring_setup(u32 entries, struct io_uring_params __user *params)
 			IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG |
 			IORING_SETUP_SQE128 | IORING_SETUP_CQE32 |
 			IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN |
-			IORING_SETUP_NO_MMAP | IORING_SETUP_REGISTERED_FD_ONLY))
+			IORING_SETUP_NO_MMAP | IORING_SETUP_REGISTERED_FD_ONLY |
+			IORING_SETUP_SHARED_REQ_CACHE))
 		return -EINVAL;
 
 	return io_uring_create(entries, &p, params);
@@ -4458,6 +4667,24 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_file_alloc_range(ctx, arg);
 		break;
+	case IORING_REGISTER_FILES_GROW:
+		ret = -EINVAL;
+		if (arg || !nr_args)
+			break;
+		ret = io_sqe_files_grow(ctx, nr_args);
+		break;
+	case IORING_REGISTER_SQPOLL_WEIGHT:
+		ret = -EINVAL;
+		if (arg)
+			break;
+		ret = io_sqpoll_set_weight(ctx, nr_args);
+		break;
+	case IORING_REGISTER_OP_STATS:
+		ret = -EINVAL;
+		if (arg)
+			break;
+		ret = io_register_op_stats(ctx, nr_args);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
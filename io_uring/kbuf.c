@@ -125,6 +125,45 @@ static void __user *io_provided_buffer_select(struct io_kiocb *req, size_t *len,
 	return NULL;
 }
 
+static struct io_uring_buf *io_ring_head_to_buf(struct io_buffer_list *bl,
+						__u16 head)
+{
+	struct io_uring_buf *buf;
+
+	head &= bl->mask;
+	/* mmaped buffers are always contig */
+	if (bl->is_mmap || head < IO_BUFFER_LIST_BUF_PER_PAGE)
+		return &bl->buf_ring->bufs[head];
+
+	buf = page_address(bl->buf_pages[head / IO_BUFFER_LIST_BUF_PER_PAGE]);
+	return buf + (head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1));
+}
+
+/*
+ * Commit @len bytes of the head buffer of an incrementally consumed ring.
+ * The buffer stays at the head of the ring, with its address and length
+ * advanced past the received data, until there's nothing left of it.
+ */
+unsigned int __io_put_kbuf_inc(struct io_kiocb *req, int len)
+{
+	struct io_buffer_list *bl = req->buf_list;
+	unsigned int cflags = IORING_CQE_F_BUFFER |
+			      (req->buf_index << IORING_CQE_BUFFER_SHIFT);
+	struct io_uring_buf *buf = io_ring_head_to_buf(bl, bl->head);
+	__u32 buf_len = READ_ONCE(buf->len);
+
+	if (len < buf_len) {
+		WRITE_ONCE(buf->addr, READ_ONCE(buf->addr) + len);
+		WRITE_ONCE(buf->len, buf_len - len);
+		cflags |= IORING_CQE_F_BUF_MORE;
+	} else {
+		bl->head++;
+	}
+	req->buf_index = bl->bgid;
+	req->flags &= ~REQ_F_BUFFER_RING;
+	return cflags;
+}
+
 static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 					  struct io_buffer_list *bl,
 					  unsigned int issue_flags)
@@ -136,16 +175,7 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 	if (unlikely(smp_load_acquire(&br->tail) == head))
 		return NULL;
 
-	head &= bl->mask;
-	/* mmaped buffers are always contig */
-	if (bl->is_mmap || head < IO_BUFFER_LIST_BUF_PER_PAGE) {
-		buf = &br->bufs[head];
-	} else {
-		int off = head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1);
-		int index = head / IO_BUFFER_LIST_BUF_PER_PAGE;
-		buf = page_address(bl->buf_pages[index]);
-		buf += off;
-	}
+	buf = io_ring_head_to_buf(bl, head);
 	if (*len == 0 || *len > buf->len)
 		*len = buf->len;
 	req->flags |= REQ_F_BUFFER_RING;
@@ -545,7 +575,7 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 
 	if (reg.resv[0] || reg.resv[1] || reg.resv[2])
 		return -EINVAL;
-	if (reg.flags & ~IOU_PBUF_RING_MMAP)
+	if (reg.flags & ~(IOU_PBUF_RING_MMAP | IOU_PBUF_RING_INC))
 		return -EINVAL;
 	if (!(reg.flags & IOU_PBUF_RING_MMAP)) {
 		if (!reg.ring_addr)
@@ -589,6 +619,7 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	if (!ret) {
 		bl->nr_entries = reg.ring_entries;
 		bl->mask = reg.ring_entries - 1;
+		bl->is_inc = !!(reg.flags & IOU_PBUF_RING_INC);
 
 		io_buffer_add_list(ctx, bl, reg.bgid);
 		return 0;
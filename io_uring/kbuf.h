@@ -28,6 +28,8 @@ struct io_buffer_list {
 	__u8 is_mapped;
 	/* ring mapped provided buffers, but mmap'ed by application */
 	__u8 is_mmap;
+	/* buffers may be consumed incrementally, see IOU_PBUF_RING_INC */
+	__u8 is_inc;
 };
 
 struct io_buffer {
@@ -52,6 +54,7 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 
 unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags);
+unsigned int __io_put_kbuf_inc(struct io_kiocb *req, int len);
 
 void io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags);
 
@@ -136,4 +139,18 @@ static inline unsigned int io_put_kbuf(struct io_kiocb *req,
 		return 0;
 	return __io_put_kbuf(req, issue_flags);
 }
+
+/*
+ * Like io_put_kbuf(), but for requests that know how much of the buffer they
+ * used, which allows incrementally consumed buffer rings to hang on to the
+ * buffer if there's space left in it.
+ */
+static inline unsigned int io_put_kbuf_len(struct io_kiocb *req, int len,
+					   unsigned issue_flags)
+{
+	if ((req->flags & REQ_F_BUFFER_RING) && req->buf_list &&
+	    req->buf_list->is_inc && len >= 0)
+		return __io_put_kbuf_inc(req, len);
+	return io_put_kbuf(req, issue_flags);
+}
 #endif
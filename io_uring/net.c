@@ -630,7 +630,7 @@ static inline bool io_recv_finish(struct io_kiocb *req, int *ret,
 {
 	unsigned int cflags;
 
-	cflags = io_put_kbuf(req, issue_flags);
+	cflags = io_put_kbuf_len(req, *ret, issue_flags);
 	if (msg->msg_inq && msg->msg_inq != -1)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
@@ -9,6 +9,7 @@
 #include <linux/hugetlb.h>
 #include <linux/compat.h>
 #include <linux/io_uring.h>
+#include <linux/blk-mq.h>
 
 #include <uapi/linux/io_uring.h>
 
@@ -33,6 +34,9 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 #define IORING_MAX_FIXED_FILES	(1U << 20)
 #define IORING_MAX_REG_BUFFERS	(1U << 14)
 
+/* number of fds/tags copied in at once by a files update */
+#define IO_FILES_UPDATE_BATCH	32
+
 int __io_account_mem(struct user_struct *user, unsigned long nr_pages)
 {
 	unsigned long page_limit, cur_pages, new_pages;
@@ -133,10 +137,14 @@ static void io_buffer_unmap(struct io_ring_ctx *ctx, struct io_mapped_ubuf **slo
 	unsigned int i;
 
 	if (imu != ctx->dummy_ubuf) {
-		for (i = 0; i < imu->nr_bvecs; i++)
-			unpin_user_page(imu->bvec[i].bv_page);
-		if (imu->acct_pages)
-			io_unaccount_mem(ctx, imu->acct_pages);
+		if (imu->release) {
+			imu->release(imu->priv);
+		} else {
+			for (i = 0; i < imu->nr_bvecs; i++)
+				unpin_user_page(imu->bvec[i].bv_page);
+			if (imu->acct_pages)
+				io_unaccount_mem(ctx, imu->acct_pages);
+		}
 		kvfree(imu);
 	}
 	*slot = NULL;
@@ -354,6 +362,8 @@ static int __io_sqe_files_update(struct io_ring_ctx *ctx,
 	__s32 __user *fds = u64_to_user_ptr(up->data);
 	struct io_rsrc_data *data = ctx->file_data;
 	struct io_fixed_file *file_slot;
+	u64 tag_batch[IO_FILES_UPDATE_BATCH];
+	__s32 fd_batch[IO_FILES_UPDATE_BATCH];
 	int fd, i, err = 0;
 	unsigned int done;
 
@@ -363,13 +373,25 @@ static int __io_sqe_files_update(struct io_ring_ctx *ctx,
 		return -EINVAL;
 
 	for (done = 0; done < nr_args; done++) {
-		u64 tag = 0;
-
-		if ((tags && copy_from_user(&tag, &tags[done], sizeof(tag))) ||
-		    copy_from_user(&fd, &fds[done], sizeof(fd))) {
-			err = -EFAULT;
-			break;
+		unsigned int b = done % IO_FILES_UPDATE_BATCH;
+		u64 tag;
+
+		/* pull in user fds and tags a batch at a time */
+		if (!b) {
+			unsigned int nr = min_t(unsigned int, nr_args - done,
+						IO_FILES_UPDATE_BATCH);
+
+			if ((tags && copy_from_user(tag_batch, &tags[done],
+						    nr * sizeof(tag_batch[0]))) ||
+			    copy_from_user(fd_batch, &fds[done],
+					   nr * sizeof(fd_batch[0]))) {
+				err = -EFAULT;
+				break;
+			}
 		}
+		tag = tags ? tag_batch[b] : 0;
+		fd = fd_batch[b];
+
 		if ((fd == IORING_REGISTER_FILES_SKIP || fd == -1) && tag) {
 			err = -EINVAL;
 			break;
@@ -767,6 +789,9 @@ int __io_scm_file_account(struct io_ring_ctx *ctx, struct file *file)
 	fpl = UNIXCB(skb).fp;
 	fpl->fp[fpl->count++] = get_file(file);
 	unix_inflight(fpl->user, file);
+	/* Let the unix GC scan the ring socket, see scan_inflight() */
+	if (unix_get_socket(file))
+		atomic_inc(&unix_sk(sk)->scm_stat.nr_unix_fds);
 	skb_queue_head(head, skb);
 	fput(file);
 #endif
@@ -799,6 +824,8 @@ static __cold void io_rsrc_file_scm_put(struct io_ring_ctx *ctx, struct file *fi
 				continue;
 
 			unix_notinflight(fp->user, fp->fp[i]);
+			if (unix_get_socket(fp->fp[i]))
+				atomic_dec(&unix_sk(sock)->scm_stat.nr_unix_fds);
 			left = fp->count - 1 - i;
 			if (left) {
 				memmove(&fp->fp[i], &fp->fp[i + 1],
@@ -919,6 +946,61 @@ int io_sqe_files_register(struct io_ring_ctx *ctx, void __user *arg,
 	return ret;
 }
 
+static __cold int io_rsrc_data_grow(struct io_rsrc_data *data, unsigned nr)
+{
+	u64 **tags;
+	unsigned i;
+
+	tags = (u64 **)io_alloc_page_table(nr * sizeof(data->tags[0][0]));
+	if (!tags)
+		return -ENOMEM;
+
+	for (i = 0; i < data->nr; i += IO_RSRC_TAG_TABLE_MAX) {
+		unsigned int this_nr = min(data->nr - i, IO_RSRC_TAG_TABLE_MAX);
+
+		memcpy(tags[i >> IO_RSRC_TAG_TABLE_SHIFT], io_get_tag_slot(data, i),
+		       this_nr * sizeof(data->tags[0][0]));
+	}
+	io_free_page_table((void **)data->tags, data->nr * sizeof(data->tags[0][0]));
+	data->tags = tags;
+	data->nr = nr;
+	return 0;
+}
+
+/*
+ * Grow the registered file table in place. Existing slots keep their files
+ * and tags, and as nothing is removed there's no need to switch or quiesce
+ * rsrc nodes. New slots start out empty.
+ */
+int io_sqe_files_grow(struct io_ring_ctx *ctx, unsigned nr_files)
+{
+	unsigned old_nr = ctx->nr_user_files;
+	int ret;
+
+	if (!ctx->file_data)
+		return -ENXIO;
+	if (ctx->file_data->quiesce)
+		return -EBUSY;
+	if (nr_files <= old_nr)
+		return -EINVAL;
+	if (nr_files > IORING_MAX_FIXED_FILES)
+		return -EMFILE;
+	if (nr_files > rlimit(RLIMIT_NOFILE))
+		return -EMFILE;
+
+	ret = io_rsrc_data_grow(ctx->file_data, nr_files);
+	if (ret)
+		return ret;
+	if (!io_grow_file_tables(&ctx->file_table, old_nr, nr_files))
+		return -ENOMEM;
+
+	/* extend the allocation range if it covered the whole table */
+	if (ctx->file_alloc_start == 0 && ctx->file_alloc_end == old_nr)
+		ctx->file_alloc_end = nr_files;
+	ctx->nr_user_files = nr_files;
+	return 0;
+}
+
 static void io_rsrc_buf_put(struct io_ring_ctx *ctx, struct io_rsrc_put *prsrc)
 {
 	io_buffer_unmap(ctx, &prsrc->buf);
@@ -1132,6 +1214,7 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	imu->ubuf = (unsigned long) iov->iov_base;
 	imu->ubuf_end = imu->ubuf + iov->iov_len;
 	imu->nr_bvecs = nr_pages;
+	imu->release = NULL;
 	*pimu = imu;
 	ret = 0;
 
@@ -1228,6 +1311,9 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 	/* not inside the mapped region */
 	if (unlikely(buf_addr < imu->ubuf || buf_end > imu->ubuf_end))
 		return -EFAULT;
+	/* a buffer lent by a driver can only be used in one direction */
+	if (unlikely(imu->release && !(imu->dir & (1U << ddir))))
+		return -EFAULT;
 
 	/*
 	 * Might not be a start of buffer, set size appropriately
@@ -1236,7 +1322,10 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 	offset = buf_addr - imu->ubuf;
 	iov_iter_bvec(iter, ddir, imu->bvec, imu->nr_bvecs, offset + len);
 
-	if (offset) {
+	/* driver bvecs are of any size, take the slow path */
+	if (offset && imu->release) {
+		iov_iter_advance(iter, offset);
+	} else if (offset) {
 		/*
 		 * Don't use iov_iter_advance() here, as it's really slow for
 		 * using the latter parts of a big fixed buffer - it iterates
@@ -1281,3 +1370,196 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 
 	return 0;
 }
+
+/*
+ * Build a bvec table for IORING_OP_READV_FIXED/WRITEV_FIXED, covering the
+ * ranges of registered buffers described by the user's io_uring_fixed_vec
+ * array. The pages are already pinned, so this is just a table copy. The
+ * returned array backs @iter and must be freed with kvfree() by the caller.
+ */
+struct bio_vec *io_import_fixed_vec(int ddir, struct iov_iter *iter,
+				    struct io_ring_ctx *ctx, u64 uaddr,
+				    unsigned int nr_vecs)
+{
+	struct io_uring_fixed_vec *vecs;
+	struct bio_vec *bvec = NULL;
+	size_t total = 0, nr_segs = 0, nr = 0;
+	unsigned int i;
+	int ret;
+
+	if (!nr_vecs || nr_vecs > UIO_MAXIOV)
+		return ERR_PTR(-EINVAL);
+	vecs = memdup_user(u64_to_user_ptr(uaddr),
+			   array_size(nr_vecs, sizeof(*vecs)));
+	if (IS_ERR(vecs))
+		return ERR_CAST(vecs);
+
+	/*
+	 * Registered buffers consist of PAGE_SIZE bvecs, except possibly the
+	 * first and last one, or of larger folio sized ones. A range of len
+	 * bytes can thus span at most (len >> PAGE_SHIFT) + 2 entries.
+	 */
+	for (i = 0; i < nr_vecs; i++) {
+		struct io_uring_fixed_vec *v = &vecs[i];
+		struct io_mapped_ubuf *imu;
+
+		ret = -EINVAL;
+		if (v->resv)
+			goto err;
+		ret = -EFAULT;
+		if (unlikely(v->buf_index >= ctx->nr_user_bufs))
+			goto err;
+		imu = ctx->user_bufs[array_index_nospec(v->buf_index,
+							ctx->nr_user_bufs)];
+		total += v->len;
+		ret = -EINVAL;
+		if (total > MAX_RW_COUNT)
+			goto err;
+		if (imu->release)
+			nr_segs += imu->nr_bvecs;
+		else
+			nr_segs += min_t(size_t, imu->nr_bvecs,
+					 (v->len >> PAGE_SHIFT) + 2);
+	}
+
+	ret = -ENOMEM;
+	bvec = kvmalloc_array(nr_segs, sizeof(*bvec), GFP_KERNEL_ACCOUNT);
+	if (!bvec)
+		goto err;
+
+	for (i = 0; i < nr_vecs; i++) {
+		struct io_uring_fixed_vec *v = &vecs[i];
+		const struct bio_vec *src;
+		struct io_mapped_ubuf *imu;
+		struct iov_iter it;
+		size_t skip, left = v->len;
+		u64 addr;
+
+		imu = ctx->user_bufs[array_index_nospec(v->buf_index,
+							ctx->nr_user_bufs)];
+		ret = -EFAULT;
+		if (check_add_overflow(imu->ubuf, v->offset, &addr))
+			goto err;
+		ret = io_import_fixed(ddir, &it, imu, addr, v->len);
+		if (ret)
+			goto err;
+
+		src = it.bvec;
+		skip = it.iov_offset;
+		while (left) {
+			size_t n;
+
+			if (skip >= src->bv_len) {
+				skip -= src->bv_len;
+				src++;
+				continue;
+			}
+			n = min_t(size_t, src->bv_len - skip, left);
+			bvec_set_page(&bvec[nr++], src->bv_page, n,
+				      src->bv_offset + skip);
+			left -= n;
+			skip = 0;
+			src++;
+		}
+	}
+
+	kfree(vecs);
+	iov_iter_bvec(iter, ddir, bvec, nr, total);
+	return bvec;
+err:
+	kvfree(bvec);
+	kfree(vecs);
+	return ERR_PTR(ret);
+}
+
+/**
+ * io_buffer_register_bvec - lend the pages of a request as a fixed buffer
+ * @ioucmd:	uring_cmd issued on the ring to register the buffer into
+ * @rq:		request whose bvecs make up the buffer
+ * @release:	called with @rq once the buffer isn't used any more
+ * @index:	registered buffer slot, has to be empty
+ * @issue_flags: issue flags of @ioucmd
+ *
+ * The buffer is addressed by offset into @rq, i.e. its address range starts
+ * at 0, and can only be used in the data direction of @rq: a write request can
+ * be read from, a read request can be written to.
+ */
+int io_buffer_register_bvec(struct io_uring_cmd *ioucmd, struct request *rq,
+			    void (*release)(void *), unsigned int index,
+			    unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = cmd_to_io_kiocb(ioucmd)->ctx;
+	struct req_iterator rq_iter;
+	struct io_mapped_ubuf *imu;
+	unsigned int nr_bvecs = 0;
+	struct bio_vec bv;
+	int ret = 0;
+
+	rq_for_each_bvec(bv, rq, rq_iter)
+		nr_bvecs++;
+
+	imu = kvmalloc(struct_size(imu, bvec, nr_bvecs), GFP_KERNEL);
+	if (!imu)
+		return -ENOMEM;
+
+	imu->ubuf = 0;
+	imu->ubuf_end = blk_rq_bytes(rq);
+	imu->acct_pages = 0;
+	imu->release = release;
+	imu->priv = rq;
+	imu->dir = 1U << (op_is_write(req_op(rq)) ? ITER_SOURCE : ITER_DEST);
+	imu->nr_bvecs = 0;
+	rq_for_each_bvec(bv, rq, rq_iter)
+		imu->bvec[imu->nr_bvecs++] = bv;
+
+	io_ring_submit_lock(ctx, issue_flags);
+	if (!ctx->buf_data || index >= ctx->nr_user_bufs) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+	index = array_index_nospec(index, ctx->nr_user_bufs);
+	if (ctx->user_bufs[index] != ctx->dummy_ubuf) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+	ctx->user_bufs[index] = imu;
+unlock:
+	io_ring_submit_unlock(ctx, issue_flags);
+	if (ret)
+		kvfree(imu);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(io_buffer_register_bvec);
+
+/**
+ * io_buffer_unregister_bvec - give back a buffer of io_buffer_register_bvec()
+ * @ioucmd:	uring_cmd issued on the ring the buffer was registered into
+ * @index:	registered buffer slot
+ * @issue_flags: issue flags of @ioucmd
+ *
+ * The slot is emptied right away, the release callback runs once the
+ * requests still using the buffer have completed.
+ */
+int io_buffer_unregister_bvec(struct io_uring_cmd *ioucmd, unsigned int index,
+			      unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = cmd_to_io_kiocb(ioucmd)->ctx;
+	struct io_mapped_ubuf *imu;
+	int ret = -EINVAL;
+
+	io_ring_submit_lock(ctx, issue_flags);
+	if (!ctx->buf_data || index >= ctx->nr_user_bufs)
+		goto unlock;
+	index = array_index_nospec(index, ctx->nr_user_bufs);
+	imu = ctx->user_bufs[index];
+	if (imu == ctx->dummy_ubuf || !imu->release)
+		goto unlock;
+
+	ret = io_queue_rsrc_removal(ctx->buf_data, index, imu);
+	if (!ret)
+		ctx->user_bufs[index] = ctx->dummy_ubuf;
+unlock:
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(io_buffer_unregister_bvec);
@@ -54,6 +54,10 @@ struct io_mapped_ubuf {
 	u64		ubuf_end;
 	unsigned int	nr_bvecs;
 	unsigned long	acct_pages;
+	/* set for buffers lent by a driver, see io_buffer_register_bvec() */
+	void		(*release)(void *);
+	void		*priv;
+	u8		dir;
 	struct bio_vec	bvec[];
 };
 
@@ -66,6 +70,9 @@ int io_queue_rsrc_removal(struct io_rsrc_data *data, unsigned idx, void *rsrc);
 int io_import_fixed(int ddir, struct iov_iter *iter,
 			   struct io_mapped_ubuf *imu,
 			   u64 buf_addr, size_t len);
+struct bio_vec *io_import_fixed_vec(int ddir, struct iov_iter *iter,
+				    struct io_ring_ctx *ctx, u64 uaddr,
+				    unsigned int nr_vecs);
 
 void __io_sqe_buffers_unregister(struct io_ring_ctx *ctx);
 int io_sqe_buffers_unregister(struct io_ring_ctx *ctx);
@@ -75,6 +82,7 @@ void __io_sqe_files_unregister(struct io_ring_ctx *ctx);
 int io_sqe_files_unregister(struct io_ring_ctx *ctx);
 int io_sqe_files_register(struct io_ring_ctx *ctx, void __user *arg,
 			  unsigned nr_args, u64 __user *tags);
+int io_sqe_files_grow(struct io_ring_ctx *ctx, unsigned nr_files);
 
 int __io_scm_file_account(struct io_ring_ctx *ctx, struct file *file);
 
@@ -11,6 +11,7 @@
 #include <linux/nospec.h>
 #include <linux/compat.h>
 #include <linux/io_uring.h>
+#include <linux/sched/cpufreq.h>
 
 #include <uapi/linux/io_uring.h>
 
@@ -73,6 +74,38 @@ static int io_iov_buffer_select_prep(struct io_kiocb *req)
 	return 0;
 }
 
+/*
+ * The bvec table for vectored fixed buffers is built once at prep time and
+ * lives in ->async_data, so every issue attempt runs off the saved iterator.
+ */
+static int io_prep_rw_fixed_vec(struct io_kiocb *req)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_async_rw *io;
+	struct bio_vec *bvec;
+	int ddir;
+
+	if (req->buf_index)
+		return -EINVAL;
+	if (io_alloc_async_data(req))
+		return -ENOMEM;
+	io = req->async_data;
+
+	ddir = req->opcode == IORING_OP_READV_FIXED ? ITER_DEST : ITER_SOURCE;
+	io_req_set_rsrc_node(req, ctx, 0);
+	bvec = io_import_fixed_vec(ddir, &io->s.iter, ctx, rw->addr, rw->len);
+	if (IS_ERR(bvec))
+		return PTR_ERR(bvec);
+
+	io->free_iovec = NULL;
+	io->free_bvec = bvec;
+	io->bytes_done = 0;
+	iov_iter_save_state(&io->s.iter, &io->s.iter_state);
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+
 int io_prep_rw(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
@@ -110,6 +143,10 @@ int io_prep_rw(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	rw->len = READ_ONCE(sqe->len);
 	rw->flags = READ_ONCE(sqe->rw_flags);
 
+	if (req->opcode == IORING_OP_READV_FIXED ||
+	    req->opcode == IORING_OP_WRITEV_FIXED)
+		return io_prep_rw_fixed_vec(req);
+
 	/* Have to do this validation here, as this is in io_read() rw->len might
 	 * have chanaged due to buffer selection
 	 */
@@ -129,6 +166,13 @@ void io_readv_writev_cleanup(struct io_kiocb *req)
 	kfree(io->free_iovec);
 }
 
+void io_rw_fixed_vec_cleanup(struct io_kiocb *req)
+{
+	struct io_async_rw *io = req->async_data;
+
+	kvfree(io->free_bvec);
+}
+
 static inline void io_rw_done(struct kiocb *kiocb, ssize_t ret)
 {
 	switch (ret) {
@@ -371,6 +415,11 @@ static struct iovec *__io_import_iovec(int ddir, struct io_kiocb *req,
 	size_t sqe_len;
 	ssize_t ret;
 
+	/* always imported at prep time, see io_prep_rw_fixed_vec() */
+	if (WARN_ON_ONCE(opcode == IORING_OP_READV_FIXED ||
+			 opcode == IORING_OP_WRITEV_FIXED))
+		return ERR_PTR(-EFAULT);
+
 	if (opcode == IORING_OP_READ_FIXED || opcode == IORING_OP_WRITE_FIXED) {
 		ret = io_import_fixed(ddir, iter, req->imu, rw->addr, rw->len);
 		if (ret)
@@ -432,6 +481,7 @@ static ssize_t loop_rw_iter(int ddir, struct io_rw *rw, struct iov_iter *iter)
 	struct file *file = kiocb->ki_filp;
 	ssize_t ret = 0;
 	loff_t *ppos;
+	u8 opcode;
 
 	/*
 	 * Don't support polled IO through this interface, and we can't
@@ -440,6 +490,10 @@ static ssize_t loop_rw_iter(int ddir, struct io_rw *rw, struct iov_iter *iter)
 	 */
 	if (kiocb->ki_flags & IOCB_HIPRI)
 		return -EOPNOTSUPP;
+	/* ->addr and ->len describe the vec array, not a user buffer */
+	opcode = cmd_to_io_kiocb(rw)->opcode;
+	if (opcode == IORING_OP_READV_FIXED || opcode == IORING_OP_WRITEV_FIXED)
+		return -EOPNOTSUPP;
 	if ((kiocb->ki_flags & IOCB_NOWAIT) &&
 	    !(kiocb->ki_filp->f_flags & O_NONBLOCK))
 		return -EAGAIN;
@@ -1074,6 +1128,8 @@ int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 	if (unlikely(!nr_events))
 		return 0;
 
+	/* polled completions never hit iowait, tell schedutil directly */
+	cpufreq_io_boost_hint();
 	io_commit_cqring(ctx);
 	io_cqring_ev_posted_iopoll(ctx);
 	pos = start ? start->next : ctx->iopoll_list.first;
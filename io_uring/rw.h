@@ -11,6 +11,8 @@ struct io_rw_state {
 struct io_async_rw {
 	struct io_rw_state		s;
 	const struct iovec		*free_iovec;
+	/* bvec table for READV_FIXED/WRITEV_FIXED */
+	struct bio_vec			*free_bvec;
 	size_t				bytes_done;
 	struct wait_page_queue		wpq;
 };
@@ -21,5 +23,6 @@ int io_readv_prep_async(struct io_kiocb *req);
 int io_write(struct io_kiocb *req, unsigned int issue_flags);
 int io_writev_prep_async(struct io_kiocb *req);
 void io_readv_writev_cleanup(struct io_kiocb *req);
+void io_rw_fixed_vec_cleanup(struct io_kiocb *req);
 void io_rw_fail(struct io_kiocb *req);
 void io_req_rw_complete(struct io_kiocb *req, struct io_tw_state *ts);
@@ -18,6 +18,7 @@
 #include "sqpoll.h"
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
+#define IORING_SQPOLL_MAX_WEIGHT	64
 
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
@@ -170,9 +171,17 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	int ret = 0;
 
 	to_submit = io_sqring_entries(ctx);
-	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	/*
+	 * If we're handling multiple rings, cap submit size for fairness.
+	 * Each ring gets a budget per pass in proportion to its weight.
+	 */
+	if (cap_entries) {
+		unsigned int budget = IORING_SQPOLL_CAP_ENTRIES_VALUE *
+					READ_ONCE(ctx->sq_thread_weight);
+
+		if (to_submit > budget)
+			to_submit = budget;
+	}
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
@@ -202,6 +211,55 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	return ret;
 }
 
+/*
+ * A ring that has been idle for its own idle period while the thread is kept
+ * busy by other rings gets parked: it's flagged with IORING_SQ_NEED_WAKEUP and
+ * skipped until the application enters with IORING_ENTER_SQ_WAKEUP, just like
+ * it would if the thread had gone to sleep.
+ */
+static void io_sq_park_ring(struct io_ring_ctx *ctx)
+{
+	WRITE_ONCE(ctx->sq_parked, true);
+	ctx->sq_thread_parked = true;
+	smp_mb__before_atomic();
+	atomic_or(IORING_SQ_NEED_WAKEUP, &ctx->rings->sq_flags);
+	/*
+	 * Ensure the store of the wakeup flag is not reordered with the
+	 * load of the SQ tail, new entries mean we must not skip it.
+	 */
+	smp_mb__after_atomic();
+	if (io_sqring_entries(ctx))
+		WRITE_ONCE(ctx->sq_parked, false);
+}
+
+/* returns true if the ring should be skipped on this pass */
+static bool io_sq_ring_parked(struct io_ring_ctx *ctx)
+{
+	if (READ_ONCE(ctx->sq_parked))
+		return true;
+	if (ctx->sq_thread_parked) {
+		ctx->sq_thread_parked = false;
+		atomic_andnot(IORING_SQ_NEED_WAKEUP, &ctx->rings->sq_flags);
+		ctx->sq_idle_deadline = jiffies + ctx->sq_thread_idle;
+	}
+	return false;
+}
+
+static void io_sq_unpark_all(struct io_sq_data *sqd)
+{
+	struct io_ring_ctx *ctx;
+
+	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
+		if (ctx->sq_thread_parked) {
+			WRITE_ONCE(ctx->sq_parked, false);
+			ctx->sq_thread_parked = false;
+			atomic_andnot(IORING_SQ_NEED_WAKEUP,
+					&ctx->rings->sq_flags);
+		}
+		ctx->sq_idle_deadline = jiffies + ctx->sq_thread_idle;
+	}
+}
+
 static bool io_sqd_handle_event(struct io_sq_data *sqd)
 {
 	bool did_sig = false;
@@ -242,14 +300,25 @@ static int io_sq_thread(void *data)
 			if (io_sqd_handle_event(sqd))
 				break;
 			timeout = jiffies + sqd->sq_thread_idle;
+			/* the ring list may have changed */
+			io_sq_unpark_all(sqd);
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
 		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
-			int ret = __io_sq_thread(ctx, cap_entries);
+			int ret;
 
-			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
+			if (cap_entries && io_sq_ring_parked(ctx))
+				continue;
+
+			ret = __io_sq_thread(ctx, cap_entries);
+			if (ret > 0 || !wq_list_empty(&ctx->iopoll_list)) {
 				sqt_spin = true;
+				ctx->sq_idle_deadline = jiffies + ctx->sq_thread_idle;
+			} else if (cap_entries &&
+				   time_after(jiffies, ctx->sq_idle_deadline)) {
+				io_sq_park_ring(ctx);
+			}
 		}
 		if (io_run_task_work())
 			sqt_spin = true;
@@ -298,6 +367,7 @@ static int io_sq_thread(void *data)
 			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
 				atomic_andnot(IORING_SQ_NEED_WAKEUP,
 						&ctx->rings->sq_flags);
+			io_sq_unpark_all(sqd);
 		}
 
 		finish_wait(&sqd->wait, &wait);
@@ -332,6 +402,17 @@ void io_sqpoll_wait_sq(struct io_ring_ctx *ctx)
 	finish_wait(&ctx->sqo_sq_wait, &wait);
 }
 
+int io_sqpoll_set_weight(struct io_ring_ctx *ctx, unsigned int weight)
+{
+	if (!(ctx->flags & IORING_SETUP_SQPOLL) || !ctx->sq_data)
+		return -EINVAL;
+	if (!weight || weight > IORING_SQPOLL_MAX_WEIGHT)
+		return -EINVAL;
+
+	WRITE_ONCE(ctx->sq_thread_weight, weight);
+	return 0;
+}
+
 __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 				struct io_uring_params *p)
 {
@@ -371,6 +452,8 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
+		ctx->sq_thread_weight = 1;
+		ctx->sq_idle_deadline = jiffies + ctx->sq_thread_idle;
 
 		io_sq_thread_park(sqd);
 		list_add(&ctx->sqd_list, &sqd->ctx_list);
@@ -27,3 +27,13 @@ void io_sq_thread_park(struct io_sq_data *sqd);
 void io_sq_thread_unpark(struct io_sq_data *sqd);
 void io_put_sq_data(struct io_sq_data *sqd);
 void io_sqpoll_wait_sq(struct io_ring_ctx *ctx);
+int io_sqpoll_set_weight(struct io_ring_ctx *ctx, unsigned int weight);
+
+/*
+ * Unpark a ring the SQPOLL thread stopped looking at, see io_sq_park_ring().
+ */
+static inline void io_sqpoll_unpark(struct io_ring_ctx *ctx)
+{
+	if (READ_ONCE(ctx->sq_parked))
+		WRITE_ONCE(ctx->sq_parked, false);
+}
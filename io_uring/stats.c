@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <linux/seq_file.h>
+#include <linux/io_uring.h>
+
+#include <uapi/linux/io_uring.h>
+
+#include "io_uring.h"
+#include "opdef.h"
+#include "stats.h"
+
+static void io_stats_account(struct io_kiocb *req, int hist, u32 now)
+{
+	struct io_ring_stats __percpu *stats = READ_ONCE(req->ctx->op_stats);
+	u32 delta;
+	int bucket;
+
+	if (!stats)
+		return;
+
+	delta = ((now >> IO_STAT_TIME_SHIFT) -
+		 (req->stats_time >> IO_STAT_TIME_SHIFT)) & IO_STAT_TIME_MASK;
+	bucket = min_t(int, fls(delta), IO_STAT_NR_BUCKETS - 1);
+	this_cpu_inc(stats->ops[req->opcode].hist[hist][bucket]);
+}
+
+void __io_stats_issue(struct io_kiocb *req)
+{
+	u32 now = io_stats_stamp();
+
+	/* only the first issue counts towards submit to issue latency */
+	if (!(req->stats_time & IO_STAT_ISSUED))
+		io_stats_account(req, IO_STAT_SUBMIT_TO_ISSUE, now);
+	req->stats_time = now | IO_STAT_ISSUED;
+}
+
+void __io_stats_complete(struct io_kiocb *req)
+{
+	if (req->stats_time & IO_STAT_ISSUED)
+		io_stats_account(req, IO_STAT_ISSUE_TO_COMPLETE,
+				 io_stats_stamp());
+	req->stats_time = 0;
+}
+
+void __io_stats_count(struct io_kiocb *req, bool poll)
+{
+	struct io_ring_stats __percpu *stats = READ_ONCE(req->ctx->op_stats);
+
+	if (!stats)
+		return;
+	if (poll)
+		this_cpu_inc(stats->ops[req->opcode].nr_poll);
+	else
+		this_cpu_inc(stats->ops[req->opcode].nr_iowq);
+}
+
+/*
+ * Turning stats off just stops collection, the counters are kept around
+ * until the ring goes away as requests in flight may still reference them.
+ */
+int io_register_op_stats(struct io_ring_ctx *ctx, unsigned int enable)
+{
+	if (enable > 1)
+		return -EINVAL;
+	if (!enable) {
+		WRITE_ONCE(ctx->op_stats, NULL);
+		return 0;
+	}
+
+	if (!ctx->op_stats_mem) {
+		ctx->op_stats_mem = alloc_percpu_gfp(struct io_ring_stats,
+						     GFP_KERNEL_ACCOUNT);
+		if (!ctx->op_stats_mem)
+			return -ENOMEM;
+	}
+	WRITE_ONCE(ctx->op_stats, ctx->op_stats_mem);
+	return 0;
+}
+
+void io_free_op_stats(struct io_ring_ctx *ctx)
+{
+	free_percpu(ctx->op_stats_mem);
+	ctx->op_stats_mem = NULL;
+}
+
+#ifdef CONFIG_PROC_FS
+static void io_show_op_hist(struct seq_file *m, const char *name,
+			    const unsigned long *hist)
+{
+	int i;
+
+	seq_printf(m, "    %s:", name);
+	for (i = 0; i < IO_STAT_NR_BUCKETS; i++)
+		seq_printf(m, " %lu", hist[i]);
+	seq_putc(m, '\n');
+}
+
+__cold void io_show_op_stats(struct io_ring_ctx *ctx, struct seq_file *m)
+{
+	struct io_op_stats *sum;
+	int op, cpu;
+
+	if (!ctx->op_stats_mem)
+		return;
+	sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return;
+
+	seq_printf(m, "OpStats:\t%s\n", ctx->op_stats ? "on" : "off");
+	for (op = 0; op < IORING_OP_LAST; op++) {
+		int h, b;
+
+		memset(sum, 0, sizeof(*sum));
+		for_each_possible_cpu(cpu) {
+			struct io_op_stats *s;
+
+			s = &per_cpu_ptr(ctx->op_stats_mem, cpu)->ops[op];
+			for (h = 0; h < IO_STAT_NR_HIST; h++)
+				for (b = 0; b < IO_STAT_NR_BUCKETS; b++)
+					sum->hist[h][b] += READ_ONCE(s->hist[h][b]);
+			sum->nr_iowq += READ_ONCE(s->nr_iowq);
+			sum->nr_poll += READ_ONCE(s->nr_poll);
+		}
+		if (!memchr_inv(sum, 0, sizeof(*sum)))
+			continue;
+
+		seq_printf(m, "  %s: iowq=%lu poll=%lu\n",
+			   io_uring_get_opcode(op), sum->nr_iowq, sum->nr_poll);
+		io_show_op_hist(m, "submit_issue",
+				sum->hist[IO_STAT_SUBMIT_TO_ISSUE]);
+		io_show_op_hist(m, "issue_complete",
+				sum->hist[IO_STAT_ISSUE_TO_COMPLETE]);
+	}
+	kfree(sum);
+}
+#endif
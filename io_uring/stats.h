@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef IOU_STATS_H
+#define IOU_STATS_H
+
+#include <linux/io_uring_types.h>
+#include <linux/timekeeping.h>
+#include <uapi/linux/io_uring.h>
+
+/*
+ * Optional per-opcode latency statistics, enabled per ring with
+ * IORING_REGISTER_OP_STATS. req->stats_time holds a timestamp in units of
+ * 1024ns in the upper 30 bits, with the low bits tracking request state. A
+ * zero value means the request isn't tracked.
+ */
+#define IO_STAT_TRACKED		1U
+#define IO_STAT_ISSUED		2U
+#define IO_STAT_TIME_SHIFT	2
+#define IO_STAT_TIME_MASK	(U32_MAX >> IO_STAT_TIME_SHIFT)
+
+enum {
+	IO_STAT_SUBMIT_TO_ISSUE,
+	IO_STAT_ISSUE_TO_COMPLETE,
+	IO_STAT_NR_HIST,
+};
+
+/* bucket N counts latencies below ~2^N usec, the last one counts the rest */
+#define IO_STAT_NR_BUCKETS	20
+
+struct io_op_stats {
+	unsigned long		hist[IO_STAT_NR_HIST][IO_STAT_NR_BUCKETS];
+	unsigned long		nr_iowq;
+	unsigned long		nr_poll;
+};
+
+struct io_ring_stats {
+	struct io_op_stats	ops[IORING_OP_LAST];
+};
+
+int io_register_op_stats(struct io_ring_ctx *ctx, unsigned int enable);
+void io_free_op_stats(struct io_ring_ctx *ctx);
+void io_show_op_stats(struct io_ring_ctx *ctx, struct seq_file *m);
+
+void __io_stats_issue(struct io_kiocb *req);
+void __io_stats_complete(struct io_kiocb *req);
+void __io_stats_count(struct io_kiocb *req, bool poll);
+
+static inline u32 io_stats_stamp(void)
+{
+	return ((u32)(ktime_get_ns() >> 10) << IO_STAT_TIME_SHIFT) |
+		IO_STAT_TRACKED;
+}
+
+static inline void io_stats_init_req(struct io_ring_ctx *ctx,
+				     struct io_kiocb *req)
+{
+	req->stats_time = 0;
+	if (unlikely(READ_ONCE(ctx->op_stats)))
+		req->stats_time = io_stats_stamp();
+}
+
+static inline void io_stats_issue(struct io_kiocb *req)
+{
+	if (unlikely(req->stats_time))
+		__io_stats_issue(req);
+}
+
+static inline void io_stats_complete(struct io_kiocb *req)
+{
+	if (unlikely(req->stats_time))
+		__io_stats_complete(req);
+}
+
+static inline void io_stats_iowq(struct io_kiocb *req)
+{
+	if (unlikely(req->stats_time))
+		__io_stats_count(req, false);
+}
+
+static inline void io_stats_poll(struct io_kiocb *req)
+{
+	if (unlikely(req->stats_time))
+		__io_stats_count(req, true);
+}
+#endif
@@ -64,6 +64,57 @@ static inline bool io_timeout_finish(struct io_timeout *timeout,
 }
 
 static enum hrtimer_restart io_timeout_fn(struct hrtimer *timer);
+static enum hrtimer_restart io_link_timeout_fn(struct hrtimer *timer);
+static void io_timeout_wheel_fn(struct timer_list *t);
+static void io_link_timeout_wheel_fn(struct timer_list *t);
+
+static clockid_t io_timeout_get_clock(struct io_timeout_data *data);
+
+/*
+ * IORING_TIMEOUT_COARSE timeouts use a timer_list instead of an hrtimer. The
+ * timer wheel trades precision for O(1) arming and cancellation, which is
+ * what large numbers of mostly idle timeouts want. Coarse timeouts are
+ * CLOCK_MONOTONIC only.
+ */
+static void io_timeout_init_timer(struct io_timeout_data *data,
+				  enum hrtimer_mode mode)
+{
+	if (data->flags & IORING_TIMEOUT_COARSE)
+		timer_setup(&data->wheel, io_timeout_wheel_fn, 0);
+	else
+		hrtimer_init(&data->timer, io_timeout_get_clock(data), mode);
+}
+
+static void io_timeout_start(struct io_timeout_data *data,
+			     const struct timespec64 *ts,
+			     enum hrtimer_mode mode, bool link)
+{
+	ktime_t expires = timespec64_to_ktime(*ts);
+
+	if (data->flags & IORING_TIMEOUT_COARSE) {
+		struct timespec64 rel;
+
+		if (mode == HRTIMER_MODE_ABS)
+			expires = max_t(ktime_t, ktime_sub(expires, ktime_get()), 0);
+		rel = ktime_to_timespec64(expires);
+		data->wheel.function = link ? io_link_timeout_wheel_fn
+					    : io_timeout_wheel_fn;
+		/* rounds up, so we never fire early */
+		mod_timer(&data->wheel, jiffies + timespec64_to_jiffies(&rel));
+		return;
+	}
+
+	data->timer.function = link ? io_link_timeout_fn : io_timeout_fn;
+	hrtimer_start(&data->timer, expires, mode);
+}
+
+/* same return values as hrtimer_try_to_cancel(), -1 if the timer is firing */
+static int io_timeout_try_cancel(struct io_timeout_data *data)
+{
+	if (data->flags & IORING_TIMEOUT_COARSE)
+		return try_to_del_timer_sync(&data->wheel);
+	return hrtimer_try_to_cancel(&data->timer);
+}
 
 static void io_timeout_complete(struct io_kiocb *req, struct io_tw_state *ts)
 {
@@ -79,8 +130,7 @@ static void io_timeout_complete(struct io_kiocb *req, struct io_tw_state *ts)
 			/* re-arm timer */
 			spin_lock_irq(&ctx->timeout_lock);
 			list_add(&timeout->list, ctx->timeout_list.prev);
-			data->timer.function = io_timeout_fn;
-			hrtimer_start(&data->timer, timespec64_to_ktime(data->ts), data->mode);
+			io_timeout_start(data, &data->ts, data->mode, false);
 			spin_unlock_irq(&ctx->timeout_lock);
 			return;
 		}
@@ -94,7 +144,7 @@ static bool io_kill_timeout(struct io_kiocb *req, int status)
 {
 	struct io_timeout_data *io = req->async_data;
 
-	if (hrtimer_try_to_cancel(&io->timer) != -1) {
+	if (io_timeout_try_cancel(io) != -1) {
 		struct io_timeout *timeout = io_kiocb_to_cmd(req, struct io_timeout);
 
 		if (status)
@@ -225,7 +275,7 @@ struct io_kiocb *__io_disarm_linked_timeout(struct io_kiocb *req,
 
 	io_remove_next_linked(req);
 	timeout->head = NULL;
-	if (hrtimer_try_to_cancel(&io->timer) != -1) {
+	if (io_timeout_try_cancel(io) != -1) {
 		list_del(&timeout->list);
 		return link;
 	}
@@ -233,10 +283,8 @@ struct io_kiocb *__io_disarm_linked_timeout(struct io_kiocb *req,
 	return NULL;
 }
 
-static enum hrtimer_restart io_timeout_fn(struct hrtimer *timer)
+static void __io_timeout_fn(struct io_timeout_data *data)
 {
-	struct io_timeout_data *data = container_of(timer,
-						struct io_timeout_data, timer);
 	struct io_kiocb *req = data->req;
 	struct io_timeout *timeout = io_kiocb_to_cmd(req, struct io_timeout);
 	struct io_ring_ctx *ctx = req->ctx;
@@ -254,9 +302,21 @@ static enum hrtimer_restart io_timeout_fn(struct hrtimer *timer)
 	io_req_set_res(req, -ETIME, 0);
 	req->io_task_work.func = io_timeout_complete;
 	io_req_task_work_add(req);
+}
+
+static enum hrtimer_restart io_timeout_fn(struct hrtimer *timer)
+{
+	__io_timeout_fn(container_of(timer, struct io_timeout_data, timer));
 	return HRTIMER_NORESTART;
 }
 
+static void io_timeout_wheel_fn(struct timer_list *t)
+{
+	struct io_timeout_data *data = from_timer(data, t, wheel);
+
+	__io_timeout_fn(data);
+}
+
 static struct io_kiocb *io_timeout_extract(struct io_ring_ctx *ctx,
 					   struct io_cancel_data *cd)
 	__must_hold(&ctx->timeout_lock)
@@ -283,7 +343,7 @@ static struct io_kiocb *io_timeout_extract(struct io_ring_ctx *ctx,
 		return ERR_PTR(-ENOENT);
 
 	io = req->async_data;
-	if (hrtimer_try_to_cancel(&io->timer) == -1)
+	if (io_timeout_try_cancel(io) == -1)
 		return ERR_PTR(-EALREADY);
 	timeout = io_kiocb_to_cmd(req, struct io_timeout);
 	list_del_init(&timeout->list);
@@ -330,10 +390,8 @@ static void io_req_task_link_timeout(struct io_kiocb *req, struct io_tw_state *t
 	}
 }
 
-static enum hrtimer_restart io_link_timeout_fn(struct hrtimer *timer)
+static void __io_link_timeout_fn(struct io_timeout_data *data)
 {
-	struct io_timeout_data *data = container_of(timer,
-						struct io_timeout_data, timer);
 	struct io_kiocb *prev, *req = data->req;
 	struct io_timeout *timeout = io_kiocb_to_cmd(req, struct io_timeout);
 	struct io_ring_ctx *ctx = req->ctx;
@@ -358,9 +416,21 @@ static enum hrtimer_restart io_link_timeout_fn(struct hrtimer *timer)
 
 	req->io_task_work.func = io_req_task_link_timeout;
 	io_req_task_work_add(req);
+}
+
+static enum hrtimer_restart io_link_timeout_fn(struct hrtimer *timer)
+{
+	__io_link_timeout_fn(container_of(timer, struct io_timeout_data, timer));
 	return HRTIMER_NORESTART;
 }
 
+static void io_link_timeout_wheel_fn(struct timer_list *t)
+{
+	struct io_timeout_data *data = from_timer(data, t, wheel);
+
+	__io_link_timeout_fn(data);
+}
+
 static clockid_t io_timeout_get_clock(struct io_timeout_data *data)
 {
 	switch (data->flags & IORING_TIMEOUT_CLOCK_MASK) {
@@ -397,11 +467,10 @@ static int io_linked_timeout_update(struct io_ring_ctx *ctx, __u64 user_data,
 		return -ENOENT;
 
 	io = req->async_data;
-	if (hrtimer_try_to_cancel(&io->timer) == -1)
+	if (io_timeout_try_cancel(io) == -1)
 		return -EALREADY;
-	hrtimer_init(&io->timer, io_timeout_get_clock(io), mode);
-	io->timer.function = io_link_timeout_fn;
-	hrtimer_start(&io->timer, timespec64_to_ktime(*ts), mode);
+	io_timeout_init_timer(io, mode);
+	io_timeout_start(io, ts, mode, true);
 	return 0;
 }
 
@@ -420,9 +489,8 @@ static int io_timeout_update(struct io_ring_ctx *ctx, __u64 user_data,
 	timeout->off = 0; /* noseq */
 	data = req->async_data;
 	list_add_tail(&timeout->list, &ctx->timeout_list);
-	hrtimer_init(&data->timer, io_timeout_get_clock(data), mode);
-	data->timer.function = io_timeout_fn;
-	hrtimer_start(&data->timer, timespec64_to_ktime(*ts), mode);
+	io_timeout_init_timer(data, mode);
+	io_timeout_start(data, ts, mode, false);
 	return 0;
 }
 
@@ -511,11 +579,15 @@ static int __io_timeout_prep(struct io_kiocb *req,
 	flags = READ_ONCE(sqe->timeout_flags);
 	if (flags & ~(IORING_TIMEOUT_ABS | IORING_TIMEOUT_CLOCK_MASK |
 		      IORING_TIMEOUT_ETIME_SUCCESS |
-		      IORING_TIMEOUT_MULTISHOT))
+		      IORING_TIMEOUT_MULTISHOT | IORING_TIMEOUT_COARSE))
 		return -EINVAL;
 	/* more than one clock specified is invalid, obviously */
 	if (hweight32(flags & IORING_TIMEOUT_CLOCK_MASK) > 1)
 		return -EINVAL;
+	/* the timer wheel only runs off jiffies, i.e. CLOCK_MONOTONIC */
+	if ((flags & IORING_TIMEOUT_COARSE) &&
+	    (flags & IORING_TIMEOUT_CLOCK_MASK))
+		return -EINVAL;
 	/* multishot requests only make sense with rel values */
 	if (!(~flags & (IORING_TIMEOUT_MULTISHOT | IORING_TIMEOUT_ABS)))
 		return -EINVAL;
@@ -549,7 +621,7 @@ static int __io_timeout_prep(struct io_kiocb *req,
 
 	INIT_LIST_HEAD(&timeout->list);
 	data->mode = io_translate_timeout_mode(flags);
-	hrtimer_init(&data->timer, io_timeout_get_clock(data), data->mode);
+	io_timeout_init_timer(data, data->mode);
 
 	if (is_timeout_link) {
 		struct io_submit_link *link = &req->ctx->submit_state.link;
@@ -558,6 +630,9 @@ static int __io_timeout_prep(struct io_kiocb *req,
 			return -EINVAL;
 		if (link->last->opcode == IORING_OP_LINK_TIMEOUT)
 			return -EINVAL;
+		/* parallel link groups don't support linked timeouts */
+		if (link->last_in_group || (req->flags & REQ_F_IO_PARALLEL))
+			return -EINVAL;
 		timeout->head = link->last;
 		link->last->flags |= REQ_F_ARM_LTIMEOUT;
 	}
@@ -619,8 +694,7 @@ int io_timeout(struct io_kiocb *req, unsigned int issue_flags)
 	}
 add:
 	list_add(&timeout->list, entry);
-	data->timer.function = io_timeout_fn;
-	hrtimer_start(&data->timer, timespec64_to_ktime(data->ts), data->mode);
+	io_timeout_start(data, &data->ts, data->mode, false);
 	spin_unlock_irq(&ctx->timeout_lock);
 	return IOU_ISSUE_SKIP_COMPLETE;
 }
@@ -638,9 +712,7 @@ void io_queue_linked_timeout(struct io_kiocb *req)
 	if (timeout->head) {
 		struct io_timeout_data *data = req->async_data;
 
-		data->timer.function = io_link_timeout_fn;
-		hrtimer_start(&data->timer, timespec64_to_ktime(data->ts),
-				data->mode);
+		io_timeout_start(data, &data->ts, data->mode, true);
 		list_add_tail(&timeout->list, &ctx->ltimeout_list);
 	}
 	spin_unlock_irq(&ctx->timeout_lock);
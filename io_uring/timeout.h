@@ -2,7 +2,11 @@
 
 struct io_timeout_data {
 	struct io_kiocb			*req;
-	struct hrtimer			timer;
+	union {
+		struct hrtimer		timer;
+		/* IORING_TIMEOUT_COARSE, backed by the timer wheel */
+		struct timer_list	wheel;
+	};
 	struct timespec64		ts;
 	enum hrtimer_mode		mode;
 	u32				flags;
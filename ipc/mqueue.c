@@ -16,6 +16,7 @@
 #include <linux/capability.h>
 #include <linux/init.h>
 #include <linux/pagemap.h>
+#include <linux/highmem.h>
 #include <linux/file.h>
 #include <linux/mount.h>
 #include <linux/fs_context.h>
@@ -57,6 +58,7 @@ struct mqueue_fs_context {
 
 #define STATE_NONE	0
 #define STATE_READY	1
+#define STATE_CLAIMED	2
 
 struct posix_msg_tree_node {
 	struct rb_node		rb_node;
@@ -122,6 +124,15 @@ struct posix_msg_tree_node {
  *    release memory barrier, and the wakeup is triggered when holding
  *    info->lock, i.e. spin_lock(&info->lock) provided a pairing
  *    acquire memory barrier.
+ *
+ * MQ_RECV_DIRECT:
+ * A receiver that pinned its buffer can be taken off the wait queue by a
+ * sender without a message attached, it is then in STATE_CLAIMED while the
+ * sender copies into the pinned pages with info->lock dropped. The receiver
+ * must not return before the sender is done, so it waits uninterruptibly for
+ * the state to leave STATE_CLAIMED. The sender either completes the receive
+ * with STATE_READY as above, or puts the receiver back on the wait queue with
+ * STATE_NONE, in both cases under info->lock.
  */
 
 struct ext_wait_queue {		/* queue of sleeping tasks */
@@ -129,6 +140,10 @@ struct ext_wait_queue {		/* queue of sleeping tasks */
 	struct list_head list;
 	struct msg_msg *msg;	/* ptr of loaded message */
 	int state;		/* one of STATE_* values */
+	struct page **pages;	/* pinned receive buffer, see MQ_RECV_DIRECT */
+	unsigned int nr_pages;
+	size_t direct_len;	/* message copied directly into pages */
+	unsigned int direct_prio;
 };
 
 struct mqueue_inode_info {
@@ -151,6 +166,7 @@ struct mqueue_inode_info {
 
 	/* for tasks waiting for free space and messages, respectively */
 	struct ext_wait_queue e_wait_q[2];
+	unsigned int nr_direct;	/* receivers waiting with a pinned buffer */
 
 	unsigned long qsize; /* size of queue in memory (sum of all msgs) */
 };
@@ -703,6 +719,15 @@ static void wq_add(struct mqueue_inode_info *info, int sr,
 		}
 	}
 	list_add_tail(&ewp->list, &info->e_wait_q[sr].list);
+	if (ewp->pages)
+		info->nr_direct++;
+}
+
+static void wq_del(struct mqueue_inode_info *info, struct ext_wait_queue *ewp)
+{
+	list_del(&ewp->list);
+	if (ewp->pages)
+		info->nr_direct--;
 }
 
 /*
@@ -735,6 +760,14 @@ static int wq_sleep(struct mqueue_inode_info *info, int sr,
 		}
 		spin_lock(&info->lock);
 
+		/* a sender is copying into our pinned buffer */
+		while (READ_ONCE(ewp->state) == STATE_CLAIMED) {
+			__set_current_state(TASK_UNINTERRUPTIBLE);
+			spin_unlock(&info->lock);
+			schedule();
+			spin_lock(&info->lock);
+		}
+
 		/* we hold info->lock, so no memory barrier required */
 		if (READ_ONCE(ewp->state) == STATE_READY) {
 			retval = 0;
@@ -749,7 +782,7 @@ static int wq_sleep(struct mqueue_inode_info *info, int sr,
 			break;
 		}
 	}
-	list_del(&ewp->list);
+	wq_del(info, ewp);
 out_unlock:
 	spin_unlock(&info->lock);
 out:
@@ -1013,20 +1046,24 @@ SYSCALL_DEFINE1(mq_unlink, const char __user *, u_name)
  * The same algorithm is used for senders.
  */
 
-static inline void __pipelined_op(struct wake_q_head *wake_q,
-				  struct mqueue_inode_info *info,
-				  struct ext_wait_queue *this)
+static inline void __pipelined_wake(struct wake_q_head *wake_q,
+				    struct ext_wait_queue *this)
 {
-	struct task_struct *task;
-
-	list_del(&this->list);
-	task = get_task_struct(this->task);
+	struct task_struct *task = get_task_struct(this->task);
 
 	/* see MQ_BARRIER for purpose/pairing */
 	smp_store_release(&this->state, STATE_READY);
 	wake_q_add_safe(wake_q, task);
 }
 
+static inline void __pipelined_op(struct wake_q_head *wake_q,
+				  struct mqueue_inode_info *info,
+				  struct ext_wait_queue *this)
+{
+	wq_del(info, this);
+	__pipelined_wake(wake_q, this);
+}
+
 /* pipelined_send() - send a message directly to the task waiting in
  * sys_mq_timedreceive() (without inserting message into a queue).
  */
@@ -1057,6 +1094,64 @@ static inline void pipelined_receive(struct wake_q_head *wake_q,
 	__pipelined_op(wake_q, info, sender);
 }
 
+/*
+ * direct_send() - copy a large message straight into the buffer that the
+ * first waiting receiver pinned in sys_mq_timedreceivev(), instead of into
+ * a msg_msg and out again. Returns -EAGAIN if that receiver didn't pin its
+ * buffer, so that the message takes the normal path.
+ */
+static int direct_send(struct mqueue_inode_info *info, struct inode *inode,
+		       const char __user *u_msg_ptr, size_t msg_len,
+		       unsigned int msg_prio)
+{
+	struct ext_wait_queue *receiver;
+	DEFINE_WAKE_Q(wake_q);
+	size_t done;
+	int ret = 0;
+
+	spin_lock(&info->lock);
+	receiver = wq_get_first_waiter(info, RECV);
+	if (!receiver || !receiver->pages ||
+	    msg_len > ((size_t)receiver->nr_pages << PAGE_SHIFT)) {
+		spin_unlock(&info->lock);
+		return -EAGAIN;
+	}
+	wq_del(info, receiver);
+	WRITE_ONCE(receiver->state, STATE_CLAIMED);
+	spin_unlock(&info->lock);
+
+	for (done = 0; done < msg_len; done += PAGE_SIZE) {
+		size_t len = min_t(size_t, msg_len - done, PAGE_SIZE);
+		void *kaddr = kmap_local_page(receiver->pages[done >> PAGE_SHIFT]);
+
+		if (copy_from_user(kaddr, u_msg_ptr + done, len))
+			ret = -EFAULT;
+		kunmap_local(kaddr);
+		if (ret)
+			break;
+	}
+
+	spin_lock(&info->lock);
+	if (!ret) {
+		receiver->msg = NULL;
+		receiver->direct_len = msg_len;
+		receiver->direct_prio = msg_prio;
+		__pipelined_wake(&wake_q, receiver);
+		inode->i_atime = inode->i_mtime = inode->i_ctime =
+				current_time(inode);
+	} else {
+		/* Give the receiver back its place at the head of the queue */
+		list_add_tail(&receiver->list, &info->e_wait_q[RECV].list);
+		info->nr_direct++;
+		WRITE_ONCE(receiver->state, STATE_NONE);
+		wake_q_add(&wake_q, receiver->task);
+	}
+	spin_unlock(&info->lock);
+	wake_up_q(&wake_q);
+
+	return ret;
+}
+
 static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 		size_t msg_len, unsigned int msg_prio,
 		struct timespec64 *ts)
@@ -1106,6 +1201,13 @@ static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 		goto out_fput;
 	}
 
+	if (msg_len >= PAGE_SIZE && READ_ONCE(info->nr_direct)) {
+		ret = direct_send(info, inode, u_msg_ptr, msg_len, msg_prio);
+		if (ret != -EAGAIN)
+			goto out_fput;
+		ret = 0;
+	}
+
 	/* First try to allocate memory, before doing anything with
 	 * existing queues. */
 	msg_ptr = load_msg(u_msg_ptr, msg_len);
@@ -1141,6 +1243,7 @@ static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 		} else {
 			wait.task = current;
 			wait.msg = (void *) msg_ptr;
+			wait.pages = NULL;
 
 			/* memory barrier not required, we hold info->lock */
 			WRITE_ONCE(wait.state, STATE_NONE);
@@ -1246,6 +1349,7 @@ static int do_mq_timedreceive(mqd_t mqdes, char __user *u_msg_ptr,
 			ret = -EAGAIN;
 		} else {
 			wait.task = current;
+			wait.pages = NULL;
 
 			/* memory barrier not required, we hold info->lock */
 			WRITE_ONCE(wait.state, STATE_NONE);
@@ -1281,6 +1385,207 @@ static int do_mq_timedreceive(mqd_t mqdes, char __user *u_msg_ptr,
 	return ret;
 }
 
+/* Pins the receive buffer of sys_mq_timedreceivev(), see MQ_RECV_DIRECT */
+static struct page **pin_msg_buffer(unsigned long addr, size_t len,
+				    unsigned int *nr_pages)
+{
+	unsigned int nr = DIV_ROUND_UP(len, PAGE_SIZE);
+	struct page **pages;
+	int pinned;
+
+	pages = kvmalloc_array(nr, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return NULL;
+
+	pinned = pin_user_pages_fast(addr, nr, FOLL_WRITE, pages);
+	if (pinned != nr) {
+		if (pinned > 0)
+			unpin_user_pages(pages, pinned);
+		kvfree(pages);
+		return NULL;
+	}
+
+	*nr_pages = nr;
+	return pages;
+}
+
+static int put_msgv(struct mq_msgv __user *u_msgv, size_t msg_len,
+		    unsigned int msg_prio)
+{
+	if (put_user(msg_len, &u_msgv->msg_len) ||
+	    put_user(msg_prio, &u_msgv->msg_prio))
+		return -EFAULT;
+	return 0;
+}
+
+/*
+ * Receives up to @vlen messages with one call. Only the first one is waited
+ * for, the rest is whatever is queued at that point. Returns the number of
+ * messages received.
+ */
+static int do_mq_timedreceivev(mqd_t mqdes, struct mq_msgv __user *u_msgv,
+		unsigned int vlen, unsigned int flags, struct timespec64 *ts)
+{
+	int ret;
+	unsigned int count, nr_pages = 0;
+	struct page **pages = NULL;
+	struct msg_msg *msg_ptr;
+	struct mq_msgv msgv;
+	struct fd f;
+	struct inode *inode;
+	struct mqueue_inode_info *info;
+	struct ext_wait_queue wait;
+	ktime_t expires, *timeout = NULL;
+	struct posix_msg_tree_node *new_leaf = NULL;
+
+	if (flags & ~MQ_RECV_DIRECT)
+		return -EINVAL;
+	if (!vlen)
+		return 0;
+	if (vlen > UIO_MAXIOV)
+		vlen = UIO_MAXIOV;
+
+	if (copy_from_user(&msgv, u_msgv, sizeof(msgv)))
+		return -EFAULT;
+
+	if (ts) {
+		expires = timespec64_to_ktime(*ts);
+		timeout = &expires;
+	}
+
+	audit_mq_sendrecv(mqdes, msgv.msg_len, 0, ts);
+
+	f = fdget(mqdes);
+	if (unlikely(!f.file)) {
+		ret = -EBADF;
+		goto out;
+	}
+
+	inode = file_inode(f.file);
+	if (unlikely(f.file->f_op != &mqueue_file_operations)) {
+		ret = -EBADF;
+		goto out_fput;
+	}
+	info = MQUEUE_I(inode);
+	audit_file(f.file);
+
+	if (unlikely(!(f.file->f_mode & FMODE_READ))) {
+		ret = -EBADF;
+		goto out_fput;
+	}
+
+	/* checks if buffer is big enough */
+	if (unlikely(msgv.msg_len < info->attr.mq_msgsize)) {
+		ret = -EMSGSIZE;
+		goto out_fput;
+	}
+
+	/*
+	 * Only worth it if we are going to wait: a sender that finds us
+	 * waiting copies straight into the pinned buffer.
+	 */
+	if ((flags & MQ_RECV_DIRECT) && !(f.file->f_flags & O_NONBLOCK) &&
+	    info->attr.mq_msgsize >= PAGE_SIZE &&
+	    PAGE_ALIGNED(msgv.msg_ptr) && !READ_ONCE(info->attr.mq_curmsgs))
+		pages = pin_msg_buffer(msgv.msg_ptr, info->attr.mq_msgsize,
+				       &nr_pages);
+
+	if (!info->node_cache)
+		new_leaf = kmalloc(sizeof(*new_leaf), GFP_KERNEL);
+
+	spin_lock(&info->lock);
+
+	if (!info->node_cache && new_leaf) {
+		/* Save our speculative allocation into the cache */
+		INIT_LIST_HEAD(&new_leaf->msg_list);
+		info->node_cache = new_leaf;
+	} else {
+		kfree(new_leaf);
+	}
+
+	if (info->attr.mq_curmsgs == 0) {
+		if (f.file->f_flags & O_NONBLOCK) {
+			spin_unlock(&info->lock);
+			ret = -EAGAIN;
+		} else {
+			wait.task = current;
+			wait.pages = pages;
+			wait.nr_pages = nr_pages;
+
+			/* memory barrier not required, we hold info->lock */
+			WRITE_ONCE(wait.state, STATE_NONE);
+			ret = wq_sleep(info, RECV, timeout, &wait);
+			msg_ptr = wait.msg;
+		}
+	} else {
+		DEFINE_WAKE_Q(wake_q);
+
+		msg_ptr = msg_get(info);
+
+		inode->i_atime = inode->i_mtime = inode->i_ctime =
+				current_time(inode);
+
+		/* There is now free space in queue. */
+		pipelined_receive(&wake_q, info);
+		spin_unlock(&info->lock);
+		wake_up_q(&wake_q);
+		ret = 0;
+	}
+	if (ret == 0) {
+		if (msg_ptr) {
+			if (store_msg(u64_to_user_ptr(msgv.msg_ptr), msg_ptr,
+				      msg_ptr->m_ts) ||
+			    put_msgv(u_msgv, msg_ptr->m_ts, msg_ptr->m_type))
+				ret = -EFAULT;
+			free_msg(msg_ptr);
+		} else {
+			/* direct_send() already copied the message */
+			ret = put_msgv(u_msgv, wait.direct_len,
+				       wait.direct_prio);
+		}
+	}
+	if (pages) {
+		unpin_user_pages_dirty_lock(pages, nr_pages, true);
+		kvfree(pages);
+	}
+	if (ret)
+		goto out_fput;
+
+	for (count = 1; count < vlen; count++) {
+		DEFINE_WAKE_Q(wake_q);
+
+		if (copy_from_user(&msgv, &u_msgv[count], sizeof(msgv)) ||
+		    msgv.msg_len < info->attr.mq_msgsize)
+			break;
+
+		spin_lock(&info->lock);
+		if (info->attr.mq_curmsgs == 0) {
+			spin_unlock(&info->lock);
+			break;
+		}
+		msg_ptr = msg_get(info);
+		inode->i_atime = inode->i_mtime = inode->i_ctime =
+				current_time(inode);
+		pipelined_receive(&wake_q, info);
+		spin_unlock(&info->lock);
+		wake_up_q(&wake_q);
+
+		ret = store_msg(u64_to_user_ptr(msgv.msg_ptr), msg_ptr,
+				msg_ptr->m_ts);
+		if (!ret)
+			ret = put_msgv(&u_msgv[count], msg_ptr->m_ts,
+				       msg_ptr->m_type);
+		free_msg(msg_ptr);
+		if (ret)
+			break;
+	}
+	ret = count;
+out_fput:
+	fdput(f);
+out:
+	return ret;
+}
+
 SYSCALL_DEFINE5(mq_timedsend, mqd_t, mqdes, const char __user *, u_msg_ptr,
 		size_t, msg_len, unsigned int, msg_prio,
 		const struct __kernel_timespec __user *, u_abs_timeout)
@@ -1309,6 +1614,21 @@ SYSCALL_DEFINE5(mq_timedreceive, mqd_t, mqdes, char __user *, u_msg_ptr,
 	return do_mq_timedreceive(mqdes, u_msg_ptr, msg_len, u_msg_prio, p);
 }
 
+SYSCALL_DEFINE5(mq_timedreceivev, mqd_t, mqdes,
+		struct mq_msgv __user *, u_msgv, unsigned int, vlen,
+		unsigned int, flags,
+		const struct __kernel_timespec __user *, u_abs_timeout)
+{
+	struct timespec64 ts, *p = NULL;
+	if (u_abs_timeout) {
+		int res = prepare_timeout(u_abs_timeout, &ts);
+		if (res)
+			return res;
+		p = &ts;
+	}
+	return do_mq_timedreceivev(mqdes, u_msgv, vlen, flags, p);
+}
+
 /*
  * Notes: the case when user wants us to deregister (with NULL as pointer)
  * and he isn't currently owner of notification, will be silently discarded.
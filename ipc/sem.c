@@ -1012,6 +1012,42 @@ static void set_semotime(struct sem_array *sma, struct sembuf *sops)
 	}
 }
 
+/**
+ * sem_fast_semop - complete an uncontended single semop
+ * @sma: semaphore array
+ * @sop: the altering operation, without SEM_UNDO
+ *
+ * With only the per-semaphore lock held and nobody waiting on the
+ * semaphore, an operation which can complete right away has neither
+ * pending operations to check nor sleepers to wake.  Apply it directly
+ * instead of going through perform_atomic_semop() and do_smart_update().
+ *
+ * Caller must own the per-semaphore lock of @sop->sem_num.
+ *
+ * Return: %true if the operation was done, %false if the caller has to
+ * take the regular path.
+ */
+static bool sem_fast_semop(struct sem_array *sma, struct sembuf *sop)
+{
+	int idx = array_index_nospec(sop->sem_num, sma->sem_nsems);
+	struct sem *curr = &sma->sems[idx];
+	int result;
+
+	if (!list_empty(&curr->pending_alter) ||
+	    !list_empty(&curr->pending_const))
+		return false;
+
+	/* Blocking, IPC_NOWAIT and range errors are left to the slow path */
+	result = curr->semval + sop->sem_op;
+	if (result < 0 || result > SEMVMX)
+		return false;
+
+	curr->semval = result;
+	ipc_update_pid(&curr->sempid, task_tgid(current));
+	curr->sem_otime = ktime_get_real_seconds();
+	return true;
+}
+
 /**
  * do_smart_update - optimized update_queue
  * @sma: semaphore array
@@ -2093,6 +2129,17 @@ long __do_semtimedop(int semid, struct sembuf *sops,
 	if (un && un->semid == -1)
 		goto out_unlock;
 
+	/*
+	 * The common case of a single semop on a semaphore nobody waits for
+	 * can be completed right away.  locknum >= 0 means that no complex
+	 * operation is around, see sem_lock().
+	 */
+	if (nsops == 1 && alter && !un && locknum != SEM_GLOBAL_LOCK &&
+	    sem_fast_semop(sma, sops)) {
+		error = 0;
+		goto out_unlock;
+	}
+
 	queue.sops = sops;
 	queue.nsops = nsops;
 	queue.undo = un;
@@ -59,6 +59,7 @@
 #include <linux/sched/cputime.h>
 #include <linux/sched/deadline.h>
 #include <linux/psi.h>
+#include <linux/delayacct.h>
 #include <net/sock.h>
 
 #define CREATE_TRACE_POINTS
@@ -113,6 +114,14 @@ static DEFINE_SPINLOCK(cgroup_file_kn_lock);
 
 DEFINE_PERCPU_RWSEM(cgroup_threadgroup_rwsem);
 
+/*
+ * Set once favordynmods gets enabled on any hierarchy and never cleared,
+ * see CGRP_ROOT_FAVOR_DYNMODS. Only flipped with cgroup_threadgroup_rwsem
+ * write-locked, so it can't change between
+ * cgroup_threadgroup_change_begin() and end().
+ */
+bool cgroup_enable_per_threadgroup_rwsem __read_mostly;
+
 #define cgroup_assert_mutex_or_rcu_locked()				\
 	RCU_LOCKDEP_WARN(!rcu_read_lock_held() &&			\
 			   !lockdep_is_held(&cgroup_mutex),		\
@@ -1304,9 +1313,16 @@ void cgroup_favor_dynmods(struct cgroup_root *root, bool favor)
 
 	/* see the comment above CGRP_ROOT_FAVOR_DYNMODS definition */
 	if (favor && !favoring) {
+		if (!cgroup_enable_per_threadgroup_rwsem) {
+			percpu_down_write(&cgroup_threadgroup_rwsem);
+			cgroup_enable_per_threadgroup_rwsem = true;
+			percpu_up_write(&cgroup_threadgroup_rwsem);
+		}
 		rcu_sync_enter(&cgroup_threadgroup_rwsem.rss);
 		root->flags |= CGRP_ROOT_FAVOR_DYNMODS;
 	} else if (!favor && favoring) {
+		if (cgroup_enable_per_threadgroup_rwsem)
+			pr_warn_once("favordynmods: per threadgroup locking stays enabled\n");
 		rcu_sync_exit(&cgroup_threadgroup_rwsem.rss);
 		root->flags &= ~CGRP_ROOT_FAVOR_DYNMODS;
 	}
@@ -2378,7 +2394,8 @@ EXPORT_SYMBOL_GPL(cgroup_path_ns);
 
 /**
  * cgroup_attach_lock - Lock for ->attach()
- * @lock_threadgroup: whether to down_write cgroup_threadgroup_rwsem
+ * @lock_mode: which threadgroup rwsem to down_write, if any
+ * @tsk: thread group to lock in CGRP_ATTACH_LOCK_PER_THREADGROUP mode
  *
  * cgroup migration sometimes needs to stabilize threadgroups against forks and
  * exits by write-locking cgroup_threadgroup_rwsem. However, some ->attach()
@@ -2398,22 +2415,45 @@ EXPORT_SYMBOL_GPL(cgroup_path_ns);
  * Resolve the situation by always acquiring cpus_read_lock() before optionally
  * write-locking cgroup_threadgroup_rwsem. This allows ->attach() to assume that
  * CPU hotplug is disabled on entry.
+ *
+ * The per threadgroup rwsem nests inside cpus_read_lock() the same way.
  */
-void cgroup_attach_lock(bool lock_threadgroup)
+void cgroup_attach_lock(enum cgroup_attach_lock_mode lock_mode,
+			struct task_struct *tsk)
 {
 	cpus_read_lock();
-	if (lock_threadgroup)
+
+	switch (lock_mode) {
+	case CGRP_ATTACH_LOCK_GLOBAL:
 		percpu_down_write(&cgroup_threadgroup_rwsem);
+		break;
+	case CGRP_ATTACH_LOCK_PER_THREADGROUP:
+		down_write(&tsk->signal->cgroup_threadgroup_rwsem);
+		break;
+	case CGRP_ATTACH_LOCK_NONE:
+		break;
+	}
 }
 
 /**
  * cgroup_attach_unlock - Undo cgroup_attach_lock()
- * @lock_threadgroup: whether to up_write cgroup_threadgroup_rwsem
+ * @lock_mode: lock mode passed to cgroup_attach_lock()
+ * @tsk: task passed to cgroup_attach_lock()
  */
-void cgroup_attach_unlock(bool lock_threadgroup)
+void cgroup_attach_unlock(enum cgroup_attach_lock_mode lock_mode,
+			  struct task_struct *tsk)
 {
-	if (lock_threadgroup)
+	switch (lock_mode) {
+	case CGRP_ATTACH_LOCK_GLOBAL:
 		percpu_up_write(&cgroup_threadgroup_rwsem);
+		break;
+	case CGRP_ATTACH_LOCK_PER_THREADGROUP:
+		up_write(&tsk->signal->cgroup_threadgroup_rwsem);
+		break;
+	case CGRP_ATTACH_LOCK_NONE:
+		break;
+	}
+
 	cpus_read_unlock();
 }
 
@@ -2886,33 +2926,20 @@ int cgroup_attach_task(struct cgroup *dst_cgrp, struct task_struct *leader,
 	return ret;
 }
 
-struct task_struct *cgroup_procs_write_start(char *buf, bool threadgroup,
-					     bool *threadgroup_locked)
+/*
+ * Look up the task @pid refers to (current if 0) for migration, and take a
+ * reference on it. Returns an ERR_PTR() on failure.
+ */
+static struct task_struct *cgroup_procs_find_task(pid_t pid, bool threadgroup)
 {
 	struct task_struct *tsk;
-	pid_t pid;
-
-	if (kstrtoint(strstrip(buf), 0, &pid) || pid < 0)
-		return ERR_PTR(-EINVAL);
-
-	/*
-	 * If we migrate a single thread, we don't care about threadgroup
-	 * stability. If the thread is `current`, it won't exit(2) under our
-	 * hands or change PID through exec(2). We exclude
-	 * cgroup_update_dfl_csses and other cgroup_{proc,thread}s_write
-	 * callers by cgroup_mutex.
-	 * Therefore, we can skip the global lock.
-	 */
-	lockdep_assert_held(&cgroup_mutex);
-	*threadgroup_locked = pid || threadgroup;
-	cgroup_attach_lock(*threadgroup_locked);
 
 	rcu_read_lock();
 	if (pid) {
 		tsk = find_task_by_vpid(pid);
 		if (!tsk) {
 			tsk = ERR_PTR(-ESRCH);
-			goto out_unlock_threadgroup;
+			goto out_unlock_rcu;
 		}
 	} else {
 		tsk = current;
@@ -2929,30 +2956,72 @@ struct task_struct *cgroup_procs_write_start(char *buf, bool threadgroup,
 	 */
 	if (tsk->no_cgroup_migration || (tsk->flags & PF_NO_SETAFFINITY)) {
 		tsk = ERR_PTR(-EINVAL);
-		goto out_unlock_threadgroup;
+		goto out_unlock_rcu;
 	}
 
 	get_task_struct(tsk);
-	goto out_unlock_rcu;
-
-out_unlock_threadgroup:
-	cgroup_attach_unlock(*threadgroup_locked);
-	*threadgroup_locked = false;
 out_unlock_rcu:
 	rcu_read_unlock();
 	return tsk;
 }
 
-void cgroup_procs_write_finish(struct task_struct *task, bool threadgroup_locked)
+struct task_struct *cgroup_procs_write_start(char *buf, bool threadgroup,
+					     enum cgroup_attach_lock_mode *lock_mode)
+{
+	struct task_struct *tsk;
+	pid_t pid;
+
+	if (kstrtoint(strstrip(buf), 0, &pid) || pid < 0)
+		return ERR_PTR(-EINVAL);
+
+	lockdep_assert_held(&cgroup_mutex);
+
+	/*
+	 * If we migrate a single thread, we don't care about threadgroup
+	 * stability. If the thread is `current`, it won't exit(2) under our
+	 * hands or change PID through exec(2). We exclude
+	 * cgroup_update_dfl_csses and other cgroup_{proc,thread}s_write
+	 * callers by cgroup_mutex.
+	 * Therefore, we can skip the global lock.
+	 */
+	if (!pid && !threadgroup)
+		*lock_mode = CGRP_ATTACH_LOCK_NONE;
+	else if (cgroup_enable_per_threadgroup_rwsem)
+		*lock_mode = CGRP_ATTACH_LOCK_PER_THREADGROUP;
+	else
+		*lock_mode = CGRP_ATTACH_LOCK_GLOBAL;
+
+retry_find_task:
+	tsk = cgroup_procs_find_task(pid, threadgroup);
+	if (IS_ERR(tsk))
+		return tsk;
+
+	cgroup_attach_lock(*lock_mode, tsk);
+
+	/*
+	 * A racing exec() from another thread may have stripped the leader
+	 * of its leadership before we got the lock. Look it up again.
+	 */
+	if (threadgroup && !thread_group_leader(tsk)) {
+		cgroup_attach_unlock(*lock_mode, tsk);
+		put_task_struct(tsk);
+		goto retry_find_task;
+	}
+
+	return tsk;
+}
+
+void cgroup_procs_write_finish(struct task_struct *task,
+			       enum cgroup_attach_lock_mode lock_mode)
 {
 	struct cgroup_subsys *ss;
 	int ssid;
 
+	cgroup_attach_unlock(lock_mode, task);
+
 	/* release reference from cgroup_procs_write_start() */
 	put_task_struct(task);
 
-	cgroup_attach_unlock(threadgroup_locked);
-
 	for_each_subsys(ss, ssid)
 		if (ss->post_attach)
 			ss->post_attach();
@@ -3006,6 +3075,7 @@ static int cgroup_update_dfl_csses(struct cgroup *cgrp)
 	DEFINE_CGROUP_MGCTX(mgctx);
 	struct cgroup_subsys_state *d_css;
 	struct cgroup *dsct;
+	enum cgroup_attach_lock_mode lock_mode;
 	struct css_set *src_cset;
 	bool has_tasks;
 	int ret;
@@ -3038,7 +3108,8 @@ static int cgroup_update_dfl_csses(struct cgroup *cgrp)
 	 * write-locking can be skipped safely.
 	 */
 	has_tasks = !list_empty(&mgctx.preloaded_src_csets);
-	cgroup_attach_lock(has_tasks);
+	lock_mode = has_tasks ? CGRP_ATTACH_LOCK_GLOBAL : CGRP_ATTACH_LOCK_NONE;
+	cgroup_attach_lock(lock_mode, NULL);
 
 	/* NULL dst indicates self on default hierarchy */
 	ret = cgroup_migrate_prepare_dst(&mgctx);
@@ -3059,7 +3130,7 @@ static int cgroup_update_dfl_csses(struct cgroup *cgrp)
 	ret = cgroup_migrate_execute(&mgctx);
 out_finish:
 	cgroup_migrate_finish(&mgctx);
-	cgroup_attach_unlock(has_tasks);
+	cgroup_attach_unlock(lock_mode, NULL);
 	return ret;
 }
 
@@ -5099,24 +5170,14 @@ static int cgroup_attach_permissions(struct cgroup *src_cgrp,
 	return ret;
 }
 
-static ssize_t __cgroup_procs_write(struct kernfs_open_file *of, char *buf,
-				    bool threadgroup)
+static int cgroup_procs_attach(struct kernfs_open_file *of,
+			       struct cgroup *dst_cgrp,
+			       struct task_struct *task, bool threadgroup)
 {
 	struct cgroup_file_ctx *ctx = of->priv;
-	struct cgroup *src_cgrp, *dst_cgrp;
-	struct task_struct *task;
 	const struct cred *saved_cred;
-	ssize_t ret;
-	bool threadgroup_locked;
-
-	dst_cgrp = cgroup_kn_lock_live(of->kn, false);
-	if (!dst_cgrp)
-		return -ENODEV;
-
-	task = cgroup_procs_write_start(buf, threadgroup, &threadgroup_locked);
-	ret = PTR_ERR_OR_ZERO(task);
-	if (ret)
-		goto out_unlock;
+	struct cgroup *src_cgrp;
+	int ret;
 
 	/* find the source cgroup */
 	spin_lock_irq(&css_set_lock);
@@ -5134,12 +5195,86 @@ static ssize_t __cgroup_procs_write(struct kernfs_open_file *of, char *buf,
 					threadgroup, ctx->ns);
 	revert_creds(saved_cred);
 	if (ret)
-		goto out_finish;
+		return ret;
 
-	ret = cgroup_attach_task(dst_cgrp, task, threadgroup);
+	return cgroup_attach_task(dst_cgrp, task, threadgroup);
+}
 
-out_finish:
-	cgroup_procs_write_finish(task, threadgroup_locked);
+/*
+ * Migrate the whitespace separated list of processes in @buf, as if they
+ * were written one by one, but write-locking cgroup_threadgroup_rwsem only
+ * once for all of them. Stops at the first failure, the processes before
+ * it stay migrated.
+ */
+static int cgroup_procs_write_batch(struct kernfs_open_file *of,
+				    struct cgroup *dst_cgrp, char *buf)
+{
+	struct cgroup_subsys *ss;
+	char *tok;
+	int ssid, ret = 0;
+
+	lockdep_assert_held(&cgroup_mutex);
+	cgroup_attach_lock(CGRP_ATTACH_LOCK_GLOBAL, NULL);
+
+	while ((tok = strsep(&buf, " \t\n")) != NULL) {
+		struct task_struct *task;
+		pid_t pid;
+
+		if (!*tok)
+			continue;
+
+		if (kstrtoint(tok, 0, &pid) || pid < 0) {
+			ret = -EINVAL;
+			break;
+		}
+
+		task = cgroup_procs_find_task(pid, true);
+		if (IS_ERR(task)) {
+			ret = PTR_ERR(task);
+			break;
+		}
+
+		ret = cgroup_procs_attach(of, dst_cgrp, task, true);
+		put_task_struct(task);
+		if (ret)
+			break;
+	}
+
+	cgroup_attach_unlock(CGRP_ATTACH_LOCK_GLOBAL, NULL);
+
+	for_each_subsys(ss, ssid)
+		if (ss->post_attach)
+			ss->post_attach();
+
+	return ret;
+}
+
+static ssize_t __cgroup_procs_write(struct kernfs_open_file *of, char *buf,
+				    bool threadgroup)
+{
+	enum cgroup_attach_lock_mode lock_mode;
+	struct cgroup *dst_cgrp;
+	struct task_struct *task;
+	ssize_t ret;
+
+	dst_cgrp = cgroup_kn_lock_live(of->kn, false);
+	if (!dst_cgrp)
+		return -ENODEV;
+
+	buf = strstrip(buf);
+	if (threadgroup && strpbrk(buf, " \t\n")) {
+		ret = cgroup_procs_write_batch(of, dst_cgrp, buf);
+		goto out_unlock;
+	}
+
+	task = cgroup_procs_write_start(buf, threadgroup, &lock_mode);
+	ret = PTR_ERR_OR_ZERO(task);
+	if (ret)
+		goto out_unlock;
+
+	ret = cgroup_procs_attach(of, dst_cgrp, task, threadgroup);
+
+	cgroup_procs_write_finish(task, lock_mode);
 out_unlock:
 	cgroup_kn_unlock(of->kn);
 
@@ -5345,6 +5480,7 @@ static void css_free_rwork_fn(struct work_struct *work)
 			 */
 			cgroup_put(cgroup_parent(cgrp));
 			kernfs_put(cgrp->kn);
+			delayacct_cgroup_free(cgrp);
 			psi_cgroup_free(cgrp);
 			cgroup_rstat_exit(cgrp);
 			kfree(cgrp);
@@ -5374,7 +5510,7 @@ static void css_release_work_fn(struct work_struct *work)
 	if (ss) {
 		/* css release path */
 		if (!list_empty(&css->rstat_css_node)) {
-			cgroup_rstat_flush(cgrp);
+			__cgroup_rstat_flush(cgrp);
 			list_del_rcu(&css->rstat_css_node);
 		}
 
@@ -5387,7 +5523,7 @@ static void css_release_work_fn(struct work_struct *work)
 		/* cgroup release path */
 		TRACE_CGROUP_PATH(release, cgrp);
 
-		cgroup_rstat_flush(cgrp);
+		__cgroup_rstat_flush(cgrp);
 
 		spin_lock_irq(&css_set_lock);
 		for (tcgrp = cgroup_parent(cgrp); tcgrp;
@@ -5590,10 +5726,14 @@ static struct cgroup *cgroup_create(struct cgroup *parent, const char *name,
 	if (ret)
 		goto out_kernfs_remove;
 
-	ret = cgroup_bpf_inherit(cgrp);
+	ret = delayacct_cgroup_alloc(cgrp);
 	if (ret)
 		goto out_psi_free;
 
+	ret = cgroup_bpf_inherit(cgrp);
+	if (ret)
+		goto out_delayacct_free;
+
 	/*
 	 * New cgroup inherits effective freeze counter, and
 	 * if the parent has to be frozen, the child has too.
@@ -5652,6 +5792,8 @@ static struct cgroup *cgroup_create(struct cgroup *parent, const char *name,
 
 	return cgrp;
 
+out_delayacct_free:
+	delayacct_cgroup_free(cgrp);
 out_psi_free:
 	psi_cgroup_free(cgrp);
 out_kernfs_remove:
@@ -36,9 +36,11 @@
 #include <linux/sched.h>
 #include <linux/sched/deadline.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/nohz.h>
 #include <linux/sched/task.h>
 #include <linux/security.h>
 #include <linux/spinlock.h>
+#include <linux/tick.h>
 #include <linux/oom.h>
 #include <linux/sched/isolation.h>
 #include <linux/cgroup.h>
@@ -254,6 +256,7 @@ typedef enum {
 	CS_SCHED_LOAD_BALANCE,
 	CS_SPREAD_PAGE,
 	CS_SPREAD_SLAB,
+	CS_SCHED_BATCH,
 } cpuset_flagbits_t;
 
 /* convenient tests for these bits */
@@ -297,6 +300,11 @@ static inline int is_spread_slab(const struct cpuset *cs)
 	return test_bit(CS_SPREAD_SLAB, &cs->flags);
 }
 
+static inline int is_sched_batch(const struct cpuset *cs)
+{
+	return test_bit(CS_SCHED_BATCH, &cs->flags);
+}
+
 static inline int is_partition_valid(const struct cpuset *cs)
 {
 	return cs->partition_root_state > 0;
@@ -1123,23 +1131,35 @@ partition_and_rebuild_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
 				    struct sched_domain_attr *dattr_new)
 {
 	mutex_lock(&sched_domains_mutex);
-	partition_sched_domains_locked(ndoms_new, doms_new, dattr_new);
-	dl_rebuild_rd_accounting();
+	/* The DL accounting is intact if no root domain was touched */
+	if (partition_sched_domains_locked(ndoms_new, doms_new, dattr_new))
+		dl_rebuild_rd_accounting();
 	mutex_unlock(&sched_domains_mutex);
 }
 
 /*
- * Rebuild scheduler domains.
+ * A single cpuset operation may ask for several rebuilds, e.g. when a
+ * partition change also updates the siblings. They are recorded in
+ * sched_domains_dirty and carried out once by cpuset_flush_sched_domains()
+ * before the operation drops cpuset_mutex.
  *
- * If the flag 'sched_load_balance' of any cpuset with non-empty
- * 'cpus' changes, or if the 'cpus' allowed changes in any cpuset
- * which has that flag enabled, or if any cpuset with a non-empty
- * 'cpus' is removed, then call this routine to rebuild the
- * scheduler's dynamic sched domains.
+ * With a non-zero cpuset_rebuild_delay_ms, the rebuild is instead left to
+ * cpuset_rebuild_work, so that the writes done by a management agent in
+ * a burst result in one rebuild. The sched domains then lag behind the
+ * cpuset configuration for up to that many milliseconds.
+ */
+static bool sched_domains_dirty;
+static unsigned int cpuset_rebuild_delay_ms __read_mostly;
+
+static void cpuset_rebuild_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(cpuset_rebuild_work, cpuset_rebuild_workfn);
+
+/*
+ * Rebuild scheduler domains.
  *
  * Call with cpuset_mutex held.  Takes cpus_read_lock().
  */
-static void rebuild_sched_domains_locked(void)
+static void __rebuild_sched_domains_locked(void)
 {
 	struct cgroup_subsys_state *pos_css;
 	struct sched_domain_attr *attr;
@@ -1150,6 +1170,8 @@ static void rebuild_sched_domains_locked(void)
 	lockdep_assert_cpus_held();
 	lockdep_assert_held(&cpuset_mutex);
 
+	sched_domains_dirty = false;
+
 	/*
 	 * If we have raced with CPU hotplug, return early to avoid
 	 * passing doms with offlined cpu to partition_sched_domains().
@@ -1190,17 +1212,75 @@ static void rebuild_sched_domains_locked(void)
 	/* Have scheduler rebuild the domains */
 	partition_and_rebuild_sched_domains(ndoms, doms, attr);
 }
+
+/*
+ * If the flag 'sched_load_balance' of any cpuset with non-empty
+ * 'cpus' changes, or if the 'cpus' allowed changes in any cpuset
+ * which has that flag enabled, or if any cpuset with a non-empty
+ * 'cpus' is removed, then call this routine to have the scheduler's
+ * dynamic sched domains rebuilt.
+ *
+ * Call with cpuset_mutex held.
+ */
+static void rebuild_sched_domains_locked(void)
+{
+	lockdep_assert_held(&cpuset_mutex);
+
+	sched_domains_dirty = true;
+}
+
+/*
+ * Carry out the rebuild requested by the current operation, if any.
+ *
+ * Call with cpuset_mutex and cpus_read_lock() held.
+ */
+static void cpuset_flush_sched_domains(void)
+{
+	unsigned int delay = READ_ONCE(cpuset_rebuild_delay_ms);
+
+	if (!sched_domains_dirty)
+		return;
+
+	if (delay) {
+		/* Don't push back a rebuild that is already scheduled */
+		queue_delayed_work(system_unbound_wq, &cpuset_rebuild_work,
+				   msecs_to_jiffies(delay));
+		return;
+	}
+
+	__rebuild_sched_domains_locked();
+}
+
+static void cpuset_rebuild_workfn(struct work_struct *work)
+{
+	cpus_read_lock();
+	mutex_lock(&cpuset_mutex);
+	if (sched_domains_dirty)
+		__rebuild_sched_domains_locked();
+	mutex_unlock(&cpuset_mutex);
+	cpus_read_unlock();
+}
 #else /* !CONFIG_SMP */
+static unsigned int cpuset_rebuild_delay_ms;
+
+static void __rebuild_sched_domains_locked(void)
+{
+}
+
 static void rebuild_sched_domains_locked(void)
 {
 }
+
+static void cpuset_flush_sched_domains(void)
+{
+}
 #endif /* CONFIG_SMP */
 
 void rebuild_sched_domains(void)
 {
 	cpus_read_lock();
 	mutex_lock(&cpuset_mutex);
-	rebuild_sched_domains_locked();
+	__rebuild_sched_domains_locked();
 	mutex_unlock(&cpuset_mutex);
 	cpus_read_unlock();
 }
@@ -1735,6 +1815,38 @@ static void update_sibling_cpumasks(struct cpuset *parent, struct cpuset *cs,
 	rcu_read_unlock();
 }
 
+/*
+ * update_sched_batch_cpus - tell the scheduler which CPUs run in batch mode
+ *
+ * The batch CPUs are the union of the effective CPUs of every cpuset with
+ * 'sched_batch' set. Only nohz_full CPUs are affected, see
+ * sched_set_batch_cpus().
+ *
+ * Call with cpuset_mutex held.
+ */
+static void update_sched_batch_cpus(void)
+{
+	struct cgroup_subsys_state *pos_css;
+	cpumask_var_t batch_cpus;
+	struct cpuset *cs;
+
+	if (!tick_nohz_full_enabled())
+		return;
+
+	if (!zalloc_cpumask_var(&batch_cpus, GFP_KERNEL))
+		return;
+
+	rcu_read_lock();
+	cpuset_for_each_descendant_pre(cs, pos_css, &top_cpuset) {
+		if (is_sched_batch(cs))
+			cpumask_or(batch_cpus, batch_cpus, cs->effective_cpus);
+	}
+	rcu_read_unlock();
+
+	sched_set_batch_cpus(batch_cpus);
+	free_cpumask_var(batch_cpus);
+}
+
 /**
  * update_cpumask - update the cpus_allowed mask of a cpuset and all tasks in it
  * @cs: the cpuset to consider
@@ -1867,6 +1979,8 @@ static int update_cpumask(struct cpuset *cs, struct cpuset *trialcs,
 		if (parent->child_ecpus_count)
 			update_sibling_cpumasks(parent, cs, &tmp);
 	}
+
+	update_sched_batch_cpus();
 	return 0;
 }
 
@@ -2196,6 +2310,7 @@ static int update_flag(cpuset_flagbits_t bit, struct cpuset *cs,
 	struct cpuset *trialcs;
 	int balance_flag_changed;
 	int spread_flag_changed;
+	int batch_flag_changed;
 	int err;
 
 	trialcs = alloc_trial_cpuset(cs);
@@ -2217,6 +2332,8 @@ static int update_flag(cpuset_flagbits_t bit, struct cpuset *cs,
 	spread_flag_changed = ((is_spread_slab(cs) != is_spread_slab(trialcs))
 			|| (is_spread_page(cs) != is_spread_page(trialcs)));
 
+	batch_flag_changed = (is_sched_batch(cs) != is_sched_batch(trialcs));
+
 	spin_lock_irq(&callback_lock);
 	cs->flags = trialcs->flags;
 	spin_unlock_irq(&callback_lock);
@@ -2226,6 +2343,9 @@ static int update_flag(cpuset_flagbits_t bit, struct cpuset *cs,
 
 	if (spread_flag_changed)
 		update_tasks_flags(cs);
+
+	if (batch_flag_changed)
+		update_sched_batch_cpus();
 out:
 	free_cpuset(trialcs);
 	return err;
@@ -2697,6 +2817,8 @@ typedef enum {
 	FILE_MEMORY_PRESSURE,
 	FILE_SPREAD_PAGE,
 	FILE_SPREAD_SLAB,
+	FILE_SCHED_BATCH,
+	FILE_REBUILD_DELAY_MS,
 } cpuset_filetype_t;
 
 static int cpuset_write_u64(struct cgroup_subsys_state *css, struct cftype *cft,
@@ -2738,11 +2860,23 @@ static int cpuset_write_u64(struct cgroup_subsys_state *css, struct cftype *cft,
 	case FILE_SPREAD_SLAB:
 		retval = update_flag(CS_SPREAD_SLAB, cs, val);
 		break;
+	case FILE_SCHED_BATCH:
+		retval = update_flag(CS_SCHED_BATCH, cs, val);
+		break;
+	case FILE_REBUILD_DELAY_MS:
+		if (val > MSEC_PER_SEC) {
+			retval = -EINVAL;
+			break;
+		}
+		/* Going back to 0 rebuilds anything still pending right away */
+		WRITE_ONCE(cpuset_rebuild_delay_ms, val);
+		break;
 	default:
 		retval = -EINVAL;
 		break;
 	}
 out_unlock:
+	cpuset_flush_sched_domains();
 	mutex_unlock(&cpuset_mutex);
 	cpus_read_unlock();
 	return retval;
@@ -2769,6 +2903,7 @@ static int cpuset_write_s64(struct cgroup_subsys_state *css, struct cftype *cft,
 		break;
 	}
 out_unlock:
+	cpuset_flush_sched_domains();
 	mutex_unlock(&cpuset_mutex);
 	cpus_read_unlock();
 	return retval;
@@ -2834,6 +2969,7 @@ static ssize_t cpuset_write_resmask(struct kernfs_open_file *of,
 
 	free_cpuset(trialcs);
 out_unlock:
+	cpuset_flush_sched_domains();
 	mutex_unlock(&cpuset_mutex);
 	cpus_read_unlock();
 	kernfs_unbreak_active_protection(of->kn);
@@ -2905,6 +3041,10 @@ static u64 cpuset_read_u64(struct cgroup_subsys_state *css, struct cftype *cft)
 		return is_spread_page(cs);
 	case FILE_SPREAD_SLAB:
 		return is_spread_slab(cs);
+	case FILE_SCHED_BATCH:
+		return is_sched_batch(cs);
+	case FILE_REBUILD_DELAY_MS:
+		return READ_ONCE(cpuset_rebuild_delay_ms);
 	default:
 		BUG();
 	}
@@ -2988,6 +3128,7 @@ static ssize_t sched_partition_write(struct kernfs_open_file *of, char *buf,
 
 	retval = update_prstate(cs, val);
 out_unlock:
+	cpuset_flush_sched_domains();
 	mutex_unlock(&cpuset_mutex);
 	cpus_read_unlock();
 	css_put(&cs->css);
@@ -3089,6 +3230,13 @@ static struct cftype legacy_files[] = {
 		.private = FILE_SPREAD_SLAB,
 	},
 
+	{
+		.name = "sched_batch",
+		.read_u64 = cpuset_read_u64,
+		.write_u64 = cpuset_write_u64,
+		.private = FILE_SCHED_BATCH,
+	},
+
 	{
 		.name = "memory_pressure_enabled",
 		.flags = CFTYPE_ONLY_ON_ROOT,
@@ -3097,6 +3245,14 @@ static struct cftype legacy_files[] = {
 		.private = FILE_MEMORY_PRESSURE_ENABLED,
 	},
 
+	{
+		.name = "sched_rebuild_delay_ms",
+		.flags = CFTYPE_ONLY_ON_ROOT,
+		.read_u64 = cpuset_read_u64,
+		.write_u64 = cpuset_write_u64,
+		.private = FILE_REBUILD_DELAY_MS,
+	},
+
 	{ }	/* terminate */
 };
 
@@ -3151,6 +3307,22 @@ static struct cftype dfl_files[] = {
 		.flags = CFTYPE_DEBUG,
 	},
 
+	{
+		.name = "cpus.batch",
+		.read_u64 = cpuset_read_u64,
+		.write_u64 = cpuset_write_u64,
+		.private = FILE_SCHED_BATCH,
+		.flags = CFTYPE_NOT_ON_ROOT,
+	},
+
+	{
+		.name = "cpus.rebuild_delay_ms",
+		.read_u64 = cpuset_read_u64,
+		.write_u64 = cpuset_write_u64,
+		.private = FILE_REBUILD_DELAY_MS,
+		.flags = CFTYPE_ONLY_ON_ROOT,
+	},
+
 	{ }	/* terminate */
 };
 
@@ -3256,6 +3428,7 @@ static int cpuset_css_online(struct cgroup_subsys_state *css)
 	cpumask_copy(cs->effective_cpus, parent->cpus_allowed);
 	spin_unlock_irq(&callback_lock);
 out_unlock:
+	cpuset_flush_sched_domains();
 	mutex_unlock(&cpuset_mutex);
 	cpus_read_unlock();
 	return 0;
@@ -3296,6 +3469,10 @@ static void cpuset_css_offline(struct cgroup_subsys_state *css)
 	cpuset_dec();
 	clear_bit(CS_ONLINE, &cs->flags);
 
+	if (is_sched_batch(cs))
+		update_sched_batch_cpus();
+
+	cpuset_flush_sched_domains();
 	mutex_unlock(&cpuset_mutex);
 	cpus_read_unlock();
 }
@@ -3800,6 +3977,12 @@ static void cpuset_hotplug_workfn(struct work_struct *work)
 		rebuild_sched_domains();
 	}
 
+	if (cpus_updated) {
+		mutex_lock(&cpuset_mutex);
+		update_sched_batch_cpus();
+		mutex_unlock(&cpuset_mutex);
+	}
+
 	free_cpumasks(NULL, ptmp);
 }
 
@@ -10,6 +10,23 @@
 static DEFINE_SPINLOCK(cgroup_rstat_lock);
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
 
+/*
+ * Flush coalescing.  A flusher which gets cgroup_rstat_lock while no other
+ * flush is ongoing registers its cgroup in cgroup_rstat_ongoing.  Flushers
+ * of a subtree of it then wait for it to finish instead of lining up on
+ * cgroup_rstat_lock only to walk the then empty updated lists again.
+ * cgroup_rstat_flush_seq is odd while a flush is registered.
+ */
+static struct cgroup *cgroup_rstat_ongoing;
+static unsigned long cgroup_rstat_flush_seq;
+static DECLARE_WAIT_QUEUE_HEAD(cgroup_rstat_flush_waitq);
+
+/* how long to wait for an ongoing flush before flushing on our own */
+#define CGROUP_RSTAT_JOIN_TIMEOUT	(HZ / 10)
+
+/* if set, cpu.stat reads skip the flush if stats are at most this old */
+static unsigned long cgroup_rstat_max_age;
+
 static void cgroup_base_stat_flush(struct cgroup *cgrp, int cpu);
 
 static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
@@ -174,10 +191,24 @@ __diag_pop();
 static void cgroup_rstat_flush_locked(struct cgroup *cgrp)
 	__releases(&cgroup_rstat_lock) __acquires(&cgroup_rstat_lock)
 {
+	unsigned long start = jiffies;
+	bool owner = false;
 	int cpu;
 
 	lockdep_assert_held(&cgroup_rstat_lock);
 
+	/*
+	 * Register as the ongoing flusher.  This stays valid while the lock
+	 * is dropped below, other flushers getting the lock meanwhile don't
+	 * register.
+	 */
+	if (!cgroup_rstat_ongoing) {
+		WRITE_ONCE(cgroup_rstat_flush_seq, cgroup_rstat_flush_seq + 1);
+		smp_wmb();
+		WRITE_ONCE(cgroup_rstat_ongoing, cgrp);
+		owner = true;
+	}
+
 	for_each_possible_cpu(cpu) {
 		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
 						       cpu);
@@ -215,6 +246,63 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp)
 			spin_lock_irq(&cgroup_rstat_lock);
 		}
 	}
+
+	WRITE_ONCE(cgrp->rstat_flush_time, start);
+
+	if (owner) {
+		WRITE_ONCE(cgroup_rstat_ongoing, NULL);
+		smp_wmb();
+		WRITE_ONCE(cgroup_rstat_flush_seq, cgroup_rstat_flush_seq + 1);
+		wake_up_all(&cgroup_rstat_flush_waitq);
+	}
+}
+
+/*
+ * Wait for an ongoing flush which covers @cgrp's subtree.  Returns %true if
+ * it completed, @cgrp's stats are then no older than the duration of that
+ * flush.  Returns %false if there is none or it took too long.
+ */
+static bool cgroup_rstat_join_flush(struct cgroup *cgrp)
+{
+	struct cgroup *ongoing;
+	unsigned long seq;
+	bool covered;
+
+	seq = READ_ONCE(cgroup_rstat_flush_seq);
+	if (!(seq & 1))
+		return false;
+
+	/* pairs with the smp_wmb()s in cgroup_rstat_flush_locked() */
+	smp_rmb();
+	rcu_read_lock();
+	ongoing = READ_ONCE(cgroup_rstat_ongoing);
+	covered = ongoing && cgroup_is_descendant(cgrp, ongoing);
+	rcu_read_unlock();
+	smp_rmb();
+
+	/* @ongoing may belong to a later flush */
+	if (!covered || READ_ONCE(cgroup_rstat_flush_seq) != seq)
+		return false;
+
+	return wait_event_timeout(cgroup_rstat_flush_waitq,
+				  READ_ONCE(cgroup_rstat_flush_seq) != seq,
+				  CGROUP_RSTAT_JOIN_TIMEOUT);
+}
+
+/* whether @cgrp's subtree was flushed within the last @max_age jiffies */
+static bool cgroup_rstat_flushed_within(struct cgroup *cgrp,
+					unsigned long max_age)
+{
+	unsigned long now = jiffies;
+
+	/* a flush of an ancestor covers @cgrp as well */
+	for (; cgrp; cgrp = cgroup_parent(cgrp)) {
+		unsigned long last = READ_ONCE(cgrp->rstat_flush_time);
+
+		if (time_in_range(now, last, last + max_age))
+			return true;
+	}
+	return false;
 }
 
 /**
@@ -228,17 +316,56 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp)
  * This also gets all cgroups in the subtree including @cgrp off the
  * ->updated_children lists.
  *
+ * If a flush of @cgrp or one of its ancestors is already ongoing, this
+ * waits for it to finish instead of flushing again.  Updates which raced
+ * with that flush may then still be pending.
+ *
  * This function may block.
  */
 __bpf_kfunc void cgroup_rstat_flush(struct cgroup *cgrp)
 {
 	might_sleep();
 
+	if (cgroup_rstat_join_flush(cgrp))
+		return;
+
+	__cgroup_rstat_flush(cgrp);
+}
+
+/*
+ * cgroup_rstat_flush() without coalescing.  For the release paths, which
+ * need all of @cgrp's subtree off the updated lists.
+ */
+void __cgroup_rstat_flush(struct cgroup *cgrp)
+{
+	might_sleep();
+
 	spin_lock_irq(&cgroup_rstat_lock);
 	cgroup_rstat_flush_locked(cgrp);
 	spin_unlock_irq(&cgroup_rstat_lock);
 }
 
+/**
+ * cgroup_rstat_flush_ratelimited - flush stats in @cgrp's subtree unless recent
+ * @cgrp: target cgroup
+ * @max_age: staleness in jiffies the caller can live with
+ *
+ * Like cgroup_rstat_flush() but skip the flush if @cgrp's subtree was
+ * flushed within the last @max_age jiffies.  For readers which can do with
+ * slightly stale stats and shouldn't pay for a flush on each read.
+ *
+ * This function may block.
+ */
+void cgroup_rstat_flush_ratelimited(struct cgroup *cgrp, unsigned long max_age)
+{
+	might_sleep();
+
+	if (cgroup_rstat_flushed_within(cgrp, max_age))
+		return;
+
+	cgroup_rstat_flush(cgrp);
+}
+
 /**
  * cgroup_rstat_flush_hold - flush stats in @cgrp's subtree and hold
  * @cgrp: target cgroup
@@ -251,9 +378,26 @@ __bpf_kfunc void cgroup_rstat_flush(struct cgroup *cgrp)
 void cgroup_rstat_flush_hold(struct cgroup *cgrp)
 	__acquires(&cgroup_rstat_lock)
 {
+	bool flushed;
+
 	might_sleep();
+	flushed = cgroup_rstat_join_flush(cgrp);
 	spin_lock_irq(&cgroup_rstat_lock);
-	cgroup_rstat_flush_locked(cgrp);
+	if (!flushed)
+		cgroup_rstat_flush_locked(cgrp);
+}
+
+/* cgroup_rstat_flush_hold() unless flushed within cgroup_rstat_max_age */
+static void cgroup_rstat_flush_hold_ratelimited(struct cgroup *cgrp)
+	__acquires(&cgroup_rstat_lock)
+{
+	if (cgroup_rstat_max_age &&
+	    cgroup_rstat_flushed_within(cgrp, cgroup_rstat_max_age)) {
+		spin_lock_irq(&cgroup_rstat_lock);
+		return;
+	}
+
+	cgroup_rstat_flush_hold(cgrp);
 }
 
 /**
@@ -291,7 +435,7 @@ void cgroup_rstat_exit(struct cgroup *cgrp)
 {
 	int cpu;
 
-	cgroup_rstat_flush(cgrp);
+	__cgroup_rstat_flush(cgrp);
 
 	/* sanity check */
 	for_each_possible_cpu(cpu) {
@@ -314,6 +458,18 @@ void __init cgroup_rstat_boot(void)
 		raw_spin_lock_init(per_cpu_ptr(&cgroup_rstat_cpu_lock, cpu));
 }
 
+static int __init cgroup_rstat_max_age_setup(char *str)
+{
+	unsigned int msecs;
+
+	if (kstrtouint(str, 0, &msecs))
+		return 0;
+
+	cgroup_rstat_max_age = msecs_to_jiffies(msecs);
+	return 1;
+}
+__setup("cgroup_rstat_max_age=", cgroup_rstat_max_age_setup);
+
 /*
  * Functions for cgroup basic resource statistics implemented on top of
  * rstat.
@@ -479,7 +635,7 @@ void cgroup_base_stat_cputime_show(struct seq_file *seq)
 #endif
 
 	if (cgroup_parent(cgrp)) {
-		cgroup_rstat_flush_hold(cgrp);
+		cgroup_rstat_flush_hold_ratelimited(cgrp);
 		usage = cgrp->bstat.cputime.sum_exec_runtime;
 		cputime_adjust(&cgrp->bstat.cputime, &cgrp->prev_cputime,
 			       &utime, &stime);
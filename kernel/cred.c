@@ -346,11 +346,17 @@ int copy_creds(struct task_struct *p, unsigned long clone_flags)
 	p->cached_requested_key = NULL;
 #endif
 
+	/*
+	 * Credentials are never changed in place, so a new process can share
+	 * them just like a new thread, unless it needs keyrings or a user
+	 * namespace of its own.
+	 */
 	if (
 #ifdef CONFIG_KEYS
 		!p->cred->thread_keyring &&
+		(clone_flags & CLONE_THREAD || !p->cred->process_keyring) &&
 #endif
-		clone_flags & CLONE_THREAD
+		!(clone_flags & CLONE_NEWUSER)
 	    ) {
 		p->real_cred = get_cred(p->cred);
 		get_cred(p->cred);
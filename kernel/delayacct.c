@@ -13,6 +13,8 @@
 #include <linux/sysctl.h>
 #include <linux/delayacct.h>
 #include <linux/module.h>
+#include <linux/cgroup.h>
+#include <linux/cgroupstats.h>
 
 DEFINE_STATIC_KEY_FALSE(delayacct_key);
 int delayacct_on __read_mostly;	/* Delay accounting turned on/off */
@@ -85,6 +87,97 @@ static __init int kernel_delayacct_sysctls_init(void)
 late_initcall(kernel_delayacct_sysctls_init);
 #endif
 
+#ifdef CONFIG_CGROUPS
+/*
+ * Per CPU delays of the tasks in a cgroup, folded into a struct
+ * cgroup_delaystats when read.
+ */
+struct cgroup_delay_cpu {
+	u64 delay[CGROUPSTATS_DELAY_NR];
+	u64 count[CGROUPSTATS_DELAY_NR];
+	u32 hist[CGROUPSTATS_DELAY_NR][CGROUPSTATS_DELAY_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct cgroup_delay_cpu, root_cgroup_delays);
+
+static struct cgroup_delay_cpu __percpu *cgroup_delays(struct cgroup *cgrp)
+{
+	return cgroup_parent(cgrp) ? cgrp->delays : &root_cgroup_delays;
+}
+
+int delayacct_cgroup_alloc(struct cgroup *cgrp)
+{
+	/* Cgroups created with delay accounting off don't pay for it */
+	if (!delayacct_on || !cgroup_on_dfl(cgrp))
+		return 0;
+
+	cgrp->delays = alloc_percpu(struct cgroup_delay_cpu);
+	if (!cgrp->delays)
+		return -ENOMEM;
+	return 0;
+}
+
+void delayacct_cgroup_free(struct cgroup *cgrp)
+{
+	free_percpu(cgrp->delays);
+	cgrp->delays = NULL;
+}
+
+/* See the bucket layout described with struct cgroup_delaystats */
+static inline unsigned int delay_hist_bucket(u64 ns)
+{
+	unsigned int bucket = (fls64(ns >> 10) + 1) / 2;
+
+	return min_t(unsigned int, bucket, CGROUPSTATS_DELAY_BUCKETS - 1);
+}
+
+static void cgroup_delay_add(struct task_struct *tsk, int type, u64 ns)
+{
+	struct cgroup_delay_cpu __percpu *delays;
+
+	rcu_read_lock();
+	delays = cgroup_delays(task_dfl_cgroup(tsk));
+	if (delays) {
+		this_cpu_add(delays->delay[type], ns);
+		this_cpu_inc(delays->count[type]);
+		this_cpu_inc(delays->hist[type][delay_hist_bucket(ns)]);
+	}
+	rcu_read_unlock();
+}
+
+bool delayacct_cgroup_read(struct cgroup *cgrp,
+			   struct cgroup_delaystats *stats)
+{
+	struct cgroup_delay_cpu __percpu *delays = cgroup_delays(cgrp);
+	int cpu, i, j;
+
+	if (!delays)
+		return false;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->cgroup_id = cgroup_id(cgrp);
+	stats->version = CGROUP_DELAYSTATS_VERSION;
+	stats->nr_buckets = CGROUPSTATS_DELAY_BUCKETS;
+
+	for_each_possible_cpu(cpu) {
+		struct cgroup_delay_cpu *dc = per_cpu_ptr(delays, cpu);
+
+		for (i = 0; i < CGROUPSTATS_DELAY_NR; i++) {
+			stats->delay_total[i] += READ_ONCE(dc->delay[i]);
+			stats->count[i] += READ_ONCE(dc->count[i]);
+			for (j = 0; j < CGROUPSTATS_DELAY_BUCKETS; j++)
+				stats->hist[i][j] += READ_ONCE(dc->hist[i][j]);
+		}
+	}
+
+	return true;
+}
+#else
+static inline void cgroup_delay_add(struct task_struct *tsk, int type, u64 ns)
+{
+}
+#endif /* CONFIG_CGROUPS */
+
 void __delayacct_tsk_init(struct task_struct *tsk)
 {
 	tsk->delays = kmem_cache_zalloc(delayacct_cache, GFP_KERNEL);
@@ -93,19 +186,22 @@ void __delayacct_tsk_init(struct task_struct *tsk)
 }
 
 /*
- * Finish delay accounting for a statistic using its timestamps (@start),
- * accumalator (@total) and @count
+ * Finish delay accounting of @tsk for a statistic using its timestamps
+ * (@start), accumalator (@total) and @count, and charge it to the cgroup
+ * of @tsk as @type.
  */
-static void delayacct_end(raw_spinlock_t *lock, u64 *start, u64 *total, u32 *count)
+static void delayacct_end(struct task_struct *tsk, int type, u64 *start,
+			  u64 *total, u32 *count)
 {
 	s64 ns = local_clock() - *start;
 	unsigned long flags;
 
 	if (ns > 0) {
-		raw_spin_lock_irqsave(lock, flags);
+		raw_spin_lock_irqsave(&tsk->delays->lock, flags);
 		*total += ns;
 		(*count)++;
-		raw_spin_unlock_irqrestore(lock, flags);
+		raw_spin_unlock_irqrestore(&tsk->delays->lock, flags);
+		cgroup_delay_add(tsk, type, ns);
 	}
 }
 
@@ -120,7 +216,7 @@ void __delayacct_blkio_start(void)
  */
 void __delayacct_blkio_end(struct task_struct *p)
 {
-	delayacct_end(&p->delays->lock,
+	delayacct_end(p, CGROUPSTATS_DELAY_BLKIO,
 		      &p->delays->blkio_start,
 		      &p->delays->blkio_delay,
 		      &p->delays->blkio_count);
@@ -211,7 +307,7 @@ void __delayacct_freepages_start(void)
 
 void __delayacct_freepages_end(void)
 {
-	delayacct_end(&current->delays->lock,
+	delayacct_end(current, CGROUPSTATS_DELAY_FREEPAGES,
 		      &current->delays->freepages_start,
 		      &current->delays->freepages_delay,
 		      &current->delays->freepages_count);
@@ -233,7 +329,7 @@ void __delayacct_thrashing_end(bool *in_thrashing)
 		return;
 
 	current->in_thrashing = 0;
-	delayacct_end(&current->delays->lock,
+	delayacct_end(current, CGROUPSTATS_DELAY_THRASHING,
 		      &current->delays->thrashing_start,
 		      &current->delays->thrashing_delay,
 		      &current->delays->thrashing_count);
@@ -246,7 +342,7 @@ void __delayacct_swapin_start(void)
 
 void __delayacct_swapin_end(void)
 {
-	delayacct_end(&current->delays->lock,
+	delayacct_end(current, CGROUPSTATS_DELAY_SWAPIN,
 		      &current->delays->swapin_start,
 		      &current->delays->swapin_delay,
 		      &current->delays->swapin_count);
@@ -259,7 +355,7 @@ void __delayacct_compact_start(void)
 
 void __delayacct_compact_end(void)
 {
-	delayacct_end(&current->delays->lock,
+	delayacct_end(current, CGROUPSTATS_DELAY_COMPACT,
 		      &current->delays->compact_start,
 		      &current->delays->compact_delay,
 		      &current->delays->compact_count);
@@ -272,7 +368,7 @@ void __delayacct_wpcopy_start(void)
 
 void __delayacct_wpcopy_end(void)
 {
-	delayacct_end(&current->delays->lock,
+	delayacct_end(current, CGROUPSTATS_DELAY_WPCOPY,
 		      &current->delays->wpcopy_start,
 		      &current->delays->wpcopy_delay,
 		      &current->delays->wpcopy_count);
@@ -286,5 +382,11 @@ void __delayacct_irq(struct task_struct *task, u32 delta)
 	task->delays->irq_delay += delta;
 	task->delays->irq_count++;
 	raw_spin_unlock_irqrestore(&task->delays->lock, flags);
+	cgroup_delay_add(task, CGROUPSTATS_DELAY_IRQ, delta);
+}
+
+void __delayacct_cpu_wait(struct task_struct *task, u64 delta)
+{
+	cgroup_delay_add(task, CGROUPSTATS_DELAY_CPU, delta);
 }
 
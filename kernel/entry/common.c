@@ -155,7 +155,8 @@ static unsigned long exit_to_user_mode_loop(struct pt_regs *regs,
 
 		local_irq_enable_exit_to_user(ti_work);
 
-		if (ti_work & _TIF_NEED_RESCHED)
+		if ((ti_work & _TIF_NEED_RESCHED) &&
+		    !rseq_slice_extension_grant())
 			schedule();
 
 		if (ti_work & _TIF_UPROBE)
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Run a vector of simple system calls in one kernel entry
+ *
+ * Each system call pays for the entry and exit work and, on hosts with
+ * speculation mitigations enabled, for the mitigations on every crossing.
+ * syscall_batch() runs a vector of small, independent system calls with a
+ * single crossing. Every element is still subject to seccomp and audit as
+ * if it had been issued on its own, so a batch can't be used to get around
+ * a filter.
+ *
+ * Only system calls which don't depend on the register state of the task
+ * can be batched: they are called through their in-kernel helpers, not
+ * through the system call table.
+ */
+#include <linux/audit.h>
+#include <linux/entry-common.h>
+#include <linux/fdtable.h>
+#include <linux/mm.h>
+#include <linux/sched/signal.h>
+#include <linux/sched/task_stack.h>
+#include <linux/seccomp.h>
+#include <linux/syscalls.h>
+#include <linux/uaccess.h>
+
+#include <uapi/linux/syscall_batch.h>
+
+#include <asm/syscall.h>
+
+static long __batch_call(unsigned int nr, const u64 *args)
+{
+	switch (nr) {
+	case __NR_close:
+		return close_fd(args[0]);
+	case __NR_read:
+		return ksys_read(args[0], u64_to_user_ptr(args[1]), args[2]);
+	case __NR_write:
+		return ksys_write(args[0], u64_to_user_ptr(args[1]), args[2]);
+#ifdef CONFIG_64BIT
+	case __NR_pread64:
+		return ksys_pread64(args[0], u64_to_user_ptr(args[1]), args[2],
+				    args[3]);
+	case __NR_pwrite64:
+		return ksys_pwrite64(args[0], u64_to_user_ptr(args[1]), args[2],
+				     args[3]);
+	case __NR_ftruncate:
+		return ksys_ftruncate(args[0], args[1]);
+#endif
+#ifdef CONFIG_ADVISE_SYSCALLS
+	case __NR_madvise:
+		return do_madvise(current->mm, args[0], args[1], args[2]);
+#endif
+	default:
+		return -ENOSYS;
+	}
+}
+
+static long batch_call(unsigned int nr, const u64 *args)
+{
+	long ret = __batch_call(nr, args);
+
+	/*
+	 * An element can't be restarted, the batch returns to user space
+	 * with the elements done so far, just as close can't be restarted
+	 * because its file table entry was cleared.
+	 */
+	if (unlikely(ret == -ERESTARTSYS || ret == -ERESTARTNOINTR ||
+		     ret == -ERESTARTNOHAND || ret == -ERESTART_RESTARTBLOCK))
+		ret = -EINTR;
+
+	return ret;
+}
+
+#ifdef CONFIG_AUDITSYSCALL
+/*
+ * The record of the batch itself is completed before the first element, so
+ * that each element gets a record of its own.
+ */
+static void batch_audit_begin(unsigned int nr)
+{
+	if (unlikely(audit_context()))
+		__audit_syscall_exit(1, nr);
+}
+
+static void batch_audit_entry(const struct syscall_batch_entry *e)
+{
+	audit_syscall_entry(e->nr, e->args[0], e->args[1], e->args[2],
+			    e->args[3]);
+}
+
+static void batch_audit_exit(long ret)
+{
+	if (unlikely(audit_context()))
+		__audit_syscall_exit(!IS_ERR_VALUE(ret), ret);
+}
+#else
+static inline void batch_audit_begin(unsigned int nr) { }
+static inline void batch_audit_entry(const struct syscall_batch_entry *e) { }
+static inline void batch_audit_exit(long ret) { }
+#endif
+
+/*
+ * Run the seccomp filters for an element. Returns false if the element must
+ * not be run, in which case the filter has stored its return value in the
+ * registers of the task.
+ */
+static bool batch_seccomp(const struct syscall_batch_entry *e)
+{
+	struct seccomp_data sd;
+	int i;
+
+	if (!test_syscall_work(SECCOMP))
+		return true;
+
+	sd.nr = e->nr;
+	sd.arch = syscall_get_arch(current);
+	for (i = 0; i < ARRAY_SIZE(sd.args); i++)
+		sd.args[i] = e->args[i];
+	sd.instruction_pointer = KSTK_EIP(current);
+
+	return __secure_computing(&sd) != -1;
+}
+
+/**
+ * sys_syscall_batch - run a vector of system calls
+ * @entries:	Vector of system calls
+ * @nr:		Number of entries in @entries
+ * @flags:	SYSCALL_BATCH_* flags
+ *
+ * The return value of each system call is stored in its entry. The batch
+ * stops early when an element is refused by seccomp, when a signal is
+ * pending and, with SYSCALL_BATCH_STOP_ON_ERROR, at the first element which
+ * fails.
+ *
+ * Return: the number of entries which were run, or a negative error code if
+ * none was.
+ */
+SYSCALL_DEFINE3(syscall_batch, struct syscall_batch_entry __user *, entries,
+		unsigned int, nr, unsigned int, flags)
+{
+	struct syscall_batch_entry e;
+	unsigned int i;
+
+	if (flags & ~SYSCALL_BATCH_STOP_ON_ERROR)
+		return -EINVAL;
+	if (!nr || nr > SYSCALL_BATCH_MAX)
+		return -EINVAL;
+	/* The elements are native system call numbers */
+	if (in_compat_syscall())
+		return -ENOSYS;
+
+	batch_audit_begin(nr);
+
+	for (i = 0; i < nr; i++) {
+		if (copy_from_user(&e, &entries[i], offsetof(typeof(e), ret)))
+			return i ? i : -EFAULT;
+		if (e.flags)
+			return i ? i : -EINVAL;
+
+		if (!batch_seccomp(&e)) {
+			e.ret = syscall_get_return_value(current,
+							 current_pt_regs());
+			put_user(e.ret, &entries[i].ret);
+			return i + 1;
+		}
+
+		batch_audit_entry(&e);
+		e.ret = batch_call(e.nr, e.args);
+		batch_audit_exit(e.ret);
+
+		if (put_user(e.ret, &entries[i].ret))
+			return i + 1;
+		if ((flags & SYSCALL_BATCH_STOP_ON_ERROR) && IS_ERR_VALUE(e.ret))
+			return i + 1;
+		if (signal_pending(current))
+			return i + 1;
+		cond_resched();
+	}
+
+	return nr;
+}
@@ -99,6 +99,7 @@
 #include <linux/stackprotector.h>
 #include <linux/user_events.h>
 #include <linux/iommu.h>
+#include <uapi/linux/pidfd.h>
 
 #include <asm/pgalloc.h>
 #include <linux/uaccess.h>
@@ -1282,6 +1283,7 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 	mm->pmd_huge_pte = NULL;
 #endif
 	mm_init_uprobes_state(mm);
+	membarrier_mm_init(mm);
 	hugetlb_count_init(mm);
 
 	if (current->mm) {
@@ -1896,6 +1898,9 @@ static int copy_signal(unsigned long clone_flags, struct task_struct *tsk)
 
 	mutex_init(&sig->cred_guard_mutex);
 	init_rwsem(&sig->exec_update_lock);
+#ifdef CONFIG_CGROUPS
+	init_rwsem(&sig->cgroup_threadgroup_rwsem);
+#endif
 
 	return 0;
 }
@@ -2072,6 +2077,192 @@ static void pidfd_show_fdinfo(struct seq_file *m, struct file *f)
 }
 #endif
 
+static void pidfd_info_creds(struct task_struct *task, struct pidfd_info *info)
+{
+	struct user_namespace *user_ns = current_user_ns();
+	const struct cred *cred;
+
+	rcu_read_lock();
+	cred = __task_cred(task);
+	info->ruid = from_kuid_munged(user_ns, cred->uid);
+	info->rgid = from_kgid_munged(user_ns, cred->gid);
+	info->euid = from_kuid_munged(user_ns, cred->euid);
+	info->egid = from_kgid_munged(user_ns, cred->egid);
+	info->suid = from_kuid_munged(user_ns, cred->suid);
+	info->sgid = from_kgid_munged(user_ns, cred->sgid);
+	info->fsuid = from_kuid_munged(user_ns, cred->fsuid);
+	info->fsgid = from_kgid_munged(user_ns, cred->fsgid);
+	rcu_read_unlock();
+}
+
+/* Same accounting as the whole thread group view of /proc/<pid>/stat */
+static bool pidfd_info_stat(struct task_struct *task, struct pidfd_info *info)
+{
+	unsigned long min_flt = 0, maj_flt = 0, flags;
+	struct task_struct *t = task;
+	u64 utime, stime;
+
+	if (!lock_task_sighand(task, &flags))
+		return false;
+
+	do {
+		min_flt += t->min_flt;
+		maj_flt += t->maj_flt;
+	} while_each_thread(task, t);
+	min_flt += task->signal->min_flt;
+	maj_flt += task->signal->maj_flt;
+	thread_group_cputime_adjusted(task, &utime, &stime);
+	info->nr_threads = get_nr_threads(task);
+
+	unlock_task_sighand(task, &flags);
+
+	info->state = task_state_to_char(task);
+	info->utime = utime;
+	info->stime = stime;
+	info->min_flt = min_flt;
+	info->maj_flt = maj_flt;
+	info->start_time = task->start_boottime;
+	return true;
+}
+
+static bool pidfd_info_mem(struct task_struct *task, struct pidfd_info *info)
+{
+	struct mm_struct *mm;
+
+	mm = get_task_mm(task);
+	if (!mm)
+		return false;
+
+	info->vsize = (u64)mm->total_vm << PAGE_SHIFT;
+	info->rss = (u64)get_mm_rss(mm) << PAGE_SHIFT;
+	mmput(mm);
+	return true;
+}
+
+/* Same checks and accounting as /proc/<pid>/io */
+static bool pidfd_info_io(struct task_struct *task, struct pidfd_info *info)
+{
+	struct task_io_accounting acct = task->ioac;
+	unsigned long flags;
+	bool ret = false;
+
+	if (down_read_killable(&task->signal->exec_update_lock))
+		return false;
+
+	if (!ptrace_may_access(task, PTRACE_MODE_READ_FSCREDS))
+		goto out_unlock;
+
+	if (lock_task_sighand(task, &flags)) {
+		struct task_struct *t = task;
+
+		task_io_accounting_add(&acct, &task->signal->ioac);
+		while_each_thread(task, t)
+			task_io_accounting_add(&acct, &t->ioac);
+
+		unlock_task_sighand(task, &flags);
+	}
+
+	info->rchar = acct.rchar;
+	info->wchar = acct.wchar;
+	info->syscr = acct.syscr;
+	info->syscw = acct.syscw;
+	info->read_bytes = acct.read_bytes;
+	info->write_bytes = acct.write_bytes;
+	info->cancelled_write_bytes = acct.cancelled_write_bytes;
+	ret = true;
+
+out_unlock:
+	up_read(&task->signal->exec_update_lock);
+	return ret;
+}
+
+static_assert(offsetofend(struct pidfd_info, cancelled_write_bytes) ==
+	      PIDFD_INFO_SIZE_VER0);
+
+/*
+ * Return the status of the task in one call, so that a monitor polling many
+ * tasks doesn't have to open and parse several files under /proc/<pid>.
+ * Fields that can't be provided, because the task is exiting or the caller
+ * lacks the permission, are cleared from the returned mask.
+ */
+static long pidfd_get_info(struct pid *pid, unsigned int cmd,
+			   struct pidfd_info __user *uinfo)
+{
+	size_t usize = _IOC_SIZE(cmd);
+	struct pidfd_info info = {};
+	struct task_struct *task;
+	u64 mask;
+
+	if (usize < PIDFD_INFO_SIZE_VER0)
+		return -EINVAL;
+	if (copy_from_user(&mask, &uinfo->mask, sizeof(mask)))
+		return -EFAULT;
+
+	task = get_pid_task(pid, PIDTYPE_PID);
+	if (!task)
+		return -ESRCH;
+
+	if (mask & PIDFD_INFO_PID) {
+		struct pid_namespace *ns = task_active_pid_ns(current);
+
+		info.pid = task_pid_nr_ns(task, ns);
+		info.tgid = task_tgid_nr_ns(task, ns);
+		info.ppid = task_ppid_nr_ns(task, ns);
+		/* the task isn't visible from the pid namespace of the caller */
+		if (!info.pid)
+			mask &= ~PIDFD_INFO_PID;
+	}
+
+	if (mask & PIDFD_INFO_CREDS)
+		pidfd_info_creds(task, &info);
+
+	if (mask & PIDFD_INFO_CGROUPID) {
+#ifdef CONFIG_CGROUPS
+		rcu_read_lock();
+		info.cgroupid = cgroup_id(task_dfl_cgroup(task));
+		rcu_read_unlock();
+#else
+		mask &= ~PIDFD_INFO_CGROUPID;
+#endif
+	}
+
+	if ((mask & PIDFD_INFO_STAT) && !pidfd_info_stat(task, &info))
+		mask &= ~PIDFD_INFO_STAT;
+
+	if ((mask & PIDFD_INFO_MEM) && !pidfd_info_mem(task, &info))
+		mask &= ~PIDFD_INFO_MEM;
+
+	if ((mask & PIDFD_INFO_IO) && !pidfd_info_io(task, &info))
+		mask &= ~PIDFD_INFO_IO;
+
+	put_task_struct(task);
+
+	info.mask = mask & (PIDFD_INFO_PID | PIDFD_INFO_CREDS |
+			    PIDFD_INFO_CGROUPID | PIDFD_INFO_STAT |
+			    PIDFD_INFO_MEM | PIDFD_INFO_IO);
+
+	if (copy_to_user(uinfo, &info, min(usize, sizeof(info))))
+		return -EFAULT;
+	/* the caller knows of fields this kernel doesn't have */
+	if (usize > sizeof(info) &&
+	    clear_user((void __user *)uinfo + sizeof(info), usize - sizeof(info)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static long pidfd_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct pid *pid = file->private_data;
+
+	if (_IOC_TYPE(cmd) == _IOC_TYPE(PIDFD_GET_INFO) &&
+	    _IOC_NR(cmd) == _IOC_NR(PIDFD_GET_INFO) &&
+	    _IOC_DIR(cmd) == _IOC_DIR(PIDFD_GET_INFO))
+		return pidfd_get_info(pid, cmd, (void __user *)arg);
+
+	return -ENOTTY;
+}
+
 /*
  * Poll support for process exit notification.
  */
@@ -2096,6 +2287,8 @@ static __poll_t pidfd_poll(struct file *file, struct poll_table_struct *pts)
 const struct file_operations pidfd_fops = {
 	.release = pidfd_release,
 	.poll = pidfd_poll,
+	.unlocked_ioctl = pidfd_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
 #ifdef CONFIG_PROC_FS
 	.show_fdinfo = pidfd_show_fdinfo,
 #endif
@@ -2458,6 +2651,9 @@ __latent_entropy struct task_struct *copy_process(
 	lockdep_init_task(p);
 #endif
 
+#ifdef CONFIG_LOCK_CONTENTION_PROFILE
+	p->lock_contention.depth = 0;
+#endif
 #ifdef CONFIG_DEBUG_MUTEXES
 	p->blocked_on = NULL; /* not blocked yet */
 #endif
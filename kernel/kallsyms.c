@@ -31,6 +31,9 @@
 #include <linux/kernel.h>
 #include <linux/bsearch.h>
 #include <linux/btf_ids.h>
+#include <linux/hash.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
 
 #include "kallsyms_internal.h"
 
@@ -109,6 +112,32 @@ static char kallsyms_get_symbol_type(unsigned int off)
 }
 
 
+#ifdef CONFIG_KALLSYMS_HASH
+/*
+ * Index built at boot: the offset of every symbol in the compressed stream,
+ * and a hash table of the (cleaned up) names whose chains link positions in
+ * kallsyms_seqs_of_names in ascending order.
+ */
+static u32 *kallsyms_name_offsets;
+static u32 *kallsyms_hash_heads;
+static u32 *kallsyms_hash_next;
+static unsigned int kallsyms_hash_bits;
+static bool kallsyms_indexed;
+
+#define KALLSYMS_HASH_END	U32_MAX
+
+static inline bool kallsyms_index_ready(void)
+{
+	/* Pairs with smp_store_release() in kallsyms_build_index() */
+	return smp_load_acquire(&kallsyms_indexed);
+}
+#else
+static inline bool kallsyms_index_ready(void)
+{
+	return false;
+}
+#endif
+
 /*
  * Find the offset on the compressed stream given and index in the
  * kallsyms array.
@@ -118,6 +147,11 @@ static unsigned int get_symbol_offset(unsigned long pos)
 	const u8 *name;
 	int i, len;
 
+#ifdef CONFIG_KALLSYMS_HASH
+	if (kallsyms_index_ready())
+		return kallsyms_name_offsets[pos];
+#endif
+
 	/*
 	 * Use the closest marker we have. We have markers every 256 positions,
 	 * so that should be close enough.
@@ -211,6 +245,102 @@ static unsigned int get_symbol_seq(int index)
 	return seq;
 }
 
+#ifdef CONFIG_KALLSYMS_HASH
+static u32 kallsyms_name_hash(const char *name)
+{
+	return hash_32(jhash(name, strlen(name), 0), kallsyms_hash_bits);
+}
+
+static int kallsyms_hash_lookup_names(const char *name,
+				      unsigned int *start,
+				      unsigned int *end)
+{
+	char namebuf[KSYM_NAME_LEN];
+	char key[KSYM_NAME_LEN];
+	unsigned int found = 0;
+	u32 pos;
+
+	if (strscpy(key, name, sizeof(key)) < 0)
+		return -ESRCH;
+	/* Names are hashed without the suffixes compare_symbol_name() skips */
+	cleanup_symbol_name(key);
+
+	for (pos = kallsyms_hash_heads[kallsyms_name_hash(key)];
+	     pos != KALLSYMS_HASH_END; pos = kallsyms_hash_next[pos]) {
+		kallsyms_expand_symbol(get_symbol_offset(get_symbol_seq(pos)),
+				       namebuf, ARRAY_SIZE(namebuf));
+		if (compare_symbol_name(name, namebuf))
+			continue;
+		if (!found++) {
+			*start = pos;
+			if (!end)
+				break;
+		}
+		*end = pos;
+	}
+
+	return found ? 0 : -ESRCH;
+}
+
+static int __init kallsyms_build_index(void)
+{
+	char namebuf[KSYM_NAME_LEN];
+	unsigned int i, off, len;
+	const u8 *name;
+
+	if (!kallsyms_num_syms)
+		return 0;
+
+	kallsyms_hash_bits = ilog2(roundup_pow_of_two(kallsyms_num_syms));
+	kallsyms_name_offsets = kvmalloc_array(kallsyms_num_syms, sizeof(u32),
+					       GFP_KERNEL);
+	kallsyms_hash_next = kvmalloc_array(kallsyms_num_syms, sizeof(u32),
+					    GFP_KERNEL);
+	kallsyms_hash_heads = kvmalloc_array(1U << kallsyms_hash_bits,
+					     sizeof(u32), GFP_KERNEL);
+	if (!kallsyms_name_offsets || !kallsyms_hash_next ||
+	    !kallsyms_hash_heads)
+		goto fail;
+
+	/* Same walk as get_symbol_offset(), once for all symbols */
+	for (i = 0, off = 0; i < kallsyms_num_syms; i++) {
+		kallsyms_name_offsets[i] = off;
+		name = &kallsyms_names[off];
+		len = *name;
+		if ((len & 0x80) != 0)
+			len = ((len & 0x7F) | (name[1] << 7)) + 1;
+		off += len + 1;
+	}
+
+	memset(kallsyms_hash_heads, 0xff,
+	       sizeof(u32) << kallsyms_hash_bits);
+	/* Insert backwards so that the chains come out in ascending order */
+	for (i = kallsyms_num_syms; i-- > 0; ) {
+		u32 hash;
+
+		kallsyms_expand_symbol(kallsyms_name_offsets[get_symbol_seq(i)],
+				       namebuf, ARRAY_SIZE(namebuf));
+		cleanup_symbol_name(namebuf);
+		hash = kallsyms_name_hash(namebuf);
+		kallsyms_hash_next[i] = kallsyms_hash_heads[hash];
+		kallsyms_hash_heads[hash] = i;
+
+		if (!(i & 0xfff))
+			cond_resched();
+	}
+
+	smp_store_release(&kallsyms_indexed, true);
+	return 0;
+
+fail:
+	kvfree(kallsyms_name_offsets);
+	kvfree(kallsyms_hash_next);
+	kvfree(kallsyms_hash_heads);
+	return -ENOMEM;
+}
+late_initcall(kallsyms_build_index);
+#endif
+
 static int kallsyms_lookup_names(const char *name,
 				 unsigned int *start,
 				 unsigned int *end)
@@ -220,6 +350,11 @@ static int kallsyms_lookup_names(const char *name,
 	unsigned int seq, off;
 	char namebuf[KSYM_NAME_LEN];
 
+#ifdef CONFIG_KALLSYMS_HASH
+	if (kallsyms_index_ready())
+		return kallsyms_hash_lookup_names(name, start, end);
+#endif
+
 	low = 0;
 	high = kallsyms_num_syms - 1;
 
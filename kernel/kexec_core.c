@@ -277,6 +277,9 @@ struct kimage *do_kimage_alloc_init(void)
 	/* Initialize the list of unusable pages */
 	INIT_LIST_HEAD(&image->unusable_pages);
 
+	xa_init(&image->dest_pages_xa);
+	xa_init(&image->source_entries);
+
 	return image;
 }
 
@@ -621,6 +624,8 @@ void kimage_free(struct kimage *image)
 	}
 
 	kimage_free_extra_pages(image);
+	xa_destroy(&image->dest_pages_xa);
+	xa_destroy(&image->source_entries);
 	for_each_kimage_entry(image, ptr, entry) {
 		if (entry & IND_INDIRECTION) {
 			/* Free the previous indirection page */
@@ -656,20 +661,7 @@ void kimage_free(struct kimage *image)
 static kimage_entry_t *kimage_dst_used(struct kimage *image,
 					unsigned long page)
 {
-	kimage_entry_t *ptr, entry;
-	unsigned long destination = 0;
-
-	for_each_kimage_entry(image, ptr, entry) {
-		if (entry & IND_DESTINATION)
-			destination = entry & PAGE_MASK;
-		else if (entry & IND_SOURCE) {
-			if (page == destination)
-				return ptr;
-			destination += PAGE_SIZE;
-		}
-	}
-
-	return NULL;
+	return xa_load(&image->source_entries, page >> PAGE_SHIFT);
 }
 
 static struct page *kimage_alloc_page(struct kimage *image,
@@ -689,26 +681,22 @@ static struct page *kimage_alloc_page(struct kimage *image,
 	 * that no problems will not occur is trivial, and the
 	 * implementation is simply to verify.
 	 *
-	 * When allocating all pages normally this algorithm will run
-	 * in O(N) time, but in the worst case it will run in O(N^2)
-	 * time.   If the runtime is a problem the data structures can
-	 * be fixed.
+	 * The destination pages we set aside and the source entries are
+	 * indexed by address, so this doesn't have to walk them for every
+	 * page, which made loading large images O(N^2).
 	 */
 	struct page *page;
 	unsigned long addr;
 
-	/*
-	 * Walk through the list of destination pages, and see if I
-	 * have a match.
-	 */
-	list_for_each_entry(page, &image->dest_pages, lru) {
-		addr = page_to_boot_pfn(page) << PAGE_SHIFT;
-		if (addr == destination) {
+	/* See if I have set aside the destination page already */
+	if (destination != KIMAGE_NO_DEST) {
+		page = xa_erase(&image->dest_pages_xa,
+				destination >> PAGE_SHIFT);
+		if (page) {
 			list_del(&page->lru);
 			return page;
 		}
 	}
-	page = NULL;
 	while (1) {
 		kimage_entry_t *old;
 
@@ -761,8 +749,14 @@ static struct page *kimage_alloc_page(struct kimage *image,
 			page = old_page;
 			break;
 		}
-		/* Place the page on the destination list, to be used later */
+		/*
+		 * Place the page on the destination list, to be used later.
+		 * If it can't be indexed it just doesn't get reused, and is
+		 * freed with the rest of the list.
+		 */
 		list_add(&page->lru, &image->dest_pages);
+		xa_store(&image->dest_pages_xa, addr >> PAGE_SHIFT, page,
+			 GFP_KERNEL);
 	}
 
 	return page;
@@ -803,6 +797,12 @@ static int kimage_load_normal_segment(struct kimage *image,
 								<< PAGE_SHIFT);
 		if (result < 0)
 			goto out;
+		/* kimage_alloc_page() relies on finding every source entry */
+		result = xa_err(xa_store(&image->source_entries,
+					 maddr >> PAGE_SHIFT, image->entry - 1,
+					 GFP_KERNEL));
+		if (result < 0)
+			goto out;
 
 		ptr = kmap_local_page(page);
 		/* Start with a clear page */
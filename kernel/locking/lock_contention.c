@@ -0,0 +1,458 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Lock contention profiler
+ *
+ * A lightweight alternative to lock_stat that doesn't need lockdep. It hooks
+ * the lock:contention_begin and lock:contention_end tracepoints, which the
+ * slow paths of the mutex, rwsem, rtmutex, semaphore, percpu-rwsem, qrwlock
+ * and qspinlock code already call, so it costs nothing while turned off.
+ *
+ * Once turned on with
+ *
+ *	echo 1 > /sys/kernel/debug/lock_contention/enable
+ *
+ * each contended acquisition is charged to its callsite, i.e. the first
+ * caller outside of the locking and scheduler code, in a per-CPU table:
+ *
+ *  - a log2 histogram of the time spent waiting;
+ *  - a log2 histogram of the hold time of the acquisitions that had to
+ *    wait. This is the time until the next waiter of the same lock got it,
+ *    which is only known when somebody was already queued behind us; it
+ *    doesn't account for uncontended owners that slipped in between.
+ *
+ * The tables are summed up in /sys/kernel/debug/lock_contention/stats,
+ * sorted by total wait time. Writing to .../reset clears them.
+ */
+#include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/kallsyms.h>
+#include <linux/log2.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/sched/debug.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/stacktrace.h>
+#include <linux/vmalloc.h>
+
+#include <trace/events/lock.h>
+
+#define LCP_SITES_BITS		8
+#define LCP_SITES		(1U << LCP_SITES_BITS)
+#define LCP_PROBES		8
+
+#define LCP_HIST_SHIFT		8	/* first bucket: < 256ns */
+#define LCP_HIST		24
+
+#define LCP_OWNERS_BITS		10
+#define LCP_STACK_DEPTH		16
+
+struct lcp_site {
+	unsigned long		ip;
+	unsigned int		flags;
+	u64			nr_wait;
+	u64			wait_total;
+	u64			wait_max;
+	u64			nr_hold;
+	u64			hold_total;
+	u64			hold_max;
+	u32			wait_hist[LCP_HIST];
+	u32			hold_hist[LCP_HIST];
+};
+
+struct lcp_table {
+	struct lcp_site		sites[LCP_SITES];
+	unsigned long		dropped;
+};
+
+/*
+ * Last contended acquisition of a lock, used to measure its hold time.
+ * Updated without synchronization; a torn entry costs one bogus sample.
+ */
+struct lcp_owner {
+	void			*lock;
+	unsigned long		ip;
+	unsigned int		flags;
+	u64			acquired;
+};
+
+static DEFINE_PER_CPU(struct lcp_table *, lcp_tables);
+static DEFINE_PER_CPU(struct lock_contention_stack, lcp_irq_stack[2]);
+static struct lcp_owner lcp_owners[1U << LCP_OWNERS_BITS];
+
+static DEFINE_MUTEX(lcp_mutex);
+static bool lcp_enabled;
+
+/*
+ * The waits of each context are tracked on their own stack: tasks can
+ * migrate while waiting for a sleeping lock, interrupts nest on a CPU.
+ */
+static struct lock_contention_stack *lcp_stack(void)
+{
+	unsigned char level = interrupt_context_level();
+
+	if (!level)
+		return &current->lock_contention;
+
+	return this_cpu_ptr(&lcp_irq_stack[level - 1]);
+}
+
+/*
+ * Return the first caller below the locking (and scheduler) functions.
+ */
+static unsigned long lcp_callsite(void)
+{
+	unsigned long entries[LCP_STACK_DEPTH];
+	bool in_lock = false;
+	unsigned int i, nr;
+
+	nr = stack_trace_save(entries, ARRAY_SIZE(entries), 0);
+	for (i = 0; i < nr; i++) {
+		if (in_sched_functions(entries[i]) ||
+		    in_lock_functions(entries[i]))
+			in_lock = true;
+		else if (in_lock)
+			return entries[i];
+	}
+
+	return nr ? entries[nr - 1] : 0;
+}
+
+static struct lcp_site *lcp_site(unsigned long ip, unsigned int flags)
+{
+	struct lcp_table *table = this_cpu_read(lcp_tables);
+	unsigned int i, idx = hash_long(ip, LCP_SITES_BITS);
+
+	for (i = 0; i < LCP_PROBES; i++, idx = (idx + 1) % LCP_SITES) {
+		struct lcp_site *site = &table->sites[idx];
+
+		if (site->ip == ip && site->flags == flags)
+			return site;
+		if (!site->ip) {
+			site->ip = ip;
+			site->flags = flags;
+			return site;
+		}
+	}
+
+	table->dropped++;
+	return NULL;
+}
+
+static inline unsigned int lcp_bucket(u64 ns)
+{
+	int bucket = ns ? ilog2(ns) + 1 - LCP_HIST_SHIFT : 0;
+
+	return clamp(bucket, 0, LCP_HIST - 1);
+}
+
+static void lcp_account(unsigned long ip, unsigned int flags, u64 wait,
+			unsigned long hold_ip, unsigned int hold_flags, u64 hold)
+{
+	struct lcp_site *site;
+	unsigned long irqflags;
+
+	local_irq_save(irqflags);
+	site = lcp_site(ip, flags);
+	if (site) {
+		site->nr_wait++;
+		site->wait_total += wait;
+		site->wait_max = max(site->wait_max, wait);
+		site->wait_hist[lcp_bucket(wait)]++;
+	}
+
+	if (hold_ip && (site = lcp_site(hold_ip, hold_flags))) {
+		site->nr_hold++;
+		site->hold_total += hold;
+		site->hold_max = max(site->hold_max, hold);
+		site->hold_hist[lcp_bucket(hold)]++;
+	}
+	local_irq_restore(irqflags);
+}
+
+static void lcp_contention_begin(void *data, void *lock, unsigned int flags)
+{
+	struct lock_contention_stack *st;
+	struct lock_contention_wait *w;
+
+	if (in_nmi())
+		return;
+
+	st = lcp_stack();
+
+	/* A mutex reports its spinning and its sleeping phase separately */
+	if (st->depth && st->depth <= LOCK_CONTENTION_DEPTH &&
+	    st->wait[st->depth - 1].lock == lock)
+		return;
+
+	if (st->depth < LOCK_CONTENTION_DEPTH) {
+		w = &st->wait[st->depth];
+		w->lock = lock;
+		w->flags = flags;
+		w->ip = lcp_callsite();
+		w->start = local_clock();
+	}
+	st->depth++;
+}
+
+static void lcp_contention_end(void *data, void *lock, int ret)
+{
+	struct lock_contention_stack *st;
+	struct lock_contention_wait *w;
+	unsigned long hold_ip = 0;
+	unsigned int hold_flags = 0;
+	struct lcp_owner *owner;
+	u64 now, hold = 0;
+
+	if (in_nmi())
+		return;
+
+	st = lcp_stack();
+	if (!st->depth)
+		return;		/* turned on while waiting */
+
+	if (--st->depth >= LOCK_CONTENTION_DEPTH)
+		return;
+
+	w = &st->wait[st->depth];
+	if (w->lock != lock) {
+		/* turned off and on again while waiting, start over */
+		st->depth = 0;
+		return;
+	}
+
+	now = local_clock();
+
+	if (!ret) {
+		owner = &lcp_owners[hash_ptr(lock, LCP_OWNERS_BITS)];
+		/*
+		 * If the previous contended owner got the lock after we started
+		 * waiting, we were queued for its whole hold time.
+		 */
+		if (READ_ONCE(owner->lock) == lock &&
+		    READ_ONCE(owner->acquired) >= w->start) {
+			hold_ip = READ_ONCE(owner->ip);
+			hold_flags = READ_ONCE(owner->flags);
+			hold = now - READ_ONCE(owner->acquired);
+		}
+		WRITE_ONCE(owner->lock, lock);
+		WRITE_ONCE(owner->ip, w->ip);
+		WRITE_ONCE(owner->flags, w->flags);
+		WRITE_ONCE(owner->acquired, now);
+	}
+
+	lcp_account(w->ip, w->flags, now - w->start, hold_ip, hold_flags, hold);
+}
+
+static int lcp_alloc_tables(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct lcp_table *table;
+
+		if (per_cpu(lcp_tables, cpu))
+			continue;
+
+		table = vzalloc_node(sizeof(*table), cpu_to_node(cpu));
+		if (!table)
+			return -ENOMEM;
+		per_cpu(lcp_tables, cpu) = table;
+	}
+
+	return 0;
+}
+
+static int lcp_enable(bool enable)
+{
+	int ret = 0;
+
+	mutex_lock(&lcp_mutex);
+	if (enable == lcp_enabled)
+		goto unlock;
+
+	if (enable) {
+		ret = lcp_alloc_tables();
+		if (ret)
+			goto unlock;
+
+		ret = register_trace_contention_begin(lcp_contention_begin, NULL);
+		if (ret)
+			goto unlock;
+
+		ret = register_trace_contention_end(lcp_contention_end, NULL);
+		if (ret) {
+			unregister_trace_contention_begin(lcp_contention_begin, NULL);
+			tracepoint_synchronize_unregister();
+			goto unlock;
+		}
+	} else {
+		unregister_trace_contention_end(lcp_contention_end, NULL);
+		unregister_trace_contention_begin(lcp_contention_begin, NULL);
+		tracepoint_synchronize_unregister();
+	}
+	lcp_enabled = enable;
+unlock:
+	mutex_unlock(&lcp_mutex);
+	return ret;
+}
+
+static int lcp_enable_get(void *data, u64 *val)
+{
+	*val = READ_ONCE(lcp_enabled);
+	return 0;
+}
+
+static int lcp_enable_set(void *data, u64 val)
+{
+	return lcp_enable(!!val);
+}
+DEFINE_DEBUGFS_ATTRIBUTE(lcp_enable_fops, lcp_enable_get, lcp_enable_set,
+			 "%llu\n");
+
+static int lcp_reset_set(void *data, u64 val)
+{
+	int cpu;
+
+	mutex_lock(&lcp_mutex);
+	for_each_possible_cpu(cpu) {
+		struct lcp_table *table = per_cpu(lcp_tables, cpu);
+
+		if (table)
+			memset(table, 0, sizeof(*table));
+	}
+	memset(lcp_owners, 0, sizeof(lcp_owners));
+	mutex_unlock(&lcp_mutex);
+
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(lcp_reset_fops, NULL, lcp_reset_set, "%llu\n");
+
+struct lcp_snapshot {
+	unsigned int		nr;
+	unsigned long		dropped;
+	struct lcp_site		sites[];
+};
+
+static void lcp_merge(struct lcp_snapshot *snap, unsigned int size,
+		      const struct lcp_site *src)
+{
+	struct lcp_site *dst = NULL;
+	unsigned int i;
+
+	for (i = 0; i < snap->nr; i++) {
+		if (snap->sites[i].ip == src->ip &&
+		    snap->sites[i].flags == src->flags) {
+			dst = &snap->sites[i];
+			break;
+		}
+	}
+
+	if (!dst) {
+		if (snap->nr == size) {
+			snap->dropped++;
+			return;
+		}
+		dst = &snap->sites[snap->nr++];
+		dst->ip = src->ip;
+		dst->flags = src->flags;
+	}
+
+	dst->nr_wait += READ_ONCE(src->nr_wait);
+	dst->wait_total += READ_ONCE(src->wait_total);
+	dst->wait_max = max(dst->wait_max, READ_ONCE(src->wait_max));
+	dst->nr_hold += READ_ONCE(src->nr_hold);
+	dst->hold_total += READ_ONCE(src->hold_total);
+	dst->hold_max = max(dst->hold_max, READ_ONCE(src->hold_max));
+	for (i = 0; i < LCP_HIST; i++) {
+		dst->wait_hist[i] += READ_ONCE(src->wait_hist[i]);
+		dst->hold_hist[i] += READ_ONCE(src->hold_hist[i]);
+	}
+}
+
+static int lcp_cmp(const void *a, const void *b)
+{
+	const struct lcp_site *sa = a, *sb = b;
+
+	if (sa->wait_total == sb->wait_total)
+		return 0;
+	return sa->wait_total < sb->wait_total ? 1 : -1;
+}
+
+static void lcp_show_hist(struct seq_file *m, const char *name, const u32 *hist)
+{
+	int i, last;
+
+	for (last = LCP_HIST - 1; last > 0 && !hist[last]; last--)
+		;
+
+	seq_printf(m, "  %s:", name);
+	for (i = 0; i <= last; i++)
+		seq_printf(m, " %u", hist[i]);
+	seq_putc(m, '\n');
+}
+
+static int lcp_stats_show(struct seq_file *m, void *v)
+{
+	unsigned int size = 2 * LCP_SITES;
+	struct lcp_snapshot *snap;
+	unsigned int i;
+	int cpu;
+
+	snap = vzalloc(struct_size(snap, sites, size));
+	if (!snap)
+		return -ENOMEM;
+
+	mutex_lock(&lcp_mutex);
+	for_each_possible_cpu(cpu) {
+		struct lcp_table *table = per_cpu(lcp_tables, cpu);
+
+		if (!table)
+			continue;
+
+		snap->dropped += READ_ONCE(table->dropped);
+		for (i = 0; i < LCP_SITES; i++) {
+			if (READ_ONCE(table->sites[i].ip))
+				lcp_merge(snap, size, &table->sites[i]);
+		}
+	}
+	mutex_unlock(&lcp_mutex);
+
+	sort(snap->sites, snap->nr, sizeof(snap->sites[0]), lcp_cmp, NULL);
+
+	seq_printf(m, "# histogram bucket n counts waits/holds of < %u << n ns\n",
+		   1U << LCP_HIST_SHIFT);
+	seq_printf(m, "# dropped: %lu\n", snap->dropped);
+
+	for (i = 0; i < snap->nr; i++) {
+		struct lcp_site *site = &snap->sites[i];
+
+		seq_printf(m, "%pS flags=%#x wait: nr=%llu total=%llu max=%llu hold: nr=%llu total=%llu max=%llu\n",
+			   (void *)site->ip, site->flags,
+			   site->nr_wait, site->wait_total, site->wait_max,
+			   site->nr_hold, site->hold_total, site->hold_max);
+		lcp_show_hist(m, "wait", site->wait_hist);
+		if (site->nr_hold)
+			lcp_show_hist(m, "hold", site->hold_hist);
+	}
+
+	vfree(snap);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(lcp_stats);
+
+static int __init lock_contention_init(void)
+{
+	struct dentry *d_dir = debugfs_create_dir("lock_contention", NULL);
+
+	debugfs_create_file_unsafe("enable", 0600, d_dir, NULL, &lcp_enable_fops);
+	debugfs_create_file_unsafe("reset", 0200, d_dir, NULL, &lcp_reset_fops);
+	debugfs_create_file("stats", 0400, d_dir, NULL, &lcp_stats_fops);
+
+	return 0;
+}
+fs_initcall(lock_contention_init);
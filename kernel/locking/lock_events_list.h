@@ -35,6 +35,17 @@ LOCK_EVENT(pv_wait_head)	/* # of vCPU wait's at the queue head	   */
 LOCK_EVENT(pv_wait_node)	/* # of vCPU wait's at non-head queue node */
 #endif /* CONFIG_PARAVIRT_SPINLOCKS */
 
+#ifdef CONFIG_NUMA_AWARE_SPINLOCKS
+/*
+ * Locking events for CNA qspinlock.
+ */
+LOCK_EVENT(cna_intra_node)	/* # of MCS hand-offs within a NUMA node   */
+LOCK_EVENT(cna_inter_node)	/* # of MCS hand-offs across NUMA nodes	   */
+LOCK_EVENT(cna_splice_new)	/* # of waiters moved to secondary queue   */
+LOCK_EVENT(cna_splice_old)	/* # of secondary queue splices at unlock  */
+LOCK_EVENT(cna_flush)		/* # of fairness flushes of secondary queue */
+#endif /* CONFIG_NUMA_AWARE_SPINLOCKS */
+
 /*
  * Locking events for qspinlock
  *
@@ -49,6 +60,13 @@ LOCK_EVENT(lock_use_node4)	/* # of locking ops that use 4th percpu node */
 LOCK_EVENT(lock_no_node)	/* # of locking ops w/o using percpu node    */
 #endif /* CONFIG_QUEUED_SPINLOCKS */
 
+/*
+ * Locking events for mutex
+ */
+LOCK_EVENT(mutex_spin_skip)	/* # of optspins skipped for long holds	*/
+LOCK_EVENT(mutex_spin_timeout)	/* # of optspins cut short by the budget */
+LOCK_EVENT(mutex_spin_lock)	/* # of owner releases seen by a spinner */
+
 /*
  * Locking events for rwsem
  */
@@ -58,6 +76,9 @@ LOCK_EVENT(rwsem_wake_reader)	/* # of reader wakeups			*/
 LOCK_EVENT(rwsem_wake_writer)	/* # of writer wakeups			*/
 LOCK_EVENT(rwsem_opt_lock)	/* # of opt-acquired write locks	*/
 LOCK_EVENT(rwsem_opt_fail)	/* # of failed optspins			*/
+LOCK_EVENT(rwsem_pcpu_enter)	/* # of switches to per-CPU readers	*/
+LOCK_EVENT(rwsem_pcpu_exit)	/* # of switches back to shared count	*/
+LOCK_EVENT(rwsem_pcpu_fail)	/* # of write trylock drain failures	*/
 LOCK_EVENT(rwsem_opt_nospin)	/* # of disabled optspins		*/
 LOCK_EVENT(rwsem_rlock)		/* # of read locks acquired		*/
 LOCK_EVENT(rwsem_rlock_steal)	/* # of read locks by lock stealing	*/
@@ -29,12 +29,16 @@
 #include <linux/interrupt.h>
 #include <linux/debug_locks.h>
 #include <linux/osq_lock.h>
+#include <linux/hash.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/clock.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/lock.h>
 
 #ifndef CONFIG_PREEMPT_RT
 #include "mutex.h"
+#include "lock_events.h"
 
 #ifdef CONFIG_DEBUG_MUTEXES
 # define MUTEX_WARN_ON(cond) DEBUG_LOCKS_WARN_ON(cond)
@@ -342,6 +346,63 @@ bool ww_mutex_spin_on_owner(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 	return true;
 }
 
+/*
+ * Spinning only pays off if the owner drops the lock before we could have
+ * gone to sleep and been woken up again. Oversubscribed systems are full of
+ * mutexes that are held across long operations by running owners, where
+ * the spinners just burn the CPU the owner or somebody else could use.
+ *
+ * Keep a decaying average of how long spinners had to wait for an owner to
+ * release the lock, i.e. of the remaining hold time, and don't spin when it
+ * is above mutex_spin_budget_ns. The averages live in a small hash table
+ * indexed by lock address rather than in struct mutex; a collision only
+ * blends two locks' estimates.
+ *
+ * Skipping a spin decays the estimate, so that a mutex that stopped being
+ * held for long gets sampled by the next spinner. A budget of 0 disables
+ * the policy.
+ */
+#define MUTEX_HOLD_BITS		8
+#define MUTEX_HOLD_SHIFT	3	/* weight of a new sample: 1/8 */
+
+static unsigned int mutex_spin_budget_ns = 20 * NSEC_PER_USEC;
+core_param(mutex_spin_budget_ns, mutex_spin_budget_ns, uint, 0644);
+
+static u32 mutex_hold_ns[1U << MUTEX_HOLD_BITS];
+
+static inline u32 *mutex_hold_slot(struct mutex *lock)
+{
+	return &mutex_hold_ns[hash_ptr(lock, MUTEX_HOLD_BITS)];
+}
+
+static inline void mutex_hold_sample(struct mutex *lock, u64 delta)
+{
+	u32 *slot = mutex_hold_slot(lock);
+	u32 avg = READ_ONCE(*slot);
+
+	delta = min_t(u64, delta, U32_MAX);
+	avg += ((s64)delta - avg) >> MUTEX_HOLD_SHIFT;
+	WRITE_ONCE(*slot, avg);
+}
+
+static inline bool mutex_spin_worthwhile(struct mutex *lock)
+{
+	unsigned int budget = READ_ONCE(mutex_spin_budget_ns);
+	u32 *slot = mutex_hold_slot(lock);
+	u32 avg;
+
+	if (!budget)
+		return true;
+
+	avg = READ_ONCE(*slot);
+	if (avg <= budget)
+		return true;
+
+	WRITE_ONCE(*slot, avg - (avg >> MUTEX_HOLD_SHIFT));
+	lockevent_inc(mutex_spin_skip);
+	return false;
+}
+
 /*
  * Look out! "owner" is an entirely speculative pointer access and not
  * reliable.
@@ -352,6 +413,9 @@ static noinline
 bool mutex_spin_on_owner(struct mutex *lock, struct task_struct *owner,
 			 struct ww_acquire_ctx *ww_ctx, struct mutex_waiter *waiter)
 {
+	unsigned int budget = READ_ONCE(mutex_spin_budget_ns);
+	u64 start = budget ? local_clock() : 0;
+	unsigned int loop = 0;
 	bool ret = true;
 
 	lockdep_assert_preemption_disabled();
@@ -380,9 +444,29 @@ bool mutex_spin_on_owner(struct mutex *lock, struct task_struct *owner,
 			break;
 		}
 
+		/*
+		 * Give up once spinning got more expensive than sleeping;
+		 * don't read the clock on every iteration though.
+		 */
+		if (budget && !(++loop & 0xf)) {
+			u64 delta = local_clock() - start;
+
+			if (delta > budget) {
+				mutex_hold_sample(lock, delta);
+				lockevent_inc(mutex_spin_timeout);
+				ret = false;
+				break;
+			}
+		}
+
 		cpu_relax();
 	}
 
+	if (ret && budget) {
+		mutex_hold_sample(lock, local_clock() - start);
+		lockevent_inc(mutex_spin_lock);
+	}
+
 	return ret;
 }
 
@@ -441,6 +525,9 @@ static __always_inline bool
 mutex_optimistic_spin(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 		      struct mutex_waiter *waiter)
 {
+	if (!mutex_spin_worthwhile(lock))
+		goto fail;
+
 	if (!waiter) {
 		/*
 		 * The purpose of the mutex_can_spin_on_owner() function is
@@ -27,6 +27,7 @@
 #include <linux/export.h>
 #include <linux/rwsem.h>
 #include <linux/atomic.h>
+#include <linux/percpu.h>
 #include <trace/events/lock.h>
 
 #ifndef CONFIG_PREEMPT_RT
@@ -1237,6 +1238,284 @@ static struct rw_semaphore *rwsem_downgrade_wake(struct rw_semaphore *sem)
 	return sem;
 }
 
+/*
+ * Drop the sem->count read lock of a reader.
+ */
+static inline long rwsem_read_unlock_count(struct rw_semaphore *sem)
+{
+	long tmp;
+
+	rwsem_clear_reader_owned(sem);
+	tmp = atomic_long_add_return_release(-RWSEM_READER_BIAS, &sem->count);
+	DEBUG_RWSEMS_WARN_ON(tmp < 0, sem);
+	if (unlikely((tmp & (RWSEM_LOCK_MASK|RWSEM_FLAG_WAITERS)) ==
+		      RWSEM_FLAG_WAITERS)) {
+		clear_nonspinnable(sem);
+		rwsem_wake(sem);
+	}
+	return tmp;
+}
+
+#ifdef CONFIG_RWSEM_ADAPTIVE
+/*
+ * Adaptive rwsems
+ *
+ * A read-mostly rwsem that opted in with rwsem_enable_adaptive() lets its
+ * readers bump a per-CPU count instead of sem->count once no writer has been
+ * seen for RWSEM_PCPU_DELAY. The first writer after that flips pcpu_state to
+ * DRAIN and waits for the per-CPU readers to go away, after which the rwsem
+ * works as usual until it has been read-mostly for a while again.
+ *
+ * pcpu_state only changes while sem->count is write locked. Readers that took
+ * the lock through sem->count while it is ON move over to the per-CPU count
+ * right away, so a reader can tell at unlock time where it was accounted: in
+ * the per-CPU count if pcpu_state != OFF, in sem->count otherwise.
+ */
+enum {
+	RWSEM_PCPU_OFF,
+	RWSEM_PCPU_ON,
+	RWSEM_PCPU_DRAIN,
+};
+
+#define RWSEM_PCPU_DELAY	HZ
+
+static unsigned int rwsem_pcpu_readers(struct rw_semaphore *sem)
+{
+	unsigned int sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += per_cpu(*sem->read_count, cpu);
+
+	return sum;
+}
+
+int rwsem_pcpu_is_locked(struct rw_semaphore *sem)
+{
+	return atomic_long_read(&sem->count) || rwsem_pcpu_readers(sem);
+}
+EXPORT_SYMBOL(rwsem_pcpu_is_locked);
+
+static void rwsem_pcpu_wake_writer(struct rw_semaphore *sem)
+{
+	struct task_struct *writer;
+
+	smp_mb(); /* B matches C in rwsem_pcpu_drain() */
+	if (READ_ONCE(sem->pcpu_state) != RWSEM_PCPU_DRAIN)
+		return;
+
+	rcu_read_lock();
+	writer = rcu_dereference(sem->pcpu_writer);
+	if (writer)
+		wake_up_process(writer);
+	rcu_read_unlock();
+}
+
+/*
+ * Called with preemption disabled.
+ */
+static inline bool rwsem_pcpu_read_trylock(struct rw_semaphore *sem)
+{
+	if (READ_ONCE(sem->pcpu_state) != RWSEM_PCPU_ON)
+		return false;
+
+	this_cpu_inc(*sem->read_count);
+	smp_mb(); /* A matches C in rwsem_pcpu_drain() */
+	if (likely(READ_ONCE(sem->pcpu_state) == RWSEM_PCPU_ON))
+		return true;
+
+	/* A writer is draining the per-CPU readers, take the slow way */
+	this_cpu_dec(*sem->read_count);
+	rwsem_pcpu_wake_writer(sem);
+	return false;
+}
+
+static inline bool rwsem_pcpu_read_unlock(struct rw_semaphore *sem)
+{
+	if (READ_ONCE(sem->pcpu_state) == RWSEM_PCPU_OFF)
+		return false;
+
+	smp_mb(); /* critical section before the decrement */
+	this_cpu_dec(*sem->read_count);
+	rwsem_pcpu_wake_writer(sem);
+	return true;
+}
+
+
+/*
+ * A reader got the lock through sem->count; if the per-CPU readers are
+ * enabled, switch over to them. pcpu_state can't change while we hold the
+ * read lock, and the release of sem->count orders the per-CPU increment
+ * before any writer that comes next.
+ *
+ * Called with preemption disabled.
+ */
+static inline void rwsem_pcpu_read_locked(struct rw_semaphore *sem)
+{
+	if (likely(READ_ONCE(sem->pcpu_state) != RWSEM_PCPU_ON))
+		return;
+
+	this_cpu_inc(*sem->read_count);
+	rwsem_read_unlock_count(sem);
+}
+
+/*
+ * The last reader of a rwsem that hasn't seen a writer for a while turns
+ * the per-CPU readers on. @count is sem->count after its unlock.
+ *
+ * Called with preemption disabled.
+ */
+static inline void rwsem_pcpu_read_unlocked(struct rw_semaphore *sem, long count)
+{
+	if (likely(!sem->read_count) || count)
+		return;
+
+	if (time_before(jiffies, READ_ONCE(sem->pcpu_stamp) + RWSEM_PCPU_DELAY))
+		return;
+
+	if (!rwsem_write_trylock(sem))
+		return;
+
+	/* Recheck, rwsem_disable_adaptive() may have run in the meantime */
+	if (sem->read_count) {
+		WRITE_ONCE(sem->pcpu_state, RWSEM_PCPU_ON);
+		lockevent_inc(rwsem_pcpu_enter);
+	}
+
+	rwsem_clear_owner(sem);
+	count = atomic_long_fetch_add_release(-RWSEM_WRITER_LOCKED, &sem->count);
+	if (unlikely(count & RWSEM_FLAG_WAITERS))
+		rwsem_wake(sem);
+}
+
+/*
+ * Called by a writer that just took sem->count; wait for the per-CPU readers
+ * to go away. May sleep.
+ */
+static void rwsem_pcpu_drain(struct rw_semaphore *sem)
+{
+	if (!sem->read_count)
+		return;
+
+	WRITE_ONCE(sem->pcpu_stamp, jiffies);
+	if (likely(READ_ONCE(sem->pcpu_state) != RWSEM_PCPU_ON))
+		return;
+
+	rcu_assign_pointer(sem->pcpu_writer, current);
+	WRITE_ONCE(sem->pcpu_state, RWSEM_PCPU_DRAIN);
+	smp_mb(); /* C matches A and B */
+
+	for (;;) {
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		if (!rwsem_pcpu_readers(sem))
+			break;
+		schedule();
+	}
+	__set_current_state(TASK_RUNNING);
+	RCU_INIT_POINTER(sem->pcpu_writer, NULL);
+
+	/* If we observed the decrements, make sure we see the read sections */
+	smp_mb();
+	WRITE_ONCE(sem->pcpu_state, RWSEM_PCPU_OFF);
+	lockevent_inc(rwsem_pcpu_exit);
+}
+
+/*
+ * Non-blocking variant of rwsem_pcpu_drain() for write trylocks.
+ */
+static bool rwsem_pcpu_try_drain(struct rw_semaphore *sem)
+{
+	if (!sem->read_count)
+		return true;
+
+	WRITE_ONCE(sem->pcpu_stamp, jiffies);
+	if (likely(READ_ONCE(sem->pcpu_state) != RWSEM_PCPU_ON))
+		return true;
+
+	WRITE_ONCE(sem->pcpu_state, RWSEM_PCPU_DRAIN);
+	smp_mb(); /* C matches A and B */
+	if (rwsem_pcpu_readers(sem)) {
+		WRITE_ONCE(sem->pcpu_state, RWSEM_PCPU_ON);
+		lockevent_inc(rwsem_pcpu_fail);
+		return false;
+	}
+
+	smp_mb();
+	WRITE_ONCE(sem->pcpu_state, RWSEM_PCPU_OFF);
+	lockevent_inc(rwsem_pcpu_exit);
+	return true;
+}
+
+/**
+ * rwsem_enable_adaptive - let a read-mostly rwsem use per-CPU reader counts
+ * @sem: the rwsem
+ *
+ * Must be called before @sem is used, or with @sem held for writing.
+ *
+ * Return: 0 on success, -ENOMEM if the per-CPU counts can't be allocated.
+ */
+int rwsem_enable_adaptive(struct rw_semaphore *sem)
+{
+	unsigned int __percpu *read_count;
+
+	if (sem->read_count)
+		return 0;
+
+	read_count = alloc_percpu(unsigned int);
+	if (!read_count)
+		return -ENOMEM;
+
+	WRITE_ONCE(sem->pcpu_stamp, jiffies);
+	WRITE_ONCE(sem->read_count, read_count);
+	return 0;
+}
+EXPORT_SYMBOL(rwsem_enable_adaptive);
+
+/**
+ * rwsem_disable_adaptive - undo rwsem_enable_adaptive()
+ * @sem: the rwsem
+ *
+ * Must be called when @sem is no longer used, or with @sem held for writing.
+ * May sleep.
+ */
+void rwsem_disable_adaptive(struct rw_semaphore *sem)
+{
+	unsigned int __percpu *read_count = sem->read_count;
+
+	DEBUG_RWSEMS_WARN_ON(READ_ONCE(sem->pcpu_state) != RWSEM_PCPU_OFF, sem);
+	if (!read_count)
+		return;
+
+	/*
+	 * A reader that saw RWSEM_PCPU_ON before the last drain may still be
+	 * about to undo its per-CPU increment. Readers touch the counts with
+	 * preemption disabled, so wait for them before freeing.
+	 */
+	synchronize_rcu();
+	WRITE_ONCE(sem->read_count, NULL);
+	free_percpu(read_count);
+}
+EXPORT_SYMBOL(rwsem_disable_adaptive);
+#else
+static inline bool rwsem_pcpu_read_trylock(struct rw_semaphore *sem)
+{
+	return false;
+}
+
+static inline bool rwsem_pcpu_read_unlock(struct rw_semaphore *sem)
+{
+	return false;
+}
+
+static inline void rwsem_pcpu_read_locked(struct rw_semaphore *sem) { }
+static inline void rwsem_pcpu_read_unlocked(struct rw_semaphore *sem, long count) { }
+static inline void rwsem_pcpu_drain(struct rw_semaphore *sem) { }
+static inline bool rwsem_pcpu_try_drain(struct rw_semaphore *sem)
+{
+	return true;
+}
+#endif /* CONFIG_RWSEM_ADAPTIVE */
+
 /*
  * lock for reading
  */
@@ -1246,6 +1525,8 @@ static __always_inline int __down_read_common(struct rw_semaphore *sem, int stat
 	long count;
 
 	preempt_disable();
+	if (rwsem_pcpu_read_trylock(sem))
+		goto out;
 	if (!rwsem_read_trylock(sem, &count)) {
 		if (IS_ERR(rwsem_down_read_slowpath(sem, count, state))) {
 			ret = -EINTR;
@@ -1253,6 +1534,7 @@ static __always_inline int __down_read_common(struct rw_semaphore *sem, int stat
 		}
 		DEBUG_RWSEMS_WARN_ON(!is_rwsem_reader_owned(sem), sem);
 	}
+	rwsem_pcpu_read_locked(sem);
 out:
 	preempt_enable();
 	return ret;
@@ -1281,11 +1563,16 @@ static inline int __down_read_trylock(struct rw_semaphore *sem)
 	DEBUG_RWSEMS_WARN_ON(sem->magic != sem, sem);
 
 	preempt_disable();
+	if (rwsem_pcpu_read_trylock(sem)) {
+		preempt_enable();
+		return 1;
+	}
 	tmp = atomic_long_read(&sem->count);
 	while (!(tmp & RWSEM_READ_FAILED_MASK)) {
 		if (atomic_long_try_cmpxchg_acquire(&sem->count, &tmp,
 						    tmp + RWSEM_READER_BIAS)) {
 			rwsem_set_reader_owned(sem);
+			rwsem_pcpu_read_locked(sem);
 			ret = 1;
 			break;
 		}
@@ -1307,6 +1594,9 @@ static inline int __down_write_common(struct rw_semaphore *sem, int state)
 			ret = -EINTR;
 	}
 	preempt_enable();
+
+	if (!ret)
+		rwsem_pcpu_drain(sem);
 	return ret;
 }
 
@@ -1320,6 +1610,8 @@ static inline int __down_write_killable(struct rw_semaphore *sem)
 	return __down_write_common(sem, TASK_KILLABLE);
 }
 
+static inline void __up_write(struct rw_semaphore *sem);
+
 static inline int __down_write_trylock(struct rw_semaphore *sem)
 {
 	int ret;
@@ -1329,6 +1621,10 @@ static inline int __down_write_trylock(struct rw_semaphore *sem)
 	ret = rwsem_write_trylock(sem);
 	preempt_enable();
 
+	if (ret && unlikely(!rwsem_pcpu_try_drain(sem))) {
+		__up_write(sem);
+		ret = 0;
+	}
 	return ret;
 }
 
@@ -1340,17 +1636,16 @@ static inline void __up_read(struct rw_semaphore *sem)
 	long tmp;
 
 	DEBUG_RWSEMS_WARN_ON(sem->magic != sem, sem);
-	DEBUG_RWSEMS_WARN_ON(!is_rwsem_reader_owned(sem), sem);
 
 	preempt_disable();
-	rwsem_clear_reader_owned(sem);
-	tmp = atomic_long_add_return_release(-RWSEM_READER_BIAS, &sem->count);
-	DEBUG_RWSEMS_WARN_ON(tmp < 0, sem);
-	if (unlikely((tmp & (RWSEM_LOCK_MASK|RWSEM_FLAG_WAITERS)) ==
-		      RWSEM_FLAG_WAITERS)) {
-		clear_nonspinnable(sem);
-		rwsem_wake(sem);
+	if (rwsem_pcpu_read_unlock(sem)) {
+		preempt_enable();
+		return;
 	}
+
+	DEBUG_RWSEMS_WARN_ON(!is_rwsem_reader_owned(sem), sem);
+	tmp = rwsem_read_unlock_count(sem);
+	rwsem_pcpu_read_unlocked(sem, tmp);
 	preempt_enable();
 }
 
@@ -82,6 +82,8 @@ struct load_info {
 	struct {
 		unsigned int sym, str, mod, vers, info, pcpu;
 	} index;
+	/* copy of @name for finit_module(), still valid after load_module() */
+	char loaded_name[MODULE_NAME_LEN];
 };
 
 enum mod_license {
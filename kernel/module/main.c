@@ -2849,6 +2849,7 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	err = elf_validity_cache_copy(info, flags);
 	if (err)
 		goto free_copy;
+	strscpy(info->loaded_name, info->name, sizeof(info->loaded_name));
 
 	err = early_mod_check(info, flags);
 	if (err)
@@ -3112,11 +3113,89 @@ static int idempotent_complete(struct idempotent *u, int ret)
 	return ret;
 }
 
+/*
+ * Files modules were recently loaded from. udev asks for the same module
+ * over and over while devices show up, usually from the same file. As long
+ * as that file didn't change and the module is still there, fail right away
+ * instead of reading, decompressing and verifying the whole file again just
+ * to find out it's a duplicate.
+ */
+struct loaded_file {
+	dev_t dev;
+	unsigned long ino;
+	struct timespec64 ctime;
+	char name[MODULE_NAME_LEN];
+};
+
+#define LOADED_FILES 16
+static struct loaded_file loaded_files[LOADED_FILES];
+static unsigned int loaded_files_next;
+
+static bool loaded_file_match(const struct loaded_file *lf,
+			      const struct inode *inode)
+{
+	return lf->name[0] && lf->dev == inode->i_sb->s_dev &&
+	       lf->ino == inode->i_ino &&
+	       timespec64_equal(&lf->ctime, &inode->i_ctime);
+}
+
+static bool module_file_loaded(struct file *f)
+{
+	struct inode *inode = file_inode(f);
+	char name[MODULE_NAME_LEN] = "";
+	struct module *mod;
+	bool ret;
+	int i;
+
+	spin_lock(&idem_lock);
+	for (i = 0; i < LOADED_FILES; i++) {
+		if (loaded_file_match(&loaded_files[i], inode)) {
+			strscpy(name, loaded_files[i].name, sizeof(name));
+			break;
+		}
+	}
+	spin_unlock(&idem_lock);
+
+	if (!name[0])
+		return false;
+
+	mutex_lock(&module_mutex);
+	mod = find_module_all(name, strlen(name), true);
+	ret = mod && mod->state != MODULE_STATE_GOING;
+	mutex_unlock(&module_mutex);
+
+	return ret;
+}
+
+static void remember_module_file(struct file *f, const char *name)
+{
+	struct inode *inode = file_inode(f);
+	struct loaded_file *lf = NULL;
+	int i;
+
+	spin_lock(&idem_lock);
+	for (i = 0; i < LOADED_FILES; i++) {
+		if (loaded_file_match(&loaded_files[i], inode)) {
+			lf = &loaded_files[i];
+			break;
+		}
+	}
+	if (!lf) {
+		lf = &loaded_files[loaded_files_next];
+		loaded_files_next = (loaded_files_next + 1) % LOADED_FILES;
+	}
+	lf->dev = inode->i_sb->s_dev;
+	lf->ino = inode->i_ino;
+	lf->ctime = inode->i_ctime;
+	strscpy(lf->name, name, sizeof(lf->name));
+	spin_unlock(&idem_lock);
+}
+
 static int init_module_from_file(struct file *f, const char __user * uargs, int flags)
 {
 	struct load_info info = { };
 	void *buf = NULL;
-	int len;
+	int len, ret;
 
 	len = kernel_read_file(f, 0, &buf, INT_MAX, NULL, READING_MODULE);
 	if (len < 0) {
@@ -3137,7 +3216,10 @@ static int init_module_from_file(struct file *f, const char __user * uargs, int
 		info.len = len;
 	}
 
-	return load_module(&info, uargs, flags);
+	ret = load_module(&info, uargs, flags);
+	if ((!ret || ret == -EEXIST) && info.loaded_name[0])
+		remember_module_file(f, info.loaded_name);
+	return ret;
 }
 
 static int idempotent_init_module(struct file *f, const char __user * uargs, int flags)
@@ -3147,6 +3229,9 @@ static int idempotent_init_module(struct file *f, const char __user * uargs, int
 	if (!f || !(f->f_mode & FMODE_READ))
 		return -EBADF;
 
+	if (module_file_loaded(f))
+		return -EEXIST;
+
 	/* See if somebody else is doing the operation? */
 	if (idempotent(&idem, file_inode(f))) {
 		wait_for_completion(&idem.complete);
@@ -11,14 +11,18 @@
  * Author: Daniel Jordan <daniel.m.jordan@oracle.com>
  */
 
+#include <linux/cgroup.h>
 #include <linux/completion.h>
 #include <linux/export.h>
 #include <linux/cpumask.h>
 #include <linux/err.h>
 #include <linux/cpu.h>
+#include <linux/nodemask.h>
 #include <linux/padata.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
+#include <linux/sched/cputime.h>
+#include <linux/sched/signal.h>
 #include <linux/slab.h>
 #include <linux/sysfs.h>
 #include <linux/rcupdate.h>
@@ -29,23 +33,35 @@ struct padata_work {
 	struct work_struct	pw_work;
 	struct list_head	pw_list;  /* padata_free_works linkage */
 	void			*pw_data;
+	int			pw_part;  /* preferred part of a mt job */
 };
 
 static DEFINE_SPINLOCK(padata_works_lock);
 static struct padata_work *padata_works;
 static LIST_HEAD(padata_free_works);
 
+/* a contiguous part of a mt job, one per node for numa_aware jobs */
+struct padata_mt_part {
+	unsigned long		start;
+	unsigned long		size;
+	int			nid;
+};
+
 struct padata_mt_job_state {
 	spinlock_t		lock;
 	struct completion	completion;
 	struct padata_mt_job	*job;
+	struct task_struct	*caller;
 	int			nworks;
 	int			nworks_fini;
 	unsigned long		chunk_size;
+	int			nparts;
+	struct padata_mt_part	*parts;
+	int			error;
 };
 
 static void padata_free_pd(struct parallel_data *pd);
-static void __init padata_mt_helper(struct work_struct *work);
+static void padata_mt_helper(struct work_struct *work);
 
 static int padata_index_to_cpu(struct parallel_data *pd, int cpu_index)
 {
@@ -83,26 +99,19 @@ static struct padata_work *padata_work_alloc(void)
 	return pw;
 }
 
-/*
- * This function is marked __ref because this function may be optimized in such
- * a way that it directly refers to work_fn's address, which causes modpost to
- * complain when work_fn is marked __init. This scenario was observed with clang
- * LTO, where padata_work_init() was optimized to refer directly to
- * padata_mt_helper() because the calls to padata_work_init() with other work_fn
- * values were eliminated or inlined.
- */
-static void __ref padata_work_init(struct padata_work *pw, work_func_t work_fn,
-				   void *data, int flags)
+static void padata_work_init(struct padata_work *pw, work_func_t work_fn,
+			     void *data, int flags)
 {
 	if (flags & PADATA_WORK_ONSTACK)
 		INIT_WORK_ONSTACK(&pw->pw_work, work_fn);
 	else
 		INIT_WORK(&pw->pw_work, work_fn);
 	pw->pw_data = data;
+	pw->pw_part = 0;
 }
 
-static int __init padata_work_alloc_mt(int nworks, void *data,
-				       struct list_head *head)
+static int padata_work_alloc_mt(int nworks, void *data,
+				struct list_head *head)
 {
 	int i;
 
@@ -127,7 +136,7 @@ static void padata_work_free(struct padata_work *pw)
 	list_add(&pw->pw_list, &padata_free_works);
 }
 
-static void __init padata_works_free(struct list_head *works)
+static void padata_works_free(struct list_head *works)
 {
 	struct padata_work *cur, *next;
 
@@ -438,32 +447,90 @@ static int padata_setup_cpumasks(struct padata_instance *pinst)
 	return err;
 }
 
-static void __init padata_mt_helper(struct work_struct *w)
+/*
+ * Pick the part to take the next chunk from, the preferred one unless it's
+ * done.  Called with @ps->lock held.
+ */
+static struct padata_mt_part *padata_mt_next_part(struct padata_mt_job_state *ps,
+						  int part)
+{
+	int i;
+
+	if (ps->parts[part].size)
+		return &ps->parts[part];
+
+	for (i = 0; i < ps->nparts; i++) {
+		if (ps->parts[i].size)
+			return &ps->parts[i];
+	}
+	return NULL;
+}
+
+static void padata_mt_helper(struct work_struct *w)
 {
 	struct padata_work *pw = container_of(w, struct padata_work, pw_work);
 	struct padata_mt_job_state *ps = pw->pw_data;
 	struct padata_mt_job *job = ps->job;
+	bool helper = current != ps->caller;
+	u64 runtime = 0;
 	bool done;
 
+	if (helper)
+		runtime = task_sched_runtime(current);
+
 	spin_lock(&ps->lock);
 
-	while (job->size > 0) {
+	while (!ps->error) {
+		struct padata_mt_part *part;
 		unsigned long start, size, end;
 
-		start = job->start;
+		if (READ_ONCE(job->cancelled)) {
+			ps->error = -ECANCELED;
+			break;
+		}
+		if (!helper && fatal_signal_pending(current)) {
+			ps->error = -EINTR;
+			break;
+		}
+
+		part = padata_mt_next_part(ps, pw->pw_part);
+		if (!part)
+			break;
+
+		start = part->start;
 		/* So end is chunk size aligned if enough work remains. */
 		size = roundup(start + 1, ps->chunk_size) - start;
-		size = min(size, job->size);
+		size = min(size, part->size);
 		end = start + size;
 
-		job->start = end;
-		job->size -= size;
+		part->start = end;
+		part->size -= size;
 
 		spin_unlock(&ps->lock);
 		job->thread_fn(start, end, job->fn_arg);
 		spin_lock(&ps->lock);
 	}
+	spin_unlock(&ps->lock);
+
+	/*
+	 * Charge the helper's time to the caller's cgroup.  The stats are
+	 * also updated from the tick, hence the disabled interrupts.  This
+	 * has to be done before the helper is accounted as finished, as
+	 * @ps lives on the stack of the caller, which may return as soon as
+	 * the last helper is.
+	 */
+	if (helper) {
+		unsigned long flags;
+
+		runtime = task_sched_runtime(current) - runtime;
+		local_irq_save(flags);
+		rcu_read_lock();
+		cgroup_account_cputime(ps->caller, runtime);
+		rcu_read_unlock();
+		local_irq_restore(flags);
+	}
 
+	spin_lock(&ps->lock);
 	++ps->nworks_fini;
 	done = (ps->nworks_fini == ps->nworks);
 	spin_unlock(&ps->lock);
@@ -472,39 +539,115 @@ static void __init padata_mt_helper(struct work_struct *w)
 		complete(&ps->completion);
 }
 
+/*
+ * Split a numa_aware job into one part per node with CPUs, each sized by the
+ * node's share of CPUs and rounded to the chunk size.  Falls back to a single
+ * part on failure.
+ */
+static void padata_mt_split(struct padata_mt_job_state *ps,
+			    struct padata_mt_part *single)
+{
+	struct padata_mt_job *job = ps->job;
+	unsigned long start = job->start, end = job->start + job->size;
+	unsigned int cpus_left = num_online_cpus();
+	int nid, i = 0;
+
+	single->start = job->start;
+	single->size = job->size;
+	single->nid = NUMA_NO_NODE;
+	ps->parts = single;
+	ps->nparts = 1;
+
+	if (!job->numa_aware || num_node_state(N_CPU) <= 1)
+		return;
+
+	ps->parts = kcalloc(num_node_state(N_CPU), sizeof(*ps->parts),
+			    GFP_KERNEL);
+	if (!ps->parts) {
+		ps->parts = single;
+		return;
+	}
+
+	for_each_node_state(nid, N_CPU) {
+		unsigned int cpus = cpumask_weight_and(cpumask_of_node(nid),
+						       cpu_online_mask);
+		unsigned long size, pend;
+
+		if (!cpus || start >= end)
+			continue;
+
+		size = cpus >= cpus_left ? end - start :
+		       mult_frac(end - start, cpus, cpus_left);
+		pend = min(roundup(start + size, ps->chunk_size), end);
+		cpus_left -= min(cpus, cpus_left);
+
+		ps->parts[i].start = start;
+		ps->parts[i].size = pend - start;
+		ps->parts[i].nid = nid;
+		start = pend;
+		i++;
+	}
+
+	/* CPUs went offline meanwhile, give the rest to the last part. */
+	if (i && start < end)
+		ps->parts[i - 1].size += end - start;
+
+	if (!i) {
+		kfree(ps->parts);
+		ps->parts = single;
+		return;
+	}
+	ps->nparts = i;
+}
+
 /**
  * padata_do_multithreaded - run a multithreaded job
  * @job: Description of the job.
  *
- * See the definition of struct padata_mt_job for more details.
+ * See the definition of struct padata_mt_job for more details.  The time the
+ * helper threads spend on the job is charged to the caller's cgroup.
+ *
+ * Context: Process context, may sleep.
+ * Return: 0 on success, -ECANCELED if the job was cancelled, -EINTR if the
+ * caller got a fatal signal.  Part of the job may have been done in either
+ * error case.
  */
-void __init padata_do_multithreaded(struct padata_mt_job *job)
+int padata_do_multithreaded(struct padata_mt_job *job)
 {
 	/* In case threads finish at different times. */
 	static const unsigned long load_balance_factor = 4;
 	struct padata_work my_work, *pw;
 	struct padata_mt_job_state ps;
+	struct padata_mt_part single;
 	LIST_HEAD(works);
-	int nworks;
+	int nworks, i;
+
+	might_sleep();
 
 	if (job->size == 0)
-		return;
+		return 0;
 
 	/* Ensure at least one thread when size < min_chunk. */
 	nworks = max(job->size / max(job->min_chunk, job->align), 1ul);
 	nworks = min(nworks, job->max_threads);
 
+	/* Don't let a runtime caller escape its cpuset through the helpers. */
+	if (system_state == SYSTEM_RUNNING)
+		nworks = min(nworks, current->nr_cpus_allowed);
+
 	if (nworks == 1) {
 		/* Single thread, no coordination needed, cut to the chase. */
 		job->thread_fn(job->start, job->start + job->size, job->fn_arg);
-		return;
+		return READ_ONCE(job->cancelled) ? -ECANCELED : 0;
 	}
 
 	spin_lock_init(&ps.lock);
 	init_completion(&ps.completion);
 	ps.job	       = job;
+	ps.caller      = current;
 	ps.nworks      = padata_work_alloc_mt(nworks, &ps, &works);
 	ps.nworks_fini = 0;
+	ps.error       = 0;
 
 	/*
 	 * Chunk size is the amount of work a helper does per call to the
@@ -516,11 +659,25 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 	ps.chunk_size = max(ps.chunk_size, job->min_chunk);
 	ps.chunk_size = roundup(ps.chunk_size, job->align);
 
-	list_for_each_entry(pw, &works, pw_list)
-		queue_work(system_unbound_wq, &pw->pw_work);
+	padata_mt_split(&ps, &single);
+
+	/* Spread the helpers over the parts, queued on their nodes. */
+	i = 0;
+	list_for_each_entry(pw, &works, pw_list) {
+		pw->pw_part = ++i % ps.nparts;
+		if (ps.parts[pw->pw_part].nid != NUMA_NO_NODE)
+			queue_work_node(ps.parts[pw->pw_part].nid,
+					system_unbound_wq, &pw->pw_work);
+		else
+			queue_work(system_unbound_wq, &pw->pw_work);
+	}
 
 	/* Use the current thread, which saves starting a workqueue worker. */
 	padata_work_init(&my_work, padata_mt_helper, &ps, PADATA_WORK_ONSTACK);
+	for (i = 0; i < ps.nparts; i++) {
+		if (ps.parts[i].nid == numa_node_id())
+			my_work.pw_part = i;
+	}
 	padata_mt_helper(&my_work.pw_work);
 
 	/* Wait for all the helpers to finish. */
@@ -528,7 +685,12 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 
 	destroy_work_on_stack(&my_work.pw_work);
 	padata_works_free(&works);
+	if (ps.parts != &single)
+		kfree(ps.parts);
+
+	return ps.error;
 }
+EXPORT_SYMBOL_GPL(padata_do_multithreaded);
 
 static void __padata_list_init(struct padata_list *pd_list)
 {
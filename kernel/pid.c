@@ -42,6 +42,8 @@
 #include <linux/sched/signal.h>
 #include <linux/sched/task.h>
 #include <linux/idr.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <net/sock.h>
 #include <uapi/linux/pidfd.h>
 
@@ -156,6 +158,178 @@ void free_pid(struct pid *pid)
 	call_rcu(&pid->rcu, delayed_put_pid);
 }
 
+/*
+ * PIDs are handed out from small per-CPU batches that are reserved in the
+ * idr, as NULL entries, with one acquisition of pidmap_lock. That way a
+ * fork doesn't take pidmap_lock for every level of nested namespaces, just
+ * once to make the PIDs visible. The batches are taken in cursor order, so
+ * allocation stays cyclic, only interleaved between CPUs.
+ *
+ * The lock of a batch is only contended by a task that migrated meanwhile
+ * and by pid_cache_disable(), which empties the batches of all CPUs.
+ */
+#define PID_CACHE_BATCH		16
+
+struct pid_cache {
+	spinlock_t	lock;
+	unsigned int	next;
+	unsigned int	nr;
+	int		pids[PID_CACHE_BATCH];
+};
+
+struct pid_alloc_stats {
+	unsigned long	cached;		/* PIDs taken from a batch */
+	unsigned long	refills;
+	unsigned long	contended;	/* refills that had to wait for the lock */
+};
+
+static DEFINE_PER_CPU(struct pid_alloc_stats, pid_alloc_stats);
+
+struct pid_cache __percpu *alloc_pid_cache(void)
+{
+	struct pid_cache __percpu *cache;
+	int cpu;
+
+	cache = alloc_percpu(struct pid_cache);
+	if (!cache)
+		return NULL;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(cache, cpu)->lock);
+
+	return cache;
+}
+
+static void pid_cache_release(struct pid_namespace *ns, int *pids, int n)
+{
+	int i;
+
+	spin_lock_irq(&pidmap_lock);
+	for (i = 0; i < n; i++)
+		idr_remove(&ns->idr, pids[i]);
+	spin_unlock_irq(&pidmap_lock);
+}
+
+static int pid_cache_refill(struct pid_namespace *ns)
+{
+	int pids[PID_CACHE_BATCH];
+	struct pid_cache *pc;
+	int n, batch, pid_min = 1;
+
+	idr_preload(GFP_KERNEL);
+	if (!spin_trylock_irq(&pidmap_lock)) {
+		this_cpu_inc(pid_alloc_stats.contended);
+		spin_lock_irq(&pidmap_lock);
+	}
+	this_cpu_inc(pid_alloc_stats.refills);
+
+	/* Don't hoard what's left of the PID space in per-CPU batches */
+	batch = PID_CACHE_BATCH;
+	if ((ns->pid_allocated & ~PIDNS_ADDING) +
+	    PID_CACHE_BATCH * num_online_cpus() > pid_max / 2 ||
+	    ns->pid_cache_off)
+		batch = 1;
+
+	/* See alloc_pid() */
+	if (idr_get_cursor(&ns->idr) > RESERVED_PIDS)
+		pid_min = RESERVED_PIDS;
+
+	for (n = 0; n < batch; n++) {
+		int nr = idr_alloc_cyclic(&ns->idr, NULL, pid_min, pid_max,
+					  GFP_ATOMIC);
+		if (nr < 0)
+			break;
+		pids[n] = nr;
+	}
+	spin_unlock_irq(&pidmap_lock);
+	idr_preload_end();
+
+	/* Let the slow path come up with the error */
+	if (!n)
+		return 0;
+
+	/* Any CPU's batch will do if we moved meanwhile */
+	pc = raw_cpu_ptr(ns->pid_cache);
+	spin_lock(&pc->lock);
+	if (pc->next == pc->nr && !READ_ONCE(ns->pid_cache_off)) {
+		memcpy(pc->pids, pids + 1, (n - 1) * sizeof(int));
+		pc->next = 0;
+		pc->nr = n - 1;
+		n = 1;
+	}
+	spin_unlock(&pc->lock);
+
+	/* Refilled by someone else, or disabled, meanwhile */
+	if (n > 1)
+		pid_cache_release(ns, pids + 1, n - 1);
+
+	return pids[0];
+}
+
+static int pid_cache_alloc(struct pid_namespace *ns)
+{
+	struct pid_cache *pc;
+	int nr = 0;
+
+	/* PID 1 of a new namespace is left to the slow path */
+	if (!ns->pid_cache || !ns->child_reaper ||
+	    READ_ONCE(ns->pid_cache_off))
+		return 0;
+
+	pc = raw_cpu_ptr(ns->pid_cache);
+	spin_lock(&pc->lock);
+	if (pc->next < pc->nr) {
+		nr = pc->pids[pc->next++];
+		this_cpu_inc(pid_alloc_stats.cached);
+	}
+	spin_unlock(&pc->lock);
+
+	/* pid_max was lowered since the batch was reserved */
+	if (nr >= pid_max) {
+		pid_cache_release(ns, &nr, 1);
+		nr = 0;
+	}
+
+	if (!nr)
+		nr = pid_cache_refill(ns);
+
+	return nr;
+}
+
+/*
+ * Stop handing out PIDs of @ns from per-CPU batches and give back the ones
+ * reserved, so that the next fork gets the PID after the idr cursor again.
+ * Done on a write of ns_last_pid, on which checkpoint/restore relies.
+ */
+void pid_cache_disable(struct pid_namespace *ns)
+{
+	int cpu;
+
+	if (!ns->pid_cache)
+		return;
+
+	/* Refills re-check it under the batch lock before installing */
+	spin_lock_irq(&pidmap_lock);
+	WRITE_ONCE(ns->pid_cache_off, true);
+	spin_unlock_irq(&pidmap_lock);
+
+	for_each_possible_cpu(cpu) {
+		struct pid_cache *pc = per_cpu_ptr(ns->pid_cache, cpu);
+		int pids[PID_CACHE_BATCH];
+		int n;
+
+		spin_lock(&pc->lock);
+		n = pc->nr - pc->next;
+		memcpy(pids, pc->pids + pc->next, n * sizeof(int));
+		pc->next = 0;
+		pc->nr = 0;
+		spin_unlock(&pc->lock);
+
+		if (n)
+			pid_cache_release(ns, pids, n);
+	}
+}
+
 struct pid *alloc_pid(struct pid_namespace *ns, pid_t *set_tid,
 		      size_t set_tid_size)
 {
@@ -205,6 +379,10 @@ struct pid *alloc_pid(struct pid_namespace *ns, pid_t *set_tid,
 			set_tid_size--;
 		}
 
+		nr = tid ? 0 : pid_cache_alloc(tmp);
+		if (nr)
+			goto allocated;
+
 		idr_preload(GFP_KERNEL);
 		spin_lock_irq(&pidmap_lock);
 
@@ -240,6 +418,7 @@ struct pid *alloc_pid(struct pid_namespace *ns, pid_t *set_tid,
 			retval = (nr == -ENOSPC) ? -EAGAIN : nr;
 			goto out_free;
 		}
+allocated:
 
 		pid->numbers[i].nr = nr;
 		pid->numbers[i].ns = tmp;
@@ -655,6 +834,7 @@ void __init pid_idr_init(void)
 	pr_info("pid_max: default: %u minimum: %u\n", pid_max, pid_max_min);
 
 	idr_init(&init_pid_ns.idr);
+	init_pid_ns.pid_cache = alloc_pid_cache();
 
 	init_pid_ns.pid_cachep = kmem_cache_create("pid",
 			struct_size_t(struct pid, numbers, 1),
@@ -663,6 +843,35 @@ void __init pid_idr_init(void)
 			NULL);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int pid_alloc_show(struct seq_file *m, void *v)
+{
+	struct pid_alloc_stats sum = { };
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct pid_alloc_stats *st = per_cpu_ptr(&pid_alloc_stats, cpu);
+
+		sum.cached += READ_ONCE(st->cached);
+		sum.refills += READ_ONCE(st->refills);
+		sum.contended += READ_ONCE(st->contended);
+	}
+
+	seq_printf(m, "cached %lu\n", sum.cached);
+	seq_printf(m, "refills %lu\n", sum.refills);
+	seq_printf(m, "contended %lu\n", sum.contended);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pid_alloc);
+
+static int __init pid_alloc_debugfs_init(void)
+{
+	debugfs_create_file("pid_alloc", 0444, NULL, NULL, &pid_alloc_fops);
+	return 0;
+}
+late_initcall(pid_alloc_debugfs_init);
+#endif
+
 static struct file *__pidfd_fget(struct task_struct *task, int fd)
 {
 	struct file *file;
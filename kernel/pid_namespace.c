@@ -99,6 +99,9 @@ static struct pid_namespace *create_pid_namespace(struct user_namespace *user_ns
 	if (ns->pid_cachep == NULL)
 		goto out_free_idr;
 
+	/* Optional, alloc_pid() falls back to pidmap_lock without it */
+	ns->pid_cache = alloc_pid_cache();
+
 	err = ns_alloc_inum(&ns->ns);
 	if (err)
 		goto out_free_idr;
@@ -116,6 +119,7 @@ static struct pid_namespace *create_pid_namespace(struct user_namespace *user_ns
 	return ns;
 
 out_free_idr:
+	free_percpu(ns->pid_cache);
 	idr_destroy(&ns->idr);
 	kmem_cache_free(pid_ns_cachep, ns);
 out_dec:
@@ -138,6 +142,7 @@ static void destroy_pid_namespace(struct pid_namespace *ns)
 {
 	ns_free_inum(&ns->ns);
 
+	free_percpu(ns->pid_cache);
 	idr_destroy(&ns->idr);
 	call_rcu(&ns->rcu, delayed_free_pidns);
 }
@@ -296,8 +301,11 @@ static int pid_ns_ctl_handler(struct ctl_table *table, int write,
 
 	tmp.data = &next;
 	ret = proc_dointvec_minmax(&tmp, write, buffer, lenp, ppos);
-	if (!ret && write)
+	if (!ret && write) {
+		/* The PID after @next must not sit in some CPU's batch */
+		pid_cache_disable(pid_ns);
 		idr_set_cursor(&pid_ns->idr, next + 1);
+	}
 
 	return ret;
 }
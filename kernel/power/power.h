@@ -6,6 +6,7 @@
 #include <linux/compiler.h>
 #include <linux/cpu.h>
 #include <linux/cpuidle.h>
+#include <linux/crypto.h>
 
 struct swsusp_info {
 	struct new_utsname	uts;
@@ -166,6 +167,16 @@ extern int swsusp_swap_in_use(void);
 #define SF_NOCOMPRESS_MODE	2
 #define SF_CRC32_MODE	        4
 #define SF_HW_SIG		8
+#define SF_COMPRESSION_ALG_LZ4	16
+#define SF_COMPRESSION_ALG_ZSTD	32
+
+/* Compression algorithms the image can be saved with */
+#define COMPRESSION_ALGO_LZO	"lzo"
+#define COMPRESSION_ALGO_LZ4	"lz4"
+#define COMPRESSION_ALGO_ZSTD	"zstd"
+
+/* Algorithm of the image being saved or loaded, set in hibernate.c */
+extern char hib_comp_algo[CRYPTO_MAX_ALG_NAME];
 
 /* kernel/power/hibernate.c */
 int swsusp_check(bool snapshot_test);
@@ -21,6 +21,7 @@
 /*#define DEBUG*/
 
 #include <linux/pm_qos.h>
+#include <linux/capability.h>
 #include <linux/sched.h>
 #include <linux/spinlock.h>
 #include <linux/slab.h>
@@ -422,6 +423,50 @@ static int __init cpu_latency_qos_init(void)
 	return ret;
 }
 late_initcall(cpu_latency_qos_init);
+
+/*
+ * Per-task wakeup latency constraints.
+ *
+ * A task can ask for the CPUs it runs on to be able to wake up within a
+ * given time. The constraint of the last task which ran on a CPU stays in
+ * effect while it is idle, as that's where the task is most likely woken
+ * up, so only those CPUs are kept in shallow idle states instead of the
+ * whole system, as with the global CPU latency QoS.
+ */
+DEFINE_PER_CPU(s32, cpu_task_latency_req) = PM_QOS_RESUME_LATENCY_NO_CONSTRAINT;
+
+/**
+ * cpu_task_latency_qos_limit - Return the task wakeup latency limit of a CPU.
+ * @cpu: Target CPU.
+ */
+s32 cpu_task_latency_qos_limit(int cpu)
+{
+	return READ_ONCE(per_cpu(cpu_task_latency_req, cpu));
+}
+
+/**
+ * task_latency_qos_set - Set the wakeup latency constraint of current.
+ * @value: Wakeup latency in usecs, or PM_QOS_RESUME_LATENCY_NO_CONSTRAINT
+ *	   to drop the constraint.
+ *
+ * Adding a constraint needs CAP_SYS_NICE, as it affects the power
+ * consumption of the whole system.
+ */
+int task_latency_qos_set(unsigned long value)
+{
+	if (value > PM_QOS_RESUME_LATENCY_NO_CONSTRAINT)
+		return -EINVAL;
+	if (value != PM_QOS_RESUME_LATENCY_NO_CONSTRAINT &&
+	    !capable(CAP_SYS_NICE))
+		return -EPERM;
+
+	preempt_disable();
+	current->wakeup_latency_qos = value;
+	this_cpu_write(cpu_task_latency_req, value);
+	preempt_enable();
+
+	return 0;
+}
 #endif /* CONFIG_CPU_IDLE */
 
 /* Definitions related to the frequency QoS below. */
@@ -296,6 +296,7 @@ static void __relay_reset(struct rchan_buf *buf, unsigned int init)
 	buf->subbufs_consumed = 0;
 	buf->bytes_consumed = 0;
 	buf->finalized = 0;
+	memset(&buf->stats, 0, sizeof(buf->stats));
 	buf->data = buf->start;
 	buf->offset = 0;
 
@@ -660,6 +661,7 @@ size_t relay_switch_subbuf(struct rchan_buf *buf, size_t length)
 {
 	void *old, *new;
 	size_t old_subbuf, new_subbuf;
+	int full;
 
 	if (unlikely(length > buf->chan->subbuf_size))
 		goto toobig;
@@ -692,10 +694,14 @@ size_t relay_switch_subbuf(struct rchan_buf *buf, size_t length)
 	new_subbuf = buf->subbufs_produced % buf->chan->n_subbufs;
 	new = buf->start + new_subbuf * buf->chan->subbuf_size;
 	buf->offset = 0;
+	full = relay_buf_full(buf);
 	if (!relay_subbuf_start(buf, new, old, buf->prev_padding)) {
+		buf->stats.full_count++;
 		buf->offset = buf->chan->subbuf_size + 1;
 		return 0;
 	}
+	if (full)
+		buf->stats.overwrite_count++;
 	buf->data = new;
 	buf->padding[new_subbuf] = 0;
 
@@ -705,6 +711,7 @@ size_t relay_switch_subbuf(struct rchan_buf *buf, size_t length)
 	return length;
 
 toobig:
+	buf->stats.big_count++;
 	buf->chan->last_toobig = length;
 	return 0;
 }
@@ -743,6 +750,46 @@ void relay_subbufs_consumed(struct rchan *chan,
 }
 EXPORT_SYMBOL_GPL(relay_subbufs_consumed);
 
+/**
+ *	relay_stats - get channel buffer statistics
+ *	@chan: the channel
+ *	@flags: select particular information to get
+ *
+ *	Returns the sum of the selected counters over all the channel
+ *	buffers.  The counters are updated locklessly by the writers, so
+ *	the result is a snapshot.
+ *
+ *	Takes relay_channels_mutex, so must be called from a context that
+ *	may sleep.
+ */
+size_t relay_stats(struct rchan *chan, int flags)
+{
+	struct rchan_buf *rbuf;
+	unsigned int i;
+	size_t count = 0;
+
+	if (!chan)
+		return 0;
+
+	mutex_lock(&relay_channels_mutex);
+	for_each_possible_cpu(i) {
+		rbuf = *per_cpu_ptr(chan->buf, i);
+		if (!rbuf)
+			continue;
+		if (flags & RELAY_STATS_BUF_FULL)
+			count += READ_ONCE(rbuf->stats.full_count);
+		if (flags & RELAY_STATS_BUF_OVERWRITE)
+			count += READ_ONCE(rbuf->stats.overwrite_count);
+		if (flags & RELAY_STATS_WRT_BIG)
+			count += READ_ONCE(rbuf->stats.big_count);
+		if (chan->is_global)
+			break;
+	}
+	mutex_unlock(&relay_channels_mutex);
+
+	return count;
+}
+
 /**
  *	relay_close - close the channel
  *	@chan: the channel
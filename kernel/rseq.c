@@ -13,6 +13,8 @@
 #include <linux/syscalls.h>
 #include <linux/rseq.h>
 #include <linux/types.h>
+#include <linux/sched/cputime.h>
+#include <linux/timekeeping.h>
 #include <asm/ptrace.h>
 
 #define CREATE_TRACE_POINTS
@@ -85,12 +87,45 @@
  *   F1. <failure>
  */
 
+static inline bool rseq_has_sched_runtime(struct task_struct *t)
+{
+	return t->rseq_len >= offsetofend(struct rseq, sched_stamp);
+}
+
+/*
+ * Clear RSEQ_SLICE_EXT_GRANTED once the extension is over, leaving a new
+ * request user-space may have made in the meantime alone.
+ */
+static int rseq_slice_update(struct task_struct *t)
+{
+	u32 ctrl;
+
+	if (!t->rseq_slice_ext || t->rseq_slice_state != RSEQ_SLICE_NONE)
+		return 0;
+	if (get_user(ctrl, &t->rseq->slice_ctrl))
+		return -EFAULT;
+	if (!(ctrl & RSEQ_SLICE_EXT_GRANTED))
+		return 0;
+	return put_user(ctrl & ~RSEQ_SLICE_EXT_GRANTED, &t->rseq->slice_ctrl);
+}
+
 static int rseq_update_cpu_node_id(struct task_struct *t)
 {
 	struct rseq __user *rseq = t->rseq;
 	u32 cpu_id = raw_smp_processor_id();
 	u32 node_id = cpu_to_node(cpu_id);
 	u32 mm_cid = task_mm_cid(t);
+	u64 runtime = 0, stamp = 0;
+
+	/*
+	 * Snapshot the thread CPU time so that user-space can extrapolate
+	 * it with CLOCK_MONOTONIC until the next time it is scheduled out,
+	 * which brings us back here before it returns to user-space.
+	 */
+	if (rseq_has_sched_runtime(t)) {
+		runtime = task_sched_runtime(t);
+		stamp = ktime_get_ns();
+	}
 
 	WARN_ON_ONCE((int) mm_cid < 0);
 	if (!user_write_access_begin(rseq, t->rseq_len))
@@ -104,6 +139,10 @@ static int rseq_update_cpu_node_id(struct task_struct *t)
 	 * need to be conditionally updated only if
 	 * t->rseq_len != ORIG_RSEQ_SIZE.
 	 */
+	if (rseq_has_sched_runtime(t)) {
+		unsafe_put_user(runtime, &rseq->sched_runtime, efault_end);
+		unsafe_put_user(stamp, &rseq->sched_stamp, efault_end);
+	}
 	user_write_access_end();
 	trace_rseq_update(t);
 	return 0;
@@ -146,6 +185,13 @@ static int rseq_reset_rseq_cpu_node_id(struct task_struct *t)
 	 * need to be conditionally reset only if
 	 * t->rseq_len != ORIG_RSEQ_SIZE.
 	 */
+	if (rseq_has_sched_runtime(t)) {
+		u64 zero = 0;
+
+		if (put_user(zero, &t->rseq->sched_runtime) ||
+		    put_user(zero, &t->rseq->sched_stamp))
+			return -EFAULT;
+	}
 	return 0;
 }
 
@@ -332,6 +378,8 @@ void __rseq_handle_notify_resume(struct ksignal *ksig, struct pt_regs *regs)
 	}
 	if (unlikely(rseq_update_cpu_node_id(t)))
 		goto error;
+	if (unlikely(rseq_slice_update(t)))
+		goto error;
 	return;
 
 error:
@@ -339,6 +387,31 @@ void __rseq_handle_notify_resume(struct ksignal *ksig, struct pt_regs *regs)
 	force_sigsegv(sig);
 }
 
+/*
+ * Called with interrupts enabled from the exit to user-space loop when a
+ * reschedule is pending. If the thread asked for a time slice extension
+ * and hasn't already been granted one since it last scheduled, let it
+ * return to user-space for a bounded amount of time instead of
+ * preempting it. Returns true if the reschedule has been deferred.
+ */
+bool rseq_slice_extension_grant(void)
+{
+	struct task_struct *t = current;
+	u32 ctrl;
+
+	if (likely(!t->rseq_slice_ext) || t->rseq_slice_state != RSEQ_SLICE_NONE)
+		return false;
+	if (get_user(ctrl, &t->rseq->slice_ctrl) ||
+	    !(ctrl & RSEQ_SLICE_EXT_REQUEST))
+		return false;
+	if (!sched_rseq_slice_extend())
+		return false;
+	ctrl = (ctrl & ~RSEQ_SLICE_EXT_REQUEST) | RSEQ_SLICE_EXT_GRANTED;
+	if (put_user(ctrl, &t->rseq->slice_ctrl))
+		force_sigsegv(0);
+	return true;
+}
+
 #ifdef CONFIG_DEBUG_RSEQ
 
 /*
@@ -383,10 +456,11 @@ SYSCALL_DEFINE4(rseq, struct rseq __user *, rseq, u32, rseq_len,
 		current->rseq = NULL;
 		current->rseq_sig = 0;
 		current->rseq_len = 0;
+		current->rseq_slice_ext = 0;
 		return 0;
 	}
 
-	if (unlikely(flags))
+	if (unlikely(flags & ~RSEQ_FLAG_SLICE_EXT))
 		return -EINVAL;
 
 	if (current->rseq) {
@@ -423,6 +497,7 @@ SYSCALL_DEFINE4(rseq, struct rseq __user *, rseq, u32, rseq_len,
 	current->rseq = rseq;
 	current->rseq_len = rseq_len;
 	current->rseq_sig = sig;
+	current->rseq_slice_ext = !!(flags & RSEQ_FLAG_SLICE_EXT);
 	/*
 	 * If rseq was previously inactive, and has just been
 	 * registered, ensure the cpu_id_start and cpu_id fields
@@ -54,6 +54,7 @@
 #include <linux/nmi.h>
 #include <linux/nospec.h>
 #include <linux/perf_event_api.h>
+#include <linux/pm_qos.h>
 #include <linux/profile.h>
 #include <linux/psi.h>
 #include <linux/rcuwait_api.h>
@@ -114,6 +115,7 @@ EXPORT_TRACEPOINT_SYMBOL_GPL(sched_overutilized_tp);
 EXPORT_TRACEPOINT_SYMBOL_GPL(sched_util_est_cfs_tp);
 EXPORT_TRACEPOINT_SYMBOL_GPL(sched_util_est_se_tp);
 EXPORT_TRACEPOINT_SYMBOL_GPL(sched_update_nr_running_tp);
+EXPORT_TRACEPOINT_SYMBOL_GPL(sched_cpufreq_boost_tp);
 
 DEFINE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
 
@@ -882,6 +884,95 @@ static inline void hrtick_rq_init(struct rq *rq)
 }
 #endif	/* CONFIG_SCHED_HRTICK */
 
+#ifdef CONFIG_RSEQ
+/*
+ * rseq time slice extension: a thread which is about to be preempted on
+ * its way back to user-space while it has RSEQ_SLICE_EXT_REQUEST set in
+ * its rseq area is allowed to run for up to sysctl_sched_rseq_slice_ext_us
+ * more before the reschedule is forced on it. The extension ends as soon
+ * as the thread schedules, usually through sched_yield().
+ */
+static unsigned int sysctl_sched_rseq_slice_ext_us = 20;
+static const unsigned int rseq_slice_ext_max_us = 50;
+
+static enum hrtimer_restart rseq_slice_timer_fn(struct hrtimer *timer)
+{
+	struct rq *rq = container_of(timer, struct rq, rseq_slice_timer);
+	struct task_struct *curr;
+	struct rq_flags rf;
+
+	WARN_ON_ONCE(cpu_of(rq) != smp_processor_id());
+
+	rq_lock(rq, &rf);
+	curr = rq->curr;
+	if (curr->rseq_slice_state == RSEQ_SLICE_GRANTED) {
+		curr->rseq_slice_state = RSEQ_SLICE_EXPIRED;
+		curr->rseq_slice_expired++;
+		resched_curr(rq);
+	}
+	rq_unlock(rq, &rf);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Called by rseq_slice_extension_grant() from the exit to user-space loop
+ * instead of schedule(). Returns false if the extension is disabled, in
+ * which case the caller has to reschedule.
+ */
+bool sched_rseq_slice_extend(void)
+{
+	unsigned int us = READ_ONCE(sysctl_sched_rseq_slice_ext_us);
+	struct task_struct *p = current;
+	struct rq_flags rf;
+	struct rq *rq;
+
+	if (!us)
+		return false;
+
+	rq = this_rq_lock_irq(&rf);
+	clear_tsk_need_resched(p);
+	clear_preempt_need_resched();
+	p->rseq_slice_state = RSEQ_SLICE_GRANTED;
+	p->rseq_slice_granted++;
+	hrtimer_start(&rq->rseq_slice_timer, ns_to_ktime(us * NSEC_PER_USEC),
+		      HRTIMER_MODE_REL_PINNED_HARD);
+	rq_unlock_irq(rq, &rf);
+
+	return true;
+}
+
+/* The extension of @prev, if any, ends when it goes through __schedule(). */
+static inline void rseq_slice_clear(struct rq *rq, struct task_struct *prev)
+{
+	if (likely(prev->rseq_slice_state == RSEQ_SLICE_NONE))
+		return;
+
+	if (prev->rseq_slice_state == RSEQ_SLICE_GRANTED) {
+		prev->rseq_slice_yielded++;
+		hrtimer_try_to_cancel(&rq->rseq_slice_timer);
+	}
+	prev->rseq_slice_state = RSEQ_SLICE_NONE;
+	/* Have RSEQ_SLICE_EXT_GRANTED cleared before it returns to user-space */
+	rseq_set_notify_resume(prev);
+}
+
+static void rseq_slice_rq_init(struct rq *rq)
+{
+	hrtimer_init(&rq->rseq_slice_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL_PINNED_HARD);
+	rq->rseq_slice_timer.function = rseq_slice_timer_fn;
+}
+#else /* CONFIG_RSEQ */
+static inline void rseq_slice_clear(struct rq *rq, struct task_struct *prev)
+{
+}
+
+static inline void rseq_slice_rq_init(struct rq *rq)
+{
+}
+#endif /* CONFIG_RSEQ */
+
 /*
  * cmpxchg based fetch_or, macro so it works for different integer types
  */
@@ -1224,13 +1315,43 @@ bool sched_can_stop_tick(struct rq *rq)
 	/*
 	 * If there are no DL,RR/FIFO tasks, there must only be CFS tasks left;
 	 * if there's more than one we need the tick for involuntary
-	 * preemption.
+	 * preemption, unless this is a batch CPU where the hrtick ends the
+	 * (long) slices instead.
 	 */
 	if (rq->nr_running > 1)
-		return false;
+		return sched_batch_rq(rq) && hrtick_enabled(rq);
 
 	return true;
 }
+
+/**
+ * sched_set_batch_cpus - set the CPUs running in batch mode
+ * @cpus: the new set of batch CPUs
+ *
+ * On a batch CPU, CFS tasks get slices of at least sysctl_sched_batch_slice
+ * which are ended by the hrtick, so the periodic tick can be stopped even
+ * with several runnable tasks. This trades latency for fewer tick
+ * interrupts and the load balancing they trigger. Only nohz_full CPUs
+ * can stop their tick, the other CPUs in @cpus are ignored.
+ */
+void sched_set_batch_cpus(const struct cpumask *cpus)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		bool batch = cpumask_test_cpu(cpu, cpus) && tick_nohz_full_cpu(cpu);
+		struct rq *rq = cpu_rq(cpu);
+		struct rq_flags rf;
+
+		if (READ_ONCE(rq->batch_cpu) == batch)
+			continue;
+
+		rq_lock_irqsave(rq, &rf);
+		WRITE_ONCE(rq->batch_cpu, batch);
+		sched_update_tick_dependency(rq);
+		rq_unlock_irqrestore(rq, &rf);
+	}
+}
 #endif /* CONFIG_NO_HZ_FULL */
 #endif /* CONFIG_SMP */
 
@@ -4711,6 +4832,17 @@ static struct ctl_table sched_core_sysctls[] = {
 		.extra2		= SYSCTL_FOUR,
 	},
 #endif /* CONFIG_NUMA_BALANCING */
+#ifdef CONFIG_RSEQ
+	{
+		.procname	= "sched_rseq_slice_ext_us",
+		.data		= &sysctl_sched_rseq_slice_ext_us,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= (void *)&rseq_slice_ext_max_us,
+	},
+#endif /* CONFIG_RSEQ */
 	{}
 };
 static int __init sched_core_sysctl_init(void)
@@ -5161,6 +5293,18 @@ static inline void kmap_local_sched_in(void)
 #endif
 }
 
+static inline void task_latency_qos_switch(struct task_struct *next)
+{
+#ifdef CONFIG_CPU_IDLE
+	/* The idle task keeps the constraint of the task that ran last */
+	if (is_idle_task(next))
+		return;
+	if (unlikely(__this_cpu_read(cpu_task_latency_req) !=
+		     next->wakeup_latency_qos))
+		__this_cpu_write(cpu_task_latency_req, next->wakeup_latency_qos);
+#endif
+}
+
 /**
  * prepare_task_switch - prepare to switch tasks
  * @rq: the runqueue preparing to switch
@@ -5178,6 +5322,7 @@ static inline void
 prepare_task_switch(struct rq *rq, struct task_struct *prev,
 		    struct task_struct *next)
 {
+	task_latency_qos_switch(next);
 	kcov_prepare_switch(prev);
 	sched_info_switch(rq, prev, next);
 	perf_event_task_sched_out(prev, next);
@@ -6631,6 +6776,8 @@ static void __sched notrace __schedule(unsigned int sched_mode)
 	rq->clock_update_flags <<= 1;
 	update_rq_clock(rq);
 
+	rseq_slice_clear(rq, prev);
+
 	switch_count = &prev->nivcsw;
 
 	/*
@@ -10042,6 +10189,7 @@ void __init sched_init(void)
 #endif
 #endif /* CONFIG_SMP */
 		hrtick_rq_init(rq);
+		rseq_slice_rq_init(rq);
 		atomic_set(&rq->nr_iowait, 0);
 
 #ifdef CONFIG_SCHED_CORE
@@ -10522,6 +10670,7 @@ void sched_move_task(struct task_struct *tsk)
 	if (running)
 		put_prev_task(rq, tsk);
 
+	dl_tg_move_task(tsk, tsk->sched_task_group, group);
 	sched_change_group(tsk, group);
 
 	if (queued)
@@ -10588,6 +10737,8 @@ static void cpu_cgroup_css_released(struct cgroup_subsys_state *css)
 {
 	struct task_group *tg = css_tg(css);
 
+	/* Hand a deadline reservation back to the parent */
+	dl_tg_set_bandwidth(tg, RUNTIME_INF, 0);
 	sched_release_group(tg);
 }
 
@@ -10601,19 +10752,23 @@ static void cpu_cgroup_css_free(struct cgroup_subsys_state *css)
 	sched_unregister_group(tg);
 }
 
-#ifdef CONFIG_RT_GROUP_SCHED
 static int cpu_cgroup_can_attach(struct cgroup_taskset *tset)
 {
 	struct task_struct *task;
 	struct cgroup_subsys_state *css;
+	int ret;
 
 	cgroup_taskset_for_each(task, css, tset) {
+#ifdef CONFIG_RT_GROUP_SCHED
 		if (!sched_rt_can_attach(css_tg(css), task))
 			return -EINVAL;
+#endif
+		ret = dl_tg_can_attach(css_tg(css), task);
+		if (ret)
+			return ret;
 	}
 	return 0;
 }
-#endif
 
 static void cpu_cgroup_attach(struct cgroup_taskset *tset)
 {
@@ -11180,6 +11335,28 @@ static int cpu_idle_write_s64(struct cgroup_subsys_state *css,
 {
 	return sched_group_set_idle(css_tg(css), idle);
 }
+
+#ifdef CONFIG_SCHEDSTATS
+/* Runqueue wait time histogram of the group entities, one line per bucket */
+static int cpu_wait_hist_show(struct seq_file *sf, void *v)
+{
+	struct task_group *tg = css_tg(seq_css(sf));
+	u64 hist[SCHED_WAIT_HIST_NR] = { };
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		struct sched_statistics *stats = __schedstats_from_se(tg->se[cpu]);
+
+		for (i = 0; i < SCHED_WAIT_HIST_NR; i++)
+			hist[i] += schedstat_val(stats->wait_hist[i]);
+	}
+
+	for (i = 0; i < SCHED_WAIT_HIST_NR - 1; i++)
+		seq_printf(sf, "lt_%lluus %llu\n", 1ULL << i, hist[i]);
+	seq_printf(sf, "ge_%lluus %llu\n", 1ULL << (i - 1), hist[i]);
+	return 0;
+}
+#endif
 #endif
 
 static struct cftype cpu_legacy_files[] = {
@@ -11194,6 +11371,13 @@ static struct cftype cpu_legacy_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+#ifdef CONFIG_SCHEDSTATS
+	{
+		.name = "wait_hist",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_wait_hist_show,
+	},
+#endif
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -11391,6 +11575,33 @@ static ssize_t cpu_max_write(struct kernfs_open_file *of,
 }
 #endif
 
+static int cpu_dl_max_show(struct seq_file *sf, void *v)
+{
+	struct task_group *tg = css_tg(seq_css(sf));
+	long runtime = -1;
+
+	if (READ_ONCE(tg->dl_bw))
+		runtime = div_u64(READ_ONCE(tg->dl_runtime), NSEC_PER_USEC);
+	cpu_period_quota_print(sf, div_u64(READ_ONCE(tg->dl_period), NSEC_PER_USEC),
+			       runtime);
+	return 0;
+}
+
+static ssize_t cpu_dl_max_write(struct kernfs_open_file *of,
+				char *buf, size_t nbytes, loff_t off)
+{
+	struct task_group *tg = css_tg(of_css(of));
+	/* the parser takes the period in usecs */
+	u64 period = div_u64(READ_ONCE(tg->dl_period), NSEC_PER_USEC);
+	u64 runtime;
+	int ret;
+
+	ret = cpu_period_quota_parse(buf, &period, &runtime);
+	if (!ret)
+		ret = dl_tg_set_bandwidth(tg, runtime, period);
+	return ret ?: nbytes;
+}
+
 static struct cftype cpu_files[] = {
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
@@ -11411,6 +11622,13 @@ static struct cftype cpu_files[] = {
 		.read_s64 = cpu_idle_read_s64,
 		.write_s64 = cpu_idle_write_s64,
 	},
+#ifdef CONFIG_SCHEDSTATS
+	{
+		.name = "wait_hist",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_wait_hist_show,
+	},
+#endif
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -11440,6 +11658,12 @@ static struct cftype cpu_files[] = {
 		.write = cpu_uclamp_max_write,
 	},
 #endif
+	{
+		.name = "dl.max",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_dl_max_show,
+		.write = cpu_dl_max_write,
+	},
 	{ }	/* terminate */
 };
 
@@ -11449,9 +11673,7 @@ struct cgroup_subsys cpu_cgrp_subsys = {
 	.css_released	= cpu_cgroup_css_released,
 	.css_free	= cpu_cgroup_css_free,
 	.css_extra_stat_show = cpu_extra_stat_show,
-#ifdef CONFIG_RT_GROUP_SCHED
 	.can_attach	= cpu_cgroup_can_attach,
-#endif
 	.attach		= cpu_cgroup_attach,
 	.legacy_cftypes	= cpu_legacy_files,
 	.dfl_cftypes	= cpu_files,
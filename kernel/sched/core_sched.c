@@ -3,28 +3,29 @@
 /*
  * A simple wrapper around refcount. An allocated sched_core_cookie's
  * address is used to compute the cookie of the task.
+ *
+ * Cookies can be created as members of a compatibility group, in which case
+ * ->group points to the cookie that started the group, and whose address is
+ * what gets matched. Such members hold a reference on the group leader so
+ * its address cannot be recycled while in use; standalone cookies are their
+ * own leader.
+ *
+ * A task holds a reference on p->core_ref, while p->core_cookie caches the
+ * group leader's address so that the matching paths don't need to chase it.
  */
 struct sched_core_cookie {
 	refcount_t refcnt;
+	struct sched_core_cookie *group;
+	atomic64_t forceidle_sum;
 };
 
-static unsigned long sched_core_alloc_cookie(void)
-{
-	struct sched_core_cookie *ck = kmalloc(sizeof(*ck), GFP_KERNEL);
-	if (!ck)
-		return 0;
-
-	refcount_set(&ck->refcnt, 1);
-	sched_core_get();
-
-	return (unsigned long)ck;
-}
-
 static void sched_core_put_cookie(unsigned long cookie)
 {
 	struct sched_core_cookie *ptr = (void *)cookie;
 
 	if (ptr && refcount_dec_and_test(&ptr->refcnt)) {
+		if (ptr->group != ptr)
+			sched_core_put_cookie((unsigned long)ptr->group);
 		kfree(ptr);
 		sched_core_put();
 	}
@@ -40,6 +41,33 @@ static unsigned long sched_core_get_cookie(unsigned long cookie)
 	return cookie;
 }
 
+static inline unsigned long sched_core_cookie_key(unsigned long cookie)
+{
+	struct sched_core_cookie *ptr = (void *)cookie;
+
+	return ptr ? (unsigned long)ptr->group : 0UL;
+}
+
+/*
+ * sched_core_alloc_cookie - allocate a new cookie
+ * @group: a cookie whose compatibility group the new cookie joins, or 0
+ */
+static unsigned long sched_core_alloc_cookie(unsigned long group)
+{
+	struct sched_core_cookie *ck = kmalloc(sizeof(*ck), GFP_KERNEL);
+	if (!ck)
+		return 0;
+
+	refcount_set(&ck->refcnt, 1);
+	atomic64_set(&ck->forceidle_sum, 0);
+	ck->group = ck;
+	if (group)
+		ck->group = (void *)sched_core_get_cookie(sched_core_cookie_key(group));
+	sched_core_get();
+
+	return (unsigned long)ck;
+}
+
 /*
  * sched_core_update_cookie - replace the cookie on a task
  * @p: the task to update
@@ -70,8 +98,9 @@ static unsigned long sched_core_update_cookie(struct task_struct *p,
 	if (sched_core_enqueued(p))
 		sched_core_dequeue(rq, p, DEQUEUE_SAVE);
 
-	old_cookie = p->core_cookie;
-	p->core_cookie = cookie;
+	old_cookie = p->core_ref;
+	p->core_ref = cookie;
+	p->core_cookie = sched_core_cookie_key(cookie);
 
 	/*
 	 * Consider the cases: !prev_cookie and !cookie.
@@ -101,7 +130,7 @@ static unsigned long sched_core_clone_cookie(struct task_struct *p)
 	unsigned long cookie, flags;
 
 	raw_spin_lock_irqsave(&p->pi_lock, flags);
-	cookie = sched_core_get_cookie(p->core_cookie);
+	cookie = sched_core_get_cookie(p->core_ref);
 	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
 
 	return cookie;
@@ -110,12 +139,13 @@ static unsigned long sched_core_clone_cookie(struct task_struct *p)
 void sched_core_fork(struct task_struct *p)
 {
 	RB_CLEAR_NODE(&p->core_node);
-	p->core_cookie = sched_core_clone_cookie(current);
+	p->core_ref = sched_core_clone_cookie(current);
+	p->core_cookie = sched_core_cookie_key(p->core_ref);
 }
 
 void sched_core_free(struct task_struct *p)
 {
-	sched_core_put_cookie(p->core_cookie);
+	sched_core_put_cookie(p->core_ref);
 }
 
 static void __sched_core_set(struct task_struct *p, unsigned long cookie)
@@ -129,7 +159,7 @@ static void __sched_core_set(struct task_struct *p, unsigned long cookie)
 int sched_core_share_pid(unsigned int cmd, pid_t pid, enum pid_type type,
 			 unsigned long uaddr)
 {
-	unsigned long cookie = 0, id = 0;
+	unsigned long cookie = 0, group, id = 0;
 	struct task_struct *task, *p;
 	struct pid *grp;
 	int err = 0;
@@ -142,7 +172,8 @@ int sched_core_share_pid(unsigned int cmd, pid_t pid, enum pid_type type,
 	BUILD_BUG_ON(PR_SCHED_CORE_SCOPE_PROCESS_GROUP != PIDTYPE_PGID);
 
 	if (type > PIDTYPE_PGID || cmd >= PR_SCHED_CORE_MAX || pid < 0 ||
-	    (cmd != PR_SCHED_CORE_GET && uaddr))
+	    (cmd != PR_SCHED_CORE_GET && cmd != PR_SCHED_CORE_GET_FORCEIDLE &&
+	     uaddr))
 		return -EINVAL;
 
 	rcu_read_lock();
@@ -181,8 +212,40 @@ int sched_core_share_pid(unsigned int cmd, pid_t pid, enum pid_type type,
 		err = put_user(id, (u64 __user *)uaddr);
 		goto out;
 
+	case PR_SCHED_CORE_GET_FORCEIDLE:
+		if (type != PIDTYPE_PID || uaddr & 7) {
+			err = -EINVAL;
+			goto out;
+		}
+		cookie = sched_core_clone_cookie(task);
+		if (cookie) {
+			struct sched_core_cookie *ck = (void *)cookie;
+
+			id = atomic64_read(&ck->forceidle_sum);
+		}
+		err = put_user(id, (u64 __user *)uaddr);
+		goto out;
+
 	case PR_SCHED_CORE_CREATE:
-		cookie = sched_core_alloc_cookie();
+		cookie = sched_core_alloc_cookie(0);
+		if (!cookie) {
+			err = -ENOMEM;
+			goto out;
+		}
+		break;
+
+	case PR_SCHED_CORE_CREATE_COMPAT:
+		/*
+		 * Only the holder of a cookie can extend its group, which is
+		 * the same trust model as PR_SCHED_CORE_SHARE_TO.
+		 */
+		group = sched_core_clone_cookie(current);
+		if (!group) {
+			err = -EINVAL;
+			goto out;
+		}
+		cookie = sched_core_alloc_cookie(group);
+		sched_core_put_cookie(group);
 		if (!cookie) {
 			err = -ENOMEM;
 			goto out;
@@ -283,6 +346,11 @@ void __sched_core_account_forceidle(struct rq *rq)
 		 * if it comes from our SMT sibling.
 		 */
 		__account_forceidle_time(p, delta);
+		if (p->core_ref) {
+			struct sched_core_cookie *ck = (void *)p->core_ref;
+
+			atomic64_add(delta, &ck->forceidle_sum);
+		}
 	}
 }
 
@@ -72,3 +72,34 @@ bool cpufreq_this_cpu_can_update(struct cpufreq_policy *policy)
 		(policy->dvfs_possible_from_any_cpu &&
 		 rcu_dereference_sched(*this_cpu_ptr(&cpufreq_update_util_data)));
 }
+
+#ifdef CONFIG_UCLAMP_TASK
+/**
+ * cpufreq_cpu_uclamp - Get the utilization clamps of a CPU.
+ * @cpu: Target CPU.
+ * @min: Where to store the minimum utilization clamp.
+ * @max: Where to store the maximum utilization clamp.
+ *
+ * The clamps are aggregated over the tasks runnable on @cpu, which lets
+ * drivers that select the performance level in hardware honour them.
+ *
+ * Return 'false' if utilization clamping is not in use.
+ */
+bool cpufreq_cpu_uclamp(int cpu, unsigned long *min, unsigned long *max)
+{
+	struct rq *rq = cpu_rq(cpu);
+
+	if (!uclamp_is_used())
+		return false;
+
+	*min = uclamp_rq_get(rq, UCLAMP_MIN);
+	*max = uclamp_rq_get(rq, UCLAMP_MAX);
+
+	/* Like uclamp_rq_util_with(), let the boost win on inversion */
+	if (*min > *max)
+		*max = *min;
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(cpufreq_cpu_uclamp);
+#endif
@@ -11,6 +11,7 @@
 struct sugov_tunables {
 	struct gov_attr_set	attr_set;
 	unsigned int		rate_limit_us;
+	unsigned int		boost_decay_us;
 };
 
 struct sugov_policy {
@@ -22,6 +23,7 @@ struct sugov_policy {
 	raw_spinlock_t		update_lock;
 	u64			last_freq_update_time;
 	s64			freq_update_delay_ns;
+	s64			boost_decay_ns;
 	unsigned int		next_freq;
 	unsigned int		cached_raw_freq;
 
@@ -46,6 +48,10 @@ struct sugov_cpu {
 	unsigned int		iowait_boost;
 	u64			last_update;
 
+	/* Bumped by cpufreq_io_boost_hint(), consumed by the update hooks */
+	unsigned int		io_hints;
+	unsigned int		io_hints_seen;
+
 	unsigned long		util;
 	unsigned long		bw_dl;
 
@@ -169,18 +175,18 @@ static void sugov_get_util(struct sugov_cpu *sg_cpu)
  * @time: the update time from the caller
  * @set_iowait_boost: true if an IO boost has been requested
  *
- * The IO wait boost of a task is disabled after a tick since the last update
- * of a CPU. If a new IO wait boost is requested after more then a tick, then
- * we enable the boost starting from IOWAIT_BOOST_MIN, which improves energy
- * efficiency by ignoring sporadic wakeups from IO.
+ * The IO wait boost of a task is disabled after boost_decay_us (a tick by
+ * default) since the last update of a CPU. If a new IO wait boost is requested
+ * after that, then we enable the boost starting from IOWAIT_BOOST_MIN, which
+ * improves energy efficiency by ignoring sporadic wakeups from IO.
  */
 static bool sugov_iowait_reset(struct sugov_cpu *sg_cpu, u64 time,
 			       bool set_iowait_boost)
 {
 	s64 delta_ns = time - sg_cpu->last_update;
 
-	/* Reset boost only if a tick has elapsed since last request */
-	if (delta_ns <= TICK_NSEC)
+	/* Reset boost only if the decay period has elapsed since last request */
+	if (delta_ns <= sg_cpu->sg_policy->boost_decay_ns)
 		return false;
 
 	sg_cpu->iowait_boost = set_iowait_boost ? IOWAIT_BOOST_MIN : 0;
@@ -195,18 +201,28 @@ static bool sugov_iowait_reset(struct sugov_cpu *sg_cpu, u64 time,
  * @time: the update time from the caller
  * @flags: SCHED_CPUFREQ_IOWAIT if the task is waking up after an IO wait
  *
+ * Completions reported through cpufreq_io_boost_hint() since the previous
+ * update count as a request as well, so that CPUs polling for IO, which never
+ * sleep in iowait, get the same treatment.
+ *
  * Each time a task wakes up after an IO operation, the CPU utilization can be
  * boosted to a certain utilization which doubles at each "frequent and
  * successive" wakeup from IO, ranging from IOWAIT_BOOST_MIN to the utilization
  * of the maximum OPP.
  *
- * To keep doubling, an IO boost has to be requested at least once per tick,
- * otherwise we restart from the utilization of the minimum OPP.
+ * To keep doubling, an IO boost has to be requested at least once per decay
+ * period, otherwise we restart from the utilization of the minimum OPP.
  */
 static void sugov_iowait_boost(struct sugov_cpu *sg_cpu, u64 time,
 			       unsigned int flags)
 {
 	bool set_iowait_boost = flags & SCHED_CPUFREQ_IOWAIT;
+	unsigned int io_hints = READ_ONCE(sg_cpu->io_hints);
+
+	if (io_hints != sg_cpu->io_hints_seen) {
+		sg_cpu->io_hints_seen = io_hints;
+		set_iowait_boost = true;
+	}
 
 	/* Reset boost if the CPU appears to have been idle enough */
 	if (sg_cpu->iowait_boost &&
@@ -283,10 +299,26 @@ static void sugov_iowait_apply(struct sugov_cpu *sg_cpu, u64 time,
 	 */
 	boost = (sg_cpu->iowait_boost * max_cap) >> SCHED_CAPACITY_SHIFT;
 	boost = uclamp_rq_util_with(cpu_rq(sg_cpu->cpu), boost, NULL);
+	trace_sched_cpufreq_boost_tp(sg_cpu->cpu, boost, sg_cpu->util);
 	if (sg_cpu->util < boost)
 		sg_cpu->util = boost;
 }
 
+/**
+ * cpufreq_io_boost_hint() - Report an IO completion found by polling.
+ *
+ * Polled completions (io_uring IOPOLL, NVMe poll queues) never put the task
+ * into iowait, so SCHED_CPUFREQ_IOWAIT never fires for them. Hot completion
+ * paths call this instead; it only bumps a per-CPU counter, and the next
+ * schedutil update on this CPU treats it like an IO wakeup. The resulting
+ * boost decays like the iowait one, over the policy's boost_decay_us.
+ */
+void cpufreq_io_boost_hint(void)
+{
+	this_cpu_inc(sugov_cpu.io_hints);
+}
+EXPORT_SYMBOL_GPL(cpufreq_io_boost_hint);
+
 #ifdef CONFIG_NO_HZ_COMMON
 static bool sugov_cpu_is_busy(struct sugov_cpu *sg_cpu)
 {
@@ -534,8 +566,36 @@ rate_limit_us_store(struct gov_attr_set *attr_set, const char *buf, size_t count
 
 static struct governor_attr rate_limit_us = __ATTR_RW(rate_limit_us);
 
+static ssize_t boost_decay_us_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->boost_decay_us);
+}
+
+static ssize_t
+boost_decay_us_store(struct gov_attr_set *attr_set, const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	struct sugov_policy *sg_policy;
+	unsigned int boost_decay_us;
+
+	if (kstrtouint(buf, 10, &boost_decay_us))
+		return -EINVAL;
+
+	tunables->boost_decay_us = boost_decay_us;
+
+	list_for_each_entry(sg_policy, &attr_set->policy_list, tunables_hook)
+		sg_policy->boost_decay_ns = boost_decay_us * NSEC_PER_USEC;
+
+	return count;
+}
+
+static struct governor_attr boost_decay_us = __ATTR_RW(boost_decay_us);
+
 static struct attribute *sugov_attrs[] = {
 	&rate_limit_us.attr,
+	&boost_decay_us.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(sugov);
@@ -699,6 +759,7 @@ static int sugov_init(struct cpufreq_policy *policy)
 	}
 
 	tunables->rate_limit_us = cpufreq_policy_transition_delay_us(policy);
+	tunables->boost_decay_us = TICK_NSEC / NSEC_PER_USEC;
 
 	policy->governor_data = sg_policy;
 	sg_policy->tunables = tunables;
@@ -759,6 +820,7 @@ static int sugov_start(struct cpufreq_policy *policy)
 	unsigned int cpu;
 
 	sg_policy->freq_update_delay_ns	= sg_policy->tunables->rate_limit_us * NSEC_PER_USEC;
+	sg_policy->boost_decay_ns		= sg_policy->tunables->boost_decay_us * NSEC_PER_USEC;
 	sg_policy->last_freq_update_time	= 0;
 	sg_policy->next_freq			= 0;
 	sg_policy->work_in_progress		= false;
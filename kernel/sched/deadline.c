@@ -308,6 +308,152 @@ void sub_running_bw(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
 		__sub_running_bw(dl_se->dl_bw, dl_rq);
 }
 
+#ifdef CONFIG_CGROUP_SCHED
+/*
+ * SCHED_DEADLINE cgroup reservations.
+ *
+ * A task group with a reservation (->dl_bw != 0) caps the deadline
+ * bandwidth its subtree can be admitted with. ->dl_usage is what a group's
+ * own tasks and its children consume, a reserved child counting with its
+ * whole reservation, so charges propagate up to the first reserved group.
+ *
+ * This is admission control on top of the root domain one: the tasks still
+ * run on their own CBS servers, which are what enforce the reservation at
+ * run time. The charged bandwidth follows p->dl.dl_bw, i.e. it is released
+ * together with the root domain one at the 0-lag time.
+ */
+static DEFINE_RAW_SPINLOCK(dl_tg_lock);
+
+static struct task_group *dl_tg_reserved(struct task_group *tg)
+{
+	for (; tg; tg = tg->parent) {
+		if (tg->dl_bw)
+			return tg;
+	}
+	return NULL;
+}
+
+static bool dl_tg_fits(struct task_group *tg, s64 delta)
+{
+	tg = dl_tg_reserved(tg);
+
+	return !tg || delta <= 0 || tg->dl_usage + delta <= tg->dl_bw;
+}
+
+static void dl_tg_charge(struct task_group *tg, s64 delta)
+{
+	for (; tg; tg = tg->parent) {
+		tg->dl_usage += delta;
+		if (tg->dl_bw)
+			break;
+	}
+}
+
+static inline bool dl_tg_task_charged(struct task_struct *p)
+{
+	return p->dl.dl_bw && !dl_entity_is_special(&p->dl);
+}
+
+static void dl_tg_uncharge_task(struct task_struct *p)
+{
+	if (!dl_tg_task_charged(p))
+		return;
+
+	raw_spin_lock(&dl_tg_lock);
+	dl_tg_charge(task_group(p), -(s64)p->dl.dl_bw);
+	raw_spin_unlock(&dl_tg_lock);
+}
+
+/* Called with p's rq->lock held, before p->sched_task_group changes */
+void dl_tg_move_task(struct task_struct *p, struct task_group *from,
+		     struct task_group *to)
+{
+	if (!dl_tg_task_charged(p))
+		return;
+
+	raw_spin_lock(&dl_tg_lock);
+	dl_tg_charge(from, -(s64)p->dl.dl_bw);
+	dl_tg_charge(to, p->dl.dl_bw);
+	raw_spin_unlock(&dl_tg_lock);
+}
+
+int dl_tg_can_attach(struct task_group *tg, struct task_struct *p)
+{
+	unsigned long flags;
+	u64 bw = READ_ONCE(p->dl.dl_bw);
+	bool fits;
+
+	if (!bw || dl_entity_is_special(&p->dl))
+		return 0;
+
+	raw_spin_lock_irqsave(&dl_tg_lock, flags);
+	dl_tg_charge(task_group(p), -(s64)bw);
+	fits = dl_tg_fits(tg, bw);
+	dl_tg_charge(task_group(p), bw);
+	raw_spin_unlock_irqrestore(&dl_tg_lock, flags);
+
+	return fits ? 0 : -EBUSY;
+}
+
+/*
+ * dl_tg_set_bandwidth - set or, with @runtime == RUNTIME_INF, remove the
+ * deadline reservation of @tg
+ */
+int dl_tg_set_bandwidth(struct task_group *tg, u64 runtime, u64 period)
+{
+	u64 old_contrib, new_contrib, new_bw = 0;
+	int ret = 0;
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	if (runtime != RUNTIME_INF) {
+		if (!runtime || !period || runtime > period)
+			return -EINVAL;
+		new_bw = to_ratio(period, runtime);
+	}
+
+	raw_spin_lock_irq(&dl_tg_lock);
+
+	if (new_bw && tg->dl_usage > new_bw) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	old_contrib = tg->dl_bw ?: tg->dl_usage;
+	new_contrib = new_bw ?: tg->dl_usage;
+	if (!dl_tg_fits(tg->parent, new_contrib - old_contrib)) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	dl_tg_charge(tg->parent, new_contrib - old_contrib);
+	tg->dl_bw = new_bw;
+	tg->dl_runtime = runtime;
+	tg->dl_period = period;
+unlock:
+	raw_spin_unlock_irq(&dl_tg_lock);
+
+	return ret;
+}
+
+static inline void dl_tg_lock_acquire(void)
+{
+	raw_spin_lock(&dl_tg_lock);
+}
+
+static inline void dl_tg_lock_release(void)
+{
+	raw_spin_unlock(&dl_tg_lock);
+}
+#else
+static inline bool dl_tg_fits(struct task_group *tg, s64 delta) { return true; }
+static inline void dl_tg_charge(struct task_group *tg, s64 delta) { }
+static inline void dl_tg_uncharge_task(struct task_struct *p) { }
+static inline void dl_tg_lock_acquire(void) { }
+static inline void dl_tg_lock_release(void) { }
+#endif /* CONFIG_CGROUP_SCHED */
+
 static void dl_change_utilization(struct task_struct *p, u64 new_bw)
 {
 	struct rq *rq;
@@ -434,6 +580,7 @@ static void task_non_contending(struct task_struct *p)
 			raw_spin_lock(&dl_b->lock);
 			__dl_sub(dl_b, p->dl.dl_bw, dl_bw_cpus(task_cpu(p)));
 			raw_spin_unlock(&dl_b->lock);
+			dl_tg_uncharge_task(p);
 			__dl_clear_params(p);
 		}
 
@@ -1422,6 +1569,7 @@ static enum hrtimer_restart inactive_task_timer(struct hrtimer *timer)
 		raw_spin_lock(&dl_b->lock);
 		__dl_sub(dl_b, p->dl.dl_bw, dl_bw_cpus(task_cpu(p)));
 		raw_spin_unlock(&dl_b->lock);
+		dl_tg_uncharge_task(p);
 		__dl_clear_params(p);
 
 		goto unlock;
@@ -2853,7 +3001,9 @@ int sched_dl_overflow(struct task_struct *p, int policy,
 	u64 new_bw = dl_policy(policy) ? to_ratio(period, runtime) : 0;
 	int cpus, err = -1, cpu = task_cpu(p);
 	struct dl_bw *dl_b = dl_bw_of(cpu);
+	struct task_group *tg = task_group(p);
 	unsigned long cap;
+	s64 tg_delta;
 
 	if (attr->sched_flags & SCHED_FLAG_SUGOV)
 		return 0;
@@ -2866,19 +3016,29 @@ int sched_dl_overflow(struct task_struct *p, int policy,
 	 * Either if a task, enters, leave, or stays -deadline but changes
 	 * its parameters, we may need to update accordingly the total
 	 * allocated bandwidth of the container.
+	 *
+	 * The task group is charged like the root domain, i.e. the old
+	 * bandwidth only counts while it is still allocated there.
 	 */
+	tg_delta = new_bw;
+	if (task_has_dl_policy(p) || hrtimer_active(&p->dl.inactive_timer))
+		tg_delta -= p->dl.dl_bw;
+
+	dl_tg_lock_acquire();
 	raw_spin_lock(&dl_b->lock);
 	cpus = dl_bw_cpus(cpu);
 	cap = dl_bw_capacity(cpu);
 
 	if (dl_policy(policy) && !task_has_dl_policy(p) &&
-	    !__dl_overflow(dl_b, cap, 0, new_bw)) {
+	    !__dl_overflow(dl_b, cap, 0, new_bw) && dl_tg_fits(tg, tg_delta)) {
 		if (hrtimer_active(&p->dl.inactive_timer))
 			__dl_sub(dl_b, p->dl.dl_bw, cpus);
 		__dl_add(dl_b, new_bw, cpus);
+		dl_tg_charge(tg, tg_delta);
 		err = 0;
 	} else if (dl_policy(policy) && task_has_dl_policy(p) &&
-		   !__dl_overflow(dl_b, cap, p->dl.dl_bw, new_bw)) {
+		   !__dl_overflow(dl_b, cap, p->dl.dl_bw, new_bw) &&
+		   dl_tg_fits(tg, tg_delta)) {
 		/*
 		 * XXX this is slightly incorrect: when the task
 		 * utilization decreases, we should delay the total
@@ -2888,6 +3048,7 @@ int sched_dl_overflow(struct task_struct *p, int policy,
 		 */
 		__dl_sub(dl_b, p->dl.dl_bw, cpus);
 		__dl_add(dl_b, new_bw, cpus);
+		dl_tg_charge(tg, tg_delta);
 		dl_change_utilization(p, new_bw);
 		err = 0;
 	} else if (!dl_policy(policy) && task_has_dl_policy(p)) {
@@ -2899,6 +3060,7 @@ int sched_dl_overflow(struct task_struct *p, int policy,
 		err = 0;
 	}
 	raw_spin_unlock(&dl_b->lock);
+	dl_tg_lock_release();
 
 	return err;
 }
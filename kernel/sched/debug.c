@@ -350,6 +350,9 @@ static __init int sched_init_debug(void)
 	debugfs_create_u32("latency_ns", 0644, debugfs_sched, &sysctl_sched_latency);
 	debugfs_create_u32("min_granularity_ns", 0644, debugfs_sched, &sysctl_sched_min_granularity);
 	debugfs_create_u32("idle_min_granularity_ns", 0644, debugfs_sched, &sysctl_sched_idle_min_granularity);
+#ifdef CONFIG_NO_HZ_FULL
+	debugfs_create_u32("batch_slice_ns", 0644, debugfs_sched, &sysctl_sched_batch_slice);
+#endif
 	debugfs_create_u32("wakeup_granularity_ns", 0644, debugfs_sched, &sysctl_sched_wakeup_granularity);
 
 	debugfs_create_u32("latency_warn_ms", 0644, debugfs_sched, &sysctl_resched_latency_warn_ms);
@@ -422,6 +425,7 @@ static void register_sd(struct sched_domain *sd, struct dentry *parent)
 	SDM(u32,   0644, busy_factor);
 	SDM(u32,   0644, imbalance_pct);
 	SDM(u32,   0644, cache_nice_tries);
+	SDM(u32,   0644, migration_cost);
 	SDM(str,   0444, name);
 
 #undef SDM
@@ -1013,6 +1017,7 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 
 	if (schedstat_enabled()) {
 		u64 avg_atom, avg_per_cpu;
+		int i;
 
 		PN_SCHEDSTAT(sum_sleep_runtime);
 		PN_SCHEDSTAT(sum_block_runtime);
@@ -1026,6 +1031,10 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 		PN_SCHEDSTAT(wait_max);
 		PN_SCHEDSTAT(wait_sum);
 		P_SCHEDSTAT(wait_count);
+		SEQ_printf(m, "%-45s:", "wait_hist");
+		for (i = 0; i < SCHED_WAIT_HIST_NR; i++)
+			SEQ_printf(m, " %llu", schedstat_val(p->stats.wait_hist[i]));
+		SEQ_printf(m, "\n");
 		PN_SCHEDSTAT(iowait_sum);
 		P_SCHEDSTAT(iowait_count);
 		P_SCHEDSTAT(nr_migrations_cold);
@@ -1068,6 +1077,11 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 	__P(nr_switches);
 	__PS("nr_voluntary_switches", p->nvcsw);
 	__PS("nr_involuntary_switches", p->nivcsw);
+#ifdef CONFIG_RSEQ
+	P(rseq_slice_granted);
+	P(rseq_slice_yielded);
+	P(rseq_slice_expired);
+#endif
 
 	P(se.load.weight);
 #ifdef CONFIG_SMP
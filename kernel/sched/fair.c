@@ -101,6 +101,14 @@ static unsigned int normalized_sysctl_sched_min_granularity	= 750000ULL;
  */
 unsigned int sysctl_sched_idle_min_granularity			= 750000ULL;
 
+/*
+ * Minimal slice for CFS tasks on batch CPUs, which run with the periodic
+ * tick stopped and rely on the hrtick for preemption.
+ *
+ * (default: 20 msec)
+ */
+unsigned int sysctl_sched_batch_slice			= 20000000ULL;
+
 /*
  * This value is kept at sysctl_sched_latency/sysctl_sched_min_granularity
  */
@@ -776,6 +784,9 @@ static u64 sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		slice = max_t(u64, slice, min_gran);
 	}
 
+	if (sched_batch_rq(rq_of(cfs_rq)))
+		slice = max_t(u64, slice, sysctl_sched_batch_slice);
+
 	return slice;
 }
 
@@ -5002,6 +5013,8 @@ check_preempt_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr)
 	 * very light for example). Therefore impose a maximum.
 	 */
 	ideal_runtime = min_t(u64, sched_slice(cfs_rq, curr), sysctl_sched_latency);
+	if (sched_batch_rq(rq_of(cfs_rq)))
+		ideal_runtime = max_t(u64, ideal_runtime, sysctl_sched_batch_slice);
 
 	delta_exec = curr->sum_exec_runtime - curr->prev_sum_exec_runtime;
 	if (delta_exec > ideal_runtime) {
@@ -6240,7 +6253,8 @@ static void hrtick_update(struct rq *rq)
 	if (!hrtick_enabled_fair(rq) || curr->sched_class != &fair_sched_class)
 		return;
 
-	if (cfs_rq_of(&curr->se)->nr_running < sched_nr_latency)
+	if (cfs_rq_of(&curr->se)->nr_running < sched_nr_latency ||
+	    sched_batch_rq(rq))
 		hrtick_start_fair(rq, curr);
 }
 #else /* !CONFIG_SCHED_HRTICK */
@@ -6298,6 +6312,40 @@ static int sched_idle_cpu(int cpu)
 {
 	return sched_idle_rq(cpu_rq(cpu));
 }
+
+#ifdef CONFIG_PARAVIRT_TIME_ACCOUNTING
+/*
+ * In a guest, rq->avg_irq also tracks the time stolen by the hypervisor (see
+ * update_rq_clock_task()). A vCPU that keeps getting descheduled on the host
+ * may well look idle, yet a task woken onto it will sit waiting for the vCPU
+ * to run again. Treat it as a poor idle candidate while more than a quarter
+ * of its capacity has recently been lost to steal and IRQ time.
+ */
+static inline bool cpu_steal_heavy(int cpu)
+{
+	if (!sched_feat(SIS_STEAL) ||
+	    !static_key_false(&paravirt_steal_rq_enabled))
+		return false;
+
+	return 4 * READ_ONCE(cpu_rq(cpu)->avg_irq.util_avg) >
+	       arch_scale_cpu_capacity(cpu);
+}
+#else
+static inline bool cpu_steal_heavy(int cpu)
+{
+	return false;
+}
+#endif
+
+/*
+ * Idle, or running only SCHED_IDLE tasks, and not losing most of its time to
+ * the hypervisor: a good target for a waking task.
+ */
+static inline bool sis_idle_cpu(int cpu)
+{
+	return (available_idle_cpu(cpu) || sched_idle_cpu(cpu)) &&
+	       !cpu_steal_heavy(cpu);
+}
 #endif
 
 /*
@@ -6819,8 +6867,7 @@ static inline int find_idlest_cpu(struct sched_domain *sd, struct task_struct *p
 
 static inline int __select_idle_cpu(int cpu, struct task_struct *p)
 {
-	if ((available_idle_cpu(cpu) || sched_idle_cpu(cpu)) &&
-	    sched_cpu_cookie_match(cpu_rq(cpu), p))
+	if (sis_idle_cpu(cpu) && sched_cpu_cookie_match(cpu_rq(cpu), p))
 		return cpu;
 
 	return -1;
@@ -6922,7 +6969,7 @@ static int select_idle_smt(struct task_struct *p, int target)
 	for_each_cpu_and(cpu, cpu_smt_mask(target), p->cpus_ptr) {
 		if (cpu == target)
 			continue;
-		if (available_idle_cpu(cpu) || sched_idle_cpu(cpu))
+		if (sis_idle_cpu(cpu))
 			return cpu;
 	}
 
@@ -6952,6 +6999,34 @@ static inline int select_idle_smt(struct task_struct *p, int target)
 
 #endif /* CONFIG_SCHED_SMT */
 
+/*
+ * Track the idle CPUs of each LLC in sd_llc_shared->icpus, so select_idle_cpu()
+ * only has to look at CPUs that are likely idle instead of the whole LLC. The
+ * bit is only written when it changes, to not bounce the cacheline on every
+ * idle entry and exit of a busy CPU.
+ */
+void update_idle_cpumask(int cpu, bool idle)
+{
+	struct sched_domain_shared *sds;
+	struct cpumask *icpus;
+
+	if (!sched_feat(SIS_FILTER))
+		return;
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (sds) {
+		icpus = to_cpumask(sds->icpus);
+		if (cpumask_test_cpu(cpu, icpus) != idle) {
+			if (idle)
+				cpumask_set_cpu(cpu, icpus);
+			else
+				cpumask_clear_cpu(cpu, icpus);
+		}
+	}
+	rcu_read_unlock();
+}
+
 /*
  * Scan the LLC domain for idle CPUs; this is dynamically regulated by
  * comparing the average scan cost (tracked in sd->avg_scan_cost) against the
@@ -6969,6 +7044,13 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 
 	cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
 
+	if (sched_feat(SIS_FILTER)) {
+		sd_share = rcu_dereference(per_cpu(sd_llc_shared, target));
+		if (sd_share)
+			cpumask_and(cpus, cpus, to_cpumask(sd_share->icpus));
+	}
+	schedstat_inc(this_rq->sis_search);
+
 	if (sched_feat(SIS_PROP) && !has_idle_core) {
 		u64 avg_cost, avg_idle, span_avg;
 		unsigned long now = jiffies;
@@ -7013,10 +7095,13 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 	}
 
 	for_each_cpu_wrap(cpu, cpus, target + 1) {
+		schedstat_inc(this_rq->sis_scanned);
 		if (has_idle_core) {
 			i = select_idle_core(p, cpu, cpus, &idle_cpu);
-			if ((unsigned int)i < nr_cpumask_bits)
+			if ((unsigned int)i < nr_cpumask_bits) {
+				schedstat_inc(this_rq->sis_found);
 				return i;
+			}
 
 		} else {
 			if (!--nr)
@@ -7042,6 +7127,8 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 		update_avg(&this_sd->avg_scan_cost, time);
 	}
 
+	if ((unsigned int)idle_cpu < nr_cpumask_bits)
+		schedstat_inc(this_rq->sis_found);
 	return idle_cpu;
 }
 
@@ -7139,7 +7226,7 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	 */
 	lockdep_assert_irqs_disabled();
 
-	if ((available_idle_cpu(target) || sched_idle_cpu(target)) &&
+	if (sis_idle_cpu(target) &&
 	    asym_fits_cpu(task_util, util_min, util_max, target))
 		return target;
 
@@ -7147,7 +7234,7 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	 * If the previous CPU is cache affine and idle, don't be stupid:
 	 */
 	if (prev != target && cpus_share_cache(prev, target) &&
-	    (available_idle_cpu(prev) || sched_idle_cpu(prev)) &&
+	    sis_idle_cpu(prev) &&
 	    asym_fits_cpu(task_util, util_min, util_max, prev))
 		return prev;
 
@@ -7173,7 +7260,7 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	if (recent_used_cpu != prev &&
 	    recent_used_cpu != target &&
 	    cpus_share_cache(recent_used_cpu, target) &&
-	    (available_idle_cpu(recent_used_cpu) || sched_idle_cpu(recent_used_cpu)) &&
+	    sis_idle_cpu(recent_used_cpu) &&
 	    cpumask_test_cpu(p->recent_used_cpu, p->cpus_ptr) &&
 	    asym_fits_cpu(task_util, util_min, util_max, recent_used_cpu)) {
 		return recent_used_cpu;
@@ -8478,6 +8565,7 @@ struct lb_env {
  */
 static int task_hot(struct task_struct *p, struct lb_env *env)
 {
+	unsigned int migration_cost;
 	s64 delta;
 
 	lockdep_assert_rq_held(env->src_rq);
@@ -8500,7 +8588,10 @@ static int task_hot(struct task_struct *p, struct lb_env *env)
 			 &p->se == cfs_rq_of(&p->se)->last))
 		return 1;
 
-	if (sysctl_sched_migration_cost == -1)
+	migration_cost = READ_ONCE(env->sd->migration_cost) ?:
+			 sysctl_sched_migration_cost;
+
+	if (migration_cost == -1)
 		return 1;
 
 	/*
@@ -8510,12 +8601,12 @@ static int task_hot(struct task_struct *p, struct lb_env *env)
 	if (!sched_core_cookie_match(cpu_rq(env->dst_cpu), p))
 		return 1;
 
-	if (sysctl_sched_migration_cost == 0)
+	if (migration_cost == 0)
 		return 0;
 
 	delta = rq_clock_task(env->src_rq) - p->se.exec_start;
 
-	return delta < (s64)sysctl_sched_migration_cost;
+	return delta < (s64)migration_cost;
 }
 
 #ifdef CONFIG_NUMA_BALANCING
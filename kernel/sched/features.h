@@ -62,6 +62,15 @@ SCHED_FEAT(TTWU_QUEUE, true)
  */
 SCHED_FEAT(SIS_PROP, false)
 SCHED_FEAT(SIS_UTIL, true)
+/*
+ * Only scan the CPUs of the LLC that were recently seen going idle, rather
+ * than the whole domain span.
+ */
+SCHED_FEAT(SIS_FILTER, true)
+/*
+ * In guests, don't pick vCPUs with heavy recent steal time as idle targets.
+ */
+SCHED_FEAT(SIS_STEAL, true)
 
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
@@ -407,10 +407,12 @@ static void check_preempt_curr_idle(struct rq *rq, struct task_struct *p, int fl
 
 static void put_prev_task_idle(struct rq *rq, struct task_struct *prev)
 {
+	update_idle_cpumask(cpu_of(rq), false);
 }
 
 static void set_next_task_idle(struct rq *rq, struct task_struct *next, bool first)
 {
+	update_idle_cpumask(cpu_of(rq), true);
 	update_idle_core(rq);
 	schedstat_inc(rq->sched_goidle);
 }
@@ -307,42 +307,10 @@ static int membarrier_global_expedited(void)
 	return 0;
 }
 
-static int membarrier_private_expedited(int flags, int cpu_id)
+static int membarrier_private_ipi(struct mm_struct *mm, smp_call_func_t ipi_func,
+				  int flags, int cpu_id)
 {
 	cpumask_var_t tmpmask;
-	struct mm_struct *mm = current->mm;
-	smp_call_func_t ipi_func = ipi_mb;
-
-	if (flags == MEMBARRIER_FLAG_SYNC_CORE) {
-		if (!IS_ENABLED(CONFIG_ARCH_HAS_MEMBARRIER_SYNC_CORE))
-			return -EINVAL;
-		if (!(atomic_read(&mm->membarrier_state) &
-		      MEMBARRIER_STATE_PRIVATE_EXPEDITED_SYNC_CORE_READY))
-			return -EPERM;
-		ipi_func = ipi_sync_core;
-	} else if (flags == MEMBARRIER_FLAG_RSEQ) {
-		if (!IS_ENABLED(CONFIG_RSEQ))
-			return -EINVAL;
-		if (!(atomic_read(&mm->membarrier_state) &
-		      MEMBARRIER_STATE_PRIVATE_EXPEDITED_RSEQ_READY))
-			return -EPERM;
-		ipi_func = ipi_rseq;
-	} else {
-		WARN_ON_ONCE(flags);
-		if (!(atomic_read(&mm->membarrier_state) &
-		      MEMBARRIER_STATE_PRIVATE_EXPEDITED_READY))
-			return -EPERM;
-	}
-
-	if (flags != MEMBARRIER_FLAG_SYNC_CORE &&
-	    (atomic_read(&mm->mm_users) == 1 || num_online_cpus() == 1))
-		return 0;
-
-	/*
-	 * Matches memory barriers around rq->curr modification in
-	 * scheduler.
-	 */
-	smp_mb();	/* system call entry is not a mb. */
 
 	if (cpu_id < 0 && !zalloc_cpumask_var(&tmpmask, GFP_KERNEL))
 		return -ENOMEM;
@@ -413,6 +381,87 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 		free_cpumask_var(tmpmask);
 	cpus_read_unlock();
 
+	return 0;
+}
+
+/*
+ * Concurrent MEMBARRIER_CMD_PRIVATE_EXPEDITED callers on one mm would each
+ * send their own IPI round to the same set of CPUs. Instead, serialize the
+ * rounds on @mm->membarrier_mutex and track them with @mm->membarrier_seq in
+ * the style of rcu_seq_snap(): a caller only needs a round that started
+ * after its entry barrier, so one that waited for the mutex while another
+ * round ran can return as soon as a later round has completed.
+ *
+ * The round bumps the sequence and issues smp_mb() before scanning rq->curr,
+ * pairing with the caller's own smp_mb() before it samples the sequence:
+ * either the caller observes the bump, or the scan observes the caller's
+ * prior stores.
+ */
+static int membarrier_private_expedited_shared(struct mm_struct *mm)
+{
+	unsigned long s;
+	int ret = 0;
+
+	s = (READ_ONCE(mm->membarrier_seq) + 3) & ~0x1UL;
+
+	mutex_lock(&mm->membarrier_mutex);
+	if (!ULONG_CMP_GE(mm->membarrier_seq, s)) {
+		WRITE_ONCE(mm->membarrier_seq, mm->membarrier_seq + 1);
+		smp_mb(); /* seq update before the rq->curr scan. */
+		ret = membarrier_private_ipi(mm, ipi_mb, 0, -1);
+		/* A failed round must not satisfy anybody waiting on it. */
+		WRITE_ONCE(mm->membarrier_seq, ret ? mm->membarrier_seq - 1 :
+						     mm->membarrier_seq + 1);
+	}
+	mutex_unlock(&mm->membarrier_mutex);
+
+	return ret;
+}
+
+static int membarrier_private_expedited(int flags, int cpu_id)
+{
+	struct mm_struct *mm = current->mm;
+	smp_call_func_t ipi_func = ipi_mb;
+	int ret;
+
+	if (flags == MEMBARRIER_FLAG_SYNC_CORE) {
+		if (!IS_ENABLED(CONFIG_ARCH_HAS_MEMBARRIER_SYNC_CORE))
+			return -EINVAL;
+		if (!(atomic_read(&mm->membarrier_state) &
+		      MEMBARRIER_STATE_PRIVATE_EXPEDITED_SYNC_CORE_READY))
+			return -EPERM;
+		ipi_func = ipi_sync_core;
+	} else if (flags == MEMBARRIER_FLAG_RSEQ) {
+		if (!IS_ENABLED(CONFIG_RSEQ))
+			return -EINVAL;
+		if (!(atomic_read(&mm->membarrier_state) &
+		      MEMBARRIER_STATE_PRIVATE_EXPEDITED_RSEQ_READY))
+			return -EPERM;
+		ipi_func = ipi_rseq;
+	} else {
+		WARN_ON_ONCE(flags);
+		if (!(atomic_read(&mm->membarrier_state) &
+		      MEMBARRIER_STATE_PRIVATE_EXPEDITED_READY))
+			return -EPERM;
+	}
+
+	if (flags != MEMBARRIER_FLAG_SYNC_CORE &&
+	    (atomic_read(&mm->mm_users) == 1 || num_online_cpus() == 1))
+		return 0;
+
+	/*
+	 * Matches memory barriers around rq->curr modification in
+	 * scheduler.
+	 */
+	smp_mb();	/* system call entry is not a mb. */
+
+	if (!flags && cpu_id < 0)
+		ret = membarrier_private_expedited_shared(mm);
+	else
+		ret = membarrier_private_ipi(mm, ipi_func, flags, cpu_id);
+	if (ret)
+		return ret;
+
 	/*
 	 * Memory barrier on the caller thread _after_ we finished
 	 * waiting for the last IPI. Matches memory barriers around
@@ -153,6 +153,25 @@ static int __init setup_psi(char *str)
 }
 __setup("psi=", setup_psi);
 
+/*
+ * With psi_leaf_only, task state changes are only accounted to the task's
+ * own cgroup and to the system group rather than to every ancestor, which
+ * keeps the scheduler hot path cost independent of the nesting depth. The
+ * pressure of inner cgroups is then folded from their descendants when it
+ * is read, see psi_fold_subtree().
+ */
+static DEFINE_STATIC_KEY_FALSE(psi_leaf_only);
+static bool psi_leaf_only_enable;
+static int __init setup_psi_leaf_only(char *str)
+{
+	psi_leaf_only_enable = true;
+	return 1;
+}
+__setup("psi_leaf_only", setup_psi_leaf_only);
+
+/* Protects the psi_group children lists */
+static DEFINE_MUTEX(psi_tree_mutex);
+
 /* Running averages - we need to be higher-res than loadavg */
 #define PSI_FREQ	(2*HZ+1)	/* 2 sec intervals */
 #define EXP_10s		1677		/* 1/exp(2s/10s) as fixed-point */
@@ -181,6 +200,8 @@ static void group_init(struct psi_group *group)
 	int cpu;
 
 	group->enabled = true;
+	INIT_LIST_HEAD(&group->children);
+	INIT_LIST_HEAD(&group->sibling);
 	for_each_possible_cpu(cpu)
 		seqcount_init(&per_cpu_ptr(group->pcpu, cpu)->seq);
 	group->avg_last_update = sched_clock();
@@ -213,6 +234,8 @@ void __init psi_init(void)
 
 	if (!cgroup_psi_enabled())
 		static_branch_disable(&psi_cgroups_enabled);
+	else if (psi_leaf_only_enable)
+		static_branch_enable(&psi_leaf_only);
 
 	psi_period = jiffies_to_nsecs(PSI_FREQ);
 	group_init(&psi_system);
@@ -388,6 +411,80 @@ static void collect_percpu_times(struct psi_group *group,
 		*pchanged_states = changed_states;
 }
 
+static inline bool psi_group_is_lazy(struct psi_group *group)
+{
+	return static_branch_unlikely(&psi_leaf_only) &&
+	       group != &psi_system && !list_empty(&group->children);
+}
+
+static struct psi_group *psi_leftmost_descendant(struct psi_group *pos)
+{
+	while (!list_empty(&pos->children))
+		pos = list_first_entry(&pos->children, struct psi_group, sibling);
+	return pos;
+}
+
+/* Post-order walk of @root's descendants, ending with @root itself */
+static struct psi_group *psi_next_descendant_post(struct psi_group *pos,
+						  struct psi_group *root)
+{
+	if (!pos)
+		return psi_leftmost_descendant(root);
+	if (pos == root)
+		return NULL;
+	if (!list_is_last(&pos->sibling, &pos->parent->children))
+		return psi_leftmost_descendant(list_next_entry(pos, sibling));
+	return pos->parent;
+}
+
+static void psi_fold_children(struct psi_group *group)
+{
+	struct psi_group *child;
+	int s;
+
+	list_for_each_entry(child, &group->children, sibling) {
+		for (s = 0; s < NR_PSI_STATES - 1; s++)
+			group->total[PSI_AVGS][s] =
+				max(group->total[PSI_AVGS][s],
+				    READ_ONCE(child->total[PSI_AVGS][s]));
+	}
+}
+
+/*
+ * psi_fold_subtree - bring an inner group's totals up to date
+ *
+ * In psi_leaf_only mode nothing accounts to inner groups directly. When
+ * one is read, collect every descendant bottom-up and take the per-state
+ * maximum of the children's cumulative stall times: pressure in any child
+ * is pressure in the parent, while concurrent stalls in several children
+ * only count once. This is a lower bound of what full hierarchical
+ * accounting would report, and exact when stalls don't overlap.
+ *
+ * Called with psi_tree_mutex and @group->avgs_lock held, after @group's
+ * own times were collected.
+ */
+static void psi_fold_subtree(struct psi_group *group)
+{
+	struct psi_group *pos = NULL;
+
+	lockdep_assert_held(&psi_tree_mutex);
+
+	while ((pos = psi_next_descendant_post(pos, group)) != group) {
+		mutex_lock_nested(&pos->avgs_lock, SINGLE_DEPTH_NESTING);
+		collect_percpu_times(pos, PSI_AVGS, NULL);
+		psi_fold_children(pos);
+		mutex_unlock(&pos->avgs_lock);
+	}
+	psi_fold_children(group);
+}
+
+static inline struct psi_group *psi_group_next(struct psi_group *group)
+{
+	if (static_branch_unlikely(&psi_leaf_only))
+		return group == &psi_system ? NULL : &psi_system;
+	return group->parent;
+}
+
 /* Trigger tracking window manipulations */
 static void window_reset(struct psi_window *win, u64 now, u64 value,
 			 u64 prev_growth)
@@ -917,7 +1014,7 @@ void psi_task_change(struct task_struct *task, int clear, int set)
 	group = task_psi_group(task);
 	do {
 		psi_group_change(group, cpu, clear, set, now, true);
-	} while ((group = group->parent));
+	} while ((group = psi_group_next(group)));
 }
 
 void psi_task_switch(struct task_struct *prev, struct task_struct *next,
@@ -943,7 +1040,7 @@ void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 			}
 
 			psi_group_change(group, cpu, 0, TSK_ONCPU, now, true);
-		} while ((group = group->parent));
+		} while ((group = psi_group_next(group)));
 	}
 
 	if (prev->pid) {
@@ -981,7 +1078,7 @@ void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 			if (group == common)
 				break;
 			psi_group_change(group, cpu, clear, set, now, wake_clock);
-		} while ((group = group->parent));
+		} while ((group = psi_group_next(group)));
 
 		/*
 		 * TSK_ONCPU is handled up to the common ancestor. If there are
@@ -991,7 +1088,7 @@ void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 		 */
 		if ((prev->psi_flags ^ next->psi_flags) & ~TSK_ONCPU) {
 			clear &= ~TSK_ONCPU;
-			for (; group; group = group->parent)
+			for (; group; group = psi_group_next(group))
 				psi_group_change(group, cpu, clear, set, now, wake_clock);
 		}
 	}
@@ -1026,7 +1123,7 @@ void psi_account_irqtime(struct task_struct *task, u32 delta)
 
 		if (group->rtpoll_states & (1 << PSI_IRQ_FULL))
 			psi_schedule_rtpoll_work(group, 1, false);
-	} while ((group = group->parent));
+	} while ((group = psi_group_next(group)));
 }
 #endif
 
@@ -1109,6 +1206,11 @@ int psi_cgroup_alloc(struct cgroup *cgroup)
 	}
 	group_init(cgroup->psi);
 	cgroup->psi->parent = cgroup_psi(cgroup_parent(cgroup));
+	if (static_branch_unlikely(&psi_leaf_only)) {
+		mutex_lock(&psi_tree_mutex);
+		list_add_tail(&cgroup->psi->sibling, &cgroup->psi->parent->children);
+		mutex_unlock(&psi_tree_mutex);
+	}
 	return 0;
 }
 
@@ -1117,6 +1219,11 @@ void psi_cgroup_free(struct cgroup *cgroup)
 	if (!static_branch_likely(&psi_cgroups_enabled))
 		return;
 
+	if (static_branch_unlikely(&psi_leaf_only)) {
+		mutex_lock(&psi_tree_mutex);
+		list_del(&cgroup->psi->sibling);
+		mutex_unlock(&psi_tree_mutex);
+	}
 	cancel_delayed_work_sync(&cgroup->psi->avgs_work);
 	free_percpu(cgroup->psi->pcpu);
 	/* All triggers must be removed by now */
@@ -1229,20 +1336,31 @@ void psi_cgroup_restart(struct psi_group *group)
 int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 {
 	bool only_full = false;
+	bool lazy;
 	int full;
 	u64 now;
 
 	if (static_branch_likely(&psi_disabled))
 		return -EOPNOTSUPP;
 
+	/* psi_tree_mutex nests outside of any avgs_lock */
+	lazy = static_branch_unlikely(&psi_leaf_only) && group != &psi_system;
+	if (lazy)
+		mutex_lock(&psi_tree_mutex);
+
 	/* Update averages before reporting them */
 	mutex_lock(&group->avgs_lock);
 	now = sched_clock();
 	collect_percpu_times(group, PSI_AVGS, NULL);
+	if (lazy && psi_group_is_lazy(group))
+		psi_fold_subtree(group);
 	if (now >= group->avg_next_update)
 		group->avg_next_update = update_averages(group, now);
 	mutex_unlock(&group->avgs_lock);
 
+	if (lazy)
+		mutex_unlock(&psi_tree_mutex);
+
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
 	only_full = res == PSI_IRQ;
 #endif
@@ -1283,6 +1401,20 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group,
 	if (static_branch_likely(&psi_disabled))
 		return ERR_PTR(-EOPNOTSUPP);
 
+	/*
+	 * Inner groups are only updated when read in psi_leaf_only mode, so
+	 * there are no state changes or periodic samples to fire triggers.
+	 */
+	if (static_branch_unlikely(&psi_leaf_only)) {
+		bool inner;
+
+		mutex_lock(&psi_tree_mutex);
+		inner = psi_group_is_lazy(group);
+		mutex_unlock(&psi_tree_mutex);
+		if (inner)
+			return ERR_PTR(-EOPNOTSUPP);
+	}
+
 	/*
 	 * Checking the privilege here on file->f_cred implies that a privileged user
 	 * could open the file and delegate the write to an unprivileged one.
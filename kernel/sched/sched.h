@@ -31,6 +31,7 @@
 #include <linux/cpufreq.h>
 #include <linux/cpumask_api.h>
 #include <linux/ctype.h>
+#include <linux/delayacct.h>
 #include <linux/file.h>
 #include <linux/fs_api.h>
 #include <linux/hrtimer_api.h>
@@ -319,6 +320,12 @@ extern void init_dl_bw(struct dl_bw *dl_b);
 extern int  sched_dl_global_validate(void);
 extern void sched_dl_do_global(void);
 extern int  sched_dl_overflow(struct task_struct *p, int policy, const struct sched_attr *attr);
+#ifdef CONFIG_CGROUP_SCHED
+extern int  dl_tg_set_bandwidth(struct task_group *tg, u64 runtime, u64 period);
+extern int  dl_tg_can_attach(struct task_group *tg, struct task_struct *p);
+extern void dl_tg_move_task(struct task_struct *p, struct task_group *from,
+			    struct task_group *to);
+#endif
 extern void __setparam_dl(struct task_struct *p, const struct sched_attr *attr);
 extern void __getparam_dl(struct task_struct *p, struct sched_attr *attr);
 extern bool __checkparam_dl(const struct sched_attr *attr);
@@ -390,6 +397,12 @@ struct task_group {
 	struct rt_bandwidth	rt_bandwidth;
 #endif
 
+	/* SCHED_DEADLINE reservation, protected by dl_tg_lock */
+	u64			dl_runtime;
+	u64			dl_period;
+	u64			dl_bw;
+	u64			dl_usage;
+
 	struct rcu_head		rcu;
 	struct list_head	list;
 
@@ -977,6 +990,10 @@ struct rq {
 	unsigned int		nohz_tick_stopped;
 	atomic_t		nohz_flags;
 #endif /* CONFIG_NO_HZ_COMMON */
+#ifdef CONFIG_NO_HZ_FULL
+	/* nohz_full CPU in a cpuset with sched_batch set: */
+	unsigned int		batch_cpu;
+#endif
 
 #ifdef CONFIG_SMP
 	unsigned int		ttwu_pending;
@@ -1107,6 +1124,11 @@ struct rq {
 	ktime_t 		hrtick_time;
 #endif
 
+#ifdef CONFIG_RSEQ
+	/* Bounds the rseq time slice extension of curr */
+	struct hrtimer		rseq_slice_timer;
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	/* latency stats */
 	struct sched_info	rq_sched_info;
@@ -1123,6 +1145,11 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int		ttwu_count;
 	unsigned int		ttwu_local;
+
+	/* select_idle_cpu() stats */
+	unsigned int		sis_search;
+	unsigned int		sis_scanned;
+	unsigned int		sis_found;
 #endif
 
 #ifdef CONFIG_CPU_IDLE
@@ -1397,6 +1424,12 @@ do {						\
 	flags = _raw_spin_rq_lock_irqsave(rq);	\
 } while (0)
 
+#ifdef CONFIG_SMP
+extern void update_idle_cpumask(int cpu, bool idle);
+#else
+static inline void update_idle_cpumask(int cpu, bool idle) { }
+#endif
+
 #ifdef CONFIG_SCHED_SMT
 extern void __update_idle_core(struct rq *rq);
 
@@ -2450,9 +2483,15 @@ static inline void sched_update_tick_dependency(struct rq *rq)
 	else
 		tick_nohz_dep_set_cpu(cpu, TICK_DEP_BIT_SCHED);
 }
+
+static inline bool sched_batch_rq(struct rq *rq)
+{
+	return READ_ONCE(rq->batch_cpu);
+}
 #else
 static inline int sched_tick_offload_init(void) { return 0; }
 static inline void sched_update_tick_dependency(struct rq *rq) { }
+static inline bool sched_batch_rq(struct rq *rq) { return false; }
 #endif
 
 static inline void add_nr_running(struct rq *rq, unsigned count)
@@ -2503,6 +2542,7 @@ extern const_debug unsigned int sysctl_sched_migration_cost;
 extern unsigned int sysctl_sched_latency;
 extern unsigned int sysctl_sched_min_granularity;
 extern unsigned int sysctl_sched_idle_min_granularity;
+extern unsigned int sysctl_sched_batch_slice;
 extern unsigned int sysctl_sched_wakeup_granularity;
 extern int sysctl_resched_latency_warn_ms;
 extern int sysctl_resched_latency_warn_once;
@@ -2532,7 +2572,8 @@ static inline int hrtick_enabled(struct rq *rq)
 
 static inline int hrtick_enabled_fair(struct rq *rq)
 {
-	if (!sched_feat(HRTICK))
+	/* Batch CPUs rely on the hrtick to end slices with the tick stopped */
+	if (!sched_feat(HRTICK) && !sched_batch_rq(rq))
 		return 0;
 	return hrtick_enabled(rq);
 }
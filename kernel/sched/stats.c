@@ -42,6 +42,9 @@ void __update_stats_wait_end(struct rq *rq, struct task_struct *p,
 	__schedstat_inc(stats->wait_count);
 	__schedstat_add(stats->wait_sum, delta);
 	__schedstat_set(stats->wait_start, 0);
+	/* ns >> 10 is close enough to usecs for a log2 histogram */
+	__schedstat_inc(stats->wait_hist[min_t(int, fls64(delta >> 10),
+					       SCHED_WAIT_HIST_NR - 1)]);
 }
 
 void __update_stats_enqueue_sleeper(struct rq *rq, struct task_struct *p,
@@ -113,7 +116,7 @@ void __update_stats_enqueue_sleeper(struct rq *rq, struct task_struct *p,
  * Bump this up when changing the output format or the meaning of an existing
  * format, so that tools can adapt (or abort)
  */
-#define SCHEDSTAT_VERSION 15
+#define SCHEDSTAT_VERSION 16
 
 static int show_schedstat(struct seq_file *seq, void *v)
 {
@@ -133,12 +136,13 @@ static int show_schedstat(struct seq_file *seq, void *v)
 
 		/* runqueue-specific stats */
 		seq_printf(seq,
-		    "cpu%d %u 0 %u %u %u %u %llu %llu %lu",
+		    "cpu%d %u 0 %u %u %u %u %llu %llu %lu %u %u %u",
 		    cpu, rq->yld_count,
 		    rq->sched_count, rq->sched_goidle,
 		    rq->ttwu_count, rq->ttwu_local,
 		    rq->rq_cpu_time,
-		    rq->rq_sched_info.run_delay, rq->rq_sched_info.pcount);
+		    rq->rq_sched_info.run_delay, rq->rq_sched_info.pcount,
+		    rq->sis_search, rq->sis_scanned, rq->sis_found);
 
 		seq_printf(seq, "\n");
 
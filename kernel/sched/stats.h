@@ -236,6 +236,7 @@ static void sched_info_arrive(struct rq *rq, struct task_struct *t)
 	t->sched_info.pcount++;
 
 	rq_sched_info_arrive(rq, delta);
+	delayacct_cpu_wait(t, delta);
 }
 
 /*
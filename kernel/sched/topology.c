@@ -1575,6 +1575,7 @@ sd_init(struct sched_domain_topology_level *tl,
 		.imbalance_pct		= 117,
 
 		.cache_nice_tries	= 0,
+		.migration_cost		= tl->migration_cost,
 
 		.flags			= 1*SD_BALANCE_NEWIDLE
 					| 1*SD_BALANCE_EXEC
@@ -1648,6 +1649,9 @@ sd_init(struct sched_domain_topology_level *tl,
 		sd->shared = *per_cpu_ptr(sdd->sds, sd_id);
 		atomic_inc(&sd->shared->ref);
 		atomic_set(&sd->shared->nr_busy_cpus, sd_weight);
+		/* CPUs that are idle right now won't report idle entry */
+		cpumask_copy(to_cpumask(sd->shared->icpus),
+			     sched_domain_span(sd));
 	}
 
 	sd->private = sdd;
@@ -2206,8 +2210,8 @@ static int __sdt_alloc(const struct cpumask *cpu_map)
 
 			*per_cpu_ptr(sdd->sd, j) = sd;
 
-			sds = kzalloc_node(sizeof(struct sched_domain_shared),
-					GFP_KERNEL, cpu_to_node(j));
+			sds = kzalloc_node(sizeof(struct sched_domain_shared) +
+					cpumask_size(), GFP_KERNEL, cpu_to_node(j));
 			if (!sds)
 				return -ENOMEM;
 
@@ -2606,6 +2610,38 @@ static int dattrs_equal(struct sched_domain_attr *cur, int idx_cur,
 			sizeof(struct sched_domain_attr));
 }
 
+/*
+ * Check whether doms_new[] describes the current partitioning. The masks
+ * of a partitioning don't overlap, so finding each new mask among the
+ * current ones is enough.
+ */
+static bool doms_unchanged(int ndoms_new, cpumask_var_t doms_new[],
+			   struct sched_domain_attr *dattr_new)
+{
+	int i, j;
+
+	if (ndoms_new != ndoms_cur)
+		return false;
+
+#if defined(CONFIG_ENERGY_MODEL) && defined(CONFIG_CPU_FREQ_GOV_SCHEDUTIL)
+	if (sched_energy_update)
+		return false;
+#endif
+
+	for (i = 0; i < ndoms_new; i++) {
+		for (j = 0; j < ndoms_cur; j++) {
+			if (cpumask_equal(doms_new[i], doms_cur[j]) &&
+			    dattrs_equal(dattr_new, i, dattr_cur, j))
+				goto match;
+		}
+		return false;
+match:
+		;
+	}
+
+	return true;
+}
+
 /*
  * Partition sched domains as specified by the 'ndoms_new'
  * cpumasks in the array doms_new[] of cpumasks. This compares
@@ -2630,9 +2666,12 @@ static int dattrs_equal(struct sched_domain_attr *cur, int idx_cur,
  * ndoms_new == 0 is a special case for destroying existing domains,
  * and it will not create the default domain.
  *
+ * Returns false if the partitioning was left unchanged, in which case
+ * no root domain was touched either.
+ *
  * Call with hotplug lock and sched_domains_mutex held
  */
-void partition_sched_domains_locked(int ndoms_new, cpumask_var_t doms_new[],
+bool partition_sched_domains_locked(int ndoms_new, cpumask_var_t doms_new[],
 				    struct sched_domain_attr *dattr_new)
 {
 	bool __maybe_unused has_eas = false;
@@ -2660,6 +2699,14 @@ void partition_sched_domains_locked(int ndoms_new, cpumask_var_t doms_new[],
 		n = ndoms_new;
 	}
 
+	/* Nothing to do, e.g. cpuset changes that didn't affect balancing: */
+	if (doms_new && !new_topology &&
+	    doms_unchanged(n, doms_new, dattr_new)) {
+		free_sched_domains(doms_new, n);
+		kfree(dattr_new);
+		return false;
+	}
+
 	/* Destroy deleted domains: */
 	for (i = 0; i < ndoms_cur; i++) {
 		for (j = 0; j < n && !new_topology; j++) {
@@ -2733,6 +2780,8 @@ void partition_sched_domains_locked(int ndoms_new, cpumask_var_t doms_new[],
 	ndoms_cur = ndoms_new;
 
 	update_sched_domain_debugfs();
+
+	return true;
 }
 
 /*
@@ -25,6 +25,8 @@
 #include <linux/nmi.h>
 #include <linux/sched/debug.h>
 #include <linux/jump_label.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <trace/events/ipi.h>
 #define CREATE_TRACE_POINTS
@@ -44,10 +46,57 @@ struct call_function_data {
 
 static DEFINE_PER_CPU_ALIGNED(struct call_function_data, cfd_data);
 
+#define SMP_CALL_BATCH_MAX	8
+
+struct smp_call_batch {
+	bool			active;
+	unsigned int		nr;
+	cpumask_var_t		cpumask;	/* union of @masks */
+	cpumask_var_t		masks[SMP_CALL_BATCH_MAX];
+	smp_call_func_t		funcs[SMP_CALL_BATCH_MAX];
+	void			*infos[SMP_CALL_BATCH_MAX];
+
+	unsigned long		nr_batches;
+	unsigned long		nr_calls;
+	unsigned long		nr_ipis_saved;
+};
+
+static DEFINE_PER_CPU(struct smp_call_batch, cfd_batch);
+
 static DEFINE_PER_CPU_SHARED_ALIGNED(struct llist_head, call_single_queue);
 
 static void __flush_smp_call_function_queue(bool warn_cpu_offline);
 
+static void free_call_batch(unsigned int cpu)
+{
+	struct smp_call_batch *batch = &per_cpu(cfd_batch, cpu);
+	int i;
+
+	free_cpumask_var(batch->cpumask);
+	for (i = 0; i < SMP_CALL_BATCH_MAX; i++)
+		free_cpumask_var(batch->masks[i]);
+}
+
+static int alloc_call_batch(unsigned int cpu)
+{
+	struct smp_call_batch *batch = &per_cpu(cfd_batch, cpu);
+	int i;
+
+	if (!zalloc_cpumask_var_node(&batch->cpumask, GFP_KERNEL,
+				     cpu_to_node(cpu)))
+		goto fail;
+	for (i = 0; i < SMP_CALL_BATCH_MAX; i++) {
+		if (!zalloc_cpumask_var_node(&batch->masks[i], GFP_KERNEL,
+					     cpu_to_node(cpu)))
+			goto fail;
+	}
+	return 0;
+
+fail:
+	free_call_batch(cpu);
+	return -ENOMEM;
+}
+
 int smpcfd_prepare_cpu(unsigned int cpu)
 {
 	struct call_function_data *cfd = &per_cpu(cfd_data, cpu);
@@ -66,6 +115,12 @@ int smpcfd_prepare_cpu(unsigned int cpu)
 		free_cpumask_var(cfd->cpumask_ipi);
 		return -ENOMEM;
 	}
+	if (alloc_call_batch(cpu)) {
+		free_cpumask_var(cfd->cpumask);
+		free_cpumask_var(cfd->cpumask_ipi);
+		free_percpu(cfd->csd);
+		return -ENOMEM;
+	}
 
 	return 0;
 }
@@ -77,6 +132,7 @@ int smpcfd_dead_cpu(unsigned int cpu)
 	free_cpumask_var(cfd->cpumask);
 	free_cpumask_var(cfd->cpumask_ipi);
 	free_percpu(cfd->csd);
+	free_call_batch(cpu);
 	return 0;
 }
 
@@ -883,6 +939,144 @@ void smp_call_function(smp_call_func_t func, void *info, int wait)
 }
 EXPORT_SYMBOL(smp_call_function);
 
+/*
+ * Batched cross calls
+ *
+ * Callers that issue several cross calls in a row can collect them between
+ * smp_call_batch_begin() and smp_call_batch_end(). The calls are sent as one
+ * smp_call_function_many() to the union of their masks, so every target CPU
+ * takes one IPI and then runs the functions it was asked to in order.
+ */
+static void smp_call_batch_func(void *info)
+{
+	struct smp_call_batch *batch = info;
+	int cpu = smp_processor_id();
+	unsigned int i;
+
+	for (i = 0; i < batch->nr; i++) {
+		if (cpumask_test_cpu(cpu, batch->masks[i]))
+			batch->funcs[i](batch->infos[i]);
+	}
+}
+
+static void smp_call_batch_flush(struct smp_call_batch *batch)
+{
+	unsigned int i, nr_ipis = 0;
+
+	if (!batch->nr)
+		return;
+
+	for (i = 0; i < batch->nr; i++)
+		nr_ipis += cpumask_weight(batch->masks[i]);
+	batch->nr_ipis_saved += nr_ipis - cpumask_weight(batch->cpumask);
+	batch->nr_batches++;
+
+	/* The batch is reused right after, so we have to wait */
+	smp_call_function_many_cond(batch->cpumask, smp_call_batch_func, batch,
+				    SCF_WAIT, NULL);
+
+	batch->nr = 0;
+	cpumask_clear(batch->cpumask);
+}
+
+/**
+ * smp_call_batch_begin(): Start collecting cross calls on this CPU.
+ *
+ * Disables preemption until smp_call_batch_end(). Batches don't nest.
+ */
+void smp_call_batch_begin(void)
+{
+	struct smp_call_batch *batch;
+
+	preempt_disable();
+	batch = this_cpu_ptr(&cfd_batch);
+	WARN_ON_ONCE(batch->active);
+	batch->active = true;
+}
+EXPORT_SYMBOL_GPL(smp_call_batch_begin);
+
+/**
+ * smp_call_batch_add(): Add a cross call to the current batch.
+ * @mask: The set of cpus to run on (only runs on the online subset, never
+ *        on the calling CPU).
+ * @func: The function to run. This must be fast and non-blocking.
+ * @info: An arbitrary pointer to pass to the function.
+ *
+ * @func runs by smp_call_batch_end() at the latest, possibly earlier if the
+ * batch fills up. @info must stay valid until then.
+ */
+void smp_call_batch_add(const struct cpumask *mask,
+			smp_call_func_t func, void *info)
+{
+	struct smp_call_batch *batch = this_cpu_ptr(&cfd_batch);
+	struct cpumask *cpus;
+
+	lockdep_assert_preemption_disabled();
+	if (WARN_ON_ONCE(!batch->active))
+		return;
+
+	if (batch->nr == SMP_CALL_BATCH_MAX)
+		smp_call_batch_flush(batch);
+
+	cpus = batch->masks[batch->nr];
+	cpumask_and(cpus, mask, cpu_online_mask);
+	__cpumask_clear_cpu(smp_processor_id(), cpus);
+	if (cpumask_empty(cpus))
+		return;
+
+	cpumask_or(batch->cpumask, batch->cpumask, cpus);
+	batch->funcs[batch->nr] = func;
+	batch->infos[batch->nr] = info;
+	batch->nr++;
+	batch->nr_calls++;
+}
+EXPORT_SYMBOL_GPL(smp_call_batch_add);
+
+/**
+ * smp_call_batch_end(): Run the collected cross calls and wait for them.
+ *
+ * Same context rules as smp_call_function_many().
+ */
+void smp_call_batch_end(void)
+{
+	struct smp_call_batch *batch = this_cpu_ptr(&cfd_batch);
+
+	smp_call_batch_flush(batch);
+	batch->active = false;
+	preempt_enable();
+}
+EXPORT_SYMBOL_GPL(smp_call_batch_end);
+
+#ifdef CONFIG_DEBUG_FS
+static int smp_call_batch_show(struct seq_file *m, void *v)
+{
+	unsigned long batches = 0, calls = 0, saved = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct smp_call_batch *batch = &per_cpu(cfd_batch, cpu);
+
+		batches += READ_ONCE(batch->nr_batches);
+		calls += READ_ONCE(batch->nr_calls);
+		saved += READ_ONCE(batch->nr_ipis_saved);
+	}
+
+	seq_printf(m, "batches %lu\n", batches);
+	seq_printf(m, "calls %lu\n", calls);
+	seq_printf(m, "ipis_saved %lu\n", saved);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(smp_call_batch);
+
+static int __init smp_call_batch_debugfs_init(void)
+{
+	debugfs_create_file("smp_call_batch", 0444, NULL, NULL,
+			    &smp_call_batch_fops);
+	return 0;
+}
+late_initcall(smp_call_batch_debugfs_init);
+#endif
+
 /* Setup configured maximum number of CPUs to activate */
 unsigned int setup_max_cpus = NR_CPUS;
 EXPORT_SYMBOL(setup_max_cpus);
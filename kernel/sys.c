@@ -17,6 +17,7 @@
 #include <linux/kmod.h>
 #include <linux/ksm.h>
 #include <linux/perf_event.h>
+#include <linux/pm_qos.h>
 #include <linux/resource.h>
 #include <linux/kernel.h>
 #include <linux/workqueue.h>
@@ -2720,6 +2721,18 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 	case PR_RISCV_V_GET_CONTROL:
 		error = RISCV_V_GET_CONTROL();
 		break;
+#ifdef CONFIG_CPU_IDLE
+	case PR_SET_WAKEUP_LATENCY:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = task_latency_qos_set(arg2);
+		break;
+	case PR_GET_WAKEUP_LATENCY:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = current->wakeup_latency_qos;
+		break;
+#endif
 	default:
 		error = -EINVAL;
 		break;
@@ -111,6 +111,7 @@ COND_SYSCALL(mq_timedsend);
 COND_SYSCALL(mq_timedsend_time32);
 COND_SYSCALL(mq_timedreceive);
 COND_SYSCALL(mq_timedreceive_time32);
+COND_SYSCALL(mq_timedreceivev);
 COND_SYSCALL(mq_notify);
 COND_SYSCALL_COMPAT(mq_notify);
 COND_SYSCALL(mq_getsetattr);
@@ -372,3 +373,6 @@ COND_SYSCALL(setuid16);
 
 /* restartable sequence */
 COND_SYSCALL(rseq);
+
+/* kernel/entry/syscall_batch.c */
+COND_SYSCALL(syscall_batch);
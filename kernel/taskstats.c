@@ -454,6 +454,61 @@ static int cgroupstats_user_cmd(struct sk_buff *skb, struct genl_info *info)
 	return rc;
 }
 
+#ifdef CONFIG_CGROUPS
+/*
+ * Dump the delays of all cgroups on the default hierarchy, one message per
+ * cgroup. cb->args[0] counts the cgroups already visited, so the walk may
+ * miss or repeat cgroups created or removed between two rounds.
+ */
+static int cgroupstats_delays_dumpit(struct sk_buff *skb,
+				     struct netlink_callback *cb)
+{
+	struct cgroup_subsys_state *css;
+	struct cgroup_delaystats *stats;
+	long idx = 0, start = cb->args[0];
+
+	stats = kmalloc(sizeof(*stats), GFP_KERNEL);
+	if (!stats)
+		return -ENOMEM;
+
+	rcu_read_lock();
+	css_for_each_descendant_pre(css, &cgrp_dfl_root.cgrp.self) {
+		struct nlattr *na;
+		void *hdr;
+
+		if (idx++ < start)
+			continue;
+
+		if (!delayacct_cgroup_read(css->cgroup, stats))
+			continue;
+
+		hdr = genlmsg_put(skb, NETLINK_CB(cb->skb).portid,
+				  cb->nlh->nlmsg_seq, &family, NLM_F_MULTI,
+				  CGROUPSTATS_CMD_GET_DELAYS);
+		if (!hdr) {
+			idx--;
+			break;
+		}
+
+		na = nla_reserve(skb, CGROUPSTATS_TYPE_CGROUP_DELAYS,
+				 sizeof(*stats));
+		if (!na) {
+			genlmsg_cancel(skb, hdr);
+			idx--;
+			break;
+		}
+		memcpy(nla_data(na), stats, sizeof(*stats));
+		genlmsg_end(skb, hdr);
+	}
+	rcu_read_unlock();
+
+	cb->args[0] = idx;
+	kfree(stats);
+
+	return skb->len;
+}
+#endif
+
 static int cmd_attr_register_cpumask(struct genl_info *info)
 {
 	cpumask_var_t mask;
@@ -680,6 +735,13 @@ static const struct genl_ops taskstats_ops[] = {
 		.policy		= cgroupstats_cmd_get_policy,
 		.maxattr	= ARRAY_SIZE(cgroupstats_cmd_get_policy) - 1,
 	},
+#ifdef CONFIG_CGROUPS
+	{
+		.cmd		= CGROUPSTATS_CMD_GET_DELAYS,
+		.dumpit		= cgroupstats_delays_dumpit,
+		.flags		= GENL_ADMIN_PERM,
+	},
+#endif
 };
 
 static struct genl_family family __ro_after_init = {
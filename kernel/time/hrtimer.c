@@ -38,6 +38,7 @@
 #include <linux/sched/deadline.h>
 #include <linux/sched/nohz.h>
 #include <linux/sched/debug.h>
+#include <linux/sched/isolation.h>
 #include <linux/timer.h>
 #include <linux/freezer.h>
 #include <linux/compat.h>
@@ -199,20 +200,108 @@ hrtimer_check_target(struct hrtimer *timer, struct hrtimer_clock_base *new_base)
 	return expires < new_base->cpu_base->expires_next;
 }
 
+/*
+ * Timer coalescing: timers which tolerate at least hrtimer_coalesce_slack_ns
+ * of slack are queued on the base of hrtimer_coalesce_cpu instead of the
+ * local or nohz target one. hrtimer_interrupt() expires all timers whose
+ * soft expiry time has passed, so on a box with many sleepers with similar
+ * deadlines they get fired in batches by one housekeeping CPU instead of
+ * each raising an interrupt on its own CPU, which lets idle CPUs stay in
+ * deep idle states.
+ *
+ * Disabled when hrtimer_coalesce_cpu is -1.
+ */
+static int hrtimer_coalesce_cpu __read_mostly = -1;
+static unsigned int hrtimer_coalesce_slack_ns __read_mostly = 50 * NSEC_PER_USEC;
+
+static int hrtimer_coalesce_target(struct hrtimer *timer)
+{
+	int cpu = READ_ONCE(hrtimer_coalesce_cpu);
+	s64 slack;
+
+	if (cpu < 0 || !cpu_active(cpu))
+		return -1;
+
+	slack = hrtimer_get_expires_tv64(timer) - hrtimer_get_softexpires_tv64(timer);
+	if (slack < READ_ONCE(hrtimer_coalesce_slack_ns))
+		return -1;
+
+	return cpu;
+}
+
+#ifdef CONFIG_SYSCTL
+static int hrtimer_coalesce_cpu_handler(struct ctl_table *table, int write,
+					void *buffer, size_t *lenp, loff_t *ppos)
+{
+	int max_cpu = nr_cpu_ids - 1;
+	int cpu = hrtimer_coalesce_cpu;
+	struct ctl_table t = {
+		.data	= &cpu,
+		.maxlen	= sizeof(cpu),
+		.extra1	= SYSCTL_NEG_ONE,
+		.extra2	= &max_cpu,
+	};
+	int ret;
+
+	ret = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
+	if (ret || !write)
+		return ret;
+
+	if (cpu >= 0 && !housekeeping_cpu(cpu, HK_TYPE_TIMER))
+		return -EINVAL;
+
+	WRITE_ONCE(hrtimer_coalesce_cpu, cpu);
+	return 0;
+}
+
+static struct ctl_table hrtimer_sysctl[] = {
+	{
+		.procname	= "hrtimer_coalesce_cpu",
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= hrtimer_coalesce_cpu_handler,
+	},
+	{
+		.procname	= "hrtimer_coalesce_slack_ns",
+		.data		= &hrtimer_coalesce_slack_ns,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
+	{}
+};
+
+static int __init hrtimer_sysctl_init(void)
+{
+	register_sysctl("kernel", hrtimer_sysctl);
+	return 0;
+}
+device_initcall(hrtimer_sysctl_init);
+#endif /* CONFIG_SYSCTL */
+
 static inline
 struct hrtimer_cpu_base *get_target_base(struct hrtimer_cpu_base *base,
-					 int pinned)
+					 struct hrtimer *timer, int pinned)
 {
-#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
-	if (static_branch_likely(&timers_migration_enabled) && !pinned)
+	int cpu;
+
+	if (pinned)
+		return base;
+
+	cpu = hrtimer_coalesce_target(timer);
+	if (cpu >= 0)
+		return &per_cpu(hrtimer_bases, cpu);
+
+#ifdef CONFIG_NO_HZ_COMMON
+	if (static_branch_likely(&timers_migration_enabled))
 		return &per_cpu(hrtimer_bases, get_nohz_timer_target());
 #endif
 	return base;
 }
 
 /*
- * We switch the timer base to a power-optimized selected CPU target,
- * if:
+ * We switch the timer base to the coalescing CPU for slack tolerant
+ * timers, or to a power-optimized selected CPU target, if:
  *	- NO_HZ_COMMON is enabled
  *	- timer migration is enabled
  *	- the timer callback is not running
@@ -231,7 +320,7 @@ switch_hrtimer_base(struct hrtimer *timer, struct hrtimer_clock_base *base,
 	int basenum = base->index;
 
 	this_cpu_base = this_cpu_ptr(&hrtimer_bases);
-	new_cpu_base = get_target_base(this_cpu_base, pinned);
+	new_cpu_base = get_target_base(this_cpu_base, timer, pinned);
 again:
 	new_base = &new_cpu_base->clock_base[basenum];
 
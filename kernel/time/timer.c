@@ -53,6 +53,7 @@
 #include <asm/io.h>
 
 #include "tick-internal.h"
+#include "timer_migration.h"
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/timer.h>
@@ -181,18 +182,22 @@ EXPORT_SYMBOL(jiffies_64);
 #define WHEEL_TIMEOUT_MAX	(WHEEL_TIMEOUT_CUTOFF - LVL_GRAN(LVL_DEPTH - 1))
 
 /*
- * The resulting wheel size. If NOHZ is configured we allocate two
- * wheels so we have a separate storage for the deferrable timers.
+ * The resulting wheel size. If NOHZ is configured we allocate three
+ * wheels: one for the pinned (local) timers, one for the global timers,
+ * which may be expired by another CPU while this one is idle (see
+ * timer_migration.c), and a separate storage for the deferrable timers.
  */
 #define WHEEL_SIZE	(LVL_SIZE * LVL_DEPTH)
 
 #ifdef CONFIG_NO_HZ_COMMON
-# define NR_BASES	2
-# define BASE_STD	0
-# define BASE_DEF	1
+# define NR_BASES	3
+# define BASE_LOCAL	0
+# define BASE_GLOBAL	1
+# define BASE_DEF	2
 #else
 # define NR_BASES	1
-# define BASE_STD	0
+# define BASE_LOCAL	0
+# define BASE_GLOBAL	0
 # define BASE_DEF	0
 #endif
 
@@ -230,10 +235,13 @@ DEFINE_STATIC_KEY_FALSE(timers_migration_enabled);
 
 static void timers_update_migration(void)
 {
-	if (sysctl_timer_migration && tick_nohz_active)
+	if (sysctl_timer_migration && tick_nohz_active) {
 		static_branch_enable(&timers_migration_enabled);
-	else
+	} else {
 		static_branch_disable(&timers_migration_enabled);
+		/* Idle CPUs have to wake up for their global timers again */
+		tmigr_kick_idle();
+	}
 }
 
 #ifdef CONFIG_SYSCTL
@@ -900,30 +908,27 @@ static int detach_if_pending(struct timer_list *timer, struct timer_base *base,
 	return 1;
 }
 
-static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
+static inline unsigned int timer_base_index(u32 tflags)
 {
-	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_STD], cpu);
-
 	/*
 	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
-	 * to use the deferrable base.
+	 * to use the deferrable base. Otherwise pinned timers go to the
+	 * local base and all others to the global one.
 	 */
 	if (IS_ENABLED(CONFIG_NO_HZ_COMMON) && (tflags & TIMER_DEFERRABLE))
-		base = per_cpu_ptr(&timer_bases[BASE_DEF], cpu);
-	return base;
+		return BASE_DEF;
+
+	return tflags & TIMER_PINNED ? BASE_LOCAL : BASE_GLOBAL;
 }
 
-static inline struct timer_base *get_timer_this_cpu_base(u32 tflags)
+static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	return per_cpu_ptr(&timer_bases[timer_base_index(tflags)], cpu);
+}
 
-	/*
-	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
-	 * to use the deferrable base.
-	 */
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON) && (tflags & TIMER_DEFERRABLE))
-		base = this_cpu_ptr(&timer_bases[BASE_DEF]);
-	return base;
+static inline struct timer_base *get_timer_this_cpu_base(u32 tflags)
+{
+	return this_cpu_ptr(&timer_bases[timer_base_index(tflags)]);
 }
 
 static inline struct timer_base *get_timer_base(u32 tflags)
@@ -1264,7 +1269,11 @@ void add_timer_on(struct timer_list *timer, int cpu)
 	if (WARN_ON_ONCE(timer_pending(timer)))
 		return;
 
-	new_base = get_timer_cpu_base(timer->flags, cpu);
+	/*
+	 * The timer has to stay on @cpu, keep it off the global base which
+	 * might be expired by another CPU.
+	 */
+	new_base = get_timer_cpu_base(timer->flags | TIMER_PINNED, cpu);
 
 	/*
 	 * If @timer was on a different CPU, it should be migrated with the
@@ -1286,7 +1295,7 @@ void add_timer_on(struct timer_list *timer, int cpu)
 		base = new_base;
 		raw_spin_lock(&base->lock);
 		WRITE_ONCE(timer->flags,
-			   (timer->flags & ~TIMER_BASEMASK) | cpu);
+			   (timer->flags & ~TIMER_BASEMASK) | TIMER_PINNED | cpu);
 	}
 	forward_timer_base(base);
 
@@ -1910,6 +1919,36 @@ static u64 cmp_next_hrtimer_event(u64 basem, u64 expires)
 	return DIV_ROUND_UP_ULL(nextevt, TICK_NSEC) * TICK_NSEC;
 }
 
+static unsigned long next_timer_interrupt(struct timer_base *base,
+					  unsigned long basej)
+{
+	if (base->next_expiry_recalc)
+		base->next_expiry = __next_timer_interrupt(base);
+
+	/*
+	 * We have a fresh next event. Check whether we can forward the
+	 * base. We can only do that when @basej is past base->clk
+	 * otherwise we might rewind base->clk.
+	 */
+	if (time_after(basej, base->clk)) {
+		if (time_after(base->next_expiry, basej))
+			base->clk = basej;
+		else if (time_after(base->next_expiry, base->clk))
+			base->clk = base->next_expiry;
+	}
+
+	return base->next_expiry;
+}
+
+static inline u64 next_timer_ns(unsigned long nextevt, unsigned long basej,
+				u64 basem)
+{
+	if (time_before_eq(nextevt, basej))
+		return basem;
+
+	return basem + (u64)(nextevt - basej) * TICK_NSEC;
+}
+
 /**
  * get_next_timer_interrupt - return the time (clock mono) of the next timer
  * @basej:	base time jiffies
@@ -1920,9 +1959,12 @@ static u64 cmp_next_hrtimer_event(u64 basem, u64 expires)
  */
 u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	struct timer_base *base_local = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
+	struct timer_base *base_global = this_cpu_ptr(&timer_bases[BASE_GLOBAL]);
+	unsigned long nextevt_local, nextevt_global;
+	bool pending_local, pending_global;
 	u64 expires = KTIME_MAX;
-	unsigned long nextevt;
+	bool idle = false;
 
 	/*
 	 * Pretend that there is no timer pending if the cpu is offline.
@@ -1931,40 +1973,46 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
 	if (cpu_is_offline(smp_processor_id()))
 		return expires;
 
-	raw_spin_lock(&base->lock);
-	if (base->next_expiry_recalc)
-		base->next_expiry = __next_timer_interrupt(base);
-	nextevt = base->next_expiry;
+	raw_spin_lock(&base_local->lock);
+	raw_spin_lock_nested(&base_global->lock, SINGLE_DEPTH_NESTING);
+
+	nextevt_local = next_timer_interrupt(base_local, basej);
+	nextevt_global = next_timer_interrupt(base_global, basej);
+	pending_local = base_local->timers_pending;
+	pending_global = base_global->timers_pending;
+
+	if (pending_local)
+		expires = next_timer_ns(nextevt_local, basej, basem);
+	if (pending_global)
+		expires = min(expires, next_timer_ns(nextevt_global, basej, basem));
 
 	/*
-	 * We have a fresh next event. Check whether we can forward the
-	 * base. We can only do that when @basej is past base->clk
-	 * otherwise we might rewind base->clk.
+	 * If we expect to sleep more than a tick, mark the bases idle.
+	 * Also the tick is stopped so any added timer must forward the
+	 * base clk itself to keep granularity small. This idle logic is
+	 * only maintained for the local and global bases, deferrable
+	 * timers may still see large granularity skew (by design).
 	 */
-	if (time_after(basej, base->clk)) {
-		if (time_after(nextevt, basej))
-			base->clk = basej;
-		else if (time_after(nextevt, base->clk))
-			base->clk = nextevt;
-	}
+	if ((expires - basem) > TICK_NSEC)
+		idle = true;
 
-	if (time_before_eq(nextevt, basej)) {
-		expires = basem;
-		base->is_idle = false;
-	} else {
-		if (base->timers_pending)
-			expires = basem + (u64)(nextevt - basej) * TICK_NSEC;
-		/*
-		 * If we expect to sleep more than a tick, mark the base idle.
-		 * Also the tick is stopped so any added timer must forward
-		 * the base clk itself to keep granularity small. This idle
-		 * logic is only maintained for the BASE_STD base, deferrable
-		 * timers may still see large granularity skew (by design).
-		 */
-		if ((expires - basem) > TICK_NSEC)
-			base->is_idle = true;
+	base_local->is_idle = idle;
+	base_global->is_idle = idle;
+
+	raw_spin_unlock(&base_global->lock);
+	raw_spin_unlock(&base_local->lock);
+
+	/*
+	 * Going idle: leave the global timers to the other CPUs of the
+	 * group, unless this is the last one of them to go idle.
+	 */
+	if (idle) {
+		expires = KTIME_MAX;
+		if (pending_local)
+			expires = next_timer_ns(nextevt_local, basej, basem);
+		if (tmigr_cpu_deactivate(&nextevt_global, pending_global))
+			expires = min(expires, next_timer_ns(nextevt_global, basej, basem));
 	}
-	raw_spin_unlock(&base->lock);
 
 	return cmp_next_hrtimer_event(basem, expires);
 }
@@ -1976,15 +2024,16 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
  */
 void timer_clear_idle(void)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
-
 	/*
 	 * We do this unlocked. The worst outcome is a remote enqueue sending
 	 * a pointless IPI, but taking the lock would just make the window for
 	 * sending the IPI a few instructions smaller for the cost of taking
 	 * the lock in the exit from idle path.
 	 */
-	base->is_idle = false;
+	__this_cpu_write(timer_bases[BASE_LOCAL].is_idle, false);
+	__this_cpu_write(timer_bases[BASE_GLOBAL].is_idle, false);
+
+	tmigr_cpu_activate();
 }
 #endif
 
@@ -2030,31 +2079,61 @@ static inline void __run_timers(struct timer_base *base)
  */
 static __latent_entropy void run_timer_softirq(struct softirq_action *h)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	int i;
+
+	for (i = 0; i < NR_BASES; i++)
+		__run_timers(this_cpu_ptr(&timer_bases[i]));
+
+	tmigr_handle_remote();
+}
+
+#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
+/**
+ * timer_expire_remote - expire the global timers of an idle CPU
+ * @cpu:	The idle CPU
+ * @next:	Returns the expiry of its next global timer
+ *
+ * Return: true if the global base of @cpu has a timer pending.
+ */
+bool timer_expire_remote(unsigned int cpu, unsigned long *next)
+{
+	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_GLOBAL], cpu);
+	bool pending;
 
 	__run_timers(base);
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON))
-		__run_timers(this_cpu_ptr(&timer_bases[BASE_DEF]));
+
+	raw_spin_lock_irq(&base->lock);
+	if (base->next_expiry_recalc)
+		base->next_expiry = __next_timer_interrupt(base);
+	*next = base->next_expiry;
+	pending = base->timers_pending;
+	raw_spin_unlock_irq(&base->lock);
+
+	return pending;
 }
+#endif
 
 /*
  * Called by the local, per-CPU timer interrupt on SMP.
  */
 static void run_local_timers(void)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
+	int i;
 
 	hrtimer_run_queues();
+
 	/* Raise the softirq only if required. */
-	if (time_before(jiffies, base->next_expiry)) {
-		if (!IS_ENABLED(CONFIG_NO_HZ_COMMON))
-			return;
-		/* CPU is awake, so check the deferrable base. */
-		base++;
-		if (time_before(jiffies, base->next_expiry))
+	for (i = 0; i < NR_BASES; i++, base++) {
+		if (time_after_eq(jiffies, base->next_expiry)) {
+			raise_softirq(TIMER_SOFTIRQ);
 			return;
+		}
 	}
-	raise_softirq(TIMER_SOFTIRQ);
+
+	/* Global timers of idle CPUs in our group */
+	if (tmigr_requires_handle_remote())
+		raise_softirq(TIMER_SOFTIRQ);
 }
 
 /*
@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Pull model for global timers
+ *
+ * Timers which are not pinned to a CPU are queued in the per CPU global
+ * timer bases. Without further handling an idle CPU has to wake up for
+ * each of them, even though any other CPU could expire them just as well.
+ *
+ * CPUs are therefore organized in groups of TMIGR_GROUP_SIZE. A CPU which
+ * goes idle (or stops its tick in nohz_full mode) publishes the expiry of
+ * its first global timer in the group and leaves it to the members which
+ * are still active: whichever of them ticks first after that expiry calls
+ * timer_expire_remote() from the timer softirq. Only the last member to go
+ * idle has to program a wakeup for the global timers of the whole group.
+ *
+ * Pinned timers and deferrable timers are not affected.
+ */
+#include <linux/cpuhotplug.h>
+#include <linux/jiffies.h>
+#include <linux/percpu.h>
+#include <linux/sched/nohz.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#include "tick-internal.h"
+#include "timer_migration.h"
+
+static DEFINE_PER_CPU(struct tmigr_cpu, tmigr_cpu);
+static struct tmigr_group *tmigr_groups;
+static bool tmigr_initialized __read_mostly;
+
+static inline bool tmigr_enabled(void)
+{
+	return static_branch_likely(&timers_migration_enabled);
+}
+
+#define for_each_group_cpu(cpu, group)					\
+	for ((cpu) = (group)->first_cpu;				\
+	     (cpu) < (group)->first_cpu + (group)->nr_cpus; (cpu)++)	\
+		if (!cpu_possible(cpu)) {} else
+
+/*
+ * Recompute the earliest global timer of the idle members. Called with
+ * @group->lock held.
+ */
+static void tmigr_update_group(struct tmigr_group *group)
+{
+	unsigned long next = 0;
+	bool pending = false;
+	unsigned int cpu;
+
+	for_each_group_cpu(cpu, group) {
+		struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+
+		if (!tmc->online || !tmc->idle || !tmc->pending)
+			continue;
+
+		if (!pending || time_before(tmc->wakeup, next))
+			next = tmc->wakeup;
+		pending = true;
+	}
+
+	WRITE_ONCE(group->next_expiry, next);
+	WRITE_ONCE(group->pending, pending);
+}
+
+/**
+ * tmigr_cpu_activate - take back the expiry of the local global timers
+ *
+ * Called with interrupts disabled when the CPU leaves idle or restarts the
+ * tick.
+ */
+void tmigr_cpu_activate(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *group = tmc->group;
+
+	if (!tmigr_initialized || !tmc->online || !tmc->idle)
+		return;
+
+	raw_spin_lock(&group->lock);
+	tmc->idle = false;
+	group->active |= tmc->bit;
+	tmigr_update_group(group);
+	raw_spin_unlock(&group->lock);
+}
+
+/**
+ * tmigr_cpu_deactivate - hand the local global timers over to the group
+ * @nextevt:	In: expiry of the first local global timer, valid if @pending.
+ *		Out: the wakeup the CPU has to program for global timers.
+ * @pending:	True if the local global base has a timer pending
+ *
+ * Called with interrupts disabled when the CPU is about to stop its tick.
+ *
+ * Return: true if the CPU has to wake up at @nextevt, false if the global
+ * timers are taken care of by another member of the group.
+ */
+bool tmigr_cpu_deactivate(unsigned long *nextevt, bool pending)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *group = tmc->group;
+	bool wake;
+
+	if (!tmigr_initialized || !tmc->online)
+		return pending;
+
+	raw_spin_lock(&group->lock);
+	tmc->idle = true;
+	tmc->pending = pending;
+	tmc->wakeup = *nextevt;
+	tmc->seq++;
+	group->active &= ~tmc->bit;
+	tmigr_update_group(group);
+
+	if (!tmigr_enabled()) {
+		wake = pending;
+	} else if (group->active) {
+		wake = false;
+	} else {
+		/* Last one out, stand in for the whole group */
+		wake = group->pending;
+		*nextevt = group->next_expiry;
+	}
+	raw_spin_unlock(&group->lock);
+
+	return wake;
+}
+
+/**
+ * tmigr_requires_handle_remote - check for due global timers of idle CPUs
+ *
+ * Called from the tick.
+ */
+bool tmigr_requires_handle_remote(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *group = tmc->group;
+
+	if (!tmigr_initialized || !tmc->online || !tmigr_enabled())
+		return false;
+
+	return READ_ONCE(group->pending) &&
+	       time_after_eq(jiffies, READ_ONCE(group->next_expiry));
+}
+
+/**
+ * tmigr_handle_remote - expire the due global timers of idle CPUs
+ *
+ * Called from the timer softirq.
+ */
+void tmigr_handle_remote(void)
+{
+	struct tmigr_cpu *this = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *group = this->group;
+	unsigned int cpu;
+
+	if (!tmigr_requires_handle_remote())
+		return;
+
+	for_each_group_cpu(cpu, group) {
+		struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+		unsigned long next;
+		unsigned int seq;
+		bool due;
+
+		if (tmc == this)
+			continue;
+
+		raw_spin_lock_irq(&group->lock);
+		due = tmc->online && tmc->idle && tmc->pending &&
+		      time_after_eq(jiffies, tmc->wakeup);
+		seq = tmc->seq;
+		raw_spin_unlock_irq(&group->lock);
+
+		if (!due)
+			continue;
+
+		due = timer_expire_remote(cpu, &next);
+
+		raw_spin_lock_irq(&group->lock);
+		/* Don't overwrite what the CPU published in the meantime */
+		if (tmc->idle && tmc->seq == seq) {
+			tmc->pending = due;
+			tmc->wakeup = next;
+		}
+		tmigr_update_group(group);
+		raw_spin_unlock_irq(&group->lock);
+	}
+}
+
+/**
+ * tmigr_kick_idle - make idle CPUs reevaluate their next timer event
+ *
+ * Used when the timer migration gets disabled, so that the idle CPUs
+ * program the wakeups for their global timers again.
+ */
+void tmigr_kick_idle(void)
+{
+	unsigned int cpu;
+
+	if (!tmigr_initialized)
+		return;
+
+	for_each_online_cpu(cpu) {
+		if (READ_ONCE(per_cpu(tmigr_cpu, cpu).idle))
+			wake_up_nohz_cpu(cpu);
+	}
+}
+
+static int tmigr_cpu_online(unsigned int cpu)
+{
+	struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+	struct tmigr_group *group = tmc->group;
+
+	raw_spin_lock_irq(&group->lock);
+	tmc->online = true;
+	tmc->idle = false;
+	group->active |= tmc->bit;
+	raw_spin_unlock_irq(&group->lock);
+
+	return 0;
+}
+
+static int tmigr_cpu_offline(unsigned int cpu)
+{
+	struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+	struct tmigr_group *group = tmc->group;
+	int target = -1;
+	unsigned int i;
+
+	raw_spin_lock_irq(&group->lock);
+	tmc->online = false;
+	tmc->idle = false;
+	group->active &= ~tmc->bit;
+	tmigr_update_group(group);
+
+	/*
+	 * The idle members rely on this CPU for their global timers. If it
+	 * was the last active one, wake one of them up so it takes over.
+	 * The global timers of this CPU itself are migrated when it is dead.
+	 */
+	if (!group->active && group->pending) {
+		for_each_group_cpu(i, group) {
+			if (per_cpu(tmigr_cpu, i).idle) {
+				target = i;
+				break;
+			}
+		}
+	}
+	raw_spin_unlock_irq(&group->lock);
+
+	if (target >= 0)
+		wake_up_nohz_cpu(target);
+
+	return 0;
+}
+
+static int __init tmigr_init(void)
+{
+	unsigned int nr_groups = DIV_ROUND_UP(nr_cpu_ids, TMIGR_GROUP_SIZE);
+	unsigned int cpu, i;
+	int ret;
+
+	tmigr_groups = kcalloc(nr_groups, sizeof(*tmigr_groups), GFP_KERNEL);
+	if (!tmigr_groups)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_groups; i++) {
+		struct tmigr_group *group = &tmigr_groups[i];
+
+		raw_spin_lock_init(&group->lock);
+		group->first_cpu = i * TMIGR_GROUP_SIZE;
+		group->nr_cpus = min_t(unsigned int, TMIGR_GROUP_SIZE,
+				       nr_cpu_ids - group->first_cpu);
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+
+		tmc->group = &tmigr_groups[cpu / TMIGR_GROUP_SIZE];
+		tmc->bit = BIT(cpu % TMIGR_GROUP_SIZE);
+	}
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "timers/migration:online",
+				tmigr_cpu_online, tmigr_cpu_offline);
+	if (ret < 0)
+		return ret;
+
+	smp_wmb();
+	WRITE_ONCE(tmigr_initialized, true);
+	return 0;
+}
+early_initcall(tmigr_init);
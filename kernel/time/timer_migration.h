@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef _KERNEL_TIME_MIGRATION_H
+#define _KERNEL_TIME_MIGRATION_H
+
+/* Number of CPUs sharing the expiry of their global timers */
+#define TMIGR_GROUP_SIZE	8
+
+/**
+ * struct tmigr_group - a group of CPUs expiring each others global timers
+ * @lock:		Protects the group and the tmigr_cpu of its members
+ * @active:		Mask of the members which are online and not idle
+ * @pending:		True if an idle member has a global timer pending
+ * @next_expiry:	Earliest global timer (jiffies) of the idle members,
+ *			valid if @pending
+ * @first_cpu:		First CPU of the group
+ * @nr_cpus:		Number of CPUs in the group
+ */
+struct tmigr_group {
+	raw_spinlock_t		lock;
+	unsigned long		active;
+	bool			pending;
+	unsigned long		next_expiry;
+	unsigned int		first_cpu;
+	unsigned int		nr_cpus;
+};
+
+/**
+ * struct tmigr_cpu - per CPU timer migration state
+ * @group:		The group this CPU belongs to
+ * @bit:		The bit of this CPU in @group->active
+ * @online:		The CPU takes part in the timer migration
+ * @idle:		The CPU is idle and its global timers are handled by
+ *			the group
+ * @pending:		The CPU has a global timer pending, valid if @idle
+ * @wakeup:		Expiry (jiffies) of its first global timer, valid if
+ *			@pending
+ * @seq:		Incremented on each deactivation, so that a remote
+ *			expiry doesn't overwrite a more recent @wakeup
+ */
+struct tmigr_cpu {
+	struct tmigr_group	*group;
+	unsigned long		bit;
+	bool			online;
+	bool			idle;
+	bool			pending;
+	unsigned long		wakeup;
+	unsigned int		seq;
+};
+
+#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
+extern void tmigr_cpu_activate(void);
+extern bool tmigr_cpu_deactivate(unsigned long *nextevt, bool pending);
+extern bool tmigr_requires_handle_remote(void);
+extern void tmigr_handle_remote(void);
+extern void tmigr_kick_idle(void);
+extern bool timer_expire_remote(unsigned int cpu, unsigned long *next);
+#else
+static inline void tmigr_cpu_activate(void) { }
+static inline bool tmigr_cpu_deactivate(unsigned long *nextevt, bool pending)
+{
+	return pending;
+}
+static inline bool tmigr_requires_handle_remote(void)
+{
+	return false;
+}
+static inline void tmigr_handle_remote(void) { }
+static inline void tmigr_kick_idle(void) { }
+#endif
+
+#endif
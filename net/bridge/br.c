@@ -269,6 +269,18 @@ int br_boolopt_toggle(struct net_bridge *br, enum br_boolopt_id opt, bool on,
 	case BR_BOOLOPT_MST_ENABLE:
 		err = br_mst_set_enabled(br, on, extack);
 		break;
+	case BR_BOOLOPT_FDB_LEARN_BATCH:
+		br_opt_toggle(br, BROPT_FDB_LEARN_BATCH, on);
+		/* don't leave entries behind when switching it off */
+		if (!on)
+			schedule_work(&br->fdb_learn_work);
+		break;
+	case BR_BOOLOPT_FDB_COARSE_REFRESH:
+		br_opt_toggle(br, BROPT_FDB_COARSE_REFRESH, on);
+		break;
+	case BR_BOOLOPT_FDB_FWD_CACHE:
+		br_opt_toggle(br, BROPT_FDB_FWD_CACHE, on);
+		break;
 	default:
 		/* shouldn't be called with unsupported options */
 		WARN_ON(1);
@@ -287,6 +299,12 @@ int br_boolopt_get(const struct net_bridge *br, enum br_boolopt_id opt)
 		return br_opt_get(br, BROPT_MCAST_VLAN_SNOOPING_ENABLED);
 	case BR_BOOLOPT_MST_ENABLE:
 		return br_opt_get(br, BROPT_MST_ENABLED);
+	case BR_BOOLOPT_FDB_LEARN_BATCH:
+		return br_opt_get(br, BROPT_FDB_LEARN_BATCH);
+	case BR_BOOLOPT_FDB_COARSE_REFRESH:
+		return br_opt_get(br, BROPT_FDB_COARSE_REFRESH);
+	case BR_BOOLOPT_FDB_FWD_CACHE:
+		return br_opt_get(br, BROPT_FDB_FWD_CACHE);
 	default:
 		/* shouldn't be called with unsupported options */
 		WARN_ON(1);
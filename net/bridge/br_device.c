@@ -535,4 +535,5 @@ void br_dev_setup(struct net_device *dev)
 	br_stp_timer_init(br);
 	br_multicast_init(br);
 	INIT_DELAYED_WORK(&br->gc_work, br_fdb_cleanup);
+	INIT_WORK(&br->fdb_learn_work, br_fdb_learn_work);
 }
@@ -52,12 +52,39 @@ void br_fdb_fini(void)
 
 int br_fdb_hash_init(struct net_bridge *br)
 {
-	return rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	int cpu, err;
+
+	br->fdb_learn = alloc_percpu(struct net_bridge_fdb_learn);
+	if (!br->fdb_learn)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(br->fdb_learn, cpu)->lock);
+
+	br->fdb_fwd = alloc_percpu(struct net_bridge_fdb_fwd);
+	if (!br->fdb_fwd) {
+		err = -ENOMEM;
+		goto err_learn;
+	}
+
+	err = rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
+	if (err)
+		goto err_fwd;
+
+	return 0;
+
+err_fwd:
+	free_percpu(br->fdb_fwd);
+err_learn:
+	free_percpu(br->fdb_learn);
+	return err;
 }
 
 void br_fdb_hash_fini(struct net_bridge *br)
 {
 	rhashtable_destroy(&br->fdb_hash_tbl);
+	free_percpu(br->fdb_fwd);
+	free_percpu(br->fdb_learn);
 }
 
 /* if topology_changing then use forward_delay (default 15 sec)
@@ -329,6 +356,11 @@ static void fdb_delete(struct net_bridge *br, struct net_bridge_fdb_entry *f,
 	hlist_del_init_rcu(&f->fdb_node);
 	rhashtable_remove_fast(&br->fdb_hash_tbl, &f->rhnode,
 			       br_fdb_rht_params);
+	/* invalidate the forwarding caches before @f can be freed, pairs with
+	 * br_fdb_fwd_cache_gen()
+	 */
+	smp_wmb();
+	WRITE_ONCE(br->fdb_gen, br->fdb_gen + 1);
 	fdb_notify(br, f, RTM_DELNEIGH, swdev_notify);
 	call_rcu(&f->rcu, fdb_rcu_free);
 }
@@ -850,6 +882,94 @@ static bool __fdb_mark_active(struct net_bridge_fdb_entry *fdb)
 		  test_and_clear_bit(BR_FDB_NOTIFY_INACTIVE, &fdb->flags));
 }
 
+static void fdb_learn_insert(struct net_bridge *br,
+			     const struct net_bridge_fdb_pending *ent,
+			     unsigned int n)
+{
+	struct net_bridge_fdb_entry *fdb;
+	struct net_bridge_port *p;
+	struct net_device *dev;
+	unsigned int i;
+
+	rcu_read_lock();
+	spin_lock_bh(&br->hash_lock);
+	for (i = 0; i < n; i++) {
+		dev = dev_get_by_index_rcu(dev_net(br->dev), ent[i].ifindex);
+		p = dev ? br_port_get_check_rcu(dev) : NULL;
+		/* the port may have been removed since, del_nbp() disables
+		 * it before flushing its entries under hash_lock
+		 */
+		if (!p || p->br != br || p->state == BR_STATE_DISABLED)
+			continue;
+
+		fdb = fdb_create(br, p, ent[i].addr, ent[i].vid, 0);
+		if (fdb) {
+			trace_br_fdb_update(br, p, ent[i].addr, ent[i].vid, 0);
+			fdb_notify(br, fdb, RTM_NEWNEIGH, true);
+		}
+	}
+	spin_unlock_bh(&br->hash_lock);
+	rcu_read_unlock();
+}
+
+static void fdb_learn_drain(struct net_bridge *br,
+			    struct net_bridge_fdb_learn *q)
+{
+	struct net_bridge_fdb_pending ent[BR_FDB_LEARN_BATCH];
+	unsigned int n;
+
+	spin_lock_bh(&q->lock);
+	n = q->count;
+	memcpy(ent, q->ent, n * sizeof(ent[0]));
+	q->count = 0;
+	spin_unlock_bh(&q->lock);
+
+	if (n)
+		fdb_learn_insert(br, ent, n);
+}
+
+void br_fdb_learn_work(struct work_struct *work)
+{
+	struct net_bridge *br = container_of(work, struct net_bridge,
+					     fdb_learn_work);
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		fdb_learn_drain(br, per_cpu_ptr(br->fdb_learn, cpu));
+}
+
+/* Queue a new entry on the local CPU instead of taking hash_lock for each
+ * one; the queue is inserted once full or from fdb_learn_work.  Called from
+ * the rx path with BH disabled.
+ */
+static void fdb_learn_queue(struct net_bridge *br,
+			    const struct net_bridge_port *source,
+			    const unsigned char *addr, u16 vid)
+{
+	struct net_bridge_fdb_learn *q = this_cpu_ptr(br->fdb_learn);
+	unsigned int i, count;
+
+	spin_lock(&q->lock);
+	/* a burst from a new source is queued only once */
+	for (i = 0; i < q->count; i++) {
+		if (q->ent[i].vid == vid &&
+		    ether_addr_equal(q->ent[i].addr, addr)) {
+			spin_unlock(&q->lock);
+			return;
+		}
+	}
+	memcpy(q->ent[i].addr, addr, ETH_ALEN);
+	q->ent[i].vid = vid;
+	q->ent[i].ifindex = source->dev->ifindex;
+	count = ++q->count;
+	spin_unlock(&q->lock);
+
+	if (count == BR_FDB_LEARN_BATCH)
+		fdb_learn_drain(br, q);
+	else if (count == 1)
+		schedule_work(&br->fdb_learn_work);
+}
+
 void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 		   const unsigned char *addr, u16 vid, unsigned long flags)
 {
@@ -870,7 +990,9 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 			unsigned long now = jiffies;
 			bool fdb_modified = false;
 
-			if (now != fdb->updated) {
+			if (br_fdb_stamp_stale(br, fdb->updated, now) ||
+			    unlikely(test_bit(BR_FDB_NOTIFY_INACTIVE,
+					      &fdb->flags))) {
 				fdb->updated = now;
 				fdb_modified = __fdb_mark_active(fdb);
 			}
@@ -900,6 +1022,8 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 				fdb_notify(br, fdb, RTM_NEWNEIGH, true);
 			}
 		}
+	} else if (!flags && br_opt_get(br, BROPT_FDB_LEARN_BATCH)) {
+		fdb_learn_queue(br, source, addr, vid);
 	} else {
 		spin_lock(&br->hash_lock);
 		fdb = fdb_create(br, source, addr, vid, flags);
@@ -914,6 +1038,95 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 	}
 }
 
+static unsigned int fdb_fwd_slot(const struct sk_buff *skb)
+{
+	const struct ethhdr *eth = eth_hdr(skb);
+
+	return (skb->hash ? : eth->h_dest[5] ^ eth->h_source[5]) &
+	       (BR_FDB_FWD_CACHE_SIZE - 1);
+}
+
+/* Look up the cached destination of a unicast flow learning on port @p,
+ * refreshing the source entry as br_fdb_update() would on a hit.  Called
+ * with rcu_read_lock from the rx path.
+ */
+struct net_bridge_fdb_entry *
+br_fdb_fwd_cache_get(struct net_bridge *br, const struct net_bridge_port *p,
+		     const struct sk_buff *skb, u16 vid)
+{
+	const struct ethhdr *eth = eth_hdr(skb);
+	struct net_bridge_fdb_entry *src, *dst;
+	unsigned long now = jiffies;
+	unsigned int i;
+
+	if (!br_opt_get(br, BROPT_FDB_FWD_CACHE) || hold_time(br) == 0)
+		return NULL;
+
+	i = fdb_fwd_slot(skb);
+	if (this_cpu_read(br->fdb_fwd->slot[i].gen) != READ_ONCE(br->fdb_gen))
+		return NULL;
+
+	src = this_cpu_read(br->fdb_fwd->slot[i].src);
+	dst = this_cpu_read(br->fdb_fwd->slot[i].dst);
+	if (!dst || READ_ONCE(src->dst) != p ||
+	    src->key.vlan_id != vid || dst->key.vlan_id != vid ||
+	    !ether_addr_equal(src->key.addr.addr, eth->h_source) ||
+	    !ether_addr_equal(dst->key.addr.addr, eth->h_dest) ||
+	    test_bit(BR_FDB_LOCAL, &dst->flags))
+		return NULL;
+
+	if (br_fdb_stamp_stale(br, src->updated, now) ||
+	    unlikely(test_bit(BR_FDB_NOTIFY_INACTIVE, &src->flags))) {
+		src->updated = now;
+		if (__fdb_mark_active(src)) {
+			trace_br_fdb_update(br, src->dst, eth->h_source, vid, 0);
+			fdb_notify(br, src, RTM_NEWNEIGH, true);
+		}
+	}
+
+	return dst;
+}
+
+/* Sample the generation a slot gets stored with, before the fdb lookups
+ * of the entries cached in it: an entry found after this point was either
+ * still hashed, or its deletion bumped the generation and invalidates the
+ * slot.
+ */
+unsigned long br_fdb_fwd_cache_gen(struct net_bridge *br)
+{
+	unsigned long gen = READ_ONCE(br->fdb_gen);
+
+	/* pairs with the smp_wmb() in fdb_delete() */
+	smp_rmb();
+	return gen;
+}
+
+/* Remember the fdb entries of a unicast frame forwarded from port @p after
+ * the full lookup of @dst, which must have been done after sampling @gen
+ * with br_fdb_fwd_cache_gen().
+ */
+void br_fdb_fwd_cache_set(struct net_bridge *br, const struct net_bridge_port *p,
+			  const struct sk_buff *skb, u16 vid, unsigned long gen,
+			  struct net_bridge_fdb_entry *dst)
+{
+	struct net_bridge_fdb_entry *src;
+	unsigned int i;
+
+	if (!dst || test_bit(BR_FDB_LOCAL, &dst->flags))
+		return;
+
+	src = br_fdb_find_rcu(br, eth_hdr(skb)->h_source, vid);
+	if (!src || READ_ONCE(src->dst) != p ||
+	    test_bit(BR_FDB_LOCAL, &src->flags) ||
+	    test_bit(BR_FDB_LOCKED, &src->flags))
+		return;
+
+	i = fdb_fwd_slot(skb);
+	this_cpu_write(br->fdb_fwd->slot[i].gen, gen);
+	this_cpu_write(br->fdb_fwd->slot[i].src, src);
+	this_cpu_write(br->fdb_fwd->slot[i].dst, dst);
+}
+
 /* Dump information about entries, in response to GETNEIGH */
 int br_fdb_dump(struct sk_buff *skb,
 		struct netlink_callback *cb,
@@ -134,8 +134,11 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 	nbp_switchdev_frame_mark(p, skb);
 
 	/* insert into forwarding database after filtering to avoid spoofing */
-	if (p->flags & BR_LEARNING)
-		br_fdb_update(br, p, eth_hdr(skb)->h_source, vid, 0);
+	if (p->flags & BR_LEARNING) {
+		dst = br_fdb_fwd_cache_get(br, p, skb, vid);
+		if (!dst)
+			br_fdb_update(br, p, eth_hdr(skb)->h_source, vid, 0);
+	}
 
 	local_rcv = !!(br->dev->flags & IFF_PROMISC);
 	if (is_multicast_ether_addr(eth_hdr(skb)->h_dest)) {
@@ -190,6 +193,16 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 		}
 		break;
 	case BR_PKT_UNICAST:
+		if (dst)
+			break;
+		if ((p->flags & BR_LEARNING) &&
+		    br_opt_get(br, BROPT_FDB_FWD_CACHE)) {
+			unsigned long gen = br_fdb_fwd_cache_gen(br);
+
+			dst = br_fdb_find_rcu(br, eth_hdr(skb)->h_dest, vid);
+			br_fdb_fwd_cache_set(br, p, skb, vid, gen, dst);
+			break;
+		}
 		dst = br_fdb_find_rcu(br, eth_hdr(skb)->h_dest, vid);
 		break;
 	default:
@@ -202,7 +215,7 @@ int br_handle_frame_finish(struct net *net, struct sock *sk, struct sk_buff *skb
 		if (test_bit(BR_FDB_LOCAL, &dst->flags))
 			return br_pass_frame_up(skb);
 
-		if (now != dst->used)
+		if (br_fdb_stamp_stale(br, dst->used, now))
 			dst->used = now;
 		br_forward(dst->dst, skb, local_rcv, false);
 	} else {
@@ -296,6 +296,40 @@ struct net_bridge_fdb_entry {
 	struct rcu_head			rcu;
 };
 
+#define BR_FDB_LEARN_BATCH	16
+#define BR_FDB_COARSE_REFRESH	HZ
+
+/* fdb entries learned on a CPU with BROPT_FDB_LEARN_BATCH, waiting to be
+ * inserted under hash_lock all at once
+ */
+struct net_bridge_fdb_pending {
+	unsigned char			addr[ETH_ALEN];
+	u16				vid;
+	int				ifindex;
+};
+
+struct net_bridge_fdb_learn {
+	spinlock_t			lock;
+	unsigned int			count;
+	struct net_bridge_fdb_pending	ent[BR_FDB_LEARN_BATCH];
+};
+
+#define BR_FDB_FWD_CACHE_SIZE	64
+
+/* Source and destination entries of unicast flows recently forwarded on a
+ * CPU with BROPT_FDB_FWD_CACHE, saving both fdb lookups for the next frames
+ * of the flow.  A slot is only valid, and its entries may only be looked
+ * at, while @gen matches net_bridge's fdb_gen, which is bumped before any
+ * entry gets freed.
+ */
+struct net_bridge_fdb_fwd {
+	struct {
+		unsigned long			gen;
+		struct net_bridge_fdb_entry	*src;
+		struct net_bridge_fdb_entry	*dst;
+	} slot[BR_FDB_FWD_CACHE_SIZE];
+};
+
 struct net_bridge_fdb_flush_desc {
 	unsigned long			flags;
 	unsigned long			flags_mask;
@@ -479,6 +513,9 @@ enum net_bridge_opts {
 	BROPT_VLAN_BRIDGE_BINDING,
 	BROPT_MCAST_VLAN_SNOOPING_ENABLED,
 	BROPT_MST_ENABLED,
+	BROPT_FDB_LEARN_BATCH,
+	BROPT_FDB_COARSE_REFRESH,
+	BROPT_FDB_FWD_CACHE,
 };
 
 struct net_bridge {
@@ -495,6 +532,10 @@ struct net_bridge {
 #endif
 
 	struct rhashtable		fdb_hash_tbl;
+	struct net_bridge_fdb_learn	__percpu *fdb_learn;
+	struct work_struct		fdb_learn_work;
+	struct net_bridge_fdb_fwd	__percpu *fdb_fwd;
+	unsigned long			fdb_gen;
 	struct list_head		port_list;
 #if IS_ENABLED(CONFIG_BRIDGE_NETFILTER)
 	union {
@@ -745,6 +786,18 @@ static inline int br_opt_get(const struct net_bridge *br,
 	return test_bit(opt, &br->options);
 }
 
+/* fdb timestamps written on the packet path: with BROPT_FDB_COARSE_REFRESH
+ * at most once per BR_FDB_COARSE_REFRESH, so the cache line of a busy entry
+ * isn't bounced between the CPUs forwarding its traffic
+ */
+static inline bool br_fdb_stamp_stale(const struct net_bridge *br,
+				      unsigned long stamp, unsigned long now)
+{
+	if (br_opt_get(br, BROPT_FDB_COARSE_REFRESH))
+		return time_after(now, stamp + BR_FDB_COARSE_REFRESH);
+	return now != stamp;
+}
+
 int br_boolopt_toggle(struct net_bridge *br, enum br_boolopt_id opt, bool on,
 		      struct netlink_ext_ack *extack);
 int br_boolopt_get(const struct net_bridge *br, enum br_boolopt_id opt);
@@ -828,6 +881,14 @@ void br_fdb_find_delete_local(struct net_bridge *br,
 void br_fdb_changeaddr(struct net_bridge_port *p, const unsigned char *newaddr);
 void br_fdb_change_mac_address(struct net_bridge *br, const u8 *newaddr);
 void br_fdb_cleanup(struct work_struct *work);
+void br_fdb_learn_work(struct work_struct *work);
+struct net_bridge_fdb_entry *
+br_fdb_fwd_cache_get(struct net_bridge *br, const struct net_bridge_port *p,
+		     const struct sk_buff *skb, u16 vid);
+unsigned long br_fdb_fwd_cache_gen(struct net_bridge *br);
+void br_fdb_fwd_cache_set(struct net_bridge *br, const struct net_bridge_port *p,
+			  const struct sk_buff *skb, u16 vid, unsigned long gen,
+			  struct net_bridge_fdb_entry *dst);
 void br_fdb_delete_by_port(struct net_bridge *br,
 			   const struct net_bridge_port *p, u16 vid, int do_all);
 struct net_bridge_fdb_entry *br_fdb_find_rcu(struct net_bridge *br,
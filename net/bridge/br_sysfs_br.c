@@ -382,6 +382,74 @@ static ssize_t no_linklocal_learn_store(struct device *d,
 }
 static DEVICE_ATTR_RW(no_linklocal_learn);
 
+static ssize_t fdb_learn_batch_show(struct device *d,
+				    struct device_attribute *attr, char *buf)
+{
+	struct net_bridge *br = to_bridge(d);
+	return sprintf(buf, "%d\n",
+		       br_boolopt_get(br, BR_BOOLOPT_FDB_LEARN_BATCH));
+}
+
+static int set_fdb_learn_batch(struct net_bridge *br, unsigned long val,
+			       struct netlink_ext_ack *extack)
+{
+	return br_boolopt_toggle(br, BR_BOOLOPT_FDB_LEARN_BATCH, !!val, extack);
+}
+
+static ssize_t fdb_learn_batch_store(struct device *d,
+				     struct device_attribute *attr,
+				     const char *buf, size_t len)
+{
+	return store_bridge_parm(d, buf, len, set_fdb_learn_batch);
+}
+static DEVICE_ATTR_RW(fdb_learn_batch);
+
+static ssize_t fdb_coarse_refresh_show(struct device *d,
+				       struct device_attribute *attr,
+				       char *buf)
+{
+	struct net_bridge *br = to_bridge(d);
+	return sprintf(buf, "%d\n",
+		       br_boolopt_get(br, BR_BOOLOPT_FDB_COARSE_REFRESH));
+}
+
+static int set_fdb_coarse_refresh(struct net_bridge *br, unsigned long val,
+				  struct netlink_ext_ack *extack)
+{
+	return br_boolopt_toggle(br, BR_BOOLOPT_FDB_COARSE_REFRESH, !!val,
+				 extack);
+}
+
+static ssize_t fdb_coarse_refresh_store(struct device *d,
+					struct device_attribute *attr,
+					const char *buf, size_t len)
+{
+	return store_bridge_parm(d, buf, len, set_fdb_coarse_refresh);
+}
+static DEVICE_ATTR_RW(fdb_coarse_refresh);
+
+static ssize_t fdb_fwd_cache_show(struct device *d,
+				  struct device_attribute *attr, char *buf)
+{
+	struct net_bridge *br = to_bridge(d);
+	return sprintf(buf, "%d\n",
+		       br_boolopt_get(br, BR_BOOLOPT_FDB_FWD_CACHE));
+}
+
+static int set_fdb_fwd_cache(struct net_bridge *br, unsigned long val,
+			     struct netlink_ext_ack *extack)
+{
+	return br_boolopt_toggle(br, BR_BOOLOPT_FDB_FWD_CACHE, !!val, extack);
+}
+
+static ssize_t fdb_fwd_cache_store(struct device *d,
+				   struct device_attribute *attr,
+				   const char *buf, size_t len)
+{
+	return store_bridge_parm(d, buf, len, set_fdb_fwd_cache);
+}
+static DEVICE_ATTR_RW(fdb_fwd_cache);
+
 #ifdef CONFIG_BRIDGE_IGMP_SNOOPING
 static ssize_t multicast_router_show(struct device *d,
 				     struct device_attribute *attr, char *buf)
@@ -954,6 +1022,9 @@ static struct attribute *bridge_attrs[] = {
 	&dev_attr_group_addr.attr,
 	&dev_attr_flush.attr,
 	&dev_attr_no_linklocal_learn.attr,
+	&dev_attr_fdb_learn_batch.attr,
+	&dev_attr_fdb_coarse_refresh.attr,
+	&dev_attr_fdb_fwd_cache.attr,
 #ifdef CONFIG_BRIDGE_IGMP_SNOOPING
 	&dev_attr_multicast_router.attr,
 	&dev_attr_multicast_snooping.attr,
@@ -21,6 +21,7 @@
 #include <linux/proc_fs.h>
 #include <linux/err.h>
 #include <linux/cpumask.h>
+#include <linux/hash.h>
 
 #include <linux/netfilter/x_tables.h>
 #include <linux/netfilter_ipv4/ip_tables.h>
@@ -218,6 +219,82 @@ struct ipt_entry *ipt_next_entry(const struct ipt_entry *entry)
 	return (void *)entry + entry->next_offset;
 }
 
+/* Runs of at least IPT_DISPATCH_MIN_RUN consecutive rules matching an exact,
+ * non-inverted destination address (as in the kubernetes service chains)
+ * are indexed by that address when the table is loaded.  Only the rules of
+ * a run for the destination of the packet can match, so the walker jumps
+ * straight to the next of these or past the end of the run.  Rule order,
+ * matches, targets and counters are unchanged, the rules skipped could not
+ * have matched.
+ */
+#define IPT_DISPATCH_MIN_RUN	16
+
+struct ipt_dst_rule {
+	__be32			addr;
+	unsigned int		off;
+};
+
+struct ipt_dst_run {
+	unsigned int		start;	/* offset of the first rule */
+	unsigned int		end;	/* offset of the rule after the run */
+	unsigned int		bits;
+	unsigned int		*bucket;	/* rule[] range of each bucket */
+	struct ipt_dst_rule	*rule;		/* by bucket, then by offset */
+};
+
+struct ipt_dispatch {
+	unsigned long		*in_run;	/* rules inside a run */
+	unsigned int		nruns;
+	struct ipt_dst_run	run[];
+};
+
+/* The dispatch index is kept behind the rules, in room reserved by
+ * ipt_alloc_table_info().
+ */
+static inline struct ipt_dispatch **
+ipt_dispatch_slot(const struct xt_table_info *info)
+{
+	return (struct ipt_dispatch **)((void *)info->entries +
+					ALIGN(info->size, sizeof(void *)));
+}
+
+static inline bool
+ipt_dispatch_in_run(const struct ipt_dispatch *d, const void *base,
+		    const struct ipt_entry *e)
+{
+	return test_bit(((void *)e - base) / __alignof__(struct ipt_entry),
+			d->in_run);
+}
+
+/* Performance critical */
+static struct ipt_entry *
+ipt_dispatch(const struct ipt_dispatch *d, const void *base,
+	     struct ipt_entry *e, __be32 daddr)
+{
+	unsigned int off = (void *)e - base;
+	unsigned int lo = 0, hi = d->nruns - 1, mid, h, i;
+	const struct ipt_dst_run *run;
+
+	for (;;) {
+		mid = (lo + hi) / 2;
+		run = &d->run[mid];
+		if (off < run->start)
+			hi = mid - 1;
+		else if (off >= run->end)
+			lo = mid + 1;
+		else
+			break;
+	}
+
+	h = hash_32((__force u32)daddr, run->bits);
+	for (i = run->bucket[h]; i < run->bucket[h + 1]; i++) {
+		if (run->rule[i].addr == daddr && run->rule[i].off >= off)
+			return get_entry(base, run->rule[i].off);
+	}
+
+	return get_entry(base, run->end);
+}
+
 /* Returns one of the generic firewall policies, like NF_ACCEPT. */
 unsigned int
 ipt_do_table(void *priv,
@@ -235,6 +312,7 @@ ipt_do_table(void *priv,
 	struct ipt_entry *e, **jumpstack;
 	unsigned int stackidx, cpu;
 	const struct xt_table_info *private;
+	const struct ipt_dispatch *dispatch;
 	struct xt_action_param acpar;
 	unsigned int addend;
 
@@ -260,6 +338,7 @@ ipt_do_table(void *priv,
 	private = READ_ONCE(table->private); /* Address dependency. */
 	cpu        = smp_processor_id();
 	table_base = private->entries;
+	dispatch   = *ipt_dispatch_slot(private);
 	jumpstack  = (struct ipt_entry **)private->jumpstack[cpu];
 
 	/* Switch to alternate jumpstack if we're being invoked via TEE.
@@ -280,6 +359,9 @@ ipt_do_table(void *priv,
 		struct xt_counters *counter;
 
 		WARN_ON(!e);
+		if (dispatch && ipt_dispatch_in_run(dispatch, table_base, e))
+			e = ipt_dispatch(dispatch, table_base, e, ip->daddr);
+
 		if (!ip_packet_match(ip, indev, outdev,
 		    &e->ip, acpar.fragoff)) {
  no_match:
@@ -654,6 +736,143 @@ cleanup_entry(struct ipt_entry *e, struct net *net)
 	xt_percpu_counter_free(&e->counters);
 }
 
+static bool ipt_dst_keyed(const struct ipt_entry *e)
+{
+	return e->ip.dmsk.s_addr == htonl(0xffffffff) &&
+	       !(e->ip.invflags & IPT_INV_DSTIP);
+}
+
+static void ipt_dispatch_free(struct ipt_dispatch *d)
+{
+	unsigned int i;
+
+	if (!d)
+		return;
+
+	for (i = 0; i < d->nruns; i++) {
+		kvfree(d->run[i].bucket);
+		kvfree(d->run[i].rule);
+	}
+	kvfree(d->in_run);
+	kvfree(d);
+}
+
+static int ipt_dispatch_fill_run(struct ipt_dispatch *d, void *entry0,
+				 struct ipt_dst_run *run, unsigned int n)
+{
+	unsigned int off, h, i;
+	struct ipt_entry *e;
+
+	run->bits = ilog2(roundup_pow_of_two(n));
+	run->bucket = kvcalloc((1U << run->bits) + 1, sizeof(*run->bucket),
+			       GFP_KERNEL);
+	run->rule = kvmalloc_array(n, sizeof(*run->rule), GFP_KERNEL);
+	if (!run->bucket || !run->rule)
+		return -ENOMEM;
+
+	/* counting sort, so that the rules of a bucket stay in rule order:
+	 * bucket[h] ends up as the index of the first rule hashing to h
+	 */
+	for (off = run->start; off < run->end; off += e->next_offset) {
+		e = entry0 + off;
+		run->bucket[hash_32((__force u32)e->ip.dst.s_addr,
+				    run->bits) + 1]++;
+		__set_bit(off / __alignof__(struct ipt_entry), d->in_run);
+	}
+	for (h = 1; h <= 1U << run->bits; h++)
+		run->bucket[h] += run->bucket[h - 1];
+
+	/* bucket[h] is used as the insertion cursor of h, then moved back */
+	for (off = run->start; off < run->end; off += e->next_offset) {
+		e = entry0 + off;
+		h = hash_32((__force u32)e->ip.dst.s_addr, run->bits);
+		i = run->bucket[h]++;
+		run->rule[i].addr = e->ip.dst.s_addr;
+		run->rule[i].off = off;
+	}
+	for (h = (1U << run->bits) - 1; h > 0; h--)
+		run->bucket[h] = run->bucket[h - 1];
+	run->bucket[0] = 0;
+
+	return 0;
+}
+
+/* Build the destination dispatch of a validated table.  Failing here is
+ * not fatal, the table is then walked rule by rule.
+ */
+static void ipt_dispatch_build(struct xt_table_info *newinfo, void *entry0)
+{
+	unsigned int nruns = 0, n = 0, start = 0, i;
+	struct ipt_dispatch *d;
+	struct ipt_entry *iter;
+
+	xt_entry_foreach(iter, entry0, newinfo->size) {
+		if (ipt_dst_keyed(iter)) {
+			n++;
+			continue;
+		}
+		if (n >= IPT_DISPATCH_MIN_RUN)
+			nruns++;
+		n = 0;
+	}
+	if (!nruns)
+		return;
+
+	d = kvzalloc(struct_size(d, run, nruns), GFP_KERNEL);
+	if (!d)
+		return;
+
+	d->in_run = kvcalloc(BITS_TO_LONGS(newinfo->size /
+					   __alignof__(struct ipt_entry)),
+			     sizeof(unsigned long), GFP_KERNEL);
+	if (!d->in_run)
+		goto err;
+
+	/* the final ERROR target ends any run before the end of the table */
+	n = 0;
+	xt_entry_foreach(iter, entry0, newinfo->size) {
+		if (ipt_dst_keyed(iter)) {
+			if (!n++)
+				start = (void *)iter - entry0;
+			continue;
+		}
+		if (n >= IPT_DISPATCH_MIN_RUN) {
+			i = d->nruns++;
+			d->run[i].start = start;
+			d->run[i].end = (void *)iter - entry0;
+			if (ipt_dispatch_fill_run(d, entry0, &d->run[i], n))
+				goto err;
+		}
+		n = 0;
+	}
+
+	*ipt_dispatch_slot(newinfo) = d;
+	return;
+
+err:
+	ipt_dispatch_free(d);
+}
+
+static struct xt_table_info *ipt_alloc_table_info(unsigned int size)
+{
+	struct xt_table_info *info;
+
+	info = xt_alloc_table_info(ALIGN(size, sizeof(void *)) +
+				   sizeof(struct ipt_dispatch *));
+	if (!info)
+		return NULL;
+
+	info->size = size;
+	*ipt_dispatch_slot(info) = NULL;
+	return info;
+}
+
+static void ipt_free_table_info(struct xt_table_info *info)
+{
+	ipt_dispatch_free(*ipt_dispatch_slot(info));
+	xt_free_table_info(info);
+}
+
 /* Checks and translates the user-supplied table segment (held in
    newinfo) */
 static int
@@ -729,6 +948,7 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		return ret;
 	}
 
+	ipt_dispatch_build(newinfo, entry0);
 	return ret;
  out_free:
 	kvfree(offsets);
@@ -1081,7 +1301,7 @@ __do_replace(struct net *net, const char *name, unsigned int valid_hooks,
 	xt_entry_foreach(iter, oldinfo->entries, oldinfo->size)
 		cleanup_entry(iter, net);
 
-	xt_free_table_info(oldinfo);
+	ipt_free_table_info(oldinfo);
 	if (copy_to_user(counters_ptr, counters,
 			 sizeof(struct xt_counters) * num_counters) != 0) {
 		/* Silent error, can't fail, new table is already in place */
@@ -1119,7 +1339,7 @@ do_replace(struct net *net, sockptr_t arg, unsigned int len)
 
 	tmp.name[sizeof(tmp.name)-1] = 0;
 
-	newinfo = xt_alloc_table_info(tmp.size);
+	newinfo = ipt_alloc_table_info(tmp.size);
 	if (!newinfo)
 		return -ENOMEM;
 
@@ -1144,7 +1364,7 @@ do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1422,7 +1642,7 @@ translate_compat_table(struct net *net,
 		goto out_unlock;
 
 	ret = -ENOMEM;
-	newinfo = xt_alloc_table_info(size);
+	newinfo = ipt_alloc_table_info(size);
 	if (!newinfo)
 		goto out_unlock;
 
@@ -1466,11 +1686,11 @@ translate_compat_table(struct net *net,
 
 	*pinfo = newinfo;
 	*pentry0 = entry1;
-	xt_free_table_info(info);
+	ipt_free_table_info(info);
 	return 0;
 
 free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 out_unlock:
 	xt_compat_flush_offsets(AF_INET);
@@ -1503,7 +1723,7 @@ compat_do_replace(struct net *net, sockptr_t arg, unsigned int len)
 
 	tmp.name[sizeof(tmp.name)-1] = 0;
 
-	newinfo = xt_alloc_table_info(tmp.size);
+	newinfo = ipt_alloc_table_info(tmp.size);
 	if (!newinfo)
 		return -ENOMEM;
 
@@ -1528,7 +1748,7 @@ compat_do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1709,7 +1929,7 @@ static void __ipt_unregister_table(struct net *net, struct xt_table *table)
 		cleanup_entry(iter, net);
 	if (private->number > private->initial_entries)
 		module_put(table_owner);
-	xt_free_table_info(private);
+	ipt_free_table_info(private);
 }
 
 int ipt_register_table(struct net *net, const struct xt_table *table,
@@ -1724,7 +1944,7 @@ int ipt_register_table(struct net *net, const struct xt_table *table,
 	void *loc_cpu_entry;
 	struct xt_table *new_table;
 
-	newinfo = xt_alloc_table_info(repl->size);
+	newinfo = ipt_alloc_table_info(repl->size);
 	if (!newinfo)
 		return -ENOMEM;
 
@@ -1733,7 +1953,7 @@ int ipt_register_table(struct net *net, const struct xt_table *table,
 
 	ret = translate_table(net, newinfo, loc_cpu_entry, repl);
 	if (ret != 0) {
-		xt_free_table_info(newinfo);
+		ipt_free_table_info(newinfo);
 		return ret;
 	}
 
@@ -1743,7 +1963,7 @@ int ipt_register_table(struct net *net, const struct xt_table *table,
 
 		xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 			cleanup_entry(iter, net);
-		xt_free_table_info(newinfo);
+		ipt_free_table_info(newinfo);
 		return PTR_ERR(new_table);
 	}
 
@@ -66,6 +66,13 @@ static const struct snmp_mib mptcp_snmp_list[] = {
 	SNMP_MIB_ITEM("RcvWndShared", MPTCP_MIB_RCVWNDSHARED),
 	SNMP_MIB_ITEM("RcvWndConflictUpdate", MPTCP_MIB_RCVWNDCONFLICTUPDATE),
 	SNMP_MIB_ITEM("RcvWndConflict", MPTCP_MIB_RCVWNDCONFLICT),
+	SNMP_MIB_ITEM("SchedDefault", MPTCP_MIB_SCHEDDEFAULT),
+	SNMP_MIB_ITEM("SchedRoundRobin", MPTCP_MIB_SCHEDROUNDROBIN),
+	SNMP_MIB_ITEM("SchedRedundant", MPTCP_MIB_SCHEDREDUNDANT),
+	SNMP_MIB_ITEM("SchedOther", MPTCP_MIB_SCHEDOTHER),
+	SNMP_MIB_ITEM("RedundantSegs", MPTCP_MIB_REDUNDANTSEGS),
+	SNMP_MIB_ITEM("RcvMoved", MPTCP_MIB_RCVMOVED),
+	SNMP_MIB_ITEM("RcvCoalesce", MPTCP_MIB_RCVCOALESCE),
 	SNMP_MIB_SENTINEL
 };
 
@@ -65,6 +65,13 @@ enum linux_mptcp_mib_field {
 					 * conflict with another subflow while updating msk rcv wnd
 					 */
 	MPTCP_MIB_RCVWNDCONFLICT,	/* Conflict with while updating msk rcv wnd */
+	MPTCP_MIB_SCHEDDEFAULT,		/* Connections using the default scheduler */
+	MPTCP_MIB_SCHEDROUNDROBIN,	/* Connections using the round-robin scheduler */
+	MPTCP_MIB_SCHEDREDUNDANT,	/* Connections using the redundant scheduler */
+	MPTCP_MIB_SCHEDOTHER,		/* Connections using a BPF or module scheduler */
+	MPTCP_MIB_REDUNDANTSEGS,	/* Segments sent again on additional scheduled subflows */
+	MPTCP_MIB_RCVMOVED,		/* Skbs moved from the subflows to the msk receive queue */
+	MPTCP_MIB_RCVCOALESCE,		/* Moved skbs coalesced into the previous in-sequence one */
 	__MPTCP_MIB_MAX
 };
 
@@ -88,6 +95,14 @@ static inline void MPTCP_INC_STATS(struct net *net,
 		SNMP_INC_STATS(net->mib.mptcp_statistics, field);
 }
 
+static inline void __MPTCP_ADD_STATS(struct net *net,
+				     enum linux_mptcp_mib_field field,
+				     int val)
+{
+	if (likely(net->mib.mptcp_statistics))
+		__SNMP_ADD_STATS(net->mib.mptcp_statistics, field, val);
+}
+
 static inline void __MPTCP_INC_STATS(struct net *net,
 				     enum linux_mptcp_mib_field field)
 {
@@ -349,7 +349,7 @@ static bool mptcp_rmem_schedule(struct sock *sk, struct sock *ssk, int size)
 
 static bool __mptcp_move_skb(struct mptcp_sock *msk, struct sock *ssk,
 			     struct sk_buff *skb, unsigned int offset,
-			     size_t copy_len)
+			     size_t copy_len, unsigned int *coalesced)
 {
 	struct mptcp_subflow_context *subflow = mptcp_subflow_ctx(ssk);
 	struct sock *sk = (struct sock *)msk;
@@ -381,8 +381,10 @@ static bool __mptcp_move_skb(struct mptcp_sock *msk, struct sock *ssk,
 		msk->bytes_received += copy_len;
 		WRITE_ONCE(msk->ack_seq, msk->ack_seq + copy_len);
 		tail = skb_peek_tail(&sk->sk_receive_queue);
-		if (tail && mptcp_try_coalesce(sk, tail, skb))
+		if (tail && mptcp_try_coalesce(sk, tail, skb)) {
+			(*coalesced)++;
 			return true;
+		}
 
 		mptcp_set_owner_r(skb, sk);
 		__skb_queue_tail(&sk->sk_receive_queue, skb);
@@ -497,7 +499,7 @@ static long mptcp_timeout_from_subflow(const struct mptcp_subflow_context *subfl
 	       inet_csk(ssk)->icsk_timeout - jiffies : 0;
 }
 
-static void mptcp_set_timeout(struct sock *sk)
+void mptcp_set_timeout(struct sock *sk)
 {
 	struct mptcp_subflow_context *subflow;
 	long tout = 0;
@@ -634,6 +636,7 @@ static bool __mptcp_move_skbs_from_subflow(struct mptcp_sock *msk,
 {
 	struct mptcp_subflow_context *subflow = mptcp_subflow_ctx(ssk);
 	struct sock *sk = (struct sock *)msk;
+	unsigned int skbs = 0, coalesced = 0;
 	unsigned int moved = 0;
 	bool more_data_avail;
 	struct tcp_sock *tp;
@@ -696,9 +699,10 @@ static bool __mptcp_move_skbs_from_subflow(struct mptcp_sock *msk,
 			if (tp->urg_data)
 				done = true;
 
-			if (__mptcp_move_skb(msk, ssk, skb, offset, len))
+			if (__mptcp_move_skb(msk, ssk, skb, offset, len, &coalesced))
 				moved += len;
 			seq += len;
+			skbs++;
 
 			if (WARN_ON_ONCE(map_remaining < len))
 				break;
@@ -717,6 +721,13 @@ static bool __mptcp_move_skbs_from_subflow(struct mptcp_sock *msk,
 		}
 	} while (more_data_avail);
 
+	/* account the whole batch at once, we are under the msk data lock */
+	if (skbs) {
+		__MPTCP_ADD_STATS(sock_net(sk), MPTCP_MIB_RCVMOVED, skbs);
+		if (coalesced)
+			__MPTCP_ADD_STATS(sock_net(sk), MPTCP_MIB_RCVCOALESCE, coalesced);
+	}
+
 	*bytes += moved;
 	return done;
 }
@@ -1364,11 +1375,11 @@ bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
 #define SSK_MODE_BACKUP	1
 #define SSK_MODE_MAX	2
 
-/* implement the mptcp packet scheduler;
+/* the default mptcp packet scheduler;
  * returns the subflow that will transmit the next DSS
  * additionally updates the rtx timeout
  */
-static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
+struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 {
 	struct subflow_send_info send_info[SSK_MODE_MAX];
 	struct mptcp_subflow_context *subflow;
@@ -1379,15 +1390,6 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	u64 linger_time;
 	long tout = 0;
 
-	msk_owned_by_me(msk);
-
-	if (__mptcp_check_fallback(msk)) {
-		if (!msk->first)
-			return NULL;
-		return __tcp_can_send(msk->first) &&
-		       sk_stream_memory_free(msk->first) ? msk->first : NULL;
-	}
-
 	/* re-use last subflow, if the burst allow that */
 	if (msk->last_snd && msk->snd_burst > 0 &&
 	    sk_stream_memory_free(msk->last_snd) &&
@@ -1501,64 +1503,162 @@ void mptcp_check_and_set_pending(struct sock *sk)
 		mptcp_sk(sk)->push_pending |= BIT(MPTCP_PUSH_PENDING);
 }
 
-void __mptcp_push_pending(struct sock *sk, unsigned int flags)
+static int mptcp_subflow_scheduled_count(struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+	int nr = 0;
+
+	mptcp_for_each_subflow(msk, subflow)
+		nr += READ_ONCE(subflow->scheduled);
+	return nr;
+}
+
+static int __subflow_push_pending(struct sock *sk, struct sock *ssk,
+				  struct mptcp_sendmsg_info *info)
 {
-	struct sock *prev_ssk = NULL, *ssk = NULL;
 	struct mptcp_sock *msk = mptcp_sk(sk);
-	struct mptcp_sendmsg_info info = {
-				.flags = flags,
-	};
-	bool do_check_data_fin = false;
 	struct mptcp_data_frag *dfrag;
-	int len;
+	int len, copied = 0, err = 0;
 
 	while ((dfrag = mptcp_send_head(sk))) {
-		info.sent = dfrag->already_sent;
-		info.limit = dfrag->data_len;
+		info->sent = dfrag->already_sent;
+		info->limit = dfrag->data_len;
 		len = dfrag->data_len - dfrag->already_sent;
 		while (len > 0) {
 			int ret = 0;
 
-			prev_ssk = ssk;
-			ssk = mptcp_subflow_get_send(msk);
-
-			/* First check. If the ssk has changed since
-			 * the last round, release prev_ssk
-			 */
-			if (ssk != prev_ssk && prev_ssk)
-				mptcp_push_release(prev_ssk, &info);
-			if (!ssk)
-				goto out;
-
-			/* Need to lock the new subflow only if different
-			 * from the previous one, otherwise we are still
-			 * helding the relevant lock
-			 */
-			if (ssk != prev_ssk)
-				lock_sock(ssk);
-
-			ret = mptcp_sendmsg_frag(sk, ssk, dfrag, &info);
+			ret = mptcp_sendmsg_frag(sk, ssk, dfrag, info);
 			if (ret <= 0) {
-				if (ret == -EAGAIN)
-					continue;
-				mptcp_push_release(ssk, &info);
+				err = copied ? : ret;
 				goto out;
 			}
 
-			do_check_data_fin = true;
-			info.sent += ret;
+			info->sent += ret;
+			copied += ret;
 			len -= ret;
 
 			mptcp_update_post_push(msk, dfrag, ret);
 		}
 		WRITE_ONCE(msk->first_pending, mptcp_send_next(sk));
+
+		/* go back to the scheduler once the burst is over */
+		if (msk->snd_burst <= 0 ||
+		    !sk_stream_memory_free(ssk) ||
+		    !mptcp_subflow_active(mptcp_subflow_ctx(ssk))) {
+			err = copied;
+			goto out;
+		}
+		mptcp_set_timeout(sk);
+	}
+	err = copied;
+
+out:
+	return err;
+}
+
+/* the scheduler picked more than one subflow: send again on @ssk the data
+ * pushed in the current round on the first one, starting at @dfrag offset
+ * @sent. The msk-level sequence numbers have already been updated.
+ */
+static int __subflow_push_redundant(struct sock *sk, struct sock *ssk,
+				    struct mptcp_data_frag *dfrag, u16 sent,
+				    struct mptcp_sendmsg_info *info)
+{
+	struct mptcp_sock *msk = mptcp_sk(sk);
+	int copied = 0;
+
+	list_for_each_entry_from(dfrag, &msk->rtx_queue, list) {
+		if (dfrag->already_sent <= sent)
+			break;
+
+		info->sent = sent;
+		info->limit = dfrag->already_sent;
+		while (info->sent < info->limit) {
+			int ret = mptcp_sendmsg_frag(sk, ssk, dfrag, info);
+
+			if (ret <= 0)
+				goto out;
+
+			MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_REDUNDANTSEGS);
+			info->sent += ret;
+			copied += ret;
+		}
+		sent = 0;
+	}
+
+out:
+	return copied;
+}
+
+void __mptcp_push_pending(struct sock *sk, unsigned int flags)
+{
+	struct sock *prev_ssk = NULL, *ssk = NULL;
+	struct mptcp_sock *msk = mptcp_sk(sk);
+	struct mptcp_sendmsg_info info = {
+				.flags = flags,
+	};
+	bool do_check_data_fin = false;
+	int push_count = 1;
+
+	/* each round sends on the subflow(s) picked by the scheduler, until
+	 * no picked subflow makes progress any more
+	 */
+	while (mptcp_send_head(sk) && (push_count > 0)) {
+		struct mptcp_subflow_context *subflow;
+		struct mptcp_data_frag *head;
+		bool pushed = false;
+		u16 head_sent;
+		int ret = 0;
+
+		if (mptcp_sched_get_send(msk))
+			break;
+
+		head = mptcp_send_head(sk);
+		head_sent = head->already_sent;
+		push_count = 0;
+
+		mptcp_for_each_subflow(msk, subflow) {
+			if (!READ_ONCE(subflow->scheduled))
+				continue;
+
+			mptcp_subflow_set_scheduled(subflow, false);
+
+			prev_ssk = ssk;
+			ssk = mptcp_subflow_tcp_sock(subflow);
+			if (ssk != prev_ssk) {
+				/* First check. If the ssk has changed since
+				 * the last round, release prev_ssk
+				 */
+				if (prev_ssk)
+					mptcp_push_release(prev_ssk, &info);
+
+				/* Need to lock the new subflow only if different
+				 * from the previous one, otherwise we are still
+				 * helding the relevant lock
+				 */
+				lock_sock(ssk);
+			}
+
+			/* only the first subflow making progress sends new data */
+			if (pushed) {
+				__subflow_push_redundant(sk, ssk, head, head_sent, &info);
+				continue;
+			}
+
+			ret = __subflow_push_pending(sk, ssk, &info);
+			if (ret <= 0)
+				continue;
+
+			push_count++;
+			do_check_data_fin = true;
+			pushed = true;
+		}
 	}
 
 	/* at this point we held the socket lock for the last subflow we used */
 	if (ssk)
 		mptcp_push_release(ssk, &info);
 
-out:
 	/* ensure the rtx timer is running */
 	if (!mptcp_timer_pending(sk))
 		mptcp_reset_timer(sk);
@@ -1572,42 +1672,55 @@ static void __mptcp_subflow_push_pending(struct sock *sk, struct sock *ssk, bool
 	struct mptcp_sendmsg_info info = {
 		.data_lock_held = true,
 	};
-	struct mptcp_data_frag *dfrag;
-	struct sock *xmit_ssk;
-	int len, copied = 0;
+	bool keep_pushing = true;
+	int copied = 0;
 
 	info.flags = 0;
-	while ((dfrag = mptcp_send_head(sk))) {
-		info.sent = dfrag->already_sent;
-		info.limit = dfrag->data_len;
-		len = dfrag->data_len - dfrag->already_sent;
-		while (len > 0) {
-			int ret = 0;
+	while (mptcp_send_head(sk) && keep_pushing) {
+		struct mptcp_subflow_context *subflow = mptcp_subflow_ctx(ssk);
+		int ret = 0;
 
-			/* check for a different subflow usage only after
-			 * spooling the first chunk of data
-			 */
-			xmit_ssk = first ? ssk : mptcp_subflow_get_send(msk);
-			if (!xmit_ssk)
-				goto out;
-			if (xmit_ssk != ssk) {
-				mptcp_subflow_delegate(mptcp_subflow_ctx(xmit_ssk),
-						       MPTCP_DELEGATE_SEND);
-				goto out;
-			}
-
-			ret = mptcp_sendmsg_frag(sk, ssk, dfrag, &info);
+		/* check for a different subflow usage only after
+		 * spooling the first chunk of data
+		 */
+		if (first) {
+			mptcp_subflow_set_scheduled(subflow, false);
+			ret = __subflow_push_pending(sk, ssk, &info);
+			first = false;
 			if (ret <= 0)
-				goto out;
+				break;
+			copied += ret;
+			continue;
+		}
 
-			info.sent += ret;
+		if (mptcp_sched_get_send(msk))
+			goto out;
+
+		/* redundant copies need the subflows lock in turn: leave
+		 * them to the msk owner
+		 */
+		if (mptcp_subflow_scheduled_count(msk) > 1) {
+			mptcp_check_and_set_pending(sk);
+			mptcp_schedule_work(sk);
+			goto out;
+		}
+
+		if (READ_ONCE(subflow->scheduled)) {
+			mptcp_subflow_set_scheduled(subflow, false);
+			ret = __subflow_push_pending(sk, ssk, &info);
+			if (ret <= 0)
+				break;
 			copied += ret;
-			len -= ret;
-			first = false;
+			continue;
+		}
 
-			mptcp_update_post_push(msk, dfrag, ret);
+		mptcp_for_each_subflow(msk, subflow) {
+			if (READ_ONCE(subflow->scheduled)) {
+				mptcp_subflow_delegate(subflow, MPTCP_DELEGATE_SEND);
+				break;
+			}
 		}
-		WRITE_ONCE(msk->first_pending, mptcp_send_next(sk));
+		keep_pushing = false;
 	}
 
 out:
@@ -1986,6 +2099,22 @@ static void __mptcp_update_rmem(struct sock *sk)
 static void __mptcp_splice_receive_queue(struct sock *sk)
 {
 	struct mptcp_sock *msk = mptcp_sk(sk);
+	struct sk_buff *tail, *skb;
+
+	/* both queues are in sequence: merge the first moved skb into
+	 * the partially read one, if any, to keep the reader to a
+	 * single copy call per chunk
+	 */
+	tail = skb_peek_tail(&msk->receive_queue);
+	skb = skb_peek(&sk->sk_receive_queue);
+	if (tail && skb &&
+	    MPTCP_SKB_CB(skb)->map_seq == MPTCP_SKB_CB(tail)->end_seq) {
+		__skb_unlink(skb, &sk->sk_receive_queue);
+		if (mptcp_try_coalesce(sk, tail, skb))
+			__MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_RCVCOALESCE);
+		else
+			__skb_queue_head(&sk->sk_receive_queue, skb);
+	}
 
 	skb_queue_splice_tail_init(&sk->sk_receive_queue, &msk->receive_queue);
 }
@@ -1994,7 +2123,7 @@ static bool __mptcp_move_skbs(struct mptcp_sock *msk)
 {
 	struct sock *sk = (struct sock *)msk;
 	unsigned int moved = 0;
-	bool ret, done;
+	bool ret = false, done;
 
 	do {
 		struct sock *ssk = mptcp_subflow_recv_lookup(msk);
@@ -2011,6 +2140,12 @@ static bool __mptcp_move_skbs(struct mptcp_sock *msk)
 		mptcp_data_lock(sk);
 		__mptcp_update_rmem(sk);
 		done = __mptcp_move_skbs_from_subflow(msk, ssk, &moved);
+
+		/* flush to the msk queue while still holding the data lock,
+		 * instead of re-acquiring it below
+		 */
+		ret |= __mptcp_ofo_queue(msk);
+		__mptcp_splice_receive_queue(sk);
 		mptcp_data_unlock(sk);
 
 		if (unlikely(ssk->sk_err))
@@ -2019,7 +2154,7 @@ static bool __mptcp_move_skbs(struct mptcp_sock *msk)
 	} while (!done);
 
 	/* acquire the data lock only if some input data is pending */
-	ret = moved > 0;
+	ret |= moved > 0;
 	if (!RB_EMPTY_ROOT(&msk->out_of_order_queue) ||
 	    !skb_queue_empty_lockless(&sk->sk_receive_queue)) {
 		mptcp_data_lock(sk);
@@ -2202,17 +2337,12 @@ static void mptcp_timeout_timer(struct timer_list *t)
  *
  * A backup subflow is returned only if that is the only kind available.
  */
-static struct sock *mptcp_subflow_get_retrans(struct mptcp_sock *msk)
+struct sock *mptcp_subflow_get_retrans(struct mptcp_sock *msk)
 {
 	struct sock *backup = NULL, *pick = NULL;
 	struct mptcp_subflow_context *subflow;
 	int min_stale_count = INT_MAX;
 
-	msk_owned_by_me(msk);
-
-	if (__mptcp_check_fallback(msk))
-		return NULL;
-
 	mptcp_for_each_subflow(msk, subflow) {
 		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
 
@@ -2502,16 +2632,17 @@ static void mptcp_check_fastclose(struct mptcp_sock *msk)
 static void __mptcp_retrans(struct sock *sk)
 {
 	struct mptcp_sock *msk = mptcp_sk(sk);
+	struct mptcp_subflow_context *subflow;
 	struct mptcp_sendmsg_info info = {};
 	struct mptcp_data_frag *dfrag;
-	size_t copied = 0;
 	struct sock *ssk;
-	int ret;
+	int ret, err;
+	u16 len = 0;
 
 	mptcp_clean_una_wakeup(sk);
 
 	/* first check ssk: need to kick "stale" logic */
-	ssk = mptcp_subflow_get_retrans(msk);
+	err = mptcp_sched_get_retrans(msk);
 	dfrag = mptcp_rtx_head(sk);
 	if (!dfrag) {
 		if (mptcp_data_fin_enabled(msk)) {
@@ -2530,32 +2661,44 @@ static void __mptcp_retrans(struct sock *sk)
 		goto reset_timer;
 	}
 
-	if (!ssk)
+	if (err)
 		goto reset_timer;
 
-	lock_sock(ssk);
+	mptcp_for_each_subflow(msk, subflow) {
+		u16 copied = 0;
 
-	/* limit retransmission to the bytes already sent on some subflows */
-	info.sent = 0;
-	info.limit = READ_ONCE(msk->csum_enabled) ? dfrag->data_len : dfrag->already_sent;
-	while (info.sent < info.limit) {
-		ret = mptcp_sendmsg_frag(sk, ssk, dfrag, &info);
-		if (ret <= 0)
-			break;
+		if (!READ_ONCE(subflow->scheduled))
+			continue;
 
-		MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_RETRANSSEGS);
-		copied += ret;
-		info.sent += ret;
-	}
-	if (copied) {
-		dfrag->already_sent = max(dfrag->already_sent, info.sent);
-		msk->bytes_retrans += copied;
-		tcp_push(ssk, 0, info.mss_now, tcp_sk(ssk)->nonagle,
-			 info.size_goal);
-		WRITE_ONCE(msk->allow_infinite_fallback, false);
+		mptcp_subflow_set_scheduled(subflow, false);
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		lock_sock(ssk);
+
+		/* limit retransmission to the bytes already sent on some subflows */
+		info.sent = 0;
+		info.limit = READ_ONCE(msk->csum_enabled) ? dfrag->data_len :
+							    dfrag->already_sent;
+		while (info.sent < info.limit) {
+			ret = mptcp_sendmsg_frag(sk, ssk, dfrag, &info);
+			if (ret <= 0)
+				break;
+
+			MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_RETRANSSEGS);
+			copied += ret;
+			info.sent += ret;
+		}
+		if (copied) {
+			len = max(copied, len);
+			tcp_push(ssk, 0, info.mss_now, tcp_sk(ssk)->nonagle,
+				 info.size_goal);
+			WRITE_ONCE(msk->allow_infinite_fallback, false);
+		}
+
+		release_sock(ssk);
 	}
 
-	release_sock(ssk);
+	msk->bytes_retrans += len;
+	dfrag->already_sent = max(dfrag->already_sent, len);
 
 reset_timer:
 	mptcp_check_and_set_pending(sk);
@@ -2684,6 +2827,7 @@ static int __mptcp_init_sock(struct sock *sk)
 	WRITE_ONCE(msk->allow_infinite_fallback, true);
 	msk->recovery = false;
 	msk->subflow_id = 1;
+	msk->sched = NULL;
 
 	mptcp_pm_data_init(msk);
 
@@ -2721,6 +2865,13 @@ static int mptcp_init_sock(struct sock *sk)
 	if (unlikely(!net->mib.mptcp_statistics) && !mptcp_mib_alloc(net))
 		return -ENOMEM;
 
+	rcu_read_lock();
+	ret = mptcp_init_sched(mptcp_sk(sk),
+			       mptcp_sched_find(mptcp_get_scheduler(net)));
+	rcu_read_unlock();
+	if (ret)
+		return ret;
+
 	set_bit(SOCK_CUSTOM_SOCKOPT, &sk->sk_socket->flags);
 
 	/* fetch the ca name; do it outside __mptcp_init_sock(), so that clone will
@@ -3126,6 +3277,9 @@ struct sock *mptcp_sk_clone_init(const struct sock *sk,
 	/* passive msk is created after the first/MPC subflow */
 	msk->subflow_id = 2;
 
+	/* inherit the listener scheduler, or use the default one on failure */
+	mptcp_init_sched(msk, mptcp_sk(sk)->sched);
+
 	sock_reset_flag(nsk, SOCK_RCU_FREE);
 	security_inet_csk_clone(nsk, req);
 
@@ -3247,6 +3401,7 @@ void mptcp_destroy_common(struct mptcp_sock *msk, unsigned int flags)
 	mptcp_token_destroy(msk);
 	mptcp_pm_free_anno_list(msk);
 	mptcp_free_local_addr_list(msk);
+	mptcp_release_sched(msk);
 }
 
 static void mptcp_destroy(struct sock *sk)
@@ -3935,6 +4090,7 @@ void __init mptcp_proto_init(void)
 
 	mptcp_subflow_init();
 	mptcp_pm_init();
+	mptcp_sched_init();
 	mptcp_token_init();
 
 	if (proto_register(&mptcp_prot, 1) != 0)
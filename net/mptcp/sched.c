@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Multipath TCP
+ *
+ * Packet schedulers: pick the subflow(s) used for the next transmission.
+ */
+
+#define pr_fmt(fmt) "MPTCP: " fmt
+
+#include <linux/bpf.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
+#include "protocol.h"
+#include "mib.h"
+
+static DEFINE_SPINLOCK(mptcp_sched_list_lock);
+static LIST_HEAD(mptcp_sched_list);
+
+static int mptcp_sched_default_get_subflow(struct mptcp_sock *msk,
+					   struct mptcp_sched_data *data)
+{
+	struct sock *ssk;
+
+	ssk = data->reinject ? mptcp_subflow_get_retrans(msk) :
+			       mptcp_subflow_get_send(msk);
+	if (!ssk)
+		return -EINVAL;
+
+	mptcp_subflow_set_scheduled(mptcp_subflow_ctx(ssk), true);
+	return 0;
+}
+
+static struct mptcp_sched_ops mptcp_sched_default = {
+	.get_subflow	= mptcp_sched_default_get_subflow,
+	.name		= "default",
+	.owner		= THIS_MODULE,
+};
+
+static bool mptcp_sched_can_xmit(struct mptcp_subflow_context *subflow)
+{
+	return mptcp_subflow_active(subflow) &&
+	       sk_stream_memory_free(mptcp_subflow_tcp_sock(subflow));
+}
+
+/* hand over the next chunk to the first usable subflow following the last
+ * one used; backup subflows are used only if nothing else is usable
+ */
+static int mptcp_sched_rr_get_subflow(struct mptcp_sock *msk,
+				      struct mptcp_sched_data *data)
+{
+	struct mptcp_subflow_context *subflow, *pick = NULL, *backup = NULL;
+	struct sock *sk = (struct sock *)msk;
+	int i, last = -1;
+
+	if (data->reinject)
+		return mptcp_sched_default_get_subflow(msk, data);
+
+	if (!data->subflows)
+		return -EINVAL;
+
+	for (i = 0; i < data->subflows; i++) {
+		if (mptcp_subflow_tcp_sock(data->contexts[i]) == msk->last_snd) {
+			last = i;
+			break;
+		}
+	}
+
+	for (i = 1; i <= data->subflows; i++) {
+		subflow = data->contexts[(last + i) % data->subflows];
+		if (!mptcp_sched_can_xmit(subflow))
+			continue;
+
+		if (!subflow->backup) {
+			pick = subflow;
+			break;
+		}
+		if (!backup)
+			backup = subflow;
+	}
+
+	pick = pick ? : backup;
+	if (!pick)
+		return -EINVAL;
+
+	/* a single dfrag per round */
+	msk->last_snd = mptcp_subflow_tcp_sock(pick);
+	msk->snd_burst = 0;
+	mptcp_set_timeout(sk);
+	mptcp_subflow_set_scheduled(pick, true);
+	return 0;
+}
+
+static struct mptcp_sched_ops mptcp_sched_rr = {
+	.get_subflow	= mptcp_sched_rr_get_subflow,
+	.name		= "roundrobin",
+	.owner		= THIS_MODULE,
+};
+
+/* send the same data on all the usable subflows; as for the default
+ * scheduler backup subflows are used only if no other subflow is usable.
+ * Retransmissions still go on a single subflow.
+ */
+static int mptcp_sched_red_get_subflow(struct mptcp_sock *msk,
+				       struct mptcp_sched_data *data)
+{
+	struct mptcp_subflow_context *subflow;
+	bool backup = false;
+	int i, nr = 0;
+
+	if (data->reinject)
+		return mptcp_sched_default_get_subflow(msk, data);
+
+again:
+	for (i = 0; i < data->subflows; i++) {
+		subflow = data->contexts[i];
+		if (subflow->backup != backup || !mptcp_sched_can_xmit(subflow))
+			continue;
+
+		mptcp_subflow_set_scheduled(subflow, true);
+		nr++;
+	}
+
+	if (!nr && !backup) {
+		backup = true;
+		goto again;
+	}
+	if (!nr)
+		return -EINVAL;
+
+	mptcp_set_timeout((struct sock *)msk);
+	return 0;
+}
+
+static struct mptcp_sched_ops mptcp_sched_red = {
+	.get_subflow	= mptcp_sched_red_get_subflow,
+	.name		= "redundant",
+	.owner		= THIS_MODULE,
+};
+
+/* Must be called with rcu read lock held */
+struct mptcp_sched_ops *mptcp_sched_find(const char *name)
+{
+	struct mptcp_sched_ops *sched, *ret = NULL;
+
+	list_for_each_entry_rcu(sched, &mptcp_sched_list, list) {
+		if (!strcmp(sched->name, name)) {
+			ret = sched;
+			break;
+		}
+	}
+
+	return ret;
+}
+
+/* Build string with list of available scheduler values.
+ * Similar to tcp_get_available_congestion_control()
+ */
+void mptcp_get_available_schedulers(char *buf, size_t maxlen)
+{
+	struct mptcp_sched_ops *sched;
+	size_t offs = 0;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(sched, &mptcp_sched_list, list) {
+		offs += snprintf(buf + offs, maxlen - offs,
+				 "%s%s",
+				 offs == 0 ? "" : " ", sched->name);
+
+		if (WARN_ON_ONCE(offs >= maxlen))
+			break;
+	}
+	rcu_read_unlock();
+}
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched)
+{
+	if (!sched->get_subflow)
+		return -EINVAL;
+
+	spin_lock(&mptcp_sched_list_lock);
+	if (mptcp_sched_find(sched->name)) {
+		spin_unlock(&mptcp_sched_list_lock);
+		return -EEXIST;
+	}
+	list_add_tail_rcu(&sched->list, &mptcp_sched_list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	pr_debug("%s registered", sched->name);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(mptcp_register_scheduler);
+
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched)
+{
+	if (sched == &mptcp_sched_default)
+		return;
+
+	spin_lock(&mptcp_sched_list_lock);
+	list_del_rcu(&sched->list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	/* msk holding a reference keep using the ops until released */
+	synchronize_rcu();
+}
+EXPORT_SYMBOL_GPL(mptcp_unregister_scheduler);
+
+void mptcp_sched_init(void)
+{
+	mptcp_register_scheduler(&mptcp_sched_default);
+	mptcp_register_scheduler(&mptcp_sched_rr);
+	mptcp_register_scheduler(&mptcp_sched_red);
+}
+
+int mptcp_init_sched(struct mptcp_sock *msk,
+		     struct mptcp_sched_ops *sched)
+{
+	enum linux_mptcp_mib_field mib;
+
+	if (!sched)
+		sched = &mptcp_sched_default;
+
+	if (!bpf_try_module_get(sched, sched->owner))
+		return -EBUSY;
+
+	msk->sched = sched;
+	if (msk->sched->init)
+		msk->sched->init(msk);
+
+	if (sched == &mptcp_sched_default)
+		mib = MPTCP_MIB_SCHEDDEFAULT;
+	else if (sched == &mptcp_sched_rr)
+		mib = MPTCP_MIB_SCHEDROUNDROBIN;
+	else if (sched == &mptcp_sched_red)
+		mib = MPTCP_MIB_SCHEDREDUNDANT;
+	else
+		mib = MPTCP_MIB_SCHEDOTHER;
+	MPTCP_INC_STATS(sock_net((struct sock *)msk), mib);
+
+	pr_debug("sched=%s", msk->sched->name);
+
+	return 0;
+}
+
+void mptcp_release_sched(struct mptcp_sock *msk)
+{
+	struct mptcp_sched_ops *sched = msk->sched;
+
+	if (!sched)
+		return;
+
+	msk->sched = NULL;
+	if (sched->release)
+		sched->release(msk);
+
+	bpf_module_put(sched, sched->owner);
+}
+
+void mptcp_subflow_set_scheduled(struct mptcp_subflow_context *subflow,
+				 bool scheduled)
+{
+	WRITE_ONCE(subflow->scheduled, scheduled);
+}
+
+static void mptcp_sched_data_set_contexts(const struct mptcp_sock *msk,
+					  struct mptcp_sched_data *data)
+{
+	struct mptcp_subflow_context *subflow;
+	int i = 0;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		if (i == MPTCP_SUBFLOWS_MAX) {
+			pr_warn_once("too many subflows");
+			break;
+		}
+		data->contexts[i++] = subflow;
+	}
+	data->subflows = i;
+
+	for (; i < MPTCP_SUBFLOWS_MAX; i++)
+		data->contexts[i] = NULL;
+}
+
+static int mptcp_sched_get_subflow(struct mptcp_sock *msk, bool reinject)
+{
+	struct mptcp_subflow_context *subflow;
+	struct mptcp_sched_data data;
+
+	/* a previous pick has not been consumed yet */
+	mptcp_for_each_subflow(msk, subflow) {
+		if (READ_ONCE(subflow->scheduled))
+			return 0;
+	}
+
+	data.reinject = reinject;
+	if (!msk->sched || msk->sched == &mptcp_sched_default)
+		return mptcp_sched_default_get_subflow(msk, &data);
+
+	mptcp_sched_data_set_contexts(msk, &data);
+	return msk->sched->get_subflow(msk, &data);
+}
+
+int mptcp_sched_get_send(struct mptcp_sock *msk)
+{
+	msk_owned_by_me(msk);
+
+	/* fallback sockets can only use the first subflow */
+	if (__mptcp_check_fallback(msk)) {
+		if (msk->first &&
+		    __tcp_can_send(msk->first) &&
+		    sk_stream_memory_free(msk->first)) {
+			mptcp_subflow_set_scheduled(mptcp_subflow_ctx(msk->first), true);
+			return 0;
+		}
+		return -EINVAL;
+	}
+
+	return mptcp_sched_get_subflow(msk, false);
+}
+
+int mptcp_sched_get_retrans(struct mptcp_sock *msk)
+{
+	msk_owned_by_me(msk);
+
+	if (__mptcp_check_fallback(msk))
+		return -EINVAL;
+
+	return mptcp_sched_get_subflow(msk, true);
+}
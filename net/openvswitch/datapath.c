@@ -168,6 +168,7 @@ static void destroy_dp_rcu(struct rcu_head *rcu)
 
 	ovs_flow_tbl_destroy(&dp->table);
 	free_percpu(dp->stats_percpu);
+	free_percpu(dp->upcall_limit);
 	kfree(dp->ports);
 	ovs_meters_exit(dp);
 	kfree(rcu_dereference_raw(dp->upcall_portids));
@@ -241,6 +242,61 @@ void ovs_dp_detach_port(struct vport *p)
 	ovs_vport_del(p);
 }
 
+/* Decide whether a flow miss is sent to userspace.  With
+ * OVS_DP_F_UPCALL_DEDUP, more misses of a flow which just had
+ * DP_UPCALL_DEDUP_BURST upcalls are dropped: the flow being set up for the
+ * first ones will take care of the next packets.  A flow is told apart by
+ * the packet hash, input port and recirculation id, packets without a hash
+ * are never deduplicated.  On top of that, the upcall rate limits the misses
+ * of each CPU.
+ *
+ * Must be called with rcu_read_lock and BH disabled.
+ */
+static bool ovs_dp_upcall_allowed(struct datapath *dp,
+				  const struct sw_flow_key *key, u32 skb_hash)
+{
+	struct dp_upcall_limit_percpu *limit = this_cpu_ptr(dp->upcall_limit);
+	u32 rate = READ_ONCE(dp->upcall_rate);
+	unsigned long now = jiffies;
+
+	if (dp->user_features & OVS_DP_F_UPCALL_DEDUP && skb_hash) {
+		u32 hash = jhash_3words(skb_hash, key->phy.in_port,
+					key->recirc_id, 0);
+		struct dp_upcall_dedup *e;
+
+		e = &limit->dedup[hash % DP_UPCALL_DEDUP_ENTRIES];
+		if (e->skb_hash != skb_hash ||
+		    e->in_port != key->phy.in_port ||
+		    e->recirc_id != key->recirc_id ||
+		    time_after(now, e->start + DP_UPCALL_DEDUP_WINDOW)) {
+			e->skb_hash = skb_hash;
+			e->in_port = key->phy.in_port;
+			e->recirc_id = key->recirc_id;
+			e->start = now;
+			e->count = 0;
+		}
+		if (e->count >= DP_UPCALL_DEDUP_BURST)
+			return false;
+		e->count++;
+	}
+
+	if (rate) {
+		unsigned long elapsed = min_t(unsigned long,
+					      now - limit->last_refill, HZ);
+		u64 refill = div_u64((u64)elapsed * rate, HZ);
+
+		if (refill) {
+			limit->tokens = min_t(u64, limit->tokens + refill, rate);
+			limit->last_refill = now;
+		}
+		if (!limit->tokens)
+			return false;
+		limit->tokens--;
+	}
+
+	return true;
+}
+
 /* Must be called with rcu_read_lock. */
 void ovs_dp_process_packet(struct sk_buff *skb, struct sw_flow_key *key)
 {
@@ -252,16 +308,27 @@ void ovs_dp_process_packet(struct sk_buff *skb, struct sw_flow_key *key)
 	u64 *stats_counter;
 	u32 n_mask_hit;
 	u32 n_cache_hit;
+	u32 skb_hash;
 	int error;
 
 	stats = this_cpu_ptr(dp->stats_percpu);
 
 	/* Look up flow. */
-	flow = ovs_flow_tbl_lookup_stats(&dp->table, key, skb_get_hash(skb),
+	skb_hash = skb_get_hash(skb);
+	flow = ovs_flow_tbl_lookup_stats(&dp->table, key, skb_hash,
 					 &n_mask_hit, &n_cache_hit);
 	if (unlikely(!flow)) {
 		struct dp_upcall_info upcall;
 
+		if (!ovs_dp_upcall_allowed(dp, key, skb_hash)) {
+			kfree_skb(skb);
+			u64_stats_update_begin(&stats->syncp);
+			stats->n_lost++;
+			u64_stats_update_end(&stats->syncp);
+			stats_counter = &stats->n_missed;
+			goto out;
+		}
+
 		memset(&upcall, 0, sizeof(upcall));
 		upcall.cmd = OVS_PACKET_CMD_MISS;
 
@@ -796,7 +863,8 @@ static size_t ovs_flow_cmd_msg_size(const struct sw_flow_actions *acts,
 	return len
 		+ nla_total_size_64bit(sizeof(struct ovs_flow_stats)) /* OVS_FLOW_ATTR_STATS */
 		+ nla_total_size(1) /* OVS_FLOW_ATTR_TCP_FLAGS */
-		+ nla_total_size_64bit(8); /* OVS_FLOW_ATTR_USED */
+		+ nla_total_size_64bit(8) /* OVS_FLOW_ATTR_USED */
+		+ nla_total_size_64bit(8); /* OVS_FLOW_ATTR_MASK_HITS */
 }
 
 /* Called with ovs_mutex or RCU read lock. */
@@ -806,8 +874,10 @@ static int ovs_flow_cmd_fill_stats(const struct sw_flow *flow,
 	struct ovs_flow_stats stats;
 	__be16 tcp_flags;
 	unsigned long used;
+	u64 mask_hits;
 
 	ovs_flow_stats_get(flow, &stats, &used, &tcp_flags);
+	mask_hits = flow->mask ? READ_ONCE(flow->mask->n_hit) : 0;
 
 	if (used &&
 	    nla_put_u64_64bit(skb, OVS_FLOW_ATTR_USED, ovs_flow_used_time(used),
@@ -824,6 +894,11 @@ static int ovs_flow_cmd_fill_stats(const struct sw_flow *flow,
 	     nla_put_u8(skb, OVS_FLOW_ATTR_TCP_FLAGS, (u8)ntohs(tcp_flags)))
 		return -EMSGSIZE;
 
+	if (mask_hits &&
+	    nla_put_u64_64bit(skb, OVS_FLOW_ATTR_MASK_HITS, mask_hits,
+			      OVS_FLOW_ATTR_PAD))
+		return -EMSGSIZE;
+
 	return 0;
 }
 
@@ -1555,6 +1630,7 @@ static size_t ovs_dp_cmd_msg_size(void)
 	msgsize += nla_total_size_64bit(sizeof(struct ovs_dp_megaflow_stats));
 	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_USER_FEATURES */
 	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_MASKS_CACHE_SIZE */
+	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_UPCALL_RATE */
 	msgsize += nla_total_size(sizeof(u32) * nr_cpu_ids); /* OVS_DP_ATTR_PER_CPU_PIDS */
 
 	return msgsize;
@@ -1598,6 +1674,9 @@ static int ovs_dp_cmd_fill_info(struct datapath *dp, struct sk_buff *skb,
 			ovs_flow_tbl_masks_cache_size(&dp->table)))
 		goto nla_put_failure;
 
+	if (nla_put_u32(skb, OVS_DP_ATTR_UPCALL_RATE, dp->upcall_rate))
+		goto nla_put_failure;
+
 	if (dp->user_features & OVS_DP_F_DISPATCH_UPCALL_PER_CPU && pids) {
 		pids_len = min(pids->n_pids, nr_cpu_ids) * sizeof(u32);
 		if (nla_put(skb, OVS_DP_ATTR_PER_CPU_PIDS, pids_len, &pids->pids))
@@ -1714,7 +1793,8 @@ static int ovs_dp_change(struct datapath *dp, struct nlattr *a[])
 		if (user_features & ~(OVS_DP_F_VPORT_PIDS |
 				      OVS_DP_F_UNALIGNED |
 				      OVS_DP_F_TC_RECIRC_SHARING |
-				      OVS_DP_F_DISPATCH_UPCALL_PER_CPU))
+				      OVS_DP_F_DISPATCH_UPCALL_PER_CPU |
+				      OVS_DP_F_UPCALL_DEDUP))
 			return -EOPNOTSUPP;
 
 #if !IS_ENABLED(CONFIG_NET_TC_SKB_EXT)
@@ -1733,6 +1813,10 @@ static int ovs_dp_change(struct datapath *dp, struct nlattr *a[])
 			return err;
 	}
 
+	if (a[OVS_DP_ATTR_UPCALL_RATE])
+		WRITE_ONCE(dp->upcall_rate,
+			   nla_get_u32(a[OVS_DP_ATTR_UPCALL_RATE]));
+
 	dp->user_features = user_features;
 
 	if (dp->user_features & OVS_DP_F_DISPATCH_UPCALL_PER_CPU &&
@@ -1760,6 +1844,12 @@ static int ovs_dp_stats_init(struct datapath *dp)
 	if (!dp->stats_percpu)
 		return -ENOMEM;
 
+	dp->upcall_limit = alloc_percpu(struct dp_upcall_limit_percpu);
+	if (!dp->upcall_limit) {
+		free_percpu(dp->stats_percpu);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -1877,6 +1967,7 @@ static int ovs_dp_cmd_new(struct sk_buff *skb, struct genl_info *info)
 	kfree(dp->ports);
 err_destroy_stats:
 	free_percpu(dp->stats_percpu);
+	free_percpu(dp->upcall_limit);
 err_destroy_table:
 	ovs_flow_tbl_destroy(&dp->table);
 err_destroy_dp:
@@ -2050,6 +2141,7 @@ static const struct nla_policy datapath_policy[OVS_DP_ATTR_MAX + 1] = {
 	[OVS_DP_ATTR_MASKS_CACHE_SIZE] =  NLA_POLICY_RANGE(NLA_U32, 0,
 		PCPU_MIN_UNIT_SIZE / sizeof(struct mask_cache_entry)),
 	[OVS_DP_ATTR_IFINDEX] = {.type = NLA_U32 },
+	[OVS_DP_ATTR_UPCALL_RATE] = { .type = NLA_U32 },
 };
 
 static const struct genl_small_ops dp_datapath_genl_ops[] = {
@@ -50,6 +50,39 @@ struct dp_stats_percpu {
 	struct u64_stats_sync syncp;
 };
 
+#define DP_UPCALL_DEDUP_ENTRIES	64
+#define DP_UPCALL_DEDUP_BURST	4
+#define DP_UPCALL_DEDUP_WINDOW	max_t(unsigned long, HZ / 100, 1)
+
+/**
+ * struct dp_upcall_dedup - recent flow miss upcalls of a flow
+ * @skb_hash: Packet hash of the flow.
+ * @in_port: Input port of the flow.
+ * @recirc_id: Recirculation id of the flow.
+ * @count: Number of upcalls sent for the flow since @start.
+ * @start: Start (jiffies) of the current window.
+ */
+struct dp_upcall_dedup {
+	u32 skb_hash;
+	u16 in_port;
+	u32 recirc_id;
+	u32 count;
+	unsigned long start;
+};
+
+/**
+ * struct dp_upcall_limit_percpu - per CPU state to limit flow miss upcalls
+ * @tokens: Upcalls left in the token bucket, refilled at the upcall rate of
+ * the datapath.
+ * @last_refill: Time (jiffies) of the last refill of @tokens.
+ * @dedup: Recent upcalls indexed by flow hash.
+ */
+struct dp_upcall_limit_percpu {
+	u32 tokens;
+	unsigned long last_refill;
+	struct dp_upcall_dedup dedup[DP_UPCALL_DEDUP_ENTRIES];
+};
+
 /**
  * struct dp_nlsk_pids - array of netlink portids of for a datapath.
  *                       This is used when OVS_DP_F_DISPATCH_UPCALL_PER_CPU
@@ -77,6 +110,8 @@ struct dp_nlsk_pids {
  * @max_headroom: the maximum headroom of all vports in this datapath; it will
  * be used by all the internal vports in this dp.
  * @upcall_portids: RCU protected 'struct dp_nlsk_pids'.
+ * @upcall_rate: Maximum flow miss upcalls per second and CPU, 0 for no limit.
+ * @upcall_limit: Per-CPU state for @upcall_rate and %OVS_DP_F_UPCALL_DEDUP.
  *
  * Context: See the comment on locking at the top of datapath.c for additional
  * locking information.
@@ -105,6 +140,10 @@ struct datapath {
 	struct dp_meter_table meter_tbl;
 
 	struct dp_nlsk_pids __rcu *upcall_portids;
+
+	/* Flow miss upcall limits. */
+	u32 upcall_rate;
+	struct dp_upcall_limit_percpu __percpu *upcall_limit;
 };
 
 /**
@@ -180,11 +180,22 @@ struct sw_flow_key_range {
 	unsigned short int end;
 };
 
+/* Number of buckets of the per mask stage filter, must be a power of 2 */
+#define SW_FLOW_MASK_STAGE_BUCKETS	512
+
 struct sw_flow_mask {
 	int ref_count;
 	struct rcu_head rcu;
 	struct sw_flow_key_range range;
 	struct sw_flow_key key;
+	/* Only for masks in a flow table: */
+	u64 n_hit;			/* Lookups matched, as of the last
+					 * rebalance or mask array change.
+					 */
+	unsigned short int stage_end;	/* End of the key range hashed into
+					 * 'stage_cnt', 0 if it is 'range'.
+					 */
+	u16 stage_cnt[];		/* Flows per stage hash bucket. */
 };
 
 struct sw_flow_match {
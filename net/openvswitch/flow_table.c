@@ -50,23 +50,32 @@ static u16 range_n_bytes(const struct sw_flow_key_range *range)
 	return range->end - range->start;
 }
 
-void ovs_flow_mask_key(struct sw_flow_key *dst, const struct sw_flow_key *src,
-		       bool full, const struct sw_flow_mask *mask)
+static void flow_mask_key_range(struct sw_flow_key *dst,
+				const struct sw_flow_key *src,
+				const struct sw_flow_mask *mask,
+				int start, int end)
 {
-	int start = full ? 0 : mask->range.start;
-	int len = full ? sizeof *dst : range_n_bytes(&mask->range);
 	const long *m = (const long *)((const u8 *)&mask->key + start);
 	const long *s = (const long *)((const u8 *)src + start);
 	long *d = (long *)((u8 *)dst + start);
 	int i;
 
+	for (i = start; i < end; i += sizeof(long))
+		*d++ = *s++ & *m++;
+}
+
+void ovs_flow_mask_key(struct sw_flow_key *dst, const struct sw_flow_key *src,
+		       bool full, const struct sw_flow_mask *mask)
+{
+	int start = full ? 0 : mask->range.start;
+	int end = full ? sizeof(*dst) : mask->range.end;
+
 	/* If 'full' is true then all of 'dst' is fully initialized. Otherwise,
 	 * if 'full' is false the memory outside of the 'mask->range' is left
 	 * uninitialized. This can be used as an optimization when further
 	 * operations on 'dst' only use contents within 'mask->range'.
 	 */
-	for (i = 0; i < len; i += sizeof(long))
-		*d++ = *s++ & *m++;
+	flow_mask_key_range(dst, src, mask, start, end);
 }
 
 struct sw_flow *ovs_flow_alloc(void)
@@ -187,31 +196,46 @@ static void mask_array_rcu_cb(struct rcu_head *rcu)
 	__mask_array_destroy(ma);
 }
 
+static u64 tbl_mask_array_usage(struct mask_array *ma, int index)
+{
+	u64 usage = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct mask_array_stats *stats;
+		unsigned int start;
+		u64 counter;
+
+		stats = per_cpu_ptr(ma->masks_usage_stats, cpu);
+		do {
+			start = u64_stats_fetch_begin(&stats->syncp);
+			counter = stats->usage_cntrs[index];
+		} while (u64_stats_fetch_retry(&stats->syncp, start));
+
+		usage += counter;
+	}
+
+	return usage;
+}
+
 static void tbl_mask_array_reset_counters(struct mask_array *ma)
 {
-	int i, cpu;
+	int i;
 
 	/* As the per CPU counters are not atomic we can not go ahead and
 	 * reset them from another CPU. To be able to still have an approximate
 	 * zero based counter we store the value at reset, and subtract it
-	 * later when processing.
+	 * later when processing. The usage since the last reset is added to
+	 * the hit count of the mask at the index.
 	 */
 	for (i = 0; i < ma->max; i++) {
-		ma->masks_usage_zero_cntr[i] = 0;
-
-		for_each_possible_cpu(cpu) {
-			struct mask_array_stats *stats;
-			unsigned int start;
-			u64 counter;
-
-			stats = per_cpu_ptr(ma->masks_usage_stats, cpu);
-			do {
-				start = u64_stats_fetch_begin(&stats->syncp);
-				counter = stats->usage_cntrs[i];
-			} while (u64_stats_fetch_retry(&stats->syncp, start));
+		struct sw_flow_mask *mask = ovsl_dereference(ma->masks[i]);
+		u64 usage = tbl_mask_array_usage(ma, i);
 
-			ma->masks_usage_zero_cntr[i] += counter;
-		}
+		if (mask)
+			WRITE_ONCE(mask->n_hit, mask->n_hit + usage -
+				   ma->masks_usage_zero_cntr[i]);
+		ma->masks_usage_zero_cntr[i] = usage;
 	}
 }
 
@@ -258,6 +282,8 @@ static int tbl_mask_array_realloc(struct flow_table *tbl, int size)
 	if (old) {
 		int i;
 
+		/* the counters of the new array start from 0 */
+		tbl_mask_array_reset_counters(old);
 		for (i = 0; i < old->max; i++) {
 			if (ovsl_dereference(old->masks[i]))
 				new->masks[new->count++] = old->masks[i];
@@ -314,6 +340,8 @@ static void tbl_mask_array_del_mask(struct flow_table *tbl,
 	return;
 
 found:
+	/* account the usage before the last mask takes over the index */
+	tbl_mask_array_reset_counters(ma);
 	WRITE_ONCE(ma->count, ma_count - 1);
 
 	rcu_assign_pointer(ma->masks[i], ma->masks[ma_count - 1]);
@@ -459,6 +487,74 @@ static void flow_tbl_destroy_rcu_cb(struct rcu_head *rcu)
 	__table_instance_destroy(ti);
 }
 
+static u32 flow_hash(const struct sw_flow_key *key,
+		     const struct sw_flow_key_range *range)
+{
+	const u32 *hash_key = (const u32 *)((const u8 *)key + range->start);
+
+	/* Make sure number of hash bytes are multiple of u32. */
+	int hash_u32s = range_n_bytes(range) >> 2;
+
+	return jhash2(hash_key, hash_u32s, 0);
+}
+
+/* The stage filter of a mask counts its flows per hash of the first part of
+ * the masked key, up to the L4 fields. A lookup hashes that part first and
+ * skips the mask if no flow has the same hash, without masking and hashing
+ * the rest of the key. If the mask range ends before, the full hash is used,
+ * which still saves the bucket walk.
+ */
+#define FLOW_STAGE_END	rounddown(offsetof(struct sw_flow_key, tp), \
+				  sizeof(long))
+
+static void flow_mask_stage_init(struct sw_flow_mask *mask)
+{
+	if (mask->range.start < FLOW_STAGE_END &&
+	    mask->range.end > FLOW_STAGE_END)
+		mask->stage_end = FLOW_STAGE_END;
+	else
+		mask->stage_end = 0;
+}
+
+static u32 flow_stage_hash(const struct sw_flow_key *key,
+			   const struct sw_flow_mask *mask)
+{
+	struct sw_flow_key_range range = {
+		.start	= mask->range.start,
+		.end	= mask->stage_end,
+	};
+
+	return flow_hash(key, mask->stage_end ? &range : &mask->range);
+}
+
+#define FLOW_STAGE_BUCKET(hash)	((hash) & (SW_FLOW_MASK_STAGE_BUCKETS - 1))
+
+/* Must be called with OVS mutex held. */
+static void flow_stage_add(struct sw_flow *flow)
+{
+	u32 hash = flow_stage_hash(&flow->key, flow->mask);
+	u16 *cnt = &flow->mask->stage_cnt[FLOW_STAGE_BUCKET(hash)];
+
+	/* A saturated bucket is never decremented again. */
+	if (*cnt != U16_MAX)
+		WRITE_ONCE(*cnt, *cnt + 1);
+}
+
+/* Must be called with OVS mutex held. */
+static void flow_stage_del(struct sw_flow *flow)
+{
+	u32 hash = flow_stage_hash(&flow->key, flow->mask);
+	u16 *cnt = &flow->mask->stage_cnt[FLOW_STAGE_BUCKET(hash)];
+
+	if (*cnt != U16_MAX)
+		WRITE_ONCE(*cnt, *cnt - 1);
+}
+
+static bool flow_stage_match(const struct sw_flow_mask *mask, u32 hash)
+{
+	return READ_ONCE(mask->stage_cnt[FLOW_STAGE_BUCKET(hash)]);
+}
+
 static void table_instance_flow_free(struct flow_table *table,
 				     struct table_instance *ti,
 				     struct table_instance *ufid_ti,
@@ -466,6 +562,7 @@ static void table_instance_flow_free(struct flow_table *table,
 {
 	hlist_del_rcu(&flow->flow_table.node[ti->node_ver]);
 	table->count--;
+	flow_stage_del(flow);
 
 	if (ovs_identifier_is_ufid(&flow->id)) {
 		hlist_del_rcu(&flow->ufid_table.node[ufid_ti->node_ver]);
@@ -645,17 +742,6 @@ int ovs_flow_tbl_flush(struct flow_table *flow_table)
 	return -ENOMEM;
 }
 
-static u32 flow_hash(const struct sw_flow_key *key,
-		     const struct sw_flow_key_range *range)
-{
-	const u32 *hash_key = (const u32 *)((const u8 *)key + range->start);
-
-	/* Make sure number of hash bytes are multiple of u32. */
-	int hash_u32s = range_n_bytes(range) >> 2;
-
-	return jhash2(hash_key, hash_u32s, 0);
-}
-
 static int flow_key_start(const struct sw_flow_key *key)
 {
 	if (key->tun_proto)
@@ -671,13 +757,17 @@ static bool cmp_key(const struct sw_flow_key *key1,
 {
 	const long *cp1 = (const long *)((const u8 *)key1 + key_start);
 	const long *cp2 = (const long *)((const u8 *)key2 + key_start);
+	long diffs = 0;
 	int i;
 
+	/* Keys are compared after a hash match, so they are expected to be
+	 * equal: accumulate the differences rather than branching on each
+	 * word.
+	 */
 	for (i = key_start; i < key_end; i += sizeof(long))
-		if (*cp1++ ^ *cp2++)
-			return false;
+		diffs |= *cp1++ ^ *cp2++;
 
-	return true;
+	return diffs == 0;
 }
 
 static bool flow_cmp_masked_key(const struct sw_flow *flow,
@@ -708,10 +798,22 @@ static struct sw_flow *masked_flow_lookup(struct table_instance *ti,
 	u32 hash;
 	struct sw_flow_key masked_key;
 
-	ovs_flow_mask_key(&masked_key, unmasked, false, mask);
-	hash = flow_hash(&masked_key, &mask->range);
-	head = find_bucket(ti, hash);
 	(*n_mask_hit)++;
+	if (mask->stage_end) {
+		flow_mask_key_range(&masked_key, unmasked, mask,
+				    mask->range.start, mask->stage_end);
+		if (!flow_stage_match(mask, flow_stage_hash(&masked_key, mask)))
+			return NULL;
+		flow_mask_key_range(&masked_key, unmasked, mask,
+				    mask->stage_end, mask->range.end);
+		hash = flow_hash(&masked_key, &mask->range);
+	} else {
+		ovs_flow_mask_key(&masked_key, unmasked, false, mask);
+		hash = flow_hash(&masked_key, &mask->range);
+		if (!flow_stage_match(mask, hash))
+			return NULL;
+	}
+	head = find_bucket(ti, hash);
 
 	hlist_for_each_entry_rcu(flow, head, flow_table.node[ti->node_ver],
 				 lockdep_ovsl_is_held()) {
@@ -969,7 +1071,8 @@ static struct sw_flow_mask *mask_alloc(void)
 {
 	struct sw_flow_mask *mask;
 
-	mask = kmalloc(sizeof(*mask), GFP_KERNEL);
+	mask = kzalloc(struct_size(mask, stage_cnt, SW_FLOW_MASK_STAGE_BUCKETS),
+		       GFP_KERNEL);
 	if (mask)
 		mask->ref_count = 1;
 
@@ -1019,6 +1122,7 @@ static int flow_mask_insert(struct flow_table *tbl, struct sw_flow *flow,
 			return -ENOMEM;
 		mask->key = new->key;
 		mask->range = new->range;
+		flow_mask_stage_init(mask);
 
 		/* Add mask to mask-list. */
 		if (tbl_mask_array_add_mask(tbl, mask)) {
@@ -1042,6 +1146,8 @@ static void flow_key_insert(struct flow_table *table, struct sw_flow *flow)
 
 	flow->flow_table.hash = flow_hash(&flow->key, &flow->mask->range);
 	ti = ovsl_dereference(table->ti);
+	/* before the flow is visible, lookups must not skip its mask */
+	flow_stage_add(flow);
 	table_instance_insert(ti, flow);
 	table->count++;
 
@@ -1121,28 +1227,13 @@ void ovs_flow_masks_rebalance(struct flow_table *table)
 
 	for (i = 0; i < ma->max; i++) {
 		struct sw_flow_mask *mask;
-		int cpu;
 
 		mask = rcu_dereference_ovsl(ma->masks[i]);
 		if (unlikely(!mask))
 			break;
 
 		masks_and_count[i].index = i;
-		masks_and_count[i].counter = 0;
-
-		for_each_possible_cpu(cpu) {
-			struct mask_array_stats *stats;
-			unsigned int start;
-			u64 counter;
-
-			stats = per_cpu_ptr(ma->masks_usage_stats, cpu);
-			do {
-				start = u64_stats_fetch_begin(&stats->syncp);
-				counter = stats->usage_cntrs[i];
-			} while (u64_stats_fetch_retry(&stats->syncp, start));
-
-			masks_and_count[i].counter += counter;
-		}
+		masks_and_count[i].counter = tbl_mask_array_usage(ma, i);
 
 		/* Subtract the zero count value. */
 		masks_and_count[i].counter -= ma->masks_usage_zero_cntr[i];
@@ -1151,6 +1242,8 @@ void ovs_flow_masks_rebalance(struct flow_table *table)
 		 * below when no change is needed, do it inline here.
 		 */
 		ma->masks_usage_zero_cntr[i] += masks_and_count[i].counter;
+		WRITE_ONCE(mask->n_hit,
+			   mask->n_hit + masks_and_count[i].counter);
 	}
 
 	if (i == 0)
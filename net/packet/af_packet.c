@@ -203,7 +203,7 @@ static void prb_retire_current_block(struct tpacket_kbdq_core *,
 static int prb_queue_frozen(struct tpacket_kbdq_core *);
 static void prb_open_block(struct tpacket_kbdq_core *,
 		struct tpacket_block_desc *);
-static void prb_retire_rx_blk_timer_expired(struct timer_list *);
+static enum hrtimer_restart prb_retire_rx_blk_timer_expired(struct hrtimer *);
 static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *);
 static void prb_fill_rxhash(struct tpacket_kbdq_core *, struct tpacket3_hdr *);
 static void prb_clear_rxhash(struct tpacket_kbdq_core *,
@@ -536,7 +536,7 @@ static void *packet_current_frame(struct packet_sock *po,
 
 static void prb_del_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	del_timer_sync(&pkc->retire_blk_timer);
+	hrtimer_cancel(&pkc->retire_blk_timer);
 }
 
 static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
@@ -558,9 +558,10 @@ static void prb_setup_retire_blk_timer(struct packet_sock *po)
 	struct tpacket_kbdq_core *pkc;
 
 	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
-	timer_setup(&pkc->retire_blk_timer, prb_retire_rx_blk_timer_expired,
-		    0);
-	pkc->retire_blk_timer.expires = jiffies;
+	/* Soft mode, the expiry handler runs in softirq like tpacket_rcv() */
+	hrtimer_init(&pkc->retire_blk_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL_SOFT);
+	pkc->retire_blk_timer.function = prb_retire_rx_blk_timer_expired;
 }
 
 static int prb_calc_retire_blk_tmo(struct packet_sock *po,
@@ -626,12 +627,19 @@ static void init_prb_bdqc(struct packet_sock *po,
 	p1->version = po->tp_version;
 	p1->last_kactive_blk_num = 0;
 	po->stats.stats3.tp_freeze_q_cnt = 0;
-	if (req_u->req3.tp_retire_blk_tov)
-		p1->retire_blk_tov = req_u->req3.tp_retire_blk_tov;
-	else
+	if (!req_u->req3.tp_retire_blk_tov) {
 		p1->retire_blk_tov = prb_calc_retire_blk_tmo(po,
 						req_u->req3.tp_block_size);
-	p1->tov_in_jiffies = msecs_to_jiffies(p1->retire_blk_tov);
+		p1->interval_ktime = ms_to_ktime(p1->retire_blk_tov);
+	} else if (req_u->req3.tp_feature_req_word & TP_FT_REQ_RETIRE_TOV_USEC) {
+		/* retire_blk_tov is what the diag interface reports, in msecs */
+		p1->retire_blk_tov = DIV_ROUND_UP(req_u->req3.tp_retire_blk_tov,
+						  USEC_PER_MSEC);
+		p1->interval_ktime = us_to_ktime(req_u->req3.tp_retire_blk_tov);
+	} else {
+		p1->retire_blk_tov = req_u->req3.tp_retire_blk_tov;
+		p1->interval_ktime = ms_to_ktime(p1->retire_blk_tov);
+	}
 	p1->blk_sizeof_priv = req_u->req3.tp_sizeof_priv;
 	rwlock_init(&p1->blk_fill_in_prog_lock);
 
@@ -646,8 +654,8 @@ static void init_prb_bdqc(struct packet_sock *po,
  */
 static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	mod_timer(&pkc->retire_blk_timer,
-			jiffies + pkc->tov_in_jiffies);
+	hrtimer_start(&pkc->retire_blk_timer, pkc->interval_ktime,
+		      HRTIMER_MODE_REL_SOFT);
 	pkc->last_kactive_blk_num = pkc->kactive_blk_num;
 }
 
@@ -667,17 +675,20 @@ static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
  * to close a block early and that's fine.
  *
  * But when the timer does fire, we check whether or not to refresh it.
- * Since the tmo granularity is in msecs, it is not too expensive
- * to refresh the timer, lets say every '8' msecs.
+ * The tmo granularity is in msecs by default, so it is not too expensive
+ * to refresh the timer, lets say every '8' msecs. With
+ * TP_FT_REQ_RETIRE_TOV_USEC the user asks for a finer one and pays for it.
  * Either the user can set the 'tmo' or we can derive it based on
  * a) line-speed and b) block-size.
  * prb_calc_retire_blk_tmo() calculates the tmo.
  *
+ * The timer is re-armed from _prb_refresh_rx_retire_blk_timer(), the
+ * handler itself never asks for a restart.
  */
-static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
+static enum hrtimer_restart prb_retire_rx_blk_timer_expired(struct hrtimer *t)
 {
 	struct packet_sock *po =
-		from_timer(po, t, rx_ring.prb_bdqc.retire_blk_timer);
+		container_of(t, struct packet_sock, rx_ring.prb_bdqc.retire_blk_timer);
 	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	unsigned int frozen;
 	struct tpacket_block_desc *pbd;
@@ -745,6 +756,7 @@ static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 
 out:
 	spin_unlock(&po->sk.sk_receive_queue.lock);
+	return HRTIMER_NORESTART;
 }
 
 static void prb_flush_block(struct tpacket_kbdq_core *pkc1,
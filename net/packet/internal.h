@@ -2,6 +2,7 @@
 #ifndef __PACKET_INTERNAL_H__
 #define __PACKET_INTERNAL_H__
 
+#include <linux/hrtimer.h>
 #include <linux/refcount.h>
 
 struct packet_mclist {
@@ -46,10 +47,10 @@ struct tpacket_kbdq_core {
 
 	unsigned short  retire_blk_tov;
 	unsigned short  version;
-	unsigned long	tov_in_jiffies;
+	ktime_t		interval_ktime;
 
 	/* timer to retire an outstanding block */
-	struct timer_list retire_blk_timer;
+	struct hrtimer	retire_blk_timer;
 };
 
 struct pgv {
@@ -36,6 +36,7 @@
 #include <linux/gfp.h>
 #include <linux/in.h>
 #include <linux/ipv6.h>
+#include <linux/log2.h>
 #include <linux/poll.h>
 #include <net/sock.h>
 
@@ -892,12 +893,17 @@ static void rds_exit(void)
 module_exit(rds_exit);
 
 u32 rds_gen_num;
+/* Number of paths we advertise to multipath capable peers */
+unsigned int rds_mpath_npaths = RDS_MPATH_DEFAULT;
 
 static int __init rds_init(void)
 {
 	int ret;
 
 	net_get_random_once(&rds_gen_num, sizeof(rds_gen_num));
+	rds_mpath_npaths = clamp_t(unsigned int,
+				   roundup_pow_of_two(num_online_cpus()),
+				   RDS_MPATH_DEFAULT, RDS_MPATH_WORKERS);
 
 	ret = rds_bind_lock_init();
 	if (ret)
@@ -92,7 +92,9 @@ enum {
 #define	RDS_DESTROY_PENDING	4
 
 /* Max number of multipaths per RDS connection. Must be a power of 2 */
-#define	RDS_MPATH_WORKERS	8
+#define	RDS_MPATH_WORKERS	16
+/* Paths advertised by older kernels, and the least we advertise */
+#define	RDS_MPATH_DEFAULT	8
 #define	RDS_MPATH_HASH(rs, n) (jhash_1word((rs)->rs_bound_port, \
 			       (rs)->rs_hash_initval) & ((n) - 1))
 
@@ -759,6 +761,7 @@ struct rds_message *rds_cong_update_alloc(struct rds_connection *conn);
 
 /* connection.c */
 extern u32 rds_gen_num;
+extern unsigned int rds_mpath_npaths;
 int rds_conn_init(void);
 void rds_conn_exit(void);
 struct rds_connection *rds_conn_create(struct net *net,
@@ -1048,7 +1048,7 @@ static int rds_send_mprds_hash(struct rds_sock *rs,
 	int hash;
 
 	if (conn->c_npaths == 0)
-		hash = RDS_MPATH_HASH(rs, RDS_MPATH_WORKERS);
+		hash = RDS_MPATH_HASH(rs, rds_mpath_npaths);
 	else
 		hash = RDS_MPATH_HASH(rs, conn->c_npaths);
 	if (conn->c_npaths == 0 && hash != 0) {
@@ -1069,8 +1069,11 @@ static int rds_send_mprds_hash(struct rds_sock *rs,
 						     conn->c_npaths != 0))
 				hash = 0;
 		}
+		/* The peer may support fewer paths than we guessed */
 		if (conn->c_npaths == 1)
 			hash = 0;
+		else if (hash && conn->c_npaths)
+			hash = RDS_MPATH_HASH(rs, conn->c_npaths);
 	}
 	return hash;
 }
@@ -1459,7 +1462,7 @@ rds_send_probe(struct rds_conn_path *cp, __be16 sport,
 
 	if (RDS_HS_PROBE(be16_to_cpu(sport), be16_to_cpu(dport)) &&
 	    cp->cp_conn->c_trans->t_mp_capable) {
-		u16 npaths = cpu_to_be16(RDS_MPATH_WORKERS);
+		u16 npaths = cpu_to_be16(rds_mpath_npaths);
 		u32 my_gen_num = cpu_to_be32(cp->cp_conn->c_my_gen_num);
 
 		rds_message_add_extension(&rm->m_inc.i_hdr,
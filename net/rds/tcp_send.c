@@ -181,6 +181,7 @@ void rds_tcp_write_space(struct sock *sk)
 	void (*write_space)(struct sock *sk);
 	struct rds_conn_path *cp;
 	struct rds_tcp_connection *tc;
+	u32 una;
 
 	read_lock_bh(&sk->sk_callback_lock);
 	cp = sk->sk_user_data;
@@ -194,9 +195,15 @@ void rds_tcp_write_space(struct sock *sk)
 	write_space = tc->t_orig_write_space;
 	rds_tcp_stats_inc(s_tcp_write_space_calls);
 
-	rdsdebug("tcp una %u\n", rds_tcp_snd_una(tc));
-	tc->t_last_seen_una = rds_tcp_snd_una(tc);
-	rds_send_path_drop_acked(cp, rds_tcp_snd_una(tc), rds_tcp_is_acked);
+	una = rds_tcp_snd_una(tc);
+	rdsdebug("tcp una %u\n", una);
+	/* Nothing new was acked, don't walk the retransmit queue for it */
+	if (una != tc->t_last_seen_una) {
+		tc->t_last_seen_una = una;
+		rds_send_path_drop_acked(cp, una, rds_tcp_is_acked);
+	} else {
+		rds_tcp_stats_inc(s_tcp_write_space_no_ack);
+	}
 
 	rcu_read_lock();
 	if ((refcount_read(&sk->sk_wmem_alloc) << 1) <= sk->sk_sndbuf &&
@@ -618,12 +618,18 @@ static int smcr_clnt_conf_first_link(struct smc_sock *smc)
 
 		rc = smc_clc_wait_msg(smc, &dclc, sizeof(dclc),
 				      SMC_CLC_DECLINE, CLC_WAIT_TIME_SHORT);
-		if (rc == -EAGAIN)
-			rc = 0; /* no DECLINE received, go with one link */
+		if (rc == -EAGAIN) {
+			/* no DECLINE received, go with one link */
+			smc_llc_flow_stop(link->lgr, &link->lgr->llc_flow_lcl);
+			rc = 0;
+		}
 		return rc;
 	}
-	smc_llc_flow_qentry_clr(&link->lgr->llc_flow_lcl);
-	smc_llc_cli_add_link(link, qentry);
+	/* The server accepted the first link. Don't hold up the connection
+	 * for the setup of the 2nd link, llc_add_link_work takes over the
+	 * queued ADD LINK request and stops the flow when done.
+	 */
+	schedule_work(&link->lgr->llc_add_link_work);
 	return 0;
 }
 
@@ -1301,9 +1307,10 @@ static int smc_connect_rdma(struct smc_sock *smc,
 		/* QP confirmation over RoCE fabric */
 		smc_llc_flow_initiate(link->lgr, SMC_LLC_FLOW_ADD_LINK);
 		reason_code = smcr_clnt_conf_first_link(smc);
-		smc_llc_flow_stop(link->lgr, &link->lgr->llc_flow_lcl);
-		if (reason_code)
+		if (reason_code) {
+			smc_llc_flow_stop(link->lgr, &link->lgr->llc_flow_lcl);
 			goto connect_abort;
+		}
 	}
 	mutex_unlock(&smc_client_lgr_pending);
 
@@ -1440,7 +1447,9 @@ static int __smc_connect(struct smc_sock *smc)
 	struct smc_clc_msg_accept_confirm_v2 *aclc2;
 	struct smc_clc_msg_accept_confirm *aclc;
 	struct smc_init_info *ini = NULL;
+	ktime_t hs_start;
 	u8 *buf = NULL;
+	bool is_smcd;
 	int rc = 0;
 
 	if (smc->use_fallback)
@@ -1489,6 +1498,7 @@ static int __smc_connect(struct smc_sock *smc)
 	aclc = (struct smc_clc_msg_accept_confirm *)aclc2;
 
 	/* perform CLC handshake */
+	hs_start = ktime_get();
 	rc = smc_connect_clc(smc, aclc2, ini);
 	if (rc) {
 		/* -EAGAIN on timeout, see tcp_recvmsg() */
@@ -1504,8 +1514,12 @@ static int __smc_connect(struct smc_sock *smc)
 	version = aclc->hdr.version == SMC_V1 ? SMC_V1 : SMC_V2;
 	if (rc)
 		goto vlan_cleanup;
+	is_smcd = aclc->hdr.typev1 == SMC_TYPE_D;
+	SMC_STAT_HS_LAT(sock_net(smc->clcsock->sk), is_smcd, clnt_clc,
+			hs_start);
 
 	/* depending on previous steps, connect using rdma or ism */
+	hs_start = ktime_get();
 	if (aclc->hdr.typev1 == SMC_TYPE_R) {
 		ini->smcr_version = version;
 		rc = smc_connect_rdma(smc, aclc, ini);
@@ -1516,6 +1530,8 @@ static int __smc_connect(struct smc_sock *smc)
 	if (rc)
 		goto vlan_cleanup;
 
+	SMC_STAT_HS_LAT(sock_net(smc->clcsock->sk), is_smcd, clnt_link,
+			hs_start);
 	SMC_STAT_CLNT_SUCC_INC(sock_net(smc->clcsock->sk), aclc);
 	smc_connect_ism_vlan_cleanup(smc, ini);
 	kfree(buf);
@@ -1838,11 +1854,6 @@ static int smcr_serv_conf_first_link(struct smc_sock *smc)
 
 	smc_llc_link_active(link);
 	smcr_lgr_set_type(link->lgr, SMC_LGR_SINGLE);
-
-	down_write(&link->lgr->llc_conf_mutex);
-	/* initial contact - try to establish second link */
-	smc_llc_srv_add_link(link, NULL);
-	up_write(&link->lgr->llc_conf_mutex);
 	return 0;
 }
 
@@ -2329,6 +2340,11 @@ static int smc_listen_rdma_finish(struct smc_sock *new_smc,
 		smc_llc_flow_initiate(link->lgr, SMC_LLC_FLOW_ADD_LINK);
 		reason_code = smcr_serv_conf_first_link(new_smc);
 		smc_llc_flow_stop(link->lgr, &link->lgr->llc_flow_lcl);
+		/* initial contact - try to establish second link in a new
+		 * flow, the connection doesn't have to wait for it
+		 */
+		if (!reason_code)
+			smc_llc_add_link_local(link);
 	}
 	return reason_code;
 }
@@ -2345,6 +2361,7 @@ static void smc_listen_work(struct work_struct *work)
 	struct smc_init_info *ini = NULL;
 	u8 proposal_version = SMC_V1;
 	u8 accept_version;
+	ktime_t hs_start;
 	int rc = 0;
 
 	if (new_smc->listen_smc->sk.sk_state != SMC_LISTEN)
@@ -2378,6 +2395,7 @@ static void smc_listen_work(struct work_struct *work)
 			      SMC_CLC_PROPOSAL, CLC_WAIT_TIME);
 	if (rc)
 		goto out_decl;
+	hs_start = ktime_get();
 
 	if (pclc->hdr.version > SMC_V1)
 		proposal_version = SMC_V2;
@@ -2430,8 +2448,11 @@ static void smc_listen_work(struct work_struct *work)
 			goto out_unlock;
 		goto out_decl;
 	}
+	SMC_STAT_HS_LAT(sock_net(newclcsock->sk), ini->is_smcd, srv_clc,
+			hs_start);
 
 	/* finish worker */
+	hs_start = ktime_get();
 	if (!ini->is_smcd) {
 		rc = smc_listen_rdma_finish(new_smc, cclc,
 					    ini->first_contact_local, ini);
@@ -2441,6 +2462,8 @@ static void smc_listen_work(struct work_struct *work)
 	}
 	smc_conn_save_peer_info(new_smc, cclc);
 	smc_listen_out_connected(new_smc);
+	SMC_STAT_HS_LAT(sock_net(newclcsock->sk), ini->is_smcd, srv_link,
+			hs_start);
 	SMC_STAT_SERV_SUCC_INC(sock_net(newclcsock->sk), ini);
 	goto out_free;
 
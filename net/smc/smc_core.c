@@ -13,6 +13,7 @@
 #include <linux/if_vlan.h>
 #include <linux/random.h>
 #include <linux/workqueue.h>
+#include <linux/shrinker.h>
 #include <linux/wait.h>
 #include <linux/reboot.h>
 #include <linux/mutex.h>
@@ -1293,6 +1294,174 @@ void smcr_link_put(struct smc_link *lnk)
 		__smcr_link_clear(lnk);
 }
 
+/* Host-wide pool of SMC-R buffers released by their link group, per size
+ * class. MRs and rkeys are bound to links, so only the (zeroed) memory is
+ * kept: that saves the high order allocations of new link groups, the rest
+ * of the setup is done again. Unused entries are released after
+ * SMC_BUF_POOL_IDLE or on memory pressure.
+ */
+#define SMC_BUF_POOL_IDLE	(60 * HZ)
+
+static struct smc_buf_pool {
+	spinlock_t		lock;		/* protects the lists and cnt */
+	struct list_head	phys[SMC_RMBE_SIZES];
+	struct list_head	virt[SMC_RMBE_SIZES];
+	unsigned long		cnt;
+	struct delayed_work	shrink_work;
+} smc_buf_pool;
+
+static void smcr_buf_free_mem(struct smc_buf_desc *buf_desc)
+{
+	if (!buf_desc->is_vm && buf_desc->pages)
+		__free_pages(buf_desc->pages, buf_desc->order);
+	else if (buf_desc->is_vm && buf_desc->cpu_addr)
+		vfree(buf_desc->cpu_addr);
+	kfree(buf_desc);
+}
+
+/* unused buffers have been zeroed by smcr_buf_unuse() and are unmapped */
+static bool smcr_buf_pool_put(struct smc_buf_desc *buf_desc)
+{
+	int bufsize_short = ilog2(buf_desc->len) - 14;
+	struct list_head *head;
+
+	if (buf_desc->used || buf_desc->is_reg_err ||
+	    bufsize_short < 0 || bufsize_short >= SMC_RMBE_SIZES)
+		return false;
+
+	buf_desc->is_conf_rkey = false;
+	buf_desc->is_dma_need_sync = 0;
+	buf_desc->idle_since = jiffies;
+
+	spin_lock(&smc_buf_pool.lock);
+	head = buf_desc->is_vm ? &smc_buf_pool.virt[bufsize_short] :
+				 &smc_buf_pool.phys[bufsize_short];
+	list_add(&buf_desc->list, head);
+	if (!smc_buf_pool.cnt++)
+		schedule_delayed_work(&smc_buf_pool.shrink_work,
+				      SMC_BUF_POOL_IDLE);
+	spin_unlock(&smc_buf_pool.lock);
+	return true;
+}
+
+/* take the most recently released buffer suitable for the lgr buf_type */
+static struct smc_buf_desc *smcr_buf_pool_get(struct smc_link_group *lgr,
+					      int bufsize_short)
+{
+	struct smc_buf_desc *buf_desc = NULL;
+
+	if (!READ_ONCE(smc_buf_pool.cnt))
+		return NULL;
+
+	spin_lock(&smc_buf_pool.lock);
+	if (lgr->buf_type != SMCR_VIRT_CONT_BUFS)
+		buf_desc = list_first_entry_or_null(&smc_buf_pool.phys[bufsize_short],
+						    struct smc_buf_desc, list);
+	if (!buf_desc && lgr->buf_type != SMCR_PHYS_CONT_BUFS)
+		buf_desc = list_first_entry_or_null(&smc_buf_pool.virt[bufsize_short],
+						    struct smc_buf_desc, list);
+	if (buf_desc) {
+		list_del(&buf_desc->list);
+		smc_buf_pool.cnt--;
+	}
+	spin_unlock(&smc_buf_pool.lock);
+	return buf_desc;
+}
+
+static unsigned long __smcr_buf_pool_shrink(struct list_head *head,
+					    struct list_head *victims,
+					    unsigned long nr, unsigned long idle)
+{
+	struct smc_buf_desc *buf_desc;
+	unsigned long cnt = 0;
+
+	/* oldest entries are at the tail */
+	while (cnt < nr && !list_empty(head)) {
+		buf_desc = list_last_entry(head, struct smc_buf_desc, list);
+		if (idle && time_before(jiffies, buf_desc->idle_since + idle))
+			break;
+		list_move(&buf_desc->list, victims);
+		cnt++;
+	}
+	return cnt;
+}
+
+/* release up to nr pooled buffers idle for at least idle jiffies,
+ * largest size classes first
+ */
+static unsigned long smcr_buf_pool_shrink(unsigned long nr, unsigned long idle)
+{
+	struct smc_buf_desc *buf_desc, *bf;
+	unsigned long freed = 0;
+	LIST_HEAD(victims);
+	int i;
+
+	spin_lock(&smc_buf_pool.lock);
+	for (i = SMC_RMBE_SIZES - 1; i >= 0 && freed < nr; i--) {
+		freed += __smcr_buf_pool_shrink(&smc_buf_pool.phys[i], &victims,
+						nr - freed, idle);
+		freed += __smcr_buf_pool_shrink(&smc_buf_pool.virt[i], &victims,
+						nr - freed, idle);
+	}
+	smc_buf_pool.cnt -= freed;
+	spin_unlock(&smc_buf_pool.lock);
+
+	list_for_each_entry_safe(buf_desc, bf, &victims, list) {
+		list_del(&buf_desc->list);
+		smcr_buf_free_mem(buf_desc);
+	}
+	return freed;
+}
+
+static void smcr_buf_pool_shrink_work(struct work_struct *work)
+{
+	smcr_buf_pool_shrink(ULONG_MAX, SMC_BUF_POOL_IDLE);
+
+	spin_lock(&smc_buf_pool.lock);
+	if (smc_buf_pool.cnt)
+		schedule_delayed_work(&smc_buf_pool.shrink_work,
+				      SMC_BUF_POOL_IDLE);
+	spin_unlock(&smc_buf_pool.lock);
+}
+
+static unsigned long smcr_buf_pool_count(struct shrinker *shrink,
+					 struct shrink_control *sc)
+{
+	return READ_ONCE(smc_buf_pool.cnt) ? : SHRINK_EMPTY;
+}
+
+static unsigned long smcr_buf_pool_scan(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	unsigned long freed = smcr_buf_pool_shrink(sc->nr_to_scan, 0);
+
+	return freed ? : SHRINK_STOP;
+}
+
+static struct shrinker smcr_buf_pool_shrinker = {
+	.count_objects	= smcr_buf_pool_count,
+	.scan_objects	= smcr_buf_pool_scan,
+	.seeks		= DEFAULT_SEEKS,
+};
+
+static void smcr_buf_pool_init(void)
+{
+	int i;
+
+	spin_lock_init(&smc_buf_pool.lock);
+	for (i = 0; i < SMC_RMBE_SIZES; i++) {
+		INIT_LIST_HEAD(&smc_buf_pool.phys[i]);
+		INIT_LIST_HEAD(&smc_buf_pool.virt[i]);
+	}
+	INIT_DELAYED_WORK(&smc_buf_pool.shrink_work, smcr_buf_pool_shrink_work);
+}
+
+static void smcr_buf_pool_exit(void)
+{
+	cancel_delayed_work_sync(&smc_buf_pool.shrink_work);
+	smcr_buf_pool_shrink(ULONG_MAX, 0);
+}
+
 static void smcr_buf_free(struct smc_link_group *lgr, bool is_rmb,
 			  struct smc_buf_desc *buf_desc)
 {
@@ -1301,11 +1470,8 @@ static void smcr_buf_free(struct smc_link_group *lgr, bool is_rmb,
 	for (i = 0; i < SMC_LINKS_PER_LGR_MAX; i++)
 		smcr_buf_unmap_link(buf_desc, is_rmb, &lgr->lnk[i]);
 
-	if (!buf_desc->is_vm && buf_desc->pages)
-		__free_pages(buf_desc->pages, buf_desc->order);
-	else if (buf_desc->is_vm && buf_desc->cpu_addr)
-		vfree(buf_desc->cpu_addr);
-	kfree(buf_desc);
+	if (!smcr_buf_pool_put(buf_desc))
+		smcr_buf_free_mem(buf_desc);
 }
 
 static void smcd_buf_free(struct smc_link_group *lgr, bool is_dmb,
@@ -2341,6 +2507,15 @@ static int __smc_buf_create(struct smc_sock *smc, bool is_smcd, bool is_rmb)
 			break; /* found reusable slot */
 		}
 
+		/* then for memory released by another link group */
+		if (!is_smcd) {
+			buf_desc = smcr_buf_pool_get(lgr, bufsize_short);
+			if (buf_desc) {
+				SMC_STAT_BUF_POOL(smc, is_smcd, is_rmb);
+				goto add;
+			}
+		}
+
 		if (is_smcd)
 			buf_desc = smcd_new_buf_create(lgr, is_rmb, bufsize);
 		else
@@ -2357,6 +2532,7 @@ static int __smc_buf_create(struct smc_sock *smc, bool is_smcd, bool is_rmb)
 		}
 
 		SMC_STAT_RMB_ALLOC(smc, is_smcd, is_rmb);
+add:
 		SMC_STAT_RMB_SIZE(smc, is_smcd, is_rmb, bufsize);
 		buf_desc->used = 1;
 		down_write(lock);
@@ -2610,7 +2786,17 @@ static struct notifier_block smc_reboot_notifier = {
 
 int __init smc_core_init(void)
 {
-	return register_reboot_notifier(&smc_reboot_notifier);
+	int rc;
+
+	smcr_buf_pool_init();
+	rc = register_shrinker(&smcr_buf_pool_shrinker, "smc-buf-pool");
+	if (rc)
+		return rc;
+
+	rc = register_reboot_notifier(&smc_reboot_notifier);
+	if (rc)
+		unregister_shrinker(&smcr_buf_pool_shrinker);
+	return rc;
 }
 
 /* Called (from smc_exit) when module is removed */
@@ -2618,4 +2804,6 @@ void smc_core_exit(void)
 {
 	unregister_reboot_notifier(&smc_reboot_notifier);
 	smc_lgrs_shutdown();
+	unregister_shrinker(&smcr_buf_pool_shrinker);
+	smcr_buf_pool_exit();
 }
@@ -195,6 +195,8 @@ struct smc_buf_desc {
 					/* buffer registration err */
 			u8		is_vm;
 					/* virtually contiguous */
+			unsigned long	idle_since;
+					/* put in the host-wide pool */
 		};
 		struct { /* SMC-D */
 			unsigned short	sba_idx;
@@ -85,6 +85,10 @@ static int smc_nl_fill_stats_rmb_data(struct sk_buff *skb,
 			      stats_rmb_cnt->dgrade_cnt,
 			      SMC_NLA_STATS_RMB_PAD))
 		goto errattr;
+	if (nla_put_u64_64bit(skb, SMC_NLA_STATS_RMB_POOL_CNT,
+			      stats_rmb_cnt->pool_cnt,
+			      SMC_NLA_STATS_RMB_PAD))
+		goto errattr;
 
 	nla_nest_end(skb, attrs);
 	return 0;
@@ -162,6 +166,45 @@ static int smc_nl_fill_stats_bufsize_data(struct sk_buff *skb,
 	return -EMSGSIZE;
 }
 
+static int smc_nl_fill_stats_hslat_data(struct sk_buff *skb,
+					struct smc_stats *stats, int tech,
+					int type)
+{
+	struct smc_stats_hslat *stats_lat;
+	struct nlattr *attrs;
+
+	if (type == SMC_NLA_STATS_T_CLNT_CLC_LAT)
+		stats_lat = &stats->smc[tech].clnt_clc_lat;
+	else if (type == SMC_NLA_STATS_T_CLNT_LINK_LAT)
+		stats_lat = &stats->smc[tech].clnt_link_lat;
+	else if (type == SMC_NLA_STATS_T_SRV_CLC_LAT)
+		stats_lat = &stats->smc[tech].srv_clc_lat;
+	else if (type == SMC_NLA_STATS_T_SRV_LINK_LAT)
+		stats_lat = &stats->smc[tech].srv_link_lat;
+	else
+		goto errout;
+
+	attrs = nla_nest_start(skb, type);
+	if (!attrs)
+		goto errout;
+	if (nla_put_u64_64bit(skb, SMC_NLA_STATS_HS_LAT_SUM_US,
+			      stats_lat->sum_us,
+			      SMC_NLA_STATS_HS_LAT_PAD))
+		goto errattr;
+	if (nla_put_u64_64bit(skb, SMC_NLA_STATS_HS_LAT_CNT,
+			      stats_lat->cnt,
+			      SMC_NLA_STATS_HS_LAT_PAD))
+		goto errattr;
+
+	nla_nest_end(skb, attrs);
+	return 0;
+
+errattr:
+	nla_nest_cancel(skb, attrs);
+errout:
+	return -EMSGSIZE;
+}
+
 static int smc_nl_fill_stats_tech_data(struct sk_buff *skb,
 				       struct smc_stats *stats, int tech)
 {
@@ -194,6 +237,18 @@ static int smc_nl_fill_stats_tech_data(struct sk_buff *skb,
 	if (smc_nl_fill_stats_bufsize_data(skb, stats, tech,
 					   SMC_NLA_STATS_T_RX_RMB_SIZE))
 		goto errattr;
+	if (smc_nl_fill_stats_hslat_data(skb, stats, tech,
+					 SMC_NLA_STATS_T_CLNT_CLC_LAT))
+		goto errattr;
+	if (smc_nl_fill_stats_hslat_data(skb, stats, tech,
+					 SMC_NLA_STATS_T_CLNT_LINK_LAT))
+		goto errattr;
+	if (smc_nl_fill_stats_hslat_data(skb, stats, tech,
+					 SMC_NLA_STATS_T_SRV_CLC_LAT))
+		goto errattr;
+	if (smc_nl_fill_stats_hslat_data(skb, stats, tech,
+					 SMC_NLA_STATS_T_SRV_LINK_LAT))
+		goto errattr;
 	if (nla_put_u64_64bit(skb, SMC_NLA_STATS_T_CLNT_V1_SUCC,
 			      smc_tech->clnt_v1_succ_cnt,
 			      SMC_NLA_STATS_PAD))
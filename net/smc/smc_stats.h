@@ -54,12 +54,18 @@ struct smc_stats_rmbcnt {
 	u64	reuse_cnt;
 	u64	alloc_cnt;
 	u64	dgrade_cnt;
+	u64	pool_cnt;
 };
 
 struct smc_stats_memsize {
 	u64	buf[SMC_BUF_MAX];
 };
 
+struct smc_stats_hslat {
+	u64	sum_us;
+	u64	cnt;
+};
+
 struct smc_stats_tech {
 	struct smc_stats_memsize tx_rmbsize;
 	struct smc_stats_memsize rx_rmbsize;
@@ -79,6 +85,10 @@ struct smc_stats_tech {
 	u64			tx_bytes;
 	u64			rx_cnt;
 	u64			tx_cnt;
+	struct smc_stats_hslat	clnt_clc_lat;
+	struct smc_stats_hslat	clnt_link_lat;
+	struct smc_stats_hslat	srv_clc_lat;
+	struct smc_stats_hslat	srv_link_lat;
 };
 
 struct smc_stats {
@@ -189,6 +199,9 @@ while (0)
 #define SMC_STAT_RMB_ALLOC(smc, is_smcd, is_rx) \
 	SMC_STAT_RMB(smc, alloc, is_smcd, is_rx)
 
+#define SMC_STAT_BUF_POOL(smc, is_smcd, is_rx) \
+	SMC_STAT_RMB(smc, pool, is_smcd, is_rx)
+
 #define SMC_STAT_RMB_DOWNGRADED(smc, is_smcd, is_rx) \
 	SMC_STAT_RMB(smc, dgrade, is_smcd, is_rx)
 
@@ -257,6 +270,17 @@ do { \
 } \
 while (0)
 
+/* time spent in a handshake stage since _start */
+#define SMC_STAT_HS_LAT(net, _is_smcd, key, _start) \
+do { \
+	struct smc_stats __percpu *smc_stats = (net)->smc.smc_stats; \
+	int t = (_is_smcd) ? SMC_TYPE_D : SMC_TYPE_R; \
+	s64 us = ktime_us_delta(ktime_get(), (_start)); \
+	this_cpu_add(smc_stats->smc[t].key ## _lat.sum_us, us); \
+	this_cpu_inc(smc_stats->smc[t].key ## _lat.cnt); \
+} \
+while (0)
+
 int smc_nl_get_stats(struct sk_buff *skb, struct netlink_callback *cb);
 int smc_nl_get_fback_stats(struct sk_buff *skb, struct netlink_callback *cb);
 int smc_stats_init(struct net *net);
@@ -6,9 +6,11 @@
 #include <net/netns/generic.h>
 
 struct cache_detail;
+struct svc_qlat_stats;
 
 struct sunrpc_net {
 	struct proc_dir_entry *proc_net_rpc;
+	struct svc_qlat_stats __percpu *svc_qlat;
 	struct cache_detail *ip_map_cache;
 	struct cache_detail *unix_gid_cache;
 	struct cache_detail *rsc_cache;
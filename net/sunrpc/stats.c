@@ -28,6 +28,7 @@
 #include <trace/events/sunrpc.h>
 
 #include "netns.h"
+#include "sunrpc.h"
 
 #define RPCDBG_FACILITY	RPCDBG_MISC
 
@@ -328,6 +329,68 @@ svc_proc_unregister(struct net *net, const char *name)
 }
 EXPORT_SYMBOL_GPL(svc_proc_unregister);
 
+/*
+ * Server transport queueing latency: the time from svc_xprt_enqueue()
+ * waking a thread until that thread dequeued the transport, in
+ * power-of-two microsecond buckets. Transports picked up by a thread
+ * that was already running are only counted.
+ */
+#define SVC_QLAT_BUCKETS	16
+
+struct svc_qlat_stats {
+	u64	dequeued;
+	u64	woken;
+	u64	total_us;
+	u64	hist[SVC_QLAT_BUCKETS];
+};
+
+void svc_count_qlatency(struct net *net, ktime_t qtime, bool woken)
+{
+	struct sunrpc_net *sn = net_generic(net, sunrpc_net_id);
+	struct svc_qlat_stats *qs;
+	s64 us;
+
+	if (!sn->svc_qlat)
+		return;
+
+	qs = get_cpu_ptr(sn->svc_qlat);
+	qs->dequeued++;
+	if (woken) {
+		us = ktime_us_delta(ktime_get(), qtime);
+		if (us < 0)
+			us = 0;
+		qs->woken++;
+		qs->total_us += us;
+		qs->hist[min_t(unsigned int, fls64(us), SVC_QLAT_BUCKETS - 1)]++;
+	}
+	put_cpu_ptr(sn->svc_qlat);
+}
+
+static int svc_qlat_show(struct seq_file *seq, void *v)
+{
+	struct sunrpc_net *sn = net_generic(seq_file_single_net(seq),
+					    sunrpc_net_id);
+	struct svc_qlat_stats sum = { };
+	unsigned int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		const struct svc_qlat_stats *qs = per_cpu_ptr(sn->svc_qlat, cpu);
+
+		sum.dequeued += qs->dequeued;
+		sum.woken += qs->woken;
+		sum.total_us += qs->total_us;
+		for (i = 0; i < SVC_QLAT_BUCKETS; i++)
+			sum.hist[i] += qs->hist[i];
+	}
+
+	seq_printf(seq, "dequeued %llu woken %llu total-us %llu\nhist",
+		   sum.dequeued, sum.woken, sum.total_us);
+	for (i = 0; i < SVC_QLAT_BUCKETS; i++)
+		seq_printf(seq, " %llu", sum.hist[i]);
+	seq_putc(seq, '\n');
+	return 0;
+}
+
 int rpc_proc_init(struct net *net)
 {
 	struct sunrpc_net *sn;
@@ -338,11 +401,27 @@ int rpc_proc_init(struct net *net)
 	if (sn->proc_net_rpc == NULL)
 		return -ENOMEM;
 
+	/* the latency stats are optional, don't fail the netns for them */
+	sn->svc_qlat = alloc_percpu(struct svc_qlat_stats);
+	if (sn->svc_qlat &&
+	    !proc_create_net_single("svc_qlatency", 0444, sn->proc_net_rpc,
+				    svc_qlat_show, NULL)) {
+		free_percpu(sn->svc_qlat);
+		sn->svc_qlat = NULL;
+	}
+
 	return 0;
 }
 
 void rpc_proc_exit(struct net *net)
 {
+	struct sunrpc_net *sn = net_generic(net, sunrpc_net_id);
+
 	dprintk("RPC:       unregistering /proc/net/rpc\n");
+	if (sn->svc_qlat) {
+		remove_proc_entry("svc_qlatency", sn->proc_net_rpc);
+		free_percpu(sn->svc_qlat);
+		sn->svc_qlat = NULL;
+	}
 	remove_proc_entry("rpc", net->proc_net);
 }
@@ -14,6 +14,7 @@
 #define _NET_SUNRPC_SUNRPC_H
 
 #include <linux/net.h>
+#include <linux/ktime.h>
 
 /*
  * Header for dynamically allocated rpc buffers.
@@ -39,4 +40,5 @@ static inline int sock_is_loopback(struct sock *sk)
 int rpc_clients_notifier_register(void);
 void rpc_clients_notifier_unregister(void);
 void auth_domain_cleanup(void);
+void svc_count_qlatency(struct net *net, ktime_t qtime, bool woken);
 #endif /* _NET_SUNRPC_SUNRPC_H */
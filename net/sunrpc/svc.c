@@ -37,7 +37,11 @@
 
 static void svc_unregister(const struct svc_serv *serv, struct net *net);
 
-#define SVC_POOL_DEFAULT	SVC_POOL_GLOBAL
+/*
+ * One pool per NUMA node keeps the transport queue and the thread list
+ * node local; on a single node machine this ends up as the global pool.
+ */
+#define SVC_POOL_DEFAULT	SVC_POOL_PERNODE
 
 /*
  * Mode for mapping cpus to pools.
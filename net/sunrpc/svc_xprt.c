@@ -21,6 +21,8 @@
 #include <linux/netdevice.h>
 #include <trace/events/sunrpc.h>
 
+#include "sunrpc.h"
+
 #define RPCDBG_FACILITY	RPCDBG_SVCXPRT
 
 static unsigned int svc_rpc_per_connection_limit __read_mostly;
@@ -479,7 +481,11 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 	/* find a thread for this xprt */
 	rcu_read_lock();
 	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
-		if (test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
+		/* With many threads most are busy: skip them without
+		 * dirtying their cache line with an atomic RMW.
+		 */
+		if (test_bit(RQ_BUSY, &rqstp->rq_flags) ||
+		    test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
 			continue;
 		percpu_counter_inc(&pool->sp_threads_woken);
 		rqstp->rq_qtime = ktime_get();
@@ -754,6 +760,7 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 {
 	struct svc_pool		*pool = rqstp->rq_pool;
 	long			time_left = 0;
+	bool			woken = false;
 
 	/* rq_xprt should be clear on entry */
 	WARN_ON_ONCE(rqstp->rq_xprt);
@@ -779,8 +786,8 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 
 	try_to_freeze();
 
-	set_bit(RQ_BUSY, &rqstp->rq_flags);
-	smp_mb__after_atomic();
+	/* RQ_BUSY already set means svc_xprt_enqueue() woke us */
+	woken = test_and_set_bit(RQ_BUSY, &rqstp->rq_flags);
 	rqstp->rq_xprt = svc_xprt_dequeue(pool);
 	if (rqstp->rq_xprt)
 		goto out_found;
@@ -799,6 +806,7 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 		rqstp->rq_chandle.thread_wait = 5*HZ;
 	else
 		rqstp->rq_chandle.thread_wait = 1*HZ;
+	svc_count_qlatency(rqstp->rq_xprt->xpt_net, rqstp->rq_qtime, woken);
 	trace_svc_xprt_dequeue(rqstp);
 	return rqstp->rq_xprt;
 }
@@ -32,4 +32,8 @@ void rpc_sysfs_xprt_setup(struct rpc_xprt_switch *xprt_switch,
 			  struct rpc_xprt *xprt, gfp_t gfp_flags);
 void rpc_sysfs_xprt_destroy(struct rpc_xprt *xprt);
 
+/* xprtmultipath.c */
+int rpc_xprt_switch_set_policy(struct rpc_xprt_switch *xps, const char *name);
+const char *rpc_xprt_switch_policy(struct rpc_xprt_switch *xps);
+
 #endif
@@ -26,6 +26,7 @@ typedef struct rpc_xprt *(*xprt_switch_find_xprt_t)(struct rpc_xprt_switch *xps,
 
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_singular;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_roundrobin;
+static const struct rpc_xprt_iter_ops rpc_xprt_iter_leastqueue;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_listall;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_listoffline;
 
@@ -208,10 +209,56 @@ void xprt_switch_put(struct rpc_xprt_switch *xps)
  */
 void rpc_xprt_switch_set_roundrobin(struct rpc_xprt_switch *xps)
 {
-	if (READ_ONCE(xps->xps_iter_ops) != &rpc_xprt_iter_roundrobin)
+	/* Don't override a policy chosen through sysfs */
+	if (READ_ONCE(xps->xps_iter_ops) == &rpc_xprt_iter_singular)
 		WRITE_ONCE(xps->xps_iter_ops, &rpc_xprt_iter_roundrobin);
 }
 
+static const struct {
+	const char *name;
+	const struct rpc_xprt_iter_ops *ops;
+} rpc_xprt_switch_policies[] = {
+	{ "roundrobin", &rpc_xprt_iter_roundrobin },
+	{ "leastqueue", &rpc_xprt_iter_leastqueue },
+};
+
+/**
+ * rpc_xprt_switch_set_policy - Set the transport selection policy by name
+ * @xps: pointer to struct rpc_xprt_switch
+ * @name: "roundrobin" or "leastqueue"
+ *
+ * Returns zero on success, otherwise -EINVAL.
+ */
+int rpc_xprt_switch_set_policy(struct rpc_xprt_switch *xps, const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rpc_xprt_switch_policies); i++) {
+		if (sysfs_streq(name, rpc_xprt_switch_policies[i].name)) {
+			WRITE_ONCE(xps->xps_iter_ops,
+				   rpc_xprt_switch_policies[i].ops);
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
+/**
+ * rpc_xprt_switch_policy - Name of the transport selection policy
+ * @xps: pointer to struct rpc_xprt_switch
+ */
+const char *rpc_xprt_switch_policy(struct rpc_xprt_switch *xps)
+{
+	const struct rpc_xprt_iter_ops *ops = READ_ONCE(xps->xps_iter_ops);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rpc_xprt_switch_policies); i++) {
+		if (ops == rpc_xprt_switch_policies[i].ops)
+			return rpc_xprt_switch_policies[i].name;
+	}
+	return "singular";
+}
+
 static
 const struct rpc_xprt_iter_ops *xprt_iter_ops(const struct rpc_xprt_iter *xpi)
 {
@@ -446,6 +493,42 @@ struct rpc_xprt *xprt_iter_next_entry_roundrobin(struct rpc_xprt_iter *xpi)
 			xprt_switch_find_next_entry_roundrobin);
 }
 
+/*
+ * Pick the active transport with the fewest outstanding requests.  The
+ * search starts after the cursor, so that idle transports are still used
+ * in turn.
+ */
+static
+struct rpc_xprt *xprt_switch_find_next_entry_leastqueue(struct rpc_xprt_switch *xps,
+		const struct rpc_xprt *cur)
+{
+	struct list_head *head = &xps->xps_xprt_list;
+	struct rpc_xprt *xprt, *best = NULL;
+	unsigned long queuelen, best_queuelen = ULONG_MAX;
+	unsigned int n = READ_ONCE(xps->xps_nxprts);
+
+	xprt = __xprt_switch_find_next_entry_roundrobin(head, cur);
+	/* Bounded, transports may go offline while we walk the list */
+	while (xprt && n--) {
+		queuelen = atomic_long_read(&xprt->queuelen);
+		if (queuelen < best_queuelen) {
+			best = xprt;
+			best_queuelen = queuelen;
+			if (!queuelen)
+				break;
+		}
+		xprt = __xprt_switch_find_next_entry_roundrobin(head, xprt);
+	}
+	return best;
+}
+
+static
+struct rpc_xprt *xprt_iter_next_entry_leastqueue(struct rpc_xprt_iter *xpi)
+{
+	return xprt_iter_next_entry_multiple(xpi,
+			xprt_switch_find_next_entry_leastqueue);
+}
+
 static
 struct rpc_xprt *xprt_switch_find_next_entry_all(struct rpc_xprt_switch *xps,
 		const struct rpc_xprt *cur)
@@ -639,6 +722,14 @@ const struct rpc_xprt_iter_ops rpc_xprt_iter_roundrobin = {
 	.xpi_next = xprt_iter_next_entry_roundrobin,
 };
 
+/* Policy for picking the least loaded entry in the rpc_xprt_switch */
+static
+const struct rpc_xprt_iter_ops rpc_xprt_iter_leastqueue = {
+	.xpi_rewind = xprt_iter_default_rewind,
+	.xpi_xprt = xprt_iter_current_entry,
+	.xpi_next = xprt_iter_next_entry_leastqueue,
+};
+
 /* Policy for once-through iteration of entries in the rpc_xprt_switch */
 static
 const struct rpc_xprt_iter_ops rpc_xprt_iter_listall = {
@@ -672,6 +672,34 @@ xs_read_stream_reply(struct sock_xprt *transport, struct msghdr *msg, int flags)
 	return ret;
 }
 
+/*
+ * While the rest of a large fragment is still on its way, have TCP only
+ * signal data_ready once it has all arrived (or as much of it as the
+ * receive buffer allows), rather than every few segments: that takes far
+ * fewer receive worker runs and copies larger chunks per recvmsg.
+ */
+#define XS_STREAM_RCVLOWAT_MIN	(64U * 1024)
+
+static void
+xs_stream_set_rcvlowat(struct sock_xprt *transport, size_t want)
+{
+	struct socket *sock = transport->sock;
+	struct sock *sk = sock->sk;
+	int val = 1;
+
+	if (!sock->ops->set_rcvlowat ||
+	    transport->xprt.xprtsec.policy != RPC_XPRTSEC_NONE)
+		return;
+	if (want >= XS_STREAM_RCVLOWAT_MIN)
+		val = min_t(size_t, want, INT_MAX);
+	else if (READ_ONCE(sk->sk_rcvlowat) == 1)
+		return;
+
+	lock_sock(sk);
+	sock->ops->set_rcvlowat(sk, val);
+	release_sock(sk);
+}
+
 static ssize_t
 xs_read_stream(struct sock_xprt *transport, int flags)
 {
@@ -712,8 +740,11 @@ xs_read_stream(struct sock_xprt *transport, int flags)
 		goto out_err;
 	read += ret;
 	if (transport->recv.offset < transport->recv.len) {
-		if (!(msg.msg_flags & MSG_TRUNC))
+		if (!(msg.msg_flags & MSG_TRUNC)) {
+			xs_stream_set_rcvlowat(transport, transport->recv.len -
+					       transport->recv.offset);
 			return read;
+		}
 		msg.msg_flags = 0;
 		ret = xs_read_discard(transport->sock, &msg, flags,
 				transport->recv.len - transport->recv.offset);
@@ -730,6 +761,7 @@ xs_read_stream(struct sock_xprt *transport, int flags)
 	}
 	transport->recv.offset = 0;
 	transport->recv.len = 0;
+	xs_stream_set_rcvlowat(transport, 0);
 	return read;
 out_err:
 	return ret != 0 ? ret : -ESHUTDOWN;
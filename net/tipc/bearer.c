@@ -575,6 +575,27 @@ void tipc_bearer_xmit_skb(struct net *net, u32 bearer_id,
 	rcu_read_unlock();
 }
 
+/* tipc_bearer_send_list - hand a queue of buffers for the same destination
+ * to the media, in one go if it supports that
+ */
+static void tipc_bearer_send_list(struct net *net, struct tipc_bearer *b,
+				  struct sk_buff_head *sendq,
+				  struct tipc_media_addr *dst)
+{
+	struct sk_buff *skb;
+
+	if (skb_queue_empty(sendq))
+		return;
+
+	if (b->media->send_list) {
+		b->media->send_list(net, sendq, b, dst);
+		return;
+	}
+
+	while ((skb = __skb_dequeue(sendq)))
+		b->media->send_msg(net, skb, b, dst);
+}
+
 /* tipc_bearer_xmit() -send buffer to destination over bearer
  */
 void tipc_bearer_xmit(struct net *net, u32 bearer_id,
@@ -582,12 +603,14 @@ void tipc_bearer_xmit(struct net *net, u32 bearer_id,
 		      struct tipc_media_addr *dst,
 		      struct tipc_node *__dnode)
 {
+	struct sk_buff_head sendq;
 	struct tipc_bearer *b;
 	struct sk_buff *skb, *tmp;
 
 	if (skb_queue_empty(xmitq))
 		return;
 
+	__skb_queue_head_init(&sendq);
 	rcu_read_lock();
 	b = bearer_get(net, bearer_id);
 	if (unlikely(!b))
@@ -599,11 +622,13 @@ void tipc_bearer_xmit(struct net *net, u32 bearer_id,
 			tipc_crypto_xmit(net, &skb, b, dst, __dnode);
 			if (skb)
 #endif
-				b->media->send_msg(net, skb, b, dst);
+				__skb_queue_tail(&sendq, skb);
 		} else {
 			kfree_skb(skb);
 		}
 	}
+	if (b)
+		tipc_bearer_send_list(net, b, &sendq, dst);
 	rcu_read_unlock();
 }
 
@@ -615,10 +640,12 @@ void tipc_bearer_bc_xmit(struct net *net, u32 bearer_id,
 	struct tipc_net *tn = tipc_net(net);
 	struct tipc_media_addr *dst;
 	int net_id = tn->net_id;
+	struct sk_buff_head sendq;
 	struct tipc_bearer *b;
 	struct sk_buff *skb, *tmp;
 	struct tipc_msg *hdr;
 
+	__skb_queue_head_init(&sendq);
 	rcu_read_lock();
 	b = bearer_get(net, bearer_id);
 	if (unlikely(!b || !test_bit(0, &b->up)))
@@ -633,8 +660,10 @@ void tipc_bearer_bc_xmit(struct net *net, u32 bearer_id,
 		tipc_crypto_xmit(net, &skb, b, dst, NULL);
 		if (skb)
 #endif
-			b->media->send_msg(net, skb, b, dst);
+			__skb_queue_tail(&sendq, skb);
 	}
+	if (b)
+		tipc_bearer_send_list(net, b, &sendq, &b->bcast_addr);
 	rcu_read_unlock();
 }
 
@@ -85,6 +85,8 @@ struct tipc_bearer;
 /**
  * struct tipc_media - Media specific info exposed to generic bearer layer
  * @send_msg: routine which handles buffer transmission
+ * @send_list: optional routine which transmits a queue of buffers to the same
+ * destination in one go
  * @enable_media: routine which enables a media
  * @disable_media: routine which disables a media
  * @addr2str: convert media address format to string
@@ -105,6 +107,9 @@ struct tipc_media {
 	int (*send_msg)(struct net *net, struct sk_buff *buf,
 			struct tipc_bearer *b,
 			struct tipc_media_addr *dest);
+	int (*send_list)(struct net *net, struct sk_buff_head *xmitq,
+			 struct tipc_bearer *b,
+			 struct tipc_media_addr *dest);
 	int (*enable_media)(struct net *net, struct tipc_bearer *b,
 			    struct nlattr *attr[]);
 	void (*disable_media)(struct tipc_bearer *b);
@@ -163,11 +163,16 @@ static int tipc_udp_addr2msg(char *msg, struct tipc_media_addr *a)
 	return 0;
 }
 
-/* tipc_send_msg - enqueue a send request */
-static int tipc_udp_xmit(struct net *net, struct sk_buff *skb,
+/* tipc_udp_xmit - send a queue of buffers to the same destination
+ *
+ * The route is looked up once for the whole queue, each buffer consumes
+ * a reference on it. The queue is always emptied.
+ */
+static int tipc_udp_xmit(struct net *net, struct sk_buff_head *xmitq,
 			 struct udp_bearer *ub, struct udp_media_addr *src,
 			 struct udp_media_addr *dst, struct dst_cache *cache)
 {
+	struct sk_buff *skb = skb_peek(xmitq);
 	struct dst_entry *ndst;
 	int ttl, err = 0;
 
@@ -192,9 +197,14 @@ static int tipc_udp_xmit(struct net *net, struct sk_buff *skb,
 		}
 
 		ttl = ip4_dst_hoplimit(&rt->dst);
-		udp_tunnel_xmit_skb(rt, ub->ubsock->sk, skb, src->ipv4.s_addr,
-				    dst->ipv4.s_addr, 0, ttl, 0, src->port,
-				    dst->port, false, true);
+		while ((skb = __skb_dequeue(xmitq))) {
+			if (!skb_queue_empty(xmitq))
+				dst_hold(&rt->dst);
+			udp_tunnel_xmit_skb(rt, ub->ubsock->sk, skb,
+					    src->ipv4.s_addr, dst->ipv4.s_addr,
+					    0, ttl, 0, src->port, dst->port,
+					    false, true);
+		}
 #if IS_ENABLED(CONFIG_IPV6)
 	} else {
 		if (!ndst) {
@@ -214,9 +224,18 @@ static int tipc_udp_xmit(struct net *net, struct sk_buff *skb,
 			dst_cache_set_ip6(cache, ndst, &fl6.saddr);
 		}
 		ttl = ip6_dst_hoplimit(ndst);
-		err = udp_tunnel6_xmit_skb(ndst, ub->ubsock->sk, skb, NULL,
-					   &src->ipv6, &dst->ipv6, 0, ttl, 0,
-					   src->port, dst->port, false);
+		while ((skb = __skb_dequeue(xmitq))) {
+			int rc;
+
+			if (!skb_queue_empty(xmitq))
+				dst_hold(ndst);
+			rc = udp_tunnel6_xmit_skb(ndst, ub->ubsock->sk, skb,
+						  NULL, &src->ipv6, &dst->ipv6,
+						  0, ttl, 0, src->port,
+						  dst->port, false);
+			if (rc)
+				err = rc;
+		}
 #endif
 	}
 	local_bh_enable();
@@ -224,58 +243,83 @@ static int tipc_udp_xmit(struct net *net, struct sk_buff *skb,
 
 tx_error:
 	local_bh_enable();
-	kfree_skb(skb);
+	__skb_queue_purge(xmitq);
 	return err;
 }
 
-static int tipc_udp_send_msg(struct net *net, struct sk_buff *skb,
-			     struct tipc_bearer *b,
-			     struct tipc_media_addr *addr)
+/* tipc_udp_send_list - send a queue of buffers to the same media address */
+static int tipc_udp_send_list(struct net *net, struct sk_buff_head *xmitq,
+			      struct tipc_bearer *b,
+			      struct tipc_media_addr *addr)
 {
 	struct udp_media_addr *src = (struct udp_media_addr *)&b->addr.value;
 	struct udp_media_addr *dst = (struct udp_media_addr *)&addr->value;
 	struct udp_replicast *rcast;
+	struct sk_buff_head rcastq;
+	struct sk_buff *skb, *tmp;
 	struct udp_bearer *ub;
 	int err = 0;
 
-	if (skb_headroom(skb) < UDP_MIN_HEADROOM) {
-		err = pskb_expand_head(skb, UDP_MIN_HEADROOM, 0, GFP_ATOMIC);
-		if (err)
-			goto out;
-	}
-
-	skb_set_inner_protocol(skb, htons(ETH_P_TIPC));
 	ub = rcu_dereference(b->media_ptr);
 	if (!ub) {
 		err = -ENODEV;
 		goto out;
 	}
 
+	skb_queue_walk_safe(xmitq, skb, tmp) {
+		if (skb_headroom(skb) < UDP_MIN_HEADROOM &&
+		    pskb_expand_head(skb, UDP_MIN_HEADROOM, 0, GFP_ATOMIC)) {
+			__skb_unlink(skb, xmitq);
+			kfree_skb(skb);
+			err = -ENOMEM;
+			continue;
+		}
+		skb_set_inner_protocol(skb, htons(ETH_P_TIPC));
+	}
+	if (skb_queue_empty(xmitq))
+		return err;
+
 	if (addr->broadcast != TIPC_REPLICAST_SUPPORT)
-		return tipc_udp_xmit(net, skb, ub, src, dst,
+		return tipc_udp_xmit(net, xmitq, ub, src, dst,
 				     &ub->rcast.dst_cache);
 
-	/* Replicast, send an skb to each configured IP address */
+	/* Replicast, send a copy of the buffers to each configured IP address */
+	__skb_queue_head_init(&rcastq);
 	list_for_each_entry_rcu(rcast, &ub->rcast.list, list) {
-		struct sk_buff *_skb;
-
-		_skb = pskb_copy(skb, GFP_ATOMIC);
-		if (!_skb) {
-			err = -ENOMEM;
-			goto out;
+		skb_queue_walk(xmitq, skb) {
+			struct sk_buff *_skb;
+
+			_skb = pskb_copy(skb, GFP_ATOMIC);
+			if (!_skb) {
+				__skb_queue_purge(&rcastq);
+				err = -ENOMEM;
+				goto out;
+			}
+			__skb_queue_tail(&rcastq, _skb);
 		}
 
-		err = tipc_udp_xmit(net, _skb, ub, src, &rcast->addr,
+		err = tipc_udp_xmit(net, &rcastq, ub, src, &rcast->addr,
 				    &rcast->dst_cache);
 		if (err)
 			goto out;
 	}
 	err = 0;
 out:
-	kfree_skb(skb);
+	__skb_queue_purge(xmitq);
 	return err;
 }
 
+static int tipc_udp_send_msg(struct net *net, struct sk_buff *skb,
+			     struct tipc_bearer *b,
+			     struct tipc_media_addr *addr)
+{
+	struct sk_buff_head xmitq;
+
+	__skb_queue_head_init(&xmitq);
+	__skb_queue_tail(&xmitq, skb);
+	return tipc_udp_send_list(net, &xmitq, b, addr);
+}
+
 static bool tipc_udp_is_known_peer(struct tipc_bearer *b,
 				   struct udp_media_addr *addr)
 {
@@ -773,6 +817,12 @@ static int tipc_udp_enable(struct net *net, struct tipc_bearer *b,
 	tuncfg.encap_destroy = NULL;
 	setup_udp_tunnel_sock(net, ub->ubsock, &tuncfg);
 
+	/* Let GRO aggregate the bearer traffic on its way up the IP stack;
+	 * without accept_udp_l4 the aggregate is split again before it is
+	 * handed to tipc_udp_recv().
+	 */
+	udp_sk(ub->ubsock->sk)->gro_enabled = 1;
+
 	err = dst_cache_init(&ub->rcast.dst_cache, GFP_ATOMIC);
 	if (err)
 		goto free;
@@ -839,6 +889,7 @@ static void tipc_udp_disable(struct tipc_bearer *b)
 
 struct tipc_media udp_media_info = {
 	.send_msg	= tipc_udp_send_msg,
+	.send_list	= tipc_udp_send_list,
 	.enable_media	= tipc_udp_enable,
 	.disable_media	= tipc_udp_disable,
 	.addr2str	= tipc_udp_addr2str,
@@ -105,6 +105,7 @@ static inline bool too_many_unix_fds(struct task_struct *p)
 
 int unix_attach_fds(struct scm_cookie *scm, struct sk_buff *skb)
 {
+	u32 nr_unix_fds = 0;
 	int i;
 
 	if (too_many_unix_fds(current))
@@ -119,8 +120,12 @@ int unix_attach_fds(struct scm_cookie *scm, struct sk_buff *skb)
 	if (!UNIXCB(skb).fp)
 		return -ENOMEM;
 
-	for (i = scm->fp->count - 1; i >= 0; i--)
+	for (i = scm->fp->count - 1; i >= 0; i--) {
 		unix_inflight(scm->fp->user, scm->fp->fp[i]);
+		if (unix_get_socket(scm->fp->fp[i]))
+			nr_unix_fds++;
+	}
+	UNIXCB(skb).nr_unix_fds = nr_unix_fds;
 	return 0;
 }
 EXPORT_SYMBOL(unix_attach_fds);
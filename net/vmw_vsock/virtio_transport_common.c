@@ -472,6 +472,7 @@ static int virtio_transport_seqpacket_do_dequeue(struct vsock_sock *vsk,
 	size_t user_buf_len = msg_data_left(msg);
 	bool msg_ready = false;
 	struct sk_buff *skb;
+	u32 free_space;
 
 	spin_lock_bh(&vvs->rx_lock);
 
@@ -532,9 +533,13 @@ static int virtio_transport_seqpacket_do_dequeue(struct vsock_sock *vsk,
 		kfree_skb(skb);
 	}
 
+	free_space = vvs->buf_alloc - (vvs->fwd_cnt - vvs->last_fwd_cnt);
+
 	spin_unlock_bh(&vvs->rx_lock);
 
-	virtio_transport_send_credit_update(vsk);
+	/* Same batching of the credit update messages as for stream sockets */
+	if (free_space < VIRTIO_VSOCK_MAX_PKT_BUF_SIZE)
+		virtio_transport_send_credit_update(vsk);
 
 	return dequeued_len;
 }
@@ -23,6 +23,7 @@
 #include <linux/netdevice.h>
 #include <linux/rculist.h>
 #include <linux/vmalloc.h>
+#include <linux/virtio_net.h>
 #include <net/xdp_sock_drv.h>
 #include <net/busy_poll.h>
 #include <net/xdp.h>
@@ -32,15 +33,49 @@
 #include "xsk.h"
 
 #define TX_BATCH_SIZE 32
+/* A packet has to fit in a batch and in an skb */
+#define XSK_TX_MAX_DESCS (MAX_SKB_FRAGS + 1 < TX_BATCH_SIZE ? \
+			  MAX_SKB_FRAGS + 1 : TX_BATCH_SIZE)
 
 static DEFINE_PER_CPU(struct list_head, xskmap_flush_list);
 
+/* The own fill rings of the sockets sharing @pool, see xp_add_fq() */
+static void xsk_extra_fqs_flags(struct xsk_buff_pool *pool, bool set)
+{
+	struct xsk_fq_array *fqs;
+	struct xsk_queue *fq;
+	u32 i;
+
+	rcu_read_lock();
+	fqs = rcu_dereference(pool->extra_fqs);
+	for (i = 0; fqs && i < fqs->nr; i++) {
+		fq = READ_ONCE(fqs->fqs[i]);
+		if (!fq)
+			continue;
+		if (set)
+			fq->ring->flags |= XDP_RING_NEED_WAKEUP;
+		else
+			fq->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+	}
+	rcu_read_unlock();
+}
+
+/* The driver polled the queue, a new kick is needed to have it poll again */
+static void xsk_wakeup_done(struct xsk_buff_pool *pool, u8 flag)
+{
+	if (unlikely(READ_ONCE(pool->wakeup_pending) & flag))
+		clear_bit(__ffs(flag), &pool->wakeup_pending);
+}
+
 void xsk_set_rx_need_wakeup(struct xsk_buff_pool *pool)
 {
+	xsk_wakeup_done(pool, XDP_WAKEUP_RX);
 	if (pool->cached_need_wakeup & XDP_WAKEUP_RX)
 		return;
 
 	pool->fq->ring->flags |= XDP_RING_NEED_WAKEUP;
+	if (rcu_access_pointer(pool->extra_fqs))
+		xsk_extra_fqs_flags(pool, true);
 	pool->cached_need_wakeup |= XDP_WAKEUP_RX;
 }
 EXPORT_SYMBOL(xsk_set_rx_need_wakeup);
@@ -49,6 +84,7 @@ void xsk_set_tx_need_wakeup(struct xsk_buff_pool *pool)
 {
 	struct xdp_sock *xs;
 
+	xsk_wakeup_done(pool, XDP_WAKEUP_TX);
 	if (pool->cached_need_wakeup & XDP_WAKEUP_TX)
 		return;
 
@@ -64,10 +100,21 @@ EXPORT_SYMBOL(xsk_set_tx_need_wakeup);
 
 void xsk_clear_rx_need_wakeup(struct xsk_buff_pool *pool)
 {
+	/* A busy-polling application only gets its packets from recvmsg(),
+	 * tell it to keep calling it even though the driver made progress.
+	 */
+	if (READ_ONCE(pool->busy_poll_rx)) {
+		xsk_set_rx_need_wakeup(pool);
+		return;
+	}
+
+	xsk_wakeup_done(pool, XDP_WAKEUP_RX);
 	if (!(pool->cached_need_wakeup & XDP_WAKEUP_RX))
 		return;
 
 	pool->fq->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+	if (rcu_access_pointer(pool->extra_fqs))
+		xsk_extra_fqs_flags(pool, false);
 	pool->cached_need_wakeup &= ~XDP_WAKEUP_RX;
 }
 EXPORT_SYMBOL(xsk_clear_rx_need_wakeup);
@@ -76,6 +123,7 @@ void xsk_clear_tx_need_wakeup(struct xsk_buff_pool *pool)
 {
 	struct xdp_sock *xs;
 
+	xsk_wakeup_done(pool, XDP_WAKEUP_TX);
 	if (!(pool->cached_need_wakeup & XDP_WAKEUP_TX))
 		return;
 
@@ -403,52 +451,121 @@ EXPORT_SYMBOL(xsk_tx_peek_release_desc_batch);
 
 static int xsk_wakeup(struct xdp_sock *xs, u8 flags)
 {
+	struct xsk_buff_pool *pool = xs->pool;
 	struct net_device *dev = xs->dev;
+	unsigned long bits = flags;
+	unsigned int bit;
+	int err;
 
-	return dev->netdev_ops->ndo_xsk_wakeup(dev, xs->queue_id, flags);
+	if (!pool->uses_need_wakeup)
+		return dev->netdev_ops->ndo_xsk_wakeup(dev, xs->queue_id, flags);
+
+	/* Under load the application finds need_wakeup still set until the
+	 * driver gets to poll, and kicking it again in the meantime only
+	 * costs an IPI or a register write. The driver acks a kick in
+	 * xsk_{set,clear}_*_need_wakeup(); a kick that isn't acked within
+	 * a jiffy is repeated, in case it got lost.
+	 */
+	if ((READ_ONCE(pool->wakeup_pending) & flags) == flags &&
+	    READ_ONCE(pool->wakeup_jiffies) == jiffies)
+		return 0;
+
+	/* Mark the kick before doing it, so that an ack racing with it from
+	 * the driver's NAPI on another CPU isn't overwritten.
+	 */
+	WRITE_ONCE(pool->wakeup_jiffies, jiffies);
+	for_each_set_bit(bit, &bits, BITS_PER_BYTE)
+		set_bit(bit, &pool->wakeup_pending);
+
+	err = dev->netdev_ops->ndo_xsk_wakeup(dev, xs->queue_id, flags);
+	if (err) {
+		for_each_set_bit(bit, &bits, BITS_PER_BYTE)
+			clear_bit(bit, &pool->wakeup_pending);
+	}
+	return err;
+}
+
+/* Umem addresses of a packet spanning several descriptors */
+struct xsk_skb_addrs {
+	u32 num;
+	u64 addrs[XSK_TX_MAX_DESCS];
+};
+
+/* Completion ring of the copy mode Tx of @xs and the lock protecting it */
+static struct xsk_queue *xsk_skb_cq(struct xdp_sock *xs, spinlock_t **lock)
+{
+	if (xs->cq) {
+		*lock = &xs->cq_lock;
+		return xs->cq;
+	}
+
+	*lock = &xs->pool->cq_lock;
+	return xs->pool->cq;
+}
+
+static void xsk_cq_submit_addrs(struct xdp_sock *xs, u64 *addrs, u32 num)
+{
+	unsigned long flags;
+	struct xsk_queue *cq;
+	spinlock_t *lock;
+	u32 i;
+
+	cq = xsk_skb_cq(xs, &lock);
+	spin_lock_irqsave(lock, flags);
+	for (i = 0; i < num; i++)
+		xskq_prod_submit_addr(cq, addrs[i]);
+	spin_unlock_irqrestore(lock, flags);
 }
 
 static void xsk_destruct_skb(struct sk_buff *skb)
 {
 	u64 addr = (u64)(long)skb_shinfo(skb)->destructor_arg;
-	struct xdp_sock *xs = xdp_sk(skb->sk);
-	unsigned long flags;
 
-	spin_lock_irqsave(&xs->pool->cq_lock, flags);
-	xskq_prod_submit_addr(xs->pool->cq, addr);
-	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+	xsk_cq_submit_addrs(xdp_sk(skb->sk), &addr, 1);
+	sock_wfree(skb);
+}
 
+static void xsk_destruct_skb_mb(struct sk_buff *skb)
+{
+	struct xsk_skb_addrs *addrs = skb_shinfo(skb)->destructor_arg;
+
+	xsk_cq_submit_addrs(xdp_sk(skb->sk), addrs->addrs, addrs->num);
+	kfree(addrs);
 	sock_wfree(skb);
 }
 
-static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
-					      struct xdp_desc *desc)
+/* Free an skb that wasn't sent, without completing its descriptors */
+static void xsk_consume_skb(struct sk_buff *skb)
+{
+	if (skb->destructor == xsk_destruct_skb_mb)
+		kfree(skb_shinfo(skb)->destructor_arg);
+	skb->destructor = sock_wfree;
+	/* Free skb without triggering the perf drop trace */
+	consume_skb(skb);
+}
+
+static int xsk_skb_add_umem_frags(struct xdp_sock *xs, struct sk_buff *skb,
+				  struct xdp_desc *desc)
 {
 	struct xsk_buff_pool *pool = xs->pool;
-	u32 hr, len, ts, offset, copy, copied;
-	struct sk_buff *skb;
+	u32 len, ts, offset, copy, copied;
 	struct page *page;
 	void *buffer;
-	int err, i;
+	int i;
 	u64 addr;
 
-	hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(xs->dev->needed_headroom));
-
-	skb = sock_alloc_send_skb(&xs->sk, hr, 1, &err);
-	if (unlikely(!skb))
-		return ERR_PTR(err);
-
-	skb_reserve(skb, hr);
-
-	addr = desc->addr;
 	len = desc->len;
 	ts = pool->unaligned ? len : pool->chunk_size;
 
-	buffer = xsk_buff_raw_get_data(pool, addr);
+	buffer = xsk_buff_raw_get_data(pool, desc->addr);
 	offset = offset_in_page(buffer);
 	addr = buffer - pool->addrs;
 
-	for (copied = 0, i = 0; copied < len; i++) {
+	i = skb_shinfo(skb)->nr_frags;
+	if (i + DIV_ROUND_UP(offset + len, PAGE_SIZE) > MAX_SKB_FRAGS)
+		return -EMSGSIZE;
+
+	for (copied = 0; copied < len; i++) {
 		page = pool->umem->pgs[addr >> PAGE_SHIFT];
 		get_page(page);
 
@@ -466,58 +583,222 @@ static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
 
 	refcount_add(ts, &xs->sk.sk_wmem_alloc);
 
-	return skb;
+	return 0;
 }
 
-static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
+static int xsk_skb_copy_frag(struct xdp_sock *xs, struct sk_buff *skb,
+			     struct xdp_desc *desc)
+{
+	u32 nr_frags = skb_shinfo(skb)->nr_frags;
+	struct page *page;
+	void *buffer;
+
+	if (nr_frags == MAX_SKB_FRAGS)
+		return -EMSGSIZE;
+
+	page = alloc_page(xs->sk.sk_allocation);
+	if (unlikely(!page))
+		return -ENOMEM;
+
+	buffer = xsk_buff_raw_get_data(xs->pool, desc->addr);
+	memcpy(page_address(page), buffer, desc->len);
+	skb_add_rx_frag(skb, nr_frags, page, 0, desc->len, PAGE_SIZE);
+	refcount_add(PAGE_SIZE, &xs->sk.sk_wmem_alloc);
+
+	return 0;
+}
+
+static struct sk_buff *xsk_alloc_skb(struct xdp_sock *xs,
 				     struct xdp_desc *desc)
 {
 	struct net_device *dev = xs->dev;
 	struct sk_buff *skb;
+	u32 hr, tr, len;
+	void *buffer;
+	int err;
 
-	if (dev->priv_flags & IFF_TX_SKB_NO_LINEAR) {
-		skb = xsk_build_skb_zerocopy(xs, desc);
-		if (IS_ERR(skb))
-			return skb;
-	} else {
-		u32 hr, tr, len;
-		void *buffer;
-		int err;
-
-		hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(dev->needed_headroom));
-		tr = dev->needed_tailroom;
-		len = desc->len;
+	hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(dev->needed_headroom));
 
-		skb = sock_alloc_send_skb(&xs->sk, hr + len + tr, 1, &err);
+	if (dev->priv_flags & IFF_TX_SKB_NO_LINEAR) {
+		skb = sock_alloc_send_skb(&xs->sk, hr, 1, &err);
 		if (unlikely(!skb))
 			return ERR_PTR(err);
 
 		skb_reserve(skb, hr);
-		skb_put(skb, len);
-
-		buffer = xsk_buff_raw_get_data(xs->pool, desc->addr);
-		err = skb_store_bits(skb, 0, buffer, len);
+		err = xsk_skb_add_umem_frags(xs, skb, desc);
 		if (unlikely(err)) {
 			kfree_skb(skb);
 			return ERR_PTR(err);
 		}
+		return skb;
+	}
+
+	tr = dev->needed_tailroom;
+	len = desc->len;
+
+	skb = sock_alloc_send_skb(&xs->sk, hr + len + tr, 1, &err);
+	if (unlikely(!skb))
+		return ERR_PTR(err);
+
+	skb_reserve(skb, hr);
+	skb_put(skb, len);
+
+	buffer = xsk_buff_raw_get_data(xs->pool, desc->addr);
+	err = skb_store_bits(skb, 0, buffer, len);
+	if (unlikely(err)) {
+		kfree_skb(skb);
+		return ERR_PTR(err);
+	}
+
+	return skb;
+}
+
+/* Turn the Tx offload request into a partial checksum and GSO skb, the
+ * same way packet sockets handle a virtio_net_hdr.
+ */
+static int xsk_skb_metadata(struct sk_buff *skb, struct xsk_tx_metadata *meta)
+{
+	struct virtio_net_hdr hdr = {};
+
+	if (meta->flags & ~(XDP_TXMD_FLAGS_CHECKSUM | XDP_TXMD_FLAGS_TSO))
+		return -EINVAL;
+
+	if (meta->flags & XDP_TXMD_FLAGS_CHECKSUM) {
+		hdr.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		hdr.csum_start = __cpu_to_virtio16(true, meta->csum_start);
+		hdr.csum_offset = __cpu_to_virtio16(true, meta->csum_offset);
+	}
+
+	if (meta->flags & XDP_TXMD_FLAGS_TSO) {
+		if (!(meta->flags & XDP_TXMD_FLAGS_CHECKSUM))
+			return -EINVAL;
+
+		switch (meta->gso_type) {
+		case XDP_TXMD_GSO_TCPV4:
+			hdr.gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+			break;
+		case XDP_TXMD_GSO_TCPV6:
+			hdr.gso_type = VIRTIO_NET_HDR_GSO_TCPV6;
+			break;
+		case XDP_TXMD_GSO_UDP_L4:
+			hdr.gso_type = VIRTIO_NET_HDR_GSO_UDP_L4;
+			break;
+		default:
+			return -EINVAL;
+		}
+		hdr.gso_size = __cpu_to_virtio16(true, meta->gso_size);
+	}
+
+	skb_reset_mac_header(skb);
+	skb_set_network_header(skb, skb->dev->hard_header_len);
+	if (pskb_may_pull(skb, skb->dev->hard_header_len))
+		skb->protocol = dev_parse_header_protocol(skb);
+
+	return virtio_net_hdr_to_skb(skb, &hdr, true);
+}
+
+/* Build an skb from the @nb_descs descriptors of the next packet. Returns
+ * -EINVAL or -EMSGSIZE if the packet is invalid and has to be dropped.
+ */
+static struct sk_buff *xsk_build_skb(struct xdp_sock *xs, u32 nb_descs)
+{
+	struct xsk_buff_pool *pool = xs->pool;
+	struct xsk_skb_addrs *addrs = NULL;
+	struct xsk_tx_metadata meta = {};
+	struct sk_buff *skb = NULL;
+	struct xdp_desc desc;
+	u64 first_addr = 0;
+	int err = 0;
+	u32 i;
+
+	if (nb_descs > XSK_TX_MAX_DESCS)
+		return ERR_PTR(-EMSGSIZE);
+
+	if (nb_descs > 1) {
+		addrs = kmalloc(sizeof(*addrs), xs->sk.sk_allocation);
+		if (unlikely(!addrs))
+			return ERR_PTR(-ENOMEM);
+		addrs->num = 0;
+	}
+
+	for (i = 0; i < nb_descs; i++) {
+		bool last = i == nb_descs - 1;
+
+		/* Validate what we use, user space may have changed it */
+		xskq_cons_read_desc_at(xs->tx, i, &desc);
+		if (!xp_validate_desc(pool, &desc) ||
+		    !(desc.options & XDP_PKT_CONTD) != last ||
+		    (i && (desc.options & XDP_TX_METADATA))) {
+			err = -EINVAL;
+			goto free;
+		}
+
+		if (!i) {
+			struct xsk_tx_metadata *md;
+
+			md = xsk_buff_get_metadata(pool, &desc);
+			if (md)
+				memcpy(&meta, md, sizeof(meta));
+
+			skb = xsk_alloc_skb(xs, &desc);
+			if (IS_ERR(skb)) {
+				err = PTR_ERR(skb);
+				skb = NULL;
+				goto free;
+			}
+		} else if (xs->dev->priv_flags & IFF_TX_SKB_NO_LINEAR) {
+			err = xsk_skb_add_umem_frags(xs, skb, &desc);
+		} else {
+			err = xsk_skb_copy_frag(xs, skb, &desc);
+		}
+		if (unlikely(err))
+			goto free;
+
+		if (addrs)
+			addrs->addrs[addrs->num++] = desc.addr;
+		else
+			first_addr = desc.addr;
+	}
+
+	skb->dev = xs->dev;
+	if (meta.flags) {
+		err = xsk_skb_metadata(skb, &meta);
+		if (err)
+			goto free;
 	}
 
-	skb->dev = dev;
 	skb->priority = xs->sk.sk_priority;
 	skb->mark = xs->sk.sk_mark;
-	skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
-	skb->destructor = xsk_destruct_skb;
+	if (addrs) {
+		skb_shinfo(skb)->destructor_arg = addrs;
+		skb->destructor = xsk_destruct_skb_mb;
+	} else {
+		skb_shinfo(skb)->destructor_arg = (void *)(long)first_addr;
+		skb->destructor = xsk_destruct_skb;
+	}
 
 	return skb;
+
+free:
+	kfree(addrs);
+	kfree_skb(skb);
+	return ERR_PTR(err);
+}
+
+static void xsk_drop_pkt(struct xdp_sock *xs, u32 nb_descs)
+{
+	xs->tx->invalid_descs++;
+	xskq_cons_release_n(xs->tx, nb_descs);
 }
 
 static int __xsk_generic_xmit(struct sock *sk)
 {
 	struct xdp_sock *xs = xdp_sk(sk);
 	u32 max_batch = TX_BATCH_SIZE;
+	u32 nb_descs, reserved = 0;
+	spinlock_t *cq_lock = NULL;
+	struct xsk_queue *cq = NULL;
 	bool sent_frame = false;
-	struct xdp_desc desc;
 	struct sk_buff *skb;
 	unsigned long flags;
 	int err = 0;
@@ -530,50 +811,62 @@ static int __xsk_generic_xmit(struct sock *sk)
 		goto out;
 	}
 
+	cq = xsk_skb_cq(xs, &cq_lock);
+
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->pool)) {
-		if (max_batch-- == 0) {
-			err = -EAGAIN;
-			goto out;
+	while ((nb_descs = xskq_cons_nb_pkt_descs(xs->tx))) {
+		if (nb_descs > XSK_TX_MAX_DESCS) {
+			xsk_drop_pkt(xs, nb_descs);
+			continue;
 		}
 
-		/* This is the backpressure mechanism for the Tx path.
-		 * Reserve space in the completion queue and only proceed
-		 * if there is space in it. This avoids having to implement
-		 * any buffering in the Tx path.
-		 */
-		spin_lock_irqsave(&xs->pool->cq_lock, flags);
-		if (xskq_prod_reserve(xs->pool->cq)) {
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
+		if (nb_descs > reserved) {
+			u32 want;
+
+			if (nb_descs > max_batch) {
+				err = -EAGAIN;
+				goto out;
+			}
+
+			/* This is the backpressure mechanism for the Tx path.
+			 * Reserve space in the completion queue for the rest
+			 * of the batch and only proceed if there is space in
+			 * it. This avoids having to implement any buffering
+			 * in the Tx path.
+			 */
+			want = xskq_cons_nb_entries(xs->tx, max_batch);
+			spin_lock_irqsave(cq_lock, flags);
+			reserved += xskq_prod_reserve_n(cq, want - reserved);
+			spin_unlock_irqrestore(cq_lock, flags);
+			if (nb_descs > reserved)
+				goto out;
 		}
-		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 
-		skb = xsk_build_skb(xs, &desc);
+		skb = xsk_build_skb(xs, nb_descs);
 		if (IS_ERR(skb)) {
 			err = PTR_ERR(skb);
-			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
+			if (err != -EINVAL && err != -EMSGSIZE)
+				goto out;
+
+			xsk_drop_pkt(xs, nb_descs);
+			err = 0;
+			continue;
 		}
 
 		err = __dev_direct_xmit(skb, xs->queue_id);
 		if  (err == NETDEV_TX_BUSY) {
 			/* Tell user-space to retry the send */
-			skb->destructor = sock_wfree;
-			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			/* Free skb without triggering the perf drop trace */
-			consume_skb(skb);
+			xsk_consume_skb(skb);
 			err = -EAGAIN;
 			goto out;
 		}
 
-		xskq_cons_release(xs->tx);
+		/* The skb destructor completes the descriptors */
+		reserved -= nb_descs;
+		max_batch -= nb_descs;
+		xskq_cons_release_n(xs->tx, nb_descs);
 		/* Ignore NET_XMIT_CN as packet might have been sent */
 		if (err == NET_XMIT_DROP) {
 			/* SKB completed but not sent */
@@ -587,6 +880,12 @@ static int __xsk_generic_xmit(struct sock *sk)
 	xs->tx->queue_empty_descs++;
 
 out:
+	if (reserved) {
+		spin_lock_irqsave(cq_lock, flags);
+		xskq_prod_cancel_n(cq, reserved);
+		spin_unlock_irqrestore(cq_lock, flags);
+	}
+
 	if (sent_frame)
 		if (xsk_tx_writeable(xs))
 			sk->sk_write_space(sk);
@@ -692,8 +991,14 @@ static int __xsk_recvmsg(struct socket *sock, struct msghdr *m, size_t len, int
 	if (sk_can_busy_loop(sk))
 		sk_busy_loop(sk, 1); /* only support non-blocking sockets */
 
-	if (xsk_no_wakeup(sk))
+	if (xsk_no_wakeup(sk)) {
+		if (xs->zc && !READ_ONCE(xs->pool->busy_poll_rx))
+			WRITE_ONCE(xs->pool->busy_poll_rx, true);
 		return 0;
+	}
+
+	if (unlikely(READ_ONCE(xs->pool->busy_poll_rx)))
+		WRITE_ONCE(xs->pool->busy_poll_rx, false);
 
 	if (xs->pool->cached_need_wakeup & XDP_WAKEUP_RX && xs->zc)
 		return xsk_wakeup(xs, XDP_WAKEUP_RX);
@@ -773,6 +1078,8 @@ static void xsk_unbind_dev(struct xdp_sock *xs)
 
 	/* Wait for driver to stop using the xdp socket. */
 	xp_del_xsk(xs->pool, xs);
+	if (xs->fq)
+		xp_del_fq(xs->pool, xs->fq);
 	synchronize_net();
 	dev_put(dev);
 }
@@ -975,10 +1282,12 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 				goto out_unlock;
 			}
 		} else {
-			/* Share the buffer pool with the other socket. */
-			if (xs->fq_tmp || xs->cq_tmp) {
-				/* Do not allow setting your own fq or cq. */
-				err = -EINVAL;
+			/* Share the buffer pool with the other socket. Own
+			 * fill and completion rings are allowed, but in zero-copy
+			 * mode the driver completes Tx to the pool's ring only.
+			 */
+			if (xs->cq_tmp && umem_xs->zc) {
+				err = -EOPNOTSUPP;
 				sockfd_put(sock);
 				goto out_unlock;
 			}
@@ -998,6 +1307,17 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 					goto out_unlock;
 				}
 			}
+
+			if (xs->fq_tmp) {
+				err = xp_add_fq(xs->pool, xs->fq_tmp);
+				if (err) {
+					xp_put_pool(xs->pool);
+					sockfd_put(sock);
+					goto out_unlock;
+				}
+			}
+			xs->fq = xs->fq_tmp;
+			xs->cq = xs->cq_tmp;
 		}
 
 		xdp_get_umem(umem_xs->umem);
@@ -1022,7 +1342,9 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 		}
 	}
 
-	/* FQ and CQ are now owned by the buffer pool and cleaned up with it. */
+	/* FQ and CQ are now owned by the buffer pool and cleaned up with it,
+	 * or by the socket itself if it shares the pool of another one.
+	 */
 	xs->fq_tmp = NULL;
 	xs->cq_tmp = NULL;
 
@@ -1054,6 +1376,14 @@ struct xdp_umem_reg_v1 {
 	__u32 headroom;
 };
 
+struct xdp_umem_reg_v2 {
+	__u64 addr; /* Start of packet data area */
+	__u64 len; /* Length of packet data area */
+	__u32 chunk_size;
+	__u32 headroom;
+	__u32 flags;
+};
+
 static int xsk_setsockopt(struct socket *sock, int level, int optname,
 			  sockptr_t optval, unsigned int optlen)
 {
@@ -1097,8 +1427,10 @@ static int xsk_setsockopt(struct socket *sock, int level, int optname,
 
 		if (optlen < sizeof(struct xdp_umem_reg_v1))
 			return -EINVAL;
-		else if (optlen < sizeof(mr))
+		else if (optlen < sizeof(struct xdp_umem_reg_v2))
 			mr_size = sizeof(struct xdp_umem_reg_v1);
+		else if (optlen < sizeof(mr))
+			mr_size = sizeof(struct xdp_umem_reg_v2);
 
 		if (copy_from_sockptr(&mr, optval, mr_size))
 			return -EFAULT;
@@ -1321,10 +1653,10 @@ static int xsk_mmap(struct file *file, struct socket *sock,
 		smp_rmb();
 		if (offset == XDP_UMEM_PGOFF_FILL_RING)
 			q = state == XSK_READY ? READ_ONCE(xs->fq_tmp) :
-						 READ_ONCE(xs->pool->fq);
+				xs->fq ?: READ_ONCE(xs->pool->fq);
 		else if (offset == XDP_UMEM_PGOFF_COMPLETION_RING)
 			q = state == XSK_READY ? READ_ONCE(xs->cq_tmp) :
-						 READ_ONCE(xs->pool->cq);
+				xs->cq ?: READ_ONCE(xs->pool->cq);
 	}
 
 	if (!q)
@@ -1403,6 +1735,10 @@ static void xsk_destruct(struct sock *sk)
 	if (!sock_flag(sk, SOCK_DEAD))
 		return;
 
+	/* Not before the last skb completed to cq */
+	xskq_destroy(xs->fq);
+	xskq_destroy(xs->cq);
+
 	if (!xp_put_pool(xs->pool))
 		xdp_put_umem(xs->umem, !xs->pool);
 }
@@ -1441,6 +1777,7 @@ static int xsk_create(struct net *net, struct socket *sock, int protocol,
 	xs->state = XSK_READY;
 	mutex_init(&xs->mutex);
 	spin_lock_init(&xs->rx_lock);
+	spin_lock_init(&xs->cq_lock);
 
 	INIT_LIST_HEAD(&xs->map_list);
 	spin_lock_init(&xs->map_list_lock);
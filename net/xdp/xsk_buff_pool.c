@@ -32,11 +32,83 @@ void xp_del_xsk(struct xsk_buff_pool *pool, struct xdp_sock *xs)
 	spin_unlock_irqrestore(&pool->xsk_tx_list_lock, flags);
 }
 
+/* A socket sharing the pool of another one may bring its own fill ring.
+ * Each of them has a single producer, so the application threads can refill
+ * their rings without synchronizing with each other. The driver consumes
+ * pool->fq first and cycles through the extra rings when it runs dry.
+ */
+int xp_add_fq(struct xsk_buff_pool *pool, struct xsk_queue *fq)
+{
+	struct xsk_fq_array *old, *new;
+	u32 nr;
+
+	mutex_lock(&pool->fqs_lock);
+	old = rcu_dereference_protected(pool->extra_fqs,
+					lockdep_is_held(&pool->fqs_lock));
+	nr = old ? old->nr : 0;
+
+	new = kmalloc(struct_size(new, fqs, nr + 1), GFP_KERNEL);
+	if (!new) {
+		mutex_unlock(&pool->fqs_lock);
+		return -ENOMEM;
+	}
+
+	if (old)
+		memcpy(new->fqs, old->fqs, nr * sizeof(*new->fqs));
+	new->fqs[nr] = fq;
+	new->nr = nr + 1;
+
+	rcu_assign_pointer(pool->extra_fqs, new);
+	mutex_unlock(&pool->fqs_lock);
+
+	if (old)
+		kfree_rcu(old, rcu);
+	return 0;
+}
+
+/* The caller has to wait for an RCU grace period before destroying @fq */
+void xp_del_fq(struct xsk_buff_pool *pool, struct xsk_queue *fq)
+{
+	struct xsk_fq_array *old, *new = NULL;
+	u32 i, j;
+
+	mutex_lock(&pool->fqs_lock);
+	old = rcu_dereference_protected(pool->extra_fqs,
+					lockdep_is_held(&pool->fqs_lock));
+	if (WARN_ON_ONCE(!old)) {
+		mutex_unlock(&pool->fqs_lock);
+		return;
+	}
+
+	if (old->nr > 1) {
+		new = kmalloc(struct_size(new, fqs, old->nr - 1), GFP_KERNEL);
+		if (!new) {
+			/* Remove it in place, the readers skip NULL entries */
+			for (i = 0; i < old->nr; i++)
+				if (old->fqs[i] == fq)
+					WRITE_ONCE(old->fqs[i], NULL);
+			mutex_unlock(&pool->fqs_lock);
+			return;
+		}
+
+		for (i = 0, j = 0; i < old->nr; i++)
+			if (old->fqs[i] != fq && old->fqs[i])
+				new->fqs[j++] = old->fqs[i];
+		new->nr = j;
+	}
+
+	rcu_assign_pointer(pool->extra_fqs, new);
+	mutex_unlock(&pool->fqs_lock);
+	kfree_rcu(old, rcu);
+}
+
 void xp_destroy(struct xsk_buff_pool *pool)
 {
 	if (!pool)
 		return;
 
+	kfree(rcu_dereference_protected(pool->extra_fqs, true));
+
 	kvfree(pool->tx_descs);
 	kvfree(pool->heads);
 	kvfree(pool);
@@ -83,12 +155,14 @@ struct xsk_buff_pool *xp_create_and_assign_umem(struct xdp_sock *xs,
 	pool->unaligned = unaligned;
 	pool->frame_len = umem->chunk_size - umem->headroom -
 		XDP_PACKET_HEADROOM;
+	pool->tx_metadata_len = umem->tx_metadata_len;
 	pool->umem = umem;
 	pool->addrs = umem->addrs;
 	INIT_LIST_HEAD(&pool->free_list);
 	INIT_LIST_HEAD(&pool->xsk_tx_list);
 	spin_lock_init(&pool->xsk_tx_list_lock);
 	spin_lock_init(&pool->cq_lock);
+	mutex_init(&pool->fqs_lock);
 	refcount_set(&pool->users, 1);
 
 	pool->fq = xs->fq_tmp;
@@ -175,6 +249,8 @@ int xp_assign_dev(struct xsk_buff_pool *pool,
 	 * feature. They will always have to call sendto() or poll().
 	 */
 	pool->cached_need_wakeup = XDP_WAKEUP_TX;
+	/* Only the copy mode builds multi-buffer packets for now. */
+	pool->tx_sg = true;
 
 	dev_hold(netdev);
 
@@ -201,6 +277,9 @@ int xp_assign_dev(struct xsk_buff_pool *pool,
 		goto err_unreg_xsk;
 	}
 	pool->umem->zc = true;
+	pool->tx_sg = false;
+	if (!(netdev->xdp_features & NETDEV_XDP_ACT_XSK_TX_OFFLOAD))
+		pool->tx_metadata_len = 0;
 	return 0;
 
 err_unreg_xsk:
@@ -476,26 +555,22 @@ static bool xp_check_aligned(struct xsk_buff_pool *pool, u64 *addr)
 	return *addr < pool->addrs_cnt;
 }
 
-static struct xdp_buff_xsk *__xp_alloc(struct xsk_buff_pool *pool)
+static struct xdp_buff_xsk *__xp_alloc(struct xsk_buff_pool *pool,
+				       struct xsk_queue *fq)
 {
 	struct xdp_buff_xsk *xskb;
 	u64 addr;
 	bool ok;
 
-	if (pool->free_heads_cnt == 0)
-		return NULL;
-
 	for (;;) {
-		if (!xskq_cons_peek_addr_unchecked(pool->fq, &addr)) {
-			pool->fq->queue_empty_descs++;
+		if (!xskq_cons_peek_addr_unchecked(fq, &addr))
 			return NULL;
-		}
 
 		ok = pool->unaligned ? xp_check_unaligned(pool, &addr) :
 		     xp_check_aligned(pool, &addr);
 		if (!ok) {
-			pool->fq->invalid_descs++;
-			xskq_cons_release(pool->fq);
+			fq->invalid_descs++;
+			xskq_cons_release(fq);
 			continue;
 		}
 		break;
@@ -510,7 +585,55 @@ static struct xdp_buff_xsk *__xp_alloc(struct xsk_buff_pool *pool)
 		xskb = &pool->heads[xp_aligned_extract_idx(pool, addr)];
 	}
 
-	xskq_cons_release(pool->fq);
+	xskq_cons_release(fq);
+	return xskb;
+}
+
+/* Next extra fill ring with at least one entry. Called under RCU, with the
+ * same exclusion as the other allocation functions of the pool.
+ */
+static struct xsk_queue *xp_next_extra_fq(struct xsk_buff_pool *pool,
+					  struct xsk_fq_array *fqs)
+{
+	struct xsk_queue *fq;
+	u32 i;
+
+	for (i = 0; i < fqs->nr; i++) {
+		fq = READ_ONCE(fqs->fqs[pool->extra_fq_idx++ % fqs->nr]);
+		if (fq && xskq_cons_nb_entries(fq, 1))
+			return fq;
+	}
+
+	return NULL;
+}
+
+static struct xdp_buff_xsk *xp_alloc_head(struct xsk_buff_pool *pool)
+{
+	struct xdp_buff_xsk *xskb;
+	struct xsk_fq_array *fqs;
+	struct xsk_queue *fq;
+
+	if (pool->free_heads_cnt == 0)
+		return NULL;
+
+	xskb = __xp_alloc(pool, pool->fq);
+	if (likely(xskb) || !rcu_access_pointer(pool->extra_fqs))
+		goto out;
+
+	rcu_read_lock();
+	fqs = rcu_dereference(pool->extra_fqs);
+	while (fqs && (fq = xp_next_extra_fq(pool, fqs))) {
+		xskb = __xp_alloc(pool, fq);
+		/* The ring is left right away, publish the consumed entries */
+		__xskq_cons_release(fq);
+		if (xskb)
+			break;
+	}
+	rcu_read_unlock();
+
+out:
+	if (!xskb)
+		pool->fq->queue_empty_descs++;
 	return xskb;
 }
 
@@ -519,7 +642,7 @@ struct xdp_buff *xp_alloc(struct xsk_buff_pool *pool)
 	struct xdp_buff_xsk *xskb;
 
 	if (!pool->free_list_cnt) {
-		xskb = __xp_alloc(pool);
+		xskb = xp_alloc_head(pool);
 		if (!xskb)
 			return NULL;
 	} else {
@@ -541,15 +664,16 @@ struct xdp_buff *xp_alloc(struct xsk_buff_pool *pool)
 }
 EXPORT_SYMBOL(xp_alloc);
 
-static u32 xp_alloc_new_from_fq(struct xsk_buff_pool *pool, struct xdp_buff **xdp, u32 max)
+static u32 xp_alloc_new_from_fq(struct xsk_buff_pool *pool, struct xsk_queue *fq,
+				struct xdp_buff **xdp, u32 max)
 {
 	u32 i, cached_cons, nb_entries;
 
 	if (max > pool->free_heads_cnt)
 		max = pool->free_heads_cnt;
-	max = xskq_cons_nb_entries(pool->fq, max);
+	max = xskq_cons_nb_entries(fq, max);
 
-	cached_cons = pool->fq->cached_cons;
+	cached_cons = fq->cached_cons;
 	nb_entries = max;
 	i = max;
 	while (i--) {
@@ -557,12 +681,12 @@ static u32 xp_alloc_new_from_fq(struct xsk_buff_pool *pool, struct xdp_buff **xd
 		u64 addr;
 		bool ok;
 
-		__xskq_cons_read_addr_unchecked(pool->fq, cached_cons++, &addr);
+		__xskq_cons_read_addr_unchecked(fq, cached_cons++, &addr);
 
 		ok = pool->unaligned ? xp_check_unaligned(pool, &addr) :
 			xp_check_aligned(pool, &addr);
 		if (unlikely(!ok)) {
-			pool->fq->invalid_descs++;
+			fq->invalid_descs++;
 			nb_entries--;
 			continue;
 		}
@@ -580,7 +704,29 @@ static u32 xp_alloc_new_from_fq(struct xsk_buff_pool *pool, struct xdp_buff **xd
 		xdp++;
 	}
 
-	xskq_cons_release_n(pool->fq, max);
+	xskq_cons_release_n(fq, max);
+	return nb_entries;
+}
+
+static u32 xp_alloc_new_from_extra_fqs(struct xsk_buff_pool *pool,
+				       struct xdp_buff **xdp, u32 max)
+{
+	struct xsk_fq_array *fqs;
+	u32 nb_entries = 0, n;
+	struct xsk_queue *fq;
+
+	rcu_read_lock();
+	fqs = rcu_dereference(pool->extra_fqs);
+	while (fqs && nb_entries < max && pool->free_heads_cnt &&
+	       (fq = xp_next_extra_fq(pool, fqs))) {
+		n = xp_alloc_new_from_fq(pool, fq, xdp, max - nb_entries);
+		/* The ring is left right away, publish the consumed entries */
+		__xskq_cons_release(fq);
+		nb_entries += n;
+		xdp += n;
+	}
+	rcu_read_unlock();
+
 	return nb_entries;
 }
 
@@ -627,7 +773,10 @@ u32 xp_alloc_batch(struct xsk_buff_pool *pool, struct xdp_buff **xdp, u32 max)
 		xdp += nb_entries1;
 	}
 
-	nb_entries2 = xp_alloc_new_from_fq(pool, xdp, max);
+	nb_entries2 = xp_alloc_new_from_fq(pool, pool->fq, xdp, max);
+	if (unlikely(nb_entries2 < max) && rcu_access_pointer(pool->extra_fqs))
+		nb_entries2 += xp_alloc_new_from_extra_fqs(pool, xdp + nb_entries2,
+							   max - nb_entries2);
 	if (!nb_entries2)
 		pool->fq->queue_empty_descs++;
 
@@ -637,9 +786,30 @@ EXPORT_SYMBOL(xp_alloc_batch);
 
 bool xp_can_alloc(struct xsk_buff_pool *pool, u32 count)
 {
+	struct xsk_fq_array *fqs;
+	struct xsk_queue *fq;
+	u32 i;
+
 	if (pool->free_list_cnt >= count)
 		return true;
-	return xskq_cons_has_entries(pool->fq, count - pool->free_list_cnt);
+
+	count -= pool->free_list_cnt;
+	if (xskq_cons_has_entries(pool->fq, count))
+		return true;
+	if (!rcu_access_pointer(pool->extra_fqs))
+		return false;
+
+	count -= xskq_cons_nb_entries(pool->fq, count);
+	rcu_read_lock();
+	fqs = rcu_dereference(pool->extra_fqs);
+	for (i = 0; fqs && i < fqs->nr && count; i++) {
+		fq = READ_ONCE(fqs->fqs[i]);
+		if (fq)
+			count -= xskq_cons_nb_entries(fq, count);
+	}
+	rcu_read_unlock();
+
+	return !count;
 }
 EXPORT_SYMBOL(xp_can_alloc);
 
@@ -49,6 +49,7 @@ static int xsk_diag_put_umem(const struct xdp_sock *xs, struct sk_buff *nlskb)
 	struct xsk_buff_pool *pool = xs->pool;
 	struct xdp_umem *umem = xs->umem;
 	struct xdp_diag_umem du = {};
+	struct xsk_queue *fq, *cq;
 	int err;
 
 	if (!umem)
@@ -67,12 +68,14 @@ static int xsk_diag_put_umem(const struct xdp_sock *xs, struct sk_buff *nlskb)
 	du.refs = refcount_read(&umem->users);
 
 	err = nla_put(nlskb, XDP_DIAG_UMEM, sizeof(du), &du);
-	if (!err && pool && pool->fq)
-		err = xsk_diag_put_ring(pool->fq,
-					XDP_DIAG_UMEM_FILL_RING, nlskb);
-	if (!err && pool && pool->cq)
-		err = xsk_diag_put_ring(pool->cq,
-					XDP_DIAG_UMEM_COMPLETION_RING, nlskb);
+	/* The socket's own rings if it brought them to a shared pool */
+	fq = xs->fq ?: (pool ? pool->fq : NULL);
+	cq = xs->cq ?: (pool ? pool->cq : NULL);
+	if (!err && fq)
+		err = xsk_diag_put_ring(fq, XDP_DIAG_UMEM_FILL_RING, nlskb);
+	if (!err && cq)
+		err = xsk_diag_put_ring(cq, XDP_DIAG_UMEM_COMPLETION_RING,
+					nlskb);
 	return err;
 }
 
@@ -130,6 +130,26 @@ static inline bool xskq_cons_read_addr_unchecked(struct xsk_queue *q, u64 *addr)
 	return false;
 }
 
+/* @offset is where the packet data starts, within the chunk in aligned
+ * mode and within the umem in unaligned mode.
+ */
+static inline bool xp_validate_desc_options(struct xsk_buff_pool *pool,
+					    struct xdp_desc *desc, u64 offset)
+{
+	if (desc->options & ~(XDP_PKT_CONTD | XDP_TX_METADATA))
+		return false;
+
+	if ((desc->options & XDP_PKT_CONTD) && !pool->tx_sg)
+		return false;
+
+	/* The metadata sits in front of the data, in the same chunk */
+	if ((desc->options & XDP_TX_METADATA) &&
+	    (!pool->tx_metadata_len || offset < pool->tx_metadata_len))
+		return false;
+
+	return true;
+}
+
 static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 					    struct xdp_desc *desc)
 {
@@ -141,9 +161,7 @@ static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 	if (desc->addr >= pool->addrs_cnt)
 		return false;
 
-	if (desc->options)
-		return false;
-	return true;
+	return xp_validate_desc_options(pool, desc, offset);
 }
 
 static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
@@ -158,9 +176,7 @@ static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
 	    xp_desc_crosses_non_contig_pg(pool, addr, desc->len))
 		return false;
 
-	if (desc->options)
-		return false;
-	return true;
+	return xp_validate_desc_options(pool, desc, addr);
 }
 
 static inline bool xp_validate_desc(struct xsk_buff_pool *pool,
@@ -283,6 +299,42 @@ static inline bool xskq_cons_peek_desc(struct xsk_queue *q,
 	return xskq_cons_read_desc(q, desc, pool);
 }
 
+/* Return the number of descriptors of the next packet, or 0 if user space
+ * didn't produce all of them yet. The descriptors are not validated, the
+ * caller has to do that while reading them with xskq_cons_read_desc_at().
+ */
+static inline u32 xskq_cons_nb_pkt_descs(struct xsk_queue *q)
+{
+	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
+	u32 cons = q->cached_cons, prod;
+
+	if (q->cached_prod == q->cached_cons)
+		xskq_cons_get_entries(q);
+
+	do {
+		while (cons != q->cached_prod) {
+			u32 options = READ_ONCE(ring->desc[cons++ & q->ring_mask].options);
+
+			if (!(options & XDP_PKT_CONTD))
+				return cons - q->cached_cons;
+		}
+
+		/* The tail of the packet may have been produced since */
+		prod = q->cached_prod;
+		__xskq_cons_peek(q);
+	} while (q->cached_prod != prod);
+
+	return 0;
+}
+
+static inline void xskq_cons_read_desc_at(struct xsk_queue *q, u32 i,
+					  struct xdp_desc *desc)
+{
+	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
+
+	*desc = ring->desc[(q->cached_cons + i) & q->ring_mask];
+}
+
 /* To improve performance in the xskq_cons_release functions, only update local state here.
  * Reflect this to global state when we get new entries from the ring in
  * xskq_cons_get_entries() and whenever Rx or Tx processing are completed in the NAPI loop.
@@ -324,6 +376,21 @@ static inline void xskq_prod_cancel(struct xsk_queue *q)
 	q->cached_prod--;
 }
 
+static inline void xskq_prod_cancel_n(struct xsk_queue *q, u32 cnt)
+{
+	q->cached_prod -= cnt;
+}
+
+/* Reserve up to @max entries, returns how many could be reserved. */
+static inline u32 xskq_prod_reserve_n(struct xsk_queue *q, u32 max)
+{
+	u32 nb_entries = xskq_prod_nb_free(q, max);
+
+	/* A, matches D */
+	q->cached_prod += nb_entries;
+	return nb_entries;
+}
+
 static inline int xskq_prod_reserve(struct xsk_queue *q)
 {
 	if (xskq_prod_is_full(q))
@@ -35,6 +35,7 @@ static const char * const netdev_xdp_act_strmap[] = {
 	[4] = "hw-offload",
 	[5] = "rx-sg",
 	[6] = "ndo-xmit-sg",
+	[7] = "xsk-tx-offload",
 };
 
 const char *netdev_xdp_act_str(enum netdev_xdp_act value)
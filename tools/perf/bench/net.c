@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * net.c
+ *
+ * net: Benchmark for stream socket throughput between two threads
+ */
+#include <subcmd/parse-options.h>
+#include "bench.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/time64.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY	60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY	0x4000000
+#endif
+
+#define LOOPS_DEFAULT 100000
+static int		loops = LOOPS_DEFAULT;
+static unsigned int	msg_size = 64 * 1024;
+static bool		zerocopy;
+
+static const struct option tcp_options[] = {
+	OPT_INTEGER('l', "loop",	&loops,		"Specify number of messages to send"),
+	OPT_UINTEGER('s', "size",	&msg_size,	"Specify the size of a message in bytes"),
+	OPT_BOOLEAN('z', "zerocopy",	&zerocopy,	"Send with MSG_ZEROCOPY"),
+	OPT_END()
+};
+
+/* AF_UNIX has no zerocopy transmit */
+static const struct option unix_options[] = {
+	OPT_INTEGER('l', "loop",	&loops,		"Specify number of messages to send"),
+	OPT_UINTEGER('s', "size",	&msg_size,	"Specify the size of a message in bytes"),
+	OPT_END()
+};
+
+static const char * const bench_net_unix_usage[] = {
+	"perf bench net unix <options>",
+	NULL
+};
+
+static const char * const bench_net_tcp_usage[] = {
+	"perf bench net tcp <options>",
+	NULL
+};
+
+struct receiver {
+	int			fd;
+	unsigned long long	total;
+	pthread_t		pthread;
+};
+
+static void *receiver_thread(void *arg)
+{
+	struct receiver *rx = arg;
+	unsigned long long left = rx->total;
+	char *buf = malloc(msg_size);
+	ssize_t ret;
+
+	if (!buf)
+		err(EXIT_FAILURE, "malloc");
+
+	while (left) {
+		ret = read(rx->fd, buf, msg_size);
+		if (ret <= 0)
+			err(EXIT_FAILURE, "read");
+		left -= ret;
+	}
+
+	free(buf);
+	return NULL;
+}
+
+/* Reap the zerocopy completions so the socket doesn't run out of optmem */
+static void drain_errqueue(int fd)
+{
+	char control[128];
+	struct msghdr msg;
+
+	do {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+	} while (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0);
+}
+
+static void send_all(int fd, const char *buf)
+{
+	int flags = zerocopy ? MSG_ZEROCOPY : 0;
+	size_t done = 0;
+	ssize_t ret;
+
+	while (done < msg_size) {
+		ret = send(fd, buf + done, msg_size - done, flags);
+		if (ret < 0) {
+			if (errno == ENOBUFS && zerocopy) {
+				drain_errqueue(fd);
+				continue;
+			}
+			err(EXIT_FAILURE, "send");
+		}
+		done += ret;
+	}
+}
+
+static int run_stream(int tx_fd, int rx_fd, const char *name)
+{
+	struct timeval start, stop, diff;
+	unsigned long long result_usec;
+	struct receiver rx;
+	char *buf;
+	int i;
+
+	if (loops <= 0 || !msg_size) {
+		fprintf(stderr, "Invalid number of loops or message size\n");
+		return -1;
+	}
+
+	buf = malloc(msg_size);
+	if (!buf)
+		err(EXIT_FAILURE, "malloc");
+	memset(buf, 0x5a, msg_size);
+
+	rx.fd = rx_fd;
+	rx.total = (unsigned long long)loops * msg_size;
+
+	gettimeofday(&start, NULL);
+
+	if (pthread_create(&rx.pthread, NULL, receiver_thread, &rx))
+		err(EXIT_FAILURE, "pthread_create");
+
+	for (i = 0; i < loops; i++) {
+		send_all(tx_fd, buf);
+		if (zerocopy && !(i % 64))
+			drain_errqueue(tx_fd);
+	}
+
+	if (pthread_join(rx.pthread, NULL))
+		err(EXIT_FAILURE, "pthread_join");
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	free(buf);
+
+	result_usec = diff.tv_sec * USEC_PER_SEC;
+	result_usec += diff.tv_usec;
+	if (!result_usec)
+		result_usec = 1;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Sent %d messages of %u bytes over %s%s\n\n",
+		       loops, msg_size, name, zerocopy ? " with MSG_ZEROCOPY" : "");
+
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       (unsigned long) diff.tv_sec,
+		       (unsigned long) (diff.tv_usec / USEC_PER_MSEC));
+
+		printf(" %14lf usecs/op\n",
+		       (double)result_usec / (double)loops);
+		printf(" %14d ops/sec\n",
+		       (int)((double)loops /
+			     ((double)result_usec / (double)USEC_PER_SEC)));
+		printf(" %14lf MB/sec\n",
+		       (double)rx.total / (double)result_usec);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lu.%03lu\n",
+		       (unsigned long) diff.tv_sec,
+		       (unsigned long) (diff.tv_usec / USEC_PER_MSEC));
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
+
+int bench_net_unix(int argc, const char **argv)
+{
+	int fds[2];
+	int ret;
+
+	argc = parse_options(argc, argv, unix_options, bench_net_unix_usage, 0);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+		err(EXIT_FAILURE, "socketpair");
+
+	ret = run_stream(fds[0], fds[1], "an AF_UNIX stream socket");
+
+	close(fds[0]);
+	close(fds[1]);
+	return ret;
+}
+
+int bench_net_tcp(int argc, const char **argv)
+{
+	struct sockaddr_in addr = {
+		.sin_family	 = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(addr);
+	int listen_fd, tx_fd, rx_fd;
+	int one = 1;
+	int ret;
+
+	argc = parse_options(argc, argv, tcp_options, bench_net_tcp_usage, 0);
+
+	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_fd < 0)
+		err(EXIT_FAILURE, "socket");
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(listen_fd, 1) ||
+	    getsockname(listen_fd, (struct sockaddr *)&addr, &len))
+		err(EXIT_FAILURE, "listen");
+
+	tx_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (tx_fd < 0)
+		err(EXIT_FAILURE, "socket");
+	if (zerocopy &&
+	    setsockopt(tx_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)))
+		err(EXIT_FAILURE, "setsockopt(SO_ZEROCOPY)");
+	if (connect(tx_fd, (struct sockaddr *)&addr, sizeof(addr)))
+		err(EXIT_FAILURE, "connect");
+
+	rx_fd = accept(listen_fd, NULL, NULL);
+	if (rx_fd < 0)
+		err(EXIT_FAILURE, "accept");
+	close(listen_fd);
+
+	setsockopt(tx_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	ret = run_stream(tx_fd, rx_fd, "a loopback TCP connection");
+
+	close(tx_fd);
+	close(rx_fd);
+	return ret;
+}
@@ -16,6 +16,7 @@
  *  numa  ... NUMA scheduling and MM performance
  *  futex ... Futex performance
  *  epoll ... Event poll performance
+ *  net   ... Stream socket throughput
  */
 #include <subcmd/parse-options.h>
 #include "builtin.h"
@@ -104,6 +105,13 @@ static struct bench breakpoint_benchmarks[] = {
 	{ NULL,	NULL, NULL },
 };
 
+static struct bench net_benchmarks[] = {
+	{ "unix",	"Benchmark AF_UNIX stream socket throughput",	bench_net_unix		},
+	{ "tcp",	"Benchmark loopback TCP throughput",		bench_net_tcp		},
+	{ "all",	"Run all net benchmarks",			NULL			},
+	{ NULL,		NULL,						NULL			}
+};
+
 struct collection {
 	const char	*name;
 	const char	*summary;
@@ -123,6 +131,7 @@ static struct collection collections[] = {
 #endif
 	{ "internals",	"Perf-internals benchmarks",			internals_benchmarks	},
 	{ "breakpoint",	"Breakpoint benchmarks",			breakpoint_benchmarks	},
+	{ "net",	"Socket throughput benchmarks",			net_benchmarks		},
 	{ "all",	"All benchmarks",				NULL			},
 	{ NULL,		NULL,						NULL			}
 };
@@ -562,13 +562,35 @@ void dso__delete_symbol(struct dso *dso, struct symbol *sym)
 	dso__reset_find_symbol_cache(dso);
 }
 
+static bool symbol__contains(const struct symbol *sym, u64 addr)
+{
+	/* same test as in symbols__find() */
+	return addr >= sym->start &&
+	       (addr < sym->end || (addr == sym->end && addr == sym->start));
+}
+
 struct symbol *dso__find_symbol(struct dso *dso, u64 addr)
 {
-	if (dso->last_find_result.addr != addr || dso->last_find_result.symbol == NULL) {
-		dso->last_find_result.addr   = addr;
-		dso->last_find_result.symbol = symbols__find(&dso->symbols, addr);
+	struct symbol *sym = dso->last_find_result.symbol;
+
+	/*
+	 * Consecutive samples usually hit the same function, but rarely the
+	 * same address, so reuse the last result if it covers @addr.  Unless
+	 * a symbol nested in it or overlapping it starts before @addr, then
+	 * leave the pick to symbols__find().
+	 */
+	if (sym && symbol__contains(sym, addr)) {
+		struct symbol *next = symbols__next(sym);
+
+		if (!next || next->start > addr) {
+			dso->last_find_result.addr = addr;
+			return sym;
+		}
 	}
 
+	dso->last_find_result.addr   = addr;
+	dso->last_find_result.symbol = symbols__find(&dso->symbols, addr);
+
 	return dso->last_find_result.symbol;
 }
 
@@ -6,7 +6,10 @@
 #include <linux/radix-tree.h>
 #include <linux/slab.h>
 #include <linux/errno.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 #include "test.h"
 
 #define NSEC_PER_SEC	1000000000L
@@ -134,6 +137,179 @@ static void benchmark_size(unsigned long size, unsigned long step)
 	rcu_barrier();
 }
 
+#ifdef BENCHMARK
+/*
+ * Multi-threaded lookups, the way the page cache uses the xarray: readers
+ * walk it under RCU while an optional writer keeps evicting and refilling
+ * entries, which frees and reallocates nodes under the readers.
+ */
+enum mt_pattern {
+	MT_SEQUENTIAL,
+	MT_RANDOM,
+	MT_BATCH,
+};
+
+static const char *mt_pattern_name[] = {
+	[MT_SEQUENTIAL]	= "sequential",
+	[MT_RANDOM]	= "random",
+	[MT_BATCH]	= "batch",
+};
+
+#define MT_BATCH_SIZE	16	/* like filemap_get_read_batch() */
+
+struct mt_thread {
+	struct xarray *xa;
+	unsigned long size;
+	enum mt_pattern pattern;
+	unsigned long ops;
+	pthread_t thread;
+};
+
+static volatile bool mt_stop;
+
+static void *mt_reader(void *arg)
+{
+	struct mt_thread *t = arg;
+	volatile unsigned long sink = 0;
+	unsigned long index = 0, seed = (unsigned long)t | 1;
+	unsigned long ops = 0;
+	void *entry;
+
+	rcu_register_thread();
+
+	while (!mt_stop) {
+		if (t->pattern == MT_SEQUENTIAL) {
+			index = (index + 1) % t->size;
+		} else {
+			/* xorshift, cheap enough not to hide the lookup */
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+			index = seed % t->size;
+		}
+
+		rcu_read_lock();
+		if (t->pattern == MT_BATCH) {
+			XA_STATE(xas, t->xa, index);
+
+			xas_for_each(&xas, entry, index + MT_BATCH_SIZE - 1) {
+				if (xas_retry(&xas, entry))
+					continue;
+				sink ^= (unsigned long)entry;
+				ops++;
+			}
+		} else {
+			sink ^= (unsigned long)xa_load(t->xa, index);
+			ops++;
+		}
+		rcu_read_unlock();
+	}
+
+	rcu_unregister_thread();
+	t->ops = ops;
+	return NULL;
+}
+
+static void *mt_writer(void *arg)
+{
+	struct mt_thread *t = arg;
+	unsigned long index = 0, ops = 0;
+
+	rcu_register_thread();
+
+	/* Evict a run of entries and refill it, dropping whole leaf nodes */
+	while (!mt_stop) {
+		unsigned long i;
+
+		for (i = index; i < index + XA_CHUNK_SIZE; i++)
+			xa_erase(t->xa, i);
+		for (i = index; i < index + XA_CHUNK_SIZE; i++)
+			xa_store(t->xa, i, xa_mk_value(i), GFP_KERNEL);
+
+		ops += 2 * XA_CHUNK_SIZE;
+		index = (index + XA_CHUNK_SIZE) % t->size;
+	}
+
+	rcu_unregister_thread();
+	t->ops = ops;
+	return NULL;
+}
+
+static void benchmark_mt(struct xarray *xa, unsigned long size,
+			 enum mt_pattern pattern, int nr_readers, bool writer)
+{
+	struct mt_thread *threads;
+	struct timespec start, finish;
+	unsigned long reads = 0;
+	long long nsec;
+	int i, nr = nr_readers + writer;
+
+	threads = calloc(nr, sizeof(*threads));
+	assert(threads);
+
+	mt_stop = false;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nr; i++) {
+		threads[i].xa = xa;
+		threads[i].size = size;
+		threads[i].pattern = pattern;
+		if (pthread_create(&threads[i].thread, NULL,
+				   i < nr_readers ? mt_reader : mt_writer,
+				   &threads[i])) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+
+	sleep(1);
+	mt_stop = true;
+
+	for (i = 0; i < nr; i++) {
+		if (pthread_join(threads[i].thread, NULL)) {
+			perror("pthread_join");
+			exit(1);
+		}
+		if (i < nr_readers)
+			reads += threads[i].ops;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+
+	nsec = (finish.tv_sec - start.tv_sec) * NSEC_PER_SEC +
+	       (finish.tv_nsec - start.tv_nsec);
+
+	printv(2, "Size: %8ld, %-10s readers: %3d, writer: %d, lookups: %12lld/s",
+		size, mt_pattern_name[pattern], nr_readers, writer,
+		(long long)reads * NSEC_PER_SEC / nsec);
+	if (writer)
+		printv(2, ", stores: %10lld/s",
+			(long long)threads[nr_readers].ops * NSEC_PER_SEC / nsec);
+	printv(2, "\n");
+
+	free(threads);
+}
+
+static void benchmark_mt_size(unsigned long size)
+{
+	DEFINE_XARRAY(xa);
+	long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long index;
+	int pattern, readers;
+
+	for (index = 0; index < size; index++)
+		xa_store(&xa, index, xa_mk_value(index), GFP_KERNEL);
+
+	for (pattern = MT_SEQUENTIAL; pattern <= MT_BATCH; pattern++) {
+		for (readers = 1; readers <= nr_cpus; readers *= 2) {
+			benchmark_mt(&xa, size, pattern, readers, false);
+			benchmark_mt(&xa, size, pattern, readers, true);
+		}
+	}
+
+	xa_destroy(&xa);
+	rcu_barrier();
+}
+#endif
+
 void benchmark(void)
 {
 	unsigned long size[] = {1 << 10, 1 << 20, 0};
@@ -147,4 +323,10 @@ void benchmark(void)
 	for (c = 0; size[c]; c++)
 		for (s = 0; step[s]; s++)
 			benchmark_size(size[c], step[s]);
+
+#ifdef BENCHMARK
+	/* a second per configuration, too slow for the regular runs */
+	for (c = 0; size[c]; c++)
+		benchmark_mt_size(size[c]);
+#endif
 }
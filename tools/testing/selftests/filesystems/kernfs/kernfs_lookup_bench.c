@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Compare the rate of path lookups and opens in a sysfs directory done by
+ * one thread with the rate of as many threads as there are CPUs.  Lookups
+ * of names which don't exist walk negative kernfs dentries, the others
+ * revalidate positive ones and go through the kernfs open file handling,
+ * both of which contended on kernfs locks with many readers.
+ *
+ * Usage: kernfs_lookup_bench [-d dir] [-f file] [-s seconds] [-t threads]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../kselftest.h"
+
+#define MAX_THREADS	256
+
+enum bench_op {
+	OP_NEGATIVE,
+	OP_POSITIVE,
+	OP_OPEN,
+};
+
+static const char * const op_names[] = {
+	[OP_NEGATIVE]	= "negative lookup",
+	[OP_POSITIVE]	= "positive lookup",
+	[OP_OPEN]	= "open/close",
+};
+
+struct bench_thread {
+	pthread_t thread;
+	enum bench_op op;
+	unsigned long ops;
+	int err;
+} __attribute__((aligned(64)));
+
+static const char *dir = "/sys/kernel";
+static const char *file = "uevent_seqnum";
+static char negative_path[PATH_MAX];
+static char positive_path[PATH_MAX];
+static volatile int running;
+
+static void *bench_fn(void *arg)
+{
+	struct bench_thread *t = arg;
+	struct stat st;
+	int fd;
+
+	while (!running)
+		;
+
+	while (running == 1) {
+		switch (t->op) {
+		case OP_NEGATIVE:
+			if (!stat(negative_path, &st))
+				t->err = EEXIST;
+			else if (errno != ENOENT)
+				t->err = errno;
+			break;
+		case OP_POSITIVE:
+			if (stat(positive_path, &st))
+				t->err = errno;
+			break;
+		case OP_OPEN:
+			fd = open(positive_path, O_RDONLY);
+			if (fd < 0)
+				t->err = errno;
+			else
+				close(fd);
+			break;
+		}
+		if (t->err)
+			break;
+		t->ops++;
+	}
+
+	return NULL;
+}
+
+/* Returns the operations per second of @nr_threads threads, 0 on error */
+static double run_bench(enum bench_op op, int nr_threads, int seconds)
+{
+	static struct bench_thread threads[MAX_THREADS];
+	unsigned long ops = 0;
+	struct timespec start, end;
+	double elapsed;
+	int i, err = 0;
+
+	running = 0;
+	for (i = 0; i < nr_threads; i++) {
+		memset(&threads[i], 0, sizeof(threads[i]));
+		threads[i].op = op;
+		if (pthread_create(&threads[i].thread, NULL, bench_fn,
+				   &threads[i]))
+			ksft_exit_fail_msg("pthread_create: %s\n",
+					   strerror(errno));
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	running = 1;
+	sleep(seconds);
+	running = 2;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(threads[i].thread, NULL);
+		ops += threads[i].ops;
+		if (threads[i].err)
+			err = threads[i].err;
+	}
+
+	if (err) {
+		ksft_print_msg("%s: %s\n", op_names[op], strerror(err));
+		return 0;
+	}
+
+	elapsed = end.tv_sec - start.tv_sec +
+		  (end.tv_nsec - start.tv_nsec) / 1e9;
+	return ops / elapsed;
+}
+
+int main(int argc, char **argv)
+{
+	int nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int seconds = 1;
+	enum bench_op op;
+	struct stat st;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:f:s:t:")) != -1) {
+		switch (opt) {
+		case 'd':
+			dir = optarg;
+			break;
+		case 'f':
+			file = optarg;
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-d dir] [-f file] [-s seconds] [-t threads]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+	if (nr_threads < 1)
+		nr_threads = 1;
+	if (nr_threads > MAX_THREADS)
+		nr_threads = MAX_THREADS;
+	if (seconds < 1)
+		seconds = 1;
+
+	ksft_print_header();
+
+	snprintf(negative_path, sizeof(negative_path),
+		 "%s/kernfs_lookup_bench_%d", dir, getpid());
+	snprintf(positive_path, sizeof(positive_path), "%s/%s", dir, file);
+	if (stat(positive_path, &st))
+		ksft_exit_skip("%s: %s\n", positive_path, strerror(errno));
+
+	ksft_set_plan(OP_OPEN + 1);
+	ksft_print_msg("%d threads, %d seconds per run, in %s\n",
+		       nr_threads, seconds, dir);
+
+	for (op = OP_NEGATIVE; op <= OP_OPEN; op++) {
+		double single, multi;
+
+		single = run_bench(op, 1, seconds);
+		multi = single ? run_bench(op, nr_threads, seconds) : 0;
+		if (!multi) {
+			ksft_test_result_fail("%s\n", op_names[op]);
+			continue;
+		}
+
+		ksft_print_msg("%s: 1 thread %.0f ops/s, %d threads %.0f ops/s, scaling %.2f\n",
+			       op_names[op], single, nr_threads, multi,
+			       multi / single);
+		ksft_test_result_pass("%s\n", op_names[op]);
+	}
+
+	ksft_finished();
+}
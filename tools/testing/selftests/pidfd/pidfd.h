@@ -12,6 +12,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <syscall.h>
+#include <linux/types.h>
+#include <sys/ioctl.h>
 #include <sys/mount.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -50,6 +52,52 @@
 #define PIDFD_NONBLOCK O_NONBLOCK
 #endif
 
+#ifndef PIDFD_GET_INFO
+#define PIDFD_INFO_PID		(1ULL << 0)
+#define PIDFD_INFO_CREDS	(1ULL << 1)
+#define PIDFD_INFO_CGROUPID	(1ULL << 2)
+#define PIDFD_INFO_STAT		(1ULL << 3)
+#define PIDFD_INFO_MEM		(1ULL << 4)
+#define PIDFD_INFO_IO		(1ULL << 5)
+
+#define PIDFD_INFO_SIZE_VER0	184
+
+struct pidfd_info {
+	__u64 mask;
+	__u64 cgroupid;
+	__u32 pid;
+	__u32 tgid;
+	__u32 ppid;
+	__u32 ruid;
+	__u32 rgid;
+	__u32 euid;
+	__u32 egid;
+	__u32 suid;
+	__u32 sgid;
+	__u32 fsuid;
+	__u32 fsgid;
+	__u32 state;
+	__u32 nr_threads;
+	__u32 __spare0;
+	__u64 utime;
+	__u64 stime;
+	__u64 min_flt;
+	__u64 maj_flt;
+	__u64 start_time;
+	__u64 vsize;
+	__u64 rss;
+	__u64 rchar;
+	__u64 wchar;
+	__u64 syscr;
+	__u64 syscw;
+	__u64 read_bytes;
+	__u64 write_bytes;
+	__u64 cancelled_write_bytes;
+};
+
+#define PIDFD_GET_INFO		_IOWR(0xFF, 11, struct pidfd_info)
+#endif
+
 /*
  * The kernel reserves 300 pids via RESERVED_PIDS in kernel/pid.c
  * That means, when it wraps around any pid < 300 will be skipped.
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/types.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pidfd.h"
+#include "../kselftest_harness.h"
+
+#define PIDFD_INFO_ALL	(PIDFD_INFO_PID | PIDFD_INFO_CREDS | \
+			 PIDFD_INFO_CGROUPID | PIDFD_INFO_STAT | \
+			 PIDFD_INFO_MEM | PIDFD_INFO_IO)
+
+TEST(pidfd_info_size)
+{
+	ASSERT_EQ(sizeof(struct pidfd_info), PIDFD_INFO_SIZE_VER0);
+	ASSERT_EQ(_IOC_SIZE(PIDFD_GET_INFO), PIDFD_INFO_SIZE_VER0);
+}
+
+TEST(pidfd_info_self)
+{
+	struct pidfd_info info = {
+		.mask = PIDFD_INFO_ALL,
+	};
+	int pidfd;
+
+	pidfd = sys_pidfd_open(getpid(), 0);
+	ASSERT_GE(pidfd, 0);
+
+	ASSERT_EQ(ioctl(pidfd, PIDFD_GET_INFO, &info), 0);
+
+	ASSERT_TRUE(info.mask & PIDFD_INFO_PID);
+	EXPECT_EQ(info.pid, getpid());
+	EXPECT_EQ(info.tgid, getpid());
+	EXPECT_EQ(info.ppid, getppid());
+
+	ASSERT_TRUE(info.mask & PIDFD_INFO_CREDS);
+	EXPECT_EQ(info.ruid, getuid());
+	EXPECT_EQ(info.euid, geteuid());
+	EXPECT_EQ(info.rgid, getgid());
+	EXPECT_EQ(info.egid, getegid());
+
+	ASSERT_TRUE(info.mask & PIDFD_INFO_STAT);
+	EXPECT_EQ(info.nr_threads, 1);
+	EXPECT_EQ(info.state, 'R');
+
+	ASSERT_TRUE(info.mask & PIDFD_INFO_MEM);
+	EXPECT_GT(info.vsize, 0);
+	EXPECT_GT(info.rss, 0);
+
+	/* we may always look at our own IO counters */
+	EXPECT_TRUE(info.mask & PIDFD_INFO_IO);
+
+	EXPECT_EQ(close(pidfd), 0);
+}
+
+TEST(pidfd_info_mask)
+{
+	struct pidfd_info info = {
+		.mask = PIDFD_INFO_PID,
+	};
+	int pidfd;
+
+	pidfd = sys_pidfd_open(getpid(), 0);
+	ASSERT_GE(pidfd, 0);
+
+	ASSERT_EQ(ioctl(pidfd, PIDFD_GET_INFO, &info), 0);
+	EXPECT_EQ(info.mask, PIDFD_INFO_PID);
+	EXPECT_EQ(info.pid, getpid());
+	/* groups that were not asked for are left cleared */
+	EXPECT_EQ(info.vsize, 0);
+
+	EXPECT_EQ(close(pidfd), 0);
+}
+
+TEST(pidfd_info_reaped)
+{
+	struct pidfd_info info = {
+		.mask = PIDFD_INFO_ALL,
+	};
+	int pidfd;
+	pid_t pid;
+
+	pid = fork();
+	ASSERT_GE(pid, 0);
+	if (pid == 0)
+		_exit(EXIT_SUCCESS);
+
+	pidfd = sys_pidfd_open(pid, 0);
+	ASSERT_GE(pidfd, 0);
+	ASSERT_EQ(waitpid(pid, NULL, 0), pid);
+
+	EXPECT_EQ(ioctl(pidfd, PIDFD_GET_INFO, &info), -1);
+	EXPECT_EQ(errno, ESRCH);
+
+	EXPECT_EQ(close(pidfd), 0);
+}
+
+TEST_HARNESS_MAIN
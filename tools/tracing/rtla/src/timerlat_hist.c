@@ -998,7 +998,12 @@ int timerlat_hist_main(int argc, char *argv[])
 		}
 	}
 
-	if (params->trace_output) {
+	/*
+	 * Events are recorded in the trace instance. They are also useful
+	 * without -t, hist: triggers aggregate them in the kernel for the
+	 * whole run and are saved when rtla exits.
+	 */
+	if (params->trace_output || params->events) {
 		record = osnoise_init_trace_tool("timerlat");
 		if (!record) {
 			err_msg("Failed to enable the trace instance\n");
@@ -1037,7 +1042,7 @@ int timerlat_hist_main(int argc, char *argv[])
 	 * tracing while enabling other instances. The trace instance is the
 	 * one with most valuable information.
 	 */
-	if (params->trace_output)
+	if (record)
 		trace_instance_start(&record->trace);
 	if (!params->no_aa)
 		trace_instance_start(&aa->trace);
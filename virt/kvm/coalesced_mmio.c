@@ -13,6 +13,8 @@
 
 #include <linux/kvm_host.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/eventfd.h>
 #include <linux/kvm.h>
 
 #include "coalesced_mmio.h"
@@ -61,6 +63,43 @@ static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_dev *dev, u32 last)
 	return 1;
 }
 
+/*
+ * The ring of a vCPU only ever gets written by the vCPU itself, so there
+ * is no need for a lock, only for ordering against the consumer.
+ */
+static int coalesced_mmio_write_vcpu(struct kvm_vcpu *vcpu,
+				     struct kvm_coalesced_mmio_dev *dev,
+				     gpa_t addr, int len, const void *val)
+{
+	struct kvm_coalesced_mmio_ring *ring = vcpu->coalesced_mmio_ring;
+	u32 max = vcpu->coalesced_mmio_max;
+	struct kvm *kvm = vcpu->kvm;
+	u32 insert, first, used;
+
+	insert = READ_ONCE(ring->last);
+	first = READ_ONCE(ring->first);
+	if (insert >= max || first >= max)
+		return -EOPNOTSUPP;
+
+	/* There is always one unused entry in the buffer */
+	used = (insert + max - first) % max;
+	if (used == max - 1)
+		return -EOPNOTSUPP;
+
+	ring->coalesced_mmio[insert].phys_addr = addr;
+	ring->coalesced_mmio[insert].len = len;
+	memcpy(ring->coalesced_mmio[insert].data, val, len);
+	ring->coalesced_mmio[insert].pio = dev->zone.pio;
+	smp_wmb();
+	WRITE_ONCE(ring->last, (insert + 1) % max);
+
+	/* Let the VMM harvest the ring in batches */
+	if (kvm->coalesced_ring_eventfd && used + 1 == kvm->coalesced_ring_batch)
+		eventfd_signal(kvm->coalesced_ring_eventfd, 1);
+
+	return 0;
+}
+
 static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
 				struct kvm_io_device *this, gpa_t addr,
 				int len, const void *val)
@@ -72,6 +111,9 @@ static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
 	if (!coalesced_mmio_in_range(dev, addr, len))
 		return -EOPNOTSUPP;
 
+	if (vcpu && vcpu->coalesced_mmio_ring)
+		return coalesced_mmio_write_vcpu(vcpu, dev, addr, len, val);
+
 	spin_lock(&dev->kvm->ring_lock);
 
 	insert = READ_ONCE(ring->last);
@@ -132,6 +174,78 @@ void kvm_coalesced_mmio_free(struct kvm *kvm)
 {
 	if (kvm->coalesced_mmio_ring)
 		free_page((unsigned long)kvm->coalesced_mmio_ring);
+	if (kvm->coalesced_ring_eventfd)
+		eventfd_ctx_put(kvm->coalesced_ring_eventfd);
+}
+
+int kvm_vm_ioctl_enable_coalesced_mmio_ring(struct kvm *kvm,
+					    struct kvm_enable_cap *cap)
+{
+	u64 size = cap->args[0], batch = cap->args[2];
+	int fd = (int)cap->args[1];
+	struct eventfd_ctx *eventfd = NULL;
+	u32 max;
+	int r;
+
+	if (!KVM_COALESCED_MMIO_RING_PAGE_OFFSET || cap->flags)
+		return -EINVAL;
+
+	if (!is_power_of_2(size) || size < PAGE_SIZE)
+		return -EINVAL;
+	if (size > KVM_COALESCED_MMIO_RING_MAX_SIZE)
+		return -E2BIG;
+
+	max = (size - sizeof(struct kvm_coalesced_mmio_ring)) /
+	      sizeof(struct kvm_coalesced_mmio);
+	if (batch >= max)
+		return -EINVAL;
+
+	if (fd >= 0) {
+		if (!batch)
+			return -EINVAL;
+		eventfd = eventfd_ctx_fdget(fd);
+		if (IS_ERR(eventfd))
+			return PTR_ERR(eventfd);
+	}
+
+	mutex_lock(&kvm->lock);
+	/* Can only be set once, before vCPUs are created */
+	if (kvm->created_vcpus || kvm->coalesced_ring_size) {
+		r = -EINVAL;
+	} else {
+		kvm->coalesced_ring_size = size;
+		kvm->coalesced_ring_batch = batch;
+		kvm->coalesced_ring_eventfd = eventfd;
+		eventfd = NULL;
+		r = 0;
+	}
+	mutex_unlock(&kvm->lock);
+
+	if (eventfd)
+		eventfd_ctx_put(eventfd);
+	return r;
+}
+
+int kvm_coalesced_mmio_vcpu_init(struct kvm_vcpu *vcpu)
+{
+	u32 size = vcpu->kvm->coalesced_ring_size;
+
+	if (!size)
+		return 0;
+
+	vcpu->coalesced_mmio_ring = vzalloc(size);
+	if (!vcpu->coalesced_mmio_ring)
+		return -ENOMEM;
+
+	vcpu->coalesced_mmio_max = (size - sizeof(struct kvm_coalesced_mmio_ring)) /
+				   sizeof(struct kvm_coalesced_mmio);
+	return 0;
+}
+
+void kvm_coalesced_mmio_vcpu_free(struct kvm_vcpu *vcpu)
+{
+	vfree(vcpu->coalesced_mmio_ring);
+	vcpu->coalesced_mmio_ring = NULL;
 }
 
 int kvm_vm_ioctl_register_coalesced_mmio(struct kvm *kvm,
@@ -28,11 +28,34 @@ int kvm_vm_ioctl_register_coalesced_mmio(struct kvm *kvm,
 					struct kvm_coalesced_mmio_zone *zone);
 int kvm_vm_ioctl_unregister_coalesced_mmio(struct kvm *kvm,
 					struct kvm_coalesced_mmio_zone *zone);
+int kvm_vm_ioctl_enable_coalesced_mmio_ring(struct kvm *kvm,
+					    struct kvm_enable_cap *cap);
+int kvm_coalesced_mmio_vcpu_init(struct kvm_vcpu *vcpu);
+void kvm_coalesced_mmio_vcpu_free(struct kvm_vcpu *vcpu);
+
+static inline bool kvm_page_in_coalesced_ring(struct kvm *kvm,
+					      unsigned long pgoff)
+{
+	return KVM_COALESCED_MMIO_RING_PAGE_OFFSET &&
+	       pgoff >= KVM_COALESCED_MMIO_RING_PAGE_OFFSET &&
+	       pgoff < KVM_COALESCED_MMIO_RING_PAGE_OFFSET +
+		       kvm->coalesced_ring_size / PAGE_SIZE;
+}
 
 #else
 
 static inline int kvm_coalesced_mmio_init(struct kvm *kvm) { return 0; }
 static inline void kvm_coalesced_mmio_free(struct kvm *kvm) { }
+static inline int kvm_coalesced_mmio_vcpu_init(struct kvm_vcpu *vcpu)
+{
+	return 0;
+}
+static inline void kvm_coalesced_mmio_vcpu_free(struct kvm_vcpu *vcpu) { }
+static inline bool kvm_page_in_coalesced_ring(struct kvm *kvm,
+					      unsigned long pgoff)
+{
+	return false;
+}
 
 #endif
 
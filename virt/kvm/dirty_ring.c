@@ -50,25 +50,66 @@ static bool kvm_dirty_ring_full(struct kvm_dirty_ring *ring)
 	return kvm_dirty_ring_used(ring) >= ring->size;
 }
 
-static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
+/*
+ * Number of coalesced resets done in a row under mmu_lock before it is
+ * dropped to let vCPUs and other rings in.
+ */
+#define KVM_DIRTY_RING_RESET_BATCH	64
+
+/*
+ * State kept across the kvm_reset_dirty_gfn() calls of a ring reset. The
+ * memslot of the last call is cached, as the harvested gfns are usually
+ * clustered, and mmu_lock is kept taken between calls. The memslots are
+ * stable for the whole reset, see kvm_dirty_ring_reset().
+ */
+struct kvm_dirty_ring_reset_batch {
+	struct kvm_memory_slot *memslot;
+	u32 slot;
+	int nr;
+	bool locked;
+};
+
+static void kvm_reset_dirty_gfn(struct kvm *kvm,
+				struct kvm_dirty_ring_reset_batch *batch,
+				u32 slot, u64 offset, u64 mask)
 {
 	struct kvm_memory_slot *memslot;
 	int as_id, id;
 
-	as_id = slot >> 16;
-	id = (u16)slot;
+	if (!batch->memslot || batch->slot != slot) {
+		as_id = slot >> 16;
+		id = (u16)slot;
 
-	if (as_id >= KVM_ADDRESS_SPACE_NUM || id >= KVM_USER_MEM_SLOTS)
-		return;
+		if (as_id >= KVM_ADDRESS_SPACE_NUM || id >= KVM_USER_MEM_SLOTS)
+			return;
 
-	memslot = id_to_memslot(__kvm_memslots(kvm, as_id), id);
+		batch->memslot = id_to_memslot(__kvm_memslots(kvm, as_id), id);
+		batch->slot = slot;
+	}
+	memslot = batch->memslot;
 
 	if (!memslot || (offset + __fls(mask)) >= memslot->npages)
 		return;
 
-	KVM_MMU_LOCK(kvm);
+	if (!batch->locked) {
+		KVM_MMU_LOCK(kvm);
+		batch->locked = true;
+	}
 	kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, memslot, offset, mask);
-	KVM_MMU_UNLOCK(kvm);
+
+	if (++batch->nr >= KVM_DIRTY_RING_RESET_BATCH || need_resched()) {
+		KVM_MMU_UNLOCK(kvm);
+		batch->locked = false;
+		batch->nr = 0;
+		cond_resched();
+	}
+}
+
+static void kvm_reset_dirty_gfn_finish(struct kvm *kvm,
+				       struct kvm_dirty_ring_reset_batch *batch)
+{
+	if (batch->locked)
+		KVM_MMU_UNLOCK(kvm);
 }
 
 int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size)
@@ -82,6 +123,7 @@ int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size)
 	ring->dirty_index = 0;
 	ring->reset_index = 0;
 	ring->index = index;
+	mutex_init(&ring->reset_lock);
 
 	return 0;
 }
@@ -103,6 +145,7 @@ static inline bool kvm_dirty_gfn_harvested(struct kvm_dirty_gfn *gfn)
 
 int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 {
+	struct kvm_dirty_ring_reset_batch batch = {};
 	u32 cur_slot, next_slot;
 	u64 cur_offset, next_offset;
 	unsigned long mask;
@@ -113,6 +156,13 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 	/* This is only needed to make compilers happy */
 	cur_slot = cur_offset = mask = 0;
 
+	/*
+	 * The caller either holds slots_lock or is in a kvm->srcu read side
+	 * critical section, so the memslots can't go away under us, but
+	 * rings may be reset by several threads in parallel.
+	 */
+	mutex_lock(&ring->reset_lock);
+
 	while (true) {
 		entry = &ring->dirty_gfns[ring->reset_index & (ring->size - 1)];
 
@@ -147,14 +197,20 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 				continue;
 			}
 		}
-		kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+		if (!first_round)
+			kvm_reset_dirty_gfn(kvm, &batch, cur_slot, cur_offset,
+					    mask);
 		cur_slot = next_slot;
 		cur_offset = next_offset;
 		mask = 1;
 		first_round = false;
 	}
 
-	kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+	if (!first_round)
+		kvm_reset_dirty_gfn(kvm, &batch, cur_slot, cur_offset, mask);
+	kvm_reset_dirty_gfn_finish(kvm, &batch);
+
+	mutex_unlock(&ring->reset_lock);
 
 	/*
 	 * The request KVM_REQ_DIRTY_RING_SOFT_FULL will be cleared
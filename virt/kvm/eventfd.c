@@ -24,6 +24,7 @@
 #include <linux/slab.h>
 #include <linux/seqlock.h>
 #include <linux/irqbypass.h>
+#include <linux/kthread.h>
 #include <trace/events/kvm.h>
 
 #include <kvm/iodev.h>
@@ -32,6 +33,14 @@
 
 static struct workqueue_struct *irqfd_cleanup_wq;
 
+/*
+ * Inject the irqfds whose route can't be handled in atomic context from a
+ * per-VM SCHED_FIFO kthread rather than from the system workqueue, where
+ * they compete with everything else.
+ */
+static bool irqfd_inject_kthread;
+module_param(irqfd_inject_kthread, bool, 0644);
+
 bool __attribute__((weak))
 kvm_arch_irqfd_allowed(struct kvm *kvm, struct kvm_irqfd *args)
 {
@@ -39,10 +48,8 @@ kvm_arch_irqfd_allowed(struct kvm *kvm, struct kvm_irqfd *args)
 }
 
 static void
-irqfd_inject(struct work_struct *work)
+__irqfd_inject(struct kvm_kernel_irqfd *irqfd)
 {
-	struct kvm_kernel_irqfd *irqfd =
-		container_of(work, struct kvm_kernel_irqfd, inject);
 	struct kvm *kvm = irqfd->kvm;
 
 	if (!irqfd->resampler) {
@@ -55,6 +62,54 @@ irqfd_inject(struct work_struct *work)
 			    irqfd->gsi, 1, false);
 }
 
+static void
+irqfd_inject(struct work_struct *work)
+{
+	__irqfd_inject(container_of(work, struct kvm_kernel_irqfd, inject));
+}
+
+static void
+irqfd_inject_kwork(struct kthread_work *work)
+{
+	__irqfd_inject(container_of(work, struct kvm_kernel_irqfd,
+				    inject_kwork));
+}
+
+/* Defer the injection to process context */
+static void
+irqfd_schedule_inject(struct kvm_kernel_irqfd *irqfd)
+{
+	++irqfd->kvm->stat.generic.irqfd_inject_slow;
+
+	if (irqfd->inject_worker)
+		kthread_queue_work(irqfd->inject_worker, &irqfd->inject_kwork);
+	else
+		schedule_work(&irqfd->inject);
+}
+
+static struct kthread_worker *
+irqfd_get_inject_worker(struct kvm *kvm)
+{
+	struct kthread_worker *worker, *old;
+
+	worker = READ_ONCE(kvm->irqfds.inject_worker);
+	if (worker)
+		return worker;
+
+	worker = kthread_create_worker(0, "kvm-irqfd-%d",
+				       task_pid_nr(current));
+	if (IS_ERR(worker))
+		return NULL;
+	sched_set_fifo_low(worker->task);
+
+	old = cmpxchg(&kvm->irqfds.inject_worker, NULL, worker);
+	if (old) {
+		kthread_destroy_worker(worker);
+		return old;
+	}
+	return worker;
+}
+
 static void irqfd_resampler_notify(struct kvm_kernel_irqfd_resampler *resampler)
 {
 	struct kvm_kernel_irqfd *irqfd;
@@ -139,6 +194,8 @@ irqfd_shutdown(struct work_struct *work)
 	 * until all previously outstanding events have completed
 	 */
 	flush_work(&irqfd->inject);
+	if (irqfd->inject_worker)
+		kthread_flush_work(&irqfd->inject_kwork);
 
 	if (irqfd->resampler) {
 		irqfd_resampler_shutdown(irqfd);
@@ -211,11 +268,20 @@ irqfd_wakeup(wait_queue_entry_t *wait, unsigned mode, int sync, void *key)
 			seq = read_seqcount_begin(&irqfd->irq_entry_sc);
 			irq = irqfd->irq_entry;
 		} while (read_seqcount_retry(&irqfd->irq_entry_sc, seq));
-		/* An event has been signaled, inject an interrupt */
+		/*
+		 * An event has been signaled, inject an interrupt.  Level
+		 * triggered irqfds are asserted on behalf of their resampler,
+		 * which deasserts them on EOI, so they can take the fast path
+		 * as well.
+		 */
 		if (kvm_arch_set_irq_inatomic(&irq, kvm,
+					      irqfd->resampler ?
+					      KVM_IRQFD_RESAMPLE_IRQ_SOURCE_ID :
 					      KVM_USERSPACE_IRQ_SOURCE_ID, 1,
 					      false) == -EWOULDBLOCK)
-			schedule_work(&irqfd->inject);
+			irqfd_schedule_inject(irqfd);
+		else
+			++kvm->stat.generic.irqfd_inject_fast;
 		srcu_read_unlock(&kvm->irq_srcu, idx);
 		ret = 1;
 	}
@@ -323,7 +389,10 @@ kvm_irqfd_assign(struct kvm *kvm, struct kvm_irqfd *args)
 	irqfd->gsi = args->gsi;
 	INIT_LIST_HEAD(&irqfd->list);
 	INIT_WORK(&irqfd->inject, irqfd_inject);
+	kthread_init_work(&irqfd->inject_kwork, irqfd_inject_kwork);
 	INIT_WORK(&irqfd->shutdown, irqfd_shutdown);
+	if (READ_ONCE(irqfd_inject_kthread))
+		irqfd->inject_worker = irqfd_get_inject_worker(kvm);
 	seqcount_spinlock_init(&irqfd->irq_entry_sc, &kvm->irqfds.lock);
 
 	f = fdget(args->fd);
@@ -422,7 +491,7 @@ kvm_irqfd_assign(struct kvm *kvm, struct kvm_irqfd *args)
 	events = vfs_poll(f.file, &irqfd->pt);
 
 	if (events & EPOLLIN)
-		schedule_work(&irqfd->inject);
+		irqfd_schedule_inject(irqfd);
 
 #ifdef CONFIG_HAVE_KVM_IRQ_BYPASS
 	if (kvm_arch_has_irq_bypass()) {
@@ -618,6 +687,10 @@ kvm_irqfd_release(struct kvm *kvm)
 	 */
 	flush_workqueue(irqfd_cleanup_wq);
 
+	if (kvm->irqfds.inject_worker) {
+		kthread_destroy_worker(kvm->irqfds.inject_worker);
+		kvm->irqfds.inject_worker = NULL;
+	}
 }
 
 /*
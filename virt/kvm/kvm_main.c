@@ -96,6 +96,13 @@ unsigned int halt_poll_ns_shrink;
 module_param(halt_poll_ns_shrink, uint, 0644);
 EXPORT_SYMBOL_GPL(halt_poll_ns_shrink);
 
+/*
+ * Skip or stretch the halt polling window of a vCPU based on when its next
+ * wakeup is predicted to arrive, see kvm_vcpu_predict_poll_ns().
+ */
+static bool halt_poll_predict;
+module_param(halt_poll_predict, bool, 0644);
+
 /*
  * Ordering of locks:
  *
@@ -484,6 +491,7 @@ static void kvm_vcpu_destroy(struct kvm_vcpu *vcpu)
 {
 	kvm_arch_vcpu_destroy(vcpu);
 	kvm_dirty_ring_free(&vcpu->dirty_ring);
+	kvm_coalesced_mmio_vcpu_free(vcpu);
 
 	/*
 	 * No need for rcu_read_lock as VCPU_RUN is the only place that changes
@@ -3493,6 +3501,73 @@ static inline void update_halt_poll_stats(struct kvm_vcpu *vcpu, ktime_t start,
 	}
 }
 
+/* Timer wakeups further apart than this aren't treated as periodic. */
+#define KVM_HALT_TIMER_PERIOD_MAX_NS	NSEC_PER_SEC
+
+static u64 halt_ewma(u64 avg, u64 val)
+{
+	if (!avg)
+		return val;
+	return avg - (avg >> 3) + (val >> 3);
+}
+
+/*
+ * Record why a halt of the vCPU ended and how long it lasted. Timer
+ * wakeups, as far as the architecture reports them through
+ * kvm_cpu_has_pending_timer(), are tracked as a period, all other valid
+ * wakeups (device interrupts, IPIs, ...) as an average halt duration.
+ */
+static void kvm_vcpu_update_wakeup_stats(struct kvm_vcpu *vcpu, ktime_t now,
+					 u64 halt_ns)
+{
+	struct kvm_vcpu_stat_generic *stats = &vcpu->stat.generic;
+
+	KVM_STATS_LOG_HIST_UPDATE(stats->halt_duration_hist, halt_ns);
+
+	if (kvm_cpu_has_pending_timer(vcpu)) {
+		u64 interval = ktime_to_ns(ktime_sub(now, vcpu->halt_last_timer));
+
+		++stats->halt_wakeup_timer;
+		if (interval < KVM_HALT_TIMER_PERIOD_MAX_NS)
+			vcpu->halt_timer_period_ns =
+				halt_ewma(vcpu->halt_timer_period_ns, interval);
+		else
+			vcpu->halt_timer_period_ns = 0;
+		vcpu->halt_last_timer = now;
+	} else if (signal_pending(current)) {
+		++stats->halt_wakeup_signal;
+	} else if (vcpu_valid_wakeup(vcpu)) {
+		++stats->halt_wakeup_irq;
+		vcpu->halt_avg_ns = halt_ewma(vcpu->halt_avg_ns, halt_ns);
+	}
+}
+
+/*
+ * Pick the polling window of this halt from the predicted wakeups: poll
+ * until the guest timer fires if it is expected within @max_ns, don't poll
+ * at all if other wakeups usually take much longer than @poll_ns to come.
+ */
+static unsigned int kvm_vcpu_predict_poll_ns(struct kvm_vcpu *vcpu,
+					     ktime_t now, unsigned int poll_ns,
+					     unsigned int max_ns)
+{
+	if (vcpu->halt_timer_period_ns) {
+		ktime_t next = ktime_add_ns(vcpu->halt_last_timer,
+					    vcpu->halt_timer_period_ns);
+		s64 timer_ns = ktime_to_ns(ktime_sub(next, now));
+
+		if (timer_ns > 0 && timer_ns <= max_ns)
+			return max_t(unsigned int, poll_ns, timer_ns);
+	}
+
+	if (poll_ns && vcpu->halt_avg_ns > 2 * (u64)poll_ns) {
+		++vcpu->stat.generic.halt_poll_skipped;
+		return 0;
+	}
+
+	return poll_ns;
+}
+
 static unsigned int kvm_vcpu_max_halt_poll_ns(struct kvm_vcpu *vcpu)
 {
 	struct kvm *kvm = vcpu->kvm;
@@ -3522,6 +3597,7 @@ void kvm_vcpu_halt(struct kvm_vcpu *vcpu)
 	unsigned int max_halt_poll_ns = kvm_vcpu_max_halt_poll_ns(vcpu);
 	bool halt_poll_allowed = !kvm_arch_no_poll(vcpu);
 	ktime_t start, cur, poll_end;
+	unsigned int poll_ns;
 	bool waited = false;
 	bool do_halt_poll;
 	u64 halt_ns;
@@ -3529,11 +3605,17 @@ void kvm_vcpu_halt(struct kvm_vcpu *vcpu)
 	if (vcpu->halt_poll_ns > max_halt_poll_ns)
 		vcpu->halt_poll_ns = max_halt_poll_ns;
 
-	do_halt_poll = halt_poll_allowed && vcpu->halt_poll_ns;
-
 	start = cur = poll_end = ktime_get();
+
+	poll_ns = vcpu->halt_poll_ns;
+	if (halt_poll_allowed && READ_ONCE(halt_poll_predict))
+		poll_ns = kvm_vcpu_predict_poll_ns(vcpu, start, poll_ns,
+						   max_halt_poll_ns);
+
+	do_halt_poll = halt_poll_allowed && poll_ns;
+
 	if (do_halt_poll) {
-		ktime_t stop = ktime_add_ns(start, vcpu->halt_poll_ns);
+		ktime_t stop = ktime_add_ns(start, poll_ns);
 
 		do {
 			if (kvm_vcpu_check_block(vcpu) < 0)
@@ -3556,6 +3638,8 @@ void kvm_vcpu_halt(struct kvm_vcpu *vcpu)
 	/* The total time the vCPU was "halted", including polling time. */
 	halt_ns = ktime_to_ns(cur) - ktime_to_ns(start);
 
+	kvm_vcpu_update_wakeup_stats(vcpu, cur, halt_ns);
+
 	/*
 	 * Note, halt-polling is considered successful so long as the vCPU was
 	 * never actually scheduled out, i.e. even if the wake event arrived
@@ -3590,6 +3674,46 @@ void kvm_vcpu_halt(struct kvm_vcpu *vcpu)
 }
 EXPORT_SYMBOL_GPL(kvm_vcpu_halt);
 
+/**
+ * kvm_vcpu_account_exit - account the time spent handling an exit
+ * @vcpu:	the vCPU which exited
+ * @type:	the class of the exit
+ * @start_ns:	ktime_get_ns() when the handling started
+ *
+ * The latencies end up in per-class log2 histograms of the binary stats.
+ */
+void kvm_vcpu_account_exit(struct kvm_vcpu *vcpu, enum kvm_exit_type type,
+			   u64 start_ns)
+{
+	struct kvm_vcpu_stat_generic *stat = &vcpu->stat.generic;
+	u64 ns = ktime_get_ns() - start_ns;
+	u64 *hist;
+
+	switch (type) {
+	case KVM_EXIT_TYPE_IRQ:
+		hist = stat->exit_irq_hist;
+		break;
+	case KVM_EXIT_TYPE_HALT:
+		hist = stat->exit_halt_hist;
+		break;
+	case KVM_EXIT_TYPE_MEM_FAULT:
+		hist = stat->exit_mem_fault_hist;
+		break;
+	case KVM_EXIT_TYPE_HYPERCALL:
+		hist = stat->exit_hypercall_hist;
+		break;
+	case KVM_EXIT_TYPE_INSN:
+		hist = stat->exit_insn_hist;
+		break;
+	default:
+		hist = stat->exit_other_hist;
+		break;
+	}
+
+	kvm_stats_log_hist_update(hist, EXIT_LATENCY_HIST_COUNT, ns);
+}
+EXPORT_SYMBOL_GPL(kvm_vcpu_account_exit);
+
 bool kvm_vcpu_wake_up(struct kvm_vcpu *vcpu)
 {
 	if (__kvm_vcpu_wake_up(vcpu)) {
@@ -3812,6 +3936,10 @@ static vm_fault_t kvm_vcpu_fault(struct vm_fault *vmf)
 #ifdef CONFIG_KVM_MMIO
 	else if (vmf->pgoff == KVM_COALESCED_MMIO_PAGE_OFFSET)
 		page = virt_to_page(vcpu->kvm->coalesced_mmio_ring);
+	else if (kvm_page_in_coalesced_ring(vcpu->kvm, vmf->pgoff))
+		page = vmalloc_to_page((void *)vcpu->coalesced_mmio_ring +
+				       (vmf->pgoff - KVM_COALESCED_MMIO_RING_PAGE_OFFSET) *
+				       PAGE_SIZE);
 #endif
 	else if (kvm_page_in_dirty_ring(vcpu->kvm, vmf->pgoff))
 		page = kvm_dirty_ring_get_page(
@@ -3834,7 +3962,9 @@ static int kvm_vcpu_mmap(struct file *file, struct vm_area_struct *vma)
 	unsigned long pages = vma_pages(vma);
 
 	if ((kvm_page_in_dirty_ring(vcpu->kvm, vma->vm_pgoff) ||
-	     kvm_page_in_dirty_ring(vcpu->kvm, vma->vm_pgoff + pages - 1)) &&
+	     kvm_page_in_dirty_ring(vcpu->kvm, vma->vm_pgoff + pages - 1) ||
+	     kvm_page_in_coalesced_ring(vcpu->kvm, vma->vm_pgoff) ||
+	     kvm_page_in_coalesced_ring(vcpu->kvm, vma->vm_pgoff + pages - 1)) &&
 	    ((vma->vm_flags & VM_EXEC) || !(vma->vm_flags & VM_SHARED)))
 		return -EINVAL;
 
@@ -3954,6 +4084,10 @@ static int kvm_vm_ioctl_create_vcpu(struct kvm *kvm, u32 id)
 			goto arch_vcpu_destroy;
 	}
 
+	r = kvm_coalesced_mmio_vcpu_init(vcpu);
+	if (r)
+		goto dirty_ring_free;
+
 	mutex_lock(&kvm->lock);
 
 #ifdef CONFIG_LOCKDEP
@@ -4000,6 +4134,8 @@ static int kvm_vm_ioctl_create_vcpu(struct kvm *kvm, u32 id)
 	xa_release(&kvm->vcpu_array, vcpu->vcpu_idx);
 unlock_vcpu_destroy:
 	mutex_unlock(&kvm->lock);
+	kvm_coalesced_mmio_vcpu_free(vcpu);
+dirty_ring_free:
 	kvm_dirty_ring_free(&vcpu->dirty_ring);
 arch_vcpu_destroy:
 	kvm_arch_vcpu_destroy(vcpu);
@@ -4532,6 +4668,15 @@ static int kvm_vm_ioctl_check_extension_generic(struct kvm *kvm, long arg)
 #endif
 #ifdef CONFIG_NEED_KVM_DIRTY_RING_WITH_BITMAP
 	case KVM_CAP_DIRTY_LOG_RING_WITH_BITMAP:
+#endif
+#ifdef CONFIG_HAVE_KVM_DIRTY_RING
+	case KVM_CAP_DIRTY_LOG_RING_RESET_LIST:
+#endif
+		return 1;
+#ifdef CONFIG_KVM_MMIO
+	case KVM_CAP_COALESCED_MMIO_RING:
+		return KVM_COALESCED_MMIO_RING_PAGE_OFFSET ?
+		       KVM_COALESCED_MMIO_RING_MAX_SIZE : 0;
 #endif
 	case KVM_CAP_BINARY_STATS_FD:
 	case KVM_CAP_SYSTEM_EVENT_DATA:
@@ -4602,6 +4747,49 @@ static int kvm_vm_ioctl_reset_dirty_pages(struct kvm *kvm)
 	return cleared;
 }
 
+static int kvm_vm_ioctl_reset_dirty_rings_list(struct kvm *kvm,
+					       struct kvm_dirty_ring_reset __user *argp)
+{
+	struct kvm_dirty_ring_reset reset;
+	struct kvm_vcpu *vcpu;
+	int cleared = 0, r = 0;
+	u32 i, id;
+	int idx;
+
+	if (!kvm->dirty_ring_size)
+		return -EINVAL;
+
+	if (copy_from_user(&reset, argp, sizeof(reset)))
+		return -EFAULT;
+	if (reset.flags || reset.nr > KVM_MAX_VCPUS)
+		return -EINVAL;
+
+	/*
+	 * slots_lock isn't needed to keep the memslots stable while their
+	 * dirty logging is enabled again, SRCU is enough and lets resets of
+	 * disjoint sets of rings proceed in parallel.
+	 */
+	idx = srcu_read_lock(&kvm->srcu);
+	for (i = 0; i < reset.nr; i++) {
+		if (get_user(id, &argp->vcpu_ids[i])) {
+			r = -EFAULT;
+			break;
+		}
+		vcpu = kvm_get_vcpu_by_id(kvm, id);
+		if (!vcpu) {
+			r = -EINVAL;
+			break;
+		}
+		cleared += kvm_dirty_ring_reset(kvm, &vcpu->dirty_ring);
+	}
+	srcu_read_unlock(&kvm->srcu, idx);
+
+	if (cleared)
+		kvm_flush_remote_tlbs(kvm);
+
+	return r ? r : cleared;
+}
+
 int __attribute__((weak)) kvm_vm_ioctl_enable_cap(struct kvm *kvm,
 						  struct kvm_enable_cap *cap)
 {
@@ -4627,6 +4815,10 @@ static int kvm_vm_ioctl_enable_cap_generic(struct kvm *kvm,
 					   struct kvm_enable_cap *cap)
 {
 	switch (cap->cap) {
+#ifdef CONFIG_KVM_MMIO
+	case KVM_CAP_COALESCED_MMIO_RING:
+		return kvm_vm_ioctl_enable_coalesced_mmio_ring(kvm, cap);
+#endif
 #ifdef CONFIG_KVM_GENERIC_DIRTYLOG_READ_PROTECT
 	case KVM_CAP_MANUAL_DIRTY_LOG_PROTECT2: {
 		u64 allowed_options = KVM_DIRTY_LOG_MANUAL_PROTECT_ENABLE;
@@ -4909,6 +5101,9 @@ static long kvm_vm_ioctl(struct file *filp,
 	case KVM_RESET_DIRTY_RINGS:
 		r = kvm_vm_ioctl_reset_dirty_pages(kvm);
 		break;
+	case KVM_RESET_DIRTY_RINGS_LIST:
+		r = kvm_vm_ioctl_reset_dirty_rings_list(kvm, argp);
+		break;
 	case KVM_GET_STATS_FD:
 		r = kvm_vm_ioctl_get_stats_fd(kvm);
 		break;
@@ -16,9 +16,18 @@
 #include <linux/highmem.h>
 #include <linux/module.h>
 #include <linux/errno.h>
+#include <linux/vmalloc.h>
 
 #include "kvm_mm.h"
 
+static bool gpc_in_range(struct gfn_to_pfn_cache *gpc, unsigned long start,
+			 unsigned long end)
+{
+	return gpc->valid && !is_error_noslot_pfn(gpc->pfn) &&
+	       gpc->uhva < end &&
+	       gpc->uhva + gpc->nr_pages * PAGE_SIZE > start;
+}
+
 /*
  * MMU notifier 'invalidate_range_start' hook.
  */
@@ -31,11 +40,21 @@ void gfn_to_pfn_cache_invalidate_start(struct kvm *kvm, unsigned long start,
 
 	spin_lock(&kvm->gpc_lock);
 	list_for_each_entry(gpc, &kvm->gpc_list, list) {
-		write_lock_irq(&gpc->lock);
+		/*
+		 * Most caches aren't hit by a given invalidation, check under
+		 * the read lock first so as not to stall their users.  A
+		 * refresh racing with the check can't mark the cache valid,
+		 * mn_active_invalidate_count is already elevated.
+		 */
+		read_lock_irq(&gpc->lock);
+		if (!gpc_in_range(gpc, start, end)) {
+			read_unlock_irq(&gpc->lock);
+			continue;
+		}
+		read_unlock_irq(&gpc->lock);
 
-		/* Only a single page so no need to care about length */
-		if (gpc->valid && !is_error_noslot_pfn(gpc->pfn) &&
-		    gpc->uhva >= start && gpc->uhva < end) {
+		write_lock_irq(&gpc->lock);
+		if (gpc_in_range(gpc, start, end)) {
 			gpc->valid = false;
 
 			/*
@@ -83,7 +102,7 @@ bool kvm_gpc_check(struct gfn_to_pfn_cache *gpc, unsigned long len)
 	if (!gpc->active)
 		return false;
 
-	if ((gpc->gpa & ~PAGE_MASK) + len > PAGE_SIZE)
+	if ((gpc->gpa & ~PAGE_MASK) + len > gpc->nr_pages * PAGE_SIZE)
 		return false;
 
 	if (gpc->generation != slots->generation || kvm_is_error_hva(gpc->uhva))
@@ -96,11 +115,13 @@ bool kvm_gpc_check(struct gfn_to_pfn_cache *gpc, unsigned long len)
 }
 EXPORT_SYMBOL_GPL(kvm_gpc_check);
 
-static void gpc_unmap_khva(kvm_pfn_t pfn, void *khva)
+static void gpc_unmap_khva(kvm_pfn_t pfn, void *khva, unsigned int nr_pages)
 {
 	/* Unmap the old pfn/page if it was mapped before. */
 	if (!is_error_noslot_pfn(pfn) && khva) {
-		if (pfn_valid(pfn))
+		if (nr_pages > 1)
+			vunmap(khva);
+		else if (pfn_valid(pfn))
 			kunmap(pfn_to_page(pfn));
 #ifdef CONFIG_HAS_IOMEM
 		else
@@ -109,6 +130,45 @@ static void gpc_unmap_khva(kvm_pfn_t pfn, void *khva)
 	}
 }
 
+static void gpc_release_pfns(kvm_pfn_t *pfns, unsigned int nr_pages)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_pages; i++)
+		kvm_release_pfn_clean(pfns[i]);
+}
+
+static int gpc_hva_to_pfns(unsigned long uhva, kvm_pfn_t *pfns,
+			   unsigned int nr_pages)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_pages; i++) {
+		/* We always request a writeable mapping */
+		pfns[i] = hva_to_pfn(uhva + i * PAGE_SIZE, false, false, NULL,
+				     true, NULL);
+		if (is_error_noslot_pfn(pfns[i])) {
+			gpc_release_pfns(pfns, i);
+			return -EFAULT;
+		}
+	}
+	return 0;
+}
+
+/* Map the pages of a multi-page cache at contiguous kernel addresses. */
+static void *gpc_vmap(kvm_pfn_t *pfns, unsigned int nr_pages)
+{
+	struct page *pages[KVM_GPC_MAX_PAGES];
+	unsigned int i;
+
+	for (i = 0; i < nr_pages; i++) {
+		if (!pfn_valid(pfns[i]))
+			return NULL;
+		pages[i] = pfn_to_page(pfns[i]);
+	}
+	return vmap(pages, nr_pages, VM_MAP, PAGE_KERNEL);
+}
+
 static inline bool mmu_notifier_retry_cache(struct kvm *kvm, unsigned long mmu_seq)
 {
 	/*
@@ -137,10 +197,12 @@ static inline bool mmu_notifier_retry_cache(struct kvm *kvm, unsigned long mmu_s
 	return kvm->mmu_invalidate_seq != mmu_seq;
 }
 
-static kvm_pfn_t hva_to_pfn_retry(struct gfn_to_pfn_cache *gpc)
+static kvm_pfn_t hva_to_pfn_retry(struct gfn_to_pfn_cache *gpc,
+				  unsigned int nr_pages)
 {
 	/* Note, the new page offset may be different than the old! */
 	void *old_khva = gpc->khva - offset_in_page(gpc->khva);
+	kvm_pfn_t new_pfns[KVM_GPC_MAX_PAGES];
 	kvm_pfn_t new_pfn = KVM_PFN_ERR_FAULT;
 	void *new_khva = NULL;
 	unsigned long mmu_seq;
@@ -175,17 +237,20 @@ static kvm_pfn_t hva_to_pfn_retry(struct gfn_to_pfn_cache *gpc)
 			 * the existing mapping and didn't create a new one.
 			 */
 			if (new_khva != old_khva)
-				gpc_unmap_khva(new_pfn, new_khva);
+				gpc_unmap_khva(new_pfn, new_khva, nr_pages);
 
-			kvm_release_pfn_clean(new_pfn);
+			gpc_release_pfns(new_pfns, nr_pages);
 
 			cond_resched();
 		}
 
-		/* We always request a writeable mapping */
-		new_pfn = hva_to_pfn(gpc->uhva, false, false, NULL, true, NULL);
-		if (is_error_noslot_pfn(new_pfn))
+		/*
+		 * All pages of the cache are looked up within the same
+		 * mmu_notifier sequence, so a single retry covers them all.
+		 */
+		if (gpc_hva_to_pfns(gpc->uhva, new_pfns, nr_pages))
 			goto out_error;
+		new_pfn = new_pfns[0];
 
 		/*
 		 * Obtain a new kernel mapping if KVM itself will access the
@@ -193,7 +258,9 @@ static kvm_pfn_t hva_to_pfn_retry(struct gfn_to_pfn_cache *gpc)
 		 * too must be done outside of gpc->lock!
 		 */
 		if (gpc->usage & KVM_HOST_USES_PFN) {
-			if (new_pfn == gpc->pfn) {
+			if (nr_pages > 1) {
+				new_khva = gpc_vmap(new_pfns, nr_pages);
+			} else if (new_pfn == gpc->pfn && gpc->nr_pages == 1) {
 				new_khva = old_khva;
 			} else if (pfn_valid(new_pfn)) {
 				new_khva = kmap(pfn_to_page(new_pfn));
@@ -203,7 +270,7 @@ static kvm_pfn_t hva_to_pfn_retry(struct gfn_to_pfn_cache *gpc)
 #endif
 			}
 			if (!new_khva) {
-				kvm_release_pfn_clean(new_pfn);
+				gpc_release_pfns(new_pfns, nr_pages);
 				goto out_error;
 			}
 		}
@@ -219,14 +286,16 @@ static kvm_pfn_t hva_to_pfn_retry(struct gfn_to_pfn_cache *gpc)
 
 	gpc->valid = true;
 	gpc->pfn = new_pfn;
+	gpc->nr_pages = nr_pages;
 	gpc->khva = new_khva + (gpc->gpa & ~PAGE_MASK);
 
 	/*
-	 * Put the reference to the _new_ pfn.  The pfn is now tracked by the
-	 * cache and can be safely migrated, swapped, etc... as the cache will
-	 * invalidate any mappings in response to relevant mmu_notifier events.
+	 * Put the reference to the _new_ pfns.  The pfns are now tracked by
+	 * the cache and can be safely migrated, swapped, etc... as the cache
+	 * will invalidate any mappings in response to relevant mmu_notifier
+	 * events.
 	 */
-	kvm_release_pfn_clean(new_pfn);
+	gpc_release_pfns(new_pfns, nr_pages);
 
 	return 0;
 
@@ -241,6 +310,8 @@ static int __kvm_gpc_refresh(struct gfn_to_pfn_cache *gpc, gpa_t gpa,
 {
 	struct kvm_memslots *slots = kvm_memslots(gpc->kvm);
 	unsigned long page_offset = gpa & ~PAGE_MASK;
+	unsigned int nr_pages = DIV_ROUND_UP(page_offset + len, PAGE_SIZE);
+	unsigned int old_nr_pages;
 	bool unmap_old = false;
 	unsigned long old_uhva;
 	kvm_pfn_t old_pfn;
@@ -248,10 +319,11 @@ static int __kvm_gpc_refresh(struct gfn_to_pfn_cache *gpc, gpa_t gpa,
 	int ret;
 
 	/*
-	 * If must fit within a single page. The 'len' argument is
-	 * only to enforce that.
+	 * Only caches used by the host alone may span several pages, the
+	 * guest can't be handed a range of non-contiguous pfns.
 	 */
-	if (page_offset + len > PAGE_SIZE)
+	if (nr_pages > KVM_GPC_MAX_PAGES ||
+	    (nr_pages > 1 && (gpc->usage & KVM_GUEST_USES_PFN)))
 		return -EINVAL;
 
 	/*
@@ -271,6 +343,7 @@ static int __kvm_gpc_refresh(struct gfn_to_pfn_cache *gpc, gpa_t gpa,
 	old_pfn = gpc->pfn;
 	old_khva = gpc->khva - offset_in_page(gpc->khva);
 	old_uhva = gpc->uhva;
+	old_nr_pages = gpc->nr_pages;
 
 	/* If the userspace HVA is invalid, refresh that first */
 	if (gpc->gpa != gpa || gpc->generation != slots->generation ||
@@ -288,12 +361,19 @@ static int __kvm_gpc_refresh(struct gfn_to_pfn_cache *gpc, gpa_t gpa,
 		}
 	}
 
+	/* All pages must be in the same memslot, so their uhvas are too */
+	if (nr_pages > 1 &&
+	    gpa_to_gfn(gpa) + nr_pages > gpc->memslot->base_gfn + gpc->memslot->npages) {
+		ret = -EFAULT;
+		goto out;
+	}
+
 	/*
-	 * If the userspace HVA changed or the PFN was already invalid,
-	 * drop the lock and do the HVA to PFN lookup again.
+	 * If the userspace HVA or the number of pages changed or the PFN was
+	 * already invalid, drop the lock and do the HVA to PFN lookup again.
 	 */
-	if (!gpc->valid || old_uhva != gpc->uhva) {
-		ret = hva_to_pfn_retry(gpc);
+	if (!gpc->valid || old_uhva != gpc->uhva || old_nr_pages != nr_pages) {
+		ret = hva_to_pfn_retry(gpc, nr_pages);
 	} else {
 		/*
 		 * If the HVA→PFN mapping was already valid, don't unmap it.
@@ -317,8 +397,12 @@ static int __kvm_gpc_refresh(struct gfn_to_pfn_cache *gpc, gpa_t gpa,
 		gpc->khva = NULL;
 	}
 
-	/* Detect a pfn change before dropping the lock! */
-	unmap_old = (old_pfn != gpc->pfn);
+	/*
+	 * Detect a pfn change before dropping the lock!  A multi-page cache
+	 * gets a new mapping on every lookup, even if the pfns are the same.
+	 */
+	unmap_old = (old_pfn != gpc->pfn) ||
+		    (old_khva != gpc->khva - offset_in_page(gpc->khva));
 
 out_unlock:
 	write_unlock_irq(&gpc->lock);
@@ -326,7 +410,7 @@ static int __kvm_gpc_refresh(struct gfn_to_pfn_cache *gpc, gpa_t gpa,
 	mutex_unlock(&gpc->refresh_lock);
 
 	if (unmap_old)
-		gpc_unmap_khva(old_pfn, old_khva);
+		gpc_unmap_khva(old_pfn, old_khva, old_nr_pages);
 
 	return ret;
 }
@@ -351,6 +435,7 @@ void kvm_gpc_init(struct gfn_to_pfn_cache *gpc, struct kvm *kvm,
 	gpc->usage = usage;
 	gpc->pfn = KVM_PFN_ERR_FAULT;
 	gpc->uhva = KVM_HVA_ERR_BAD;
+	gpc->nr_pages = 1;
 }
 EXPORT_SYMBOL_GPL(kvm_gpc_init);
 
@@ -382,6 +467,7 @@ EXPORT_SYMBOL_GPL(kvm_gpc_activate);
 void kvm_gpc_deactivate(struct gfn_to_pfn_cache *gpc)
 {
 	struct kvm *kvm = gpc->kvm;
+	unsigned int old_nr_pages;
 	kvm_pfn_t old_pfn;
 	void *old_khva;
 
@@ -405,6 +491,7 @@ void kvm_gpc_deactivate(struct gfn_to_pfn_cache *gpc)
 		gpc->khva = NULL;
 
 		old_pfn = gpc->pfn;
+		old_nr_pages = gpc->nr_pages;
 		gpc->pfn = KVM_PFN_ERR_FAULT;
 		write_unlock_irq(&gpc->lock);
 
@@ -412,7 +499,7 @@ void kvm_gpc_deactivate(struct gfn_to_pfn_cache *gpc)
 		list_del(&gpc->list);
 		spin_unlock(&kvm->gpc_lock);
 
-		gpc_unmap_khva(old_pfn, old_khva);
+		gpc_unmap_khva(old_pfn, old_khva, old_nr_pages);
 	}
 }
 EXPORT_SYMBOL_GPL(kvm_gpc_deactivate);